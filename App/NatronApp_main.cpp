@@ -34,6 +34,7 @@
 #include <QCoreApplication>
 
 #include "Engine/CLArgs.h"
+#include "Engine/RenderDaemon.h"
 
 #include "Gui/GuiApplicationManager.h"
 
@@ -52,6 +53,12 @@ main(int argc,
 
     if (args.isBackgroundMode()) {
         
+        if ( args.isRenderDaemonClient() ) {
+            ///The render is done by the daemon: do not load anything
+            QCoreApplication app(argc,argv);
+            return RenderDaemon::submitJob(args);
+        }
+        
         AppManager manager;
 
         // coverity[tainted_data]
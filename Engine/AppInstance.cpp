@@ -56,6 +56,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/OfxHost.h"
 #include "Engine/Plugin.h"
 #include "Engine/Project.h"
+#include "Engine/RenderWorkers.h"
 #include "Engine/RotoLayer.h"
 #include "Engine/Settings.h"
 #include "Engine/ViewerInstance.h"
@@ -497,112 +498,130 @@ AppInstancePrivate::executeCommandLinePythonCommands(const CLArgs& args)
 }
 
 void
-AppInstance::load(const CLArgs& cl,bool makeEmptyInstance)
+AppInstance::renderCommandLineJob(const CLArgs& cl,bool reuseLoadedProject)
 {
+    const QString& extraOnProjectCreatedScript = cl.getDefaultOnProjectLoadedScript();
+    
+    _imp->executeCommandLinePythonCommands(cl);
+    
+    
+    if (cl.getScriptFilename().isEmpty()) {
+        // cannot start a background process without a file
+        throw std::invalid_argument(tr("Project file name empty").toStdString());
+    }
     
-    declareCurrentAppVariable_Python();
 
-    if (makeEmptyInstance) {
-        return;
+    QFileInfo info(cl.getScriptFilename());
+    if (!info.exists()) {
+        throw std::invalid_argument(tr("Specified project file does not exist").toStdString());
     }
     
-    const QString& extraOnProjectCreatedScript = cl.getDefaultOnProjectLoadedScript();
+    std::list<AppInstance::RenderWork> writersWork;
     
-    _imp->executeCommandLinePythonCommands(cl);
-
     
-    ///if the app is a background project autorun and the project name is empty just throw an exception.
-    if ( (appPTR->getAppType() == AppManager::eAppTypeBackgroundAutoRun ||
-          appPTR->getAppType() == AppManager::eAppTypeBackgroundAutoRunLaunchedFromGui)) {
+    if (reuseLoadedProject) {
+        ///The project is already loaded: keep its nodes, and thus their images in the cache
+    } else if (info.suffix() == NATRON_PROJECT_FILE_EXT) {
         
-        if (cl.getScriptFilename().isEmpty()) {
-            // cannot start a background process without a file
-            throw std::invalid_argument(tr("Project file name empty").toStdString());
+        ///Load the project
+        if ( !_imp->_currentProject->loadProject(info.path(),info.fileName()) ) {
+            throw std::invalid_argument(tr("Project file loading failed.").toStdString());
         }
         
-
-        QFileInfo info(cl.getScriptFilename());
-        if (!info.exists()) {
-            throw std::invalid_argument(tr("Specified project file does not exist").toStdString());
-        }
+    } else if (info.suffix() == "py") {
         
-        std::list<AppInstance::RenderWork> writersWork;
-        
-        
-        if (info.suffix() == NATRON_PROJECT_FILE_EXT) {
-            
-            ///Load the project
-            if ( !_imp->_currentProject->loadProject(info.path(),info.fileName()) ) {
-                throw std::invalid_argument(tr("Project file loading failed.").toStdString());
-            }
-            
-        } else if (info.suffix() == "py") {
-            
-            ///Load the python script
-            loadPythonScript(info);
+        ///Load the python script
+        loadPythonScript(info);
 
-        } else {
-            throw std::invalid_argument(tr(NATRON_APPLICATION_NAME " only accepts python scripts or .ntp project files").toStdString());
-        }
-        
-        
-        ///exec the python script specified via --onload
-        if (!extraOnProjectCreatedScript.isEmpty()) {
-            QFileInfo cbInfo(extraOnProjectCreatedScript);
-            if (cbInfo.exists()) {
-                loadPythonScript(cbInfo);
-            }
+    } else {
+        throw std::invalid_argument(tr(NATRON_APPLICATION_NAME " only accepts python scripts or .ntp project files").toStdString());
+    }
+    
+    
+    ///exec the python script specified via --onload
+    if (!reuseLoadedProject && !extraOnProjectCreatedScript.isEmpty()) {
+        QFileInfo cbInfo(extraOnProjectCreatedScript);
+        if (cbInfo.exists()) {
+            loadPythonScript(cbInfo);
         }
-        
-        
-        getWritersWorkForCL(cl, writersWork);
+    }
+    
+    
+    getWritersWorkForCL(cl, writersWork);
 
+    
+    ///Set reader parameters if specified from the command-line
+    const std::list<CLArgs::ReaderArg>& readerArgs = cl.getReaderArgs();
+    for (std::list<CLArgs::ReaderArg>::const_iterator it = readerArgs.begin(); it!=readerArgs.end(); ++it) {
+        std::string readerName = it->name.toStdString();
+        NodePtr readNode = getNodeByFullySpecifiedName(readerName);
         
-        ///Set reader parameters if specified from the command-line
-        const std::list<CLArgs::ReaderArg>& readerArgs = cl.getReaderArgs();
-        for (std::list<CLArgs::ReaderArg>::const_iterator it = readerArgs.begin(); it!=readerArgs.end(); ++it) {
-            std::string readerName = it->name.toStdString();
-            NodePtr readNode = getNodeByFullySpecifiedName(readerName);
-            
-            if (!readNode) {
-                std::string exc(readerName);
-                exc.append(tr(" does not belong to the project file. Please enter a valid Read node script-name.").toStdString());
-                throw std::invalid_argument(exc);
-            } else {
-                if (!readNode->getEffectInstance()->isReader()) {
-                    std::string exc(readerName);
-                    exc.append(tr(" is not a Read node! It cannot render anything.").toStdString());
-                    throw std::invalid_argument(exc);
-                }
-            }
-            
-            if (it->filename.isEmpty()) {
+        if (!readNode) {
+            std::string exc(readerName);
+            exc.append(tr(" does not belong to the project file. Please enter a valid Read node script-name.").toStdString());
+            throw std::invalid_argument(exc);
+        } else {
+            if (!readNode->getEffectInstance()->isReader()) {
                 std::string exc(readerName);
-                exc.append(tr(": Filename specified is empty but [-i] or [--reader] was passed to the command-line").toStdString());
+                exc.append(tr(" is not a Read node! It cannot render anything.").toStdString());
                 throw std::invalid_argument(exc);
             }
-            KnobPtr fileKnob = readNode->getKnobByName(kOfxImageEffectFileParamName);
-            if (fileKnob) {
-                KnobFile* outFile = dynamic_cast<KnobFile*>(fileKnob.get());
-                if (outFile) {
-                    outFile->setValue(it->filename.toStdString());
-                }
+        }
+        
+        if (it->filename.isEmpty()) {
+            std::string exc(readerName);
+            exc.append(tr(": Filename specified is empty but [-i] or [--reader] was passed to the command-line").toStdString());
+            throw std::invalid_argument(exc);
+        }
+        KnobPtr fileKnob = readNode->getKnobByName(kOfxImageEffectFileParamName);
+        if (fileKnob) {
+            KnobFile* outFile = dynamic_cast<KnobFile*>(fileKnob.get());
+            if (outFile) {
+                outFile->setValue(it->filename.toStdString());
             }
+        }
 
+    }
+   
+    ///launch renders
+    if ( (cl.getWorkersCount() > 1) && cl.getIPCPipeName().isEmpty() ) {
+        ///Share the frames between several render processes
+        if ( writersWork.empty() ) {
+            getProjectWritersWork(cl.getFrameRanges(), writersWork);
         }
-       
-        ///launch renders
-        if (!writersWork.empty()) {
-            startWritersRendering(cl.areRenderStatsEnabled(), false, writersWork);
-        } else {
-            std::list<std::string> writers;
-            startWritersRendering(cl.areRenderStatsEnabled(), false, writers, cl.getFrameRanges());
+        if ( writersWork.empty() ) {
+            throw std::invalid_argument("Project file is missing a writer node. This project cannot render anything.");
         }
-       
-        
+        RenderWorkers workers(this, cl.getWorkersCount(), cl.getThreadsCount(), cl.areRenderStatsEnabled());
+        workers.render(writersWork); //< doesn't return before all the processes are finished
+    } else if (!writersWork.empty()) {
+        startWritersRendering(cl.areRenderStatsEnabled(), false, writersWork);
+    } else {
+        std::list<std::string> writers;
+        startWritersRendering(cl.areRenderStatsEnabled(), false, writers, cl.getFrameRanges());
+    }
+}
+
+void
+AppInstance::load(const CLArgs& cl,bool makeEmptyInstance)
+{
+    
+    declareCurrentAppVariable_Python();
+
+    if (makeEmptyInstance) {
+        return;
+    }
+    
+    const QString& extraOnProjectCreatedScript = cl.getDefaultOnProjectLoadedScript();
+    
+    ///if the app is a background project autorun and the project name is empty just throw an exception.
+    if ( (appPTR->getAppType() == AppManager::eAppTypeBackgroundAutoRun ||
+          appPTR->getAppType() == AppManager::eAppTypeBackgroundAutoRunLaunchedFromGui)) {
         
+        renderCommandLineJob(cl, false);
         
     } else if (appPTR->getAppType() == AppManager::eAppTypeInterpreter) {
+        _imp->executeCommandLinePythonCommands(cl);
         QFileInfo info(cl.getScriptFilename());
         if (info.exists()) {
             
@@ -625,6 +644,7 @@ AppInstance::load(const CLArgs& cl,bool makeEmptyInstance)
         
         appPTR->launchPythonInterpreter();
     } else {
+        _imp->executeCommandLinePythonCommands(cl);
         execOnProjectCreatedCallback();
         
         if (!extraOnProjectCreatedScript.isEmpty()) {
@@ -1280,32 +1300,7 @@ AppInstance::startWritersRendering(bool enableRenderStats,bool doBlockingRender,
         }
     } else {
         //start rendering for all writers found in the project
-        std::list<OutputEffectInstance*> writers;
-        getProject()->getWriters(&writers);
-        
-        for (std::list<OutputEffectInstance*>::const_iterator it2 = writers.begin(); it2 != writers.end(); ++it2) {
-            assert(*it2);
-            if (*it2) {
-                
-                for (std::list<std::pair<int,std::pair<int,int> > >::const_iterator it3 = frameRanges.begin(); it3!=frameRanges.end();++it3) {
-                    RenderWork w;
-                    w.writer = *it2;
-                    w.firstFrame = it3->second.first;
-                    w.lastFrame = it3->second.second;
-                    w.frameStep = it3->first;
-                    renderers.push_back(w);
-                }
-                
-                if (frameRanges.empty()) {
-                    RenderWork r;
-                    r.firstFrame = INT_MIN;
-                    r.lastFrame = INT_MAX;
-                    r.frameStep = INT_MIN;
-                    r.writer = *it2;
-                    renderers.push_back(r);
-                }
-            }
-        }
+        getProjectWritersWork(frameRanges, renderers);
     }
     
     
@@ -1316,6 +1311,38 @@ AppInstance::startWritersRendering(bool enableRenderStats,bool doBlockingRender,
     startWritersRendering(enableRenderStats, doBlockingRender, renderers);
 }
 
+void
+AppInstance::getProjectWritersWork(const std::list<std::pair<int,std::pair<int,int> > >& frameRanges,
+                                   std::list<RenderWork>& requests)
+{
+    std::list<OutputEffectInstance*> writers;
+    getProject()->getWriters(&writers);
+    
+    for (std::list<OutputEffectInstance*>::const_iterator it2 = writers.begin(); it2 != writers.end(); ++it2) {
+        assert(*it2);
+        if (*it2) {
+            
+            for (std::list<std::pair<int,std::pair<int,int> > >::const_iterator it3 = frameRanges.begin(); it3!=frameRanges.end();++it3) {
+                RenderWork w;
+                w.writer = *it2;
+                w.firstFrame = it3->second.first;
+                w.lastFrame = it3->second.second;
+                w.frameStep = it3->first;
+                requests.push_back(w);
+            }
+            
+            if (frameRanges.empty()) {
+                RenderWork r;
+                r.firstFrame = INT_MIN;
+                r.lastFrame = INT_MAX;
+                r.frameStep = INT_MIN;
+                r.writer = *it2;
+                requests.push_back(r);
+            }
+        }
+    }
+}
+
 void
 AppInstance::startWritersRendering(bool enableRenderStats,bool doBlockingRender, const std::list<RenderWork>& writers)
 {
@@ -1350,6 +1377,15 @@ void
 AppInstance::startRenderingBlockingFullSequence(bool enableRenderStats,const RenderWork& writerWork,bool /*renderInSeparateProcess*/,const QString& /*savePath*/)
 {
     BlockingBackgroundRender backgroundRender(writerWork.writer);
+    int first,last,frameStep;
+    getFrameRangeToRender(writerWork, &first, &last, &frameStep);
+    
+    backgroundRender.blockingRender(enableRenderStats,first,last,frameStep); //< doesn't return before rendering is finished
+}
+
+void
+AppInstance::getFrameRangeToRender(const RenderWork& writerWork,int* firstFrame,int* lastFrame,int* frameStep)
+{
     double first,last;
     if (writerWork.firstFrame == INT_MIN || writerWork.lastFrame == INT_MAX) {
         writerWork.writer->getFrameRange_public(writerWork.writer->getHash(), &first, &last);
@@ -1360,16 +1396,15 @@ AppInstance::startRenderingBlockingFullSequence(bool enableRenderStats,const Ren
         first = writerWork.firstFrame;
         last = writerWork.lastFrame;
     }
+    *firstFrame = first;
+    *lastFrame = last;
     
-    int frameStep;
     if (writerWork.frameStep == INT_MAX || writerWork.frameStep == INT_MIN) {
         ///Get the frame step from the frame step parameter of the Writer
-        frameStep = writerWork.writer->getNode()->getFrameStepKnobValue();
+        *frameStep = writerWork.writer->getNode()->getFrameStepKnobValue();
     } else {
-        frameStep = std::max(1, writerWork.frameStep);
+        *frameStep = std::max(1, writerWork.frameStep);
     }
-    
-    backgroundRender.blockingRender(enableRenderStats,first,last,frameStep); //< doesn't return before rendering is finished
 }
 
 void
@@ -147,6 +147,13 @@ public:
     };
     
     virtual void load(const CLArgs& cl,bool makeEmptyInstance);
+    
+    /**
+     * @brief Loads the project or script given on the command-line and renders its writers, as in a background
+     * render. If reuseLoadedProject is true the project currently loaded is rendered instead of being loaded again:
+     * its nodes, and thus their images in the cache, are kept.
+     **/
+    void renderCommandLineJob(const CLArgs& cl,bool reuseLoadedProject);
 
     int getAppID() const;
 
@@ -282,6 +289,12 @@ public:
 
     void startRenderingBlockingFullSequence(bool enableRenderStats,const RenderWork& writerWork,bool renderInSeparateProcess,const QString& savePath);
     
+    /**
+     * @brief Resolves the frame range and frame step of the given work: when not specified, they are the ones
+     * of the writer, or the frame range of the project.
+     **/
+    void getFrameRangeToRender(const RenderWork& writerWork,int* firstFrame,int* lastFrame,int* frameStep);
+    
     virtual void startRenderingFullSequence(bool enableRenderStats,const RenderWork& writerWork,bool renderInSeparateProcess,const QString& savePath);
 
     virtual void clearViewersLastRenderedTexture() {}
@@ -421,6 +434,9 @@ private:
     
     
     void getWritersWorkForCL(const CLArgs& cl,std::list<AppInstance::RenderWork>& requests);
+    
+    void getProjectWritersWork(const std::list<std::pair<int,std::pair<int,int> > >& frameRanges,
+                               std::list<AppInstance::RenderWork>& requests);
 
 
     NodePtr createNodeInternal(const CreateNodeArgs& args);
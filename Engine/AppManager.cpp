@@ -81,6 +81,7 @@
 #include "Engine/ProcessHandler.h" // ProcessInputChannel
 #include "Engine/Project.h"
 #include "Engine/PrecompNode.h"
+#include "Engine/RenderDaemon.h"
 #include "Engine/RotoPaint.h"
 #include "Engine/RotoSmear.h"
 #include "Engine/StandardPaths.h"
@@ -103,7 +104,10 @@ handleShutDownSignal( int /*signalId*/ )
 {
     if (appPTR) {
         std::cerr << "\nCaught termination signal, exiting!" << std::endl;
-        appPTR->quitApplication();
+        ///The render daemon closes its app itself, once the job being rendered is over
+        if ( !appPTR->quitRenderDaemon() ) {
+            appPTR->quitApplication();
+        }
     }
 }
 
@@ -277,6 +281,7 @@ AppManager::load(int &argc,
     _imp->idealThreadCount = QThread::idealThreadCount();
     QThreadPool::globalInstance()->setExpiryTimeout(-1); //< make threads never exit on their own
     //otherwise it might crash with thread local storage
+    _imp->taskScheduler.reset( new TaskScheduler(_imp->idealThreadCount) );
 
 #if QT_VERSION < 0x050000
     QTextCodec::setCodecForCStrings(QTextCodec::codecForName("UTF-8"));
@@ -347,8 +352,9 @@ AppManager::~AppManager()
 
     ///Caches may have launched some threads to delete images, wait for them to be done
     QThreadPool::globalInstance()->waitForDone();
+    _imp->taskScheduler.reset();
     
-    ///Kill caches now because decreaseNCacheFilesOpened can be called
+    ///Kill caches now because the deleter threads may still flush entries to the cache pack files
     _imp->_nodeCache->waitForDeleterThread();
     _imp->_diskCache->waitForDeleterThread();
     _imp->_viewerCache->waitForDeleterThread();
@@ -524,6 +530,17 @@ AppManager::loadInternal(const CLArgs& cl)
     ///Call restore after initializing knobs
     _imp->_settings->restoreSettings();
 
+    if (cl.getThreadsCount() > 0) {
+        ///This process only owns a share of the cores (e.g: it is one of the processes of a --workers render):
+        ///the parallel renders, the tiles and the thread pools are sized on that share. The settings are left
+        ///untouched, they are shared with the other processes of the user.
+        _imp->threadsCountOverride = cl.getThreadsCount();
+        _imp->idealThreadCount = cl.getThreadsCount();
+        setNThreadsToRender(_imp->threadsCountOverride);
+        QThreadPool::globalInstance()->setMaxThreadCount(_imp->threadsCountOverride);
+        _imp->taskScheduler->setMaxThreadCount(_imp->threadsCountOverride);
+    }
+
     ///basically show a splashScreen load fonts etc...
     return initGui(cl);
 
@@ -640,6 +657,21 @@ AppManager::loadInternalAfterInitGui(const CLArgs& cl)
     } else {
         onLoadCompleted();
         
+        ///Render the jobs submitted to the daemon until the process receives a termination signal
+        if ( args.isRenderDaemon() ) {
+            RenderDaemon daemon(mainInstance, args.getRenderDaemonName());
+            _imp->renderDaemon = &daemon;
+            const bool listened = daemon.exec();
+            _imp->renderDaemon = 0;
+            try {
+                mainInstance->quit();
+            } catch (std::logic_error) {
+                // ignore
+            }
+            
+            return listened;
+        }
+        
         ///In background project auto-run the rendering is finished at this point, just exit the instance
         if ( (_imp->_appType == eAppTypeBackgroundAutoRun ||
               _imp->_appType == eAppTypeBackgroundAutoRunLaunchedFromGui ||
@@ -833,8 +865,10 @@ AppManager::wipeAndCreateDiskCacheStructure()
     clearAllCaches();
     
     assert(_imp->_diskCache);
+    _imp->_diskCache->removeUnusedPackFileSegments();
     _imp->cleanUpCacheDiskStructure(_imp->_diskCache->getCachePath());
     assert(_imp->_viewerCache);
+    _imp->_viewerCache->removeUnusedPackFileSegments();
     _imp->cleanUpCacheDiskStructure(_imp->_viewerCache->getCachePath());
 }
 
@@ -882,6 +916,10 @@ AppManager::writeToOutputPipe(const QString & longMessage,
         QMutexLocker k(&_imp->_ofxLogMutex);
         ///Don't use qdebug here which is disabled if QT_NO_DEBUG_OUTPUT is defined.
         std::cout << longMessage.toStdString() << std::endl;
+        ///Stream the messages of the render to the client that submitted the job
+        if (_imp->renderDaemon) {
+            _imp->renderDaemon->writeToClient(longMessage);
+        }
         return false;
     }
     _imp->_backgroundIPC->writeToOutputChannel(shortMessage);
@@ -889,6 +927,28 @@ AppManager::writeToOutputPipe(const QString & longMessage,
     return true;
 }
 
+bool
+AppManager::flushRenderDaemonMessages()
+{
+    if (!_imp->renderDaemon) {
+        return false;
+    }
+    _imp->renderDaemon->flushClientMessages();
+
+    return true;
+}
+
+bool
+AppManager::quitRenderDaemon()
+{
+    if (!_imp->renderDaemon) {
+        return false;
+    }
+    _imp->renderDaemon->requestQuit();
+
+    return true;
+}
+
 void
 AppManager::registerAppInstance(AppInstance* app)
 {
@@ -1770,6 +1830,25 @@ AppManager::setNumberOfThreads(int threadsNb)
     _imp->_settings->setNumberOfThreads(threadsNb);
 }
 
+int
+AppManager::getNumberOfThreads() const
+{
+    if (_imp->threadsCountOverride > 0) {
+        return _imp->threadsCountOverride;
+    }
+    return _imp->_settings->getNumberOfThreads();
+}
+
+int
+AppManager::getNumberOfParallelRenders() const
+{
+    int nb = _imp->_settings->getNumberOfParallelRenders();
+    if ( (_imp->threadsCountOverride > 0) && (nb > _imp->threadsCountOverride) ) {
+        nb = _imp->threadsCountOverride;
+    }
+    return nb;
+}
+
 bool
 AppManager::getImage(const ImageKey & key,
                      std::list<boost::shared_ptr<Image> >* returnValue) const
@@ -1905,50 +1984,6 @@ AppManager::getDiskCacheLocation() const
     return _imp->diskCachesLocation;
 }
 
-
-bool
-AppManager::isNCacheFilesOpenedCapped() const
-{
-    QMutexLocker l(&_imp->currentCacheFilesCountMutex);
-
-    return _imp->currentCacheFilesCount >= _imp->maxCacheFiles;
-}
-
-size_t
-AppManager::getNCacheFilesOpened() const
-{
-    QMutexLocker l(&_imp->currentCacheFilesCountMutex);
-
-    return _imp->currentCacheFilesCount;
-}
-
-void
-AppManager::increaseNCacheFilesOpened()
-{
-    QMutexLocker l(&_imp->currentCacheFilesCountMutex);
-
-    ++_imp->currentCacheFilesCount;
-#ifdef DEBUG
-    if (_imp->currentCacheFilesCount > _imp->maxCacheFiles) {
-        qDebug() << "Cache has more files opened than the limit allowed:" << _imp->currentCacheFilesCount << '/' << _imp->maxCacheFiles;
-    }
-#endif
-#ifdef NATRON_DEBUG_CACHE
-    qDebug() << "N Cache Files Opened:" << _imp->currentCacheFilesCount;
-#endif
-}
-
-void
-AppManager::decreaseNCacheFilesOpened()
-{
-    QMutexLocker l(&_imp->currentCacheFilesCountMutex);
-
-    --_imp->currentCacheFilesCount;
-#ifdef NATRON_DEBUG_CACHE
-    qDebug() << "NFiles Opened:" << _imp->currentCacheFilesCount;
-#endif
-}
-
 void
 AppManager::onMaxPanelsOpenedChanged(int maxPanels)
 {
@@ -2763,6 +2798,12 @@ AppManager::getAppTLS() const
     return &_imp->globalTLS;
 }
 
+TaskScheduler*
+AppManager::getTaskScheduler() const
+{
+    return _imp->taskScheduler.get();
+}
+
 bool
 AppManager::hasThreadsRendering() const
 {
@@ -296,6 +296,19 @@ public:
      **/
     bool writeToOutputPipe(const QString & longMessage,const QString & shortMessage);
 
+    /**
+     * @brief If the current process is a render daemon, sends to the client of the job the messages written to the
+     * output pipe by the render threads. Returns false if the process is not a render daemon.
+     * This must be called on the main thread, which owns the socket of the client.
+     **/
+    bool flushRenderDaemonMessages();
+
+    /**
+     * @brief If the current process is a render daemon, makes it exit once the job being rendered is over.
+     * Returns false if the process is not a render daemon. This is called by the handler of the termination signals.
+     **/
+    bool quitRenderDaemon();
+
     /**
      * @brief Abort any processing on all AppInstance. It is called in some very rare cases
      * such as when changing the number of threads used by the application or when a background render
@@ -362,11 +375,6 @@ public:
                                    int minor,
                                    bool isDeprecated);
 
-    bool isNCacheFilesOpenedCapped() const;
-    size_t getNCacheFilesOpened() const;
-    void increaseNCacheFilesOpened();
-    void decreaseNCacheFilesOpened();
-
     /**
      * @brief Called by the caches to check that there's enough free memory on the computer to perform the allocation.
      * WARNING: This functin may remove some entries from the caches.
@@ -388,6 +396,17 @@ public:
      **/
     void setNumberOfThreads(int threadsNb);
     
+    /**
+     * @brief The number of render threads: the --threads option if it was given, otherwise the value of the
+     * Number of render threads setting. The --threads option never changes the settings.
+     **/
+    int getNumberOfThreads() const;
+    
+    /**
+     * @brief The number of frames rendered in parallel: the value of the setting, capped by the --threads option.
+     **/
+    int getNumberOfParallelRenders() const;
+    
     /**
      * @brief The value held by the Number of render threads settings.
      * It is stored it for faster access (1 mutex instead of 3 read/write locks)
@@ -483,6 +502,12 @@ public:
     
     AppTLS* getAppTLS() const;
     
+    /**
+     * @brief The pool of threads used to render the tiles of an image (host frame threading) and
+     * by the multi-thread suite of OpenFX.
+     **/
+    TaskScheduler* getTaskScheduler() const;
+    
     const OfxHost* getOFXHost() const;
     
     bool hasThreadsRendering() const;
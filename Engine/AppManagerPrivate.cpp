@@ -82,6 +82,7 @@ AppManagerPrivate::AppManagerPrivate()
 , _formats()
 , _plugins()
 , ofxHost( new OfxHost() )
+, taskScheduler()
 , _knobFactory( new KnobFactory() )
 , _nodeCache()
 , _diskCache()
@@ -89,15 +90,14 @@ AppManagerPrivate::AppManagerPrivate()
 , diskCachesLocationMutex()
 , diskCachesLocation()
 ,_backgroundIPC(0)
+,renderDaemon(0)
 ,_loaded(false)
 ,_binaryPath()
 ,_nodesGlobalMemoryUse(0)
 ,_ofxLogMutex()
 ,_ofxLog()
-,maxCacheFiles(0)
-,currentCacheFilesCount(0)
-,currentCacheFilesCountMutex()
 ,idealThreadCount(0)
+,threadsCountOverride(0)
 ,nThreadsToRender(0)
 ,nThreadsPerEffect(0)
 ,useThreadPool(true)
@@ -115,7 +115,7 @@ AppManagerPrivate::AppManagerPrivate()
 #endif
 ,natronPythonGIL(QMutex::Recursive)
 {
-    setMaxCacheFiles();
+    setMaxOpenedFiles();
     
     runningThreadsCount = 0;
 }
@@ -282,10 +282,14 @@ void saveCache(Cache<T>* cache)
     
     typename Cache<T>::CacheTOC toc;
     cache->save(&toc);
+    ///The allocator state must be saved after the entries have been flushed to the pack
+    CachePackFileState packState;
+    cache->getPackFile()->getState(&packState);
     unsigned int version = cache->cacheVersion();
     try {
         boost::archive::binary_oarchive oArchive(*ofile);
         oArchive << version;
+        oArchive << packState;
         oArchive << toc;
     } catch (const std::exception & e) {
         qDebug() << "Failed to serialize the cache table of contents:" << e.what();
@@ -311,6 +315,7 @@ void restoreCache(AppManagerPrivate* p,Cache<T>* cache)
             return;
         }
         typename Cache<T>::CacheTOC tableOfContents;
+        CachePackFileState packState;
         unsigned int cacheVersion = 0x1; //< default to 1 before NATRON_CACHE_VERSION was introduced
         try {
             boost::archive::binary_iarchive iArchive(*ifile);
@@ -319,9 +324,11 @@ void restoreCache(AppManagerPrivate* p,Cache<T>* cache)
             }
             //Only load caches with same version, otherwise wipe it!
             if (cacheVersion == cache->cacheVersion()) {
+                iArchive >> packState;
                 iArchive >> tableOfContents;
             } else {
                 p->cleanUpCacheDiskStructure(cache->getCachePath());
+                return;
             }
         } catch (const std::exception & e) {
             qDebug() << "Exception when reading disk cache TOC:" << e.what();
@@ -332,6 +339,13 @@ void restoreCache(AppManagerPrivate* p,Cache<T>* cache)
         QFile restoreFile( settingsFilePath.c_str() );
         restoreFile.remove();
         
+        ///The index refers to blocks of the pack: restore its allocator before any entry is created
+        if ( !cache->getPackFile()->restoreState(packState) ) {
+            qDebug() << cache->getCachePath() << "has an invalid pack file. Reseting.";
+            p->cleanUpCacheDiskStructure(cache->getCachePath());
+            return;
+        }
+        
         cache->restore(tableOfContents);
     }
 }
@@ -356,38 +370,6 @@ AppManagerPrivate::checkForCacheDiskStructure(const QString & cachePath)
 
         return false;
     }
-    QDir directory(cachePath);
-    QStringList files = directory.entryList(QDir::AllDirs);
-
-
-    /*Now counting actual data files in the cache*/
-    /*check if there's 256 subfolders, otherwise reset cache.*/
-    int count = 0; // -1 because of the restoreFile
-    int subFolderCount = 0;
-    for (int i = 0; i < files.size(); ++i) {
-        QString subFolder(cachePath);
-        subFolder.append( QDir::separator() );
-        subFolder.append(files[i]);
-        if ( ( subFolder.right(1) == QString(".") ) || ( subFolder.right(2) == QString("..") ) ) {
-            continue;
-        }
-        QDir d(subFolder);
-        if ( d.exists() ) {
-            ++subFolderCount;
-            QStringList items = d.entryList();
-            for (int j = 0; j < items.size(); ++j) {
-                if ( ( items[j] != QString(".") ) && ( items[j] != QString("..") ) ) {
-                    ++count;
-                }
-            }
-        }
-    }
-    if (subFolderCount < 256) {
-        qDebug() << cachePath << "doesn't contain sub-folders indexed from 00 to FF. Reseting.";
-        cleanUpCacheDiskStructure(cachePath);
-
-        return false;
-    }
 
     return true;
 }
@@ -407,31 +389,11 @@ AppManagerPrivate::cleanUpCacheDiskStructure(const QString & cachePath)
     }
 #endif
     cacheFolder.mkpath(".");
-
-    QStringList etr = cacheFolder.entryList(QDir::NoDotAndDotDot);
-    // if not 256 subdirs, we re-create the cache
-    if (etr.size() < 256) {
-        Q_FOREACH (QString e, etr) {
-            cacheFolder.rmdir(e);
-        }
-    }
-    for (U32 i = 0x00; i <= 0xF; ++i) {
-        for (U32 j = 0x00; j <= 0xF; ++j) {
-            std::ostringstream oss;
-            oss << std::hex <<  i;
-            oss << std::hex << j;
-            std::string str = oss.str();
-            cacheFolder.mkdir( str.c_str() );
-        }
-    }
 }
 
 void
-AppManagerPrivate::setMaxCacheFiles()
+AppManagerPrivate::setMaxOpenedFiles()
 {
-    /*Default to something reasonnable if the code below would happen to not work for some reason*/
-    size_t hardMax = NATRON_MAX_CACHE_FILES_OPENED;
-
 #if defined(Q_OS_UNIX) && defined(RLIMIT_NOFILE)
     /*
        Avoid 'Too many open files' on Unix.
@@ -450,12 +412,9 @@ AppManagerPrivate::setMaxCacheFiles()
                 // rlim_cur above OPEN_MAX even if rlim_max > OPEN_MAX.
                 if (rl.rlim_cur > OPEN_MAX) {
                     rl.rlim_cur = OPEN_MAX;
-                    hardMax = rl.rlim_cur;
                     setrlimit(RLIMIT_NOFILE, &rl);
                 }
 #             endif
-            } else {
-                hardMax = rl.rlim_cur;
             }
         }
     }
@@ -504,8 +463,6 @@ AppManagerPrivate::setMaxCacheFiles()
        }
      */
 #endif
-
-    maxCacheFiles = hardMax * 0.9;
 }
 
 NATRON_NAMESPACE_EXIT;
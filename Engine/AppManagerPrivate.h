@@ -49,6 +49,7 @@
 #include "Engine/FrameEntry.h"
 #include "Engine/Image.h"
 #include "Engine/EngineFwd.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/TLSHolder.h"
 
 NATRON_NAMESPACE_ENTER;
@@ -68,6 +69,7 @@ struct AppManagerPrivate
     std::vector<Format*> _formats; //<a list of the "base" formats available in the application
     PluginsMap _plugins; //< list of the plugins
     boost::scoped_ptr<OfxHost> ofxHost; //< OpenFX host
+    boost::scoped_ptr<TaskScheduler> taskScheduler; //< work-stealing pool for tiles and the multi-thread suite
     boost::scoped_ptr<KnobFactory> _knobFactory; //< knob maker
     boost::shared_ptr<Cache<Image> >  _nodeCache; //< Images cache
     boost::shared_ptr<Cache<Image> >  _diskCache; //< Images disk cache (used by DiskCache nodes)
@@ -78,19 +80,18 @@ struct AppManagerPrivate
     
     ProcessInputChannel* _backgroundIPC; //< object used to communicate with the main app
     //if this app is background, see the ProcessInputChannel def
+    RenderDaemon* renderDaemon; //< set while this app is a render daemon (--daemon), see RenderDaemon
     bool _loaded; //< true when the first instance is completly loaded.
     QString _binaryPath; //< the path to the application's binary
     U64 _nodesGlobalMemoryUse; //< how much memory all the nodes are using (besides the cache)
     mutable QMutex _ofxLogMutex;
     QString _ofxLog;
-    size_t maxCacheFiles; //< the maximum number of files the application can open for caching. This is the hard limit * 0.9
-    size_t currentCacheFilesCount; //< the number of cache files currently opened in the application
-    mutable QMutex currentCacheFilesCountMutex; //< protects currentCacheFilesCount
     
 
     std::string currentOCIOConfigPath; //< the currentOCIO config path
     
-    int idealThreadCount; // return value of QThread::idealThreadCount() cached here
+    int idealThreadCount; // return value of QThread::idealThreadCount() cached here, or the --threads option
+    int threadsCountOverride; // the --threads option: the share of the cores this process owns, 0 if not given
     
     int nThreadsToRender; // the value held by the corresponding Knob in the Settings, stored here for faster access (3 RW lock vs 1 mutex here)
     int nThreadsPerEffect;  // the value held by the corresponding Knob in the Settings, stored here for faster access (3 RW lock vs 1 mutex here)
@@ -157,7 +158,7 @@ struct AppManagerPrivate
     /**
      * @brief Called on startup to initialize the max opened files
      **/
-    void setMaxCacheFiles();
+    void setMaxOpenedFiles();
     
     Plugin* findPluginById(const QString& oldId,int major, int minor) const;
     
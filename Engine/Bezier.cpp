@@ -695,6 +695,7 @@ Bezier::dequeueGuiActions()
         
         _imp->isClockwiseOriented = _imp->guiIsClockwiseOriented;
         _imp->isClockwiseOrientedStatic = _imp->guiIsClockwiseOrientedStatic;
+        _imp->invalidateEvaluations();
         incrementNodesAge();
     }
     return mustCopy;
@@ -730,6 +731,7 @@ Bezier::clearAllPoints()
     _imp->featherPoints.clear();
     _imp->isClockwiseOriented.clear();
     _imp->finished = false;
+    _imp->invalidateEvaluations();
 }
 
 void
@@ -776,6 +778,7 @@ Bezier::clone(const RotoItem* other)
         _imp->isOpenBezier = otherBezier->_imp->isOpenBezier;
         _imp->finished = otherBezier->_imp->finished && !_imp->isOpenBezier;
     }
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     RotoDrawableItem::clone(other);
     Q_EMIT cloned();
@@ -873,6 +876,7 @@ Bezier::addControlPoint(double x,
         }
     }
     
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     return p;
 }
@@ -1053,6 +1057,7 @@ Bezier::addControlPointAfterIndex(int index,
         }
     }
     
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     
     return p;
@@ -1172,6 +1177,7 @@ Bezier::setCurveFinished(bool finished)
     
     getContext()->resetTransformCenter();
 
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     refreshPolygonOrientation(false);
 }
@@ -1216,6 +1222,7 @@ Bezier::removeControlPointByIndex(int index)
         
     }
     
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     refreshPolygonOrientation(false);
    
@@ -1395,6 +1402,7 @@ Bezier::movePointByIndexInternal(bool useGuiCurve,
         }
     }
     
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     refreshPolygonOrientation(useGuiCurve,time);
     if (autoKeying) {
@@ -1676,6 +1684,7 @@ Bezier::moveBezierPointInternal(BezierCP* cpParam,
         }
     }
     
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     refreshPolygonOrientation(useGuiCurve,time);
     if (!useGuiCurve) {
@@ -1803,6 +1812,7 @@ Bezier::setPointAtIndexInternal(bool setLeft,bool setRight,bool setPoint,bool fe
         }
     }
     
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     refreshPolygonOrientation(useGuiCurve,time);
     if (!useGuiCurve) {
@@ -1900,6 +1910,7 @@ Bezier::transformPoint(const boost::shared_ptr<BezierCP> & point,
         }
     }
     
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     refreshPolygonOrientation(useGuiCurve,time);
     if (!useGuiCurve) {
@@ -1938,6 +1949,7 @@ Bezier::removeFeatherAtIndex(int index)
 
     (*fp)->clone(**cp);
     
+    _imp->invalidateEvaluations();
     incrementNodesAge();
   
 }
@@ -1986,6 +1998,7 @@ Bezier::smoothOrCuspPointAtIndex(bool isSmooth,int index,double time,const std::
         }
     }
     
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     refreshPolygonOrientation(useGuiCurve,time);
     if (autoKeying) {
@@ -2060,6 +2073,7 @@ Bezier::setKeyframe(double time)
             }
         }
     }
+    _imp->invalidateEvaluations();
     _imp->setMustCopyGuiBezier(true);
     Q_EMIT keyframeSet(time);
 }
@@ -2096,6 +2110,7 @@ Bezier::removeKeyframe(double time)
         copyInternalPointsToGuiPoints();
     }
     
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     getContext()->evaluateChange();
     Q_EMIT keyframeRemoved(time);
@@ -2128,6 +2143,7 @@ Bezier::removeAnimation()
         copyInternalPointsToGuiPoints();
     }
     
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     Q_EMIT animationRemoved();
 }
@@ -2183,6 +2199,7 @@ Bezier::moveKeyframe(double oldTime,double newTime)
         copyInternalPointsToGuiPoints();
     }
     
+    _imp->invalidateEvaluations();
     incrementNodesAge();
     Q_EMIT keyframeRemoved(oldTime);
     Q_EMIT keyframeSet(newTime);
@@ -2233,6 +2250,114 @@ Bezier::deCastelJau(bool useGuiCurves,
     } // for()
 }
 
+void
+Bezier::evaluateCached(BezierEvaluation* eval) const
+{
+    //Private - should already be locked
+    assert( !itemMutex.tryLock() );
+    
+    _imp->getTrackOffsetsAtTime(eval->time, &eval->trackOffsets);
+    U64 age;
+    if ( _imp->findEvaluation(eval, &age) ) {
+        return;
+    }
+    
+    switch (eval->type) {
+    case BezierEvaluation::eTypePolygon: {
+        std::list<Point> points;
+        deCastelJau(eval->useGuiCurves, _imp->points, eval->time, eval->mipMapLevel, _imp->finished, eval->nbPointsPerSegment, eval->transform, &points, &eval->bbox);
+        eval->points.assign( points.begin(), points.end() );
+        break;
+    }
+    case BezierEvaluation::eTypeFeatherPolygon:
+    case BezierEvaluation::eTypeFeatherPolygonAllSegments: {
+        if ( _imp->points.empty() ) {
+            break;
+        }
+        const bool evaluateIfEqual = (eval->type == BezierEvaluation::eTypeFeatherPolygonAllSegments);
+        std::list<Point> points;
+        BezierCPs::const_iterator itCp = _imp->points.begin();
+        BezierCPs::const_iterator next = _imp->featherPoints.begin();
+        if (next != _imp->featherPoints.end()) {
+            ++next;
+        }
+        BezierCPs::const_iterator nextCp = itCp;
+        if (nextCp != _imp->points.end()) {
+            ++nextCp;
+        }
+        
+        for (BezierCPs::const_iterator it = _imp->featherPoints.begin(); it != _imp->featherPoints.end();
+             ++it) {
+            if ( next == _imp->featherPoints.end() ) {
+                next = _imp->featherPoints.begin();
+            }
+            if ( nextCp == _imp->points.end() ) {
+                if (!_imp->finished) {
+                    break;
+                }
+                nextCp = _imp->points.begin();
+            }
+            if ( !evaluateIfEqual && bezierSegmenEqual(eval->useGuiCurves, eval->time, /*view*/0, **itCp, **nextCp, **it, **next) ) {
+                continue;
+            }
+            
+            bezierSegmentEval(eval->useGuiCurves, *(*it),*(*next), eval->time,/*view*/0, eval->mipMapLevel, eval->nbPointsPerSegment, eval->transform, &points, &eval->bbox);
+            
+            // increment for next iteration
+            if (itCp != _imp->featherPoints.end()) {
+                ++itCp;
+            }
+            if (next != _imp->featherPoints.end()) {
+                ++next;
+            }
+            if (nextCp != _imp->featherPoints.end()) {
+                ++nextCp;
+            }
+        } // for(it)
+        eval->points.assign( points.begin(), points.end() );
+        break;
+    }
+    case BezierEvaluation::eTypeBoundingBox: {
+        bezierSegmentListBboxUpdate(eval->useGuiCurves, _imp->points, _imp->finished, _imp->isOpenBezier, eval->time, /*view*/0, eval->mipMapLevel, eval->transform, &eval->bbox);
+        if (useFeatherPoints() && !_imp->isOpenBezier) {
+            bezierSegmentListBboxUpdate(eval->useGuiCurves, _imp->featherPoints, _imp->finished, _imp->isOpenBezier, eval->time, /*view*/0, eval->mipMapLevel, eval->transform, &eval->bbox);
+        }
+        break;
+    }
+    case BezierEvaluation::eTypeControlPoints:
+    case BezierEvaluation::eTypeFeatherPoints: {
+        const BezierCPs& cps = (eval->type == BezierEvaluation::eTypeControlPoints) ? _imp->points : _imp->featherPoints;
+        eval->points.reserve( cps.size() );
+        for (BezierCPs::const_iterator it = cps.begin(); it != cps.end(); ++it) {
+            Transform::Point3D p;
+            p.z = 1;
+            (*it)->getPositionAtTime(eval->useGuiCurves, eval->time, /*view*/0, &p.x, &p.y);
+            p = Transform::matApply(eval->transform, p);
+            Point pos = {p.x, p.y};
+            eval->points.push_back(pos);
+        }
+        break;
+    }
+    }
+    
+    _imp->insertEvaluation(*eval, age);
+} // evaluateCached
+
+///Appends the points of eval to points and merges its bbox into bbox, as the evaluation functions do
+static void
+appendEvaluation(const BezierEvaluation& eval,
+                 std::list<Point>* points,
+                 RectD* bbox)
+{
+    points->insert( points->end(), eval.points.begin(), eval.points.end() );
+    if (bbox) {
+        bbox->x1 = std::min(bbox->x1, eval.bbox.x1);
+        bbox->x2 = std::max(bbox->x2, eval.bbox.x2);
+        bbox->y1 = std::min(bbox->y1, eval.bbox.y1);
+        bbox->y2 = std::max(bbox->y2, eval.bbox.y2);
+    }
+}
+
 void
 Bezier::evaluateAtTime_DeCasteljau(bool useGuiPoints,
                                    double time,
@@ -2243,8 +2368,18 @@ Bezier::evaluateAtTime_DeCasteljau(bool useGuiPoints,
 {
     Transform::Matrix3x3 transform;
     getTransformAtTime(time, &transform);
-    QMutexLocker l(&itemMutex);
-    deCastelJau(useGuiPoints,_imp->points, time, mipMapLevel, _imp->finished, nbPointsPerSegment, transform, points, bbox);
+    BezierEvaluation eval(BezierEvaluation::eTypePolygon, useGuiPoints, time, mipMapLevel, nbPointsPerSegment, transform);
+    {
+        QMutexLocker l(&itemMutex);
+        evaluateCached(&eval);
+    }
+    appendEvaluation(eval, points, bbox);
+}
+
+void
+Bezier::invalidateEvaluations()
+{
+    _imp->invalidateEvaluations();
 }
 
 void
@@ -2267,53 +2402,16 @@ Bezier::evaluateFeatherPointsAtTime_DeCasteljau(bool useGuiPoints,
                                                 RectD* bbox) const ///< output
 {
     assert(useFeatherPoints());
-    QMutexLocker l(&itemMutex);
-
-    
-    if ( _imp->points.empty() ) {
-        return;
-    }
-    BezierCPs::const_iterator itCp = _imp->points.begin();
-    BezierCPs::const_iterator next = _imp->featherPoints.begin();
-    if (next != _imp->featherPoints.end()) {
-        ++next;
-    }
-    BezierCPs::const_iterator nextCp = itCp;
-    if (nextCp != _imp->points.end()) {
-        ++nextCp;
-    }
     
     Transform::Matrix3x3 transform;
     getTransformAtTime(time, &transform);
-    
-    for (BezierCPs::const_iterator it = _imp->featherPoints.begin(); it != _imp->featherPoints.end();
-         ++it) {
-        if ( next == _imp->featherPoints.end() ) {
-            next = _imp->featherPoints.begin();
-        }
-        if ( nextCp == _imp->points.end() ) {
-            if (!_imp->finished) {
-                break;
-            }
-            nextCp = _imp->points.begin();
-        }
-        if ( !evaluateIfEqual && bezierSegmenEqual(useGuiPoints,time, /*view*/0, **itCp, **nextCp, **it, **next) ) {
-            continue;
-        }
-
-        bezierSegmentEval(useGuiPoints, *(*it),*(*next), time,/*view*/0,  mipMapLevel, nbPointsPerSegment, transform, points, bbox);
-
-        // increment for next iteration
-        if (itCp != _imp->featherPoints.end()) {
-            ++itCp;
-        }
-        if (next != _imp->featherPoints.end()) {
-            ++next;
-        }
-        if (nextCp != _imp->featherPoints.end()) {
-            ++nextCp;
-        }
-    } // for(it)
+    BezierEvaluation eval(evaluateIfEqual ? BezierEvaluation::eTypeFeatherPolygonAllSegments : BezierEvaluation::eTypeFeatherPolygon,
+                          useGuiPoints, time, mipMapLevel, nbPointsPerSegment, transform);
+    {
+        QMutexLocker l(&itemMutex);
+        evaluateCached(&eval);
+    }
+    appendEvaluation(eval, points, bbox);
 }
 
 void
@@ -2373,18 +2471,15 @@ Bezier::getBoundingBox(double time) const
     RectD bbox;
     bool bboxSet = false;
     for (double t = startTime; t <= endTime; t+= mbFrameStep) {
-        RectD subBbox; // a very empty bbox
-        subBbox.setupInfinity();
-        
         Transform::Matrix3x3 transform;
         getTransformAtTime(t, &transform);
         
+        BezierEvaluation eval(BezierEvaluation::eTypeBoundingBox, false, t, 0, 0, transform);
         QMutexLocker l(&itemMutex);
-        bezierSegmentListBboxUpdate(false,_imp->points, _imp->finished, _imp->isOpenBezier, t, /*view*/0, 0, transform , &subBbox);
-        
+        evaluateCached(&eval);
+        RectD subBbox = eval.bbox;
         
         if (useFeatherPoints() && !_imp->isOpenBezier) {
-            bezierSegmentListBboxUpdate(false,_imp->featherPoints, _imp->finished, _imp->isOpenBezier, t, /*view*/0, 0, transform, &subBbox);
             // EDIT: Partial fix, just pad the BBOX by the feather distance. This might not be accurate but gives at least something
             // enclosing the real bbox and close enough
             double featherDistance = getFeatherDistance(t);
@@ -2466,12 +2561,16 @@ Bezier::isNearbyControlPoint(double x,
     
     Transform::Matrix3x3 transform;
     getTransformAtTime(time, &transform);
+    BezierEvaluation controlPositions(BezierEvaluation::eTypeControlPoints, true, time, 0, 0, transform);
+    BezierEvaluation featherPositions(BezierEvaluation::eTypeFeatherPoints, true, time, 0, 0, transform);
     QMutexLocker l(&itemMutex);
+    evaluateCached(&controlPositions);
+    evaluateCached(&featherPositions);
     boost::shared_ptr<BezierCP> cp,fp;
 
     switch (pref) {
     case eControlPointSelectionPrefFeatherFirst: {
-        BezierCPs::const_iterator itF = _imp->findFeatherPointNearby(x, y, acceptance, time, /*view*/0,transform, index);
+        BezierCPs::const_iterator itF = _imp->findFeatherPointNearby(x, y, acceptance, featherPositions.points, index);
         if ( itF != _imp->featherPoints.end() ) {
             fp = *itF;
             BezierCPs::const_iterator it = _imp->points.begin();
@@ -2480,7 +2579,7 @@ Bezier::isNearbyControlPoint(double x,
 
             return std::make_pair(fp, cp);
         } else {
-            BezierCPs::const_iterator it = _imp->findControlPointNearby(x, y, acceptance, time, /*view*/0,transform, index);
+            BezierCPs::const_iterator it = _imp->findControlPointNearby(x, y, acceptance, controlPositions.points, index);
             if ( it != _imp->points.end() ) {
                 cp = *it;
                 itF = _imp->featherPoints.begin();
@@ -2495,7 +2594,7 @@ Bezier::isNearbyControlPoint(double x,
     case eControlPointSelectionPrefControlPointFirst:
     case eControlPointSelectionPrefWhateverFirst:
     default: {
-        BezierCPs::const_iterator it = _imp->findControlPointNearby(x, y, acceptance, time, /*view*/0,transform, index);
+        BezierCPs::const_iterator it = _imp->findControlPointNearby(x, y, acceptance, controlPositions.points, index);
         if ( it != _imp->points.end() ) {
             cp = *it;
             BezierCPs::const_iterator itF = _imp->featherPoints.begin();
@@ -2504,7 +2603,7 @@ Bezier::isNearbyControlPoint(double x,
 
             return std::make_pair(cp, fp);
         } else {
-            BezierCPs::const_iterator itF = _imp->findFeatherPointNearby(x, y, acceptance, time, /*view*/0,transform, index);
+            BezierCPs::const_iterator itF = _imp->findFeatherPointNearby(x, y, acceptance, featherPositions.points, index);
             if ( itF != _imp->featherPoints.end() ) {
                 fp = *itF;
                 it = _imp->points.begin();
@@ -2843,6 +2942,7 @@ Bezier::load(const RotoItemSerialization & obj)
         }
         copyInternalPointsToGuiPoints();
     }
+    _imp->invalidateEvaluations();
     refreshPolygonOrientation(false);
     RotoDrawableItem::load(obj);
 }
@@ -2921,6 +3021,7 @@ Bezier::setKeyFrameInterpolation(KeyframeTypeEnum interp,int index)
             ++fp;
         }
     }
+    _imp->invalidateEvaluations();
 }
 
 
@@ -65,6 +65,7 @@ NATRON_NAMESPACE_ENTER;
 
 
 struct BezierPrivate;
+struct BezierEvaluation;
 class Bezier
     : public RotoDrawableItem
 {
@@ -360,6 +361,8 @@ public:
     /**
      * @brief Evaluates the spline at the given time and returns the list of all the points on the curve.
      * @param nbPointsPerSegment controls how many points are used to draw one Bezier segment
+     * The evaluations are cached until the points or their animation change, so that the render, the RoD
+     * and the overlay share them.
      **/
     void evaluateAtTime_DeCasteljau(bool useGuiCurves,
                                     double time,
@@ -368,6 +371,11 @@ public:
                                     std::list<Point>* points,
                                     RectD* bbox) const;
     
+    /**
+     * @brief Clears the cache of the evaluations, e.g: when a point is slaved to a track or unslaved.
+     **/
+    void invalidateEvaluations();
+
     /**
      * @brief Same as evaluateAtTime_DeCasteljau but nbPointsPerSegment is approximated automatically
      **/
@@ -390,8 +398,8 @@ public:
                                                  RectD* bbox) const;
 
     /**
-     * @brief Returns the bounding box of the bezier. The last value computed by evaluateAtTime_DeCasteljau will be returned,
-     * otherwise if it has never been called, evaluateAtTime_DeCasteljau will be called to compute the bounding box.
+     * @brief Returns the bounding box of the bezier, padded by the feather distance or the brush size.
+     * The bounding box of the segments is cached per time, like the evaluations of evaluateAtTime_DeCasteljau.
      **/
     virtual RectD getBoundingBox(double time) const OVERRIDE;
     
@@ -536,6 +544,12 @@ private:
     
     void copyInternalPointsToGuiPoints();
     
+    /**
+     * @brief Fills the points and bbox of eval from the cache of the evaluations of this Bezier, computing them if they are not cached.
+     * The item mutex must be locked.
+     **/
+    void evaluateCached(BezierEvaluation* eval) const;
+    
 public:
     
 
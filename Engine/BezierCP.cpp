@@ -101,20 +101,10 @@ BezierCP::getPositionAtTime(bool useGuiCurves,
     }
 
     if (!skipMasterOrRelative) {
-        SequenceTime offsetTime;
-        KnobDouble* masterTrack;
-        {
-            QReadLocker l(&_imp->masterMutex);
-            offsetTime = _imp->offsetTime;
-            masterTrack = _imp->masterTrack ? _imp->masterTrack.get() : NULL;
-        }
-        if (masterTrack) {
-            double masterX = masterTrack->getValueAtTime(time, 0, ViewIdx(view));
-            double masterY = masterTrack->getValueAtTime(time, 1, ViewIdx(view));
-            double masterOffsetTimeX = masterTrack->getValueAtTime(offsetTime, 0, ViewIdx(view));
-            double masterOffsetTimeY = masterTrack->getValueAtTime(offsetTime, 1, ViewIdx(view));
-            *x += (masterX - masterOffsetTimeX);
-            *y += (masterY - masterOffsetTimeY);
+        double offsetX, offsetY;
+        if ( getMasterTrackOffsetAtTime(time, view, &offsetX, &offsetY) ) {
+            *x += offsetX;
+            *y += offsetY;
         }
     }
 
@@ -233,20 +223,10 @@ BezierCP::getLeftBezierPointAtTime(bool useGuiCurves,
     }
 
     if (!skipMasterOrRelative) {
-        KnobDouble* masterTrack;
-        SequenceTime offsetTime;
-        {
-            QReadLocker l(&_imp->masterMutex);
-            masterTrack = _imp->masterTrack ? _imp->masterTrack.get() : NULL;
-            offsetTime = _imp->offsetTime;
-        }
-        if (masterTrack) {
-            double masterX = masterTrack->getValueAtTime(time, 0, ViewIdx(view));
-            double masterY = masterTrack->getValueAtTime(time, 1, ViewIdx(view));
-            double masterOffsetTimeX = masterTrack->getValueAtTime(offsetTime, 0, ViewIdx(view));
-            double masterOffsetTimeY = masterTrack->getValueAtTime(offsetTime, 1, ViewIdx(view));
-            *x += (masterX - masterOffsetTimeX);
-            *y += (masterY - masterOffsetTimeY);
+        double offsetX, offsetY;
+        if ( getMasterTrackOffsetAtTime(time, view, &offsetX, &offsetY) ) {
+            *x += offsetX;
+            *y += offsetY;
         }
     }
 
@@ -294,20 +274,10 @@ BezierCP::getRightBezierPointAtTime(bool useGuiCurves,
 
 
     if (!skipMasterOrRelative) {
-        KnobDouble* masterTrack;
-        SequenceTime offsetTime;
-        {
-            QReadLocker l(&_imp->masterMutex);
-            masterTrack = _imp->masterTrack ? _imp->masterTrack.get() : NULL;
-            offsetTime = _imp->offsetTime;
-        }
-        if (masterTrack) {
-            double masterX = masterTrack->getValueAtTime(time, 0, ViewIdx(view));
-            double masterY = masterTrack->getValueAtTime(time, 1, ViewIdx(view));
-            double masterOffsetTimeX = masterTrack->getValueAtTime(offsetTime,0, ViewIdx(view));
-            double masterOffsetTimeY = masterTrack->getValueAtTime(offsetTime, 1, ViewIdx(view));
-            *x += (masterX - masterOffsetTimeX);
-            *y += (masterY - masterOffsetTimeY);
+        double offsetX, offsetY;
+        if ( getMasterTrackOffsetAtTime(time, view, &offsetX, &offsetY) ) {
+            *x += offsetX;
+            *y += offsetY;
         }
     }
 
@@ -951,6 +921,28 @@ BezierCP::equalsAtTime(bool useGuiCurves,
     return false;
 }
 
+bool
+BezierCP::getMasterTrackOffsetAtTime(double time,
+                                     int view,
+                                     double* x,
+                                     double* y) const
+{
+    KnobDouble* masterTrack;
+    SequenceTime offsetTime;
+    {
+        QReadLocker l(&_imp->masterMutex);
+        masterTrack = _imp->masterTrack ? _imp->masterTrack.get() : NULL;
+        offsetTime = _imp->offsetTime;
+    }
+    if (!masterTrack) {
+        return false;
+    }
+    *x = masterTrack->getValueAtTime(time, 0, ViewIdx(view)) - masterTrack->getValueAtTime(offsetTime, 0, ViewIdx(view));
+    *y = masterTrack->getValueAtTime(time, 1, ViewIdx(view)) - masterTrack->getValueAtTime(offsetTime, 1, ViewIdx(view));
+
+    return true;
+}
+
 SequenceTime
 BezierCP::getOffsetTime() const
 {
@@ -1007,9 +999,15 @@ BezierCP::slaveTo(SequenceTime offsetTime,
 {
     assert( QThread::currentThread() == qApp->thread() );
     assert(!_imp->masterTrack);
-    QWriteLocker l(&_imp->masterMutex);
-    _imp->masterTrack = track;
-    _imp->offsetTime = offsetTime;
+    {
+        QWriteLocker l(&_imp->masterMutex);
+        _imp->masterTrack = track;
+        _imp->offsetTime = offsetTime;
+    }
+    boost::shared_ptr<Bezier> bezier = getBezier();
+    if (bezier) {
+        bezier->invalidateEvaluations();
+    }
 }
 
 void
@@ -1017,8 +1015,14 @@ BezierCP::unslave()
 {
     assert( QThread::currentThread() == qApp->thread() );
     assert(_imp->masterTrack);
-    QWriteLocker l(&_imp->masterMutex);
-    _imp->masterTrack.reset();
+    {
+        QWriteLocker l(&_imp->masterMutex);
+        _imp->masterTrack.reset();
+    }
+    boost::shared_ptr<Bezier> bezier = getBezier();
+    if (bezier) {
+        bezier->invalidateEvaluations();
+    }
 }
 
 boost::shared_ptr<KnobDouble>
@@ -163,6 +163,12 @@ public:
     void unslave();
 
     SequenceTime getOffsetTime() const;
+
+    /**
+     * @brief If the point is slaved to a track, returns in x and y what the track adds to its position at the given
+     * time. Returns false if the point is not slaved.
+     **/
+    bool getMasterTrackOffsetAtTime(double time, int view, double* x, double* y) const;
     
     void cloneInternalCurvesToGuiCurves();
     
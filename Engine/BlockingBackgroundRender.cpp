@@ -37,6 +37,9 @@ CLANG_DIAG_ON(deprecated-register)
 #include "Engine/OutputEffectInstance.h"
 #include "Engine/Settings.h"
 
+// How often a render daemon sends the messages of the render threads to its client, in milliseconds
+#define NATRON_RENDER_DAEMON_FLUSH_MS 100
+
 NATRON_NAMESPACE_ENTER;
 
 
@@ -55,11 +58,17 @@ BlockingBackgroundRender::blockingRender(bool enableRenderStats,int first,int la
     assert(_running == false);
     _running = true;
     _writer->renderFullSequence(true, enableRenderStats,this,first,last, frameStep);
-    if (appPTR->getCurrentSettings()->getNumberOfThreads() == -1) {
+    if (appPTR->getNumberOfThreads() == -1) {
         _running = false;
     } else {
         while (_running) {
-            _runningCond.wait(&_runningMutex);
+            ///Only this thread may write to the socket of the client of a render daemon: wake up regularly to send it
+            ///the messages of the render threads
+            if ( appPTR->flushRenderDaemonMessages() ) {
+                _runningCond.wait(&_runningMutex, NATRON_RENDER_DAEMON_FLUSH_MS);
+            } else {
+                _runningCond.wait(&_runningMutex);
+            }
         }
     }
 }
@@ -57,6 +57,18 @@ struct CLArgsPrivate
     
     QString ipcPipe;
     
+    int workersCount;
+    
+    int threadsCount;
+    
+    bool isRenderDaemon;
+    
+    bool isRenderDaemonClient;
+    
+    QString renderDaemonName;
+    
+    QStringList renderDaemonJobArgs;
+    
     int error;
     
     bool isInterpreterMode;
@@ -89,6 +101,12 @@ struct CLArgsPrivate
     , pythonCommands()
     , isBackground(false)
     , ipcPipe()
+    , workersCount(0)
+    , threadsCount(0)
+    , isRenderDaemon(false)
+    , isRenderDaemonClient(false)
+    , renderDaemonName()
+    , renderDaemonJobArgs()
     , error(0)
     , isInterpreterMode(false)
     , frameRanges()
@@ -186,6 +204,12 @@ CLArgs::operator=(const CLArgs& other)
     _imp->pythonCommands = other._imp->pythonCommands;
     _imp->isBackground = other._imp->isBackground;
     _imp->ipcPipe = other._imp->ipcPipe;
+    _imp->workersCount = other._imp->workersCount;
+    _imp->threadsCount = other._imp->threadsCount;
+    _imp->isRenderDaemon = other._imp->isRenderDaemon;
+    _imp->isRenderDaemonClient = other._imp->isRenderDaemonClient;
+    _imp->renderDaemonName = other._imp->renderDaemonName;
+    _imp->renderDaemonJobArgs = other._imp->renderDaemonJobArgs;
     _imp->error = other._imp->error;
     _imp->isInterpreterMode = other._imp->isInterpreterMode;
     _imp->frameRanges = other._imp->frameRanges;
@@ -282,7 +306,36 @@ CLArgs::printUsage(const std::string& programName)
                               "     breakdown contains informations about each nodes, render times etc...\n"
                               "     This option is useful for debugging purposes or to control that a render\n"
                               "     is working correctly.\n"
-                              "     **Please note** that it does not work when writing video files."
+                              "     **Please note** that it does not work when writing video files.\n"
+                              "  --workers <number of processes> :\n"
+                              "    Share the frames to render between several render processes, each\n"
+                              "    loading a snapshot of the project. This makes the renders that do not\n"
+                              "    use all the cores in a single process (e.g. nodes running Python\n"
+                              "    expressions) scale with the number of cores.\n"
+                              "    The frames are interleaved between the processes, or split in\n"
+                              "    contiguous chunks for the Write nodes that prefer to render\n"
+                              "    sequentially. Write nodes that can only render sequentially (e.g.\n"
+                              "    video files) are rendered by a single process.\n"
+                              "    The frames of a process that fails or crashes are rendered again by\n"
+                              "    another process.\n"
+                              "  --threads <number of threads> :\n"
+                              "    The number of cores this process may use for rendering. With the\n"
+                              "    --workers option, the number of cores given to each render process,\n"
+                              "    which otherwise share the cores of the computer equally. The\n"
+                              "    preferences are left unchanged.\n"
+                              "  --daemon :\n"
+                              "    Start a render daemon: the process loads %1 once, then renders the\n"
+                              "    jobs submitted with the --submit option, one after the other. The\n"
+                              "    project of the last job stays loaded with its images in the cache, so\n"
+                              "    that the next jobs on the same project start rendering right away.\n"
+                              "  --submit :\n"
+                              "    Submit the render given on the command-line to the render daemon of\n"
+                              "    this user, print its progress and exit once it is rendered. Relative\n"
+                              "    paths are relative to the current directory of the submitting process.\n"
+                              "  --socket <name> :\n"
+                              "    The name of the local socket of the render daemon, to run several\n"
+                              "    daemons. On Linux and OS X, the socket is created in the runtime\n"
+                              "    directory of the user unless the name is a path.\n"
                               "Sample uses:\n"
                               "  %1 /Users/Me/MyNatronProjects/MyProject.ntp\n"
                               "  %1 -b -w MyWriter /Users/Me/MyNatronProjects/MyProject.ntp\n"
@@ -290,6 +343,9 @@ CLArgs::printUsage(const std::string& programName)
                               "  %1Renderer -w MyWriter /FastDisk/Pictures/sequence'###'.exr 1-100 /Users/Me/MyNatronProjects/MyProject.ntp\n"
                               "  %1Renderer -w MyWriter -w MySecondWriter 1-10 /Users/Me/MyNatronProjects/MyProject.ntp\n"
                               "  %1Renderer -w MyWriter 1-10 -l /Users/Me/Scripts/onProjectLoaded.py /Users/Me/MyNatronProjects/MyProject.ntp\n"
+                              "  %1Renderer -w MyWriter 1-100 --workers 4 /Users/Me/MyNatronProjects/MyProject.ntp\n"
+                              "  %1Renderer --daemon\n"
+                              "  %1Renderer --submit -w MyWriter 1-10 /Users/Me/MyNatronProjects/MyProject.ntp\n"
                               "\n"
                               /* Text must hold in 80 columns ************************************************/
                               "Options for the execution of Python scripts:\n"
@@ -440,6 +496,42 @@ CLArgs::getIPCPipeName() const
     return _imp->ipcPipe;
 }
 
+int
+CLArgs::getWorkersCount() const
+{
+    return _imp->workersCount;
+}
+
+int
+CLArgs::getThreadsCount() const
+{
+    return _imp->threadsCount;
+}
+
+bool
+CLArgs::isRenderDaemon() const
+{
+    return _imp->isRenderDaemon;
+}
+
+bool
+CLArgs::isRenderDaemonClient() const
+{
+    return _imp->isRenderDaemonClient;
+}
+
+const QString&
+CLArgs::getRenderDaemonName() const
+{
+    return _imp->renderDaemonName;
+}
+
+const QStringList&
+CLArgs::getRenderDaemonJobArguments() const
+{
+    return _imp->renderDaemonJobArgs;
+}
+
 bool
 CLArgs::areRenderStatsEnabled() const
 {
@@ -636,6 +728,9 @@ static bool tryParseMultipleFrameRanges(const QString& args,std::list<std::pair<
 void
 CLArgsPrivate::parse()
 {
+    ///The arguments as given, which are forwarded to the render daemon by the --submit option
+    const QStringList givenArgs = args;
+    
     {
         QStringList::iterator it = hasToken("version", "v");
         if (it != args.end()) {
@@ -773,6 +868,102 @@ CLArgsPrivate::parse()
         }
     }
     
+    ///Parse the processes and threads counts before the frame ranges, which would take the numbers for single frames
+    {
+        QStringList::iterator it = hasToken("workers", "");
+        if (it != args.end()) {
+            if (!isBackground || isInterpreterMode) {
+                std::cout << QObject::tr("You cannot use the --workers option in interactive or interpreter mode").toStdString() << std::endl;
+                error = 1;
+                return;
+            }
+            QStringList::iterator next = it;
+            ++next;
+            bool ok = false;
+            if (next != args.end()) {
+                workersCount = next->toInt(&ok);
+            }
+            if (!ok || workersCount < 1) {
+                std::cout << QObject::tr("You must specify a number of render processes greater than 0 when using the --workers option").toStdString() << std::endl;
+                error = 1;
+                return;
+            }
+            ++next;
+            args.erase(it, next);
+        }
+    }
+    
+    {
+        QStringList::iterator it = hasToken("threads", "");
+        if (it != args.end()) {
+            QStringList::iterator next = it;
+            ++next;
+            bool ok = false;
+            if (next != args.end()) {
+                threadsCount = next->toInt(&ok);
+            }
+            if (!ok || threadsCount < 1) {
+                std::cout << QObject::tr("You must specify a number of threads greater than 0 when using the --threads option").toStdString() << std::endl;
+                error = 1;
+                return;
+            }
+            ++next;
+            args.erase(it, next);
+        }
+    }
+    
+    {
+        QStringList::iterator it = hasToken("socket", "");
+        if (it != args.end()) {
+            QStringList::iterator next = it;
+            ++next;
+            if (next == args.end()) {
+                std::cout << QObject::tr("You must specify the name of the render daemon socket when using the --socket option").toStdString() << std::endl;
+                error = 1;
+                return;
+            }
+            renderDaemonName = *next;
+            ++next;
+            args.erase(it, next);
+        }
+    }
+    
+    {
+        QStringList::iterator it = hasToken("daemon", "");
+        if (it != args.end()) {
+            if (!isBackground || isInterpreterMode) {
+                std::cout << QObject::tr("You cannot use the --daemon option in interactive or interpreter mode").toStdString() << std::endl;
+                error = 1;
+                return;
+            }
+            isRenderDaemon = true;
+            args.erase(it);
+        }
+    }
+    
+    {
+        QStringList::iterator it = hasToken("submit", "");
+        if (it != args.end()) {
+            if (!isBackground || isInterpreterMode || isRenderDaemon) {
+                std::cout << QObject::tr("You can only use the --submit option to submit a background render to a render daemon").toStdString() << std::endl;
+                error = 1;
+                return;
+            }
+            isRenderDaemonClient = true;
+            args.erase(it);
+            
+            ///The daemon parses the job with the options of the client removed
+            renderDaemonJobArgs = givenArgs;
+            renderDaemonJobArgs.removeFirst();
+            renderDaemonJobArgs.removeAll("--submit");
+            const int socketIndex = renderDaemonJobArgs.indexOf("--socket");
+            if (socketIndex != -1) {
+                renderDaemonJobArgs.removeAt(socketIndex);
+                renderDaemonJobArgs.removeAt(socketIndex);
+            }
+        }
+    }
+    
     {
         QStringList::iterator it = hasToken("onload", "l");
         if (it != args.end()) {
@@ -803,7 +994,7 @@ CLArgsPrivate::parse()
         QStringList::iterator it = findFileNameWithExtension(NATRON_PROJECT_FILE_EXT);
         if (it == args.end()) {
             it = findFileNameWithExtension("py");
-            if (it == args.end() && !isInterpreterMode && isBackground) {
+            if (it == args.end() && !isInterpreterMode && isBackground && !isRenderDaemon) {
                 std::cout << QObject::tr("You must specify the filename of a script or %1 project. (.%2)").arg(NATRON_APPLICATION_NAME).arg(NATRON_PROJECT_FILE_EXT).toStdString() << std::endl;
                 error = 1;
                 return;
@@ -116,6 +116,36 @@ public:
     
     const QString& getIPCPipeName() const;
     
+    /*
+     * @brief The number of render processes given with --workers, or 0
+     */
+    int getWorkersCount() const;
+    
+    /*
+     * @brief The number of threads given with --threads, or 0
+     */
+    int getThreadsCount() const;
+    
+    /*
+     * @brief True if --daemon was given: the process serves the render jobs submitted to its local socket
+     */
+    bool isRenderDaemon() const;
+    
+    /*
+     * @brief True if --submit was given: the render is submitted to a render daemon instead of being done here
+     */
+    bool isRenderDaemonClient() const;
+    
+    /*
+     * @brief The name of the render daemon socket given with --socket, or an empty string for the default one
+     */
+    const QString& getRenderDaemonName() const;
+    
+    /*
+     * @brief With --submit, the arguments of the render job sent to the daemon
+     */
+    const QStringList& getRenderDaemonJobArguments() const;
+    
     bool isPythonScript() const;
     
     bool areRenderStatsEnabled() const;
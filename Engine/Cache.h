@@ -46,14 +46,18 @@ GCC_DIAG_OFF(deprecated)
 #include <QtCore/QObject>
 #include <QtCore/QBuffer>
 #include <QtCore/QRunnable>
+#include <QtCore/QAtomicInt>
 GCC_DIAG_ON(deprecated)
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/atomic.hpp>
 #endif
 
 #include "Engine/AppManager.h" //for access to settings
 #include "Engine/Settings.h"
 #include "Engine/CacheEntry.h"
+#include "Engine/CachePackFile.h"
 #include "Engine/LRUHashTable.h"
 #include "Engine/StandardPaths.h"
 #include "Engine/ImageLocker.h"
@@ -63,6 +67,12 @@ GCC_DIAG_ON(deprecated)
 //Beyond that percentage of occupation, the cache will start evicting LRU entries
 #define NATRON_CACHE_LIMIT_PERCENT 0.9
 
+//Number of independently locked buckets the hash space of a cache is split into. Must be a power of 2.
+#define NATRON_CACHE_BUCKETS_COUNT 32
+
+//Number of entries evicted from a bucket before the next bucket in LRU order is visited, in a batch of evictions
+#define NATRON_CACHE_EVICTIONS_PER_BUCKET 4
+
 ///When defined, number of opened files, memory size and disk size of the cache are printed whenever there's activity.
 //#define NATRON_DEBUG_CACHE
 
@@ -457,23 +467,41 @@ public:
 
 private:
 
+    /**
+     * @brief The hash space of the cache is split into NATRON_CACHE_BUCKETS_COUNT buckets. Each bucket has its own
+     * LRU containers and its own locks so that threads looking up entries with different hashes do not contend.
+     **/
+    struct CacheBucket
+    {
+        mutable QMutex getLock; //prevents get() and getOrCreate() to be called simultaneously for hashes of this bucket
+        mutable QMutex lock; //protects memoryCache & diskCache
+
+        /*These 2 are mutable because we need to modify the LRU list even
+             when we call get() and we want this function to be const.*/
+        mutable CacheContainer memoryCache;
+        mutable CacheContainer diskCache;
+
+        CacheBucket()
+            : getLock()
+            , lock()
+            , memoryCache()
+            , diskCache()
+        {
+        }
+    };
 
-    std::size_t _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
-    std::size_t _maximumCacheSize;     // maximum size allowed for the cache
+    boost::atomic<std::size_t> _maximumInMemorySize;     // the maximum size of the in-memory portion of the cache.(in % of the maximum cache size)
+    boost::atomic<std::size_t> _maximumCacheSize;     // maximum size allowed for the cache
 
     /*mutable because we need to change modify it in the sealEntryInternal function which
          is called by an external object that have a const ref to the cache.
      */
-    mutable std::size_t _memoryCacheSize;     // current size of the cache in bytes
-    mutable std::size_t _diskCacheSize;
-    mutable QMutex _sizeLock; // protects _memoryCacheSize & _diskCacheSize & _maximumInMemorySize & _maximumCacheSize
-    mutable QMutex _lock; //protects _memoryCache & _diskCache
-    mutable QMutex _getLock;  //prevents get() and getOrCreate() to be called simultaneously
-
-    /*These 2 are mutable because we need to modify the LRU list even
-         when we call get() and we want this function to be const.*/
-    mutable CacheContainer _memoryCache;
-    mutable CacheContainer _diskCache;
+    mutable boost::atomic<std::size_t> _memoryCacheSize;     // current size of the cache in bytes
+    mutable boost::atomic<std::size_t> _diskCacheSize;
+
+    ///Incremented on every access to an entry, used to approximate a global LRU order across buckets
+    mutable QAtomicInt _accessTick;
+    mutable CacheBucket _buckets[NATRON_CACHE_BUCKETS_COUNT];
     const std::string _cacheName;
     const unsigned int _version;
 
@@ -485,9 +513,14 @@ private:
     std::size_t _maxPhysicalRAM;
     bool _tearingDown;
     mutable DeleterThread<EntryType> _deleterThread;
-    mutable QWaitCondition _memoryFullCondition; //< protected by _sizeLock
+    mutable QMutex _memoryFullMutex; //< used along with _memoryFullCondition
+    mutable QWaitCondition _memoryFullCondition;
     mutable CacheCleanerThread _cleanerThread;
 
+    ///The storage of all disk entries, created on first use in the cache directory
+    mutable QMutex _packFileMutex;
+    mutable boost::scoped_ptr<CachePackFile> _packFile;
+
 public:
 
 
@@ -499,33 +532,33 @@ public:
           ,
           double maximumInMemoryPercentage)      //how much should live in RAM
         : CacheAPI()
-        , _maximumInMemorySize(maximumCacheSize * maximumInMemoryPercentage)
-        , _maximumCacheSize(maximumCacheSize)
+        , _maximumInMemorySize( (std::size_t)(maximumCacheSize * maximumInMemoryPercentage) )
+        , _maximumCacheSize( (std::size_t)maximumCacheSize )
         , _memoryCacheSize(0)
         , _diskCacheSize(0)
-        , _sizeLock()
-        , _lock()
-        , _getLock()
-        , _memoryCache()
-        , _diskCache()
+        , _accessTick(0)
         , _cacheName(cacheName)
         , _version(version)
         , _signalEmitter(new CacheSignalEmitter)
         , _maxPhysicalRAM( getSystemTotalRAM() )
         , _tearingDown(false)
         , _deleterThread(this)
+        , _memoryFullMutex()
         , _memoryFullCondition()
         , _cleanerThread(this)
+        , _packFileMutex()
+        , _packFile()
     {
     }
 
     virtual ~Cache()
     {
-        QMutexLocker locker(&_lock);
-
         _tearingDown = true;
-        _memoryCache.clear();
-        _diskCache.clear();
+        for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+            QMutexLocker locker(&_buckets[i].lock);
+            _buckets[i].memoryCache.clear();
+            _buckets[i].diskCache.clear();
+        }
         delete _signalEmitter;
     }
 
@@ -549,13 +582,23 @@ public:
     bool get(const typename EntryType::key_type & key,
              std::list<EntryTypePtr>* returnValue) const
     {
-        ///Be atomic, so it cannot be created by another thread in the meantime
-        QMutexLocker getlocker(&_getLock);
+        CacheBucket & bucket = getBucket( key.getHash() );
+        bool ret;
+        bool reopenedFromDisk = false;
+        {
+            ///Be atomic, so it cannot be created by another thread in the meantime
+            QMutexLocker getlocker(&bucket.getLock);
 
-        ///lock the cache before reading it.
-        QMutexLocker locker(&_lock);
+            ///lock the bucket before reading it.
+            QMutexLocker locker(&bucket.lock);
 
-        return getInternal(key, returnValue);
+            ret = getInternal(bucket, key, returnValue, &reopenedFromDisk);
+        }
+        if (reopenedFromDisk) {
+            evictExceedingMemoryEntries();
+        }
+
+        return ret;
     } // get
 
 private:
@@ -564,46 +607,29 @@ private:
                         const ParamsTypePtr & params,
                         EntryTypePtr* returnValue) const
     {
-        //_lock must not be taken here
+        //the bucket lock must not be taken here
 
         ///Before allocating the memory check that there's enough space to fit in memory
         appPTR->checkCacheFreeMemoryIsGoodEnough();
 
 
-        ///Just in case, we don't allow more than X files to be removed at once.
-        int safeCounter = 0;
-        ///If too many files are opened, fall-back on RAM storage.
-        while (appPTR->isNCacheFilesOpenedCapped() && safeCounter < 1000) {
-#ifdef NATRON_DEBUG_CACHE
-            qDebug() << "Reached maximum cache files opened limit,clearing last recently used one...";
-#endif
-            if ( !evictLRUDiskEntry() ) {
-                break;
-            }
-            ++safeCounter;
-        }
-
-        U64 memoryCacheSize, maximumInMemorySize;
         {
-            QMutexLocker k(&_sizeLock);
-            memoryCacheSize = _memoryCacheSize;
-            maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-        }
-        {
-            QMutexLocker locker(&_lock);
+            U64 memoryCacheSize = _memoryCacheSize.load(boost::memory_order_relaxed);
+            U64 maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize.load(boost::memory_order_relaxed) );
             std::list<EntryTypePtr> entriesToBeDeleted;
             double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
+            EvictionOrder order;
             ///While the current cache size can't fit the new entry, erase the last recently used entries.
             ///Also if the total free RAM is under the limit of the system free RAM to keep free, erase LRU entries.
             while (occupationPercentage > NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictEntry(deleted) ) {
+                if ( !tryEvictEntry(deleted, &order) ) {
                     break;
                 }
 
                 for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
                     if ( !(*it)->isStoredOnDisk() ) {
-                        memoryCacheSize -= (*it)->size();
+                        memoryCacheSize -= std::min( (U64)(*it)->size(), memoryCacheSize );
                     }
                     entriesToBeDeleted.push_back(*it);
                 }
@@ -622,18 +648,17 @@ private:
         }
         {
             //If _maximumcacheSize == 0 we don't return 1 otherwise we would cause a deadlock
-            QMutexLocker k(&_sizeLock);
-            double occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+            QMutexLocker k(&_memoryFullMutex);
+            double occupationPercentage = getMemoryOccupation();
 
             //_memoryCacheSize member will get updated while images are being destroyed by the parallel thread.
             //we wait for cache memory occupation to be < 100% to be sure we don't hit swap here
             while ( occupationPercentage >= 1. && _deleterThread.isWorking() ) {
-                _memoryFullCondition.wait(&_sizeLock);
-                occupationPercentage =  _maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize / _maximumCacheSize;
+                _memoryFullCondition.wait(&_memoryFullMutex);
+                occupationPercentage = getMemoryOccupation();
             }
         }
         {
-            QMutexLocker locker(&_lock);
             StorageModeEnum storage;
             if (params->getCost() == 0) {
                 storage = eStorageModeRAM;
@@ -645,12 +670,7 @@ private:
 
 
             try {
-                std::string filePath;
-                if (storage == eStorageModeDisk) {
-                    filePath = getCachePath().toStdString();
-                    filePath += '/';
-                }
-                returnValue->reset( new EntryType(key, params, this, storage, filePath) );
+                returnValue->reset( new EntryType(key, params, this, storage) );
 
                 ///Don't call allocateMemory() here because we're still under the lock and we might force tons of threads to wait unnecesserarily
             } catch (const std::bad_alloc & e) {
@@ -658,6 +678,7 @@ private:
             }
 
             if (*returnValue) {
+                QMutexLocker locker( &getBucket( (*returnValue)->getHashKey() ).lock );
                 sealEntry(*returnValue, true);
             }
         }
@@ -668,13 +689,16 @@ public:
     void swapOrInsert(const EntryTypePtr& entryToBeEvicted,
                       const EntryTypePtr& newEntry)
     {
-        QMutexLocker locker(&_lock);
-        
         const typename EntryType::key_type& key = entryToBeEvicted->getKey();
         typename EntryType::hash_type hash = entryToBeEvicted->getHashKey();
+        CacheBucket & bucket = getBucket(hash);
+
+        QMutexLocker locker(&bucket.lock);
+        
+        touchEntry(newEntry);
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache(hash);
-        if (memoryCached != _memoryCache.end()) {
+        CacheIterator memoryCached = bucket.memoryCache(hash);
+        if (memoryCached != bucket.memoryCache.end()) {
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
             for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                 if ( (*it)->getKey() == key && (*it)->getParams() == entryToBeEvicted->getParams()) {
@@ -686,8 +710,8 @@ public:
             ret.push_back(newEntry);
         } else {
             ///Look in disk cache
-            CacheIterator diskCached = _diskCache(hash);
-            if (diskCached != _diskCache.end()) {
+            CacheIterator diskCached = bucket.diskCache(hash);
+            if (diskCached != bucket.diskCache.end()) {
                 ///Remove the old entry
                 std::list<EntryTypePtr> & ret = getValueFromIterator(diskCached);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
@@ -699,7 +723,7 @@ public:
 
             }
             ///Insert in mem cache
-            _memoryCache.insert(hash, newEntry);
+            bucket.memoryCache.insert(hash, newEntry);
         }
     }
 
@@ -737,30 +761,39 @@ public:
     {
         ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
+        CacheBucket & bucket = getBucket( key.getHash() );
+        bool reopenedFromDisk = false;
+        bool found = false;
 
         {
             ///Be atomic, so it cannot be created by another thread in the meantime
-            QMutexLocker getlocker(&_getLock);
+            QMutexLocker getlocker(&bucket.getLock);
             std::list<EntryTypePtr> entries;
             bool didGetSucceed;
             {
-                QMutexLocker locker(&_lock);
-                didGetSucceed = getInternal(key, &entries);
+                QMutexLocker locker(&bucket.lock);
+                didGetSucceed = getInternal(bucket, key, &entries, &reopenedFromDisk);
             }
             if (didGetSucceed) {
                 for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
                     if (*(*it)->getParams() == *params) {
                         *returnValue = *it;
-
-                        return true;
+                        found = true;
+                        break;
                     }
                 }
             }
 
-            createInternal(key, params, returnValue);
-
-            return false;
+            if (!found) {
+                createInternal(key, params, returnValue);
+            }
         } // getlocker
+
+        if (reopenedFromDisk) {
+            evictExceedingMemoryEntries();
+        }
+
+        return found;
     }
 
     /**
@@ -775,13 +808,15 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            if ( evictedFromMemory.second->isStoredOnDisk() ) {
-                evictedFromMemory.second->removeAnyBackingFile();
+        for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+            QMutexLocker locker(&_buckets[i].lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromMemory = _buckets[i].memoryCache.evict();
+            while (evictedFromMemory.second) {
+                if ( evictedFromMemory.second->isStoredOnDisk() ) {
+                    evictedFromMemory.second->removeAnyBackingFile();
+                }
+                evictedFromMemory = _buckets[i].memoryCache.evict();
             }
-            evictedFromMemory = _memoryCache.evict();
         }
 
         if (_signalEmitter) {
@@ -800,17 +835,20 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
 
-        /// An entry which has a use_count greater than 1 is not removable:
-        /// The backing file must not be removed because it might be read/written to
-        /// at the same time. The best we can do is just let it here in the cache.
-        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-        //we'll let the user of these entries purge the extra entries left in the cache later on
-        while (evictedFromDisk.second) {
-            evictedFromDisk.second->removeAnyBackingFile();
-            evictedFromDisk = _diskCache.evict();
+        for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+            QMutexLocker locker(&_buckets[i].lock);
+
+            /// An entry which has a use_count greater than 1 is not removable:
+            /// The backing file must not be removed because it might be read/written to
+            /// at the same time. The best we can do is just let it here in the cache.
+            std::pair<hash_type, EntryTypePtr> evictedFromDisk = _buckets[i].diskCache.evict();
+            //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+            //we'll let the user of these entries purge the extra entries left in the cache later on
+            while (evictedFromDisk.second) {
+                evictedFromDisk.second->removeAnyBackingFile();
+                evictedFromDisk = _buckets[i].diskCache.evict();
+            }
         }
 
 
@@ -827,49 +865,36 @@ public:
             ///block signals otherwise the we would be spammed of notifications
             _signalEmitter->blockSignals(true);
         }
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evictedFromMemory = _memoryCache.evict();
-        while (evictedFromMemory.second) {
-            ///move back the entry on disk if it can be store on disk
-            if ( evictedFromMemory.second->isStoredOnDisk() ) {
-                evictedFromMemory.second->deallocate();
-                /*insert it back into the disk portion */
-
-                U64 diskCacheSize, maximumCacheSize;
-                {
-                    QMutexLocker k(&_sizeLock);
-                    diskCacheSize = _diskCacheSize;
-                    maximumCacheSize = _maximumCacheSize;
-                }
-
-                /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
-                while (diskCacheSize + evictedFromMemory.second->size() >= maximumCacheSize) {
-                    {
-                        std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-                        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-                        //we'll let the user of these entries purge the extra entries left in the cache later on
-                        if (!evictedFromDisk.second) {
-                            break;
+        for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+            {
+                QMutexLocker locker(&_buckets[i].lock);
+                std::pair<hash_type, EntryTypePtr> evictedFromMemory = _buckets[i].memoryCache.evict();
+                while (evictedFromMemory.second) {
+                    ///move back the entry on disk if it can be store on disk
+                    if ( evictedFromMemory.second->isStoredOnDisk() ) {
+                        evictedFromMemory.second->deallocate();
+                        /*insert it back into the disk portion */
+
+                        /*update the disk cache size*/
+                        CacheIterator existingDiskCacheEntry = _buckets[i].diskCache( evictedFromMemory.second->getHashKey() );
+                        /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
+                        if ( existingDiskCacheEntry == _buckets[i].diskCache.end() ) {
+                            _buckets[i].diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
                         }
-                        ///Erase the file from the disk if we reach the limit.
-                        evictedFromDisk.second->removeAnyBackingFile();
-                    }
-                    {
-                        QMutexLocker k(&_sizeLock);
-                        diskCacheSize = _diskCacheSize;
-                        maximumCacheSize = _maximumCacheSize;
                     }
-                }
 
-                /*update the disk cache size*/
-                CacheIterator existingDiskCacheEntry = _diskCache( evictedFromMemory.second->getHashKey() );
-                /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-                if ( existingDiskCacheEntry == _diskCache.end() ) {
-                    _diskCache.insert(evictedFromMemory.second->getHashKey(), evictedFromMemory.second);
+                    evictedFromMemory = _buckets[i].memoryCache.evict();
                 }
             }
 
-            evictedFromMemory = _memoryCache.evict();
+            /*we need to clear the disk cache if it exceeds the maximum size allowed*/
+            while ( _diskCacheSize.load(boost::memory_order_relaxed) >= _maximumCacheSize.load(boost::memory_order_relaxed) ) {
+                //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+                //we'll let the user of these entries purge the extra entries left in the cache later on
+                if ( !evictLRUDiskEntry() ) {
+                    break;
+                }
+            }
         }
 
         _signalEmitter->blockSignals(false);
@@ -885,23 +910,19 @@ public:
         std::list<EntryTypePtr> entriesToBeDeleted;
 
         {
-            QMutexLocker locker(&_lock);
-            U64 memoryCacheSize, maximumInMemorySize;
-            {
-                QMutexLocker k(&_sizeLock);
-                memoryCacheSize = _memoryCacheSize;
-                maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize );
-            }
+            U64 memoryCacheSize = _memoryCacheSize.load(boost::memory_order_relaxed);
+            U64 maximumInMemorySize = std::max( (std::size_t)1, _maximumInMemorySize.load(boost::memory_order_relaxed) );
             double occupationPercentage = (double)memoryCacheSize / maximumInMemorySize;
+            EvictionOrder order;
             while (occupationPercentage >= NATRON_CACHE_LIMIT_PERCENT) {
                 std::list<EntryTypePtr> deleted;
-                if ( !tryEvictEntry(deleted) ) {
+                if ( !tryEvictEntry(deleted, &order) ) {
                     break;
                 }
 
                 for (typename std::list<EntryTypePtr>::iterator it = deleted.begin(); it != deleted.end(); ++it) {
                     if ( !(*it)->isStoredOnDisk() ) {
-                        memoryCacheSize -= (*it)->size();
+                        memoryCacheSize -= std::min( (U64)(*it)->size(), memoryCacheSize );
                     }
                     entriesToBeDeleted.push_back(*it);
                 }
@@ -917,15 +938,17 @@ public:
      **/
     void getCopy(std::list<EntryTypePtr>* copy) const
     {
-        QMutexLocker locker(&_lock);
+        for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+            QMutexLocker locker(&_buckets[i].lock);
 
-        for (CacheIterator it = _memoryCache.begin(); it != _memoryCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
-        }
-        for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
-            const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
-            copy->insert( copy->end(), entries.begin(), entries.end() );
+            for (CacheIterator it = _buckets[i].memoryCache.begin(); it != _buckets[i].memoryCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
+            for (CacheIterator it = _buckets[i].diskCache.begin(); it != _buckets[i].diskCache.end(); ++it) {
+                const std::list<EntryTypePtr> & entries = getValueFromIterator(it);
+                copy->insert( copy->end(), entries.begin(), entries.end() );
+            }
         }
     }
 
@@ -939,13 +962,9 @@ public:
         ///Make sure the shared_ptrs live in this list and are destroyed not while under the lock
         ///so that the memory freeing (which might be expensive for large images) doesn't happen while under the lock
         std::list<EntryTypePtr> entriesToBeDeleted;
-        bool ret;
-        {
-            QMutexLocker locker(&_lock);
-            ret = tryEvictEntry(entriesToBeDeleted);
-        }
+        EvictionOrder order;
 
-        return ret;
+        return tryEvictEntry(entriesToBeDeleted, &order);
     }
 
     /**
@@ -955,18 +974,18 @@ public:
      **/
     bool evictLRUDiskEntry() const
     {
-        QMutexLocker locker(&_lock);
-        std::pair<hash_type, EntryTypePtr> evicted = _diskCache.evict();
+        EntryTypePtr evicted;
+        EvictionOrder order;
 
         //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
         //we'll let the user of these entries purge the extra entries left in the cache later on
-        if (!evicted.second) {
+        if ( !tryEvictDiskEntry(&evicted, &order) ) {
             return false;
         }
         /*if it is stored on disk, remove it from memory*/
 
-        assert( evicted.second.unique() );
-        evicted.second->removeAnyBackingFile();
+        assert( evicted.unique() );
+        evicted->removeAnyBackingFile();
 
         return true;
     }
@@ -978,22 +997,17 @@ public:
     virtual void notifyEntrySizeChanged(std::size_t oldSize,
                                         std::size_t newSize) const OVERRIDE FINAL
     {
-        ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache
-        QMutexLocker k(&_sizeLock);
-
         ///This function can only be called for RAM buffers or while a memory mapped file is mapped into the RAM, so
         ///we just have to modify the RAM size.
 
         ///Avoid overflows, _memoryCacheSize may not always fallback to 0
-        qint64 diff = (qint64)newSize - (qint64)oldSize;
-
-        if (diff < 0) {
-            _memoryCacheSize = diff > (qint64)_memoryCacheSize ? 0 : _memoryCacheSize + diff;
+        if (newSize < oldSize) {
+            subtractClamped(_memoryCacheSize, oldSize - newSize);
         } else {
-            _memoryCacheSize += diff;
+            _memoryCacheSize.fetch_add(newSize - oldSize, boost::memory_order_relaxed);
         }
 #ifdef NATRON_DEBUG_CACHE
-        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
 #endif
     }
 
@@ -1004,18 +1018,11 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        ///The entry has notified it's memory layout has changed, it must have been due to an action from the cache, hence the
-        ///lock should already be taken.
-        QMutexLocker k(&_sizeLock);
-
-        _memoryCacheSize += size;
+        _memoryCacheSize.fetch_add(size, boost::memory_order_relaxed);
         _signalEmitter->emitAddedEntry(time);
-
-        if (storage == eStorageModeDisk) {
-            appPTR->increaseNCacheFilesOpened();
-        }
+        Q_UNUSED(storage);
 #ifdef NATRON_DEBUG_CACHE
-        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+        qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
 #endif
     }
 
@@ -1026,17 +1033,15 @@ public:
                                       std::size_t size,
                                       StorageModeEnum storage) const OVERRIDE FINAL
     {
-        QMutexLocker k(&_sizeLock);
-
         if (storage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
+            subtractClamped(_memoryCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
 #endif
         } else if (storage == eStorageModeDisk) {
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            subtractClamped(_diskCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.load() );
 #endif
         }
 
@@ -1046,7 +1051,7 @@ public:
 
     virtual void notifyMemoryDeallocated() const OVERRIDE FINAL
     {
-        QMutexLocker k(&_sizeLock);
+        QMutexLocker k(&_memoryFullMutex);
 
         _memoryFullCondition.wakeAll();
     }
@@ -1063,42 +1068,43 @@ public:
         if (_tearingDown) {
             return;
         }
-        QMutexLocker k(&_sizeLock);
 
         assert(oldStorage != newStorage);
         assert(newStorage != eStorageModeNone);
         if (oldStorage == eStorageModeRAM) {
-            _memoryCacheSize = size > _memoryCacheSize ? 0 : _memoryCacheSize - size;
-            _diskCacheSize += size;
+            subtractClamped(_memoryCacheSize, size);
+            _diskCacheSize.fetch_add(size, boost::memory_order_relaxed);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.load() );
 #endif
-            ///We switched from RAM to DISK that means the MemoryFile object has been destroyed hence the file has been closed.
-            appPTR->decreaseNCacheFilesOpened();
         } else if (oldStorage == eStorageModeDisk) {
-            _memoryCacheSize += size;
-            _diskCacheSize = size > _diskCacheSize ? 0 : _diskCacheSize - size;
+            _memoryCacheSize.fetch_add(size, boost::memory_order_relaxed);
+            subtractClamped(_diskCacheSize, size);
 #ifdef NATRON_DEBUG_CACHE
-            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM(_memoryCacheSize);
-            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM(_diskCacheSize);
+            qDebug() << cacheName().c_str() << " memory size: " << printAsRAM( _memoryCacheSize.load() );
+            qDebug() << cacheName().c_str() << " disk size: " << printAsRAM( _diskCacheSize.load() );
 #endif
-            ///We switched from DISK to RAM that means the MemoryFile object has been created and the file opened
-            appPTR->increaseNCacheFilesOpened();
         } else {
             if (newStorage == eStorageModeRAM) {
-                _memoryCacheSize += size;
+                _memoryCacheSize.fetch_add(size, boost::memory_order_relaxed);
             } else if (newStorage == eStorageModeDisk) {
-                _diskCacheSize += size;
+                _diskCacheSize.fetch_add(size, boost::memory_order_relaxed);
             }
         }
 
         _signalEmitter->emitEntryStorageChanged(time, (int)oldStorage, (int)newStorage);
     }
 
-    virtual void backingFileClosed() const OVERRIDE FINAL
+    virtual CachePackFile* getPackFile() const OVERRIDE FINAL
     {
-        appPTR->decreaseNCacheFilesOpened();
+        QMutexLocker k(&_packFileMutex);
+
+        if (!_packFile) {
+            _packFile.reset( new CachePackFile( getCachePath().toStdString(), _maximumCacheSize.load() ) );
+        }
+
+        return _packFile.get();
     }
 
     // const data member: no need to take the lock
@@ -1139,42 +1145,58 @@ public:
         return newCachePath.toStdString();
     }
 
-    void setMaximumCacheSize(U64 newSize)
+    /**
+     * @brief Removes the segment files of the pack if no entry uses them anymore.
+     * To be called after clear() when the cache directory is about to be wiped.
+     **/
+    void removeUnusedPackFileSegments()
     {
-        QMutexLocker k(&_sizeLock);
+        ///Entries removed by clear() may still be in the queue of the deleter thread
+        {
+            QMutexLocker k(&_memoryFullMutex);
+            while ( _deleterThread.isWorking() ) {
+                _memoryFullCondition.wait(&_memoryFullMutex);
+            }
+        }
 
-        _maximumCacheSize = newSize;
+        QMutexLocker k(&_packFileMutex);
+        if ( _packFile && _packFile->isEmpty() ) {
+            _packFile->removeSegmentFiles();
+        }
     }
 
-    void setMaximumInMemorySize(double percentage)
+    void setMaximumCacheSize(U64 newSize)
     {
-        QMutexLocker k(&_sizeLock);
+        _maximumCacheSize.store( (std::size_t)newSize );
+        QMutexLocker k(&_packFileMutex);
+        if (_packFile) {
+            _packFile->setMaximumSize(newSize);
+        }
+    }
 
-        _maximumInMemorySize = _maximumCacheSize * percentage;
+    void setMaximumInMemorySize(double percentage)
+    {
+        _maximumInMemorySize.store( (std::size_t)(_maximumCacheSize.load() * percentage) );
     }
 
     std::size_t getMaximumSize() const
     {
-        QMutexLocker k(&_sizeLock);
-        return _maximumCacheSize;
+        return _maximumCacheSize.load();
     }
 
     std::size_t getMaximumMemorySize() const
     {
-        QMutexLocker k(&_sizeLock);
-        return _maximumInMemorySize;
+        return _maximumInMemorySize.load();
     }
 
     std::size_t getMemoryCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-        return _memoryCacheSize;
+        return _memoryCacheSize.load();
     }
 
     std::size_t getDiskCacheSize() const
     {
-        QMutexLocker k(&_sizeLock);
-        return _diskCacheSize;
+        return _diskCacheSize.load();
     }
 
     CacheSignalEmitter* activateSignalEmitter() const
@@ -1194,9 +1216,10 @@ public:
         std::list<EntryTypePtr> toRemove;
 
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( entry->getHashKey() );
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheBucket & bucket = getBucket( entry->getHashKey() );
+            QMutexLocker l(&bucket.lock);
+            CacheIterator existingEntry = bucket.memoryCache( entry->getHashKey() );
+            if ( existingEntry != bucket.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     if ( (*it)->getKey() == entry->getKey() ) {
@@ -1207,11 +1230,11 @@ public:
                     }
                 }
                 if ( ret.empty() ) {
-                    _memoryCache.erase(existingEntry);
+                    bucket.memoryCache.erase(existingEntry);
                 }
             } else {
-                existingEntry = _diskCache( entry->getHashKey() );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = bucket.diskCache( entry->getHashKey() );
+                if ( existingEntry != bucket.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         if ( (*it)->getKey() == entry->getKey() ) {
@@ -1222,11 +1245,11 @@ public:
                         }
                     }
                     if ( ret.empty() ) {
-                        _diskCache.erase(existingEntry);
+                        bucket.diskCache.erase(existingEntry);
                     }
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&bucket.lock);
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
 
@@ -1240,27 +1263,28 @@ public:
     {
         std::list<EntryTypePtr> toRemove;
         {
-            QMutexLocker l(&_lock);
-            CacheIterator existingEntry = _memoryCache( hash);
-            if ( existingEntry != _memoryCache.end() ) {
+            CacheBucket & bucket = getBucket(hash);
+            QMutexLocker l(&bucket.lock);
+            CacheIterator existingEntry = bucket.memoryCache(hash);
+            if ( existingEntry != bucket.memoryCache.end() ) {
                 std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                 for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                     //(*it)->scheduleForDestruction();
                     toRemove.push_back(*it);
                 }
-                _memoryCache.erase(existingEntry);
+                bucket.memoryCache.erase(existingEntry);
             } else {
-                existingEntry = _diskCache( hash );
-                if ( existingEntry != _diskCache.end() ) {
+                existingEntry = bucket.diskCache(hash);
+                if ( existingEntry != bucket.diskCache.end() ) {
                     std::list<EntryTypePtr> & ret = getValueFromIterator(existingEntry);
                     for (typename std::list<EntryTypePtr>::iterator it = ret.begin(); it != ret.end(); ++it) {
                         //(*it)->scheduleForDestruction();
                         toRemove.push_back(*it);
                     }
-                    _diskCache.erase(existingEntry);
+                    bucket.diskCache.erase(existingEntry);
                 }
             }
-        } // QMutexLocker l(&_lock);
+        } // QMutexLocker l(&bucket.lock);
 
         if ( !toRemove.empty() ) {
             _deleterThread.appendToQueue(toRemove);
@@ -1303,49 +1327,202 @@ public:
         
         std::string holderID = holder->getCacheID();
         
-        QMutexLocker locker(&_lock);
-        
-        for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                
-                const EntryTypePtr & front = entries.front();
-                
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *ramOccupied += (*it)->size();
+        for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+            QMutexLocker locker(&_buckets[i].lock);
+
+            for (CacheIterator memIt = _buckets[i].memoryCache.begin(); memIt != _buckets[i].memoryCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+
+                    const EntryTypePtr & front = entries.front();
+
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *ramOccupied += (*it)->size();
+                        }
                     }
                 }
             }
-        }
-        
-        for (CacheIterator memIt = _diskCache.begin(); memIt != _diskCache.end(); ++memIt) {
-            std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
-            if ( !entries.empty() ) {
-                
-                const EntryTypePtr & front = entries.front();
-                
-                if (front->getKey().getCacheHolderID() == holderID) {
-                    for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
-                        *diskOccupied += (*it)->size();
+
+            for (CacheIterator memIt = _buckets[i].diskCache.begin(); memIt != _buckets[i].diskCache.end(); ++memIt) {
+                std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
+                if ( !entries.empty() ) {
+
+                    const EntryTypePtr & front = entries.front();
+
+                    if (front->getKey().getCacheHolderID() == holderID) {
+                        for (typename std::list<EntryTypePtr>::iterator it = entries.begin(); it != entries.end(); ++it) {
+                            *diskOccupied += (*it)->size();
+                        }
                     }
                 }
             }
         }
     }
 
+    /**
+     * @brief Returns the index of the bucket holding the entries of the given hash.
+     **/
+    static int getBucketIndex(hash_type hash)
+    {
+        U64 h = (U64)hash;
+
+        return (int)( ( h ^ (h >> 32) ) & (NATRON_CACHE_BUCKETS_COUNT - 1) );
+    }
+
 private:
 
+    CacheBucket & getBucket(hash_type hash) const
+    {
+        return _buckets[getBucketIndex(hash)];
+    }
+
+    /**
+     * @brief Stamps the entry with the current access tick. The lock of the bucket holding the entry must be taken.
+     **/
+    void touchEntry(const EntryTypePtr & entry) const
+    {
+        entry->setLastAccessTick( _accessTick.fetchAndAddRelaxed(1) );
+    }
+
+    static void subtractClamped(boost::atomic<std::size_t> & value,
+                                std::size_t size)
+    {
+        std::size_t cur = value.load(boost::memory_order_relaxed);
+
+        while ( !value.compare_exchange_weak(cur, size > cur ? 0 : cur - size, boost::memory_order_relaxed) ) {
+        }
+    }
+
+    double getMemoryOccupation() const
+    {
+        std::size_t maximumCacheSize = _maximumCacheSize.load(boost::memory_order_relaxed);
+
+        return maximumCacheSize == 0 ? 0.99 : (double)_memoryCacheSize.load(boost::memory_order_relaxed) / maximumCacheSize;
+    }
+
+    /**
+     * @brief The buckets visited by a batch of evictions, in approximate global LRU order. The order is computed once
+     * for the batch, and several entries are evicted from each bucket before the next one is visited, so that a
+     * batch does not take the locks of all the buckets for each entry it evicts.
+     **/
+    struct EvictionOrder
+    {
+        std::vector<int> buckets;
+        std::size_t next; // index in buckets of the bucket being evicted from
+        int evictedFromNext; // entries already evicted from that bucket
+        bool evictedSinceSorted;
+        bool sorted;
+
+        EvictionOrder()
+            : buckets()
+            , next(0)
+            , evictedFromNext(0)
+            , evictedSinceSorted(false)
+            , sorted(false)
+        {
+        }
+    };
+
+    /**
+     * @brief Returns the bucket the next entry of the batch should be evicted from, or -1 if no bucket has
+     * anything left to evict. The order is sorted again once all its buckets were visited.
+     **/
+    int getNextBucketToEvict(bool disk,
+                             EvictionOrder* order) const
+    {
+        for (;;) {
+            if (!order->sorted) {
+                getBucketsSortedByLRU(disk, &order->buckets);
+                order->next = 0;
+                order->evictedFromNext = 0;
+                order->evictedSinceSorted = false;
+                order->sorted = true;
+            }
+            if ( order->next < order->buckets.size() ) {
+                return order->buckets[order->next];
+            }
+            if (!order->evictedSinceSorted) {
+                return -1;
+            }
+            order->sorted = false;
+        }
+    }
+
+    /**
+     * @brief Moves the batch to the next bucket once enough entries were evicted from the current one, or right away
+     * if it had nothing left to evict.
+     **/
+    static void onBucketEvicted(bool didEvict,
+                                EvictionOrder* order)
+    {
+        if (didEvict) {
+            order->evictedSinceSorted = true;
+            if (++order->evictedFromNext < NATRON_CACHE_EVICTIONS_PER_BUCKET) {
+                return;
+            }
+        }
+        ++order->next;
+        order->evictedFromNext = 0;
+    }
+
+    /**
+     * @brief Returns in bucketsOrder the indexes of the non-empty buckets of the memory portion (or disk portion if
+     * disk is true), the bucket whose least recently used entry is the oldest coming first.
+     * This approximates a global LRU order across buckets while never holding more than one bucket lock.
+     **/
+    void getBucketsSortedByLRU(bool disk,
+                               std::vector<int>* bucketsOrder) const
+    {
+        std::vector<std::pair<unsigned int, int> > ages;
+        unsigned int now = (unsigned int)_accessTick.fetchAndAddRelaxed(0);
+
+        ages.reserve(NATRON_CACHE_BUCKETS_COUNT);
+        for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+            QMutexLocker k(&_buckets[i].lock);
+            EntryTypePtr lru = disk ? _buckets[i].diskCache.peekLRU() : _buckets[i].memoryCache.peekLRU();
+            if (lru) {
+                // Unsigned arithmetic so that the tick wrapping around is harmless
+                ages.push_back( std::make_pair(now - (unsigned int)lru->getLastAccessTick(), i) );
+            }
+        }
+        std::sort( ages.begin(), ages.end() );
+        bucketsOrder->clear();
+        for (std::vector<std::pair<unsigned int, int> >::reverse_iterator it = ages.rbegin(); it != ages.rend(); ++it) {
+            bucketsOrder->push_back(it->second);
+        }
+    }
+
+    /**
+     * @brief Evicts memory entries until the in-memory portion fits in its maximum size again.
+     * No bucket lock must be taken when calling this.
+     **/
+    void evictExceedingMemoryEntries() const
+    {
+        std::list<EntryTypePtr> entriesToBeDeleted;
+        EvictionOrder order;
+
+        //now clear extra entries from the disk cache so it doesn't exceed the RAM limit.
+        while ( _memoryCacheSize.load(boost::memory_order_relaxed) > _maximumInMemorySize.load(boost::memory_order_relaxed) ) {
+            if ( !tryEvictEntry(entriesToBeDeleted, &order) ) {
+                break;
+            }
+        }
+        _deleterThread.appendToQueue(entriesToBeDeleted);
+    }
+
     virtual void removeAllEntriesWithDifferentNodeHashForHolderPrivate(const std::string & holderID,
                                                                        U64 nodeHash,
                                                                        bool removeAll) OVERRIDE FINAL
     {
         std::list<EntryTypePtr> toDelete;
-        CacheContainer newMemCache, newDiskCache;
-        {
-            QMutexLocker locker(&_lock);
 
-            for (CacheIterator memIt = _memoryCache.begin(); memIt != _memoryCache.end(); ++memIt) {
+        for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+            CacheBucket & bucket = _buckets[i];
+            CacheContainer newMemCache, newDiskCache;
+            QMutexLocker locker(&bucket.lock);
+
+            for (CacheIterator memIt = bucket.memoryCache.begin(); memIt != bucket.memoryCache.end(); ++memIt) {
                 std::list<EntryTypePtr> & entries = getValueFromIterator(memIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
@@ -1363,7 +1540,7 @@ private:
                 }
             }
 
-            for (CacheIterator dIt = _diskCache.begin(); dIt != _diskCache.end(); ++dIt) {
+            for (CacheIterator dIt = bucket.diskCache.begin(); dIt != bucket.diskCache.end(); ++dIt) {
                 std::list<EntryTypePtr> & entries = getValueFromIterator(dIt);
                 if ( !entries.empty() ) {
                     const EntryTypePtr & front = entries.front();
@@ -1381,9 +1558,9 @@ private:
                 }
             }
 
-            _memoryCache = newMemCache;
-            _diskCache = newDiskCache;
-        } // QMutexLocker locker(&_lock);
+            bucket.memoryCache = newMemCache;
+            bucket.diskCache = newDiskCache;
+        }
 
         if ( !toDelete.empty() ) {
             _deleterThread.appendToQueue(toDelete);
@@ -1394,21 +1571,30 @@ private:
         }
     } // removeAllEntriesWithDifferentNodeHashForHolderPrivate
 
-    bool getInternal(const typename EntryType::key_type & key,
-                     std::list<EntryTypePtr>* returnValue) const
+    /**
+     * @brief Looks-up the given bucket for entries matching the key. The bucket lock must be taken.
+     * @param [out] reopenedFromDisk Set to true if the entry was moved back from the disk portion to the
+     * memory portion, in which case the caller should call evictExceedingMemoryEntries() once the bucket
+     * lock is released.
+     **/
+    bool getInternal(CacheBucket & bucket,
+                     const typename EntryType::key_type & key,
+                     std::list<EntryTypePtr>* returnValue,
+                     bool* reopenedFromDisk) const
     {
         ///Private should be locked
-        assert( !_lock.tryLock() );
+        assert( !bucket.lock.tryLock() );
 
         ///find a matching value in the internal memory container
-        CacheIterator memoryCached = _memoryCache( key.getHash() );
+        CacheIterator memoryCached = bucket.memoryCache( key.getHash() );
 
-        if ( memoryCached != _memoryCache.end() ) {
+        if ( memoryCached != bucket.memoryCache.end() ) {
             ///we found something with a matching hash key. There may be several entries linked to
             ///this key, we need to find one with matching params
             std::list<EntryTypePtr> & ret = getValueFromIterator(memoryCached);
             for (typename std::list<EntryTypePtr>::const_iterator it = ret.begin(); it != ret.end(); ++it) {
                 if ( (*it)->getKey() == key ) {
+                    touchEntry(*it);
                     returnValue->push_back(*it);
 
                     ///Q_EMIT te added signal otherwise when first reading something that's already cached
@@ -1422,9 +1608,9 @@ private:
             return returnValue->size() > 0;
         } else {
             ///fallback on the disk cache internal container
-            CacheIterator diskCached = _diskCache( key.getHash() );
+            CacheIterator diskCached = bucket.diskCache( key.getHash() );
 
-            if ( diskCached == _diskCache.end() ) {
+            if ( diskCached == bucket.diskCache.end() ) {
                 /*the entry was neither in memory or disk, just allocate a new one*/
                 return false;
             } else {
@@ -1454,29 +1640,11 @@ private:
                         }
 
                         //put it back into the RAM
-                        _memoryCache.insert( (*it)->getHashKey(), *it );
-                        
+                        touchEntry(*it);
+                        bucket.memoryCache.insert( (*it)->getHashKey(), *it );
 
-                        U64 memoryCacheSize, maximumInMemorySize;
-                        {
-                            QMutexLocker k(&_sizeLock);
-                            memoryCacheSize = _memoryCacheSize;
-                            maximumInMemorySize = _maximumInMemorySize;
-                        }
-                        std::list<EntryTypePtr> entriesToBeDeleted;
-
-                        //now clear extra entries from the disk cache so it doesn't exceed the RAM limit.
-                        while (memoryCacheSize > maximumInMemorySize) {
-                            if ( !tryEvictEntry(entriesToBeDeleted) ) {
-                                break;
-                            }
-
-                            {
-                                QMutexLocker k(&_sizeLock);
-                                memoryCacheSize = _memoryCacheSize;
-                                maximumInMemorySize = _maximumInMemorySize;
-                            }
-                        }
+                        ///The caller will clear extra entries so the memory portion doesn't exceed the RAM limit
+                        *reopenedFromDisk = true;
 
                         returnValue->push_back(*it);
                         ret.erase(it);
@@ -1487,7 +1655,7 @@ private:
                         }
                         
                         ///Remove it from the disk cache
-                        _diskCache.erase(diskCached);
+                        bucket.diskCache.erase(diskCached);
                         
                         return true;
                     }
@@ -1501,27 +1669,31 @@ private:
     } // getInternal
 
     /** @brief Inserts into the cache an entry that was previously allocated by the createInternal()
-     * function. This is called directly by createInternal() if the allocation was successful
+     * function. This is called directly by createInternal() if the allocation was successful.
+     * The lock of the bucket corresponding to the entry hash must be taken.
      **/
     void sealEntry(const EntryTypePtr & entry,
                    bool inMemory) const
     {
-        assert( !_lock.tryLock() );   // must be locked
         typename EntryType::hash_type hash = entry->getHashKey();
+        CacheBucket & bucket = getBucket(hash);
+
+        assert( !bucket.lock.tryLock() );   // must be locked
+        touchEntry(entry);
 
         if (inMemory) {
             /*if the entry doesn't exist on the memory cache,make a new list and insert it*/
-            CacheIterator existingEntry = _memoryCache(hash);
-            if ( existingEntry == _memoryCache.end() ) {
-                _memoryCache.insert(hash, entry);
+            CacheIterator existingEntry = bucket.memoryCache(hash);
+            if ( existingEntry == bucket.memoryCache.end() ) {
+                bucket.memoryCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
             }
         } else {
-            CacheIterator existingEntry = _diskCache(hash);
-            if ( existingEntry == _diskCache.end() ) {
-                _diskCache.insert(hash, entry);
+            CacheIterator existingEntry = bucket.diskCache(hash);
+            if ( existingEntry == bucket.diskCache.end() ) {
+                bucket.diskCache.insert(hash, entry);
             } else {
                 /*append to the existing list*/
                 getValueFromIterator(existingEntry).push_back(entry);
@@ -1529,66 +1701,100 @@ private:
         }
     }
 
-    bool tryEvictEntry(std::list<EntryTypePtr> & entriesToBeDeleted) const
+    /**
+     * @brief Evicts the least recently used entry of the disk portion, looking at the buckets in approximate
+     * global LRU order. The order is shared by the evictions of a batch.
+     * No bucket lock must be taken when calling this.
+     **/
+    bool tryEvictDiskEntry(EntryTypePtr* evicted,
+                           EvictionOrder* order) const
     {
-        assert( !_lock.tryLock() );
-        std::pair<hash_type, EntryTypePtr> evicted = _memoryCache.evict();
-        //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-        //we'll let the user of these entries purge the extra entries left in the cache later on
-        if (!evicted.second) {
-            return false;
+        for (;;) {
+            int bucketIndex = getNextBucketToEvict(true, order);
+            if (bucketIndex == -1) {
+                return false;
+            }
+            CacheBucket & bucket = _buckets[bucketIndex];
+            QMutexLocker k(&bucket.lock);
+            std::pair<hash_type, EntryTypePtr> evictedFromDisk = bucket.diskCache.evict();
+            onBucketEvicted( (bool)evictedFromDisk.second, order );
+            if (evictedFromDisk.second) {
+                *evicted = evictedFromDisk.second;
+
+                return true;
+            }
         }
-        /*if it is stored on disk, remove it from memory*/
+    }
 
-        if ( evicted.second->isStoredOnDisk() ) {
-            assert( evicted.second.unique() );
+    /**
+     * @brief Evicts the least recently used entry of the in-memory portion, looking at the buckets in approximate
+     * global LRU order. The order is shared by the evictions of a batch.
+     * No bucket lock must be taken when calling this.
+     **/
+    bool tryEvictEntry(std::list<EntryTypePtr> & entriesToBeDeleted,
+                       EvictionOrder* order) const
+    {
+        bool movedToDisk = false;
+        bool didEvict = false;
+        while (!didEvict) {
+            int bucketIndex = getNextBucketToEvict(false, order);
+            if (bucketIndex == -1) {
+                break;
+            }
+            CacheBucket & bucket = _buckets[bucketIndex];
+            QMutexLocker k(&bucket.lock);
+            std::pair<hash_type, EntryTypePtr> evicted = bucket.memoryCache.evict();
+            onBucketEvicted( (bool)evicted.second, order );
+            //if the bucket couldn't evict that means all its entries are used somewhere and we shall not remove them!
+            //we'll let the user of these entries purge the extra entries left in the cache later on
+            if (!evicted.second) {
+                continue;
+            }
+            didEvict = true;
 
-            ///This is EXPENSIVE! it calls msync
-            evicted.second->deallocate();
+            /*if it is stored on disk, remove it from memory*/
+            if ( evicted.second->isStoredOnDisk() ) {
+                assert( evicted.second.unique() );
 
-            /*insert it back into the disk portion */
+                ///This is EXPENSIVE! it calls msync
+                evicted.second->deallocate();
 
-            U64 diskCacheSize, maximumCacheSize, maximumInMemorySize;
-            {
-                QMutexLocker k(&_sizeLock);
-                diskCacheSize = _diskCacheSize;
-                maximumInMemorySize = _maximumInMemorySize;
-                maximumCacheSize = _maximumCacheSize;
+                /*insert it back into the disk portion of the same bucket */
+                CacheIterator existingDiskCacheEntry = bucket.diskCache(evicted.first);
+                /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
+                if ( existingDiskCacheEntry == bucket.diskCache.end() ) {
+                    bucket.diskCache.insert(evicted.first, evicted.second);
+                } else {   /*append to the existing list*/
+                    getValueFromIterator(existingDiskCacheEntry).push_back(evicted.second);
+                }
+                movedToDisk = true;
+            } else {
+                entriesToBeDeleted.push_back(evicted.second);
             }
+        }
 
-            /*before that we need to clear the disk cache if it exceeds the maximum size allowed*/
-            while ( ( diskCacheSize  + evicted.second->size() ) >= (maximumCacheSize - maximumInMemorySize) ) {
-                {
-                    std::pair<hash_type, EntryTypePtr> evictedFromDisk = _diskCache.evict();
-                    //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
-                    //we'll let the user of these entries purge the extra entries left in the cache later on
-                    if (!evictedFromDisk.second) {
-                        break;
-                    }
-
-                    ///Erase the file from the disk if we reach the limit.
-                    //evictedFromDisk.second->scheduleForDestruction();
-
+        if (!didEvict) {
+            return false;
+        }
 
-                    entriesToBeDeleted.push_back(evictedFromDisk.second);
-                }
-                {
-                    QMutexLocker k(&_sizeLock);
-                    diskCacheSize = _diskCacheSize;
-                    maximumInMemorySize = _maximumInMemorySize;
-                    maximumCacheSize = _maximumCacheSize;
+        if (movedToDisk) {
+            /*we need to clear the disk cache if it exceeds the maximum size allowed*/
+            EvictionOrder diskOrder;
+            for (;;) {
+                std::size_t maximumCacheSize = _maximumCacheSize.load(boost::memory_order_relaxed);
+                std::size_t maximumInMemorySize = _maximumInMemorySize.load(boost::memory_order_relaxed);
+                if ( _diskCacheSize.load(boost::memory_order_relaxed) < (maximumCacheSize - maximumInMemorySize) ) {
+                    break;
                 }
-            }
 
-            CacheIterator existingDiskCacheEntry = _diskCache(evicted.first);
-            /*if the entry doesn't exist on the disk cache,make a new list and insert it*/
-            if ( existingDiskCacheEntry == _diskCache.end() ) {
-                _diskCache.insert(evicted.first, evicted.second);
-            } else {   /*append to the existing list*/
-                getValueFromIterator(existingDiskCacheEntry).push_back(evicted.second);
+                EntryTypePtr evictedFromDisk;
+                //if the cache couldn't evict that means all entries are used somewhere and we shall not remove them!
+                //we'll let the user of these entries purge the extra entries left in the cache later on
+                if ( !tryEvictDiskEntry(&evictedFromDisk, &diskOrder) ) {
+                    break;
+                }
+                entriesToBeDeleted.push_back(evictedFromDisk);
             }
-        } else {
-            entriesToBeDeleted.push_back(evicted.second);
         }
 
         return true;
@@ -29,6 +29,8 @@
 
 #include <iostream>
 #include <cassert>
+#include <cstring> // for memcpy
+#include <algorithm>
 #include <cstdio> // for std::remove
 #include <stdexcept>
 #include <vector>
@@ -50,7 +52,7 @@
 #endif
 #include "Engine/Hash64.h"
 #include "Engine/CacheEntryHolder.h"
-#include "Engine/MemoryFile.h"
+#include "Engine/CachePackFile.h"
 #include "Engine/NonKeyParams.h"
 #include <SequenceParsing.h> // for removePath
 #include "Engine/EngineFwd.h"
@@ -134,7 +136,8 @@ public:
 };
 
 /** @brief Buffer represents  an internal buffer that can be allocated on different devices.
- * For now the class is simple and can only be either on disk using mmap or in RAM using malloc.
+ * For now the class is simple and can only be either on disk in a block of the cache pack file (@see CachePackFile)
+ * or in RAM using malloc.
  * The cost parameter given to the allocate() function is a hint that the Buffer classes uses
  * to select a device to use. By default -1 means it should not allocate any memory,
  * 0 means RAM and >= 1 means the data will be stored on disk using mmap. We could see this
@@ -154,9 +157,11 @@ public:
 
 
     Buffer()
-    : _path()
-    , _buffer()
-    , _backingFile()
+    : _buffer()
+    , _pack(0)
+    , _block()
+    , _mapped(0)
+    , _diskSize(0)
     , _storageMode(eStorageModeRAM)
     {
     }
@@ -168,36 +173,34 @@ public:
 
     void allocate( U64 count,
                    StorageModeEnum storage,
-                   std::string path = std::string() )
+                   CachePackFile* pack = 0 )
     {
         /*allocate should be called only once.*/
-        assert( _path.empty() );
-        assert( ( (_buffer.size() == 0) && !_backingFile ) || ( (_buffer.size() != 0) && !_backingFile ) || (!(_buffer.size() != 0) && _backingFile) );
-        if ( (_buffer.size() > 0) || _backingFile ) {
+        assert( !_block.isValid() );
+        if ( (_buffer.size() > 0) || _block.isValid() ) {
             return;
         }
 
 
         if (storage == eStorageModeDisk) {
-            _storageMode = eStorageModeDisk;
-            _path = path;
-            try {
-                _backingFile.reset( new MemoryFile(_path,MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate) );
-            } catch (const std::runtime_error & r) {
-                std::cout << r.what() << std::endl;
-
-                ///if opening the file mapping failed, just call allocate again, but this time on RA%!
-                _backingFile.reset();
-                _path.clear();
-                allocate(count,eStorageModeRAM, path);
+            U64 bytes = count * sizeof(DataType);
+            CachePackBlock block;
+            if ( pack && (bytes > 0) && pack->allocate(bytes, &block) ) {
+                char* ptr = pack->data(block);
+                if (ptr) {
+                    _storageMode = eStorageModeDisk;
+                    _pack = pack;
+                    _block = block;
+                    _mapped = ptr;
+                    _diskSize = bytes;
 
-                return;
+                    return;
+                }
+                pack->free(block);
             }
 
-            if ( !path.empty() && (count != 0) ) {
-                //if the backing file has already the good size and we just wanted to re-open the mapping
-                _backingFile->resize(count);
-            }
+            ///if the pack is full or its segment could not be mapped, just call allocate again, but this time on RAM!
+            allocate(count, eStorageModeRAM);
         } else if (storage == eStorageModeRAM) {
             _storageMode = eStorageModeRAM;
             _buffer.resize(count);
@@ -216,8 +219,26 @@ public:
             assert(_buffer.size() > 0); // could be 0 if we allocate 0...
             _buffer.resize(count);
         } else if (_storageMode == eStorageModeDisk) {
-            assert(_backingFile);
-            _backingFile->resize( count * sizeof(DataType) );
+            assert(_pack && _block.isValid() && _mapped);
+            U64 bytes = count * sizeof(DataType);
+            if (bytes <= _block.capacity) {
+                _diskSize = bytes;
+                return;
+            }
+            CachePackBlock block;
+            if ( !_pack->allocate(bytes, &block) ) {
+                throw std::bad_alloc();
+            }
+            char* ptr = _pack->data(block);
+            if (!ptr) {
+                _pack->free(block);
+                throw std::bad_alloc();
+            }
+            memcpy(ptr, _mapped, std::min(_diskSize, bytes));
+            _pack->free(_block);
+            _block = block;
+            _mapped = ptr;
+            _diskSize = bytes;
         }
     }
     
@@ -230,45 +251,42 @@ public:
             if (other._storageMode == eStorageModeRAM) {
                 _buffer.swap(other._buffer);
             } else {
-                _buffer.resize(other._backingFile->size() / sizeof(DataType));
-                const char* src = other._backingFile->data();
+                _buffer.resize(other._diskSize / sizeof(DataType));
+                const char* src = other._mapped;
                 char* dst = (char*)_buffer.getData();
-                memcpy(dst,src,other._backingFile->size());
+                memcpy(dst,src,other._diskSize);
             }
         } else if (_storageMode == eStorageModeDisk) {
-            if (other._storageMode == eStorageModeDisk) {
-                assert(_backingFile);
-                _backingFile.swap(other._backingFile);
-                _path = other._path;
-            } else {
-                _backingFile->resize(other._buffer.size() * sizeof(DataType));
-				assert(_backingFile->data());
-                const char* src = (const char*)other._buffer.getData();
-                char* dst = (char*)_backingFile->data();
-                memcpy(dst,src,other._buffer.size() * sizeof(DataType));
-            }
+            std::size_t otherSize = other.size();
+            reallocate(otherSize / sizeof(DataType));
+            assert(_mapped);
+            const char* src = (const char*)other.readable();
+            memcpy(_mapped,src,otherSize);
         }
         
     }
     
-    const std::string& getFilePath() const {
-        return _path;
+    const CachePackBlock& getPackBlock() const
+    {
+        return _block;
     }
 
     void reOpenFileMapping() const
     {
-        assert(!_backingFile && _storageMode == eStorageModeDisk);
-        try{
-            _backingFile.reset( new MemoryFile(_path,MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate) );
-        } catch (const std::exception & e) {
-            _backingFile.reset();
+        assert(!_mapped && _storageMode == eStorageModeDisk && _pack);
+        _mapped = _pack->data(_block);
+        if (!_mapped) {
             throw std::bad_alloc();
         }
     }
 
-    void restoreBufferFromFile(const std::string & path)
+    void restoreBufferFromPackFile(CachePackFile* pack,
+                                   const CachePackBlock & block,
+                                   U64 size)
     {
-        _path = path;
+        _pack = pack;
+        _block = block;
+        _diskSize = size;
         _storageMode = eStorageModeDisk;
     }
 
@@ -277,30 +295,25 @@ public:
         if (_storageMode == eStorageModeRAM) {
             _buffer.clear();
         } else {
-            if (_backingFile) {
-                bool flushOk = _backingFile->flush();
-                _backingFile.reset();
-                if (!flushOk) {
-                    throw std::runtime_error("Failed to flush RAM data to backing file.");
+            if (_mapped) {
+                _mapped = 0;
+                if ( !_pack->flush(_block, _diskSize) ) {
+                    throw std::runtime_error("Failed to flush RAM data to the cache pack file.");
                 }
             }
         }
     }
 
-    bool removeAnyBackingFile() const
+    /**
+     * @brief Gives back the block to the pack file, the data is lost.
+     **/
+    void removeAnyBackingFile() const
     {
-        if (_storageMode == eStorageModeDisk) {
-            if (_backingFile) {
-                _backingFile->remove();
-                _backingFile.reset();
-                return true;
-            } else {
-                int ret_code = std::remove( _path.c_str() );
-                Q_UNUSED(ret_code);
-                return false;
-            }
+        if ( (_storageMode == eStorageModeDisk) && _block.isValid() ) {
+            _pack->free(_block);
+            _block = CachePackBlock();
+            _mapped = 0;
         }
-        return false;
     }
 
     /**
@@ -311,23 +324,19 @@ public:
         if (_storageMode == eStorageModeRAM) {
             return _buffer.size() * sizeof(DataType);
         } else {
-            return _backingFile ? _backingFile->size() : 0;
+            return _mapped ? _diskSize : 0;
         }
     }
 
     bool isAllocated() const
     {
-        return (_buffer.size() > 0) || ( _backingFile && _backingFile->data() );
+        return (_buffer.size() > 0) || _mapped;
     }
 
     DataType* writable()
     {
         if (_storageMode == eStorageModeDisk) {
-            if (_backingFile) {
-                return (DataType*)_backingFile->data();
-            } else {
-                return NULL;
-            }
+            return (DataType*)_mapped;
         } else {
             return _buffer.getData();
         }
@@ -336,7 +345,7 @@ public:
     const DataType* readable() const
     {
         if (_storageMode == eStorageModeDisk) {
-            return _backingFile ? (const DataType*)_backingFile->data() : 0;
+            return (const DataType*)_mapped;
         } else {
             return _buffer.getData();
         }
@@ -349,12 +358,16 @@ public:
 
 private:
 
-    std::string _path;
     RamBuffer<DataType> _buffer;
 
-    /*mutable so the reOpenFileMapping function can reopen the mmaped file. It doesn't
-       change the underlying data*/
-    mutable boost::scoped_ptr<MemoryFile> _backingFile;
+    ///The pack owning the block, it outlives all entries of its cache
+    CachePackFile* _pack;
+
+    /*mutable so removeAnyBackingFile() can give back the block and reOpenFileMapping() can
+       map it again. It doesn't change the underlying data*/
+    mutable CachePackBlock _block;
+    mutable char* _mapped;
+    U64 _diskSize;
     StorageModeEnum _storageMode;
 };
 
@@ -390,9 +403,9 @@ public:
     virtual void notifyMemoryDeallocated() const = 0;
 
     /**
-     * @brief To be called when a backing file has been closed
+     * @brief Returns the pack file in which disk entries of this cache are allocated.
      **/
-    virtual void backingFileClosed() const = 0;
+    virtual CachePackFile* getPackFile() const = 0;
 
     /**
      * @brief To be called whenever an entry is deallocated from memory and put back on disk or whenever
@@ -408,57 +421,6 @@ public:
     virtual void removeAllEntriesWithDifferentNodeHashForHolderPrivate(const std::string& holderID, U64 nodeHash, bool removeAll) = 0;
     
     
-#ifdef DEBUG
-    static bool checkFileNameMatchesHash(const std::string &originalFileName,U64 hash)
-    {
-        
-        std::string filename = originalFileName;
-        std::string path = SequenceParsing::removePath(filename);
-        //remove extension from filename
-        {
-            size_t lastdot = filename.find_last_of('.');
-            if (lastdot != std::string::npos) {
-                filename.erase(lastdot, std::string::npos);
-            }
-        }
-        
-        //remove index if it has one
-        {
-            std::size_t foundSep = filename.find_last_of('_');
-            if (foundSep != std::string::npos) {
-                filename.erase(foundSep, std::string::npos);
-            }
-        }
-        
-        QString hashKeyStr(filename.c_str());
-        
-        //prepend the 2 digits of the containing directory
-        {
-            if (path.size() > 0) {
-                if (path[path.size() - 1] == '\\' || path[path.size() -1] == '/') {
-                    path.erase(path.size() - 1, 1);
-                }
-                
-                std::size_t foundSep = path.find_last_of('/');
-                if (foundSep == std::string::npos) {
-                    foundSep = path.find_last_of('\\');
-                }
-                assert(foundSep != std::string::npos);
-                std::string enclosingDirName = path.substr(foundSep + 1, std::string::npos);
-                hashKeyStr.prepend(enclosingDirName.c_str());
-            }
-        }
-        
-        
-        U64 hashKey = hashKeyStr.toULongLong(0,16); //< to hex (base 16)
-        if (hashKey == hash) {
-            return true;
-        } else {
-            return false;
-        }
-        
-    }
-#endif
     
 };
 
@@ -515,10 +477,10 @@ public:
     , _params()
     , _data()
     , _cache()
-    , _requestedPath()
     , _entryLock(QReadWriteLock::Recursive)
     , _requestedStorage(eStorageModeNone)
     , _removeBackingFileBeforeDestruction(false)
+    , _lastAccessTick(0)
     {
     }
 
@@ -531,16 +493,15 @@ public:
     CacheEntryHelper(const KeyType & key,
                      const boost::shared_ptr<ParamsType> & params,
                      const CacheAPI* cache,
-                     StorageModeEnum storage,
-                     const std::string & path)
+                     StorageModeEnum storage)
     : _key(key)
     , _params(params)
     , _data()
     , _cache(cache)
-    , _requestedPath(path)
     , _entryLock(QReadWriteLock::Recursive)
     , _requestedStorage(storage)
     , _removeBackingFileBeforeDestruction(false)
+    , _lastAccessTick(0)
     {
     }
 
@@ -560,14 +521,12 @@ public:
     void setCacheEntry(const KeyType & key,
                        const boost::shared_ptr<ParamsType> & params,
                        const CacheAPI* cache,
-                       StorageModeEnum storage,
-                       const std::string & path)
+                       StorageModeEnum storage)
     {
         assert(!_params && _cache == NULL);
         _key = key;
         _params = params;
         _cache = cache;
-        _requestedPath = path;
         _requestedStorage = storage;
     }
 
@@ -591,7 +550,7 @@ public:
                 }
             }
             QWriteLocker k(&_entryLock);
-            allocate(_params->getElementsCount(),_requestedStorage,_requestedPath);
+            allocate(_params->getElementsCount(),_requestedStorage);
             onMemoryAllocated(false);
         }
         
@@ -601,21 +560,24 @@ public:
     }
     
     /**
-     * @brief To be called for disk-cached entries when restoring them from a file.
-     * The file-path will be the one passed to the constructor
+     * @brief To be called for disk-cached entries when restoring them from the cache index.
+     * The block is the one that was returned by getPackBlock() when the index was saved.
      **/
-    void restoreMetaDataFromFile(std::size_t size)
+    void restoreMetaDataFromPackFile(const CachePackBlock & block, std::size_t size)
     {
         if (!_cache || _requestedStorage != eStorageModeDisk) {
             return;
         }
         
-        assert(!_requestedPath.empty());
+        CachePackFile* pack = _cache->getPackFile();
+        if ( !pack || !block.isValid() ) {
+            throw std::runtime_error("Cache restore, invalid pack file block");
+        }
         
         {
             QWriteLocker k(&_entryLock);
             
-            restoreBufferFromFile(_requestedPath);
+            _data.restoreBufferFromPackFile(pack, block, size);
             
             onMemoryAllocated(true);
 
@@ -628,7 +590,7 @@ public:
 
     /**
      * @brief Called right away once the buffer is allocated. Used in debug mode to initialize image with a default color.
-     * @param diskRestoration If true, this is called by restoreMetaDataFromFile() and the memory is in fact not allocated, this should
+     * @param diskRestoration If true, this is called by restoreMetaDataFromPackFile() and the memory is in fact not allocated, this should
      * just restore meta-data
      **/
     virtual void onMemoryAllocated(bool /*diskRestoration*/)
@@ -641,8 +603,9 @@ public:
         return _key;
     }
     
-    const std::string& getFilePath() const {
-        return _data.getFilePath();
+    const CachePackBlock& getPackBlock() const
+    {
+        return _data.getPackBlock();
     }
 
     typename AbstractCacheEntry<KeyType>::hash_type getHashKey() const OVERRIDE FINAL
@@ -650,37 +613,6 @@ public:
         return _key.getHash();
     }
 
-    std::string generateStringFromHash(const std::string & path,U64 hashKey) const
-    {
-        std::string name(path);
-
-        if ( path.empty() ) {
-            QDir subfolder( path.c_str() );
-            if ( !subfolder.exists() ) {
-                std::cout << "(" << std::hex <<
-                    this << ") " <<   "Something is wrong in cache... couldn't find : " << path << std::endl;
-                throw std::invalid_argument(path);
-            }
-        }
-        QString hashKeyStr = QString::number(hashKey,16); //< hex is base 16
-        for (int i = 0; i < 2; ++i) {
-            if (i >= hashKeyStr.size()) {
-                break;
-            }
-            name.push_back(hashKeyStr[i].toLatin1());
-        }
-        name.append("/");
-        int i = 2;
-        while (i < hashKeyStr.size()) {
-            name.push_back(hashKeyStr[i].toLatin1());
-            ++i;
-        }
-        
-        name.append("." NATRON_CACHE_FILE_EXT);
-
-        return name;
-    }
-
     /** @brief This function is called by the get() function of the Cache when the entry is
      * living only in the disk portion of the cache. No locking is required here because the
      * caller is already preventing other threads to call this function.
@@ -768,15 +700,11 @@ public:
         }
         
         bool isAlloc = _data.isAllocated();
-        bool hasRemovedFile;
         {
             QWriteLocker k(&_entryLock);
-            hasRemovedFile = _data.removeAnyBackingFile();
+            _data.removeAnyBackingFile();
         }
         
-        if (hasRemovedFile) {
-            _cache->backingFileClosed();
-        }
         if ( isAlloc ) {
             _cache->notifyEntryDestroyed(getTime(), _params->getElementsCount() * sizeof(DataType),eStorageModeRAM);
         } else {
@@ -803,6 +731,20 @@ public:
         return _params;
     }
 
+    /**
+     * @brief Used by the Cache to approximate a global LRU order across its buckets.
+     * Only accessed while the lock of the cache bucket holding this entry is taken.
+     **/
+    void setLastAccessTick(int tick) const
+    {
+        _lastAccessTick = tick;
+    }
+
+    int getLastAccessTick() const
+    {
+        return _lastAccessTick;
+    }
+
 protected:
 
 
@@ -827,80 +769,15 @@ protected:
 
 private:
 
-    static bool fileExists(const std::string& filename)
-    {
-#ifdef _WIN32
-        WIN32_FIND_DATAW FindFileData;
-        std::wstring wpath = utf8ToUtf16 (filename);
-        HANDLE handle = FindFirstFileW(wpath.c_str(), &FindFileData) ;
-        if (handle != INVALID_HANDLE_VALUE) {
-            FindClose(handle);
-            return true;
-        }
-        return false;
-#else
-        // on Unix platforms passing in UTF-8 works
-        std::ifstream fs(filename.c_str());
-        return fs.is_open() && fs.good();
-#endif
-    }
-
     /** @brief This function is called in allocateMeory(...) and before the object is exposed
      * to other threads. Hence this function doesn't need locking mechanism at all.
      * We must ensure that this function is called ONLY by allocateMemory(), that's why
      * it is private.
      **/
     void allocate( U64 count,
-                   StorageModeEnum storage,
-                   std::string path = std::string() )
-    {
-        std::string fileName;
-        
-        if (storage == eStorageModeDisk) {
-            
-            typename AbstractCacheEntry<KeyType>::hash_type hashKey = getHashKey();
-            try {
-                fileName = generateStringFromHash(path,hashKey);
-            } catch (const std::invalid_argument & e) {
-                std::cout << "Path is empty but required for disk caching: " << e.what() << std::endl;
-                return;
-            }
-            
-            assert(!fileName.empty());
-            //Check if the filename already exists, if so append a 0-based index after the hash (separated by a '_')
-            //and try again
-            int index = 0;
-            if (fileExists(fileName)) {
-                fileName.insert(fileName.size() - 4,"_0");
-            }
-            while (fileExists(fileName)) {
-                ++index;
-                std::stringstream ss;
-                ss << index;
-                fileName.replace(fileName.size() - 1,std::string::npos,ss.str());
-            }
-#ifdef DEBUG
-            if (!CacheAPI::checkFileNameMatchesHash(fileName, hashKey)) {
-                qDebug() << "WARNING: Cache entry filename is not the same as the serialized hash key";
-            }
-#endif
-        }
-        _data.allocate(count, storage, fileName);
-    }
-
-    /** @brief This function is called in allocateMeory() and before the object is exposed
-     * to other threads. Hence this function doesn't need locking mechanism at all.
-     * We must ensure that this function is called ONLY by allocateMemory(), that's why
-     * it is private.
-     **/
-    void restoreBufferFromFile(const std::string & path)
+                   StorageModeEnum storage )
     {
-        
-        if (!fileExists(path)) {
-            throw std::runtime_error("Cache restore, no such file: " + path);
-        }
-        _data.restoreBufferFromFile(path);
-       
+        _data.allocate(count, storage, _cache ? _cache->getPackFile() : 0);
     }
 
 protected:
@@ -909,10 +786,10 @@ protected:
     boost::shared_ptr<ParamsType> _params;
     Buffer<DataType> _data;
     const CacheAPI* _cache;
-    std::string _requestedPath;
     mutable QReadWriteLock _entryLock;
     StorageModeEnum _requestedStorage;
     bool _removeBackingFileBeforeDestruction;
+    mutable int _lastAccessTick;
 };
 
 NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,447 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "CachePackFile.h"
+
+#include <cassert>
+#include <cstdio> // for std::remove
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <iostream>
+#include <set>
+#include <utility>
+
+#include <QtCore/QMutex>
+#include <QtCore/QDebug>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Engine/MemoryFile.h"
+
+NATRON_NAMESPACE_ENTER;
+
+// (segment, offset) -> capacity
+typedef std::map<std::pair<int, U64>, U64> FreeBlocksByOffsetMap;
+
+// (capacity, (segment, offset))
+typedef std::set<std::pair<U64, std::pair<int, U64> > > FreeBlocksBySizeSet;
+
+struct CachePackFilePrivate
+{
+    std::string directoryPath;
+    U64 segmentSize;
+    U64 maxTotalSize;
+
+    // NULL until the segment is mapped
+    std::vector<boost::shared_ptr<MemoryFile> > segments;
+    std::vector<U64> segmentsUsedSize;
+
+    // free blocks sorted by position, to merge neighbours, and by capacity, to find the best fit.
+    // Neighbouring free blocks are always merged and no free block ends the used portion of a segment.
+    FreeBlocksByOffsetMap freeBlocksByOffset;
+    FreeBlocksBySizeSet freeBlocksBySize;
+
+    // sum of the capacities of the blocks currently handed out
+    U64 allocatedBytes;
+
+    // protects all fields above
+    mutable QMutex lock;
+
+    CachePackFilePrivate(const std::string & directoryPath,
+                         U64 maxTotalSize)
+        : directoryPath(directoryPath)
+        , segmentSize(NATRON_CACHE_PACK_SEGMENT_SIZE)
+        , maxTotalSize(maxTotalSize)
+        , segments()
+        , segmentsUsedSize()
+        , freeBlocksByOffset()
+        , freeBlocksBySize()
+        , allocatedBytes(0)
+        , lock()
+    {
+        if ( !directoryPath.empty() && (directoryPath[directoryPath.size() - 1] != '/') && (directoryPath[directoryPath.size() - 1] != '\\') ) {
+            this->directoryPath.push_back('/');
+        }
+    }
+
+    std::string getSegmentFilePath(int index) const
+    {
+        std::stringstream ss;
+
+        ss << directoryPath << "segment" << index << "." NATRON_CACHE_FILE_EXT;
+
+        return ss.str();
+    }
+
+    boost::shared_ptr<MemoryFile> getOrMapSegment(int index);
+
+    bool takeFreeBlock(U64 capacity, CachePackBlock* block);
+
+    void insertFreeBlock(const CachePackBlock & block)
+    {
+        freeBlocksByOffset[std::make_pair(block.segment, block.offset)] = block.capacity;
+        freeBlocksBySize.insert( std::make_pair( block.capacity, std::make_pair(block.segment, block.offset) ) );
+    }
+
+    void eraseFreeBlock(FreeBlocksByOffsetMap::iterator it)
+    {
+        freeBlocksBySize.erase( std::make_pair(it->second, it->first) );
+        freeBlocksByOffset.erase(it);
+    }
+
+    void releaseBlock(const CachePackBlock & block);
+};
+
+CachePackFile::CachePackFile(const std::string & directoryPath,
+                             U64 maxTotalSize)
+    : _imp( new CachePackFilePrivate(directoryPath, maxTotalSize) )
+{
+}
+
+CachePackFile::~CachePackFile()
+{
+    delete _imp;
+}
+
+void
+CachePackFile::setMaximumSize(U64 maxTotalSize)
+{
+    QMutexLocker k(&_imp->lock);
+
+    _imp->maxTotalSize = maxTotalSize;
+}
+
+U64
+CachePackFile::roundUpToSizeClass(U64 size)
+{
+    if (size <= NATRON_CACHE_PACK_MIN_BLOCK_SIZE) {
+        return NATRON_CACHE_PACK_MIN_BLOCK_SIZE;
+    }
+    // Find the power of 2 p such that p < size <= 2p, then round up to the next quarter of p
+    U64 p = NATRON_CACHE_PACK_MIN_BLOCK_SIZE;
+    while (p * 2 < size) {
+        p *= 2;
+    }
+    U64 step = p / 4;
+
+    return p + ( (size - p + step - 1) / step ) * step;
+}
+
+boost::shared_ptr<MemoryFile>
+CachePackFilePrivate::getOrMapSegment(int index)
+{
+    assert( !lock.tryLock() );
+    assert( index >= 0 && index < (int)segments.size() );
+    if (segments[index]) {
+        return segments[index];
+    }
+    std::string filePath = getSegmentFilePath(index);
+    try {
+        boost::shared_ptr<MemoryFile> file( new MemoryFile(filePath, MemoryFile::eFileOpenModeEnumIfExistsKeepElseCreate) );
+        if (file->size() != segmentSize) {
+            file->resize(segmentSize);
+        }
+        segments[index] = file;
+    } catch (const std::exception & e) {
+        qDebug() << "Failed to map cache segment" << filePath.c_str() << ":" << e.what();
+
+        return boost::shared_ptr<MemoryFile>();
+    }
+
+    return segments[index];
+}
+
+bool
+CachePackFilePrivate::takeFreeBlock(U64 capacity,
+                                    CachePackBlock* block)
+{
+    // Smallest free block that can hold the request
+    FreeBlocksBySizeSet::iterator found = freeBlocksBySize.lower_bound( std::make_pair( capacity, std::make_pair(-1, (U64)0) ) );
+
+    if ( found == freeBlocksBySize.end() ) {
+        return false;
+    }
+    block->capacity = found->first;
+    block->segment = found->second.first;
+    block->offset = found->second.second;
+    freeBlocksByOffset.erase(found->second);
+    freeBlocksBySize.erase(found);
+
+    // Split the block if what remains is large enough to hold another entry, otherwise the entry
+    // gets the whole block and its capacity is larger than its size-class
+    if (block->capacity - capacity >= NATRON_CACHE_PACK_MIN_BLOCK_SIZE) {
+        CachePackBlock remainder;
+        remainder.segment = block->segment;
+        remainder.offset = block->offset + capacity;
+        remainder.capacity = block->capacity - capacity;
+        insertFreeBlock(remainder);
+        block->capacity = capacity;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Merges the block with the free blocks around it. If the result ends where the used portion of the segment
+ * ends, it is given back to the segment, otherwise it would overlap blocks carved at the end of the segment.
+ **/
+void
+CachePackFilePrivate::releaseBlock(const CachePackBlock & block)
+{
+    CachePackBlock merged = block;
+    FreeBlocksByOffsetMap::iterator next = freeBlocksByOffset.lower_bound( std::make_pair(block.segment, block.offset) );
+
+    if ( next != freeBlocksByOffset.begin() ) {
+        FreeBlocksByOffsetMap::iterator prev = next;
+        --prev;
+        if ( (prev->first.first == merged.segment) && (prev->first.second + prev->second == merged.offset) ) {
+            merged.offset = prev->first.second;
+            merged.capacity += prev->second;
+            eraseFreeBlock(prev);
+        }
+    }
+    if ( ( next != freeBlocksByOffset.end() ) && (next->first.first == merged.segment) && (merged.offset + merged.capacity == next->first.second) ) {
+        merged.capacity += next->second;
+        eraseFreeBlock(next);
+    }
+
+    U64 & used = segmentsUsedSize[merged.segment];
+    if (merged.offset + merged.capacity == used) {
+        used = merged.offset;
+    } else {
+        insertFreeBlock(merged);
+    }
+}
+
+bool
+CachePackFile::allocate(U64 size,
+                        CachePackBlock* block)
+{
+    U64 capacity = roundUpToSizeClass(size);
+    QMutexLocker k(&_imp->lock);
+
+    if (capacity > _imp->segmentSize) {
+        return false;
+    }
+
+    bool found = _imp->takeFreeBlock(capacity, block);
+    if (!found) {
+        // Carve the block at the end of the used portion of a segment
+        for (std::size_t i = 0; i < _imp->segmentsUsedSize.size(); ++i) {
+            if (_imp->segmentSize - _imp->segmentsUsedSize[i] >= capacity) {
+                block->segment = (int)i;
+                block->offset = _imp->segmentsUsedSize[i];
+                block->capacity = capacity;
+                _imp->segmentsUsedSize[i] += capacity;
+                found = true;
+                break;
+            }
+        }
+    }
+    if (!found) {
+        // Add a new segment if the maximum size allows it
+        if ( (U64)_imp->segments.size() * _imp->segmentSize >= _imp->maxTotalSize ) {
+            return false;
+        }
+        _imp->segments.push_back( boost::shared_ptr<MemoryFile>() );
+        _imp->segmentsUsedSize.push_back(capacity);
+        block->segment = (int)_imp->segments.size() - 1;
+        block->offset = 0;
+        block->capacity = capacity;
+    }
+
+    if ( !_imp->getOrMapSegment(block->segment) ) {
+        _imp->releaseBlock(*block);
+        *block = CachePackBlock();
+
+        return false;
+    }
+    _imp->allocatedBytes += block->capacity;
+
+    return true;
+} // allocate
+
+void
+CachePackFile::free(const CachePackBlock & block)
+{
+    if ( !block.isValid() ) {
+        return;
+    }
+    QMutexLocker k(&_imp->lock);
+
+    assert( block.segment < (int)_imp->segmentsUsedSize.size() );
+    assert(_imp->allocatedBytes >= block.capacity);
+    _imp->allocatedBytes -= block.capacity;
+    _imp->releaseBlock(block);
+}
+
+char*
+CachePackFile::data(const CachePackBlock & block)
+{
+    if ( !block.isValid() ) {
+        return 0;
+    }
+    QMutexLocker k(&_imp->lock);
+
+    if ( block.segment >= (int)_imp->segments.size() ) {
+        return 0;
+    }
+    boost::shared_ptr<MemoryFile> segment = _imp->getOrMapSegment(block.segment);
+    if ( !segment || !segment->data() ) {
+        return 0;
+    }
+
+    return segment->data() + block.offset;
+}
+
+bool
+CachePackFile::flush(const CachePackBlock & block,
+                     U64 length)
+{
+    boost::shared_ptr<MemoryFile> segment;
+    {
+        QMutexLocker k(&_imp->lock);
+        if ( !block.isValid() || ( block.segment >= (int)_imp->segments.size() ) ) {
+            return false;
+        }
+        segment = _imp->segments[block.segment];
+    }
+    if (!segment) {
+        // Never mapped: nothing to write
+        return true;
+    }
+
+    // Do not hold the lock while writing to the disk
+    return segment->flushRange( block.offset, std::min(length, block.capacity), true );
+}
+
+void
+CachePackFile::getState(CachePackFileState* state) const
+{
+    QMutexLocker k(&_imp->lock);
+
+    state->segmentSize = _imp->segmentSize;
+    state->segmentsUsedSize = _imp->segmentsUsedSize;
+    state->freeBlocks.clear();
+    for (FreeBlocksByOffsetMap::const_iterator it = _imp->freeBlocksByOffset.begin(); it != _imp->freeBlocksByOffset.end(); ++it) {
+        CachePackBlock block;
+        block.segment = it->first.first;
+        block.offset = it->first.second;
+        block.capacity = it->second;
+        state->freeBlocks.push_back(block);
+    }
+}
+
+bool
+CachePackFile::restoreState(const CachePackFileState & state)
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert( _imp->segments.empty() );
+    if (state.segmentSize != _imp->segmentSize) {
+        // The index was written by a build with a different segment size, it cannot be used
+        return false;
+    }
+    for (std::size_t i = 0; i < state.segmentsUsedSize.size(); ++i) {
+        if (state.segmentsUsedSize[i] == 0) {
+            continue;
+        }
+        std::ifstream segmentFile( _imp->getSegmentFilePath(i).c_str() );
+        if ( !segmentFile.is_open() ) {
+            // The segments were removed behind our back, the entries referencing them are lost
+            return false;
+        }
+    }
+    _imp->segmentsUsedSize = state.segmentsUsedSize;
+    _imp->segments.resize( state.segmentsUsedSize.size() );
+    _imp->freeBlocksByOffset.clear();
+    _imp->freeBlocksBySize.clear();
+
+    // Blocks of older indexes may not have been merged, releasing them again restores the invariants
+    for (std::size_t i = 0; i < state.freeBlocks.size(); ++i) {
+        const CachePackBlock & block = state.freeBlocks[i];
+        if ( !block.isValid() || ( block.segment >= (int)_imp->segments.size() ) || (block.capacity == 0) ||
+             ( block.offset + block.capacity > _imp->segmentsUsedSize[block.segment] ) ||
+             ( _imp->freeBlocksByOffset.find( std::make_pair(block.segment, block.offset) ) != _imp->freeBlocksByOffset.end() ) ) {
+            continue;
+        }
+        _imp->releaseBlock(block);
+    }
+
+    U64 usedBytes = 0;
+    for (std::size_t i = 0; i < _imp->segmentsUsedSize.size(); ++i) {
+        usedBytes += _imp->segmentsUsedSize[i];
+    }
+    U64 freeBytes = 0;
+    for (FreeBlocksByOffsetMap::const_iterator it = _imp->freeBlocksByOffset.begin(); it != _imp->freeBlocksByOffset.end(); ++it) {
+        freeBytes += it->second;
+    }
+    _imp->allocatedBytes = usedBytes >= freeBytes ? usedBytes - freeBytes : 0;
+
+    return true;
+}
+
+bool
+CachePackFile::isEmpty() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->allocatedBytes == 0;
+}
+
+void
+CachePackFile::removeSegmentFiles()
+{
+    QMutexLocker k(&_imp->lock);
+
+    assert(_imp->allocatedBytes == 0);
+    for (std::size_t i = 0; i < _imp->segments.size(); ++i) {
+        if (_imp->segments[i]) {
+            try {
+                _imp->segments[i]->remove();
+            } catch (const std::exception & e) {
+                std::cerr << e.what() << std::endl;
+            }
+        } else {
+            int ret_code = std::remove( _imp->getSegmentFilePath(i).c_str() );
+            Q_UNUSED(ret_code);
+        }
+    }
+    _imp->segments.clear();
+    _imp->segmentsUsedSize.clear();
+    _imp->freeBlocksByOffset.clear();
+    _imp->freeBlocksBySize.clear();
+}
+
+std::size_t
+CachePackFile::getNumSegments() const
+{
+    QMutexLocker k(&_imp->lock);
+
+    return _imp->segments.size();
+}
+
+NATRON_NAMESPACE_EXIT;
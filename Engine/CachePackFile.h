@@ -0,0 +1,166 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+#ifndef NATRON_ENGINE_CACHEPACKFILE_H
+#define NATRON_ENGINE_CACHEPACKFILE_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <string>
+#include <vector>
+#include <map>
+
+#include "Global/GlobalDefines.h"
+#include "Engine/EngineFwd.h"
+
+//Size of a segment file of the pack. Entries larger than this are stored in RAM.
+#define NATRON_CACHE_PACK_SEGMENT_SIZE ( sizeof(void*) == 8 ? ( (U64)1 << 30 ) : ( (U64)1 << 28 ) )
+
+//Smallest block handed out by the pack allocator. Must be a multiple of the system page size.
+#define NATRON_CACHE_PACK_MIN_BLOCK_SIZE ( (U64)1 << 16 )
+
+NATRON_NAMESPACE_ENTER;
+
+struct CachePackFilePrivate;
+
+/**
+ * @brief A contiguous region of a pack segment holding the data of one cache entry.
+ **/
+struct CachePackBlock
+{
+    int segment; //< index of the segment file, -1 if the block is invalid
+    U64 offset; //< offset in bytes from the start of the segment
+    U64 capacity; //< size of the region in bytes, at least the size-class of the requested size
+
+    CachePackBlock()
+        : segment(-1)
+        , offset(0)
+        , capacity(0)
+    {
+    }
+
+    bool isValid() const
+    {
+        return segment >= 0;
+    }
+};
+
+/**
+ * @brief The allocator state of a pack, written in the cache index so that the pack can be restored
+ * without scanning the segment files.
+ **/
+struct CachePackFileState
+{
+    U64 segmentSize;
+    std::vector<U64> segmentsUsedSize; //< for each segment, the offset past the last block ever allocated
+    std::vector<CachePackBlock> freeBlocks;
+
+    CachePackFileState()
+        : segmentSize(0)
+        , segmentsUsedSize()
+        , freeBlocks()
+    {
+    }
+};
+
+/**
+ * @brief Storage for the disk portion of a Cache: instead of one memory-mapped file per entry, all entries
+ * live in a few large preallocated segment files which stay mapped for the lifetime of the pack.
+ * Requested sizes are rounded up to the next size-class (4 classes per power of 2, starting at
+ * NATRON_CACHE_PACK_MIN_BLOCK_SIZE) and served by the smallest free block that can hold them, which is
+ * split if the remainder can hold another entry. Freed blocks are merged with their free neighbours, and
+ * given back to their segment when they end its used portion.
+ *
+ * This class is thread-safe.
+ **/
+class CachePackFile
+{
+public:
+
+    /**
+     * @param directoryPath The directory where the segment files are created
+     * @param maxTotalSize The pack will not create more segments than needed to hold this amount of bytes
+     **/
+    CachePackFile(const std::string & directoryPath,
+                  U64 maxTotalSize);
+
+    /**
+     * @brief Unmaps all segments. The segment files are left on disk.
+     **/
+    ~CachePackFile();
+
+    void setMaximumSize(U64 maxTotalSize);
+
+    /**
+     * @brief Returns the capacity actually reserved for a request of the given size.
+     **/
+    static U64 roundUpToSizeClass(U64 size);
+
+    /**
+     * @brief Reserves a block of at least size bytes. Returns false if the pack is full or if a segment
+     * file could not be created, in which case the caller should fallback on RAM storage.
+     **/
+    bool allocate(U64 size, CachePackBlock* block);
+
+    /**
+     * @brief Gives back the block to the allocator.
+     **/
+    void free(const CachePackBlock & block);
+
+    /**
+     * @brief Returns a pointer to the data of the block, mapping its segment if needed. Returns NULL on failure.
+     **/
+    char* data(const CachePackBlock & block);
+
+    /**
+     * @brief Writes the first length bytes of the block to the segment file and releases the pages from RAM.
+     **/
+    bool flush(const CachePackBlock & block, U64 length);
+
+    /**
+     * @brief Get/restore the allocator state so it can be saved along the cache index.
+     * restoreState() must be called before any allocation.
+     **/
+    void getState(CachePackFileState* state) const;
+    bool restoreState(const CachePackFileState & state);
+
+    /**
+     * @brief Returns true if no block is currently allocated
+     **/
+    bool isEmpty() const;
+
+    /**
+     * @brief Unmaps all segments and removes their files. Must only be called when isEmpty() returns true.
+     **/
+    void removeSegmentFiles();
+
+    std::size_t getNumSegments() const;
+
+private:
+
+    CachePackFilePrivate* _imp;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_CACHEPACKFILE_H
@@ -36,6 +36,7 @@ GCC_DIAG_OFF(unused-parameter)
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/serialization/utility.hpp>
 #include <boost/serialization/list.hpp>
+#include <boost/serialization/vector.hpp>
 // /usr/local/include/boost/serialization/shared_ptr.hpp:112:5: warning: unused typedef 'boost_static_assert_typedef_112' [-Wunused-local-typedef]
 #include <boost/serialization/shared_ptr.hpp>
 #include <boost/serialization/export.hpp>
@@ -45,6 +46,7 @@ GCC_DIAG_ON(unused-parameter)
 #endif
 
 #include "Engine/Cache.h"
+#include "Engine/CachePackFile.h"
 #include "Engine/ImageSerialization.h"
 #include "Engine/ImageParamsSerialization.h"
 #include "Engine/FrameEntrySerialization.h"
@@ -60,6 +62,32 @@ GCC_DIAG_ON(unused-parameter)
 ///When defined, number of opened files, memory size and disk size of the cache are printed whenever there's activity.
 //#define NATRON_DEBUG_CACHE
 
+namespace boost {
+namespace serialization {
+template<class Archive>
+void
+serialize(Archive & ar,
+          NATRON_NAMESPACE::CachePackBlock & b,
+          const unsigned int /*version*/)
+{
+    ar & ::boost::serialization::make_nvp("Segment",b.segment);
+    ar & ::boost::serialization::make_nvp("Offset",b.offset);
+    ar & ::boost::serialization::make_nvp("Capacity",b.capacity);
+}
+
+template<class Archive>
+void
+serialize(Archive & ar,
+          NATRON_NAMESPACE::CachePackFileState & s,
+          const unsigned int /*version*/)
+{
+    ar & ::boost::serialization::make_nvp("SegmentSize",s.segmentSize);
+    ar & ::boost::serialization::make_nvp("SegmentsUsedSize",s.segmentsUsedSize);
+    ar & ::boost::serialization::make_nvp("FreeBlocks",s.freeBlocks);
+}
+}
+}
+
 NATRON_NAMESPACE_ENTER;
 
 /*Saves cache to disk as a settings file.
@@ -68,24 +96,22 @@ template<typename EntryType>
 void Cache<EntryType>::save(CacheTOC* tableOfContents)
 {
     clearInMemoryPortion(false);
-    QMutexLocker l(&_lock);     // must be locked
-
-    for (CacheIterator it = _diskCache.begin(); it != _diskCache.end(); ++it) {
-        std::list<EntryTypePtr> & listOfValues  = getValueFromIterator(it);
-        for (typename std::list<EntryTypePtr>::const_iterator it2 = listOfValues.begin(); it2 != listOfValues.end(); ++it2) {
-            if ( (*it2)->isStoredOnDisk() ) {
-                SerializedEntry serialization;
-                serialization.hash = (*it2)->getHashKey();
-                serialization.params = (*it2)->getParams();
-                serialization.key = (*it2)->getKey();
-                serialization.size = (*it2)->dataSize();
-                serialization.filePath = (*it2)->getFilePath();
-                tableOfContents->push_back(serialization);
-#ifdef DEBUG
-                if (!CacheAPI::checkFileNameMatchesHash(serialization.filePath, serialization.hash)) {
-                    qDebug() << "WARNING: Cache entry filename is not the same as the serialized hash key";
+
+    for (int i = 0; i < NATRON_CACHE_BUCKETS_COUNT; ++i) {
+        QMutexLocker l(&_buckets[i].lock);     // must be locked
+
+        for (CacheIterator it = _buckets[i].diskCache.begin(); it != _buckets[i].diskCache.end(); ++it) {
+            std::list<EntryTypePtr> & listOfValues  = getValueFromIterator(it);
+            for (typename std::list<EntryTypePtr>::const_iterator it2 = listOfValues.begin(); it2 != listOfValues.end(); ++it2) {
+                if ( (*it2)->isStoredOnDisk() ) {
+                    SerializedEntry serialization;
+                    serialization.hash = (*it2)->getHashKey();
+                    serialization.params = (*it2)->getParams();
+                    serialization.key = (*it2)->getKey();
+                    serialization.size = (*it2)->dataSize();
+                    serialization.block = (*it2)->getPackBlock();
+                    tableOfContents->push_back(serialization);
                 }
-#endif
             }
         }
     }
@@ -116,28 +142,23 @@ void Cache<EntryType>::restore(const CacheTOC & tableOfContents)
             qDebug() << "WARNING: serialized hash key different than the restored one";
         }
 
-#ifdef DEBUG
-        if (!checkFileNameMatchesHash(it->filePath, it->hash)) {
-            qDebug() << "WARNING: Cache entry filename is not the same as the serialized hash key";
-        }
-#endif
-
         EntryType* value = NULL;
 
         StorageModeEnum storage = eStorageModeDisk;
 
         try {
-            value = new EntryType(it->key,it->params,this,storage,it->filePath);
+            value = new EntryType(it->key,it->params,this,storage);
 
             ///This will not put the entry back into RAM, instead we just insert back the entry into the disk cache
-            value->restoreMetaDataFromFile(it->size);
+            value->restoreMetaDataFromPackFile(it->block, it->size);
         } catch (const std::exception & e) {
             qDebug() << e.what();
+            delete value;
             continue;
         }
 
         {
-            QMutexLocker locker(&_lock);
+            QMutexLocker locker( &getBucket( value->getHashKey() ).lock );
             sealEntry(EntryTypePtr(value), false);
         }
     }
@@ -150,14 +171,14 @@ struct Cache<EntryType>::SerializedEntry
     typename EntryType::key_type key;
     ParamsTypePtr params;
     std::size_t size; //< the data size in bytes
-    std::string filePath; //< we need to serialize it as several entries can have the same hash, hence we index them
+    CachePackBlock block; //< where the data of the entry lives in the pack file of the cache
 
     SerializedEntry()
     : hash(0)
     , key()
     , params()
     , size(0)
-    , filePath()
+    , block()
     {
 
     }
@@ -170,7 +191,7 @@ struct Cache<EntryType>::SerializedEntry
         ar & ::boost::serialization::make_nvp("Key",key);
         ar & ::boost::serialization::make_nvp("Params",params);
         ar & ::boost::serialization::make_nvp("Size",size);
-        ar & ::boost::serialization::make_nvp("Filename",filePath);
+        ar & ::boost::serialization::make_nvp("Block",block);
     }
 
     template<class Archive>
@@ -181,7 +202,7 @@ struct Cache<EntryType>::SerializedEntry
         ar & ::boost::serialization::make_nvp("Key",key);
         ar & ::boost::serialization::make_nvp("Params",params);
         ar & ::boost::serialization::make_nvp("Size",size);
-        ar & ::boost::serialization::make_nvp("Filename",filePath);
+        ar & ::boost::serialization::make_nvp("Block",block);
     }
 
     BOOST_SERIALIZATION_SPLIT_MEMBER()
@@ -67,6 +67,28 @@ public:
 private:
     double _t;
 };
+
+/// the range of the values of the knob owning a curve
+std::pair<double,double>
+getKnobYRange(KnobI* owner,
+              int dimension)
+{
+    Knob<double>* isDouble = dynamic_cast<Knob<double>*>(owner);
+    Knob<int>* isInt = dynamic_cast<Knob<int>*>(owner);
+    if (isDouble) {
+        std::pair<double, double> ret;
+        ret.first = isDouble->getMinimum(dimension);
+        ret.second = isDouble->getMaximum(dimension);
+        return ret;
+    } else if (isInt) {
+        std::pair<double, double> ret;
+        ret.first = isInt->getMinimum(dimension);
+        ret.second = isInt->getMaximum(dimension);
+        return ret;
+    } else {
+        return std::make_pair( (double)INT_MIN, (double)INT_MAX );
+    }
+}
 }
 
 /************************************KEYFRAME************************************/
@@ -304,6 +326,7 @@ Curve::clearKeyFrames()
     QMutexLocker l(&_imp->_lock);
 
     _imp->keyFrames.clear();
+    boost::atomic_store( &_imp->snapshot, CurveSnapshotPtr() );
 }
 
 bool
@@ -783,36 +806,34 @@ interParams(const KeyFrameSet &keyFrames,
     }
 }
 
-double
-Curve::getValueAt(double t,bool doClamp) const
+/// build the snapshot of the keyframes, with the cubic of each segment computed like getValueAt did
+static CurveSnapshotPtr
+buildSnapshot(const CurvePrivate& imp)
 {
-    QMutexLocker l(&_imp->_lock);
+    // PRIVATE - must be called under the lock
+    boost::shared_ptr<CurveSnapshot> snap(new CurveSnapshot);
+    const KeyFrameSet& keyFrames = imp.keyFrames;
 
-    if ( _imp->keyFrames.empty() ) {
-        throw std::runtime_error("Curve has no control points!");
+    snap->hasYRange = imp.hasYRange;
+    snap->yMin = imp.yMin;
+    snap->yMax = imp.yMax;
+    if ( keyFrames.empty() ) {
+        return snap;
     }
-    
-    double v;
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double,double>::const_iterator foundCached = _imp->resultCache.find(t);
-    if (foundCached != _imp->resultCache.end()) {
-        v = foundCached->second;
-    } else
-#endif
-    {
-        // even when there is only one keyframe, there may be tangents!
-        //if (_imp->keyFrames.size() == 1) {
-        //    //if there's only 1 keyframe, don't bother interpolating
-        //    return (*_imp->keyFrames.begin()).getValue();
-        //}
+    snap->keyTimes.reserve( keyFrames.size() );
+    for (KeyFrameSet::const_iterator it = keyFrames.begin(); it != keyFrames.end(); ++it) {
+        snap->keyTimes.push_back( it->getTime() );
+    }
+    snap->segments.resize(keyFrames.size() + 1);
+
+    KeyFrameSet::const_iterator itup = keyFrames.begin();
+    for (std::size_t i = 0; i < snap->segments.size(); ++i) {
+        // a time inside the segment, for the asserts of interParams
+        const double t = (i == 0) ? snap->keyTimes[0] - 1. : snap->keyTimes[i - 1];
         double tcur,tnext;
         double vcurDerivRight,vnextDerivLeft,vcur,vnext;
         KeyframeTypeEnum interp,interpNext;
-        KeyFrame k(t,0.);
-        // find the first keyframe with time greater than t
-        KeyFrameSet::const_iterator itup;
-        itup = _imp->keyFrames.upper_bound(k);
-        interParams(_imp->keyFrames,
+        interParams(keyFrames,
                     t,
                     itup,
                     &tcur,
@@ -823,21 +844,56 @@ Curve::getValueAt(double t,bool doClamp) const
                     &vnext,
                     &vnextDerivLeft,
                     &interpNext);
-        
-        v = Interpolation::interpolate(tcur,vcur,
-                                vcurDerivRight,
-                                vnextDerivLeft,
-                                tnext,vnext,
-                                t,
-                                interp,
-                                interpNext);
-#ifdef NATRON_CURVE_USE_CACHE
-        _imp->resultCache[t] = v;
-#endif
+
+        CurveSnapshot::Segment& seg = snap->segments[i];
+        Interpolation::cubicCoefficients(tcur,vcur,
+                                         vcurDerivRight,
+                                         vnextDerivLeft,
+                                         tnext,vnext,
+                                         interp,
+                                         interpNext,
+                                         &seg.tstart, &seg.tend,
+                                         &seg.c0, &seg.c1, &seg.c2, &seg.c3);
+        if ( itup != keyFrames.end() ) {
+            ++itup;
+        }
+    }
+
+    return snap;
+}
+
+CurveSnapshotPtr
+Curve::getSnapshot() const
+{
+    CurveSnapshotPtr snap = boost::atomic_load(&_imp->snapshot);
+
+    if (snap) {
+        return snap;
     }
 
-    if ( doClamp && mustClamp() ) {
-        v = clampValueToCurveYRange(v);
+    QMutexLocker l(&_imp->_lock);
+    // another thread may have built it while we were waiting for the lock
+    if (!_imp->snapshot) {
+        boost::atomic_store( &_imp->snapshot, buildSnapshot(*_imp) );
+    }
+
+    return _imp->snapshot;
+}
+
+double
+Curve::snapshotValueToCurveValue(const CurveSnapshot& snap,
+                                 double v,
+                                 bool doClamp) const
+{
+    // PRIVATE - should not lock
+    if ( doClamp && (_imp->owner || snap.hasYRange) ) {
+        std::pair<double,double> minmax = _imp->owner ? getKnobYRange(_imp->owner, _imp->dimensionInOwner) :
+                                          std::make_pair(snap.yMin, snap.yMax);
+        if (v > minmax.second) {
+            v = minmax.second;
+        } else if (v < minmax.first) {
+            v = minmax.first;
+        }
     }
 
     switch (_imp->type) {
@@ -855,8 +911,45 @@ Curve::getValueAt(double t,bool doClamp) const
 
         return v;
     }
+}
+
+double
+Curve::getValueAt(double t,bool doClamp) const
+{
+    CurveSnapshotPtr snap = getSnapshot();
+
+    if ( snap->keyTimes.empty() ) {
+        throw std::runtime_error("Curve has no control points!");
+    }
+
+    // even when there is only one keyframe, there may be tangents!
+    double v = snap->evaluate(snap->findSegment(t), t);
+
+    return snapshotValueToCurveValue(*snap, v, doClamp);
 } // getValueAt
 
+void
+Curve::getValuesAt(const double* times,
+                   int n,
+                   double* values,
+                   bool doClamp) const
+{
+    CurveSnapshotPtr snap = getSnapshot();
+
+    if ( snap->keyTimes.empty() ) {
+        throw std::runtime_error("Curve has no control points!");
+    }
+
+    int segment = 0;
+    for (int i = 0; i < n; ++i) {
+        const double t = times[i];
+        if ( !snap->segmentContains(segment, t) ) {
+            segment = snap->findSegment(t);
+        }
+        values[i] = snapshotValueToCurveValue(*snap, snap->evaluate(segment, t), doClamp);
+    }
+}
+
 double
 Curve::getDerivativeAt(double t) const
 {
@@ -1031,21 +1124,7 @@ std::pair<double,double>  Curve::getCurveYRange() const
         throw std::logic_error("Curve::getCurveYRange() called for a curve without owner or Y range");
     }
     if (_imp->owner) {
-        Knob<double>* isDouble = dynamic_cast<Knob<double>*>(_imp->owner);
-        Knob<int>* isInt = dynamic_cast<Knob<int>*>(_imp->owner);
-        if (isDouble) {
-            std::pair<double, double> ret;
-            ret.first = isDouble->getMinimum(_imp->dimensionInOwner);
-            ret.second = isDouble->getMaximum(_imp->dimensionInOwner);
-            return ret;
-        } else if (isInt) {
-            std::pair<double, double> ret;
-            ret.first = isInt->getMinimum(_imp->dimensionInOwner);
-            ret.second = isInt->getMaximum(_imp->dimensionInOwner);
-            return ret;
-        } else {
-            return std::make_pair( (double)INT_MIN, (double)INT_MAX );
-        }
+        return getKnobYRange(_imp->owner, _imp->dimensionInOwner);
     }
     assert( hasYRange() );
 
@@ -1561,6 +1640,7 @@ Curve::setYRange(double yMin,
     _imp->yMin = yMin;
     _imp->yMax = yMax;
     _imp->hasYRange = true;
+    boost::atomic_store( &_imp->snapshot, CurveSnapshotPtr() );
 }
 
 bool
@@ -1581,12 +1661,10 @@ void
 Curve::onCurveChanged()
 {
     // PRIVATE - should not lock
+    boost::atomic_store( &_imp->snapshot, CurveSnapshotPtr() );
     if (_imp->owner) {
         _imp->owner->clearExpressionsResults(_imp->dimensionInOwner);
     }
-#ifdef NATRON_CURVE_USE_CACHE
-    _imp->resultCache.clear();
-#endif
 }
 
 NATRON_NAMESPACE_EXIT;
@@ -129,6 +129,7 @@ typedef std::set<KeyFrame, KeyFrame_compare_time> KeyFrameSet;
 
 
 struct CurvePrivate;
+struct CurveSnapshot;
 
 class Curve
 {
@@ -228,8 +229,18 @@ public:
 
     double getMaximumTimeCovered() const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Returns the value of the curve at t. This does not take the lock of the curve, except for the
+     * first call after the curve changed: it evaluates the last snapshot of the keyframes.
+     **/
     double getValueAt(double t,bool clamp = true) const WARN_UNUSED_RETURN;
 
+    /**
+     * @brief Same as getValueAt for n times, all evaluated on the same snapshot of the curve.
+     * It is faster when the times are sorted since the segment of the previous time is tried first.
+     **/
+    void getValuesAt(const double* times, int n, double* values, bool clamp = true) const;
+
     double getDerivativeAt(double t) const WARN_UNUSED_RETURN;
 
     double getIntegrateFromTo(double t1, double t2) const WARN_UNUSED_RETURN;
@@ -300,6 +311,12 @@ private:
 
     double clampValueToCurveYRange(double v) const WARN_UNUSED_RETURN;
 
+    ///Returns the snapshot of the keyframes, building it if the curve changed since the last call
+    boost::shared_ptr<const CurveSnapshot> getSnapshot() const WARN_UNUSED_RETURN;
+
+    ///Applies the Y range and the type of the curve to a value interpolated on snap
+    double snapshotValueToCurveValue(const CurveSnapshot& snap, double v, bool doClamp) const WARN_UNUSED_RETURN;
+
     ///returns an iterator to the new keyframe in the keyframe set and
     ///a boolean indicating whether it removed a keyframe already existing at this time or not
     std::pair<KeyFrameSet::iterator,bool> addKeyFrameNoUpdate(const KeyFrame & cp) WARN_UNUSED_RETURN;
@@ -27,6 +27,9 @@
 
 #include "Global/Macros.h"
 
+#include <vector>
+#include <algorithm>
+
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/shared_ptr.hpp>
 #endif
@@ -38,10 +41,56 @@
 #include "Engine/KnobFile.h"
 #include "Engine/EngineFwd.h"
 
-//#define NATRON_CURVE_USE_CACHE
-
 NATRON_NAMESPACE_ENTER;
 
+/**
+ * @brief An immutable copy of a curve, as flat arrays of the keyframe times and of the cubic of each segment,
+ * computed by Interpolation::cubicCoefficients. The readers evaluate it without taking the lock of the curve:
+ * when the curve changes, a new snapshot is built and the readers still holding the old one finish with it.
+ **/
+struct CurveSnapshot
+{
+    struct Segment
+    {
+        double tstart, tend;
+        double c0, c1, c2, c3;
+    };
+
+    std::vector<double> keyTimes;
+
+    ///segments[i] is used for t in [keyTimes[i-1], keyTimes[i]), segments[0] before the first keyframe
+    ///and segments[keyTimes.size()] after the last one
+    std::vector<Segment> segments;
+    bool hasYRange;
+    double yMin, yMax;
+
+    /// the index of the segment used at time t, i.e. the number of keyframes with a time <= t
+    int findSegment(double t) const
+    {
+        return (int)( std::upper_bound(keyTimes.begin(), keyTimes.end(), t) - keyTimes.begin() );
+    }
+
+    bool segmentContains(int i,
+                         double t) const
+    {
+        return ( i == 0 || keyTimes[i - 1] <= t ) && ( i == (int)keyTimes.size() || t < keyTimes[i] );
+    }
+
+    /// same result as Interpolation::interpolate()
+    double evaluate(int i,
+                    double t) const
+    {
+        const Segment& s = segments[i];
+        const double x = (t - s.tstart) / (s.tend - s.tstart);
+        const double x2 = x * x;
+        const double x3 = x2 * x;
+
+        return s.c0 + s.c1 * x + s.c2 * x2 + s.c3 * x3;
+    }
+};
+
+typedef boost::shared_ptr<const CurveSnapshot> CurveSnapshotPtr;
+
 struct CurvePrivate
 {
     enum CurveTypeEnum
@@ -55,11 +104,11 @@ struct CurvePrivate
     };
 
     KeyFrameSet keyFrames;
-    
-#ifdef NATRON_CURVE_USE_CACHE
-    std::map<double,double> resultCache; //< a cache for interpolations
-#endif
-    
+
+    ///Read with boost::atomic_load by getValueAt, NULL when the curve changed since it was built.
+    ///It is only rebuilt and reset under _lock.
+    CurveSnapshotPtr snapshot;
+
     KnobI* owner;
     int dimensionInOwner;
     CurveTypeEnum type;
@@ -72,9 +121,7 @@ struct CurvePrivate
 
     CurvePrivate()
     : keyFrames()
-#ifdef NATRON_CURVE_USE_CACHE
-    , resultCache()
-#endif
+    , snapshot()
     , owner(NULL)
     , dimensionInOwner(-1)
     , type(eCurveTypeDouble)
@@ -106,6 +153,7 @@ struct CurvePrivate
         yMin = other.yMin;
         yMax = other.yMax;
         hasYRange = other.hasYRange;
+        boost::atomic_store( &snapshot, CurveSnapshotPtr() );
     }
     
 };
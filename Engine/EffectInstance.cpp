@@ -1782,9 +1782,9 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
     QThread* curThread = QThread::currentThread();
     if (callingThread != curThread) {
         ///We are in the case of host frame threading, see kOfxImageEffectPluginPropHostFrameThreading
-        ///We know that in the renderAction, TLS will be needed, so we do a deep copy of the TLS from the caller thread
-        ///to this thread
-        appPTR->getAppTLS()->copyTLS(callingThread, curThread);
+        ///We know that in the renderAction, TLS will be needed, so we use the copy of the TLS of the caller thread
+        ///taken before the tiles were queued
+        appPTR->getAppTLS()->copyTLS(args.callerTLS);
     }
     
     
@@ -1809,12 +1809,27 @@ EffectInstance::Implementation::tiledRenderingFunctor(EffectInstance::Implementa
                                  args.processChannels,
                                  args.planes);
     
-    //Exit of the host frame threading thread
-    appPTR->getAppTLS()->cleanupTLSForThread();
+    //Exit of the host frame threading thread. If the calling thread rendered this tile itself while waiting
+    //for the others, its TLS must be kept.
+    if (callingThread != curThread) {
+        appPTR->getAppTLS()->cleanupTLSForThread();
+    }
     
     return ret;
 }
 
+void
+EffectInstance::Implementation::tiledRenderingTask(TiledRenderingFunctorArgs args,
+                                                   const RectToRender* specificData,
+                                                   const QThread* callingThread,
+                                                   RenderingFunctorRetEnum* ret,
+                                                   double* timeSpent)
+{
+    TimeLapse timer;
+    *ret = tiledRenderingFunctor(args, *specificData, callingThread);
+    *timeSpent = timer.getTimeSinceCreation();
+}
+
 EffectInstance::RenderingFunctorRetEnum
 EffectInstance::Implementation::tiledRenderingFunctor(const RectToRender & rectToRender,
                                                       const bool renderFullScaleThenDownscale,
@@ -2448,6 +2463,19 @@ EffectInstance::Implementation::renderHandler(const EffectDataTLSPtr& tls,
             } else { // if (renderFullScaleThenDownscale) {
                 
                 
+                /*
+                 * When the image is stored in the cache with another bit depth than the one rendered (half-float cache),
+                 * the original input and the mask have the depth of the render: mix them before the conversion.
+                 */
+                const bool mixBeforeConversion = it->second.tmpImage != it->second.downscaleImage &&
+                                                 it->second.downscaleImage->getBitDepth() != it->second.tmpImage->getBitDepth();
+                if (mixBeforeConversion) {
+                    it->second.tmpImage->copyUnProcessedChannels(actionArgs.roi, planes.outputPremult, originalImagePremultiplication, processChannels, originalInputImage);
+                    if (useMaskMix) {
+                        it->second.tmpImage->applyMaskMix(actionArgs.roi, maskImage.get(), originalInputImage.get(), doMask, false, mix);
+                    }
+                }
+
                 ///Copy the rectangle rendered in the downscaled image
                 if (it->second.tmpImage != it->second.downscaleImage) {
                     if ( ( it->second.downscaleImage->getComponents() != it->second.tmpImage->getComponents() ) ||
@@ -2470,9 +2498,11 @@ EffectInstance::Implementation::renderHandler(const EffectDataTLSPtr& tls,
                     }
                 }
 
-                it->second.downscaleImage->copyUnProcessedChannels(actionArgs.roi, planes.outputPremult, originalImagePremultiplication, processChannels, originalInputImage);
-                if (useMaskMix) {
-                    it->second.downscaleImage->applyMaskMix(actionArgs.roi, maskImage.get(), originalInputImage.get(), doMask, false, mix);
+                if (!mixBeforeConversion) {
+                    it->second.downscaleImage->copyUnProcessedChannels(actionArgs.roi, planes.outputPremult, originalImagePremultiplication, processChannels, originalInputImage);
+                    if (useMaskMix) {
+                        it->second.downscaleImage->applyMaskMix(actionArgs.roi, maskImage.get(), originalInputImage.get(), doMask, false, mix);
+                    }
                 }
                 it->second.downscaleImage->markForRendered(downscaledRectToRender);
                 
@@ -31,6 +31,12 @@
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
 
+// Under this speedup, tiles are not worth the overhead of splitting the render
+#define NATRON_TILES_MIN_SPEEDUP 1.2
+// The number of renders without tiles after which the speedup of the tiles is measured again
+#define NATRON_TILES_SPEEDUP_MEASURE_PERIOD 16
+#define NATRON_TILES_SPEEDUP_SMOOTHING 0.3
+
 
 NATRON_NAMESPACE_ENTER;
 
@@ -350,6 +356,9 @@ EffectInstance::Implementation::Implementation(EffectInstance* publicInterface)
     , outputComponentsAvailable()
     , defaultClipPreferencesDataMutex()
     , clipPrefsData()
+    , tilesSpeedupMutex()
+    , tilesSpeedup(-1)
+    , rendersWithoutTiles(0)
 {
 }
 
@@ -447,6 +456,36 @@ EffectInstance::Implementation::setDuringInteractAction(bool b)
     duringInteractAction = b;
 }
 
+bool
+EffectInstance::Implementation::shouldRenderInTiles()
+{
+    QMutexLocker k(&tilesSpeedupMutex);
+
+    if ( (tilesSpeedup < 0.) || (tilesSpeedup >= NATRON_TILES_MIN_SPEEDUP) ) {
+        return true;
+    }
+    ///The conditions may have changed (e.g. less frames are rendered in parallel), measure again from time to time
+    if (++rendersWithoutTiles >= NATRON_TILES_SPEEDUP_MEASURE_PERIOD) {
+        rendersWithoutTiles = 0;
+
+        return true;
+    }
+
+    return false;
+}
+
+void
+EffectInstance::Implementation::reportTilesSpeedup(double tilesTime,
+                                                   double wallTime)
+{
+    if (wallTime <= 0.) {
+        return;
+    }
+    const double speedup = tilesTime / wallTime;
+    QMutexLocker k(&tilesSpeedupMutex);
+    tilesSpeedup = tilesSpeedup < 0. ? speedup : tilesSpeedup + (speedup - tilesSpeedup) * NATRON_TILES_SPEEDUP_SMOOTHING;
+}
+
 
 #if NATRON_ENABLE_TRIMAP
 void
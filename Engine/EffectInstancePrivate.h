@@ -212,12 +212,31 @@ struct EffectInstance::Implementation
     mutable QMutex defaultClipPreferencesDataMutex;
     EffectInstance::DefaultClipPreferencesData clipPrefsData;
     
+    ///How much faster the tiles of this effect render in parallel, measured when the threads are balanced automatically
+    ///Protected by tilesSpeedupMutex
+    QMutex tilesSpeedupMutex;
+    double tilesSpeedup; // moving average of the time spent in all the tiles over the time to render them, -1 if unknown
+    int rendersWithoutTiles; // renders since the tiles were last measured
+    
     
 
 
     void runChangedParamCallback(KnobI* k, bool userEdited, const std::string & callback);
 
     void setDuringInteractAction(bool b);
+    
+    /**
+     * @brief When the threads are balanced automatically, returns whether the next render should be split in
+     * tiles rendered in parallel: it is not if the tiles were measured not to render faster in parallel (e.g. the
+     * cores are busy with other frames or the plug-in is limited by a lock), unless it is time to measure them again.
+     **/
+    bool shouldRenderInTiles();
+    
+    /**
+     * @brief Records the speedup of a render in tiles: tilesTime is the sum of the time spent in each tile and
+     * wallTime the time it took to render them all.
+     **/
+    void reportTilesSpeedup(double tilesTime, double wallTime);
 
 #if NATRON_ENABLE_TRIMAP
     void markImageAsBeingRendered(const boost::shared_ptr<Image> & img);
@@ -312,10 +331,22 @@ struct EffectInstance::Implementation
         bool byPassCache;
         std::bitset<4> processChannels;
         boost::shared_ptr<ImagePlanesToRender> planes;
+        //The TLS of the thread which queued the tiles, taken before queuing them since that thread then renders
+        //tiles itself, which modifies its TLS
+        TLSSnapshotPtr callerTLS;
     };
     
     RenderingFunctorRetEnum tiledRenderingFunctor(TiledRenderingFunctorArgs & args,  const RectToRender & specificData,
                                                   const QThread* callingThread);
+
+    /**
+     * @brief Same as above, storing the result in ret so that it can be queued on the TaskScheduler
+     **/
+    void tiledRenderingTask(TiledRenderingFunctorArgs args,
+                            const RectToRender* specificData,
+                            const QThread* callingThread,
+                            RenderingFunctorRetEnum* ret,
+                            double* timeSpent);
     
     RenderingFunctorRetEnum tiledRenderingFunctor(const RectToRender & rectToRender,
                                                   const bool renderFullScaleThenDownscale,
@@ -33,7 +33,6 @@
 #include <stdexcept>
 
 #include <QtCore/QThreadPool>
-#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QtConcurrentRun>
@@ -69,6 +68,7 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/Settings.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/Timer.h"
 #include "Engine/Transform.h"
 #include "Engine/ViewerInstance.h"
@@ -723,6 +723,16 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
     getPreferredDepthAndComponents(-1, &outputClipPrefComps, &outputDepth);
     assert( !outputClipPrefComps.empty() );
 
+    /*
+     * Float images may be stored in the cache as half-floats to halve its memory: the plug-in still renders in float
+     * and the planes are converted back to float when returned. Not for effects painting over their own output, which
+     * read back the cached image while rendering.
+     */
+    const bool storeAsHalf = outputDepth == eImageBitDepthFloat && args.bitdepth == eImageBitDepthFloat &&
+                             !isPaintingOverItselfEnabled() && appPTR->getCurrentSettings()->isHalfFloatCacheEnabled();
+    const ImageBitDepthEnum cachedDepth = storeAsHalf ? eImageBitDepthHalf : args.bitdepth;
+    const ImageBitDepthEnum cachedPrefDepth = storeAsHalf ? eImageBitDepthHalf : outputDepth;
+
 
     boost::shared_ptr<ImagePlanesToRender> planesToRender(new ImagePlanesToRender);
     boost::shared_ptr<FramesNeededMap> framesNeeded(new FramesNeededMap);
@@ -765,8 +775,8 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
                     getImageFromCacheAndConvertIfNeeded(createInCache, useDiskCacheNode, n == 0 ? nonDraftKey : key, renderMappedMipMapLevel,
                                                         renderFullScaleThenDownscale ? &upscaledImageBounds : &downscaledImageBounds,
                                                         &rod,
-                                                        args.bitdepth, *it,
-                                                        outputDepth,
+                                                        cachedDepth, *it,
+                                                        cachedPrefDepth,
                                                         *components,
                                                         args.inputImagesList,
                                                         frameArgs->stats,
@@ -1156,8 +1166,8 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
             getImageFromCacheAndConvertIfNeeded(createInCache, useDiskCacheNode, key, renderMappedMipMapLevel,
                                                 renderFullScaleThenDownscale ? &upscaledImageBounds : &downscaledImageBounds,
                                                 &rod,
-                                                args.bitdepth, it->first,
-                                                outputDepth, *components,
+                                                cachedDepth, it->first,
+                                                cachedPrefDepth, *components,
                                                 args.inputImagesList, frameArgs->stats, &it->second.fullscaleImage);
 
             ///We must retrieve from the cache exactly the originally retrieved image, otherwise we might have to call  renderInputImagesForRoI
@@ -1269,7 +1279,7 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
 
             if (!it->second.fullscaleImage) {
                 ///The image is not cached
-                allocateImagePlane(key, rod, downscaledImageBounds, upscaledImageBounds, isProjectFormat, *framesNeeded, *components, args.bitdepth, par, args.mipMapLevel, renderFullScaleThenDownscale, useDiskCacheNode, createInCache, &it->second.fullscaleImage, &it->second.downscaleImage);
+                allocateImagePlane(key, rod, downscaledImageBounds, upscaledImageBounds, isProjectFormat, *framesNeeded, *components, cachedDepth, par, args.mipMapLevel, renderFullScaleThenDownscale, useDiskCacheNode, createInCache, &it->second.fullscaleImage, &it->second.downscaleImage);
             } else {
                 /*
                  * There might be a situation  where the RoD of the cached image
@@ -1324,7 +1334,7 @@ EffectInstance::renderRoI(const RenderRoIArgs & args,
                 if ( renderFullScaleThenDownscale && (it->second.fullscaleImage->getMipMapLevel() == 0) ) {
                     RectI bounds;
                     rod.toPixelEnclosing(args.mipMapLevel, par, &bounds);
-                    it->second.downscaleImage.reset( new Image(*components, rod, downscaledImageBounds, args.mipMapLevel, it->second.fullscaleImage->getPixelAspectRatio(), outputDepth, true) );
+                    it->second.downscaleImage.reset( new Image(*components, rod, downscaledImageBounds, args.mipMapLevel, it->second.fullscaleImage->getPixelAspectRatio(), it->second.fullscaleImage->getBitDepth(), true) );
                     
                     it->second.fullscaleImage->downscaleMipMap( rod, it->second.fullscaleImage->getBounds(), 0, args.mipMapLevel, true, it->second.downscaleImage.get() );
                 }
@@ -1648,16 +1658,20 @@ EffectInstance::renderRoIInternal(double time,
     ///If the project lock is already locked at this point, don't start any other thread
     ///as it would lead to a deadlock when the project is loading.
     ///Just fall back to Fully_safe
-    int nbThreads = appPTR->getCurrentSettings()->getNumberOfThreads();
+    int nbThreads = appPTR->getNumberOfThreads();
+    const bool autoThreadsBalancing = appPTR->getCurrentSettings()->isAutoThreadsBalancingEnabled();
     if (safety == eRenderSafetyFullySafeFrame) {
         ///If the plug-in is eRenderSafetyFullySafeFrame that means it wants the host to perform SMP aka slice up the RoI into chunks
         ///but if the effect doesn't support tiles it won't work.
         ///Also check that the number of threads indicating by the settings are appropriate for this render mode.
+        ///There's no need to check whether the pool is busy: the render thread helps rendering its own tiles.
         if ( !frameArgs->tilesSupported || (nbThreads == -1) || (nbThreads == 1) ||
             ( (nbThreads == 0) && (appPTR->getHardwareIdealThreadCount() == 1) ) ||
-            ( QThreadPool::globalInstance()->activeThreadCount() >= QThreadPool::globalInstance()->maxThreadCount() ) ||
             isRotoPaintNode() ) {
             safety = eRenderSafetyFullySafe;
+        } else if ( autoThreadsBalancing && (planesToRender->rectsToRender.size() > 1) && !_imp->shouldRenderInTiles() ) {
+            ///The tiles of this effect were measured not to render faster in parallel
+            safety = eRenderSafetyFullySafe;
         }
     }
 
@@ -1728,6 +1742,7 @@ EffectInstance::renderRoIInternal(double time,
             tiledArgs->processChannels = processChannels;
             tiledArgs->planes = planesToRender;
             tiledArgs->compsNeeded = compsNeeded;
+            tiledArgs->callerTLS = appPTR->getAppTLS()->takeSnapshot();
 
 
 #ifdef NATRON_HOSTFRAMETHREADING_SEQUENTIAL
@@ -1743,14 +1758,35 @@ EffectInstance::renderRoIInternal(double time,
 #else
 
 
-            QFuture<RenderingFunctorRetEnum> ret = QtConcurrent::mapped( planesToRender->rectsToRender,
-                                                                        boost::bind(&EffectInstance::Implementation::tiledRenderingFunctor,
-                                                                                    _imp.get(),
-                                                                                    *tiledArgs,
-                                                                                    _1,
-                                                                                    currentThread) );
-            ret.waitForFinished();
-            QFuture<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
+            ///Tiles are queued on the work-stealing scheduler. While waiting, this thread renders the tiles that no
+            ///worker has picked up yet, so this works even if all workers are busy (e.g. we are ourselves a tile of a
+            ///downstream node) and idle workers can steal the tiles of upstream nodes.
+            std::vector<EffectInstance::RenderingFunctorRetEnum> ret( planesToRender->rectsToRender.size(), eRenderingFunctorRetFailed );
+            std::vector<double> tilesTime(planesToRender->rectsToRender.size(), 0.);
+            {
+                TimeLapse timer;
+                TaskGroup tiles( appPTR->getTaskScheduler() );
+                int i = 0;
+                for (std::list<RectToRender>::const_iterator it = planesToRender->rectsToRender.begin(); it != planesToRender->rectsToRender.end(); ++it, ++i) {
+                    tiles.run( boost::bind(&EffectInstance::Implementation::tiledRenderingTask,
+                                           _imp.get(),
+                                           *tiledArgs,
+                                           &*it,
+                                           currentThread,
+                                           &ret[i],
+                                           &tilesTime[i]) );
+                }
+                if ( !tiles.wait() ) {
+                    renderStatus = eRenderingFunctorRetFailed;
+                } else if (autoThreadsBalancing) {
+                    double totalTilesTime = 0.;
+                    for (std::size_t t = 0; t < tilesTime.size(); ++t) {
+                        totalTilesTime += tilesTime[t];
+                    }
+                    _imp->reportTilesSpeedup( totalTilesTime, timer.getTimeSinceCreation() );
+                }
+            }
+            std::vector<EffectInstance::RenderingFunctorRetEnum>::const_iterator it2;
 
 #endif
             for (it2 = ret.begin(); it2 != ret.end(); ++it2) {
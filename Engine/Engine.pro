@@ -81,6 +81,7 @@ SOURCES += \
     BezierCP.cpp \
     BlockingBackgroundRender.cpp \
     Cache.cpp \
+    CachePackFile.cpp \
     CLArgs.cpp \
     CoonsRegularization.cpp \
     Curve.cpp \
@@ -99,6 +100,7 @@ SOURCES += \
     FrameParamsSerialization.cpp \
     GroupInput.cpp \
     GroupOutput.cpp \
+    Half.cpp \
     Hash64.cpp \
     HistogramCPU.cpp \
     Image.cpp \
@@ -108,6 +110,7 @@ SOURCES += \
     ImageKey.cpp \
     ImageMaskMix.cpp \
     ImageParamsSerialization.cpp \
+    ImageRow.cpp \
     Interpolation.cpp \
     Knob.cpp \
     KnobSerialization.cpp \
@@ -118,6 +121,8 @@ SOURCES += \
     Log.cpp \
     Lut.cpp \
     MemoryFile.cpp \
+    MipMapRow.cpp \
+    NativeExpression.cpp \
     Node.cpp \
     NodeGroup.cpp \
     NodeGroupWrapper.cpp \
@@ -148,12 +153,16 @@ SOURCES += \
     PySideCompat.cpp \
     RectD.cpp \
     RectI.cpp \
+    RenderDaemon.cpp \
     RenderStats.cpp \
+    RenderThreadsBalancer.cpp \
+    RenderWorkers.cpp \
     RotoContext.cpp \
     RotoDrawableItem.cpp \
     RotoItem.cpp \
     RotoLayer.cpp \
     RotoPaint.cpp \
+    RotoRasterizer.cpp \
     RotoSmear.cpp \
     RotoStrokeItem.cpp \
     RotoWrapper.cpp \
@@ -161,12 +170,14 @@ SOURCES += \
     Settings.cpp \
     StandardPaths.cpp \
     StringAnimationManager.cpp \
+    TaskScheduler.cpp \
     TextureRect.cpp \
     TimeLine.cpp \
     Timer.cpp \
     TLSHolder.cpp \
     Transform.cpp \
     ViewerInstance.cpp \
+    ViewerRowConverter.cpp \
     ../Global/ProcInfo.cpp \
     ../libs/SequenceParsing/SequenceParsing.cpp \
     NatronEngine/natronengine_module_wrapper.cpp \
@@ -227,6 +238,7 @@ HEADERS += \
     Cache.h \
     CacheEntry.h \
     CacheEntryHolder.h \
+    CachePackFile.h \
     CacheSerialization.h \
     CoonsRegularization.h \
     Curve.h \
@@ -253,6 +265,7 @@ HEADERS += \
     GlobalFunctionsWrapper.h \
     GroupInput.h \
     GroupOutput.h \
+    Half.h \
     Hash64.h \
     HistogramCPU.h \
     ImageInfo.h \
@@ -263,6 +276,7 @@ HEADERS += \
     ImageSerialization.h \
     ImageParams.h \
     ImageParamsSerialization.h \
+    ImageRow.h \
     Interpolation.h \
     KeyHelper.h \
     Knob.h \
@@ -278,6 +292,8 @@ HEADERS += \
     Lut.h \
     MemoryFile.h \
     MergingEnum.h \
+    MipMapRow.h \
+    NativeExpression.h \
     Node.h \
     NodeGroup.h \
     NodeGroupSerialization.h \
@@ -314,7 +330,10 @@ HEADERS += \
     RectDSerialization.h \
     RectI.h \
     RectISerialization.h \
+    RenderDaemon.h \
     RenderStats.h \
+    RenderThreadsBalancer.h \
+    RenderWorkers.h \
     RotoContext.h \
     RotoContextPrivate.h \
     RotoContextSerialization.h \
@@ -326,6 +345,7 @@ HEADERS += \
     RotoItemSerialization.h \
     RotoPaint.h \
     RotoPoint.h \
+    RotoRasterizer.h \
     RotoSmear.h \
     RotoStrokeItem.h \
     RotoStrokeItemSerialization.h \
@@ -335,6 +355,7 @@ HEADERS += \
     Singleton.h \
     StandardPaths.h \
     StringAnimationManager.h \
+    TaskScheduler.h \
     TextureRect.h \
     TextureRectSerialization.h \
     ThreadStorage.h \
@@ -348,6 +369,7 @@ HEADERS += \
     VariantSerialization.h \
     ViewerInstance.h \
     ViewerInstancePrivate.h \
+    ViewerRowConverter.h \
     ViewIdx.h \
     ../Global/Enums.h \
     ../Global/GitVersion.h \
@@ -106,6 +106,7 @@ class BufferableObject;
 class ButtonParam;
 class CLArgs;
 class CacheEntryHolder;
+class CachePackFile;
 class CacheSignalEmitter;
 struct CreateNodeArgs;
 class ChoiceExtraData;
@@ -156,6 +157,7 @@ class KnobSeparator;
 class KnobSerialization;
 class KnobString;
 class LibraryBinary;
+class NativeExpression;
 class Node;
 class NodeCollection;
 class NodeGroup;
@@ -191,6 +193,7 @@ class Project;
 class ProjectSerialization;
 class RectD;
 class RectI;
+class RenderDaemon;
 class RenderEngine;
 class RenderStats;
 class RenderingFlagSetter;
@@ -209,6 +212,7 @@ class Settings;
 class StringAnimationManager;
 class StringParam;
 class TLSHolderBase;
+class TaskScheduler;
 class TextureRect;
 class TimeLine;
 class UserParamHolder;
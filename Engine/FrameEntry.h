@@ -50,9 +50,8 @@ public:
     FrameEntry(const FrameKey & key,
                const boost::shared_ptr<FrameParams> &  params,
                const CacheAPI* cache,
-               StorageModeEnum storage,
-               const std::string & path)
-        : CacheEntryHelper<U8,FrameKey,FrameParams>(key,params,cache,storage,path)
+               StorageModeEnum storage)
+        : CacheEntryHelper<U8,FrameKey,FrameParams>(key,params,cache,storage)
         , _abortedMutex()
         , _aborted(false)
     {
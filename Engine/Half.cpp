@@ -0,0 +1,157 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Half.h"
+
+// F16C code is compiled for the functions that need it and only used if the CPU supports it
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#if defined(__clang__) || ( defined(__GNUC__) && ( ( (__GNUC__ * 100) + __GNUC_MINOR__ ) >= 409 ) )
+#define NATRON_HALF_F16C
+#define NATRON_HALF_F16C_FUNCTION __attribute__ ( ( target("avx,f16c") ) )
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (_MSC_VER >= 1800)
+#define NATRON_HALF_F16C
+#define NATRON_HALF_F16C_FUNCTION
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+NATRON_NAMESPACE_ENTER;
+
+#ifdef NATRON_HALF_F16C
+static bool
+cpuSupportsF16C()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 1);
+    // F16C works on the AVX registers, which the OS must save
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool f16c = (info[2] & (1 << 29)) != 0;
+
+    return osxsave && avx && f16c && ( (_xgetbv(0) & 6) == 6 );
+#else
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+#endif
+}
+
+static const bool f16cSupported = cpuSupportsF16C();
+
+NATRON_HALF_F16C_FUNCTION
+static void
+convertRowToFloat_F16C(const Half* from,
+                       float* to,
+                       int n)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps( to + i, _mm256_cvtph_ps( _mm_loadu_si128( (const __m128i*)(from + i) ) ) );
+    }
+    Half::convertRowToFloatScalar(from + i, to + i, n - i);
+}
+
+NATRON_HALF_F16C_FUNCTION
+static void
+convertRowFromFloat_F16C(const float* from,
+                         Half* to,
+                         int n)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_si128( (__m128i*)(to + i), _mm256_cvtps_ph(_mm256_loadu_ps(from + i), _MM_FROUND_TO_NEAREST_INT) );
+    }
+    Half::convertRowFromFloatScalar(from + i, to + i, n - i);
+}
+
+#endif // NATRON_HALF_F16C
+
+bool
+Half::isF16CSupported()
+{
+#ifdef NATRON_HALF_F16C
+
+    return f16cSupported;
+#else
+
+    return false;
+#endif
+}
+
+void
+Half::convertRowToFloatScalar(const Half* from,
+                              float* to,
+                              int n)
+{
+    for (int i = 0; i < n; ++i) {
+        to[i] = bitsToFloat(from[i]._bits);
+    }
+}
+
+void
+Half::convertRowFromFloatScalar(const float* from,
+                                Half* to,
+                                int n)
+{
+    for (int i = 0; i < n; ++i) {
+        to[i]._bits = floatToBits(from[i]);
+    }
+}
+
+void
+Half::convertRowToFloat(const Half* from,
+                        float* to,
+                        int n)
+{
+#ifdef NATRON_HALF_F16C
+    if (f16cSupported) {
+        convertRowToFloat_F16C(from, to, n);
+
+        return;
+    }
+#endif
+    convertRowToFloatScalar(from, to, n);
+}
+
+void
+Half::convertRowFromFloat(const float* from,
+                          Half* to,
+                          int n)
+{
+#ifdef NATRON_HALF_F16C
+    if (f16cSupported) {
+        convertRowFromFloat_F16C(from, to, n);
+
+        return;
+    }
+#endif
+    convertRowFromFloatScalar(from, to, n);
+}
+
+NATRON_NAMESPACE_EXIT;
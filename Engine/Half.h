@@ -0,0 +1,172 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_HALF_H
+#define NATRON_ENGINE_HALF_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <cstring> // for memcpy
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief A 16-bit IEEE 754 half-precision float, the pixel type of eImageBitDepthHalf images.
+ * It has 11 bits of precision (a relative error of at most 2^-11 after rounding) and covers [-65504, 65504],
+ * values beyond are converted to infinity. Conversions from float round to the nearest even, like OpenEXR and F16C do.
+ *
+ * A Half converts implicitly from and to float, so that the image processing templates instantiated
+ * for float pixels (maxValue = 1) can be instantiated for Half as well: all the arithmetic is done in float.
+ * Rows of pixels should rather be converted with convertRowToFloat() and convertRowFromFloat(), which use the
+ * F16C instructions when the CPU supports them.
+ **/
+class Half
+{
+public:
+
+    /// uninitialized, like the built-in types
+    Half()
+    {
+    }
+
+    Half(float f)
+        : _bits( floatToBits(f) )
+    {
+    }
+
+    operator float() const
+    {
+        return bitsToFloat(_bits);
+    }
+
+    unsigned short getBits() const
+    {
+        return _bits;
+    }
+
+    static Half fromBits(unsigned short bits)
+    {
+        Half h;
+
+        h._bits = bits;
+
+        return h;
+    }
+
+    /*
+     * The scalar conversions are the branch-light versions from F. Giesen,
+     * https://gist.github.com/rygorous/2156668 (public domain)
+     */
+    static unsigned short floatToBits(float f)
+    {
+        const U32 f32infty = 255U << 23;
+        const U32 f16max = (127U + 16U) << 23;
+        const U32 denormMagic = ( (127U - 15U) + (23U - 10U) + 1U ) << 23;
+        U32 u;
+
+        std::memcpy( &u, &f, sizeof(u) );
+        const U32 sign = u & 0x80000000U;
+        u ^= sign;
+
+        unsigned short o;
+        if (u >= f16max) {
+            // overflow to infinity, NaN stays NaN (quiet)
+            o = (u > f32infty) ? 0x7e00 : 0x7c00;
+        } else if ( u < (113U << 23) ) {
+            // the result is a denormal or zero: let the FPU do the rounding by adding a magic number
+            float v;
+            std::memcpy( &v, &u, sizeof(v) );
+            float magic;
+            std::memcpy( &magic, &denormMagic, sizeof(magic) );
+            v += magic;
+            std::memcpy( &u, &v, sizeof(u) );
+            o = (unsigned short)(u - denormMagic);
+        } else {
+            const U32 mantOdd = (u >> 13) & 1U;
+            // update the exponent and round to nearest even
+            u += ( (U32)(15 - 127) << 23 ) + 0xfffU;
+            u += mantOdd;
+            o = (unsigned short)(u >> 13);
+        }
+
+        return (unsigned short)( o | (sign >> 16) );
+    }
+
+    static float bitsToFloat(unsigned short h)
+    {
+        const U32 shiftedExp = 0x7c00U << 13;
+        U32 o = (h & 0x7fffU) << 13;
+        const U32 exp = shiftedExp & o;
+
+        o += (U32)(127 - 15) << 23;
+        if (exp == shiftedExp) {
+            // Inf/NaN
+            o += (U32)(128 - 16) << 23;
+        } else if (exp == 0) {
+            // zero or denormal: renormalize
+            o += 1U << 23;
+            float f;
+            std::memcpy( &f, &o, sizeof(f) );
+            const U32 magicBits = 113U << 23;
+            float magic;
+            std::memcpy( &magic, &magicBits, sizeof(magic) );
+            f -= magic;
+            std::memcpy( &o, &f, sizeof(o) );
+        }
+        o |= (U32)(h & 0x8000U) << 16;
+        float f;
+        std::memcpy( &f, &o, sizeof(f) );
+
+        return f;
+    }
+
+    /**
+     * @brief Returns true if the row conversions use the F16C instructions, detected once at startup.
+     * The results are the same either way, except for the payload of NaNs.
+     **/
+    static bool isF16CSupported();
+
+    /**
+     * @brief Converts n contiguous values
+     **/
+    static void convertRowToFloat(const Half* from, float* to, int n);
+
+    static void convertRowFromFloat(const float* from, Half* to, int n);
+
+    /**
+     * @brief Same as above without the F16C instructions. Only exposed for testing.
+     **/
+    static void convertRowToFloatScalar(const Half* from, float* to, int n);
+
+    static void convertRowFromFloatScalar(const float* from, Half* to, int n);
+
+private:
+
+    unsigned short _bits;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_HALF_H
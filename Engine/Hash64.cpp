@@ -24,45 +24,189 @@
 
 #include "Hash64.h"
 
-#include <algorithm>  // for std::for_each
 #include <cassert>
 #include <stdexcept>
 
-#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
-#include <boost/crc.hpp>
-#endif
 #include <QtCore/QString>
 
 #include "Engine/Node.h"
 
+///The primes of XXH64
+#define HASH64_PRIME1 0x9E3779B185EBCA87ULL
+#define HASH64_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define HASH64_PRIME3 0x165667B19E3779F9ULL
+#define HASH64_PRIME4 0x85EBCA77C2B2AE63ULL
+#define HASH64_PRIME5 0x27D4EB2F165667C5ULL
+
 NATRON_NAMESPACE_ENTER;
 
+static inline U64
+rotl64(U64 x,
+       int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline U64
+round64(U64 acc,
+        U64 input)
+{
+    acc += input * HASH64_PRIME2;
+    acc = rotl64(acc, 31);
+    acc *= HASH64_PRIME1;
+
+    return acc;
+}
+
+static inline U64
+mergeRound64(U64 acc,
+             U64 val)
+{
+    acc ^= round64(0, val);
+    acc = acc * HASH64_PRIME1 + HASH64_PRIME4;
+
+    return acc;
+}
+
+void
+Hash64::consumeStripe()
+{
+    assert(_stripeSize == 4);
+    _acc[0] = round64(_acc[0], _stripe[0]);
+    _acc[1] = round64(_acc[1], _stripe[1]);
+    _acc[2] = round64(_acc[2], _stripe[2]);
+    _acc[3] = round64(_acc[3], _stripe[3]);
+    _stripeSize = 0;
+    ++_nStripes;
+}
+
 void
 Hash64::computeHash()
 {
-    if ( node_values.empty() ) {
+    if ( (_nStripes == 0) && (_stripeSize == 0) ) {
         return;
     }
 
-    const unsigned char* data = reinterpret_cast<const unsigned char*>( &node_values.front() );
-    boost::crc_optimal<64,0x42F0E1EBA9EA3693ULL,0,0,false,false> crc_64;
-    crc_64 = std::for_each( data, data + node_values.size() * sizeof(node_values[0]), crc_64 );
-    hash = crc_64();
+    U64 h;
+    if (_nStripes > 0) {
+        h = rotl64(_acc[0], 1) + rotl64(_acc[1], 7) + rotl64(_acc[2], 12) + rotl64(_acc[3], 18);
+        for (int i = 0; i < 4; ++i) {
+            h = mergeRound64(h, _acc[i]);
+        }
+    } else {
+        h = HASH64_PRIME5;
+    }
+    h += (_nStripes * 4 + _stripeSize) * sizeof(U64);
+
+    for (unsigned int i = 0; i < _stripeSize; ++i) {
+        h ^= round64(0, _stripe[i]);
+        h = rotl64(h, 27) * HASH64_PRIME1 + HASH64_PRIME4;
+    }
+
+    ///Avalanche
+    h ^= h >> 33;
+    h *= HASH64_PRIME2;
+    h ^= h >> 29;
+    h *= HASH64_PRIME3;
+    h ^= h >> 32;
+
+    ///0 is reserved for invalid hashes
+    hash = h ? h : 1;
+}
+
+///Reads n bytes in little-endian order
+static inline U64
+readLE(const unsigned char* p,
+       int n)
+{
+    U64 v = 0;
+
+    for (int i = n - 1; i >= 0; --i) {
+        v = (v << 8) | p[i];
+    }
+
+    return v;
+}
+
+U64
+Hash64::xxh64(const void* data,
+              std::size_t size,
+              U64 seed)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* const end = p + size;
+    U64 h;
+
+    if (size >= 32) {
+        U64 acc[4] = { seed + HASH64_PRIME1 + HASH64_PRIME2, seed + HASH64_PRIME2, seed, seed - HASH64_PRIME1 };
+        for (; p + 32 <= end; p += 32) {
+            for (int i = 0; i < 4; ++i) {
+                acc[i] = round64( acc[i], readLE(p + i * 8, 8) );
+            }
+        }
+        h = rotl64(acc[0], 1) + rotl64(acc[1], 7) + rotl64(acc[2], 12) + rotl64(acc[3], 18);
+        for (int i = 0; i < 4; ++i) {
+            h = mergeRound64(h, acc[i]);
+        }
+    } else {
+        h = seed + HASH64_PRIME5;
+    }
+    h += (U64)size;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= round64( 0, readLE(p, 8) );
+        h = rotl64(h, 27) * HASH64_PRIME1 + HASH64_PRIME4;
+    }
+    if (p + 4 <= end) {
+        h ^= readLE(p, 4) * HASH64_PRIME1;
+        h = rotl64(h, 23) * HASH64_PRIME2 + HASH64_PRIME3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= (*p) * HASH64_PRIME5;
+        h = rotl64(h, 11) * HASH64_PRIME1;
+    }
+
+    ///Avalanche
+    h ^= h >> 33;
+    h *= HASH64_PRIME2;
+    h ^= h >> 29;
+    h *= HASH64_PRIME3;
+    h ^= h >> 32;
+
+    return h;
 }
 
 void
 Hash64::reset()
 {
-    node_values.clear();
     hash = 0;
+    _acc[0] = HASH64_PRIME1 + HASH64_PRIME2;
+    _acc[1] = HASH64_PRIME2;
+    _acc[2] = 0;
+    _acc[3] = 0ULL - HASH64_PRIME1;
+    _stripeSize = 0;
+    _nStripes = 0;
 }
 
 void
 Hash64_appendQString(Hash64* hash,
                      const QString & str)
 {
-    for (int i = 0; i < str.size(); ++i) {
-        hash->append<unsigned short>( str.at(i).unicode() );
+    ///Pack 4 UTF-16 code units per word, the length disambiguates consecutive strings
+    const ushort* data = str.utf16();
+    int size = str.size();
+    hash->append<int>(size);
+    int i = 0;
+    for (; i + 4 <= size; i += 4) {
+        hash->append<U64>( (U64)data[i] | ( (U64)data[i + 1] << 16 ) | ( (U64)data[i + 2] << 32 ) | ( (U64)data[i + 3] << 48 ) );
+    }
+    if (i < size) {
+        U64 last = 0;
+        for (int shift = 0; i < size; ++i, shift += 16) {
+            last |= (U64)data[i] << shift;
+        }
+        hash->append<U64>(last);
     }
 }
 
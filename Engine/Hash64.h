@@ -25,6 +25,7 @@
 #include <Python.h>
 // ***** END PYTHON BLOCK *****
 
+#include <cstddef>
 #include <vector>
 #if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
 #include <boost/static_assert.hpp>
@@ -35,9 +36,13 @@
 
 NATRON_NAMESPACE_ENTER;
 
-/*The hash of a Node is the checksum of the vector of data containing:
+/*The hash of a Node is the checksum of the data containing:
     - the values of the current knob for this node + the name of the node
     - the hash values for the  tree upstream
+
+   Values are widened to 64-bit words and streamed into the state of the hash as they are appended:
+   this is XXH64 over the sequence of words, without keeping any intermediate buffer. Changing what is
+   appended or how it is hashed changes the keys of the cached images: increment NATRON_CACHE_VERSION.
  */
 
 class Hash64
@@ -45,12 +50,7 @@ class Hash64
 public:
     Hash64()
     {
-        hash = 0;
-    }
-
-    ~Hash64()
-    {
-        node_values.clear();
+        reset();
     }
 
     U64 value() const
@@ -58,6 +58,10 @@ public:
         return hash;
     }
 
+    /**
+     * @brief Computes the hash of all the values appended since the last reset(). More values may be
+     * appended afterwards, the hash must then be computed again.
+     **/
     void computeHash();
 
     void reset();
@@ -67,6 +71,13 @@ public:
         return hash != 0;
     }
 
+    /**
+     * @brief Returns the XXH64 hash of a buffer with the given seed. computeHash() gives the same value as this function
+     * over the appended words stored in little-endian order with the seed 0, which the tests check against the
+     * reference values of XXH64.
+     **/
+    static U64 xxh64(const void* data, std::size_t size, U64 seed);
+
     template<typename T>
     static U64 toU64(T value)
     {
@@ -82,7 +93,10 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
     template<typename T>
     void append(T value)
     {
-        node_values.push_back( toU64(value) );
+        _stripe[_stripeSize++] = toU64(value);
+        if (_stripeSize == 4) {
+            consumeStripe();
+        }
     }
 
     bool operator== (const Hash64 & h) const
@@ -111,8 +125,14 @@ private:
         };
     };
 
+    ///Mixes the 4 buffered words in the accumulators
+    void consumeStripe();
+
     U64 hash;
-    std::vector<U64> node_values;
+    U64 _acc[4]; //< the accumulators of the 32 bytes stripes
+    U64 _stripe[4]; //< words not yet mixed in the accumulators
+    unsigned int _stripeSize;
+    U64 _nStripes;
 };
 
 void Hash64_appendQString(Hash64* hash, const QString & str);
@@ -31,7 +31,13 @@
 #include <QMutex>
 #include <QWaitCondition>
 
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+
 #include "Engine/Image.h"
+#include "Engine/ImageRow.h"
 
 NATRON_NAMESPACE_ENTER;
 
@@ -260,31 +266,118 @@ struct pix_lum
 };
 
 
+///The histograms of a request are computed in one pass over the image: the bands of rows are counted
+///in parallel in local histograms which are then summed.
+struct HistogramReduction
+{
+    const float* pixels; // the first pixel of the rect
+    int rowElements;
+    int nComps;
+    RectI rect;
+    double vmin, vmax;
+    std::vector<int> modes; // the mode of each histogram, one of A, Y, R, G or B
+    int binsCount;
+    QMutex lock;
+    std::vector<unsigned int> counts; // binsCount counts for each mode
+};
+
 template <float pix_func(const float*)>
 void
-computeHisto(const HistogramRequest & request,
-             int upscale,
-             std::vector<float> *histo)
+countHistoRow(const HistogramReduction & reduction,
+              const float* pix,
+              unsigned int* counts)
+{
+    const double binSize = (reduction.vmax - reduction.vmin) / reduction.binsCount;
+
+    for (int x = 0; x < reduction.rect.width(); ++x, pix += reduction.nComps) {
+        float v = pix_func(pix);
+        if ( (reduction.vmin <= v) && (v < reduction.vmax) ) {
+            int index = (int)( (v - reduction.vmin) / binSize );
+            assert( 0 <= index && index < reduction.binsCount );
+            ++counts[index];
+        }
+    }
+}
+
+static void
+countHistoRows(HistogramReduction* reduction,
+               int y1,
+               int y2)
+{
+    const int nHistos = (int)reduction->modes.size();
+    std::vector<unsigned int> counts(reduction->counts.size(), 0);
+
+    for (int y = y1; y < y2; ++y) {
+        const float* pix = reduction->pixels + (std::size_t)(y - reduction->rect.y1) * reduction->rowElements;
+        for (int h = 0; h < nHistos; ++h) {
+            unsigned int* histoCounts = &counts[h * reduction->binsCount];
+            switch (reduction->modes[h]) {
+            case 1:     //< A
+                countHistoRow<&pix_alpha::val>(*reduction, pix, histoCounts);
+                break;
+            case 2:     //<Y
+                countHistoRow<&pix_lum::val>(*reduction, pix, histoCounts);
+                break;
+            case 3:     //< R
+                countHistoRow<&pix_red::val>(*reduction, pix, histoCounts);
+                break;
+            case 4:     //< G
+                countHistoRow<&pix_green::val>(*reduction, pix, histoCounts);
+                break;
+            case 5:     //< B
+                countHistoRow<&pix_blue::val>(*reduction, pix, histoCounts);
+                break;
+            default:
+                assert(false);
+                break;
+            }
+        }
+    }
+
+    QMutexLocker l(&reduction->lock);
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        reduction->counts[i] += counts[i];
+    }
+}
+
+/**
+ * @brief Computes for each mode the histogram of request with binsCount * upscale bins.
+ **/
+static void
+computeHistos(const HistogramRequest & request,
+              const std::vector<int> & modes,
+              int upscale,
+              std::vector<std::vector<float> > *histos)
 {
-    assert(histo);
-    histo->resize(request.binsCount * upscale);
-    std::fill(histo->begin(), histo->end(), 0.f);
-    double binSize = (request.vmax - request.vmin) / histo->size();
+    HistogramReduction reduction;
+
+    reduction.rect = request.rect;
+    reduction.vmin = request.vmin;
+    reduction.vmax = request.vmax;
+    reduction.modes = modes;
+    reduction.binsCount = request.binsCount * upscale;
+    reduction.counts.resize(modes.size() * reduction.binsCount, 0);
 
     ///Images come from the viewer which is in float.
     assert(request.image->getBitDepth() == eImageBitDepthFloat);
 
-    Image::ReadAccess acc = request.image->getReadRights();
-    
-    for (int y = request.rect.bottom(); y < request.rect.top(); ++y) {
-        for (int x = request.rect.left(); x < request.rect.right(); ++x) {
-            const float *pix = (const float*)acc.pixelAt(x, y);
-            float v = pix_func(pix);
-            if ( (request.vmin <= v) && (v < request.vmax) ) {
-                int index = (int)( (v - request.vmin) / binSize );
-                assert( 0 <= index && index < (int)histo->size() );
-                (*histo)[index] += 1.f;
-            }
+    if ( !request.rect.isNull() ) {
+        ///the lock is held by this thread while the bands read the pixels
+        Image::ReadAccess acc = request.image->getReadRights();
+        reduction.pixels = (const float*)acc.pixelAt( request.rect.left(), request.rect.bottom() );
+        reduction.nComps = request.image->getComponentsCount();
+        reduction.rowElements = request.image->getBounds().width() * reduction.nComps;
+        assert(reduction.pixels);
+        ImageRow::processRowBands( request.rect, boost::bind(&countHistoRows, &reduction, _1, _2) );
+    }
+
+    histos->resize( modes.size() );
+    for (std::size_t h = 0; h < modes.size(); ++h) {
+        std::vector<float>& histo = (*histos)[h];
+        histo.resize(reduction.binsCount);
+        for (int i = 0; i < reduction.binsCount; ++i) {
+            // the bins used to be incremented as floats, which stops at 2^24
+            histo[i] = (float)std::min(reduction.counts[h * reduction.binsCount + i], 1U << 24);
         }
     }
 }
@@ -426,64 +519,11 @@ iir_1d_filter(SrcIterator src,
 } // iir_1d_filter
 
 static void
-computeHistogramStatic(const HistogramRequest & request,
-                       boost::shared_ptr<FinishedHistogram> ret,
-                       int histogramIndex)
+smoothHistogram(const HistogramRequest & request,
+                int upscale,
+                std::vector<float> & histo_upscaled,
+                std::vector<float> *histo)
 {
-    const int upscale = 5;
-    std::vector<float> *histo = 0;
-
-    switch (histogramIndex) {
-    case 1:
-        histo = &ret->histogram1;
-        break;
-    case 2:
-        histo = &ret->histogram2;
-        break;
-    case 3:
-        histo = &ret->histogram3;
-        break;
-    default:
-        break;
-    }
-    assert(histo);
-    if (!histo) {
-        return;
-    }
-
-    /// keep the mode parameter in sync with Histogram::DisplayModeEnum
-
-    int mode = request.mode;
-
-    ///if the mode is RGB, adjust the mode to either R,G or B depending on the histogram index
-    if (mode == 0) {
-        mode = histogramIndex + 2;
-    }
-
-    ret->pixelsCount = request.rect.area();
-    // a histogram with upscale more bins
-    std::vector<float> histo_upscaled;
-    switch (mode) {
-    case 1:     //< A
-        computeHisto<&pix_alpha::val>(request, upscale, &histo_upscaled);
-        break;
-    case 2:     //<Y
-        computeHisto<&pix_lum::val>(request, upscale, &histo_upscaled);
-        break;
-    case 3:     //< R
-        computeHisto<&pix_red::val>(request, upscale, &histo_upscaled);
-        break;
-    case 4:     //< G
-        computeHisto<&pix_green::val>(request, upscale, &histo_upscaled);
-        break;
-    case 5:     //< B
-        computeHisto<&pix_blue::val>(request, upscale, &histo_upscaled);
-        break;
-
-    default:
-        assert(false);
-        break;
-    }
     double sigma = upscale;
     if (request.smoothingKernelSize > 1) {
         sigma *= request.smoothingKernelSize;
@@ -508,6 +548,35 @@ computeHistogramStatic(const HistogramRequest & request,
             std::advance (it_in,upscale);
         }
     }
+} // smoothHistogram
+
+static void
+computeHistogramStatic(const HistogramRequest & request,
+                       boost::shared_ptr<FinishedHistogram> ret)
+{
+    const int upscale = 5;
+
+    /// keep the mode parameter in sync with Histogram::DisplayModeEnum
+
+    ///if the mode is RGB, the 3 histograms are R, G and B
+    std::vector<int> modes;
+    if (request.mode == 0) {
+        modes.push_back(3);
+        modes.push_back(4);
+        modes.push_back(5);
+    } else {
+        modes.push_back(request.mode);
+    }
+
+    ret->pixelsCount = request.rect.area();
+    // histograms with upscale more bins
+    std::vector<std::vector<float> > histos_upscaled;
+    computeHistos(request, modes, upscale, &histos_upscaled);
+
+    std::vector<float>* histos[3] = { &ret->histogram1, &ret->histogram2, &ret->histogram3 };
+    for (std::size_t h = 0; h < modes.size(); ++h) {
+        smoothHistogram(request, upscale, histos_upscaled[h], histos[h]);
+    }
 } // computeHistogramStatic
 
 void
@@ -548,16 +617,12 @@ HistogramCPU::run()
 
         switch (request.mode) {
         case 0:     //< RGB
-            computeHistogramStatic(request, ret, 1);
-            computeHistogramStatic(request, ret, 2);
-            computeHistogramStatic(request, ret, 3);
-            break;
         case 1:
         case 2:
         case 3:
         case 4:
         case 5:
-            computeHistogramStatic(request, ret, 1);
+            computeHistogramStatic(request, ret);
             break;
         default:
             assert(false);     //< unknown case.
@@ -30,7 +30,14 @@
 
 #include <QDebug>
 
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+
 #include "Engine/AppManager.h"
+#include "Engine/ImageRow.h"
+#include "Engine/MipMapRow.h"
 
 NATRON_NAMESPACE_ENTER;
 
@@ -38,171 +45,353 @@ NATRON_NAMESPACE_ENTER;
 
 #define PIXEL_UNAVAILABLE 2
 
-template <int trimap>
-RectI minimalNonMarkedBbox_internal(const RectI& roi, const RectI& _bounds,const std::vector<char>& _map,
-                                    bool* isBeingRenderedElsewhere)
+///State of a tile whose pixels are not all in the same state. Any other value is the state shared by all its pixels.
+#define TILE_MIXED 3
+
+void
+Bitmap::initialize(const RectI & bounds)
 {
-    RectI bbox;
-    assert(_bounds.contains(roi));
-    bbox = roi;
-    
-    //find bottom
-    for (int i = bbox.bottom(); i < bbox.top(); ++i) {
-        const char* buf = BM_GET(i, bbox.left());
-        
-        if (trimap) {
-            
-            const char* lineEnd = buf + bbox.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (!*buf) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE) {
-                    metUnavailablePixel = true;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else if (metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
-                ++bbox.y1;
+    _bounds = bounds;
+    _map.resize( _bounds.area() );
+    std::fill(_map.begin(), _map.end(), 0);
+
+    if ( _bounds.isNull() ) {
+        _tilesPerRow = 0;
+        _tiles.clear();
+    } else {
+        _tilesPerRow = (_bounds.width() + NATRON_BITMAP_TILE_SIZE - 1) / NATRON_BITMAP_TILE_SIZE;
+        int tilesPerColumn = (_bounds.height() + NATRON_BITMAP_TILE_SIZE - 1) / NATRON_BITMAP_TILE_SIZE;
+        _tiles.resize(_tilesPerRow * tilesPerColumn);
+    }
+    std::fill(_tiles.begin(), _tiles.end(), 0);
+}
+
+void
+Bitmap::setTo1()
+{
+    std::fill(_map.begin(), _map.end(), 1);
+    std::fill(_tiles.begin(), _tiles.end(), 1);
+}
+
+RectI
+Bitmap::getTileRect(int tx,
+                    int ty) const
+{
+    RectI ret;
+
+    ret.x1 = _bounds.x1 + tx * NATRON_BITMAP_TILE_SIZE;
+    ret.y1 = _bounds.y1 + ty * NATRON_BITMAP_TILE_SIZE;
+    ret.x2 = std::min(ret.x1 + NATRON_BITMAP_TILE_SIZE, _bounds.x2);
+    ret.y2 = std::min(ret.y1 + NATRON_BITMAP_TILE_SIZE, _bounds.y2);
+
+    return ret;
+}
+
+int
+Bitmap::getPixelsContent(const RectI & roi) const
+{
+    const int allFlags = eContentFlagUnrendered | eContentFlagRendered | eContentFlagBeingRendered;
+    int content = 0;
+    const char* row = BM_GET(roi.bottom(), roi.left());
+    int w = _bounds.width();
+    int roiw = roi.width();
+
+    for (int i = roi.y1; i < roi.y2 && content != allFlags; ++i, row += w) {
+        const char* rowEnd = row + roiw;
+        for (const char* pix = row; pix < rowEnd; ++pix) {
+            content |= 1 << *pix;
+        }
+    }
+
+    return content;
+}
+
+static char
+tileStateFromContent(int content)
+{
+    switch (content) {
+    case Bitmap::eContentFlagUnrendered:
+        return 0;
+    case Bitmap::eContentFlagRendered:
+        return 1;
+    case Bitmap::eContentFlagBeingRendered:
+        return PIXEL_UNAVAILABLE;
+    default:
+        return TILE_MIXED;
+    }
+}
+
+void
+Bitmap::updateTile(int tx,
+                   int ty)
+{
+    _tiles[ty * _tilesPerRow + tx] = tileStateFromContent( getPixelsContent( getTileRect(tx, ty) ) );
+}
+
+int
+Bitmap::getContent(const RectI & roi) const
+{
+    const int allFlags = eContentFlagUnrendered | eContentFlagRendered | eContentFlagBeingRendered;
+
+    if ( roi.isNull() ) {
+        return 0;
+    }
+    assert( _bounds.contains(roi) );
+
+    int tx1 = (roi.x1 - _bounds.x1) / NATRON_BITMAP_TILE_SIZE;
+    int tx2 = (roi.x2 - 1 - _bounds.x1) / NATRON_BITMAP_TILE_SIZE;
+    int ty1 = (roi.y1 - _bounds.y1) / NATRON_BITMAP_TILE_SIZE;
+    int ty2 = (roi.y2 - 1 - _bounds.y1) / NATRON_BITMAP_TILE_SIZE;
+    int content = 0;
+
+    for (int ty = ty1; ty <= ty2; ++ty) {
+        const char* tile = &_tiles[ty * _tilesPerRow + tx1];
+        for (int tx = tx1; tx <= tx2; ++tx, ++tile) {
+            if (*tile != TILE_MIXED) {
+                content |= 1 << *tile;
             } else {
-                ++bbox.y1;
+                ///Only scan the pixels of tiles that are partially rendered
+                RectI tileRoi;
+                getTileRect(tx, ty).intersect(roi, &tileRoi);
+                content |= getPixelsContent(tileRoi);
             }
-        } else {
-            
-            const char* lineEnd = buf + bbox.width();
-            while (buf < lineEnd) {
-                if (!*buf || *buf == PIXEL_UNAVAILABLE) {
-                    buf = 0;
-                    break;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else {
-                ++bbox.y1;
+            if (content == allFlags) {
+                return content;
             }
         }
     }
-    
-    //find top (will do zero iteration if the bbox is already empty)
-    for (int i = bbox.top() - 1; i >= bbox.bottom(); --i) {
-        const char* buf = BM_GET(i, bbox.left());
-        
-        if (trimap) {
-            
-            const char* lineEnd = buf + bbox.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (!*buf) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE) {
-                    metUnavailablePixel = true;
-                }
-                ++buf;
-            }
-            if (!buf) {
-                break;
-            } else if (metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag if the whole row is not 0
-                --bbox.y2;
-            } else {
-                --bbox.y2;
+
+    return content;
+}
+
+void
+Bitmap::updateTiles(const RectI & roi)
+{
+    RectI intersection;
+
+    if ( !roi.intersect(_bounds, &intersection) ) {
+        return;
+    }
+
+    int tx1 = (intersection.x1 - _bounds.x1) / NATRON_BITMAP_TILE_SIZE;
+    int tx2 = (intersection.x2 - 1 - _bounds.x1) / NATRON_BITMAP_TILE_SIZE;
+    int ty1 = (intersection.y1 - _bounds.y1) / NATRON_BITMAP_TILE_SIZE;
+    int ty2 = (intersection.y2 - 1 - _bounds.y1) / NATRON_BITMAP_TILE_SIZE;
+
+    for (int ty = ty1; ty <= ty2; ++ty) {
+        for (int tx = tx1; tx <= tx2; ++tx) {
+            char & state = _tiles[ty * _tilesPerRow + tx];
+            RectI tileRect = getTileRect(tx, ty);
+            RectI written;
+            tileRect.intersect(intersection, &written);
+            char writtenState = tileStateFromContent( getPixelsContent(written) );
+            if ( written == tileRect ) {
+                state = writtenState;
+            } else if (state != writtenState) {
+                ///Do not scan the rest of the tile: this is called for each row by the conversion functions
+                state = TILE_MIXED;
             }
-            
-        } else {
-            
-            const char* lineEnd = buf + bbox.width();
-            while (buf < lineEnd) {
-                if (!*buf || *buf == PIXEL_UNAVAILABLE) {
-                    buf = 0;
-                    break;
-                }
-                ++buf;
+        }
+    }
+}
+
+void
+Bitmap::fill(const RectI & roi,
+             char value)
+{
+    if ( roi.isNull() ) {
+        return;
+    }
+    assert( _bounds.contains(roi) );
+
+    char* buf = BM_GET(roi.bottom(), roi.left());
+    int w = _bounds.width();
+    int roiw = roi.width();
+    for (int i = roi.y1; i < roi.y2; ++i, buf += w) {
+        memset( buf, value, roiw );
+    }
+
+    int tx1 = (roi.x1 - _bounds.x1) / NATRON_BITMAP_TILE_SIZE;
+    int tx2 = (roi.x2 - 1 - _bounds.x1) / NATRON_BITMAP_TILE_SIZE;
+    int ty1 = (roi.y1 - _bounds.y1) / NATRON_BITMAP_TILE_SIZE;
+    int ty2 = (roi.y2 - 1 - _bounds.y1) / NATRON_BITMAP_TILE_SIZE;
+
+    for (int ty = ty1; ty <= ty2; ++ty) {
+        for (int tx = tx1; tx <= tx2; ++tx) {
+            char & state = _tiles[ty * _tilesPerRow + tx];
+            if (state == value) {
+                continue;
             }
-            if (!buf) {
-                break;
+            if ( roi.contains( getTileRect(tx, ty) ) ) {
+                state = value;
             } else {
-                --bbox.y2;
+                ///The tile is only partially covered: rescan it so that tiles rendered in several passes become uniform again
+                updateTile(tx, ty);
             }
         }
     }
-    
-    // avoid making bbox.width() iterations for nothing
-    if ( bbox.isNull() ) {
-        return bbox;
+}
+
+namespace {
+
+enum BitmapSideEnum
+{
+    eBitmapSideBottom = 0,
+    eBitmapSideTop,
+    eBitmapSideLeft,
+    eBitmapSideRight
+};
+
+/*
+ * Returns the rows (or columns) of rect on the given side, up to the next tile boundary or just one if singleLine is true.
+ */
+RectI
+getBitmapBand(const RectI & bounds,
+              const RectI & rect,
+              BitmapSideEnum side,
+              bool singleLine)
+{
+    RectI band = rect;
+
+    switch (side) {
+    case eBitmapSideBottom:
+        band.y2 = singleLine ? rect.y1 + 1 :
+                  std::min( rect.y2, bounds.y1 + ( (rect.y1 - bounds.y1) / NATRON_BITMAP_TILE_SIZE + 1 ) * NATRON_BITMAP_TILE_SIZE );
+        break;
+    case eBitmapSideTop:
+        band.y1 = singleLine ? rect.y2 - 1 :
+                  std::max( rect.y1, bounds.y1 + ( (rect.y2 - 1 - bounds.y1) / NATRON_BITMAP_TILE_SIZE ) * NATRON_BITMAP_TILE_SIZE );
+        break;
+    case eBitmapSideLeft:
+        band.x2 = singleLine ? rect.x1 + 1 :
+                  std::min( rect.x2, bounds.x1 + ( (rect.x1 - bounds.x1) / NATRON_BITMAP_TILE_SIZE + 1 ) * NATRON_BITMAP_TILE_SIZE );
+        break;
+    case eBitmapSideRight:
+        band.x1 = singleLine ? rect.x2 - 1 :
+                  std::max( rect.x1, bounds.x1 + ( (rect.x2 - 1 - bounds.x1) / NATRON_BITMAP_TILE_SIZE ) * NATRON_BITMAP_TILE_SIZE );
+        break;
     }
-    
-    //find left
-    for (int j = bbox.left(); j < bbox.right(); ++j) {
-        const char* pix = BM_GET(bbox.bottom(), j);
 
-        bool metUnavailablePixel = false;
+    return band;
+}
 
-        for (int i = bbox.bottom(); i < bbox.top(); ++i, pix += _bounds.width()) {
-            if (!*pix) {
-                pix = 0;
-                break;
+void
+removeBitmapBand(const RectI & band,
+                 BitmapSideEnum side,
+                 RectI* rect)
+{
+    switch (side) {
+    case eBitmapSideBottom:
+        rect->y1 = band.y2;
+        break;
+    case eBitmapSideTop:
+        rect->y2 = band.y1;
+        break;
+    case eBitmapSideLeft:
+        rect->x1 = band.x2;
+        break;
+    case eBitmapSideRight:
+        rect->x2 = band.x1;
+        break;
+    }
+}
+
+/*
+ * When shrinking a rectangle to the bounding box of the pixels to render (removeRendered = 1), a band can be
+ * removed if it has no pixel to render. When looking for the bands around that bounding box that are entirely
+ * to render (removeRendered = 0), a band can be removed if it has no rendered pixel.
+ * In trimap mode, pixels being rendered elsewhere are not to render but flag isBeingRenderedElsewhere.
+ */
+template <int trimap, int removeRendered>
+bool
+canRemoveBitmapBand(int content,
+                    bool* isBeingRenderedElsewhere)
+{
+    if (removeRendered) {
+        if (trimap) {
+            if (content & Bitmap::eContentFlagUnrendered) {
+                return false;
             }
-            
-            else if (*pix == PIXEL_UNAVAILABLE) {
-                if (trimap) {
-                    metUnavailablePixel = true;
-                } else {
-                    pix = 0;
-                    break;
-                }
+            if (content & Bitmap::eContentFlagBeingRendered) {
+                *isBeingRenderedElsewhere = true; //< only flag if the whole band is not 0
             }
-            
+
+            return true;
         }
-        if (pix) {
-            ++bbox.x1;
-            if (trimap && metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
-            }
-        } else {
-            break;
+
+        return !( content & (Bitmap::eContentFlagUnrendered | Bitmap::eContentFlagBeingRendered) );
+    } else {
+        if (trimap) {
+            return !( content & (Bitmap::eContentFlagRendered | Bitmap::eContentFlagBeingRendered) );
         }
-    }
-    
-    //find right
-    for (int j = bbox.right() - 1; j >= bbox.left(); --j) {
-        const char* pix = BM_GET(bbox.bottom(), j);
 
-        bool metUnavailablePixel = false;
+        return !(content & Bitmap::eContentFlagRendered);
+    }
+}
 
-        for (int i = bbox.bottom(); i < bbox.top(); ++i, pix += _bounds.width()) {
-            if (!*pix) {
-                pix = 0;
-                break;
-            }
+/*
+ * Removes the rows (or columns) of rect on the given side as long as canRemoveBitmapBand() allows it.
+ * Whole tile bands are tested at once and only the band where the search stops is tested row by row.
+ */
+template <int trimap, int removeRendered>
+void
+shrinkBitmapRect(const Bitmap & bm,
+                 BitmapSideEnum side,
+                 RectI* rect,
+                 bool* isBeingRenderedElsewhere)
+{
+    while ( !rect->isNull() ) {
+        RectI band = getBitmapBand(bm.getBounds(), *rect, side, false);
+        if ( canRemoveBitmapBand<trimap, removeRendered>(bm.getContent(band), isBeingRenderedElsewhere) ) {
+            removeBitmapBand(band, side, rect);
+            continue;
+        }
 
-            else if (*pix == PIXEL_UNAVAILABLE) {
-                if (trimap) {
-                    metUnavailablePixel = true;
-                } else {
-                    pix = 0;
-                    break;
+        // One of the lines of the band stops the search, find it
+        for (;;) {
+            RectI line = getBitmapBand(bm.getBounds(), *rect, side, true);
+            int content = bm.getContent(line);
+            if ( !canRemoveBitmapBand<trimap, removeRendered>(content, isBeingRenderedElsewhere) ) {
+                if ( trimap && !removeRendered && (content & Bitmap::eContentFlagBeingRendered) ) {
+                    *isBeingRenderedElsewhere = true;
                 }
-            }
 
-        }
-        if (pix) {
-            --bbox.x2;
-            if (trimap && metUnavailablePixel) {
-                *isBeingRenderedElsewhere = true; //< only flag is the whole column is not 0
+                return;
             }
-
-        } else {
-            break;
+            removeBitmapBand(line, side, rect);
         }
     }
-    
+}
+
+} // anon namespace
+
+template <int trimap>
+RectI
+minimalNonMarkedBbox_internal(const RectI& roi,
+                              const Bitmap& bm,
+                              bool* isBeingRenderedElsewhere)
+{
+    RectI bbox;
+    assert(bm.getBounds().contains(roi));
+    bbox = roi;
+
+    //find bottom
+    shrinkBitmapRect<trimap, 1>(bm, eBitmapSideBottom, &bbox, isBeingRenderedElsewhere);
+
+    //find top (will do zero iteration if the bbox is already empty)
+    shrinkBitmapRect<trimap, 1>(bm, eBitmapSideTop, &bbox, isBeingRenderedElsewhere);
+
+    // avoid making bbox.width() iterations for nothing
+    if ( bbox.isNull() ) {
+        return bbox;
+    }
+
+    //find left
+    shrinkBitmapRect<trimap, 1>(bm, eBitmapSideLeft, &bbox, isBeingRenderedElsewhere);
+
+    //find right
+    shrinkBitmapRect<trimap, 1>(bm, eBitmapSideRight, &bbox, isBeingRenderedElsewhere);
+
     return bbox;
 
 }
@@ -210,9 +399,12 @@ RectI minimalNonMarkedBbox_internal(const RectI& roi, const RectI& _bounds,const
 
 template <int trimap>
 void
-minimalNonMarkedRects_internal(const RectI & roi,const RectI& _bounds, const std::vector<char>& _map,
+minimalNonMarkedRects_internal(const RectI & roi,
+                               const Bitmap& bm,
                                std::list<RectI>& ret,bool* isBeingRenderedElsewhere)
 {
+    const RectI& _bounds = bm.getBounds();
+
     ///Any out of bounds portion is pushed to the rectangles to render
     RectI intersection;
     roi.intersect(_bounds, &intersection);
@@ -246,7 +438,7 @@ minimalNonMarkedRects_internal(const RectI & roi,const RectI& _bounds, const std
         return;
     }
     
-    RectI bboxM = minimalNonMarkedBbox_internal<trimap>(intersection, _bounds, _map, isBeingRenderedElsewhere);
+    RectI bboxM = minimalNonMarkedBbox_internal<trimap>(intersection, bm, isBeingRenderedElsewhere);
     assert((trimap && isBeingRenderedElsewhere) || (!trimap && !isBeingRenderedElsewhere));
     
     //#define NATRON_BITMAP_DISABLE_OPTIMIZATION
@@ -284,41 +476,8 @@ minimalNonMarkedRects_internal(const RectI & roi,const RectI& _bounds, const std
     //find bottom
     RectI bboxX = bboxM;
     RectI bboxA = bboxX;
-    bboxA.set_top( bboxX.bottom() );
-    for (int i = bboxX.bottom(); i < bboxX.top(); ++i) {
-        const char* buf = BM_GET(i, bboxX.left());
-        if (trimap) {
-            const char* lineEnd = buf + bboxX.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (*buf == 1) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE && trimap) {
-                    buf = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-                ++buf;
-            }
-            if (buf) {
-                ++bboxX.y1;
-                bboxA.y2 = bboxX.y1;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        } else {
-            if ( !memchr( buf, 1, bboxX.width() ) ) {
-                ++bboxX.y1;
-                bboxA.y2 = bboxX.y1;
-            } else {
-                break;
-            }
-        }
-    }
+    shrinkBitmapRect<trimap, 0>(bm, eBitmapSideBottom, &bboxX, isBeingRenderedElsewhere);
+    bboxA.y2 = bboxX.y1;
     if ( !bboxA.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxA);
     }
@@ -326,112 +485,25 @@ minimalNonMarkedRects_internal(const RectI & roi,const RectI& _bounds, const std
     // Now, find the "B" rectangle
     //find top
     RectI bboxB = bboxX;
-    bboxB.set_bottom( bboxX.top() );
-    for (int i = bboxX.top() - 1; i >= bboxX.bottom(); --i) {
-        const char* buf = BM_GET(i, bboxX.left());
-        
-        if (trimap) {
-            const char* lineEnd = buf + bboxX.width();
-            bool metUnavailablePixel = false;
-            while (buf < lineEnd) {
-                if (*buf == 1) {
-                    buf = 0;
-                    break;
-                } else if (*buf == PIXEL_UNAVAILABLE && trimap) {
-                    buf = 0;
-                    metUnavailablePixel = true;
-                    break;
-                }
-                ++buf;
-            }
-            if (buf) {
-                --bboxX.y2;
-                bboxB.y1 = bboxX.y2;
-            } else {
-                if (metUnavailablePixel) {
-                    *isBeingRenderedElsewhere = true;
-                }
-                break;
-            }
-        } else {
-            if ( !memchr( buf, 1, bboxX.width() ) ) {
-                --bboxX.y2;
-                bboxB.y1 = bboxX.y2;
-            } else {
-                break;
-            }
-            
-        }
-    }
+    shrinkBitmapRect<trimap, 0>(bm, eBitmapSideTop, &bboxX, isBeingRenderedElsewhere);
+    bboxB.y1 = bboxX.y2;
     if ( !bboxB.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxB);
     }
     
-	//find left
-	RectI bboxC = bboxX;
-	bboxC.set_right( bboxX.left() );
-	if (bboxX.bottom() < bboxX.top()) {
-		for (int j = bboxX.left(); j < bboxX.right(); ++j) {
-			const char* pix = BM_GET(bboxX.bottom(), j);
-
-			bool metUnavailablePixel = false;
-
-			for (int i = bboxX.bottom(); i < bboxX.top(); ++i, pix += _bounds.width()) {
-				if (*pix == 1) {
-					pix = 0;
-					break;
-				} else if (trimap && *pix == PIXEL_UNAVAILABLE) {
-					pix = 0;
-					metUnavailablePixel = true;
-					break;
-				}
-			}
-			if (pix) {
-                ++bboxX.x1;
-                bboxC.x2 = bboxX.x1;
-			} else {
-				if (metUnavailablePixel) {
-					*isBeingRenderedElsewhere = true;
-				}
-				break;
-			}
-		}
-	}
+    //find left
+    RectI bboxC = bboxX;
+    shrinkBitmapRect<trimap, 0>(bm, eBitmapSideLeft, &bboxX, isBeingRenderedElsewhere);
+    bboxC.x2 = bboxX.x1;
     if ( !bboxC.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxC);
     }
 
-	//find right
-	RectI bboxD = bboxX;
-	bboxD.set_left( bboxX.right() );
-	if (bboxX.bottom() < bboxX.top()) {
-		for (int j = bboxX.right() - 1; j >= bboxX.left(); --j) {
-			const char* pix = BM_GET(bboxX.bottom(), j);
-
-			bool metUnavailablePixel = false;
-
-			for (int i = bboxX.bottom(); i < bboxX.top(); ++i, pix += _bounds.width()) {
-				if (*pix == 1) {
-					pix = 0;
-					break;
-				} else if (trimap && *pix == PIXEL_UNAVAILABLE) {
-					pix = 0;
-					metUnavailablePixel = true;
-					break;
-				}
-			}
-			if (pix) {
-                --bboxX.x2;
-                bboxD.x1 = bboxX.x2;
-			} else {
-				if (metUnavailablePixel) {
-					*isBeingRenderedElsewhere = true;
-				}
-				break;
-			}
-		}
-	}
-	if ( !bboxD.isNull() ) { // empty boxes should not be pushed
+    //find right
+    RectI bboxD = bboxX;
+    shrinkBitmapRect<trimap, 0>(bm, eBitmapSideRight, &bboxX, isBeingRenderedElsewhere);
+    bboxD.x1 = bboxX.x2;
+    if ( !bboxD.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxD);
     }
     
@@ -456,7 +528,7 @@ minimalNonMarkedRects_internal(const RectI & roi,const RectI& _bounds, const std
     assert( bboxD.bottom() == bboxX.bottom() );
     
     // get the bounding box of what's left (the X rectangle in the drawing above)
-    bboxX = minimalNonMarkedBbox_internal<trimap>(bboxX,_bounds,_map,isBeingRenderedElsewhere);
+    bboxX = minimalNonMarkedBbox_internal<trimap>(bboxX,bm,isBeingRenderedElsewhere);
     
     if ( !bboxX.isNull() ) { // empty boxes should not be pushed
         ret.push_back(bboxX);
@@ -474,9 +546,9 @@ Bitmap::minimalNonMarkedBbox(const RectI & roi) const
         if (!roi.intersect(_dirtyZone, &realRoi)) {
             return RectI();
         }
-        return minimalNonMarkedBbox_internal<0>(realRoi, _bounds, _map, NULL);
+        return minimalNonMarkedBbox_internal<0>(realRoi, *this, NULL);
     } else {
-        return minimalNonMarkedBbox_internal<0>(roi, _bounds, _map, NULL);
+        return minimalNonMarkedBbox_internal<0>(roi, *this, NULL);
     }
 }
 
@@ -488,9 +560,9 @@ Bitmap::minimalNonMarkedRects(const RectI & roi,std::list<RectI>& ret) const
         if (!roi.intersect(_dirtyZone, &realRoi)) {
             return;
         }
-        minimalNonMarkedRects_internal<0>(realRoi, _bounds, _map,ret , NULL);
+        minimalNonMarkedRects_internal<0>(realRoi, *this, ret , NULL);
     } else {
-        minimalNonMarkedRects_internal<0>(roi, _bounds, _map,ret , NULL);
+        minimalNonMarkedRects_internal<0>(roi, *this, ret , NULL);
     }
 }
 
@@ -504,9 +576,9 @@ Bitmap::minimalNonMarkedBbox_trimap(const RectI & roi,bool* isBeingRenderedElsew
             *isBeingRenderedElsewhere = false;
             return RectI();
         }
-        return minimalNonMarkedBbox_internal<1>(realRoi, _bounds, _map, isBeingRenderedElsewhere);
+        return minimalNonMarkedBbox_internal<1>(realRoi, *this, isBeingRenderedElsewhere);
     } else {
-        return minimalNonMarkedBbox_internal<1>(roi, _bounds, _map, isBeingRenderedElsewhere);
+        return minimalNonMarkedBbox_internal<1>(roi, *this, isBeingRenderedElsewhere);
     }
 }
 
@@ -520,9 +592,9 @@ Bitmap::minimalNonMarkedRects_trimap(const RectI & roi,std::list<RectI>& ret,boo
             *isBeingRenderedElsewhere = false;
             return;
         }
-        minimalNonMarkedRects_internal<1>(realRoi, _bounds, _map ,ret , isBeingRenderedElsewhere);
+        minimalNonMarkedRects_internal<1>(realRoi, *this ,ret , isBeingRenderedElsewhere);
     } else {
-        minimalNonMarkedRects_internal<1>(roi, _bounds, _map ,ret , isBeingRenderedElsewhere);
+        minimalNonMarkedRects_internal<1>(roi, *this ,ret , isBeingRenderedElsewhere);
     }
 } 
 #endif
@@ -530,42 +602,29 @@ Bitmap::minimalNonMarkedRects_trimap(const RectI & roi,std::list<RectI>& ret,boo
 void
 Bitmap::markForRendered(const RectI & roi)
 {
-    char* buf = BM_GET(roi.bottom(), roi.left());
-    int w = _bounds.width();
-    int roiw = roi.width();
-    for (int i = roi.y1; i < roi.y2; ++i, buf += w) {
-        memset( buf, 1, roiw);
-    }
+    fill(roi, 1);
 }
 
 #if NATRON_ENABLE_TRIMAP
 void
 Bitmap::markForRendering(const RectI & roi)
 {
-    char* buf = BM_GET(roi.bottom(), roi.left());
-    int w = _bounds.width();
-    int roiw = roi.width();
-    for (int i = roi.y1; i < roi.y2; ++i, buf += w) {
-        memset( buf, PIXEL_UNAVAILABLE , roiw );
-    }
+    fill(roi, PIXEL_UNAVAILABLE);
 }
 #endif
 
 void
 Bitmap::clear(const RectI& roi)
 {
-    char* buf = BM_GET(roi.bottom(), roi.left());
-    int w = _bounds.width();
-    int roiw = roi.width();
-    for (int i = roi.y1; i < roi.y2; ++i, buf += w) {
-        memset( buf, 0 , roiw );
-    }
+    fill(roi, 0);
 }
 
 void
 Bitmap::swap(Bitmap& other)
 {
     _map.swap(other._map);
+    _tiles.swap(other._tiles);
+    std::swap(_tilesPerRow, other._tilesPerRow);
     _bounds = other._bounds;
     _dirtyZone.clear();//merge(other._dirtyZone);
     _dirtyZoneSet = false;
@@ -662,9 +721,8 @@ Image::printUnrenderedPixels(const RectI& roi) const
 Image::Image(const ImageKey & key,
              const boost::shared_ptr<ImageParams>& params,
              const CacheAPI* cache,
-             StorageModeEnum storage,
-             const std::string & path)
-    : CacheEntryHelper<unsigned char, ImageKey,ImageParams>(key, params, cache,storage,path)
+             StorageModeEnum storage)
+    : CacheEntryHelper<unsigned char, ImageKey,ImageParams>(key, params, cache,storage)
     , _useBitmap(true)
 {
     _bitDepth = params->getBitDepth();
@@ -676,7 +734,7 @@ Image::Image(const ImageKey & key,
 
 Image::Image(const ImageKey & key,
              const boost::shared_ptr<ImageParams>& params)
-: CacheEntryHelper<unsigned char, ImageKey,ImageParams>(key, params, NULL,eStorageModeRAM,std::string())
+: CacheEntryHelper<unsigned char, ImageKey,ImageParams>(key, params, NULL,eStorageModeRAM)
 , _useBitmap(false)
 {
     _bitDepth = params->getBitDepth();
@@ -713,8 +771,7 @@ Image::Image(const ImageComponents& components,
                                                                    components,
                                                                    std::map<int, std::map<int,std::vector<RangeD> > >() ) ),
                   NULL,
-                  eStorageModeRAM,
-                  std::string()
+                  eStorageModeRAM
                   );
 
     _bitDepth = bitdepth;
@@ -836,7 +893,7 @@ Image::pasteFromForDepth(const Image & srcImg,
     ///Cannot copy images with different bit depth, this is not the purpose of this function.
     ///@see convert
     assert( getBitDepth() == srcImg.getBitDepth() );
-    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
+    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthHalf && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
     // NOTE: before removing the following asserts, please explain why an empty image may happen
     
     QWriteLocker k(&_entryLock);
@@ -918,7 +975,7 @@ Image::resizeInternal(const Image* srcImg,
     } else {
         boost::shared_ptr<ImageParams> params(new ImageParams(*srcImg->getParams()));
         params->setBounds(merge);
-        outputImage->reset(new Image(srcImg->getKey(), params, srcImg->getCacheAPI(), eStorageModeRAM,std::string()));
+        outputImage->reset(new Image(srcImg->getKey(), params, srcImg->getCacheAPI(), eStorageModeRAM));
         (*outputImage)->allocateMemory();
     }
     ImageBitDepthEnum depth = srcImg->getBitDepth();
@@ -974,6 +1031,7 @@ Image::resizeInternal(const Image* srcImg,
                 char* bm = wacc.bitmapAt(aRect.x1, aRect.y1);
                 assert(bm);
                 memset(bm, 1, a);
+                (*outputImage)->_bitmap.updateTiles(aRect);
             }
         }
         if (!cRect.isNull()) {
@@ -986,6 +1044,7 @@ Image::resizeInternal(const Image* srcImg,
                 char* bm = (char*)wacc.bitmapAt(cRect.x1, cRect.y1);
                 assert(bm);
                 memset(bm, 1, a);
+                (*outputImage)->_bitmap.updateTiles(cRect);
             }
         }
         if (!bRect.isNull()) {
@@ -1005,6 +1064,9 @@ Image::resizeInternal(const Image* srcImg,
                     bm += mw;
                 }
             }
+            if (bm) {
+                (*outputImage)->_bitmap.updateTiles(bRect);
+            }
         }
         if (!dRect.isNull()) {
             char* pix = (char*)wacc.pixelAt(dRect.x1, dRect.y1);
@@ -1023,6 +1085,9 @@ Image::resizeInternal(const Image* srcImg,
                     bm += mw;
                 }
             }
+            if (bm) {
+                (*outputImage)->_bitmap.updateTiles(dRect);
+            }
         }
         
         
@@ -1037,7 +1102,7 @@ Image::resizeInternal(const Image* srcImg,
             (*outputImage)->pasteFromForDepth<unsigned short>(*srcImg, srcBounds, srcImg->usesBitMap(), false);
             break;
         case eImageBitDepthHalf:
-            assert(false);
+            (*outputImage)->pasteFromForDepth<Half>(*srcImg, srcBounds, srcImg->usesBitMap(), false);
             break;
         case eImageBitDepthFloat:
             (*outputImage)->pasteFromForDepth<float>(*srcImg, srcBounds, srcImg->usesBitMap(), false);
@@ -1114,7 +1179,7 @@ Image::pasteFrom(const Image & src,
         pasteFromForDepth<unsigned short>(src, srcRoi, copyBitmap, true);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        pasteFromForDepth<Half>(src, srcRoi, copyBitmap, true);
         break;
     case eImageBitDepthFloat:
         pasteFromForDepth<float>(src, srcRoi, copyBitmap, true);
@@ -1132,7 +1197,7 @@ Image::fillForDepthForComponents(const RectI & roi_,
                                  float b,
                                  float a)
 {
-    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
+    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthHalf && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
     
     RectI roi = roi_;
     bool doInteresect = roi.intersect(_bounds, &roi);
@@ -1212,7 +1277,7 @@ Image::fill(const RectI & roi,
         fillForDepth<unsigned short, 65535>(roi, r, g, b, a);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        fillForDepth<Half, 1>(roi, r, g, b, a);
         break;
     case eImageBitDepthFloat:
         fillForDepth<float, 1>(roi, r, g, b, a);
@@ -1453,6 +1518,7 @@ Image::halveRoIForDepth(const RectI & roi,
 {
     assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) ||
            (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) ||
+           (getBitDepth() == eImageBitDepthHalf && sizeof(PIX) == 2) ||
            (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
 
     ///handle case where there is only 1 column/row
@@ -1469,11 +1535,8 @@ Image::halveRoIForDepth(const RectI & roi,
 
     ///The source rectangle, intersected to this image region of definition in pixels
     const RectI &srcBounds = _bounds;
-    const RectI &dstBounds = output->_bounds;
-    const RectI &srcBmBounds = _bitmap.getBounds();
-    const RectI &dstBmBounds = output->_bitmap.getBounds();
     assert(!copyBitMap || usesBitMap());
-    assert(!usesBitMap() ||(srcBmBounds == srcBounds && dstBmBounds == dstBounds));
+    assert( !usesBitMap() || ( _bitmap.getBounds() == srcBounds && output->_bitmap.getBounds() == output->_bounds ) );
 
     // the srcRoD of the output should be enclosed in half the roi.
     // It does not have to be exactly half of the input.
@@ -1485,7 +1548,6 @@ Image::halveRoIForDepth(const RectI & roi,
     //           dstRoD.height()*2 <= roi.height());
     assert( getComponents() == output->getComponents() );
 
-    int nComponents = getComponents().getNumComponents();
     RectI dstRoI;
     RectI srcRoI = roi;
     srcRoI.intersect(srcBounds, &srcRoI); // intersect srcRoI with the region of definition
@@ -1495,9 +1557,32 @@ Image::halveRoIForDepth(const RectI & roi,
     dstRoI.x2 = std::ceil(srcRoI.x2 / 2.);
     dstRoI.y2 = std::ceil(srcRoI.y2 / 2.);
 
-    
-  
-    
+    ///Large levels are split in bands of rows halved in parallel, the bands write to distinct rows of output
+    ImageRow::processRowBands( dstRoI, boost::bind(&Image::halveRowsForDepth<PIX, maxValue>, this, dstRoI, _1, _2, copyBitMap, output) );
+
+    if (copyBitMap) {
+        output->_bitmap.updateTiles(dstRoI);
+    }
+} // halveRoIForDepth
+
+template <typename PIX, int maxValue>
+void
+Image::halveRowsForDepth(const RectI & dstRoI,
+                         int y1,
+                         int y2,
+                         bool copyBitMap,
+                         Image* output) const
+{
+    const RectI &srcBounds = _bounds;
+    const RectI &dstBounds = output->_bounds;
+    const RectI &srcBmBounds = _bitmap.getBounds();
+    const RectI &dstBmBounds = output->_bitmap.getBounds();
+    const int nComponents = getComponents().getNumComponents();
+
+    ///The destination columns whose 2x2 block is entirely inside the source image, done by MipMap::halveRow
+    const int fastX1 = std::max( dstRoI.x1, (int)std::ceil(srcBounds.x1 / 2.) );
+    const int fastX2 = std::min( dstRoI.x2, (int)std::floor(srcBounds.x2 / 2.) );
+
     const PIX* const srcPixels      = (const PIX*)pixelAt(srcBounds.x1,   srcBounds.y1);
     const char* const srcBmPixels   = _bitmap.getBitmapAt(srcBmBounds.x1, srcBmBounds.y1);
     PIX* const dstPixels          = (PIX*)output->pixelAt(dstBounds.x1,   dstBounds.y1);
@@ -1516,7 +1601,7 @@ Image::halveRoIForDepth(const RectI & roi,
     const char* const srcBmData = srcBmPixels - (srcBmBounds.x1 + srcBmRowSize * srcBmBounds.y1);
     char* const dstBmData       = dstBmPixels - (dstBmBounds.x1 + dstBmRowSize * dstBmBounds.y1);
 
-    for (int y = dstRoI.y1; y < dstRoI.y2; ++y) {
+    for (int y = y1; y < y2; ++y) {
         const PIX* const srcLineStart    = srcData + y * 2 * srcRowSize;
         PIX* const dstLineStart          = dstData + y     * dstRowSize;
         const char* const srcBmLineStart = srcBmData + y * 2 * srcBmRowSize;
@@ -1530,8 +1615,20 @@ Image::halveRoIForDepth(const RectI & roi,
 
         int sumH = (int)pickNextRow + (int)pickThisRow;
         assert(sumH == 1 || sumH == 2);
-        
+
+        const bool fastRow = sumH == 2 && fastX1 < fastX2;
+        if (fastRow) {
+            MipMap::halveRow(srcLineStart + fastX1 * 2 * nComponents, srcLineStart + srcRowSize + fastX1 * 2 * nComponents,
+                             nComponents, fastX2 - fastX1, dstLineStart + fastX1 * nComponents);
+        }
+
         for (int x = dstRoI.x1; x < dstRoI.x2; ++x) {
+            ///the pixels of the interior were computed by MipMap::halveRow, only their bitmap is left to do
+            const bool pixelsDone = fastRow && (x >= fastX1) && (x < fastX2);
+            if (pixelsDone && !copyBitMap) {
+                x = fastX2 - 1;
+                continue;
+            }
             const PIX* const srcPixStart    = srcLineStart   + x * 2 * nComponents;
             const char* const srcBmPixStart = srcBmLineStart + x * 2;
             PIX* const dstPixStart          = dstLineStart   + x * nComponents;
@@ -1558,14 +1655,14 @@ Image::halveRoIForDepth(const RectI & roi,
                 continue;
             }
 
-            for (int k = 0; k < nComponents; ++k) {
+            for (int k = 0; k < nComponents && !pixelsDone; ++k) {
                 ///a b
                 ///c d
 
-                const PIX a = (pickThisCol && pickThisRow) ? *(srcPixStart + k) : 0;
-                const PIX b = (pickNextCol && pickThisRow) ? *(srcPixStart + k + nComponents) : 0;
-                const PIX c = (pickThisCol && pickNextRow) ? *(srcPixStart + k + srcRowSize): 0;
-                const PIX d = (pickNextCol && pickNextRow) ? *(srcPixStart + k + srcRowSize  + nComponents)  : 0;
+                const PIX a = (pickThisCol && pickThisRow) ? *(srcPixStart + k) : PIX(0);
+                const PIX b = (pickNextCol && pickThisRow) ? *(srcPixStart + k + nComponents) : PIX(0);
+                const PIX c = (pickThisCol && pickNextRow) ? *(srcPixStart + k + srcRowSize): PIX(0);
+                const PIX d = (pickNextCol && pickNextRow) ? *(srcPixStart + k + srcRowSize  + nComponents)  : PIX(0);
                 
                 assert(sumW == 2 || (sumW == 1 && ((a == 0 && c == 0) || (b == 0 && d == 0))));
                 assert(sumH == 2 || (sumH == 1 && ((a == 0 && b == 0) || (c == 0 && d == 0))));
@@ -1607,8 +1704,7 @@ Image::halveRoIForDepth(const RectI & roi,
             }
         }
     }
-
-} // halveRoIForDepth
+} // halveRowsForDepth
 
 // code proofread and fixed by @devernay on 8/8/2014
 void
@@ -1624,7 +1720,7 @@ Image::halveRoI(const RectI & roi,
         halveRoIForDepth<unsigned short,65535>(roi,copyBitMap, output);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        halveRoIForDepth<Half,1>(roi,copyBitMap,output);
         break;
     case eImageBitDepthFloat:
         halveRoIForDepth<float,1>(roi,copyBitMap,output);
@@ -1707,7 +1803,7 @@ Image::halve1DImage(const RectI & roi,
         halve1DImageForDepth<unsigned short, 65535>(roi, output);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        halve1DImageForDepth<Half, 1>(roi, output);
         break;
     case eImageBitDepthFloat:
         halve1DImageForDepth<float, 1>(roi, output);
@@ -1796,7 +1892,7 @@ Image::upscaleMipMapForDepth(const RectI & roi,
                              Image* output) const
 {
     assert( getBitDepth() == output->getBitDepth() );
-    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
+    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthHalf && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
 
     ///You should not call this function with a level equal to 0.
     assert(fromLevel > toLevel);
@@ -1884,7 +1980,7 @@ Image::upscaleMipMap(const RectI & roi,
         upscaleMipMapForDepth<unsigned short, 65535>(roi, fromLevel, toLevel, output);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        upscaleMipMapForDepth<Half,1>(roi, fromLevel, toLevel, output);
         break;
     case eImageBitDepthFloat:
         upscaleMipMapForDepth<float,1>(roi, fromLevel, toLevel, output);
@@ -1903,7 +1999,7 @@ Image::scaleBoxForDepth(const RectI & roi,
                         Image* output) const
 {
     assert( getBitDepth() == output->getBitDepth() );
-    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
+    assert( (getBitDepth() == eImageBitDepthByte && sizeof(PIX) == 1) || (getBitDepth() == eImageBitDepthShort && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthHalf && sizeof(PIX) == 2) || (getBitDepth() == eImageBitDepthFloat && sizeof(PIX) == 4) );
 
     
     QWriteLocker k1(&output->_entryLock);
@@ -2137,7 +2233,7 @@ Image::scaleBox(const RectI & roi,
         scaleBoxForDepth<unsigned short>(roi, output);
         break;
     case eImageBitDepthHalf:
-        assert(false);
+        scaleBoxForDepth<Half>(roi, output);
         break;
     case eImageBitDepthFloat:
         scaleBoxForDepth<float>(roi, output);
@@ -2248,7 +2344,7 @@ Bitmap::copyRowPortion(int x1,int x2,int y,const Bitmap& other)
         ++dstBitmap;
         ++srcBitmap;
     }
-    
+    updateTiles( RectI(x1, y, x2, y + 1) );
 }
 
 void
@@ -2283,74 +2379,65 @@ Bitmap::copyBitmapPortion(const RectI& roi, const Bitmap& other)
             ++dstCur;
         }
     }
+    updateTiles(roi);
 }
 
-template <typename PIX, bool doPremult>
+template <typename PIX>
 void
-Image::premultInternal(const RectI& roi)
+Image::premultRows(const RectI& roi,
+                   int y1,
+                   int y2,
+                   bool doPremult)
 {
-
-    
-    WriteAccess acc(this);
-    
-    RectI renderWindow;
-    roi.intersect(_bounds, &renderWindow);
-    
-    assert(getComponentsCount() == 4);
-    
-    int srcRowElements = 4 * _bounds.width();
-    
-    PIX* dstPix = (PIX*)acc.pixelAt(renderWindow.x1, renderWindow.y1);
-    for (int y = renderWindow.y1; y < renderWindow.y2; ++y, dstPix += (srcRowElements - (renderWindow.x2 - renderWindow.x1) * 4)) {
-        for (int x = renderWindow.x1; x < renderWindow.x2; ++x, dstPix += 4) {
-            for (int c = 0; c < 3; ++c) {
-                if (doPremult) {
-                    dstPix[c] = PIX(float(dstPix[c]) * dstPix[3]);
-                } else {
-                    if (dstPix[3] != 0) {
-                        dstPix[c] = PIX(dstPix[c] / float(dstPix[3]));
-                    }
-                }
-            }
-        }
+    for (int y = y1; y < y2; ++y) {
+        ImageRow::premultRow( doPremult, roi.width(), (PIX*)pixelAt(roi.x1, y) );
     }
 }
 
-
-template <bool doPremult>
 void
-Image::premultForDepth(const RectI& roi)
+Image::premultInternal(const RectI& roi,
+                       bool doPremult)
 {
     if (getComponentsCount() != 4) {
         return;
     }
-    ImageBitDepthEnum depth = getBitDepth();
-    switch (depth) {
+
+    WriteAccess acc(this);
+
+    RectI renderWindow;
+    if ( !roi.intersect(_bounds, &renderWindow) ) {
+        return;
+    }
+
+    ///The rows are processed in parallel bands for large rois, the lock is held by this thread
+    switch ( getBitDepth() ) {
         case eImageBitDepthByte:
-            premultInternal<unsigned char, doPremult>(roi);
+            ImageRow::processRowBands( renderWindow, boost::bind(&Image::premultRows<unsigned char>, this, renderWindow, _1, _2, doPremult) );
             break;
         case eImageBitDepthShort:
-            premultInternal<unsigned short, doPremult>(roi);
+            ImageRow::processRowBands( renderWindow, boost::bind(&Image::premultRows<unsigned short>, this, renderWindow, _1, _2, doPremult) );
+            break;
+        case eImageBitDepthHalf:
+            ImageRow::processRowBands( renderWindow, boost::bind(&Image::premultRows<Half>, this, renderWindow, _1, _2, doPremult) );
             break;
         case eImageBitDepthFloat:
-            premultInternal<float, doPremult>(roi);
+            ImageRow::processRowBands( renderWindow, boost::bind(&Image::premultRows<float>, this, renderWindow, _1, _2, doPremult) );
             break;
         default:
             break;
     }
 }
 
-
 void
 Image::premultImage(const RectI& roi)
 {
-    premultForDepth<true>(roi);
+    premultInternal(roi, true);
 }
 
 void
 Image::unpremultImage(const RectI& roi)
 {
-    premultForDepth<false>(roi);
+    premultInternal(roi, false);
 }
 
 NATRON_NAMESPACE_EXIT;
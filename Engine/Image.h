@@ -37,6 +37,7 @@ CLANG_DIAG_OFF(deprecated)
 CLANG_DIAG_ON(deprecated)
 #include <QtCore/QReadWriteLock>
 
+#include "Engine/Half.h"
 #include "Engine/ImageKey.h"
 #include "Engine/ImageComponents.h"
 #include "Engine/ImageParams.h"
@@ -60,12 +61,34 @@ public:
     }
 };
 
+//Side of the square tiles in which the Bitmap summarizes the state of its pixels
+#define NATRON_BITMAP_TILE_SIZE 64
+
+/**
+ * @brief Tracks for each pixel of an image whether it is rendered (1), not rendered (0) or being rendered
+ * by another thread (2, trimap only).
+ * The state of each pixel is stored in a byte map so it can be copied along the image, but queries do not walk it:
+ * the bitmap is divided in tiles of NATRON_BITMAP_TILE_SIZE pixels and each tile records whether all of its pixels
+ * are in the same state. Only tiles that mix several states are scanned, so the cost of minimalNonMarkedRects()
+ * is proportional to the number of tiles in the RoI plus the pixels of partially rendered tiles.
+ **/
 class Bitmap
 {
 public:
+
+    ///Bits returned by getContent()
+    enum ContentFlagEnum
+    {
+        eContentFlagUnrendered = 0x1,
+        eContentFlagRendered = 0x2,
+        eContentFlagBeingRendered = 0x4
+    };
+
     Bitmap(const RectI & bounds)
-    : _bounds(bounds)
-    , _map( bounds.area() )
+    : _bounds()
+    , _map()
+    , _tiles()
+    , _tilesPerRow(0)
     , _dirtyZone()
     , _dirtyZoneSet(false)
     {
@@ -73,34 +96,27 @@ public:
         // "identities" images (i.e: images that are just a link to another image). See EffectInstance :
         // "!!!Note that if isIdentity is true it will allocate an empty image object with 0 bytes of data."
         //assert(!rod.isNull());
-        std::fill(_map.begin(), _map.end(), 0);
+        initialize(bounds);
     }
 
     Bitmap()
     : _bounds()
     , _map()
+    , _tiles()
+    , _tilesPerRow(0)
     , _dirtyZone()
     , _dirtyZoneSet(false)
     {
     }
 
-    void initialize(const RectI & bounds)
-    {
-        _bounds = bounds;
-        _map.resize( _bounds.area() );
-
-        std::fill(_map.begin(), _map.end(), 0);
-    }
+    void initialize(const RectI & bounds);
 
     ~Bitmap()
     {
     }
 
 
-    void setTo1()
-    {
-        std::fill(_map.begin(),_map.end(),1);
-    }
+    void setTo1();
 
     const RectI & getBounds() const
     {
@@ -128,6 +144,17 @@ public:
 
     void swap(Bitmap& other);
 
+    /**
+     * @brief Returns a combination of ContentFlagEnum describing the pixels in roi, which must be contained in the bounds.
+     **/
+    int getContent(const RectI& roi) const;
+
+    /**
+     * @brief Must be called after the pixels in roi were modified through the pointers returned by getBitmap()
+     * or getBitmapAt() so that the tiles reflect them again.
+     **/
+    void updateTiles(const RectI& roi);
+
     const char* getBitmap() const
     {
         return &_map.front();
@@ -151,9 +178,23 @@ public:
     }
 
 private:
+
+    ///Fills the roi with the given pixel state and updates the tiles it covers
+    void fill(const RectI& roi, char value);
+
+    RectI getTileRect(int tx, int ty) const;
+
+    int getPixelsContent(const RectI& roi) const;
+
+    void updateTile(int tx, int ty);
+
     RectI _bounds;
     std::vector<char> _map;
 
+    ///For each tile, the state shared by all of its pixels or eTileStateMixed
+    std::vector<char> _tiles;
+    int _tilesPerRow;
+
     /**
      * This represents the zone that has potentially something to render. In minimalNonMarkedRects
      * we intersect the region of interest with the dirty zone. This is useful to optimize the bitmap checking
@@ -172,8 +213,7 @@ public:
     Image(const ImageKey & key,
           const boost::shared_ptr<ImageParams> &  params,
           const CacheAPI* cache,
-          StorageModeEnum storage,
-          const std::string & path);
+          StorageModeEnum storage);
 
 
 
@@ -797,10 +837,13 @@ private:
                                bool requiresUnpremult,
                                Image* dstImg) const;
 
-    template <typename PIX, bool doPremult>
-    void premultInternal(const RectI& roi);
-    template <bool doPremult>
-    void premultForDepth(const RectI& roi);
+    void premultInternal(const RectI& roi, bool doPremult);
+
+    /**
+     * @brief Premultiplies or unpremultiplies the rows [y1,y2) of roi. The locks must be held by the caller.
+     **/
+    template <typename PIX>
+    void premultRows(const RectI& roi, int y1, int y2, bool doPremult);
 
 
 public:
@@ -845,88 +888,30 @@ public:
 
 private:
 
-    template<int srcNComps, int dstNComps, typename PIX, int maxValue, bool masked, bool maskInvert>
-    void applyMaskMixForMaskInvert(const RectI& roi,
-                                   const Image* maskImg,
-                                   const Image* originalImg,
-                                   float mix);
-
-
-    template<int srcNComps, int dstNComps, typename PIX, int maxValue, bool masked>
-    void applyMaskMixForMasked(const RectI& roi,
-                               const Image* maskImg,
-                               const Image* originalImg,
-                               bool maskInvert,
-                               float mix);
-
-    template<int srcNComps, int dstNComps, typename PIX, int maxValue>
-    void applyMaskMixForDepth(const RectI& roi,
-                              const Image* maskImg,
-                              const Image* originalImg,
-                              bool masked,
-                              bool maskInvert,
-                              float mix);
-
-
-
-    template<int srcNComps, int dstNComps>
-    void applyMaskMixForDstComponents(const RectI& roi,
-                                      const Image* maskImg,
-                                      const Image* originalImg,
-                                      bool masked,
-                                      bool maskInvert,
-                                      float mix);
-
-    template<int srcNComps>
-    void applyMaskMixForSrcComponents(const RectI& roi,
-                                      const Image* maskImg,
-                                      const Image* originalImg,
-                                      bool masked,
-                                      bool maskInvert,
-                                      float mix);
-
-    template <typename PIX, int maxValue, int srcNComps, int dstNComps, bool doR, bool doG, bool doB, bool doA, bool premult, bool originalPremult>
-    void copyUnProcessedChannelsForPremult(std::bitset<4> processChannels,
-                                           const RectI& roi,
-                                           const boost::shared_ptr<Image>& originalImage);
-
-    template <typename PIX, int maxValue, int srcNComps, int dstNComps>
-    void copyUnProcessedChannelsForPremult(bool premult, bool originalPremult,
-                                           std::bitset<4> processChannels,
-                                           const RectI& roi,
-                                           const boost::shared_ptr<Image>& originalImage);
-
-    template <typename PIX, int maxValue, int srcNComps, int dstNComps, bool doR, bool doG, bool doB, bool doA>
-    void copyUnProcessedChannelsForChannels(std::bitset<4> processChannels,
-                                            bool premult,
-                                            const RectI& roi,
-                                            const boost::shared_ptr<Image>& originalImage,
-                                            bool originalPremult);
-
-    template <typename PIX, int maxValue, int srcNComps, int dstNComps>
-    void copyUnProcessedChannelsForChannels(std::bitset<4> processChannels,
-                                            bool premult,
-                                            const RectI& roi,
-                                            const boost::shared_ptr<Image>& originalImage,
-                                            bool originalPremult);
-
-
-
-    template <typename PIX, int maxValue,int srcNComps, int dstNComps>
-    void copyUnProcessedChannelsForComponents(bool premult,
-                                              const RectI& roi,
-                                              std::bitset<4> processChannels,
-                                              const boost::shared_ptr<Image>& originalImage,
-                                              bool originalPremult);
-
-    template <typename PIX, int maxValue>
-    void copyUnProcessedChannelsForDepth(bool premult,
-                                         const RectI& roi,
-                                         std::bitset<4> processChannels,
-                                         const boost::shared_ptr<Image>& originalImage,
-                                         bool originalPremult);
-
+    /**
+     * @brief Applies the mask and mix to the rows [y1,y2) of roi. The locks must be held by the caller.
+     **/
+    template <typename PIX>
+    void applyMaskMixRows(const RectI& roi,
+                          int y1,
+                          int y2,
+                          const Image* maskImg,
+                          const Image* originalImg,
+                          bool masked,
+                          bool maskInvert,
+                          float mix);
 
+    /**
+     * @brief Copies the unprocessed channels of originalImage to the rows [y1,y2) of roi. The locks must be held by the caller.
+     **/
+    template <typename PIX>
+    void copyUnProcessedChannelsRows(const RectI& roi,
+                                     int y1,
+                                     int y2,
+                                     bool premult,
+                                     std::bitset<4> processChannels,
+                                     const Image* originalImage,
+                                     bool originalPremult);
 
     /**
      * @brief Given the output buffer,the region of interest and the mip map level, this
@@ -950,6 +935,12 @@ private:
                           bool copyBitMap,
                           Image* output) const;
 
+    /**
+     * @brief Computes the rows [y1,y2) of dstRoI for halveRoIForDepth. The locks must be held by the caller.
+     **/
+    template <typename PIX, int maxValue>
+    void halveRowsForDepth(const RectI & dstRoI, int y1, int y2, bool copyBitMap, Image* output) const;
+
     /**
      * @brief Same as halveRoI but for 1D only (either width == 1 or height == 1)
      **/
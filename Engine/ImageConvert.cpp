@@ -106,6 +106,55 @@ Image::convertPixelDepth(float pix)
     return pix;
 }
 
+template <>
+Half
+Image::convertPixelDepth(unsigned char pix)
+{
+    return Half( Color::intToFloat<256>(pix) );
+}
+
+template <>
+Half
+Image::convertPixelDepth(unsigned short pix)
+{
+    return Half( Color::intToFloat<65536>(pix) );
+}
+
+template <>
+Half
+Image::convertPixelDepth(float pix)
+{
+    return Half(pix);
+}
+
+template <>
+unsigned char
+Image::convertPixelDepth(Half pix)
+{
+    return (unsigned char)Color::floatToInt<256>(pix);
+}
+
+template <>
+unsigned short
+Image::convertPixelDepth(Half pix)
+{
+    return (unsigned short)Color::floatToInt<65536>(pix);
+}
+
+template <>
+float
+Image::convertPixelDepth(Half pix)
+{
+    return pix;
+}
+
+template <>
+Half
+Image::convertPixelDepth(Half pix)
+{
+    return pix;
+}
+
 static const Color::Lut*
 lutFromColorspace(ViewerColorSpaceEnum cs)
 {
@@ -123,9 +172,6 @@ lutFromColorspace(ViewerColorSpaceEnum cs)
             lut = 0;
             break;
     }
-    if (lut) {
-        lut->validate();
-    }
     
     return lut;
 }
@@ -160,13 +206,47 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
     if (intersection.isNull()) {
         return;
     }
+    
+    ///The look-ups in the luts do not depend on the error diffusion: when converting from float to 8-bit or from 8-bit to float,
+    ///do them for the whole line at once with the vectorized functions of Lut.
+    const bool lutRowToByte = dstLut && !srcLut && srcDepth == eImageBitDepthFloat && dstDepth == eImageBitDepthByte;
+    const bool lutRowFromByte = srcLut && srcDepth == eImageBitDepthByte;
+    std::vector<unsigned short> lutRowToByteValues(lutRowToByte ? intersection.width() * nComp : 0);
+    std::vector<float> lutRowFromByteValues(lutRowFromByte ? intersection.width() * nComp : 0);
+    
+    ///Half images are converted from and to float without error diffusion: do whole lines with Half's row functions (F16C when available)
+    const bool halfRowToFloat = !srcLut && !dstLut && srcDepth == eImageBitDepthHalf && dstDepth == eImageBitDepthFloat;
+    const bool halfRowFromFloat = !srcLut && !dstLut && srcDepth == eImageBitDepthFloat && dstDepth == eImageBitDepthHalf;
+    
     for (int y = 0; y < intersection.height(); ++y) {
+        if (halfRowToFloat || halfRowFromFloat) {
+            const void* srcRow = srcImg.pixelAt(intersection.x1, intersection.y1 + y);
+            void* dstRow = dstImg.pixelAt(intersection.x1, intersection.y1 + y);
+            if (halfRowToFloat) {
+                Half::convertRowToFloat( (const Half*)srcRow, (float*)dstRow, intersection.width() * nComp );
+            } else {
+                Half::convertRowFromFloat( (const float*)srcRow, (Half*)dstRow, intersection.width() * nComp );
+            }
+            if (copyBitmap) {
+                dstImg.copyBitmapRowPortion(intersection.x1, intersection.x2, intersection.y1 + y, srcImg);
+            }
+            continue;
+        }
+        
         // coverity[dont_call]
         int start = rand() % intersection.width();
         const SRCPIX* srcPixels = (const SRCPIX*)srcImg.pixelAt(intersection.x1 + start, intersection.y1 + y);
         DSTPIX* dstPixels = (DSTPIX*)dstImg.pixelAt(intersection.x1 + start, intersection.y1 + y);
         const SRCPIX* srcStart = srcPixels;
         DSTPIX* dstStart = dstPixels;
+        
+        if (lutRowToByte) {
+            dstLut->toColorSpaceUint8xxFromLinearFloatFast( (const float*)srcImg.pixelAt(intersection.x1, intersection.y1 + y),
+                                                            &lutRowToByteValues[0], intersection.width(), nComp );
+        } else if (lutRowFromByte) {
+            srcLut->fromColorSpaceUint8ToLinearFloatFast( (const unsigned char*)srcImg.pixelAt(intersection.x1, intersection.y1 + y),
+                                                          &lutRowFromByteValues[0], intersection.width() * nComp );
+        }
 
         for (int backward = 0; backward < 2; ++backward) {
             int x = backward ? start - 1 : start;
@@ -187,8 +267,8 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
                         float pixFloat;
 
                         if (srcLut) {
-                            if (srcDepth == eImageBitDepthByte) {
-                                pixFloat = srcLut->fromColorSpaceUint8ToLinearFloatFast(srcPixels[k]);
+                            if (lutRowFromByte) {
+                                pixFloat = lutRowFromByteValues[x * nComp + k];
                             } else if (srcDepth == eImageBitDepthShort) {
                                 pixFloat = srcLut->fromColorSpaceUint16ToLinearFloatFast(srcPixels[k]);
                             } else {
@@ -200,11 +280,15 @@ Image::convertToFormatInternal_sameComps(const RectI & renderWindow,
 
                         if (dstDepth == eImageBitDepthByte) {
                             ///small increase in perf we use Luts. This should be anyway the most used case.
-                            error[k] = (error[k] & 0xff) + ( dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat) :
-                                                             Color::floatToInt<0xff01>(pixFloat) );
+                            if (lutRowToByte) {
+                                error[k] = (error[k] & 0xff) + lutRowToByteValues[x * nComp + k];
+                            } else {
+                                error[k] = (error[k] & 0xff) + ( dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat) :
+                                                                 Color::floatToInt<0xff01>(pixFloat) );
+                            }
                             pix = error[k] >> 8;
                         } else if (dstDepth == eImageBitDepthShort) {
-                            pix = dstLut ? dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
+                            pix = dstLut ? DSTPIX( dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) ) :
                                   convertPixelDepth<float, DSTPIX>(pixFloat);
                         } else {
                             if (dstLut) {
@@ -307,12 +391,22 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
     const Color::Lut* const srcLut = useColorspaces ? lutFromColorspace((ViewerColorSpaceEnum)srcColorSpace) : 0;
     const Color::Lut* const dstLut = useColorspaces ? lutFromColorspace((ViewerColorSpaceEnum)dstColorSpace) : 0;
     
+    ///Same as in convertToFormatInternal_sameComps: look-up the whole line at once when converting linear float RGB(A) to 8-bit
+    const bool lutRowToByte = dstLut && !srcLut && !requiresUnpremult && srcMaxValue == 1 && dstMaxValue == 255 &&
+                              srcNComps >= 3 && dstNComps >= 3;
+    std::vector<unsigned short> lutRowToByteValues(lutRowToByte ? renderWindow.width() * srcNComps : 0);
+    
     for (int y = 0; y < renderWindow.height(); ++y) {
         
         ///Start of the line for error diffusion
         // coverity[dont_call]
         int start = rand() % renderWindow.width();
         
+        if (lutRowToByte) {
+            dstLut->toColorSpaceUint8xxFromLinearFloatFast( (const float*)srcImg.pixelAt(renderWindow.x1, renderWindow.y1 + y),
+                                                            &lutRowToByteValues[0], renderWindow.width(), srcNComps );
+        }
+        
         const SRCPIX* srcPixels = (const SRCPIX*)srcImg.pixelAt(renderWindow.x1 + start, renderWindow.y1 + y);
         
         DSTPIX* dstPixels = (DSTPIX*)dstImg.pixelAt(renderWindow.x1 + start, renderWindow.y1 + y);
@@ -346,11 +440,11 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
                             break;
                         case 3:
                             // RGB is opaque, so no alpha, unless channelForAlpha is 0-2
-                            pix = convertPixelDepth<SRCPIX, DSTPIX>(channelForAlpha == -1 ? 0. : srcPixels[channelForAlpha]);
+                            pix = convertPixelDepth<SRCPIX, DSTPIX>(channelForAlpha == -1 ? SRCPIX(0) : srcPixels[channelForAlpha]);
                             break;
                         case 2:
                             // XY is opaque unless channelForAlpha is  0-1
-                            pix = convertPixelDepth<SRCPIX, DSTPIX>(channelForAlpha == -1 ? 0. : srcPixels[channelForAlpha]);
+                            pix = convertPixelDepth<SRCPIX, DSTPIX>(channelForAlpha == -1 ? SRCPIX(0) : srcPixels[channelForAlpha]);
                             break;
                         case 1:
                             // just copy alpha disregarding channelForAlpha
@@ -389,7 +483,7 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
                         }
                         
                         for (int k = 0; k < 3 && k < dstNComps; ++k) {
-                            SRCPIX sourcePixel = k < srcNComps ? srcPixels[k] : 0.;
+                            SRCPIX sourcePixel = k < srcNComps ? srcPixels[k] : SRCPIX(0);
                             DSTPIX pix;
                             if (!useColorspaces || (!srcLut && !dstLut)) {
                                 if (dstMaxValue == 255) {
@@ -428,12 +522,16 @@ Image::convertToFormatInternalForColorSpace(const RectI & renderWindow,
                                 ///Apply dst color-space
                                 if (dstMaxValue == 255) {
                                     assert(k < 3);
-                                    error[k] = (error[k] & 0xff) + ( dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat) :
-                                                                    Color::floatToInt<0xff01>(pixFloat) );
+                                    if (lutRowToByte) {
+                                        error[k] = (error[k] & 0xff) + lutRowToByteValues[x * srcNComps + k];
+                                    } else {
+                                        error[k] = (error[k] & 0xff) + ( dstLut ? dstLut->toColorSpaceUint8xxFromLinearFloatFast(pixFloat) :
+                                                                        Color::floatToInt<0xff01>(pixFloat) );
+                                    }
                                     pix = error[k] >> 8;
                                     
                                 } else if (dstMaxValue == 65535) {
-                                    pix = dstLut ? dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) :
+                                    pix = dstLut ? DSTPIX( dstLut->toColorSpaceUint16FromLinearFloatFast(pixFloat) ) :
                                     convertPixelDepth<float, DSTPIX>(pixFloat);
                                     
                                 } else {
@@ -719,6 +817,9 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                                                                                                      dstColorSpace,copyBitmap);
                         break;
                     case eImageBitDepthHalf:
+                        convertToFormatInternal_sameComps<Half, unsigned char, 1, 255>(renderWindow,*this, *dstImg,
+                                                                                       srcColorSpace,
+                                                                                       dstColorSpace,copyBitmap);
                         break;
                     case eImageBitDepthFloat:
                         convertToFormatInternal_sameComps<float, unsigned char, 1, 255>(renderWindow,*this, *dstImg,
@@ -745,6 +846,9 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                                                                                                         dstColorSpace,copyBitmap);
                         break;
                     case eImageBitDepthHalf:
+                        convertToFormatInternal_sameComps<Half, unsigned short, 1, 65535>(renderWindow,*this, *dstImg,
+                                                                                          srcColorSpace,
+                                                                                          dstColorSpace,copyBitmap);
                         break;
                     case eImageBitDepthFloat:
                         convertToFormatInternal_sameComps<float, unsigned short, 1, 65535>(renderWindow,*this, *dstImg,
@@ -757,8 +861,33 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                 break;
             }
 
-            case eImageBitDepthHalf:
+            case eImageBitDepthHalf: {
+                switch ( getBitDepth() ) {
+                    case eImageBitDepthByte:
+                        convertToFormatInternal_sameComps<unsigned char, Half, 255, 1>(renderWindow,*this, *dstImg,
+                                                                                       srcColorSpace,
+                                                                                       dstColorSpace,copyBitmap);
+                        break;
+                    case eImageBitDepthShort:
+                        convertToFormatInternal_sameComps<unsigned short, Half, 65535, 1>(renderWindow,*this, *dstImg,
+                                                                                          srcColorSpace,
+                                                                                          dstColorSpace,copyBitmap);
+                        break;
+                    case eImageBitDepthHalf:
+                        convertToFormatInternal_sameComps<Half, Half, 1, 1>(renderWindow,*this, *dstImg,
+                                                                            srcColorSpace,
+                                                                            dstColorSpace,copyBitmap);
+                        break;
+                    case eImageBitDepthFloat:
+                        convertToFormatInternal_sameComps<float, Half, 1, 1>(renderWindow,*this, *dstImg,
+                                                                             srcColorSpace,
+                                                                             dstColorSpace,copyBitmap);
+                        break;
+                    case eImageBitDepthNone:
+                        break;
+                }
                 break;
+            }
 
             case eImageBitDepthFloat: {
                 switch ( getBitDepth() ) {
@@ -773,6 +902,9 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                                                                                            dstColorSpace,copyBitmap);
                         break;
                     case eImageBitDepthHalf:
+                        convertToFormatInternal_sameComps<Half, float, 1, 1>(renderWindow,*this, *dstImg,
+                                                                             srcColorSpace,
+                                                                             dstColorSpace,copyBitmap);
                         break;
                     case eImageBitDepthFloat:
                         ///Same as a copy
@@ -811,6 +943,12 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                                                                                                    copyBitmap,requiresUnpremult);
                         break;
                     case eImageBitDepthHalf:
+                        convertToFormatInternalForDepth<Half, unsigned char, 1, 255>(renderWindow,*this, *dstImg,
+                                                                                     srcColorSpace,
+                                                                                     dstColorSpace,
+                                                                                     channelForAlpha,
+                                                                                     useAlpha0,
+                                                                                     copyBitmap,requiresUnpremult);
                         break;
                     case eImageBitDepthFloat:
                         convertToFormatInternalForDepth<float, unsigned char, 1, 255>(renderWindow,*this, *dstImg,
@@ -847,6 +985,12 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                         
                         break;
                     case eImageBitDepthHalf:
+                        convertToFormatInternalForDepth<Half, unsigned short, 1, 65535>(renderWindow,*this, *dstImg,
+                                                                                        srcColorSpace,
+                                                                                        dstColorSpace,
+                                                                                        channelForAlpha,
+                                                                                        useAlpha0,
+                                                                                        copyBitmap,requiresUnpremult);
                         break;
                     case eImageBitDepthFloat:
                         convertToFormatInternalForDepth<float, unsigned short, 1, 65535>(renderWindow,*this, *dstImg,
@@ -861,8 +1005,45 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                 }
                 break;
             }
-            case eImageBitDepthHalf:
+            case eImageBitDepthHalf: {
+                switch ( getBitDepth() ) {
+                    case eImageBitDepthByte:
+                        convertToFormatInternalForDepth<unsigned char, Half, 255, 1>(renderWindow,*this, *dstImg,
+                                                                                     srcColorSpace,
+                                                                                     dstColorSpace,
+                                                                                     channelForAlpha,
+                                                                                     useAlpha0,
+                                                                                     copyBitmap,requiresUnpremult);
+                        break;
+                    case eImageBitDepthShort:
+                        convertToFormatInternalForDepth<unsigned short, Half, 65535, 1>(renderWindow,*this, *dstImg,
+                                                                                        srcColorSpace,
+                                                                                        dstColorSpace,
+                                                                                        channelForAlpha,
+                                                                                        useAlpha0,
+                                                                                        copyBitmap,requiresUnpremult);
+                        break;
+                    case eImageBitDepthHalf:
+                        convertToFormatInternalForDepth<Half, Half, 1, 1>(renderWindow,*this, *dstImg,
+                                                                          srcColorSpace,
+                                                                          dstColorSpace,
+                                                                          channelForAlpha,
+                                                                          useAlpha0,
+                                                                          copyBitmap,requiresUnpremult);
+                        break;
+                    case eImageBitDepthFloat:
+                        convertToFormatInternalForDepth<float, Half, 1, 1>(renderWindow,*this, *dstImg,
+                                                                           srcColorSpace,
+                                                                           dstColorSpace,
+                                                                           channelForAlpha,
+                                                                           useAlpha0,
+                                                                           copyBitmap,requiresUnpremult);
+                        break;
+                    case eImageBitDepthNone:
+                        break;
+                }
                 break;
+            }
             case eImageBitDepthFloat: {
                 switch ( getBitDepth() ) {
                     case eImageBitDepthByte:
@@ -883,6 +1064,12 @@ Image::convertToFormatCommon(const RectI & renderWindow,
                         
                         break;
                     case eImageBitDepthHalf:
+                        convertToFormatInternalForDepth<Half, float, 1, 1>(renderWindow,*this, *dstImg,
+                                                                           srcColorSpace,
+                                                                           dstColorSpace,
+                                                                           channelForAlpha,
+                                                                           useAlpha0,
+                                                                           copyBitmap,requiresUnpremult);
                         break;
                     case eImageBitDepthFloat:
                         convertToFormatInternalForDepth<float, float, 1, 1>(renderWindow,*this, *dstImg,
@@ -29,478 +29,53 @@
 
 #include <QDebug>
 
-//#define NATRON_COPY_CHANNELS_UNPREMULT
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
-NATRON_NAMESPACE_ENTER;
-
-template <typename PIX, int maxValue, int srcNComps, int dstNComps, bool doR, bool doG, bool doB, bool doA, bool premult, bool originalPremult>
-void
-Image::copyUnProcessedChannelsForPremult(const std::bitset<4> processChannels,
-                                         const RectI& roi,
-                                         const ImagePtr& originalImage)
-{
-    assert(((doR == !processChannels[0]) || !(dstNComps >= 2)) &&
-           ((doG == !processChannels[1]) || !(dstNComps >= 2)) &&
-           ((doB == !processChannels[2]) || !(dstNComps >= 3)) &&
-           ((doA == !processChannels[3]) || !(dstNComps == 1 || dstNComps == 4)));
-    ReadAccess acc(originalImage.get());
-
-    int dstRowElements = dstNComps * _bounds.width();
-    
-    PIX* dst_pixels = (PIX*)pixelAt(roi.x1, roi.y1);
-    assert(dst_pixels);
-    assert(srcNComps == 1 || srcNComps == 4 || !originalPremult); // only A or RGBA can be premult
-    assert(dstNComps == 1 || dstNComps == 4 || !premult); // only A or RGBA can be premult
-
-    for (int y = roi.y1; y < roi.y2; ++y, dst_pixels += (dstRowElements - (roi.x2 - roi.x1) * dstNComps)) {
-        for (int x = roi.x1; x < roi.x2; ++x, dst_pixels += dstNComps) {
-            const PIX* src_pixels = originalImage ? (const PIX*)acc.pixelAt(x, y) : 0;
-            PIX srcA = src_pixels ? maxValue : 0; /* be opaque for anything that doesn't contain alpha */
-            if ((srcNComps == 1 || srcNComps == 4) && src_pixels) {
-#             ifdef DEBUG
-                assert(src_pixels[srcNComps - 1] == src_pixels[srcNComps - 1]); // check for NaN
-#             endif
-                srcA = src_pixels[srcNComps - 1];
-            }
-
-#define DOCHANNEL(c)                                                    \
-            if (srcNComps == 1 || !src_pixels || c >= srcNComps) {      \
-                dst_pixels[c] = 0;                                      \
-            } else if (originalPremult) {                               \
-                if (srcA == 0) {                                        \
-                    dst_pixels[c] = src_pixels[c]; /* don't try to unpremult, just copy */ \
-                } else if (premult) {                                   \
-                    if (doA) {                                          \
-                        dst_pixels[c] = src_pixels[c]; /* dst will have same alpha as src, just copy src */ \
-                    } else {                                            \
-                        dst_pixels[c] = (src_pixels[c] / (float)srcA) * dstAorig; /* dst keeps its alpha, unpremult src and repremult */ \
-                    }                                                   \
-                } else {                                                \
-                    dst_pixels[c] = (src_pixels[c] / (float)srcA) * maxValue; /* dst is not premultiplied, unpremult src */ \
-                }                                                       \
-            } else {                                                    \
-                if (premult) {                                          \
-                    if (doA) {                                          \
-                        dst_pixels[c] = (src_pixels[c] / (float)maxValue) * srcA; /* dst will have same alpha as src, just premult src with its alpha */ \
-                    } else {                                            \
-                        dst_pixels[c] = (src_pixels[c] / (float)maxValue) * dstAorig; /* dst keeps its alpha, premult src with dst's alpha */ \
-                    }                                                   \
-                } else {                                                \
-                    dst_pixels[c] = src_pixels[c]; /* neither src nor dst is not premultiplied */ \
-                }                                                       \
-            }
+#include "Engine/ImageRow.h"
 
-            PIX dstAorig = maxValue;
-            if (dstNComps == 1 || dstNComps == 4) {
-#             ifdef DEBUG
-                assert(dst_pixels[dstNComps - 1] == dst_pixels[dstNComps - 1]); // check for NaN
-#             endif
-                dstAorig = dst_pixels[dstNComps - 1];
-            }
-            if (doR) {
-#             ifdef DEBUG
-                assert(!src_pixels || src_pixels[0] == src_pixels[0]); // check for NaN
-                assert(dst_pixels[0] == dst_pixels[0]); // check for NaN
-#             endif
-                DOCHANNEL(0);
-#             ifdef DEBUG
-                assert(dst_pixels[0] == dst_pixels[0]); // check for NaN
-#             endif
-            }
-            if (doG) {
-#             ifdef DEBUG
-                assert(!src_pixels || src_pixels[1] == src_pixels[1]); // check for NaN
-                assert(dst_pixels[1] == dst_pixels[1]); // check for NaN
-#             endif
-                DOCHANNEL(1);
-#             ifdef DEBUG
-                assert(dst_pixels[1] == dst_pixels[1]); // check for NaN
-#             endif
-            }
-            if (doB) {
-#             ifdef DEBUG
-                assert(!src_pixels || src_pixels[2] == src_pixels[2]); // check for NaN
-                assert(dst_pixels[2] == dst_pixels[2]); // check for NaN
-#             endif
-                DOCHANNEL(2);
-#             ifdef DEBUG
-                assert(dst_pixels[2] == dst_pixels[2]); // check for NaN
-#             endif
-            }
-            if (doA) {
-#ifdef        NATRON_COPY_CHANNELS_UNPREMULT
-                if (premult) {
-                    if (dstAorig != 0) {
-                        // unpremult, then premult
-                        if (dstNComps >= 2 && !doR) {
-                            dst_pixels[0] = (dst_pixels[0] / (float)dstAorig) * srcA;
-#                         ifdef DEBUG
-                            assert(dst_pixels[0] == dst_pixels[0]); // check for NaN
-#                         endif
-                        }
-                        if (dstNComps >= 2 && !doG) {
-                            dst_pixels[1] = (dst_pixels[1] / (float)dstAorig) * srcA;
-#                         ifdef DEBUG
-                            assert(dst_pixels[1] == dst_pixels[1]); // check for NaN
-#                         endif
-                        }
-                        if (dstNComps >= 2 && !doB) {
-                            dst_pixels[2] = (dst_pixels[2] / (float)dstAorig) * srcA;
-#                         ifdef DEBUG
-                            assert(dst_pixels[2] == dst_pixels[2]); // check for NaN
-#                         endif
-                        }
-                    }
-                }
-#             endif
-                if (dstNComps == 1 || dstNComps == 4) {
-                    dst_pixels[dstNComps - 1] = srcA;
-#                 ifdef DEBUG
-                    assert(dst_pixels[dstNComps - 1] == dst_pixels[dstNComps - 1]); // check for NaN
-#                 endif
-                }
-            }
-        }
-    }
-    
-
-}
-
-template <typename PIX, int maxValue, int srcNComps, int dstNComps>
-void
-Image::copyUnProcessedChannelsForPremult(const bool premult,
-                                         const bool originalPremult,
-                                         const std::bitset<4> processChannels,
-                                         const RectI& roi,
-                                         const ImagePtr& originalImage)
-{
-    ReadAccess acc(originalImage.get());
-
-    int dstRowElements = dstNComps * _bounds.width();
-
-    PIX* dst_pixels = (PIX*)pixelAt(roi.x1, roi.y1);
-    assert(dst_pixels);
-    const bool doR = !processChannels[0] && (dstNComps >= 2);
-    const bool doG = !processChannels[1] && (dstNComps >= 2);
-    const bool doB = !processChannels[2] && (dstNComps >= 3);
-    const bool doA = !processChannels[3] && (dstNComps == 1 || dstNComps == 4);
-    assert(srcNComps == 4 || !originalPremult); // only RGBA can be premult
-    assert(dstNComps == 4 || !premult); // only RGBA can be premult
-
-    for (int y = roi.y1; y < roi.y2; ++y, dst_pixels += (dstRowElements - (roi.x2 - roi.x1) * dstNComps)) {
-        for (int x = roi.x1; x < roi.x2; ++x, dst_pixels += dstNComps) {
-            const PIX* src_pixels = originalImage ? (const PIX*)acc.pixelAt(x, y) : 0;
-            PIX srcA = src_pixels ? maxValue : 0; /* be opaque for anything that doesn't contain alpha */
-            if ((srcNComps == 1 || srcNComps == 4) && src_pixels) {
-#             ifdef DEBUG
-                assert(src_pixels[srcNComps - 1] == src_pixels[srcNComps - 1]); // check for NaN
-#             endif
-                srcA = src_pixels[srcNComps - 1];
-            }
-            PIX dstAorig = maxValue;
-            if (dstNComps == 1 || dstNComps == 4) {
-#             ifdef DEBUG
-                assert(dst_pixels[dstNComps - 1] == dst_pixels[dstNComps - 1]); // check for NaN
-#             endif
-                dstAorig = dst_pixels[dstNComps - 1];
-            }
-            if (doR) {
-#             ifdef DEBUG
-                assert(!src_pixels || src_pixels[0] == src_pixels[0]); // check for NaN
-                assert(dst_pixels[0] == dst_pixels[0]); // check for NaN
-#             endif
-                DOCHANNEL(0);
-#             ifdef DEBUG
-                assert(dst_pixels[0] == dst_pixels[0]); // check for NaN
-#             endif
-            }
-            if (doG) {
-#             ifdef DEBUG
-                assert(!src_pixels || src_pixels[1] == src_pixels[1]); // check for NaN
-                assert(dst_pixels[1] == dst_pixels[1]); // check for NaN
-#             endif
-                DOCHANNEL(1);
-#             ifdef DEBUG
-                assert(dst_pixels[1] == dst_pixels[1]); // check for NaN
-#             endif
-            }
-            if (doB) {
-#             ifdef DEBUG
-                assert(!src_pixels || src_pixels[2] == src_pixels[2]); // check for NaN
-                assert(dst_pixels[2] == dst_pixels[2]); // check for NaN
-#             endif
-                DOCHANNEL(2);
-#             ifdef DEBUG
-                assert(dst_pixels[2] == dst_pixels[2]); // check for NaN
-#             endif
-            }
-            if (doA) {
-#ifdef            NATRON_COPY_CHANNELS_UNPREMULT
-                if (premult) {
-                    if (dstAorig != 0) {
-                        // unpremult, then premult
-                        if (dstNComps >= 2 && !doR) {
-                            dst_pixels[0] = (dst_pixels[0] / (float)dstAorig) * srcA;
-#                         ifdef DEBUG
-                            assert(dst_pixels[0] == dst_pixels[0]); // check for NaN
-#                         endif
-                        }
-                        if (dstNComps >= 2 && !doG) {
-                            dst_pixels[1] = (dst_pixels[1] / (float)dstAorig) * srcA;
-#                         ifdef DEBUG
-                            assert(dst_pixels[1] == dst_pixels[1]); // check for NaN
-#                         endif
-                        }
-                        if (dstNComps >= 2 && !doB) {
-                            dst_pixels[2] = (dst_pixels[2] / (float)dstAorig) * srcA;
-#                         ifdef DEBUG
-                            assert(dst_pixels[2] == dst_pixels[2]); // check for NaN
-#                         endif
-                        }
-                    }
-                }
-#              endif
-                if (dstNComps == 1 || dstNComps == 4) {
-                    dst_pixels[dstNComps - 1] = srcA;
-#                 ifdef DEBUG
-                    assert(dst_pixels[dstNComps - 1] == dst_pixels[dstNComps - 1]); // check for NaN
-#                 endif
-                }
-            }
-        }
-    }
-}
+NATRON_NAMESPACE_ENTER;
 
-template <typename PIX, int maxValue, int srcNComps, int dstNComps, bool doR, bool doG, bool doB, bool doA>
+template <typename PIX>
 void
-Image::copyUnProcessedChannelsForChannels(const std::bitset<4> processChannels,
-                                          const bool premult,
-                                          const RectI& roi,
-                                          const ImagePtr& originalImage,
-                                          const bool originalPremult)
+Image::copyUnProcessedChannelsRows(const RectI& roi,
+                                   int y1,
+                                   int y2,
+                                   bool premult,
+                                   std::bitset<4> processChannels,
+                                   const Image* originalImage,
+                                   bool originalPremult)
 {
-    assert(((doR == !processChannels[0]) || !(dstNComps >= 2)) &&
-           ((doG == !processChannels[1]) || !(dstNComps >= 2)) &&
-           ((doB == !processChannels[2]) || !(dstNComps >= 3)) &&
-           ((doA == !processChannels[3]) || !(dstNComps == 1 || dstNComps == 4)));
-    if (premult) {
-        if (originalPremult) {
-            copyUnProcessedChannelsForPremult<PIX, maxValue, srcNComps, dstNComps, doR, doG, doB, doA, true, true>(processChannels, roi, originalImage);
-        } else {
-            copyUnProcessedChannelsForPremult<PIX, maxValue, srcNComps, dstNComps>(true, false, processChannels, roi, originalImage);
-        }
-    } else {
-        if (originalPremult) {
-            copyUnProcessedChannelsForPremult<PIX, maxValue, srcNComps, dstNComps>(false, true, processChannels, roi, originalImage);
-        } else {
-            copyUnProcessedChannelsForPremult<PIX, maxValue, srcNComps, dstNComps, doR, doG, doB, doA, false, false>(processChannels, roi, originalImage);
-        }
+    const int dstNComps = getComponentsCount();
+    const int srcNComps = originalImage ? originalImage->getComponentsCount() : 0;
+
+    ///The row is split where the original image starts or stops having pixels
+    int xs[4];
+    int nXs = 0;
+    xs[nXs++] = roi.x1;
+    if (originalImage) {
+        const RectI& srcBounds = originalImage->getBounds();
+        xs[nXs++] = std::min(std::max(srcBounds.x1, roi.x1), roi.x2);
+        xs[nXs++] = std::min(std::max(srcBounds.x2, roi.x1), roi.x2);
     }
-}
-
-template <typename PIX, int maxValue, int srcNComps, int dstNComps>
-void
-Image::copyUnProcessedChannelsForChannels(const std::bitset<4> processChannels,
-                                          const bool premult,
-                                          const RectI& roi,
-                                          const ImagePtr& originalImage,
-                                          const bool originalPremult)
-{
-    copyUnProcessedChannelsForPremult<PIX, maxValue, srcNComps, dstNComps>(premult, originalPremult, processChannels, roi, originalImage);
-}
-
-template <typename PIX, int maxValue, int srcNComps, int dstNComps>
-void
-Image::copyUnProcessedChannelsForComponents(const bool premult,
-                                            const RectI& roi,
-                                            const std::bitset<4> processChannels,
-                                            const ImagePtr& originalImage,
-                                            const bool originalPremult)
-{
-    const bool doR = !processChannels[0] && (dstNComps >= 2);
-    const bool doG = !processChannels[1] && (dstNComps >= 2);
-    const bool doB = !processChannels[2] && (dstNComps >= 3);
-    const bool doA = !processChannels[3] && (dstNComps == 1 || dstNComps == 4);
-    if (dstNComps == 1) {
-            if (doA) {
-                copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps, false, false, false, true>(processChannels, premult, roi, originalImage, originalPremult); // RGB were processed, copy A
-            } else {
-                copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps, false, false, false, false>(processChannels, premult, roi, originalImage, originalPremult); // RGBA were processed, only do premult
-            }
-    } else {
-        assert(2 <= dstNComps && dstNComps <= 4);
-        if (doR) {
-            if (doG) {
-                if (dstNComps >= 3 && doB) {
-                    if (dstNComps >= 4 && doA) {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps, true, true, true, true>(processChannels, premult, roi, originalImage, originalPremult); // none were processed, only do premult
-                    } else {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps, true, true, true, false>(processChannels, premult, roi, originalImage, originalPremult); // A was processed
-                    }
-                } else {
-                    if (dstNComps >= 4 && doA) {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps, true, true, false, true>(processChannels, premult, roi, originalImage, originalPremult); // B was processed
-                    } else {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps>(/*true, true, false, false, */processChannels, premult, roi, originalImage, originalPremult); // BA were processed (rare)
-                    }
-                }
-            } else {
-                if (dstNComps >= 3 && doB) {
-                    if (dstNComps >= 4 && doA) {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps, true, false, true, true>(processChannels, premult, roi, originalImage, originalPremult); // G was processed
-                    } else {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps>(/*true, false, true, false, */processChannels, premult, roi, originalImage, originalPremult); // GA were processed (rare)
-                    }
-                } else {
-                    //if (dstNComps >= 4 && doA) {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps>(/*true, false, false, true, */processChannels, premult, roi, originalImage, originalPremult); // GB were processed (rare)
-                    //} else {
-                    //    copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps>(/*true, false, false, false, */processChannels, premult, roi, originalImage, originalPremult); // GBA were processed (rare)
-                    //}
-                }
-            }
-        } else {
-            if (doG) {
-                if (dstNComps >= 3 && doB) {
-                    if (dstNComps >= 4 && doA) {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps, false, true, true, true>(processChannels, premult, roi, originalImage, originalPremult); // R was processed
-                    } else {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps>(/*false, true, true, false, */processChannels, premult, roi, originalImage, originalPremult); // RA were processed (rare)
-                    }
-                } else {
-                    //if (dstNComps >= 4 && doA) {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps>(/*false, true, false, true, */processChannels, premult, roi, originalImage, originalPremult); // RB were processed (rare)
-                    //} else {
-                    //    copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps>(/*false, true, false, false, */processChannels, premult, roi, originalImage, originalPremult); // RBA were processed (rare)
-                    //}
-                }
-            } else {
-                if (dstNComps >= 3 && doB) {
-                    //if (dstNComps >= 4 && doA) {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps>(/*false, false, true, true, */processChannels, premult, roi, originalImage, originalPremult); // RG were processed (rare)
-                    //} else {
-                    //    copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps>(/*false, false, true, false, */processChannels, premult, roi, originalImage, originalPremult); // RGA were processed (rare)
-                    //}
-                } else {
-                    if (dstNComps >= 4 && doA) {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps, false, false, false, true>(processChannels, premult, roi, originalImage, originalPremult); // RGB were processed
-                    } else {
-                        copyUnProcessedChannelsForChannels<PIX, maxValue, srcNComps, dstNComps, false, false, false, false>(processChannels, premult, roi, originalImage, originalPremult); // RGBA were processed
-                    }
-                }
-            }
+    xs[nXs++] = roi.x2;
+
+    for (int y = y1; y < y2; ++y) {
+        for (int i = 0; i + 1 < nXs; ++i) {
+            const int x1 = xs[i];
+            const int width = xs[i + 1] - x1;
+            if (width <= 0) {
+                continue;
+            }
+            const PIX* srcPixels = originalImage ? (const PIX*)originalImage->pixelAt(x1, y) : 0;
+            ImageRow::copyUnProcessedChannelsRow(srcPixels, srcNComps, originalPremult, processChannels, premult,
+                                                 width, (PIX*)pixelAt(x1, y), dstNComps);
         }
     }
 }
 
-
-template <typename PIX, int maxValue>
-void
-Image::copyUnProcessedChannelsForDepth(const bool premult,
-                                       const RectI& roi,
-                                       const std::bitset<4> processChannels,
-                                       const ImagePtr& originalImage,
-                                       const bool originalPremult)
-{
-    int dstNComps = getComponents().getNumComponents();
-    int srcNComps = originalImage ? originalImage->getComponents().getNumComponents() : 0;
-    
-    switch (dstNComps) {
-        case 1:
-            switch (srcNComps) {
-                case 0:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 0, 1>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 1:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 1, 1>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 2:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 2, 1>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 3:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 3, 1>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 4:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 4, 1>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                default:
-                    assert(false);
-                    break;
-            }
-            break;
-        case 2:
-            switch (srcNComps) {
-                case 0:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 0, 2>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 1:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 1, 2>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 2:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 2, 2>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 3:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 3, 2>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 4:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 4, 2>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                default:
-                    assert(false);
-                    break;
-            }
-            break;
-        case 3:
-            switch (srcNComps) {
-                case 0:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 0, 3>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 1:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 1, 3>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 2:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 2, 3>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 3:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 3, 3>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 4:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 4, 3>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                default:
-                    assert(false);
-                    break;
-            }
-            break;
-        case 4:
-            switch (srcNComps) {
-                case 0:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 0, 4>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 1:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 1, 4>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 2:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 2, 4>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 3:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 3, 4>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                case 4:
-                    copyUnProcessedChannelsForComponents<PIX, maxValue, 4, 4>(premult, roi, processChannels, originalImage, originalPremult);
-                    break;
-                default:
-                    assert(false);
-                    break;
-            }
-            break;
-
-        default:
-            assert(false);
-            break;
-    }
-}
-
 bool
 Image::canCallCopyUnProcessedChannels(const std::bitset<4> processChannels) const
 {
@@ -549,6 +124,7 @@ Image::copyUnProcessedChannels(const RectI& roi,
     }
     
     QWriteLocker k(&_entryLock);
+    ReadAccess acc( originalImage.get() );
     assert(!originalImage || getBitDepth() == originalImage->getBitDepth());
     
     
@@ -557,15 +133,21 @@ Image::copyUnProcessedChannels(const RectI& roi,
 
     bool premult = (outputPremult == eImagePremultiplicationPremultiplied);
     bool originalPremult = (originalImagePremult == eImagePremultiplicationPremultiplied);
+    const Image* original = originalImage.get();
+
+    ///The rows are processed in parallel bands for large rois, the locks are held by this thread
     switch (getBitDepth()) {
         case eImageBitDepthByte:
-            copyUnProcessedChannelsForDepth<unsigned char, 255>(premult, roi, processChannels, originalImage, originalPremult);
+            ImageRow::processRowBands( intersected, boost::bind(&Image::copyUnProcessedChannelsRows<unsigned char>, this, intersected, _1, _2, premult, processChannels, original, originalPremult) );
             break;
         case eImageBitDepthShort:
-            copyUnProcessedChannelsForDepth<unsigned short, 65535>(premult, roi, processChannels, originalImage, originalPremult);
+            ImageRow::processRowBands( intersected, boost::bind(&Image::copyUnProcessedChannelsRows<unsigned short>, this, intersected, _1, _2, premult, processChannels, original, originalPremult) );
+            break;
+        case eImageBitDepthHalf:
+            ImageRow::processRowBands( intersected, boost::bind(&Image::copyUnProcessedChannelsRows<Half>, this, intersected, _1, _2, premult, processChannels, original, originalPremult) );
             break;
         case eImageBitDepthFloat:
-            copyUnProcessedChannelsForDepth<float, 1>(premult, roi, processChannels, originalImage, originalPremult);
+            ImageRow::processRowBands( intersected, boost::bind(&Image::copyUnProcessedChannelsRows<float>, this, intersected, _1, _2, premult, processChannels, original, originalPremult) );
             break;
         default:
             return;
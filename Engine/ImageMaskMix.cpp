@@ -24,175 +24,68 @@
 
 #include "Image.h"
 
+#include <algorithm> // sort, unique
 #include <cassert>
 #include <stdexcept>
 
-NATRON_NAMESPACE_ENTER;
-
-template<int srcNComps, int dstNComps, typename PIX, int maxValue, bool masked, bool maskInvert>
-void
-Image::applyMaskMixForMaskInvert(const RectI& roi,
-                                 const Image* maskImg,
-                                 const Image* originalImg,
-                                 float mix)
-{
-    PIX* dst_pixels = (PIX*)pixelAt(roi.x1, roi.y1);
-    
-    unsigned int dstRowElements = _bounds.width() * getComponentsCount();
-    
-    for (int y = roi.y1; y < roi.y2; ++y,
-         dst_pixels += (dstRowElements - (roi.x2 - roi.x1) * dstNComps)) { // 1 row stride minus what was done at previous iteration
-        
-        for (int x = roi.x1; x < roi.x2; ++x,
-             dst_pixels += dstNComps) {
-            
-            const PIX* src_pixels = originalImg ? (const PIX*)originalImg->pixelAt(x,y) : 0;
-            
-            float maskScale = 1.f;
-            if (!masked) {
-                // just mix
-                float alpha = mix;
-                if (src_pixels) {
-                    for (int c = 0; c < dstNComps; ++c) {
-                        if (c < srcNComps) {
-                            float v = float(dst_pixels[c]) * alpha + (1.f - alpha) * float(src_pixels[c]);
-                            dst_pixels[c] = clampIfInt<PIX>(v);
-                        }
-                        
-                    }
-                } else {
-                    for (int c = 0; c < dstNComps; ++c) {
-                        float v = float(dst_pixels[c]) * alpha;
-                        dst_pixels[c] = clampIfInt<PIX>(v);
-                    }
-                }
-                
-            } else {
-                const PIX* maskPixels = maskImg ? (const PIX*)maskImg->pixelAt(x,y) : 0;
-                // figure the scale factor from that pixel
-                if (maskPixels == 0) {
-                    maskScale = maskInvert ? 1.f : 0.f;
-                } else {
-                    maskScale = *maskPixels / float(maxValue);
-                    if (maskInvert) {
-                        maskScale = 1.f - maskScale;
-                    }
-                }
-                float alpha = mix * maskScale;
-                if (src_pixels) {
-                    for (int c = 0; c < dstNComps; ++c) {
-                        if (c < srcNComps) {
-                            float v = float(dst_pixels[c]) * alpha + (1.f - alpha) * float(src_pixels[c]);
-                            dst_pixels[c] = clampIfInt<PIX>(v);
-                        }
-                        
-                    }
-                } else {
-                    for (int c = 0; c < dstNComps; ++c) {
-                        float v = float(dst_pixels[c]) * alpha;
-                        dst_pixels[c] = clampIfInt<PIX>(v);
-                    }
-                }
-            }
-            
-            
-            
-        }
-    }
-}
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 
+#include "Engine/ImageRow.h"
 
-template<int srcNComps, int dstNComps, typename PIX, int maxValue, bool masked>
-void
-Image::applyMaskMixForMasked(const RectI& roi,
-                             const Image* maskImg,
-                             const Image* originalImg,
-                             bool maskInvert,
-                             float mix)
-{
-    if (maskInvert) {
-        applyMaskMixForMaskInvert<srcNComps,dstNComps, PIX, maxValue, masked, true>(roi, maskImg, originalImg, mix);
-    } else {
-        applyMaskMixForMaskInvert<srcNComps,dstNComps, PIX, maxValue, masked, false>(roi, maskImg, originalImg, mix);
-    }
-}
+NATRON_NAMESPACE_ENTER;
 
-template<int srcNComps, int dstNComps, typename PIX, int maxValue>
+template <typename PIX>
 void
-Image::applyMaskMixForDepth(const RectI& roi,
-                            const Image* maskImg,
-                            const Image* originalImg,
-                            bool masked,
-                            bool maskInvert,
-                            float mix)
+Image::applyMaskMixRows(const RectI& roi,
+                        int y1,
+                        int y2,
+                        const Image* maskImg,
+                        const Image* originalImg,
+                        bool masked,
+                        bool maskInvert,
+                        float mix)
 {
-    if (masked) {
-        applyMaskMixForMasked<srcNComps,dstNComps, PIX, maxValue, true>(roi, maskImg, originalImg, maskInvert, mix);
-    } else {
-        applyMaskMixForMasked<srcNComps,dstNComps, PIX, maxValue, false>(roi, maskImg, originalImg, maskInvert, mix);
-    }
-    
-}
+    const int dstNComps = getComponentsCount();
+    const int srcNComps = originalImg->getComponentsCount();
 
-
-template<int srcNComps, int dstNComps>
-void
-Image::applyMaskMixForDstComponents(const RectI& roi,
-                                    const Image* maskImg,
-                                    const Image* originalImg,
-                                    bool masked,
-                                    bool maskInvert,
-                                    float mix)
-{
-    ImageBitDepthEnum depth = getBitDepth();
-    switch (depth) {
-        case eImageBitDepthByte:
-            applyMaskMixForDepth<srcNComps,dstNComps, unsigned char , 255>(roi, maskImg, originalImg, masked, maskInvert, mix);
-            break;
-        case eImageBitDepthShort:
-            applyMaskMixForDepth<srcNComps,dstNComps, unsigned short , 65535>(roi, maskImg, originalImg, masked, maskInvert, mix);
-            break;
-        case eImageBitDepthFloat:
-            applyMaskMixForDepth<srcNComps,dstNComps, float, 1>(roi, maskImg, originalImg, masked, maskInvert, mix);
-            break;
-        default:
-            assert(false);
-            break;
+    ///The row is split where the original image and the mask start or stop having pixels
+    int xs[6];
+    int nXs = 0;
+    xs[nXs++] = roi.x1;
+    xs[nXs++] = roi.x2;
+    const RectI& srcBounds = originalImg->getBounds();
+    xs[nXs++] = std::min(std::max(srcBounds.x1, roi.x1), roi.x2);
+    xs[nXs++] = std::min(std::max(srcBounds.x2, roi.x1), roi.x2);
+    if (masked && maskImg) {
+        const RectI& maskBounds = maskImg->getBounds();
+        xs[nXs++] = std::min(std::max(maskBounds.x1, roi.x1), roi.x2);
+        xs[nXs++] = std::min(std::max(maskBounds.x2, roi.x1), roi.x2);
     }
-    
-}
+    std::sort(xs, xs + nXs);
+    nXs = std::unique(xs, xs + nXs) - xs;
 
-template<int srcNComps>
-void
-Image::applyMaskMixForSrcComponents(const RectI& roi,
-                                    const Image* maskImg,
-                                    const Image* originalImg,
-                                    bool masked,
-                                    bool maskInvert,
-                                    float mix)
-{
-    int dstNComps = getComponentsCount();
-    assert(0 < dstNComps && dstNComps <= 4);
-    switch (dstNComps) {
-        //case 0:
-        //    applyMaskMixForDstComponents<srcNComps,0>(roi, maskImg, originalImg, masked, maskInvert, mix);
-        //    break;
-        case 1:
-            applyMaskMixForDstComponents<srcNComps,1>(roi, maskImg, originalImg, masked, maskInvert, mix);
-            break;
-        case 2:
-            applyMaskMixForDstComponents<srcNComps,2>(roi, maskImg, originalImg, masked, maskInvert, mix);
-            break;
-        case 3:
-            applyMaskMixForDstComponents<srcNComps,3>(roi, maskImg, originalImg, masked, maskInvert, mix);
-            break;
-        case 4:
-            applyMaskMixForDstComponents<srcNComps,4>(roi, maskImg, originalImg, masked, maskInvert, mix);
-            break;
-        default:
-            break;
+    for (int y = y1; y < y2; ++y) {
+        for (int i = 0; i + 1 < nXs; ++i) {
+            const int x1 = xs[i];
+            const int width = xs[i + 1] - x1;
+            const PIX* srcPixels = (const PIX*)originalImg->pixelAt(x1, y);
+            const PIX* maskPixels = 0;
+            float rowMix = mix;
+            if (masked) {
+                maskPixels = maskImg ? (const PIX*)maskImg->pixelAt(x1, y) : 0;
+                if (!maskPixels) {
+                    // outside of the mask
+                    rowMix = mix * (maskInvert ? 1.f : 0.f);
+                }
+            }
+            ImageRow::maskMixRow(srcPixels, srcNComps, maskPixels, maskInvert, rowMix,
+                                 width, (PIX*)pixelAt(x1, y), dstNComps);
+        }
     }
-}
+} // applyMaskMixRows
 
 void
 Image::applyMaskMix(const RectI& roi,
@@ -223,24 +116,26 @@ Image::applyMaskMix(const RectI& roi,
     assert(!masked || !maskImg || maskImg->getComponents() == ImageComponents::getAlphaComponents());
     
     int srcNComps = originalImg ? (int)originalImg->getComponentsCount() : 0;
-    //assert(0 < srcNComps && srcNComps <= 4);
-    switch (srcNComps) {
-        //case 0:
-        //    applyMaskMixForSrcComponents<0>(realRoI, maskImg, originalImg, masked, maskInvert, mix);
-        //    break;
-        case 1:
-            applyMaskMixForSrcComponents<1>(realRoI, maskImg, originalImg, masked, maskInvert, mix);
+    if (srcNComps == 0) {
+        return;
+    }
+
+    ///The rows are processed in parallel bands for large rois, the locks are held by this thread
+    switch ( getBitDepth() ) {
+        case eImageBitDepthByte:
+            ImageRow::processRowBands( realRoI, boost::bind(&Image::applyMaskMixRows<unsigned char>, this, realRoI, _1, _2, maskImg, originalImg, masked, maskInvert, mix) );
             break;
-        case 2:
-            applyMaskMixForSrcComponents<2>(realRoI, maskImg, originalImg, masked, maskInvert, mix);
+        case eImageBitDepthShort:
+            ImageRow::processRowBands( realRoI, boost::bind(&Image::applyMaskMixRows<unsigned short>, this, realRoI, _1, _2, maskImg, originalImg, masked, maskInvert, mix) );
             break;
-        case 3:
-            applyMaskMixForSrcComponents<3>(realRoI, maskImg, originalImg, masked, maskInvert, mix);
+        case eImageBitDepthHalf:
+            ImageRow::processRowBands( realRoI, boost::bind(&Image::applyMaskMixRows<Half>, this, realRoI, _1, _2, maskImg, originalImg, masked, maskInvert, mix) );
             break;
-        case 4:
-            applyMaskMixForSrcComponents<4>(realRoI, maskImg, originalImg, masked, maskInvert, mix);
+        case eImageBitDepthFloat:
+            ImageRow::processRowBands( realRoI, boost::bind(&Image::applyMaskMixRows<float>, this, realRoI, _1, _2, maskImg, originalImg, masked, maskInvert, mix) );
             break;
         default:
+            assert(false);
             break;
     }
     
@@ -0,0 +1,740 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ImageRow.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+#include <cstring> // memcpy
+
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+
+#include "Engine/AppManager.h"
+#include "Engine/TaskScheduler.h"
+
+// SSE2 is part of x86-64
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define NATRON_IMAGEROW_SSE2
+#include <emmintrin.h>
+#endif
+
+//#define NATRON_COPY_CHANNELS_UNPREMULT
+
+///Rois smaller than this many pixels are processed by the calling thread
+#define NATRON_IMAGEROW_PARALLEL_MIN_PIXELS (256 * 256)
+
+///Minimum number of rows in a band of a roi processed in parallel
+#define NATRON_IMAGEROW_BAND_MIN_ROWS 16
+
+NATRON_NAMESPACE_ENTER;
+
+namespace ImageRow {
+void
+processRowBands(const RectI& roi,
+                const boost::function2<void, int, int>& processRows)
+{
+    TaskScheduler* scheduler = appPTR ? appPTR->getTaskScheduler() : 0;
+    int nBands = 1;
+
+    if ( scheduler && (scheduler->maxThreadCount() > 1) && (roi.area() >= NATRON_IMAGEROW_PARALLEL_MIN_PIXELS) ) {
+        nBands = std::min( scheduler->maxThreadCount() * 2, roi.height() / NATRON_IMAGEROW_BAND_MIN_ROWS );
+    }
+    if (nBands <= 1) {
+        processRows(roi.y1, roi.y2);
+
+        return;
+    }
+    TaskGroup bands(scheduler);
+    for (int i = 0; i < nBands; ++i) {
+        const int y1 = roi.y1 + (int)( (long long)roi.height() * i / nBands );
+        const int y2 = roi.y1 + (int)( (long long)roi.height() * (i + 1) / nBands );
+        bands.run( boost::bind(processRows, y1, y2) );
+    }
+    bands.wait();
+}
+
+namespace {
+template <typename PIX>
+struct PixelMax
+{
+    static const int value = 1;
+};
+
+template <>
+struct PixelMax<unsigned char>
+{
+    static const int value = 255;
+};
+
+template <>
+struct PixelMax<unsigned short>
+{
+    static const int value = 65535;
+};
+
+/// Same as Image::clampIfInt
+template <typename PIX>
+PIX clampPixel(float v);
+
+template <>
+inline unsigned char
+clampPixel(float v)
+{
+    return (unsigned char)std::min(std::max(v, 0.f), 255.f);
+}
+
+template <>
+inline unsigned short
+clampPixel(float v)
+{
+    return (unsigned short)std::min(std::max(v, 0.f), 65535.f);
+}
+
+template <>
+inline Half
+clampPixel(float v)
+{
+    return Half(v);
+}
+
+template <>
+inline float
+clampPixel(float v)
+{
+    return v;
+}
+
+template <typename PIX>
+void
+maskMixRowScalar(const PIX* src,
+                 int srcNComps,
+                 const PIX* mask,
+                 bool maskInvert,
+                 float mix,
+                 int width,
+                 PIX* dst,
+                 int dstNComps)
+{
+    const int maxValue = PixelMax<PIX>::value;
+
+    for (int x = 0; x < width; ++x, dst += dstNComps) {
+        float alpha = mix;
+        if (mask) {
+            float maskScale = float(mask[x]) / float(maxValue);
+            if (maskInvert) {
+                maskScale = 1.f - maskScale;
+            }
+            alpha = mix * maskScale;
+        }
+        if (src) {
+            for (int c = 0; c < dstNComps && c < srcNComps; ++c) {
+                const float v = float(dst[c]) * alpha + (1.f - alpha) * float(src[c]);
+                dst[c] = clampPixel<PIX>(v);
+            }
+            src += srcNComps;
+        } else {
+            for (int c = 0; c < dstNComps; ++c) {
+                dst[c] = clampPixel<PIX>(float(dst[c]) * alpha);
+            }
+        }
+    }
+}
+
+template <typename PIX>
+void
+premultRowScalar(bool doPremult,
+                 int width,
+                 PIX* pixels)
+{
+    const int maxValue = PixelMax<PIX>::value;
+
+    for (int x = 0; x < width; ++x, pixels += 4) {
+        const float a = float(pixels[3]);
+        if (doPremult) {
+            for (int c = 0; c < 3; ++c) {
+                pixels[c] = clampPixel<PIX>( (float(pixels[c]) * a) / maxValue );
+            }
+        } else if (a != 0) {
+            for (int c = 0; c < 3; ++c) {
+                pixels[c] = clampPixel<PIX>( (float(pixels[c]) * maxValue) / a );
+            }
+        }
+    }
+}
+
+/// The value of an unprocessed color channel of dst, from the channel of src srcC
+inline float
+unProcessedChannelValue(float srcC,
+                        float srcA,
+                        float dstAorig,
+                        int maxValue,
+                        bool doA,
+                        bool premult,
+                        bool originalPremult)
+{
+    if (originalPremult) {
+        if (srcA == 0) {
+            return srcC; // don't try to unpremult, just copy
+        } else if (premult) {
+            if (doA) {
+                return srcC; // dst will have same alpha as src, just copy src
+            } else {
+                return (srcC / srcA) * dstAorig; // dst keeps its alpha, unpremult src and repremult
+            }
+        } else {
+            return (srcC / srcA) * maxValue; // dst is not premultiplied, unpremult src
+        }
+    } else if (premult) {
+        if (doA) {
+            return (srcC / maxValue) * srcA; // dst will have same alpha as src, just premult src with its alpha
+        } else {
+            return (srcC / maxValue) * dstAorig; // dst keeps its alpha, premult src with dst's alpha
+        }
+    }
+
+    return srcC; // neither src nor dst is premultiplied
+}
+
+template <typename PIX>
+void
+copyUnProcessedChannelsRowScalar(const PIX* src,
+                                 int srcNComps,
+                                 bool originalPremult,
+                                 std::bitset<4> processChannels,
+                                 bool premult,
+                                 int width,
+                                 PIX* dst,
+                                 int dstNComps)
+{
+    const int maxValue = PixelMax<PIX>::value;
+    const bool doChannel[3] = {
+        !processChannels[0] && (dstNComps >= 2),
+        !processChannels[1] && (dstNComps >= 2),
+        !processChannels[2] && (dstNComps >= 3)
+    };
+    const bool doA = !processChannels[3] && (dstNComps == 1 || dstNComps == 4);
+
+    assert(srcNComps == 1 || srcNComps == 4 || !originalPremult); // only A or RGBA can be premult
+    assert(dstNComps == 1 || dstNComps == 4 || !premult); // only A or RGBA can be premult
+
+    for (int x = 0; x < width; ++x, dst += dstNComps) {
+        const PIX* s = src ? src + x * srcNComps : 0;
+        float srcA = s ? maxValue : 0; // be opaque for anything that doesn't contain alpha
+        if ( s && (srcNComps == 1 || srcNComps == 4) ) {
+            srcA = float(s[srcNComps - 1]);
+        }
+        float dstAorig = maxValue;
+        if (dstNComps == 1 || dstNComps == 4) {
+            dstAorig = float(dst[dstNComps - 1]);
+        }
+        for (int c = 0; c < 3; ++c) {
+            if (!doChannel[c]) {
+                continue;
+            }
+            if ( (srcNComps == 1) || !s || (c >= srcNComps) ) {
+                dst[c] = 0;
+            } else {
+                dst[c] = clampPixel<PIX>( unProcessedChannelValue(float(s[c]), srcA, dstAorig, maxValue, doA, premult, originalPremult) );
+            }
+        }
+        if (doA) {
+#ifdef NATRON_COPY_CHANNELS_UNPREMULT
+            if ( premult && (dstAorig != 0) ) {
+                // unpremult, then premult
+                for (int c = 0; c < 3; ++c) {
+                    if ( (dstNComps >= 2) && !doChannel[c] ) {
+                        dst[c] = clampPixel<PIX>( (float(dst[c]) / dstAorig) * srcA );
+                    }
+                }
+            }
+#endif
+            if ( (dstNComps == 1) || (dstNComps == 4) ) {
+                dst[dstNComps - 1] = clampPixel<PIX>(srcA);
+            }
+        }
+    }
+} // copyUnProcessedChannelsRowScalar
+
+#ifdef NATRON_IMAGEROW_SSE2
+/// Load 4 contiguous channels as floats
+inline __m128
+loadFloats(const float* p)
+{
+    return _mm_loadu_ps(p);
+}
+
+inline __m128
+loadFloats(const unsigned short* p)
+{
+    return _mm_cvtepi32_ps( _mm_unpacklo_epi16( _mm_loadl_epi64( (const __m128i*)p ), _mm_setzero_si128() ) );
+}
+
+inline __m128
+loadFloats(const unsigned char* p)
+{
+    int bytes;
+
+    std::memcpy(&bytes, p, 4);
+    const __m128i zero = _mm_setzero_si128();
+
+    return _mm_cvtepi32_ps( _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero) );
+}
+
+/// Store 4 contiguous channels, clamped and truncated for integer depths like clampPixel
+inline void
+storeFloats(float* p,
+            __m128 v)
+{
+    _mm_storeu_ps(p, v);
+}
+
+inline void
+storeFloats(unsigned short* p,
+            __m128 v)
+{
+    v = _mm_min_ps( _mm_max_ps( v, _mm_setzero_ps() ), _mm_set1_ps(65535.f) );
+    // SSE2 has no unsigned saturated pack from 32 to 16 bits: the values are shifted to the signed range and back
+    const __m128i bias = _mm_set1_epi32(0x8000);
+    const __m128i shifted = _mm_sub_epi32(_mm_cvttps_epi32(v), bias);
+    const __m128i packed = _mm_add_epi16( _mm_packs_epi32(shifted, shifted), _mm_set1_epi16( (short)0x8000 ) );
+    _mm_storel_epi64( (__m128i*)p, packed );
+}
+
+inline void
+storeFloats(unsigned char* p,
+            __m128 v)
+{
+    v = _mm_min_ps( _mm_max_ps( v, _mm_setzero_ps() ), _mm_set1_ps(255.f) );
+    __m128i packed = _mm_cvttps_epi32(v);
+    packed = _mm_packs_epi32(packed, packed);
+    packed = _mm_packus_epi16(packed, packed);
+    const int bytes = _mm_cvtsi128_si32(packed);
+    std::memcpy(p, &bytes, 4);
+}
+
+/// Selects the lanes of a where mask is set and the lanes of b elsewhere
+inline __m128
+selectLanes(__m128 mask,
+            __m128 a,
+            __m128 b)
+{
+    return _mm_or_ps( _mm_and_ps(mask, a), _mm_andnot_ps(mask, b) );
+}
+
+/// The alphas of the k-th vector of 4 channels in a block of 4 pixels of nComps channels, given the alphas of the 4 pixels
+template <int nComps>
+__m128 alphaOfVector(__m128 alpha, int k);
+
+template <>
+inline __m128
+alphaOfVector<1>(__m128 alpha,
+                 int /*k*/)
+{
+    return alpha;
+}
+
+template <>
+inline __m128
+alphaOfVector<3>(__m128 alpha,
+                 int k)
+{
+    switch (k) {
+    case 0:
+
+        return _mm_shuffle_ps( alpha, alpha, _MM_SHUFFLE(1, 0, 0, 0) );
+    case 1:
+
+        return _mm_shuffle_ps( alpha, alpha, _MM_SHUFFLE(2, 2, 1, 1) );
+    default:
+
+        return _mm_shuffle_ps( alpha, alpha, _MM_SHUFFLE(3, 3, 3, 2) );
+    }
+}
+
+template <>
+inline __m128
+alphaOfVector<4>(__m128 alpha,
+                 int k)
+{
+    switch (k) {
+    case 0:
+
+        return _mm_shuffle_ps( alpha, alpha, _MM_SHUFFLE(0, 0, 0, 0) );
+    case 1:
+
+        return _mm_shuffle_ps( alpha, alpha, _MM_SHUFFLE(1, 1, 1, 1) );
+    case 2:
+
+        return _mm_shuffle_ps( alpha, alpha, _MM_SHUFFLE(2, 2, 2, 2) );
+    default:
+
+        return _mm_shuffle_ps( alpha, alpha, _MM_SHUFFLE(3, 3, 3, 3) );
+    }
+}
+
+/// Returns the number of pixels done, the caller finishes the row with the scalar loop
+template <typename PIX, int nComps>
+int
+maskMixRowSSE2(const PIX* src,
+               const PIX* mask,
+               bool maskInvert,
+               float mix,
+               int width,
+               PIX* dst)
+{
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 maxValue = _mm_set1_ps( (float)PixelMax<PIX>::value );
+    const __m128 mixV = _mm_set1_ps(mix);
+    int x = 0;
+
+    // blocks of 4 pixels are nComps vectors of 4 channels
+    for (; x + 4 <= width; x += 4) {
+        __m128 alpha = mixV;
+        if (mask) {
+            __m128 maskScale = _mm_div_ps(loadFloats(mask + x), maxValue);
+            if (maskInvert) {
+                maskScale = _mm_sub_ps(one, maskScale);
+            }
+            alpha = _mm_mul_ps(mixV, maskScale);
+        }
+        PIX* d = dst + x * nComps;
+        const PIX* s = src ? src + x * nComps : 0;
+        for (int k = 0; k < nComps; ++k, d += 4) {
+            const __m128 a = alphaOfVector<nComps>(alpha, k);
+            __m128 v = _mm_mul_ps(loadFloats(d), a);
+            if (s) {
+                v = _mm_add_ps( v, _mm_mul_ps( _mm_sub_ps(one, a), loadFloats(s) ) );
+                s += 4;
+            }
+            storeFloats(d, v);
+        }
+    }
+
+    return x;
+}
+
+template <typename PIX>
+int
+premultRowSSE2(bool doPremult,
+               int width,
+               PIX* pixels)
+{
+    const __m128 maxValue = _mm_set1_ps( (float)PixelMax<PIX>::value );
+    const __m128 colorLanes = _mm_castsi128_ps( _mm_set_epi32(0, -1, -1, -1) );
+
+    for (int x = 0; x < width; ++x, pixels += 4) {
+        const __m128 v = loadFloats(pixels);
+        const __m128 a = _mm_shuffle_ps( v, v, _MM_SHUFFLE(3, 3, 3, 3) );
+        __m128 r;
+        __m128 changed = colorLanes;
+        if (doPremult) {
+            r = _mm_div_ps(_mm_mul_ps(v, a), maxValue);
+        } else {
+            r = _mm_div_ps(_mm_mul_ps(v, maxValue), a);
+            changed = _mm_and_ps( changed, _mm_cmpneq_ps( a, _mm_setzero_ps() ) );
+        }
+        storeFloats( pixels, selectLanes(changed, r, v) );
+    }
+
+    return width;
+}
+
+/// RGBA to RGBA, computes all the lanes of unProcessedChannelValue and keeps the ones of the unprocessed channels
+template <typename PIX>
+int
+copyUnProcessedChannelsRowSSE2(const PIX* src,
+                               bool originalPremult,
+                               std::bitset<4> processChannels,
+                               bool premult,
+                               int width,
+                               PIX* dst)
+{
+    const bool doA = !processChannels[3];
+    const __m128 maxValue = _mm_set1_ps( (float)PixelMax<PIX>::value );
+    const __m128 alphaLane = _mm_castsi128_ps( _mm_set_epi32(-1, 0, 0, 0) );
+    const __m128 unprocessedLanes = _mm_castsi128_ps( _mm_set_epi32(doA ? -1 : 0,
+                                                                     processChannels[2] ? 0 : -1,
+                                                                     processChannels[1] ? 0 : -1,
+                                                                     processChannels[0] ? 0 : -1) );
+
+    for (int x = 0; x < width; ++x, src += 4, dst += 4) {
+        const __m128 s = loadFloats(src);
+        const __m128 d = loadFloats(dst);
+        const __m128 srcA = _mm_shuffle_ps( s, s, _MM_SHUFFLE(3, 3, 3, 3) );
+        __m128 r = s;
+        if (originalPremult) {
+            if (!premult) {
+                r = _mm_mul_ps(_mm_div_ps(s, srcA), maxValue);
+            } else if (!doA) {
+                r = _mm_mul_ps( _mm_div_ps(s, srcA), _mm_shuffle_ps( d, d, _MM_SHUFFLE(3, 3, 3, 3) ) );
+            }
+            r = selectLanes( _mm_cmpeq_ps( srcA, _mm_setzero_ps() ), s, r );
+        } else if (premult) {
+            r = _mm_mul_ps( _mm_div_ps(s, maxValue), doA ? srcA : _mm_shuffle_ps( d, d, _MM_SHUFFLE(3, 3, 3, 3) ) );
+        }
+        // the alpha of dst becomes the alpha of src
+        r = selectLanes(alphaLane, s, r);
+        storeFloats( dst, selectLanes(unprocessedLanes, r, d) );
+    }
+
+    return width;
+}
+
+#endif // NATRON_IMAGEROW_SSE2
+
+template <typename PIX>
+void
+maskMixRowForDepth(const PIX* src,
+                   int srcNComps,
+                   const PIX* mask,
+                   bool maskInvert,
+                   float mix,
+                   int width,
+                   PIX* dst,
+                   int dstNComps,
+                   Color::SIMDLevelEnum simd)
+{
+    int done = 0;
+
+#ifdef NATRON_IMAGEROW_SSE2
+    if ( (simd >= Color::eSIMDLevelSSE2) && (!src || srcNComps == dstNComps) ) {
+        switch (dstNComps) {
+        case 1:
+            done = maskMixRowSSE2<PIX, 1>(src, mask, maskInvert, mix, width, dst);
+            break;
+        case 3:
+            done = maskMixRowSSE2<PIX, 3>(src, mask, maskInvert, mix, width, dst);
+            break;
+        case 4:
+            done = maskMixRowSSE2<PIX, 4>(src, mask, maskInvert, mix, width, dst);
+            break;
+        default:
+            break;
+        }
+    }
+#else
+    (void)simd;
+#endif
+    maskMixRowScalar(src ? src + done * srcNComps : 0, srcNComps, mask ? mask + done : 0, maskInvert, mix,
+                     width - done, dst + done * dstNComps, dstNComps);
+}
+
+template <typename PIX>
+void
+premultRowForDepth(bool doPremult,
+                   int width,
+                   PIX* pixels,
+                   Color::SIMDLevelEnum simd)
+{
+    int done = 0;
+
+#ifdef NATRON_IMAGEROW_SSE2
+    if (simd >= Color::eSIMDLevelSSE2) {
+        done = premultRowSSE2(doPremult, width, pixels);
+    }
+#else
+    (void)simd;
+#endif
+    premultRowScalar(doPremult, width - done, pixels + done * 4);
+}
+
+template <typename PIX>
+void
+copyUnProcessedChannelsRowForDepth(const PIX* src,
+                                   int srcNComps,
+                                   bool originalPremult,
+                                   std::bitset<4> processChannels,
+                                   bool premult,
+                                   int width,
+                                   PIX* dst,
+                                   int dstNComps,
+                                   Color::SIMDLevelEnum simd)
+{
+    int done = 0;
+
+#if defined(NATRON_IMAGEROW_SSE2) && !defined(NATRON_COPY_CHANNELS_UNPREMULT)
+    if ( (simd >= Color::eSIMDLevelSSE2) && src && (srcNComps == 4) && (dstNComps == 4) ) {
+        done = copyUnProcessedChannelsRowSSE2(src, originalPremult, processChannels, premult, width, dst);
+    }
+#else
+    (void)simd;
+#endif
+    copyUnProcessedChannelsRowScalar(src ? src + done * srcNComps : 0, srcNComps, originalPremult, processChannels, premult,
+                                     width - done, dst + done * dstNComps, dstNComps);
+}
+} // anon namespace
+
+void
+maskMixRow(const unsigned char* src,
+           int srcNComps,
+           const unsigned char* mask,
+           bool maskInvert,
+           float mix,
+           int width,
+           unsigned char* dst,
+           int dstNComps,
+           Color::SIMDLevelEnum simd)
+{
+    maskMixRowForDepth(src, srcNComps, mask, maskInvert, mix, width, dst, dstNComps, simd);
+}
+
+void
+maskMixRow(const unsigned short* src,
+           int srcNComps,
+           const unsigned short* mask,
+           bool maskInvert,
+           float mix,
+           int width,
+           unsigned short* dst,
+           int dstNComps,
+           Color::SIMDLevelEnum simd)
+{
+    maskMixRowForDepth(src, srcNComps, mask, maskInvert, mix, width, dst, dstNComps, simd);
+}
+
+void
+maskMixRow(const Half* src,
+           int srcNComps,
+           const Half* mask,
+           bool maskInvert,
+           float mix,
+           int width,
+           Half* dst,
+           int dstNComps,
+           Color::SIMDLevelEnum /*simd*/)
+{
+    maskMixRowScalar(src, srcNComps, mask, maskInvert, mix, width, dst, dstNComps);
+}
+
+void
+maskMixRow(const float* src,
+           int srcNComps,
+           const float* mask,
+           bool maskInvert,
+           float mix,
+           int width,
+           float* dst,
+           int dstNComps,
+           Color::SIMDLevelEnum simd)
+{
+    maskMixRowForDepth(src, srcNComps, mask, maskInvert, mix, width, dst, dstNComps, simd);
+}
+
+void
+premultRow(bool doPremult,
+           int width,
+           unsigned char* pixels,
+           Color::SIMDLevelEnum simd)
+{
+    premultRowForDepth(doPremult, width, pixels, simd);
+}
+
+void
+premultRow(bool doPremult,
+           int width,
+           unsigned short* pixels,
+           Color::SIMDLevelEnum simd)
+{
+    premultRowForDepth(doPremult, width, pixels, simd);
+}
+
+void
+premultRow(bool doPremult,
+           int width,
+           Half* pixels,
+           Color::SIMDLevelEnum /*simd*/)
+{
+    premultRowScalar(doPremult, width, pixels);
+}
+
+void
+premultRow(bool doPremult,
+           int width,
+           float* pixels,
+           Color::SIMDLevelEnum simd)
+{
+    premultRowForDepth(doPremult, width, pixels, simd);
+}
+
+void
+copyUnProcessedChannelsRow(const unsigned char* src,
+                           int srcNComps,
+                           bool originalPremult,
+                           std::bitset<4> processChannels,
+                           bool premult,
+                           int width,
+                           unsigned char* dst,
+                           int dstNComps,
+                           Color::SIMDLevelEnum simd)
+{
+    copyUnProcessedChannelsRowForDepth(src, srcNComps, originalPremult, processChannels, premult, width, dst, dstNComps, simd);
+}
+
+void
+copyUnProcessedChannelsRow(const unsigned short* src,
+                           int srcNComps,
+                           bool originalPremult,
+                           std::bitset<4> processChannels,
+                           bool premult,
+                           int width,
+                           unsigned short* dst,
+                           int dstNComps,
+                           Color::SIMDLevelEnum simd)
+{
+    copyUnProcessedChannelsRowForDepth(src, srcNComps, originalPremult, processChannels, premult, width, dst, dstNComps, simd);
+}
+
+void
+copyUnProcessedChannelsRow(const Half* src,
+                           int srcNComps,
+                           bool originalPremult,
+                           std::bitset<4> processChannels,
+                           bool premult,
+                           int width,
+                           Half* dst,
+                           int dstNComps,
+                           Color::SIMDLevelEnum /*simd*/)
+{
+    copyUnProcessedChannelsRowScalar(src, srcNComps, originalPremult, processChannels, premult, width, dst, dstNComps);
+}
+
+void
+copyUnProcessedChannelsRow(const float* src,
+                           int srcNComps,
+                           bool originalPremult,
+                           std::bitset<4> processChannels,
+                           bool premult,
+                           int width,
+                           float* dst,
+                           int dstNComps,
+                           Color::SIMDLevelEnum simd)
+{
+    copyUnProcessedChannelsRowForDepth(src, srcNComps, originalPremult, processChannels, premult, width, dst, dstNComps, simd);
+}
+} // namespace ImageRow
+
+NATRON_NAMESPACE_EXIT;
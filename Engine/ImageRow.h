@@ -0,0 +1,129 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_IMAGEROW_H
+#define NATRON_ENGINE_IMAGEROW_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <bitset>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/function.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+#include "Engine/Half.h"
+#include "Engine/Lut.h"
+#include "Engine/RectI.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief The row kernels of the post-processing Image applies after a render: mask and mix, premultiplication
+ * and restoring the unprocessed channels. Each one processes width contiguous pixels of one row, the value of
+ * the maximum channel being 255 for bytes, 65535 for shorts and 1 for Half and float.
+ *
+ * The SSE2 versions give exactly the result of the scalar loop, the SIMD level is only exposed for testing.
+ * Half rows are always processed by the scalar loop.
+ **/
+namespace ImageRow {
+/**
+ * @brief Calls processRows(y1, y2) on bands of rows covering [roi.y1, roi.y2). Large rois are split in bands
+ * processed in parallel on the TaskScheduler, small ones are processed by the calling thread in a single call.
+ * The bands must write to distinct pixels and the locks of the images be held by the caller.
+ **/
+void processRowBands(const RectI& roi, const boost::function2<void, int, int>& processRows);
+
+/**
+ * @brief dst = dst * alpha + (1 - alpha) * src for the first srcNComps channels of dst, with alpha = mix * mask[x]
+ * (or mix * (1 - mask[x]) if maskInvert), mask being a row of a single channel image. If mask is NULL alpha is mix
+ * for the whole row. If src is NULL all the channels of dst are multiplied by alpha.
+ * Integer depths are clamped to their range.
+ *
+ * The SSE2 versions handle 1, 3 and 4 components with src NULL or having as many components as dst.
+ **/
+void maskMixRow(const unsigned char* src, int srcNComps, const unsigned char* mask, bool maskInvert, float mix,
+                int width, unsigned char* dst, int dstNComps,
+                Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+void maskMixRow(const unsigned short* src, int srcNComps, const unsigned short* mask, bool maskInvert, float mix,
+                int width, unsigned short* dst, int dstNComps,
+                Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+void maskMixRow(const Half* src, int srcNComps, const Half* mask, bool maskInvert, float mix,
+                int width, Half* dst, int dstNComps,
+                Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+void maskMixRow(const float* src, int srcNComps, const float* mask, bool maskInvert, float mix,
+                int width, float* dst, int dstNComps,
+                Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+/**
+ * @brief Premultiplies (or unpremultiplies if doPremult is false) the color channels of width RGBA pixels by
+ * their alpha. Pixels with a null alpha are left untouched by the unpremultiplication.
+ **/
+void premultRow(bool doPremult, int width, unsigned char* pixels,
+                Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+void premultRow(bool doPremult, int width, unsigned short* pixels,
+                Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+void premultRow(bool doPremult, int width, Half* pixels,
+                Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+void premultRow(bool doPremult, int width, float* pixels,
+                Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+/**
+ * @brief Copies the channels of src that are not in processChannels to dst, converting them from the
+ * premultiplication state of src (originalPremult) to the one of dst (premult): this is what
+ * Image::copyUnProcessedChannels does for a row. If src is NULL the unprocessed channels are set to 0.
+ *
+ * The SSE2 versions handle RGBA to RGBA, the other layouts are plain channel copies.
+ **/
+void copyUnProcessedChannelsRow(const unsigned char* src, int srcNComps, bool originalPremult,
+                                std::bitset<4> processChannels, bool premult,
+                                int width, unsigned char* dst, int dstNComps,
+                                Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+void copyUnProcessedChannelsRow(const unsigned short* src, int srcNComps, bool originalPremult,
+                                std::bitset<4> processChannels, bool premult,
+                                int width, unsigned short* dst, int dstNComps,
+                                Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+void copyUnProcessedChannelsRow(const Half* src, int srcNComps, bool originalPremult,
+                                std::bitset<4> processChannels, bool premult,
+                                int width, Half* dst, int dstNComps,
+                                Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+void copyUnProcessedChannelsRow(const float* src, int srcNComps, bool originalPremult,
+                                std::bitset<4> processChannels, bool premult,
+                                int width, float* dst, int dstNComps,
+                                Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+} // namespace ImageRow
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_IMAGEROW_H
@@ -398,25 +398,21 @@ Interpolation::solveQuartic(double c0,
     return num;
 } // solveQuartic
 
-/**
- * @brief Interpolates using the control points P0(t0,v0) , P3(t3,v3)
- * and the derivatives P1(t1,v1) (being the derivative at P0 with respect to
- * t \in [t1,t2]) and P2(t2,v2) (being the derivative at P3 with respect to
- * t \in [t1,t2]) the value at 'currentTime' using the
- * interpolation method "interp".
- * Note that for CATMULL-ROM you must use the function interpolate_catmullRom
- * which will compute the derivatives for you.
- **/
-double
-Interpolation::interpolate(double tcur,
-                    const double vcur,                     //start control point
-                    const double vcurDerivRight,        //being the derivative dv/dt at tcur
-                    const double vnextDerivLeft,        //being the derivative dv/dt at tnext
-                    double tnext,
-                    const double vnext,                      //end control point
-                    double currentTime,
-                    KeyframeTypeEnum interp,
-                    KeyframeTypeEnum interpNext)
+void
+Interpolation::cubicCoefficients(double tcur,
+                                 const double vcur,                     //start control point
+                                 const double vcurDerivRight,        //being the derivative dv/dt at tcur
+                                 const double vnextDerivLeft,        //being the derivative dv/dt at tnext
+                                 double tnext,
+                                 const double vnext,                      //end control point
+                                 KeyframeTypeEnum interp,
+                                 KeyframeTypeEnum interpNext,
+                                 double *tstart,
+                                 double *tend,
+                                 double *c0,
+                                 double *c1,
+                                 double *c2,
+                                 double *c3)
 {
     double P0 = vcur;
     double P3 = vnext;
@@ -424,8 +420,6 @@ Interpolation::interpolate(double tcur,
     double P0pr = vcurDerivRight * (tnext - tcur); // normalize for x \in [0,1]
     double P3pl = vnextDerivLeft * (tnext - tcur); // normalize for x \in [0,1]
 
-    // if the following is true, this makes the special case for eKeyframeTypeConstant at tnext useless, and we can always use a cubic - the strict "currentTime < tnext" is the key
-    assert( ( (interp == eKeyframeTypeNone) || (tcur <= currentTime) ) && ( (currentTime < tnext) || (interpNext == eKeyframeTypeNone) ) );
     // after the last / before the first keyframe, derivatives are wrt currentTime (i.e. non-normalized)
     if (interp == eKeyframeTypeNone) {
         // virtual previous frame at t-1
@@ -443,8 +437,35 @@ Interpolation::interpolate(double tcur,
         P3 = P0 + P0pr;
         tnext = tcur + 1;
     }
+    *tstart = tcur;
+    *tend = tnext;
+    hermiteToCubicCoeffs(P0, P0pr, P3pl, P3, c0, c1, c2, c3);
+}
+
+/**
+ * @brief Interpolates using the control points P0(t0,v0) , P3(t3,v3)
+ * and the derivatives P1(t1,v1) (being the derivative at P0 with respect to
+ * t \in [t1,t2]) and P2(t2,v2) (being the derivative at P3 with respect to
+ * t \in [t1,t2]) the value at 'currentTime' using the
+ * interpolation method "interp".
+ * Note that for CATMULL-ROM you must use the function interpolate_catmullRom
+ * which will compute the derivatives for you.
+ **/
+double
+Interpolation::interpolate(double tcur,
+                    const double vcur,                     //start control point
+                    const double vcurDerivRight,        //being the derivative dv/dt at tcur
+                    const double vnextDerivLeft,        //being the derivative dv/dt at tnext
+                    double tnext,
+                    const double vnext,                      //end control point
+                    double currentTime,
+                    KeyframeTypeEnum interp,
+                    KeyframeTypeEnum interpNext)
+{
+    // if the following is true, this makes the special case for eKeyframeTypeConstant at tnext useless, and we can always use a cubic - the strict "currentTime < tnext" is the key
+    assert( ( (interp == eKeyframeTypeNone) || (tcur <= currentTime) ) && ( (currentTime < tnext) || (interpNext == eKeyframeTypeNone) ) );
     double c0, c1, c2, c3;
-    hermiteToCubicCoeffs(P0, P0pr, P3pl, P3, &c0, &c1, &c2, &c3);
+    cubicCoefficients(tcur, vcur, vcurDerivRight, vnextDerivLeft, tnext, vnext, interp, interpNext, &tcur, &tnext, &c0, &c1, &c2, &c3);
 
     const double t = (currentTime - tcur) / (tnext - tcur);
     double ret = cubicEval(c0, c1, c2, c3, t);
@@ -48,6 +48,20 @@ double interpolate(double tcur, const double vcur, //start control point
                    KeyframeTypeEnum interp,
                    KeyframeTypeEnum interpNext) WARN_UNUSED_RETURN;
 
+/**
+ * @brief Computes the cubic that interpolate() evaluates between the two control points: the value at
+ * currentTime is c0 + c1 * x + c2 * x^2 + c3 * x^3 with x = (currentTime - tstart) / (tend - tstart).
+ * tstart and tend differ from tcur and tnext before the first and after the last keyframe.
+ **/
+void cubicCoefficients(double tcur, const double vcur, //start control point
+                       const double vcurDerivRight, //being the derivative dv/dt at tcur
+                       const double vnextDerivLeft, //being the derivative dv/dt at tnext
+                       double tnext, const double vnext, //end control point
+                       KeyframeTypeEnum interp,
+                       KeyframeTypeEnum interpNext,
+                       double *tstart, double *tend,
+                       double *c0, double *c1, double *c2, double *c3);
+
 /// derive at currentTime. The derivative is with respect to currentTime
 double derive(double tcur, const double vcur, //start control point
               const double vcurDerivRight, //being the derivative dv/dt at tcur
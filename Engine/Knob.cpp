@@ -27,6 +27,7 @@
 
 #include <algorithm> // min, max
 #include <cassert>
+#include <cstring>
 #include <stdexcept>
 
 #include <QtCore/QDataStream>
@@ -46,6 +47,7 @@
 #include "Engine/KnobSerialization.h"
 #include "Engine/KnobTypes.h"
 #include "Engine/LibraryBinary.h"
+#include "Engine/NativeExpression.h"
 #include "Engine/Node.h"
 #include "Engine/Project.h"
 #include "Engine/StringAnimationManager.h"
@@ -207,11 +209,19 @@ struct Expr
     ///The list of pair<knob, dimension> dpendencies for an expression
     std::list< std::pair<KnobI*,int> > dependencies;
     
-    //PyObject* code;
+    ///The compiled code evaluating to the Python function of the expression, so that it is not parsed again
+    ///each time the expression is evaluated. This is a new ref, owned by the Expr, accessed under the GIL
+    PyObject* code;
     
-    Expr() : expression(), originalExpression(), hasRet(false) /*, code(0)*/{}
+    ///If the expression is simple enough, its native version which is evaluated without Python
+    boost::shared_ptr<NativeExpression> native;
+    
+    Expr() : expression(), originalExpression(), hasRet(false), code(0), native() {}
 };
 
+///Prefix of the script returned by validateExpression, the rest of the script is the fully qualified name of the function
+static const char* kExpressionRetPrefix = "ret = ";
+
 
 struct KnobHelperPrivate
 {
@@ -391,7 +401,20 @@ KnobHelper::KnobHelper(KnobHolder* holder,
 
 KnobHelper::~KnobHelper()
 {
-    
+    bool hasCode = false;
+    for (std::size_t i = 0; i < _imp->expressions.size(); ++i) {
+        if (_imp->expressions[i].code) {
+            hasCode = true;
+            break;
+        }
+    }
+    if (hasCode && appPTR && Py_IsInitialized()) {
+        PythonGILLocker pgl;
+        for (std::size_t i = 0; i < _imp->expressions.size(); ++i) {
+            Py_XDECREF(_imp->expressions[i].code);
+            _imp->expressions[i].code = 0;
+        }
+    }
 }
 
 void
@@ -1304,6 +1327,13 @@ KnobHelper::evaluateValueChange(int dimension,
     
     bool guiFrozen = app && _imp->gui && _imp->gui->isGuiFrozenForPlayback();
 
+    ///Expressions depending on this knob must be re-evaluated, even during playback where listeners are not refreshed.
+    ///Slaves are refreshed by their master which already walked all the listeners recursively.
+    if (reason != eValueChangedReasonTimeChanged && reason != eValueChangedReasonSlaveRefresh) {
+        std::set<std::pair<KnobHelper*,int> > visited;
+        clearListenersExpressionsResults(dimension, &visited);
+    }
+
     /// For eValueChangedReasonTimeChanged we never call the instanceChangedAction and evaluate otherwise it would just throttle
     /// the application responsiveness
     if ((reason != eValueChangedReasonTimeChanged || evaluateValueChangeOnTimeChange()) && _imp->holder) {
@@ -1915,7 +1945,7 @@ KnobHelper::validateExpression(const std::string& expression,int dimension,bool
     ///Try to compile the expression and evaluate it, if it doesn't have a good syntax, throw an exception
     ///with the error.
     std::string error;
-    std::string funcExecScript = "ret = " + exprFuncPrefix + exprFuncName;
+    std::string funcExecScript = kExpressionRetPrefix + exprFuncPrefix + exprFuncName;
 
     {
         EXPR_RECURSION_LEVEL();
@@ -1985,6 +2015,26 @@ KnobHelper::setExpressionInternal(int dimension,const std::string& expression,bo
     std::string exprResult;
     std::string exprCpy = validateExpression(expression, dimension, hasRetVariable,&exprResult);
     
+    ///Compile once the lookup of the function defined by validateExpression, executeExpression will just have to call it
+    assert(exprCpy.compare(0, std::strlen(kExpressionRetPrefix), kExpressionRetPrefix) == 0);
+    std::string functionPath = exprCpy.substr(std::strlen(kExpressionRetPrefix));
+    PyObject* code = Py_CompileString(functionPath.c_str(), "<expression>", Py_eval_input); //< new ref
+    if (!code) {
+#ifdef DEBUG
+        PyErr_Print();
+#else
+        PyErr_Clear();
+#endif
+        throw std::runtime_error("Failed to compile expression");
+    }
+    
+    ///Single-line expressions made only of arithmetic on parameters are evaluated without taking the GIL.
+    ///The Python version is still validated above so that both agree on what is a valid expression
+    boost::shared_ptr<NativeExpression> native;
+    if (!hasRetVariable) {
+        native = NativeExpression::compile(expression, this, dimension);
+    }
+    
     //Set internal fields
 
     {
@@ -1992,9 +2042,8 @@ KnobHelper::setExpressionInternal(int dimension,const std::string& expression,bo
         _imp->expressions[dimension].hasRet = hasRetVariable;
         _imp->expressions[dimension].expression = exprCpy;
         _imp->expressions[dimension].originalExpression = expression;
-        
-        ///This may throw an exception upon failure
-        //Python::compilePyScript(exprCpy, &_imp->expressions[dimension].code);
+        _imp->expressions[dimension].code = code;
+        _imp->expressions[dimension].native = native;
     }
   
 
@@ -2075,8 +2124,9 @@ KnobHelper::clearExpression(int dimension,bool clearResults)
         hadExpression = !_imp->expressions[dimension].originalExpression.empty();
         _imp->expressions[dimension].expression.clear();
         _imp->expressions[dimension].originalExpression.clear();
-        //Py_XDECREF(_imp->expressions[dimension].code); //< new ref
-        //_imp->expressions[dimension].code = 0;
+        Py_XDECREF(_imp->expressions[dimension].code); //< new ref
+        _imp->expressions[dimension].code = 0;
+        _imp->expressions[dimension].native.reset();
     }
     {
         std::list<std::pair<KnobI*,int> > dependencies;
@@ -2160,25 +2210,42 @@ KnobHelper::executeExpression(double time, ViewIdx view, int dimension) const
 {
     
     std::string expr;
+    PyObject* code;
     {
         QMutexLocker k(&_imp->expressionMutex);
         expr = _imp->expressions[dimension].expression;
+        code = _imp->expressions[dimension].code;
+        //The caller holds the GIL, keep the code alive even if the expression is cleared meanwhile
+        Py_XINCREF(code);
     }
     
-    //returns a new ref, this function's documentation is not clear onto what it returns...
-    //https://docs.python.org/2/c-api/veryhigh.html
     PyObject* mainModule = Python::getMainModule();
     PyObject* globalDict = PyModule_GetDict(mainModule);
     
-    std::stringstream ss;
-    ss << expr << '(' << time << ", " <<  view.i << ")\n";
-    std::string script = ss.str();
-    PyObject* v = PyRun_String(script.c_str(), Py_file_input, globalDict, 0);
-    Py_XDECREF(v);
-    
-    
+    ///Evaluating the compiled code only looks-up the function of the expression, which is then called directly:
+    ///no Python source is parsed here
+    PyObject* ret = 0;
+    if (code) {
+#ifdef IS_PYTHON_2
+        PyObject* func = PyEval_EvalCode((PyCodeObject*)code, globalDict, globalDict); //< new ref
+#else
+        PyObject* func = PyEval_EvalCode(code, globalDict, globalDict); //< new ref
+#endif
+        if (func) {
+            ///Integer frames are passed as Python integers, as they were formatted in the script before,
+            ///so that the arithmetic of existing expressions is unchanged
+            if ( (time == (int)time) ) {
+                ret = PyObject_CallFunction(func, (char*)"ii", (int)time, view.i); //< new ref
+            } else {
+                ret = PyObject_CallFunction(func, (char*)"di", time, view.i); //< new ref
+            }
+            Py_DECREF(func);
+        }
+        Py_DECREF(code);
+    }
     
-    if (PyErr_Occurred()) {
+    if (!ret || PyErr_Occurred()) {
+        Py_XDECREF(ret);
 #ifdef DEBUG
         PyErr_Print();
         ///Gui session, do stdout, stderr redirection
@@ -2201,21 +2268,22 @@ KnobHelper::executeExpression(double time, ViewIdx view, int dimension) const
 
         }
 
+#else
+        PyErr_Clear();
 #endif
         throw std::runtime_error("Failed to execute expression");
     }
-    PyObject *ret = PyObject_GetAttrString(mainModule,"ret"); //get our ret variable created above
-    
-    if (!ret || PyErr_Occurred()) {
-#ifdef DEBUG
-        PyErr_Print();
-#endif
-        throw std::runtime_error("return value must be assigned to the \"ret\" variable");
-    }
     return ret;
     
 }
 
+boost::shared_ptr<NativeExpression>
+KnobHelper::getNativeExpression(int dimension) const
+{
+    QMutexLocker k(&_imp->expressionMutex);
+    return _imp->expressions[dimension].native;
+}
+
 std::string
 KnobHelper::getExpression(int dimension) const
 {
@@ -2954,6 +3022,37 @@ KnobHelper::refreshListenersAfterValueChange(ViewIdx view, int dimension)
     } // for all listeners
 }
 
+void
+KnobHelper::clearListenersExpressionsResults(int dimension, std::set<std::pair<KnobHelper*,int> >* visited)
+{
+    ListenerDimsMap listeners;
+    getListeners(listeners);
+    
+    for (ListenerDimsMap::iterator it = listeners.begin(); it!=listeners.end(); ++it) {
+        
+        KnobPtr listener = it->first.lock();
+        KnobHelper* slaveKnob = dynamic_cast<KnobHelper*>(listener.get());
+        if (!slaveKnob) {
+            continue;
+        }
+        
+        for (std::size_t i = 0; i < it->second.size(); ++i) {
+            if (!it->second[i].isListening || !it->second[i].isExpr) {
+                continue;
+            }
+            if (dimension != -1 && it->second[i].targetDim != dimension && it->second[i].targetDim != -1) {
+                continue;
+            }
+            if (!visited->insert(std::make_pair(slaveKnob, (int)i)).second) {
+                continue;
+            }
+            slaveKnob->clearExpressionsResults(i);
+            
+            //call recursively
+            slaveKnob->clearListenersExpressionsResults(i, visited);
+        }
+    } // for all listeners
+}
 
 void
 KnobHelper::cloneExpressions(KnobI* other,int dimension)
@@ -40,6 +40,7 @@
 #include "Engine/Variant.h"
 #include "Engine/AppManager.h"
 #include "Engine/KnobGuiI.h"
+#include "Engine/NativeExpression.h"
 #include "Engine/OverlaySupport.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/EngineFwd.h"
@@ -1231,6 +1232,12 @@ protected:
     
     virtual void refreshListenersAfterValueChange(ViewIdx view, int dimension) OVERRIDE FINAL;
     
+    /**
+     * @brief Clears the cached expression results of all the knobs whose expression depend, directly or through other expressions,
+     * on the given dimension of this knob. Dimensions already cleared are inserted in visited so that cycles are not walked twice.
+     **/
+    void clearListenersExpressionsResults(int dimension, std::set<std::pair<KnobHelper*,int> >* visited);
+    
 public:
     
     virtual bool isExpressionUsingRetVariable(int dimension = 0) const OVERRIDE FINAL WARN_UNUSED_RETURN;
@@ -1331,6 +1338,9 @@ protected:
     
     ///The return value must be Py_DECRREF
     PyObject* executeExpression(double time, ViewIdx view, int dimension) const;
+    
+    ///Returns the version of the expression that can be evaluated without Python, if any
+    boost::shared_ptr<NativeExpression> getNativeExpression(int dimension) const;
 
 public:
 
@@ -1475,11 +1485,14 @@ public:
 
 
     /*
-     For each dimension, the results of the expressions at a given pair <frame,time> is stored so
+     For each dimension, the results of the expressions at a given pair <frame,view> is stored so
      that we're able to get the same value again for the same render.
      Of course, this saved in the project to retrieve the same values between 2 runs of the project.
+     The results are invalidated whenever a parameter the expression depends on changes, see
+     KnobHelper::clearListenersExpressionsResults
      */
-    typedef std::map<double,T> FrameValueMap;
+    typedef std::pair<double,int> FrameViewKey;
+    typedef std::map<FrameViewKey,T> FrameValueMap;
     typedef std::vector<FrameValueMap> ExprResults;
 
     
@@ -1801,6 +1814,12 @@ private:
     
     T evaluateExpression(double time, ViewIdx view, int dimension) const;
     
+    /*
+     * @brief Evaluates the native version of the expression of the given dimension in ret.
+     * Returns false if the expression has no native version and must be run by Python.
+     */
+    bool evaluateNativeExpression(double time, ViewIdx view, int dimension, T* ret) const;
+    
     /*
      * @brief Same as evaluateExpression but expects it to return a PoD
      */
@@ -387,9 +387,41 @@ inline unsigned int hashFunction(unsigned int a)
     return a;
 }
 
+template <typename T>
+bool
+Knob<T>::evaluateNativeExpression(double time, ViewIdx view, int dimension, T* ret) const
+{
+    boost::shared_ptr<NativeExpression> native = getNativeExpression(dimension);
+    if (!native) {
+        return false;
+    }
+    NativeExpression::Value v;
+    if ( !native->evaluate(time, view, &v) ) {
+        *ret = T();
+    } else {
+        ///Same as pyObjectToType, ints are truncated
+        *ret = (T)v.value;
+    }
+    return true;
+}
+
+template <>
+bool
+Knob<std::string>::evaluateNativeExpression(double /*time*/, ViewIdx /*view*/, int /*dimension*/, std::string* /*ret*/) const
+{
+    ///String parameters interpret the result of their expression, they are always run by Python
+    return false;
+}
+
 template <typename T>
 T Knob<T>::evaluateExpression(double time, ViewIdx view, int dimension) const
 {
+    ///Render threads evaluate the native expressions concurrently, without going through the interpreter
+    T nativeRet;
+    if ( evaluateNativeExpression(time, view, dimension, &nativeRet) ) {
+        return nativeRet;
+    }
+    
     PythonGILLocker pgl;
     PyObject *ret;
     
@@ -410,6 +442,15 @@ template <typename T>
 double
 Knob<T>::evaluateExpression_pod(double time, ViewIdx view, int dimension) const
 {
+    boost::shared_ptr<NativeExpression> native = getNativeExpression(dimension);
+    if (native) {
+        NativeExpression::Value v;
+        if ( !native->evaluate(time, view, &v) ) {
+            return 0.;
+        }
+        return v.isInt ? (double)(int)v.value : v.value;
+    }
+    
     PythonGILLocker pgl;
     PyObject *ret;
     
@@ -450,7 +491,7 @@ bool Knob<T>::getValueFromExpression(double time, ViewIdx view, int dimension,bo
     
     {
         QMutexLocker k(&_valueMutex);
-        typename FrameValueMap::iterator found = _exprRes[dimension].find(time);
+        typename FrameValueMap::iterator found = _exprRes[dimension].find(FrameViewKey(time, view.i));
         if (found != _exprRes[dimension].end()) {
             *ret = found->second;
             return true;
@@ -468,7 +509,7 @@ bool Knob<T>::getValueFromExpression(double time, ViewIdx view, int dimension,bo
     }
     
     QMutexLocker k(&_valueMutex);
-    _exprRes[dimension].insert(std::make_pair(time,*ret));
+    _exprRes[dimension].insert(std::make_pair(FrameViewKey(time, view.i),*ret));
     return true;
 
 }
@@ -507,7 +548,7 @@ bool Knob<T>::getValueFromExpression_pod(double time, ViewIdx view, int dimensio
     
     
     QMutexLocker k(&_valueMutex);
-    typename FrameValueMap::iterator found = _exprRes[dimension].find(time);
+    typename FrameValueMap::iterator found = _exprRes[dimension].find(FrameViewKey(time, view.i));
     if (found != _exprRes[dimension].end()) {
         *ret = found->second;
         return true;
@@ -524,7 +565,7 @@ bool Knob<T>::getValueFromExpression_pod(double time, ViewIdx view, int dimensio
     }
     
     //QWriteLocker k(&_valueMutex);
-    _exprRes[dimension].insert(std::make_pair(time,*ret));
+    _exprRes[dimension].insert(std::make_pair(FrameViewKey(time, view.i),*ret));
     return true;
 
 }
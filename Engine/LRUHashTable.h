@@ -219,6 +219,20 @@ public:
         return std::make_pair( key_type(),V() );
     }
 
+    // Returns the least-recently-used value without updating the access record
+    V peekLRU() const
+    {
+        if ( _key_tracker.empty() ) {
+            return V();
+        }
+        typename key_to_value_type::const_iterator it = _key_to_value.find( _key_tracker.front() );
+        if ( ( it == _key_to_value.end() ) || it->second.first.empty() ) {
+            return V();
+        }
+
+        return it->second.first.front();
+    }
+
     unsigned int size()
     {
         return _container.size();
@@ -332,6 +346,17 @@ public:
         return std::make_pair( key_type(),V() );
     }
 
+    // Returns the least-recently-used value without updating the access record
+    V peekLRU() const
+    {
+        typename container_type::right_const_iterator it = _container.right.begin();
+        if ( ( it == _container.right.end() ) || it->first.empty() ) {
+            return V();
+        }
+
+        return it->first.front();
+    }
+
     unsigned int size()
     {
         return _container.size();
@@ -453,6 +478,20 @@ public:
         return std::make_pair( key_type(),V() );
     }
 
+    // Returns the least-recently-used value without updating the access record
+    V peekLRU() const
+    {
+        if ( _key_tracker.empty() ) {
+            return V();
+        }
+        typename key_to_value_type::const_iterator it = _key_to_value.find( _key_tracker.front() );
+        if ( ( it == _key_to_value.end() ) || it->second.first.empty() ) {
+            return V();
+        }
+
+        return it->second.first.front();
+    }
+
     unsigned int size()
     {
         return _key_to_value.size();
@@ -560,6 +599,17 @@ public:
         return std::make_pair( key_type(),V() );
     }
 
+    // Returns the least-recently-used value without updating the access record
+    V peekLRU() const
+    {
+        typename container_type::right_const_iterator it = _container.right.begin();
+        if ( ( it == _container.right.end() ) || it->first.empty() ) {
+            return V();
+        }
+
+        return it->first.front();
+    }
+
     unsigned int size()
     {
         return _container.size();
@@ -663,6 +713,17 @@ public:
         return std::make_pair( key_type(),V() );
     }
 
+    // Returns the least-recently-used value without updating the access record
+    V peekLRU() const
+    {
+        typename container_type::right_const_iterator it = _container.right.begin();
+        if ( ( it == _container.right.end() ) || it->first.empty() ) {
+            return V();
+        }
+
+        return it->first.front();
+    }
+
     unsigned int size()
     {
         return _container.size();
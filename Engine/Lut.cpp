@@ -28,9 +28,26 @@
 #include <algorithm> // min, max
 #include <cassert>
 #include <stdexcept>
+#include <vector>
 
 #include "Engine/RectI.h"
 
+// SSE2 is part of x86-64, AVX2 code is compiled for the functions that need it and only used if the CPU supports it
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define NATRON_LUT_SSE2
+#include <emmintrin.h>
+#if defined(__clang__) || ( defined(__GNUC__) && ( ( (__GNUC__ * 100) + __GNUC_MINOR__ ) >= 409 ) )
+#define NATRON_LUT_AVX2
+#define NATRON_LUT_AVX2_FUNCTION __attribute__ ( ( target("avx2") ) )
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (_MSC_VER >= 1800)
+#define NATRON_LUT_AVX2
+#define NATRON_LUT_AVX2_FUNCTION
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
 /*
  * The to_byte* and from_byte* functions implement and generalize the algorithm
  * described in:
@@ -129,11 +146,7 @@ index_to_float(const unsigned short i)
 }
 
 ///initialize the singleton
-LutManager LutManager::m_instance = LutManager();
-LutManager::LutManager()
-    : luts()
-{
-}
+LutManager LutManager::m_instance;
 
 const Lut*
 LutManager::getLut(const std::string & name,
@@ -223,11 +236,235 @@ getOffsetsForPacking(PixelPackingEnum format,
     }
 }
 
+#ifdef NATRON_LUT_AVX2
+static bool
+cpuSupportsAVX2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    // The OS must save the AVX registers
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if ( !osxsave || !avx || ( (_xgetbv(0) & 6) != 6 ) ) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+static SIMDLevelEnum
+detectSIMDLevel()
+{
+#ifdef NATRON_LUT_AVX2
+    if ( cpuSupportsAVX2() ) {
+        return eSIMDLevelAVX2;
+    }
+#endif
+#ifdef NATRON_LUT_SSE2
+
+    return eSIMDLevelSSE2;
+#else
+
+    return eSIMDLevelNone;
+#endif
+}
+
+static const SIMDLevelEnum supportedSIMDLevel = detectSIMDLevel();
+
+SIMDLevelEnum
+getSupportedSIMDLevel()
+{
+    return supportedSIMDLevel;
+}
+
+// Computes hipart(from[i] * alpha) for a row of pixels and looks it up in table. The premultiplication is only done
+// if premultAlphaOffset != -1. All the variants below must give the same result as this one.
+static void
+toUint8xxRow_scalar(const unsigned short* table,
+                    const float* from,
+                    unsigned short* to,
+                    int nPixels,
+                    int nComps,
+                    int premultAlphaOffset)
+{
+    if (premultAlphaOffset == -1) {
+        for (int i = 0; i < nPixels * nComps; ++i) {
+            to[i] = table[hipart(from[i])];
+        }
+    } else {
+        for (int x = 0; x < nPixels; ++x, from += nComps, to += nComps) {
+            const float a = from[premultAlphaOffset];
+            for (int k = 0; k < nComps; ++k) {
+                to[k] = table[hipart(from[k] * a)];
+            }
+        }
+    }
+}
+
+static void
+fromUint8Row_scalar(const float* table,
+                    const unsigned char* from,
+                    float* to,
+                    int n)
+{
+    for (int i = 0; i < n; ++i) {
+        to[i] = table[from[i]];
+    }
+}
+
+#ifdef NATRON_LUT_SSE2
+// SSE2 has no gather: the premultiplication and hipart are vectorized, the lookups are not
+static void
+toUint8xxRow_SSE2(const unsigned short* table,
+                  const float* from,
+                  unsigned short* to,
+                  int nPixels,
+                  int nComps,
+                  int premultAlphaOffset)
+{
+    if ( (premultAlphaOffset != -1) && ( (nComps != 4) || (premultAlphaOffset != 3) ) ) {
+        // only RGBA and BGRA are premultiplied in vectors
+        toUint8xxRow_scalar(table, from, to, nPixels, nComps, premultAlphaOffset);
+
+        return;
+    }
+    const int n = nPixels * nComps;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(from + i);
+        if (premultAlphaOffset != -1) {
+            v = _mm_mul_ps( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE(3, 3, 3, 3) ) );
+        }
+        __m128i idx = _mm_srli_epi32(_mm_castps_si128(v), 16);
+        to[i] = table[_mm_extract_epi16(idx, 0)];
+        to[i + 1] = table[_mm_extract_epi16(idx, 2)];
+        to[i + 2] = table[_mm_extract_epi16(idx, 4)];
+        to[i + 3] = table[_mm_extract_epi16(idx, 6)];
+    }
+    if (i < n) {
+        // only reached when there is no premultiplication, n being a multiple of 4 otherwise
+        toUint8xxRow_scalar(table, from + i, to + i, n - i, 1, -1);
+    }
+}
+#endif // NATRON_LUT_SSE2
+
+#ifdef NATRON_LUT_AVX2
+// The table has a padding entry so that the 32-bit gather of the last entry stays in bounds
+NATRON_LUT_AVX2_FUNCTION
+static void
+toUint8xxRow_AVX2(const unsigned short* table,
+                  const float* from,
+                  unsigned short* to,
+                  int nPixels,
+                  int nComps,
+                  int premultAlphaOffset)
+{
+    if ( (premultAlphaOffset != -1) && ( (nComps != 4) || (premultAlphaOffset != 3) ) ) {
+        toUint8xxRow_scalar(table, from, to, nPixels, nComps, premultAlphaOffset);
+
+        return;
+    }
+    const int n = nPixels * nComps;
+    const __m256i lowMask = _mm256_set1_epi32(0xffff);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(from + i);
+        if (premultAlphaOffset != -1) {
+            // each 128-bit lane holds a pixel
+            v = _mm256_mul_ps( v, _mm256_permute_ps( v, _MM_SHUFFLE(3, 3, 3, 3) ) );
+        }
+        __m256i idx = _mm256_srli_epi32(_mm256_castps_si256(v), 16);
+        __m256i values = _mm256_and_si256(_mm256_i32gather_epi32( (const int*)table, idx, 2 ), lowMask);
+        // packus works within the 128-bit lanes, put the 2 halves back together
+        values = _mm256_permute4x64_epi64(_mm256_packus_epi32(values, values), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm_storeu_si128( (__m128i*)(to + i), _mm256_castsi256_si128(values) );
+    }
+    if (i < n) {
+        if (premultAlphaOffset == -1) {
+            toUint8xxRow_scalar(table, from + i, to + i, n - i, 1, -1);
+        } else {
+            // the last pixel, i being a multiple of 2 pixels
+            toUint8xxRow_scalar(table, from + i, to + i, (n - i) / nComps, nComps, premultAlphaOffset);
+        }
+    }
+}
+
+NATRON_LUT_AVX2_FUNCTION
+static void
+fromUint8Row_AVX2(const float* table,
+                  const unsigned char* from,
+                  float* to,
+                  int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i idx = _mm256_cvtepu8_epi32( _mm_loadl_epi64( (const __m128i*)(from + i) ) );
+        _mm256_storeu_ps( to + i, _mm256_i32gather_ps(table, idx, 4) );
+    }
+    fromUint8Row_scalar(table, from + i, to + i, n - i);
+}
+#endif // NATRON_LUT_AVX2
+
+void
+Lut::toColorSpaceUint8xxFromLinearFloatFast(const float* from,
+                                            unsigned short* to,
+                                            int nPixels,
+                                            int nComps,
+                                            int premultAlphaOffset,
+                                            SIMDLevelEnum simd) const
+{
+    assert(premultAlphaOffset < nComps);
+    assert(simd <= supportedSIMDLevel);
+    switch (simd) {
+#ifdef NATRON_LUT_AVX2
+    case eSIMDLevelAVX2:
+        toUint8xxRow_AVX2(toFunc_hipart_to_uint8xx, from, to, nPixels, nComps, premultAlphaOffset);
+        break;
+#endif
+#ifdef NATRON_LUT_SSE2
+    case eSIMDLevelSSE2:
+        toUint8xxRow_SSE2(toFunc_hipart_to_uint8xx, from, to, nPixels, nComps, premultAlphaOffset);
+        break;
+#endif
+    default:
+        toUint8xxRow_scalar(toFunc_hipart_to_uint8xx, from, to, nPixels, nComps, premultAlphaOffset);
+        break;
+    }
+}
+
+void
+Lut::fromColorSpaceUint8ToLinearFloatFast(const unsigned char* from,
+                                          float* to,
+                                          int n,
+                                          SIMDLevelEnum simd) const
+{
+    assert(simd <= supportedSIMDLevel);
+#ifdef NATRON_LUT_AVX2
+    if (simd == eSIMDLevelAVX2) {
+        fromUint8Row_AVX2(fromFunc_uint8_to_float, from, to, n);
+
+        return;
+    }
+#endif
+    // Without gather, SSE2 cannot do better than the scalar loop
+    fromUint8Row_scalar(fromFunc_uint8_to_float, from, to, n);
+}
+
 float
 Lut::fromColorSpaceUint8ToLinearFloatFast(unsigned char v) const
 {
-    assert(init_);
-
     return fromFunc_uint8_to_float[v];
 }
 
@@ -237,8 +474,6 @@ Lut::fromColorSpaceUint8ToLinearFloatFast(unsigned char v) const
 float
 Lut::toColorSpaceFloatFromLinearFloatFast(float v) const
 {
-    assert(init_);
-
     return Color::intToFloat<0xff01>(toFunc_hipart_to_uint8xx[hipart(v)]);
 }
 #endif // DEAD_CODE
@@ -246,16 +481,12 @@ Lut::toColorSpaceFloatFromLinearFloatFast(float v) const
 unsigned char
 Lut::toColorSpaceUint8FromLinearFloatFast(float v) const
 {
-    assert(init_);
-
     return Color::uint8xxToChar(toFunc_hipart_to_uint8xx[hipart(v)]);
 }
 
 unsigned short
 Lut::toColorSpaceUint8xxFromLinearFloatFast(float v) const
 {
-    assert(init_);
-
     return toFunc_hipart_to_uint8xx[hipart(v)];
 }
 
@@ -263,7 +494,6 @@ Lut::toColorSpaceUint8xxFromLinearFloatFast(float v) const
 unsigned short
 Lut::toColorSpaceUint16FromLinearFloatFast(float v) const
 {
-    assert(init_);
     // algorithm:
     // - convert to 8 bits -> val8u
     // - convert val8u-1, val8u and val8u+1 to float
@@ -304,7 +534,6 @@ Lut::toColorSpaceUint16FromLinearFloatFast(float v) const
 float
 Lut::fromColorSpaceUint16ToLinearFloatFast(unsigned short v) const
 {
-    assert(init_);
     // the following is from ImageMagick's quantum.h
     unsigned char v8u_prev = ( v - (v >> 8) ) >> 8;
     unsigned char v8u_next = v8u_prev + 1;
@@ -318,11 +547,8 @@ Lut::fromColorSpaceUint16ToLinearFloatFast(unsigned short v) const
 }
 
 void
-Lut::fillTables() const
+Lut::fillTables()
 {
-    if (init_) {
-        return;
-    }
     // fill all
     for (int i = 0; i < 0x10000; ++i) {
         float inp = index_to_float( (unsigned short)i );
@@ -340,6 +566,7 @@ Lut::fillTables() const
         int i = hipart(f);
         toFunc_hipart_to_uint8xx[i] = Color::charToUint8xx(b);
     }
+    toFunc_hipart_to_uint8xx[0x10000] = 0;
 }
 
 #ifdef DEAD_CODE
@@ -351,7 +578,6 @@ Lut::to_byte_planar(unsigned char* to,
                     int inDelta,
                     int outDelta) const
 {
-    validate();
     unsigned char *end = to + W * outDelta;
     // coverity[dont_call]
     int start = rand() % W;
@@ -416,7 +642,6 @@ Lut::to_float_planar(float* to,
                      int inDelta,
                      int outDelta) const
 {
-    validate();
     if (!alpha) {
         for (int f = 0,t = 0; f < W; f += inDelta, t += outDelta) {
             to[t] = toColorSpaceFloatFromLinearFloat(from[f]);
@@ -458,8 +683,7 @@ Lut::to_byte_packed(unsigned char* to,
     inPackingSize = inputHasAlpha ? 4 : 3;
     outPackingSize = outputHasAlpha ? 4 : 3;
 
-    validate();
-
+    std::vector<unsigned short> lutValues( (rect.x2 - rect.x1) * inPackingSize );
     for (int y = rect.y1; y < rect.y2; ++y) {
         // coverity[dont_call]
         int start = rand() % (rect.x2 - rect.x1) + rect.x1;
@@ -474,14 +698,18 @@ Lut::to_byte_packed(unsigned char* to,
         int dstY = dstBounds.y2 - y - 1;
         const float *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
         unsigned char *dst_pixels = to + (dstY * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
+        /* look-up the whole line at once, only the error diffusion has to be sequential: */
+        toColorSpaceUint8xxFromLinearFloatFast(src_pixels + rect.x1 * inPackingSize, &lutValues[0], rect.x2 - rect.x1, inPackingSize,
+                                               (inputHasAlpha && premult) ? inAOffset : -1);
         /* go fowards from starting point to end of line: */
         for (int x = start; x < rect.x2; ++x) {
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
+            int lutCol = (x - rect.x1) * inPackingSize;
             float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
-            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inROffset] * a)];
-            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inGOffset] * a)];
-            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inBOffset] * a)];
+            error_r = (error_r & 0xff) + lutValues[lutCol + inROffset];
+            error_g = (error_g & 0xff) + lutValues[lutCol + inGOffset];
+            error_b = (error_b & 0xff) + lutValues[lutCol + inBOffset];
             assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
             dst_pixels[outCol + outROffset] = (unsigned char)(error_r >> 8);
             dst_pixels[outCol + outGOffset] = (unsigned char)(error_g >> 8);
@@ -496,10 +724,11 @@ Lut::to_byte_packed(unsigned char* to,
         for (int x = start - 1; x >= rect.x1; --x) {
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
+            int lutCol = (x - rect.x1) * inPackingSize;
             float a = (inputHasAlpha && premult) ? src_pixels[inCol + inAOffset] : 1.f;
-            error_r = (error_r & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inROffset] * a)];
-            error_g = (error_g & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inGOffset] * a)];
-            error_b = (error_b & 0xff) + toFunc_hipart_to_uint8xx[hipart(src_pixels[inCol + inBOffset] * a)];
+            error_r = (error_r & 0xff) + lutValues[lutCol + inROffset];
+            error_g = (error_g & 0xff) + lutValues[lutCol + inGOffset];
+            error_b = (error_b & 0xff) + lutValues[lutCol + inBOffset];
             assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
             dst_pixels[outCol + outROffset] = (unsigned char)(error_r >> 8);
             dst_pixels[outCol + outGOffset] = (unsigned char)(error_g >> 8);
@@ -557,8 +786,6 @@ Lut::to_float_packed(float* to,
     inPackingSize = inputHasAlpha ? 4 : 3;
     outPackingSize = outputHasAlpha ? 4 : 3;
 
-    validate();
-
     for (int y = rect.y1; y < rect.y2; ++y) {
         int srcY = y;
         if (invertY) {
@@ -592,7 +819,6 @@ Lut::from_byte_planar(float* to,
                       int inDelta,
                       int outDelta) const
 {
-    validate();
     if (!alpha) {
         for (int f = 0,t = 0; f < W; f += inDelta, t += outDelta) {
             to[f] = fromFunc_uint8_to_float[(int)from[f]];
@@ -623,7 +849,6 @@ Lut::from_float_planar(float* to,
                        int inDelta,
                        int outDelta) const
 {
-    validate();
     if (!alpha) {
         for (int f = 0,t = 0; f < W; f += inDelta, t += outDelta) {
             to[t] = fromColorSpaceFloatToLinearFloat(from[f]);
@@ -669,7 +894,7 @@ Lut::from_byte_packed(float* to,
     inPackingSize = inputHasAlpha ? 4 : 3;
     outPackingSize = outputHasAlpha ? 4 : 3;
 
-    validate();
+    std::vector<float> lutValues( (rect.x2 - rect.x1) * inPackingSize );
     for (int y = rect.y1; y < rect.y2; ++y) {
         int srcY = y;
         if (invertY) {
@@ -678,6 +903,9 @@ Lut::from_byte_packed(float* to,
 
         const unsigned char *src_pixels = from + (srcY * (srcBounds.x2 - srcBounds.x1) * inPackingSize);
         float *dst_pixels = to + (y * (dstBounds.x2 - dstBounds.x1) * outPackingSize);
+        if ( !(inputHasAlpha && premult) ) {
+            fromColorSpaceUint8ToLinearFloatFast(src_pixels + rect.x1 * inPackingSize, &lutValues[0], (rect.x2 - rect.x1) * inPackingSize);
+        }
         for (int x = rect.x1; x < rect.x2; ++x) {
             int inCol = x * inPackingSize;
             int outCol = x * outPackingSize;
@@ -698,14 +926,10 @@ Lut::from_byte_packed(float* to,
                     dst_pixels[outCol + outAOffset] = a;
                 }
             } else {
-                int r8 = 0, g8 = 0, b8 = 0;
-                r8 = src_pixels[inCol + inROffset];
-                g8 = src_pixels[inCol + inGOffset];
-                b8 = src_pixels[inCol + inBOffset];
-                assert(r8 >= 0 && r8 < 256 && g8 >= 0 && g8 < 256 && b8 >= 0 && b8 < 256);
-                dst_pixels[outCol + outROffset] = fromFunc_uint8_to_float[r8];
-                dst_pixels[outCol + outGOffset] = fromFunc_uint8_to_float[g8];
-                dst_pixels[outCol + outBOffset] = fromFunc_uint8_to_float[b8];
+                int lutCol = (x - rect.x1) * inPackingSize;
+                dst_pixels[outCol + outROffset] = lutValues[lutCol + inROffset];
+                dst_pixels[outCol + outGOffset] = lutValues[lutCol + inGOffset];
+                dst_pixels[outCol + outBOffset] = lutValues[lutCol + inBOffset];
                 if (outputHasAlpha) {
                     // alpha is linear
                     float a = Color::intToFloat<256>(src_pixels[inCol + inAOffset]);
@@ -763,8 +987,6 @@ Lut::from_float_packed(float* to,
     inPackingSize = inputHasAlpha ? 4 : 3;
     outPackingSize = outputHasAlpha ? 4 : 3;
 
-    validate();
-
     for (int y = rect.y1; y < rect.y2; ++y) {
         int srcY = y;
         if (invertY) {
@@ -1464,6 +1686,22 @@ LutManager::AlexaV3LogCLut()
     return LutManager::m_instance.getLut("AlexaV3LogC",from_func_AlexaV3LogC,to_func_AlexaV3LogC);
 }
 
+LutManager::LutManager()
+    : luts()
+{
+    // This is m_instance: create the built-in luts and fill their tables right away, before main(),
+    // so that the functions above never modify the map afterwards and can be called by any thread.
+    sRGBLut();
+    Rec709Lut();
+    CineonLut();
+    Gamma1_8Lut();
+    Gamma2_2Lut();
+    PanaLogLut();
+    ViperLogLut();
+    RedLogLut();
+    AlexaV3LogCLut();
+}
+
 // r,g,b values are from 0 to 1
 // h = [0,360], s = [0,1], v = [0,1]
 //		if s == 0, then h = 0 (undefined)
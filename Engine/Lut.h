@@ -57,6 +57,19 @@ enum PixelPackingEnum
 };
 
 
+/// @enum The instruction sets the row conversions of Lut may use
+enum SIMDLevelEnum
+{
+    eSIMDLevelNone = 0,
+    eSIMDLevelSSE2,
+    eSIMDLevelAVX2
+};
+
+/**
+ * @brief Returns the best instruction set supported by the CPU for the row conversions of Lut, detected once at startup.
+ **/
+SIMDLevelEnum getSupportedSIMDLevel();
+
 /* @brief Converts a float ranging in [0 - 1.f] in the desired color-space to linear color-space also ranging in [0 - 1.f]*/
 typedef float (*fromColorSpaceFunctionV1)(float v);
 
@@ -66,7 +79,8 @@ typedef float (*toColorSpaceFunctionV1)(float v);
 
 // a Singleton that holds precomputed LUTs for the whole application.
 // The m_instance member is static and is thus built before the first call to Instance().
-// WARNING : This class is not thread-safe and calling getLut must not be done in a function called
+// The built-in luts are created along with it so that getting them is thread-safe.
+// WARNING : Creating a lut that is not built-in with getLut is not thread-safe and must not be done in a function called
 // by multiple thread at once!
 class Lut;
 class LutManager
@@ -130,12 +144,10 @@ class Lut
     fromColorSpaceFunctionV1 _fromFunc;
     toColorSpaceFunctionV1 _toFunc;
 
-    /// the fast lookup tables are mutable, because they are automatically initialized post-construction,
-    /// and never change afterwards
-    mutable unsigned short toFunc_hipart_to_uint8xx[0x10000];         /// contains  2^16 = 65536 values between 0-255
-    mutable float fromFunc_uint8_to_float[256];         /// values between 0-1.f
-    mutable bool init_;         ///< false if the tables are not yet initialized
-    mutable QMutex _lock;         ///< protects init_
+    /// the fast lookup tables, filled by the constructor and never modified afterwards: they can be read by any thread without locking.
+    /// contains  2^16 = 65536 values between 0-255, plus one padding entry so that the last one can be read with a 32-bit gather
+    unsigned short toFunc_hipart_to_uint8xx[0x10001];
+    float fromFunc_uint8_to_float[256];         /// values between 0-1.f
 
     friend class LutManager;
     ///private constructor, used by LutManager
@@ -145,15 +157,13 @@ class Lut
         : _name(name)
           , _fromFunc(fromFunc)
           , _toFunc(toFunc)
-          , init_(false)
-          , _lock()
     {
+        fillTables();
     }
 
     ///init luts
     ///it uses fromColorSpaceFloatToLinearFloat(float) and toColorSpaceFloatFromLinearFloat(float)
-    ///Called by validate()
-    void fillTables() const;
+    void fillTables();
 
 public:
 
@@ -175,18 +185,6 @@ public:
         return _toFunc(v);
     }
 
-    //Called by all public members
-    void validate() const
-    {
-        QMutexLocker g(&_lock);
-
-        if (init_) {
-            return;
-        }
-        fillTables();
-        init_ = true;
-    }
-
     const std::string & getName() const
     {
         return _name;
@@ -225,6 +223,28 @@ public:
      */
     float fromColorSpaceUint16ToLinearFloatFast(unsigned short v) const;
 
+    /**
+     * @brief Same as toColorSpaceUint8xxFromLinearFloatFast(float) for a row of nPixels packed pixels of nComps components.
+     * If premultAlphaOffset is not -1, each component is multiplied by the component at this offset in its pixel first.
+     * The nPixels * nComps results are written to 'to', which must not overlap 'from'.
+     * The result is the same with any SIMD level, which is only exposed for testing.
+     **/
+    void toColorSpaceUint8xxFromLinearFloatFast(const float* from,
+                                                unsigned short* to,
+                                                int nPixels,
+                                                int nComps,
+                                                int premultAlphaOffset = -1,
+                                                SIMDLevelEnum simd = getSupportedSIMDLevel()) const;
+
+    /**
+     * @brief Same as fromColorSpaceUint8ToLinearFloatFast(unsigned char) for n contiguous bytes.
+     * The result is the same with any SIMD level, which is only exposed for testing.
+     **/
+    void fromColorSpaceUint8ToLinearFloatFast(const unsigned char* from,
+                                              float* to,
+                                              int n,
+                                              SIMDLevelEnum simd = getSupportedSIMDLevel()) const;
+
 
     /////@TODO the following functions expects a float input buffer, one could extend it to cover all bitdepths.
 
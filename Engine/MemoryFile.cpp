@@ -41,6 +41,7 @@
 #include <iostream>
 #include <cassert>
 #include <stdexcept>
+#include <algorithm> // min
 
 #include "Global/Macros.h"
 #include "Global/GlobalDefines.h"
@@ -365,6 +366,37 @@ MemoryFile::flush()
 #endif
 }
 
+bool
+MemoryFile::flushRange(size_t offset,
+                       size_t length,
+                       bool discardFromRAM)
+{
+    if ( !_imp->data || (offset >= _imp->size) ) {
+        return false;
+    }
+    length = std::min(length, _imp->size - offset);
+    char* start = _imp->data + offset;
+#if defined(__NATRON_UNIX__)
+    // msync requires a page-aligned address
+    size_t pageSize = (size_t)::sysconf(_SC_PAGESIZE);
+    size_t misalignment = offset % pageSize;
+    start -= misalignment;
+    length += misalignment;
+
+    bool ok = ::msync(start, length, MS_SYNC) == 0;
+    if (ok && discardFromRAM) {
+        // The mapping is shared: the data stays in the file, the pages are simply released
+        ::madvise(start, length, MADV_DONTNEED);
+    }
+
+    return ok;
+#elif defined(__NATRON_WIN32__)
+    (void)discardFromRAM;
+
+    return ::FlushViewOfFile(start, length) != 0;
+#endif
+}
+
 MemoryFile::~MemoryFile()
 {
     if (_imp->data) {
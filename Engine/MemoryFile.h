@@ -137,6 +137,13 @@ public:
      **/
     bool flush();
 
+    /**
+     * @brief Same as flush() but only for the given byte range of the file.
+     * If discardFromRAM is true, the pages of the range are released from memory once
+     * written: they will be read back from the file on the next access.
+     **/
+    bool flushRange(size_t offset, size_t length, bool discardFromRAM);
+
     /**
      * @brief Returns the filepath of the backing file.
      **/
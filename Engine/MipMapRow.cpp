@@ -0,0 +1,275 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "MipMapRow.h"
+
+// SSE2 is part of x86-64
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define NATRON_MIPMAP_SSE2
+#include <emmintrin.h>
+#endif
+
+NATRON_NAMESPACE_ENTER;
+
+namespace MipMap {
+namespace {
+/// This is the computation done by Image::halveRoIForDepth for blocks that are entirely inside the source image
+template <typename PIX>
+void
+halveRowScalar(const PIX* row0,
+               const PIX* row1,
+               int nComps,
+               int width,
+               PIX* dst)
+{
+    for (int x = 0; x < width; ++x, row0 += 2 * nComps, row1 += 2 * nComps, dst += nComps) {
+        for (int k = 0; k < nComps; ++k) {
+            const PIX a = row0[k];
+            const PIX b = row0[k + nComps];
+            const PIX c = row1[k];
+            const PIX d = row1[k + nComps];
+            dst[k] = (a + b + c + d) / 4;
+        }
+    }
+}
+
+#ifdef NATRON_MIPMAP_SSE2
+/// Returns the number of destination pixels done, the caller finishes the row with the scalar loop
+int
+halveRowSSE2(const unsigned char* row0,
+             const unsigned char* row1,
+             int nComps,
+             int width,
+             unsigned char* dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+
+    if (nComps == 4) {
+        // 4 source pixels of each row give 2 destination pixels
+        for (; x + 2 <= width; x += 2) {
+            const __m128i v0 = _mm_loadu_si128( (const __m128i*)(row0 + x * 8) );
+            const __m128i v1 = _mm_loadu_si128( (const __m128i*)(row1 + x * 8) );
+            const __m128i lo0 = _mm_unpacklo_epi8(v0, zero);
+            const __m128i hi0 = _mm_unpackhi_epi8(v0, zero);
+            const __m128i lo1 = _mm_unpacklo_epi8(v1, zero);
+            const __m128i hi1 = _mm_unpackhi_epi8(v1, zero);
+            // even pixels in a and c, odd pixels in b and d
+            __m128i sum = _mm_add_epi16( _mm_unpacklo_epi64(lo0, hi0), _mm_unpackhi_epi64(lo0, hi0) );
+            sum = _mm_add_epi16( sum, _mm_unpacklo_epi64(lo1, hi1) );
+            sum = _mm_add_epi16( sum, _mm_unpackhi_epi64(lo1, hi1) );
+            sum = _mm_srli_epi16(sum, 2);
+            _mm_storel_epi64( (__m128i*)(dst + x * 4), _mm_packus_epi16(sum, sum) );
+        }
+    } else if (nComps == 1) {
+        const __m128i lowBytes = _mm_set1_epi16(0xff);
+        for (; x + 8 <= width; x += 8) {
+            const __m128i v0 = _mm_loadu_si128( (const __m128i*)(row0 + x * 2) );
+            const __m128i v1 = _mm_loadu_si128( (const __m128i*)(row1 + x * 2) );
+            __m128i sum = _mm_add_epi16( _mm_and_si128(v0, lowBytes), _mm_srli_epi16(v0, 8) );
+            sum = _mm_add_epi16( sum, _mm_and_si128(v1, lowBytes) );
+            sum = _mm_add_epi16( sum, _mm_srli_epi16(v1, 8) );
+            sum = _mm_srli_epi16(sum, 2);
+            _mm_storel_epi64( (__m128i*)(dst + x), _mm_packus_epi16(sum, sum) );
+        }
+    }
+
+    return x;
+}
+
+/// SSE2 has no unsigned saturated pack from 32 to 16 bits: the values are shifted to the signed range and back
+inline __m128i
+packUint32ToUint16(__m128i a,
+                   __m128i b)
+{
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16( (short)0x8000 );
+
+    return _mm_add_epi16( _mm_packs_epi32( _mm_sub_epi32(a, bias32), _mm_sub_epi32(b, bias32) ), bias16 );
+}
+
+int
+halveRowSSE2(const unsigned short* row0,
+             const unsigned short* row1,
+             int nComps,
+             int width,
+             unsigned short* dst)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x = 0;
+
+    if (nComps == 4) {
+        // 4 source pixels of each row give 2 destination pixels
+        for (; x + 2 <= width; x += 2) {
+            const __m128i v0 = _mm_loadu_si128( (const __m128i*)(row0 + x * 8) );
+            const __m128i w0 = _mm_loadu_si128( (const __m128i*)(row0 + x * 8 + 8) );
+            const __m128i v1 = _mm_loadu_si128( (const __m128i*)(row1 + x * 8) );
+            const __m128i w1 = _mm_loadu_si128( (const __m128i*)(row1 + x * 8 + 8) );
+            __m128i first = _mm_add_epi32( _mm_unpacklo_epi16(v0, zero), _mm_unpackhi_epi16(v0, zero) );
+            first = _mm_add_epi32( first, _mm_unpacklo_epi16(v1, zero) );
+            first = _mm_add_epi32( first, _mm_unpackhi_epi16(v1, zero) );
+            __m128i second = _mm_add_epi32( _mm_unpacklo_epi16(w0, zero), _mm_unpackhi_epi16(w0, zero) );
+            second = _mm_add_epi32( second, _mm_unpacklo_epi16(w1, zero) );
+            second = _mm_add_epi32( second, _mm_unpackhi_epi16(w1, zero) );
+            _mm_storeu_si128( (__m128i*)(dst + x * 4), packUint32ToUint16( _mm_srli_epi32(first, 2), _mm_srli_epi32(second, 2) ) );
+        }
+    } else if (nComps == 1) {
+        const __m128i lowShorts = _mm_set1_epi32(0xffff);
+        for (; x + 8 <= width; x += 8) {
+            const __m128i v0 = _mm_loadu_si128( (const __m128i*)(row0 + x * 2) );
+            const __m128i w0 = _mm_loadu_si128( (const __m128i*)(row0 + x * 2 + 8) );
+            const __m128i v1 = _mm_loadu_si128( (const __m128i*)(row1 + x * 2) );
+            const __m128i w1 = _mm_loadu_si128( (const __m128i*)(row1 + x * 2 + 8) );
+            __m128i first = _mm_add_epi32( _mm_and_si128(v0, lowShorts), _mm_srli_epi32(v0, 16) );
+            first = _mm_add_epi32( first, _mm_and_si128(v1, lowShorts) );
+            first = _mm_add_epi32( first, _mm_srli_epi32(v1, 16) );
+            __m128i second = _mm_add_epi32( _mm_and_si128(w0, lowShorts), _mm_srli_epi32(w0, 16) );
+            second = _mm_add_epi32( second, _mm_and_si128(w1, lowShorts) );
+            second = _mm_add_epi32( second, _mm_srli_epi32(w1, 16) );
+            _mm_storeu_si128( (__m128i*)(dst + x), packUint32ToUint16( _mm_srli_epi32(first, 2), _mm_srli_epi32(second, 2) ) );
+        }
+    }
+
+    return x;
+}
+
+int
+halveRowSSE2(const float* row0,
+             const float* row1,
+             int nComps,
+             int width,
+             float* dst)
+{
+    // the sum is done in the order of the scalar loop, and multiplying by 0.25 is exactly dividing by 4
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    int x = 0;
+
+    if (nComps == 4) {
+        for (; x < width; ++x) {
+            const __m128 a = _mm_loadu_ps(row0 + x * 8);
+            const __m128 b = _mm_loadu_ps(row0 + x * 8 + 4);
+            const __m128 c = _mm_loadu_ps(row1 + x * 8);
+            const __m128 d = _mm_loadu_ps(row1 + x * 8 + 4);
+            _mm_storeu_ps( dst + x * 4, _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(a, b), c), d), quarter) );
+        }
+    } else if (nComps == 2) {
+        for (; x + 2 <= width; x += 2) {
+            const __m128 v0 = _mm_loadu_ps(row0 + x * 4);
+            const __m128 w0 = _mm_loadu_ps(row0 + x * 4 + 4);
+            const __m128 v1 = _mm_loadu_ps(row1 + x * 4);
+            const __m128 w1 = _mm_loadu_ps(row1 + x * 4 + 4);
+            const __m128 a = _mm_shuffle_ps( v0, w0, _MM_SHUFFLE(1, 0, 1, 0) );
+            const __m128 b = _mm_shuffle_ps( v0, w0, _MM_SHUFFLE(3, 2, 3, 2) );
+            const __m128 c = _mm_shuffle_ps( v1, w1, _MM_SHUFFLE(1, 0, 1, 0) );
+            const __m128 d = _mm_shuffle_ps( v1, w1, _MM_SHUFFLE(3, 2, 3, 2) );
+            _mm_storeu_ps( dst + x * 2, _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(a, b), c), d), quarter) );
+        }
+    } else if (nComps == 1) {
+        for (; x + 4 <= width; x += 4) {
+            const __m128 v0 = _mm_loadu_ps(row0 + x * 2);
+            const __m128 w0 = _mm_loadu_ps(row0 + x * 2 + 4);
+            const __m128 v1 = _mm_loadu_ps(row1 + x * 2);
+            const __m128 w1 = _mm_loadu_ps(row1 + x * 2 + 4);
+            const __m128 a = _mm_shuffle_ps( v0, w0, _MM_SHUFFLE(2, 0, 2, 0) );
+            const __m128 b = _mm_shuffle_ps( v0, w0, _MM_SHUFFLE(3, 1, 3, 1) );
+            const __m128 c = _mm_shuffle_ps( v1, w1, _MM_SHUFFLE(2, 0, 2, 0) );
+            const __m128 d = _mm_shuffle_ps( v1, w1, _MM_SHUFFLE(3, 1, 3, 1) );
+            _mm_storeu_ps( dst + x, _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(a, b), c), d), quarter) );
+        }
+    }
+
+    return x;
+}
+
+#endif // NATRON_MIPMAP_SSE2
+
+template <typename PIX>
+void
+halveRowForDepth(const PIX* row0,
+                 const PIX* row1,
+                 int nComps,
+                 int width,
+                 PIX* dst,
+                 Color::SIMDLevelEnum simd)
+{
+    int done = 0;
+
+#ifdef NATRON_MIPMAP_SSE2
+    if (simd >= Color::eSIMDLevelSSE2) {
+        done = halveRowSSE2(row0, row1, nComps, width, dst);
+    }
+#else
+    (void)simd;
+#endif
+    const int offset = done * nComps;
+    halveRowScalar(row0 + 2 * offset, row1 + 2 * offset, nComps, width - done, dst + offset);
+}
+} // anon namespace
+
+void
+halveRow(const unsigned char* row0,
+         const unsigned char* row1,
+         int nComps,
+         int width,
+         unsigned char* dst,
+         Color::SIMDLevelEnum simd)
+{
+    halveRowForDepth(row0, row1, nComps, width, dst, simd);
+}
+
+void
+halveRow(const unsigned short* row0,
+         const unsigned short* row1,
+         int nComps,
+         int width,
+         unsigned short* dst,
+         Color::SIMDLevelEnum simd)
+{
+    halveRowForDepth(row0, row1, nComps, width, dst, simd);
+}
+
+void
+halveRow(const Half* row0,
+         const Half* row1,
+         int nComps,
+         int width,
+         Half* dst,
+         Color::SIMDLevelEnum /*simd*/)
+{
+    halveRowScalar(row0, row1, nComps, width, dst);
+}
+
+void
+halveRow(const float* row0,
+         const float* row1,
+         int nComps,
+         int width,
+         float* dst,
+         Color::SIMDLevelEnum simd)
+{
+    halveRowForDepth(row0, row1, nComps, width, dst, simd);
+}
+} // namespace MipMap
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,59 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_MIPMAPROW_H
+#define NATRON_ENGINE_MIPMAPROW_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+#include "Engine/Half.h"
+#include "Engine/Lut.h"
+
+NATRON_NAMESPACE_ENTER;
+
+namespace MipMap {
+/**
+ * @brief Computes width pixels of a mipmap level from the 2x2 blocks of the rows row0 and row1 of the
+ * previous level: dst[x] is the average of row0[2x], row0[2x+1], row1[2x] and row1[2x+1] for each component,
+ * rounded down for integer depths. All the pixels read must be inside the source image.
+ *
+ * The SSE2 versions handle 1 and 4 components (and 2 for float) and give exactly the result of the scalar
+ * loop, the SIMD level is only exposed for testing. Half rows are always processed by the scalar loop.
+ **/
+void halveRow(const unsigned char* row0, const unsigned char* row1, int nComps, int width, unsigned char* dst,
+              Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+void halveRow(const unsigned short* row0, const unsigned short* row1, int nComps, int width, unsigned short* dst,
+              Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+void halveRow(const Half* row0, const Half* row1, int nComps, int width, Half* dst,
+              Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+void halveRow(const float* row0, const float* row1, int nComps, int width, float* dst,
+              Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+} // namespace MipMap
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_MIPMAPROW_H
@@ -0,0 +1,1254 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "NativeExpression.h"
+
+#include <algorithm> // max
+#include <cmath>
+#include <cctype>
+#include <cstdlib>
+#include <cassert>
+#include <vector>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/weak_ptr.hpp>
+#endif
+
+#include "Engine/AppInstance.h"
+#include "Engine/EffectInstance.h"
+#include "Engine/Knob.h"
+#include "Engine/KnobTypes.h"
+#include "Engine/Node.h"
+#include "Engine/NodeGroup.h"
+#include "Engine/Project.h"
+
+///Expressions needing a deeper evaluation stack are left to Python
+#define NATIVE_EXPRESSION_MAX_STACK 64
+
+NATRON_NAMESPACE_ENTER;
+
+namespace {
+
+enum OpCodeEnum
+{
+    eOpCodePushConstant = 0,
+    eOpCodePushFrame,
+    eOpCodePushView,
+    eOpCodeKnobValue, //< arg: knob index, arg2: dimension
+    eOpCodeKnobValueAtTime, //< same as eOpCodeKnobValue but pops the time
+    eOpCodeAdd,
+    eOpCodeSub,
+    eOpCodeMul,
+    eOpCodeDiv,
+    eOpCodeFloorDiv,
+    eOpCodeMod,
+    eOpCodePow,
+    eOpCodeNeg,
+    eOpCodeCall //< arg: function, arg2: number of arguments
+};
+
+enum FunctionEnum
+{
+    eFunctionSin = 0,
+    eFunctionCos,
+    eFunctionTan,
+    eFunctionAsin,
+    eFunctionAcos,
+    eFunctionAtan,
+    eFunctionAtan2,
+    eFunctionSinh,
+    eFunctionCosh,
+    eFunctionTanh,
+    eFunctionExp,
+    eFunctionLog,
+    eFunctionLog10,
+    eFunctionSqrt,
+    eFunctionPow,
+    eFunctionFabs,
+    eFunctionFloor,
+    eFunctionCeil,
+    eFunctionFmod,
+    eFunctionHypot,
+    eFunctionDegrees,
+    eFunctionRadians,
+    eFunctionAbs,
+    eFunctionMin,
+    eFunctionMax,
+    eFunctionInt,
+    eFunctionFloat
+};
+
+struct FunctionDesc
+{
+    const char* name;
+    FunctionEnum function;
+    int minArgs;
+    int maxArgs; //< -1 for variadic
+};
+
+const FunctionDesc kFunctions[] = {
+    { "sin", eFunctionSin, 1, 1 },
+    { "cos", eFunctionCos, 1, 1 },
+    { "tan", eFunctionTan, 1, 1 },
+    { "asin", eFunctionAsin, 1, 1 },
+    { "acos", eFunctionAcos, 1, 1 },
+    { "atan", eFunctionAtan, 1, 1 },
+    { "atan2", eFunctionAtan2, 2, 2 },
+    { "sinh", eFunctionSinh, 1, 1 },
+    { "cosh", eFunctionCosh, 1, 1 },
+    { "tanh", eFunctionTanh, 1, 1 },
+    { "exp", eFunctionExp, 1, 1 },
+    { "log", eFunctionLog, 1, 2 },
+    { "log10", eFunctionLog10, 1, 1 },
+    { "sqrt", eFunctionSqrt, 1, 1 },
+    { "pow", eFunctionPow, 2, 2 },
+    { "fabs", eFunctionFabs, 1, 1 },
+    { "floor", eFunctionFloor, 1, 1 },
+    { "ceil", eFunctionCeil, 1, 1 },
+    { "fmod", eFunctionFmod, 2, 2 },
+    { "hypot", eFunctionHypot, 2, 2 },
+    { "degrees", eFunctionDegrees, 1, 1 },
+    { "radians", eFunctionRadians, 1, 1 },
+    { "abs", eFunctionAbs, 1, 1 },
+    { "min", eFunctionMin, 2, -1 }, //< with a single argument, min and max iterate over it
+    { "max", eFunctionMax, 2, -1 },
+    { "int", eFunctionInt, 1, 1 },
+    { "float", eFunctionFloat, 1, 1 },
+    { 0, eFunctionSin, 0, 0 }
+};
+
+enum KnobTypeEnum
+{
+    eKnobTypeDouble = 0,
+    eKnobTypeInt,
+    eKnobTypeBool
+};
+
+struct Instruction
+{
+    OpCodeEnum op;
+    int arg;
+    int arg2;
+    NativeExpression::Value constant;
+};
+
+struct KnobRef
+{
+    boost::weak_ptr<KnobI> knob; //< only used to check that the parameter still exists
+    NodeWPtr node;
+    KnobTypeEnum type;
+    Knob<double>* doubleKnob;
+    Knob<int>* intKnob;
+    Knob<bool>* boolKnob;
+};
+
+inline NativeExpression::Value
+makeValue(double v,
+          bool isInt)
+{
+    NativeExpression::Value ret;
+
+    ret.value = v;
+    ret.isInt = isInt;
+
+    return ret;
+}
+
+/**
+ * @brief The remainder with the sign of the divisor, as the Python % operator
+ **/
+inline double
+pythonMod(double a,
+          double b)
+{
+    double r = std::fmod(a, b);
+
+    if ( (r != 0) && ( (r < 0) != (b < 0) ) ) {
+        r += b;
+    }
+
+    return r;
+}
+
+inline bool
+isFinite(double v)
+{
+    return v == v && v - v == 0;
+}
+
+bool
+callFunction(FunctionEnum function,
+             const NativeExpression::Value* args,
+             int nArgs,
+             NativeExpression::Value* ret)
+{
+    const double x = args[0].value;
+
+    ret->isInt = false;
+    switch (function) {
+    case eFunctionSin:
+        ret->value = std::sin(x);
+        break;
+    case eFunctionCos:
+        ret->value = std::cos(x);
+        break;
+    case eFunctionTan:
+        ret->value = std::tan(x);
+        break;
+    case eFunctionAsin:
+        if ( (x < -1.) || (x > 1.) ) {
+            return false;
+        }
+        ret->value = std::asin(x);
+        break;
+    case eFunctionAcos:
+        if ( (x < -1.) || (x > 1.) ) {
+            return false;
+        }
+        ret->value = std::acos(x);
+        break;
+    case eFunctionAtan:
+        ret->value = std::atan(x);
+        break;
+    case eFunctionAtan2:
+        ret->value = std::atan2(x, args[1].value);
+        break;
+    case eFunctionSinh:
+        ret->value = std::sinh(x);
+        break;
+    case eFunctionCosh:
+        ret->value = std::cosh(x);
+        break;
+    case eFunctionTanh:
+        ret->value = std::tanh(x);
+        break;
+    case eFunctionExp:
+        ret->value = std::exp(x);
+        break;
+    case eFunctionLog:
+        if (x <= 0.) {
+            return false;
+        }
+        ret->value = std::log(x);
+        if (nArgs == 2) {
+            if ( (args[1].value <= 0.) || (args[1].value == 1.) ) {
+                return false;
+            }
+            ret->value /= std::log(args[1].value);
+        }
+        break;
+    case eFunctionLog10:
+        if (x <= 0.) {
+            return false;
+        }
+        ret->value = std::log10(x);
+        break;
+    case eFunctionSqrt:
+        if (x < 0.) {
+            return false;
+        }
+        ret->value = std::sqrt(x);
+        break;
+    case eFunctionPow:
+        if ( ( (x == 0.) && (args[1].value < 0.) ) || ( (x < 0.) && (args[1].value != std::floor(args[1].value) ) ) ) {
+            return false;
+        }
+        ret->value = std::pow(x, args[1].value);
+        break;
+    case eFunctionFabs:
+        ret->value = std::fabs(x);
+        break;
+    case eFunctionFloor:
+        ret->value = std::floor(x);
+#ifndef IS_PYTHON_2
+        ret->isInt = true;
+#endif
+        break;
+    case eFunctionCeil:
+        ret->value = std::ceil(x);
+#ifndef IS_PYTHON_2
+        ret->isInt = true;
+#endif
+        break;
+    case eFunctionFmod:
+        if (args[1].value == 0.) {
+            return false;
+        }
+        ret->value = std::fmod(x, args[1].value);
+        break;
+    case eFunctionHypot:
+        ret->value = std::sqrt(x * x + args[1].value * args[1].value);
+        break;
+    case eFunctionDegrees:
+        ret->value = x * 180. / M_PI;
+        break;
+    case eFunctionRadians:
+        ret->value = x * M_PI / 180.;
+        break;
+    case eFunctionAbs:
+        ret->value = std::fabs(x);
+        ret->isInt = args[0].isInt;
+        break;
+    case eFunctionMin:
+    case eFunctionMax: {
+        ///Python returns the first of the extremal arguments, with its type
+        int best = 0;
+        for (int i = 1; i < nArgs; ++i) {
+            if ( (function == eFunctionMin) ? (args[i].value < args[best].value) : (args[i].value > args[best].value) ) {
+                best = i;
+            }
+        }
+        *ret = args[best];
+        break;
+    }
+    case eFunctionInt:
+        if ( !isFinite(x) ) {
+            return false;
+        }
+        ret->value = x < 0 ? std::ceil(x) : std::floor(x);
+        ret->isInt = true;
+        break;
+    case eFunctionFloat:
+        ret->value = x;
+        break;
+    } // switch
+
+    ///Python raises OverflowError instead of returning infinite values
+    return isFinite(ret->value);
+} // callFunction
+
+/**
+ * @brief What a sub-expression refers to while compiling. Only values produce bytecode, the other kinds
+ * are resolved at compile time: the expression 'Blur1.size.get()' never looks-up Blur1 again once compiled.
+ **/
+struct Operand
+{
+    enum KindEnum
+    {
+        eKindValue = 0, //< the code computing the value has been emitted
+        eKindCollection, //< app or thisGroup: their attributes are nodes
+        eKindNode,
+        eKindKnob,
+        eKindKnobMethod,
+        eKindTuple, //< the result of get() on a multi-dimensional parameter, its members are emitted when accessed
+        eKindFunction
+    };
+
+    KindEnum kind;
+    boost::shared_ptr<NodeCollection> collection;
+    NodePtr node;
+    KnobPtr knob;
+    std::string method;
+    bool tupleAtTime; //< for eKindTuple, whether the time has already been pushed on the stack
+    int function;
+
+    Operand()
+        : kind(eKindValue)
+        , collection()
+        , node()
+        , knob()
+        , method()
+        , tupleAtTime(false)
+        , function(-1)
+    {
+    }
+};
+
+enum TokenTypeEnum
+{
+    eTokenTypeEnd = 0,
+    eTokenTypeNumber,
+    eTokenTypeName,
+    eTokenTypeOperator
+};
+
+struct Token
+{
+    TokenTypeEnum type;
+    std::string text;
+    NativeExpression::Value number;
+};
+
+/**
+ * @brief Splits the expression in tokens, returns false on anything not handled by the compiler (strings, comparisons, etc...)
+ **/
+bool
+tokenize(const std::string& expr,
+         std::vector<Token>* tokens)
+{
+    std::size_t i = 0;
+
+    while ( i < expr.size() ) {
+        char c = expr[i];
+        if ( (c == ' ') || (c == '\t') ) {
+            ++i;
+            continue;
+        }
+        Token t;
+        if ( std::isdigit(c) || ( (c == '.') && ( i + 1 < expr.size() ) && std::isdigit(expr[i + 1]) ) ) {
+            std::size_t start = i;
+            bool isInt = true;
+            while ( i < expr.size() && std::isdigit(expr[i]) ) {
+                ++i;
+            }
+            if ( i < expr.size() && (expr[i] == '.') ) {
+                isInt = false;
+                ++i;
+                while ( i < expr.size() && std::isdigit(expr[i]) ) {
+                    ++i;
+                }
+            }
+            if ( i < expr.size() && ( (expr[i] == 'e') || (expr[i] == 'E') ) ) {
+                isInt = false;
+                ++i;
+                if ( i < expr.size() && ( (expr[i] == '+') || (expr[i] == '-') ) ) {
+                    ++i;
+                }
+                if ( i >= expr.size() || !std::isdigit(expr[i]) ) {
+                    return false;
+                }
+                while ( i < expr.size() && std::isdigit(expr[i]) ) {
+                    ++i;
+                }
+            }
+            t.text = expr.substr(start, i - start);
+            ///Octal, long and complex literals are left to Python
+            if ( ( isInt && (t.text.size() > 1) && (t.text[0] == '0') ) ||
+                 ( i < expr.size() && ( std::isalnum(expr[i]) || (expr[i] == '_') ) ) ) {
+                return false;
+            }
+            t.type = eTokenTypeNumber;
+            t.number = makeValue(std::strtod(t.text.c_str(), 0), isInt);
+        } else if ( std::isalpha(c) || (c == '_') ) {
+            std::size_t start = i;
+            while ( i < expr.size() && ( std::isalnum(expr[i]) || (expr[i] == '_') ) ) {
+                ++i;
+            }
+            t.type = eTokenTypeName;
+            t.text = expr.substr(start, i - start);
+        } else {
+            t.type = eTokenTypeOperator;
+            if ( ( (c == '*') || (c == '/') ) && ( i + 1 < expr.size() ) && (expr[i + 1] == c) ) {
+                t.text = expr.substr(i, 2);
+                i += 2;
+            } else if ( (c == '+') || (c == '-') || (c == '*') || (c == '/') || (c == '%') ||
+                        (c == '(') || (c == ')') || (c == ',') || (c == '.') ) {
+                t.text = std::string(1, c);
+                ++i;
+            } else {
+                return false;
+            }
+        }
+        tokens->push_back(t);
+    }
+    Token end;
+    end.type = eTokenTypeEnd;
+    tokens->push_back(end);
+
+    return true;
+} // tokenize
+
+} // anon namespace
+
+struct NativeExpressionPrivate
+{
+    std::vector<Instruction> code;
+    std::vector<KnobRef> knobs;
+
+    NativeExpressionPrivate()
+        : code()
+        , knobs()
+    {
+    }
+};
+
+namespace {
+
+/**
+ * @brief Recursive descent parser of the Python grammar restricted to arithmetic, emitting the bytecode as it goes.
+ * Every method returns false as soon as something is not supported.
+ **/
+class ExpressionCompiler
+{
+    const std::vector<Token>& _tokens;
+    std::size_t _pos;
+    NativeExpressionPrivate* _program;
+    NodePtr _thisNode;
+    KnobPtr _thisParam;
+    int _dimension;
+    int _depth, _maxDepth;
+
+public:
+
+    ExpressionCompiler(const std::vector<Token>& tokens,
+                       NativeExpressionPrivate* program,
+                       const NodePtr& thisNode,
+                       const KnobPtr& thisParam,
+                       int dimension)
+        : _tokens(tokens)
+        , _pos(0)
+        , _program(program)
+        , _thisNode(thisNode)
+        , _thisParam(thisParam)
+        , _dimension(dimension)
+        , _depth(0)
+        , _maxDepth(0)
+    {
+    }
+
+    bool compile()
+    {
+        Operand o;
+
+        if ( !parseExpression(&o) || !isValue(o) ) {
+            return false;
+        }
+
+        return _tokens[_pos].type == eTokenTypeEnd && _depth == 1 && _maxDepth <= NATIVE_EXPRESSION_MAX_STACK;
+    }
+
+private:
+
+    const Token& peek() const
+    {
+        return _tokens[_pos];
+    }
+
+    bool peekOperator(const char* op) const
+    {
+        return _tokens[_pos].type == eTokenTypeOperator && _tokens[_pos].text == op;
+    }
+
+    bool acceptOperator(const char* op)
+    {
+        if ( peekOperator(op) ) {
+            ++_pos;
+
+            return true;
+        }
+
+        return false;
+    }
+
+    static bool isValue(const Operand& o)
+    {
+        return o.kind == Operand::eKindValue;
+    }
+
+    void emit(OpCodeEnum op,
+              int arg = 0,
+              int arg2 = 0,
+              NativeExpression::Value constant = makeValue(0., true))
+    {
+        Instruction i;
+
+        i.op = op;
+        i.arg = arg;
+        i.arg2 = arg2;
+        i.constant = constant;
+        _program->code.push_back(i);
+
+        ///Keep track of the stack depth
+        switch (op) {
+        case eOpCodePushConstant:
+        case eOpCodePushFrame:
+        case eOpCodePushView:
+        case eOpCodeKnobValue:
+            ++_depth;
+            break;
+        case eOpCodeKnobValueAtTime:
+        case eOpCodeNeg:
+            break;
+        case eOpCodeCall:
+            _depth -= arg2 - 1;
+            break;
+        default:
+            --_depth;
+            break;
+        }
+        _maxDepth = std::max(_maxDepth, _depth);
+    }
+
+    // expression := term (('+'|'-') term)*
+    bool parseExpression(Operand* o)
+    {
+        if ( !parseTerm(o) ) {
+            return false;
+        }
+        for (;;) {
+            OpCodeEnum op;
+            if ( acceptOperator("+") ) {
+                op = eOpCodeAdd;
+            } else if ( acceptOperator("-") ) {
+                op = eOpCodeSub;
+            } else {
+                return true;
+            }
+            Operand rhs;
+            if ( !isValue(*o) || !parseTerm(&rhs) || !isValue(rhs) ) {
+                return false;
+            }
+            emit(op);
+        }
+    }
+
+    // term := factor (('*'|'/'|'//'|'%') factor)*
+    bool parseTerm(Operand* o)
+    {
+        if ( !parseFactor(o) ) {
+            return false;
+        }
+        for (;;) {
+            OpCodeEnum op;
+            if ( acceptOperator("*") ) {
+                op = eOpCodeMul;
+            } else if ( acceptOperator("//") ) {
+                op = eOpCodeFloorDiv;
+            } else if ( acceptOperator("/") ) {
+                op = eOpCodeDiv;
+            } else if ( acceptOperator("%") ) {
+                op = eOpCodeMod;
+            } else {
+                return true;
+            }
+            Operand rhs;
+            if ( !isValue(*o) || !parseFactor(&rhs) || !isValue(rhs) ) {
+                return false;
+            }
+            emit(op);
+        }
+    }
+
+    // factor := ('+'|'-') factor | power
+    bool parseFactor(Operand* o)
+    {
+        if ( acceptOperator("+") ) {
+            return parseFactor(o) && isValue(*o);
+        } else if ( acceptOperator("-") ) {
+            if ( !parseFactor(o) || !isValue(*o) ) {
+                return false;
+            }
+            emit(eOpCodeNeg);
+
+            return true;
+        }
+
+        return parsePower(o);
+    }
+
+    // power := primary ['**' factor]
+    bool parsePower(Operand* o)
+    {
+        if ( !parsePrimary(o) ) {
+            return false;
+        }
+        if ( acceptOperator("**") ) {
+            Operand rhs;
+            if ( !isValue(*o) || !parseFactor(&rhs) || !isValue(rhs) ) {
+                return false;
+            }
+            emit(eOpCodePow);
+        }
+
+        return true;
+    }
+
+    // primary := atom ('.' NAME | '(' arguments ')')*
+    bool parsePrimary(Operand* o)
+    {
+        if ( !parseAtom(o) ) {
+            return false;
+        }
+        for (;;) {
+            if ( acceptOperator(".") ) {
+                if (peek().type != eTokenTypeName) {
+                    return false;
+                }
+                std::string attr = peek().text;
+                ++_pos;
+                if ( !resolveAttribute(attr, o) ) {
+                    return false;
+                }
+            } else if ( acceptOperator("(") ) {
+                if ( !parseCall(o) ) {
+                    return false;
+                }
+            } else {
+                return true;
+            }
+        }
+    }
+
+    // atom := NUMBER | NAME | '(' expression ')'
+    bool parseAtom(Operand* o)
+    {
+        const Token& t = peek();
+
+        if (t.type == eTokenTypeNumber) {
+            ++_pos;
+            emit(eOpCodePushConstant, 0, 0, t.number);
+            o->kind = Operand::eKindValue;
+
+            return true;
+        } else if (t.type == eTokenTypeName) {
+            ++_pos;
+
+            return resolveName(t.text, o);
+        } else if ( acceptOperator("(") ) {
+            return parseExpression(o) && isValue(*o) && acceptOperator(")");
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Parses the arguments of a call, the opening parenthesis has been consumed
+     **/
+    bool parseArguments(int* nArgs)
+    {
+        *nArgs = 0;
+        if ( acceptOperator(")") ) {
+            return true;
+        }
+        for (;;) {
+            Operand arg;
+            if ( !parseExpression(&arg) || !isValue(arg) ) {
+                return false;
+            }
+            ++*nArgs;
+            if ( acceptOperator(")") ) {
+                return true;
+            }
+            if ( !acceptOperator(",") ) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @brief Parses an integer literal used as the dimension argument of getValue/getValueAtTime
+     **/
+    bool parseDimension(int* dimension)
+    {
+        const Token& t = peek();
+
+        if ( (t.type == eTokenTypeNumber) && t.number.isInt ) {
+            *dimension = (int)t.number.value;
+        } else if ( (t.type == eTokenTypeName) && (t.text == "dimension") && (_dimension != -1) ) {
+            *dimension = _dimension;
+        } else {
+            return false;
+        }
+        ++_pos;
+
+        return true;
+    }
+
+    bool parseCall(Operand* o)
+    {
+        if (o->kind == Operand::eKindFunction) {
+            int nArgs;
+            if ( !parseArguments(&nArgs) ) {
+                return false;
+            }
+            const FunctionDesc& desc = kFunctions[o->function];
+            if ( (nArgs < desc.minArgs) || ( (desc.maxArgs != -1) && (nArgs > desc.maxArgs) ) ) {
+                return false;
+            }
+            emit(eOpCodeCall, (int)desc.function, nArgs);
+            o->kind = Operand::eKindValue;
+
+            return true;
+        } else if (o->kind != Operand::eKindKnobMethod) {
+            return false;
+        }
+
+        KnobPtr knob = o->knob;
+        int nDims = knob->getDimension();
+        bool isColor = dynamic_cast<KnobColor*>( knob.get() ) != 0;
+        if (o->method == "get") {
+            ///get() and get(frame), the later is the only one evaluating its argument before the parameter
+            bool atTime = false;
+            if ( !acceptOperator(")") ) {
+                Operand time;
+                if ( !parseExpression(&time) || !isValue(time) || !acceptOperator(")") ) {
+                    return false;
+                }
+                atTime = true;
+            }
+            if ( (nDims == 1) && !isColor ) {
+                return emitKnobValue(knob, 0, atTime, o);
+            }
+            o->kind = Operand::eKindTuple;
+            o->tupleAtTime = atTime;
+
+            return true;
+        } else if ( (o->method == "getValue") || (o->method == "getValueAtTime") ) {
+            bool atTime = o->method == "getValueAtTime";
+            bool isBool = dynamic_cast<KnobBool*>( knob.get() ) != 0;
+            if (atTime) {
+                Operand time;
+                if ( !parseExpression(&time) || !isValue(time) ) {
+                    return false;
+                }
+            }
+            int dimension = 0;
+            ///BooleanParam.getValue() and getValueAtTime(time) have no dimension argument
+            if ( !isBool && ( atTime ? acceptOperator(",") : !peekOperator(")") ) ) {
+                if ( !parseDimension(&dimension) ) {
+                    return false;
+                }
+            }
+            if ( !acceptOperator(")") || (dimension < 0) || (dimension >= nDims) ) {
+                return false;
+            }
+
+            return emitKnobValue(knob, dimension, atTime, o);
+        }
+
+        return false;
+    } // parseCall
+
+    bool emitKnobValue(const KnobPtr& knob,
+                       int dimension,
+                       bool atTime,
+                       Operand* o)
+    {
+        ///Register the parameter once per program
+        int index = -1;
+
+        for (std::size_t i = 0; i < _program->knobs.size(); ++i) {
+            if ( _program->knobs[i].knob.lock() == knob ) {
+                index = (int)i;
+                break;
+            }
+        }
+        if (index == -1) {
+            KnobRef ref;
+            ref.knob = knob;
+            KnobHolder* holder = knob->getHolder();
+            EffectInstance* effect = dynamic_cast<EffectInstance*>(holder);
+            if (effect) {
+                ref.node = effect->getNode();
+            }
+            ref.doubleKnob = dynamic_cast<Knob<double>*>( knob.get() );
+            ref.intKnob = dynamic_cast<Knob<int>*>( knob.get() );
+            ref.boolKnob = dynamic_cast<Knob<bool>*>( knob.get() );
+            if (ref.doubleKnob) {
+                ref.type = eKnobTypeDouble;
+            } else if (ref.intKnob) {
+                ref.type = eKnobTypeInt;
+            } else if (ref.boolKnob) {
+                ref.type = eKnobTypeBool;
+            } else {
+                return false;
+            }
+            index = (int)_program->knobs.size();
+            _program->knobs.push_back(ref);
+        }
+        emit(atTime ? eOpCodeKnobValueAtTime : eOpCodeKnobValue, index, dimension);
+        o->kind = Operand::eKindValue;
+        o->knob.reset();
+
+        return true;
+    }
+
+    /**
+     * @brief Returns true for the parameters whose Python wrapper is one of IntParam, Int2DParam, Int3DParam,
+     * DoubleParam, Double2DParam, Double3DParam, ColorParam or BooleanParam, see Effect::createParamWrapperForKnob
+     **/
+    static bool isSupportedKnob(const KnobPtr& knob)
+    {
+        if (!knob) {
+            return false;
+        }
+        int nDims = knob->getDimension();
+        if ( dynamic_cast<KnobInt*>( knob.get() ) || dynamic_cast<KnobDouble*>( knob.get() ) ) {
+            return nDims >= 1 && nDims <= 3;
+        } else if ( dynamic_cast<KnobColor*>( knob.get() ) ) {
+            return nDims == 3 || nDims == 4;
+        } else if ( dynamic_cast<KnobBool*>( knob.get() ) ) {
+            return nDims == 1;
+        }
+
+        return false;
+    }
+
+    static NodePtr findChildNode(const boost::shared_ptr<NodeCollection>& collection,
+                                 const std::string& name)
+    {
+        NodesList nodes = collection->getNodes();
+
+        for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
+            if ( (*it)->isActivated() && !(*it)->getParentMultiInstance() && ( (*it)->getScriptName_mt_safe() == name ) ) {
+                return *it;
+            }
+        }
+
+        return NodePtr();
+    }
+
+    static boost::shared_ptr<NodeCollection> collectionOfGroupNode(const NodePtr& node)
+    {
+        return boost::dynamic_pointer_cast<NodeGroup>( node->getEffectInstance() );
+    }
+
+    /**
+     * @brief Resolves a bare name the same way as the scope declared by KnobHelperPrivate::declarePythonVariables:
+     * the function arguments and locals first, then the globals of the main module
+     **/
+    bool resolveName(const std::string& name,
+                     Operand* o)
+    {
+        if (name == "frame") {
+            emit(eOpCodePushFrame);
+            o->kind = Operand::eKindValue;
+
+            return true;
+        } else if (name == "view") {
+            emit(eOpCodePushView);
+            o->kind = Operand::eKindValue;
+
+            return true;
+        }
+
+        boost::shared_ptr<NodeCollection> group = _thisNode->getGroup();
+        if (!group) {
+            return false;
+        }
+        NodePtr sibling = findChildNode(group, name);
+        if (sibling) {
+            o->kind = Operand::eKindNode;
+            o->node = sibling;
+
+            return true;
+        }
+        if (name == "thisGroup") {
+            NodeGroup* isGroup = dynamic_cast<NodeGroup*>( group.get() );
+            if (isGroup) {
+                o->kind = Operand::eKindNode;
+                o->node = isGroup->getNode();
+            } else {
+                o->kind = Operand::eKindCollection;
+                o->collection = group;
+            }
+
+            return true;
+        } else if (name == "thisNode") {
+            o->kind = Operand::eKindNode;
+            o->node = _thisNode;
+
+            return true;
+        } else if (name == "thisParam") {
+            if ( !isSupportedKnob(_thisParam) ) {
+                return false;
+            }
+            o->kind = Operand::eKindKnob;
+            o->knob = _thisParam;
+
+            return true;
+        } else if (name == "dimension") {
+            if (_dimension == -1) {
+                return false;
+            }
+            emit(eOpCodePushConstant, 0, 0, makeValue(_dimension, true));
+            o->kind = Operand::eKindValue;
+
+            return true;
+        } else if (name == "app") {
+            o->kind = Operand::eKindCollection;
+            o->collection = _thisNode->getApp()->getProject();
+
+            return true;
+        } else if ( (name == "random") || (name == "randomInt") || (name == "curve") ) {
+            return false;
+        } else if (name == "pi") {
+            emit(eOpCodePushConstant, 0, 0, makeValue(M_PI, false));
+            o->kind = Operand::eKindValue;
+
+            return true;
+        } else if (name == "e") {
+            emit(eOpCodePushConstant, 0, 0, makeValue(M_E, false));
+            o->kind = Operand::eKindValue;
+
+            return true;
+        }
+        for (int i = 0; kFunctions[i].name; ++i) {
+            if (name == kFunctions[i].name) {
+                o->kind = Operand::eKindFunction;
+                o->function = i;
+
+                return true;
+            }
+        }
+
+        return false;
+    } // resolveName
+
+    bool resolveAttribute(const std::string& attr,
+                          Operand* o)
+    {
+        switch (o->kind) {
+        case Operand::eKindCollection: {
+            NodePtr node = findChildNode(o->collection, attr);
+            if (!node) {
+                return false;
+            }
+            o->kind = Operand::eKindNode;
+            o->node = node;
+            o->collection.reset();
+
+            return true;
+        }
+        case Operand::eKindNode: {
+            ///The nodes of a group are attributes of the group, the parameters are attributes of any node
+            boost::shared_ptr<NodeCollection> children = collectionOfGroupNode(o->node);
+            if (children) {
+                NodePtr child = findChildNode(children, attr);
+                if (child) {
+                    o->node = child;
+
+                    return true;
+                }
+            }
+            KnobPtr knob = o->node->getKnobByName(attr);
+            if ( !isSupportedKnob(knob) ) {
+                return false;
+            }
+            o->kind = Operand::eKindKnob;
+            o->knob = knob;
+            o->node.reset();
+
+            return true;
+        }
+        case Operand::eKindKnob:
+            if ( (attr != "get") && (attr != "getValue") && (attr != "getValueAtTime") ) {
+                return false;
+            }
+            o->kind = Operand::eKindKnobMethod;
+            o->method = attr;
+
+            return true;
+        case Operand::eKindTuple: {
+            ///Members of Int2DTuple, Double3DTuple, ColorTuple...
+            ///The alpha of ColorTuple is not read from the parameter for 3 dimensional colors, leave it to Python
+            bool isColor = dynamic_cast<KnobColor*>( o->knob.get() ) != 0;
+            const char* members = isColor ? "rgb" : "xyz";
+            int nDims = isColor ? 3 : o->knob->getDimension();
+            for (int i = 0; i < nDims; ++i) {
+                if ( (attr.size() == 1) && (attr[0] == members[i]) ) {
+                    KnobPtr knob = o->knob;
+
+                    return emitKnobValue(knob, i, o->tupleAtTime, o);
+                }
+            }
+
+            return false;
+        }
+        case Operand::eKindValue:
+        case Operand::eKindKnobMethod:
+        case Operand::eKindFunction:
+            break;
+        } // switch
+
+        return false;
+    } // resolveAttribute
+};
+
+} // anon namespace
+
+NativeExpression::NativeExpression()
+    : _imp( new NativeExpressionPrivate() )
+{
+}
+
+NativeExpression::~NativeExpression()
+{
+    delete _imp;
+}
+
+boost::shared_ptr<NativeExpression>
+NativeExpression::compile(const std::string& expression,
+                          KnobI* knob,
+                          int dimension)
+{
+    boost::shared_ptr<NativeExpression> ret;
+
+    ///String parameters interpret the result of their expression, leave them to Python
+    if ( !knob || dynamic_cast<Knob<std::string>*>(knob) ) {
+        return ret;
+    }
+    EffectInstance* effect = dynamic_cast<EffectInstance*>( knob->getHolder() );
+    if (!effect) {
+        return ret;
+    }
+    NodePtr node = effect->getNode();
+    if ( !node || !node->getApp() ) {
+        return ret;
+    }
+    KnobPtr thisParam = node->getKnobByName( knob->getName() );
+    if (thisParam.get() != knob) {
+        return ret;
+    }
+
+    std::vector<Token> tokens;
+    if ( !tokenize(expression, &tokens) ) {
+        return ret;
+    }
+
+    ret.reset( new NativeExpression() );
+    ExpressionCompiler compiler(tokens, ret->_imp, node, thisParam, dimension);
+    if ( !compiler.compile() ) {
+        ret.reset();
+    }
+
+    return ret;
+}
+
+bool
+NativeExpression::evaluate(double time,
+                           ViewIdx view,
+                           Value* ret) const
+{
+    Value stack[NATIVE_EXPRESSION_MAX_STACK];
+    int sp = 0;
+
+    for (std::vector<Instruction>::const_iterator it = _imp->code.begin(); it != _imp->code.end(); ++it) {
+        switch (it->op) {
+        case eOpCodePushConstant:
+            stack[sp++] = it->constant;
+            break;
+        case eOpCodePushFrame:
+            ///The frame is a Python int when it is integral, see KnobHelper::executeExpression
+            stack[sp++] = makeValue( time, time == (int)time );
+            break;
+        case eOpCodePushView:
+            stack[sp++] = makeValue(view.i, true);
+            break;
+        case eOpCodeKnobValue:
+        case eOpCodeKnobValueAtTime: {
+            const KnobRef& ref = _imp->knobs[it->arg];
+            KnobPtr knob = ref.knob.lock();
+            NodePtr node = ref.node.lock();
+            ///Python can no longer reach the parameter of a deleted node
+            if ( !knob || ( node && !node->isActivated() ) ) {
+                return false;
+            }
+            bool atTime = it->op == eOpCodeKnobValueAtTime;
+            double t = atTime ? stack[--sp].value : 0.;
+            switch (ref.type) {
+            case eKnobTypeDouble:
+                stack[sp++] = makeValue(atTime ? ref.doubleKnob->getValueAtTime(t, it->arg2) : ref.doubleKnob->getValue(it->arg2), false);
+                break;
+            case eKnobTypeInt:
+                stack[sp++] = makeValue(atTime ? ref.intKnob->getValueAtTime(t, it->arg2) : ref.intKnob->getValue(it->arg2), true);
+                break;
+            case eKnobTypeBool:
+                stack[sp++] = makeValue(atTime ? ref.boolKnob->getValueAtTime(t, it->arg2) : ref.boolKnob->getValue(it->arg2), true);
+                break;
+            }
+            break;
+        }
+        case eOpCodeNeg:
+            stack[sp - 1].value = -stack[sp - 1].value;
+            break;
+        case eOpCodeCall: {
+            sp -= it->arg2;
+            Value result;
+            if ( !callFunction( (FunctionEnum)it->arg, &stack[sp], it->arg2, &result ) ) {
+                return false;
+            }
+            stack[sp++] = result;
+            break;
+        }
+        default: {
+            ///Binary operators
+            const Value b = stack[--sp];
+            Value& a = stack[sp - 1];
+            bool bothInt = a.isInt && b.isInt;
+            switch (it->op) {
+            case eOpCodeAdd:
+                a.value += b.value;
+                break;
+            case eOpCodeSub:
+                a.value -= b.value;
+                break;
+            case eOpCodeMul:
+                a.value *= b.value;
+                break;
+            case eOpCodeDiv:
+                if (b.value == 0.) {
+                    return false;
+                }
+#ifdef IS_PYTHON_2
+                ///Integer division of Python 2
+                a.value = bothInt ? std::floor(a.value / b.value) : a.value / b.value;
+#else
+                a.value /= b.value;
+                bothInt = false;
+#endif
+                break;
+            case eOpCodeFloorDiv:
+                if (b.value == 0.) {
+                    return false;
+                }
+                a.value = std::floor(a.value / b.value);
+                break;
+            case eOpCodeMod:
+                if (b.value == 0.) {
+                    return false;
+                }
+                a.value = pythonMod(a.value, b.value);
+                break;
+            case eOpCodePow:
+                if ( (a.value == 0.) && (b.value < 0.) ) {
+                    return false;
+                }
+                if ( !bothInt && (a.value < 0.) && ( b.value != std::floor(b.value) ) ) {
+                    return false;
+                }
+                a.value = std::pow(a.value, b.value);
+                ///A negative integer exponent gives a float
+                bothInt = bothInt && b.value >= 0.;
+                break;
+            default:
+                assert(false);
+                break;
+            }
+            a.isInt = bothInt;
+            if ( !isFinite(a.value) ) {
+                return false;
+            }
+            break;
+        }
+        } // switch
+    }
+
+    assert(sp == 1);
+    *ret = stack[0];
+
+    return true;
+} // NativeExpression::evaluate
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,94 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_NATIVEEXPRESSION_H
+#define NATRON_ENGINE_NATIVEEXPRESSION_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <string>
+
+#include "Global/Macros.h"
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+#include "Engine/ViewIdx.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+struct NativeExpressionPrivate;
+
+/**
+ * @brief A single-line knob expression compiled to a small stack bytecode that is evaluated without the Python interpreter.
+ * Only a subset of Python is understood:
+ * - int and float literals, the frame, view and dimension variables
+ * - the + - * / // % ** operators and the unary signs, with the Python semantics for ints and floats
+ * - the functions and constants of the math module that are imported in the expressions scope, plus abs, min, max, int and float
+ * - get(), get(frame), getValue(dimension) and getValueAtTime(time, dimension) on the int, double, boolean and color
+ * parameters of the nodes the expression can reach by name (thisNode, thisGroup, app and the nodes of the same group),
+ * the x/y/z and r/g/b members of the tuples returned by get() on multi-dimensional parameters.
+ * Anything else fails to compile and the expression keeps being run by Python.
+ *
+ * Once compiled, the expression is immutable and can be evaluated concurrently by any thread.
+ **/
+class NativeExpression
+{
+public:
+
+    /**
+     * @brief The result of an expression: Python ints and bools have isInt set, floats do not.
+     **/
+    struct Value
+    {
+        double value;
+        bool isInt;
+    };
+
+    /**
+     * @brief Returns the native version of the expression set on the given dimension of knob, or NULL if the
+     * expression is not in the subset described above. The nodes and parameters referenced by the expression
+     * are resolved now, this must be called again whenever the expression or the names it refers to change.
+     **/
+    static boost::shared_ptr<NativeExpression> compile(const std::string& expression, KnobI* knob, int dimension);
+
+    ~NativeExpression();
+
+    /**
+     * @brief Evaluates the expression at the given time and view. Returns false where Python would have raised an exception,
+     * e.g: on a division by zero or if a parameter referenced by the expression no longer exists.
+     **/
+    bool evaluate(double time, ViewIdx view, Value* ret) const WARN_UNUSED_RETURN;
+
+private:
+
+    NativeExpression();
+
+    NativeExpressionPrivate* _imp;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_NATIVEEXPRESSION_H
@@ -242,6 +242,13 @@ struct Node::Implementation
     , renderInstancesSharedMutex(QMutex::Recursive)
     , knobsAge(0)
     , knobsAgeMutex()
+    , hash()
+    , hashDirty(true)
+    , hashDirtyAge(0)
+    , ownHash()
+    , ownHashKnobsAge(0)
+    , ownHashScriptName()
+    , ownHashCreationTime(0)
     , masterNodeMutex()
     , masterNode()
     , nodeLinks()
@@ -433,8 +440,16 @@ struct Node::Implementation
     //only 1 clone can render at any time
     
     U64 knobsAge; //< the age of the knobs in this effect. It gets incremented every times the effect has its evaluate() function called.
-    mutable QReadWriteLock knobsAgeMutex; //< protects knobsAge and hash
-    Hash64 hash; //< recomputed everytime knobsAge is changed.
+    mutable QReadWriteLock knobsAgeMutex; //< protects knobsAge, hash and the fields below
+    Hash64 hash; //< recomputed lazily by getHashValue() once it has been marked dirty
+    bool hashDirty; //< true when something upstream changed since the hash was computed
+    U64 hashDirtyAge; //< incremented each time the hash is marked dirty, to detect changes during its computation
+    
+    ///The contribution of the node itself to its hash, recomputed only when the key below changes
+    Hash64 ownHash;
+    U64 ownHashKnobsAge;
+    std::string ownHashScriptName;
+    qint64 ownHashCreationTime;
     
     mutable QMutex masterNodeMutex; //< protects masterNode and nodeLinks
     NodeWPtr masterNode; //< this points to the master when the node is a clone
@@ -1214,11 +1229,27 @@ Node::getChildrenMultiInstance(NodesList* children) const
 U64
 Node::getHashValue() const
 {
-    QReadLocker l(&_imp->knobsAgeMutex);
+    {
+        QReadLocker l(&_imp->knobsAgeMutex);
+        if (!_imp->hashDirty) {
+            return _imp->hash.value();
+        }
+    }
+    
+    ///Something changed upstream since the hash was computed, refresh it now that it is needed
+    const_cast<Node*>(this)->refreshDirtyHashes();
     
+    QReadLocker l(&_imp->knobsAgeMutex);
     return _imp->hash.value();
 }
 
+bool
+Node::isHashDirty() const
+{
+    QReadLocker l(&_imp->knobsAgeMutex);
+    return _imp->hashDirty;
+}
+
 std::string
 Node::getCacheID() const
 {
@@ -1226,89 +1257,117 @@ Node::getCacheID() const
     return _imp->cacheID;
 }
 
+void
+Node::getHashInputs(std::vector<NodePtr>* inputs) const
+{
+    ViewerInstance* isViewer = dynamic_cast<ViewerInstance*>(_imp->effect.get());
+    
+    if (isViewer) {
+        int activeInput[2];
+        isViewer->getActiveInputs(activeInput[0], activeInput[1]);
+        
+        for (int i = 0; i < 2; ++i) {
+            inputs->push_back(getInput(activeInput[i]));
+        }
+    } else {
+        boost::shared_ptr<RotoDrawableItem> attachedStroke = _imp->paintStroke.lock();
+        NodePtr attachedStrokeContextNode;
+        if (attachedStroke) {
+            attachedStrokeContextNode = attachedStroke->getContext()->getNode();
+        }
+        int maxInputs = getMaxInputCount();
+        for (int i = 0; i < maxInputs; ++i) {
+            NodePtr input = getInput(i);
+            //Since the rotopaint node is connected to the internal nodes of the tree, don't change their hash
+            if (attachedStroke && input == attachedStrokeContextNode) {
+                input.reset();
+            }
+            inputs->push_back(input);
+        }
+    }
+}
+
 bool
 Node::computeHashInternal()
 {
     if (!_imp->effect) {
         return false;
     }
-    ///Always called in the main thread
-    assert( QThread::currentThread() == qApp->thread() );
-    if (!_imp->inputsInitialized) {
-        qDebug() << "Node::computeHash(): inputs not initialized";
+    ///Before the inputs are initialized the hash misses them: it is computed but stays dirty
+    const bool inputsInitialized = _imp->inputsInitialized;
+    
+    U64 dirtyAge;
+    {
+        QReadLocker l(&_imp->knobsAgeMutex);
+        dirtyAge = _imp->hashDirtyAge;
     }
     
+    ///Read the hash of the inputs first, outside of our lock: they refresh their own hash if it is dirty
+    std::vector<NodePtr> inputs;
+    getHashInputs(&inputs);
+    bool isViewer = dynamic_cast<ViewerInstance*>(_imp->effect.get()) != 0;
+    std::vector<U64> inputsHash;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        if (inputs[i]) {
+            ///Add the index of the input to its hash.
+            ///Explanation: if we didn't add this, just switching inputs would produce a similar
+            ///hash.
+            inputsHash.push_back(isViewer ? inputs[i]->getHashValue() : inputs[i]->getHashValue() + i);
+        }
+    }
+    
+    ///Also append the effect's label to distinguish 2 instances with the same parameters
+    std::string scriptName = getScriptName_mt_safe();
+    
+    ///Also append the project's creation time in the hash because 2 projects openend concurrently
+    ///could reproduce the same (especially simple graphs like Viewer-Reader)
+    qint64 creationTime =  getApp()->getProject()->getProjectCreationTime();
+    
     U64 oldHash,newHash;
     {
         QWriteLocker l(&_imp->knobsAgeMutex);
         
         oldHash = _imp->hash.value();
         
-        ///reset the hash value
-        _imp->hash.reset();
-        
-        ///append the effect's own age
-        _imp->hash.append(_imp->knobsAge);
-        
-        ///append all inputs hash
-        boost::shared_ptr<RotoDrawableItem> attachedStroke = _imp->paintStroke.lock();
-        NodePtr attachedStrokeContextNode;
-        if (attachedStroke) {
-            attachedStrokeContextNode = attachedStroke->getContext()->getNode();
-        }
-        {
-            ViewerInstance* isViewer = dynamic_cast<ViewerInstance*>(_imp->effect.get());
-            
-            if (isViewer) {
-                int activeInput[2];
-                isViewer->getActiveInputs(activeInput[0], activeInput[1]);
-                
-                for (int i = 0; i < 2; ++i) {
-                    NodePtr input = getInput(activeInput[i]);
-                    if (input) {
-                        _imp->hash.append(input->getHashValue() );
-                    }
-                }
-            } else {
-                for (U32 i = 0; i < _imp->inputs.size(); ++i) {
-                    NodePtr input = getInput(i);
-                    if (input) {
-                        
-                        //Since the rotopaint node is connected to the internal nodes of the tree, don't change their hash
-                        if (attachedStroke && input == attachedStrokeContextNode) {
-                            continue;
-                        }
-                        ///Add the index of the input to its hash.
-                        ///Explanation: if we didn't add this, just switching inputs would produce a similar
-                        ///hash.
-                        _imp->hash.append(input->getHashValue() + i);
-                    }
-                }
-            }
+        if ( !_imp->ownHash.valid() || (_imp->ownHashKnobsAge != _imp->knobsAge) ||
+             (_imp->ownHashScriptName != scriptName) || (_imp->ownHashCreationTime != creationTime) ) {
+            _imp->ownHash.reset();
+            _imp->ownHash.append(_imp->knobsAge);
+            Hash64_appendQString( &_imp->ownHash, QString( scriptName.c_str() ) );
+            _imp->ownHash.append(creationTime);
+            _imp->ownHash.computeHash();
+            _imp->ownHashKnobsAge = _imp->knobsAge;
+            _imp->ownHashScriptName = scriptName;
+            _imp->ownHashCreationTime = creationTime;
         }
         
         // We do not append the roto age any longer since now every tool in the RotoContext is backed-up by nodes which
         // have their own age. Instead each action in the Rotocontext is followed by a incrementNodesAge() call so that each
         // node respecitively have their hash correctly set.
         
-        //        boost::shared_ptr<RotoContext> roto = attachedStroke ? attachedStroke->getContext() : getRotoContext();
-        //        if (roto) {
-        //            U64 rotoAge = roto->getAge();
-        //            _imp->hash.append(rotoAge);
-        //        }
-        
-        ///Also append the effect's label to distinguish 2 instances with the same parameters
-        Hash64_appendQString( &_imp->hash, QString( getScriptName().c_str() ) );
-        
-        ///Also append the project's creation time in the hash because 2 projects openend concurrently
-        ///could reproduce the same (especially simple graphs like Viewer-Reader)
-        qint64 creationTime =  getApp()->getProject()->getProjectCreationTime();
-        _imp->hash.append(creationTime);
-        
+        _imp->hash.reset();
+        _imp->hash.append( _imp->ownHash.value() );
+        for (std::size_t i = 0; i < inputsHash.size(); ++i) {
+            _imp->hash.append(inputsHash[i]);
+        }
         _imp->hash.computeHash();
         
         newHash = _imp->hash.value();
         
+        ///If the hash was invalidated again while we were computing it, or if an input was invalidated before
+        ///the propagation could reach us, it stays dirty: a clean node never has a dirty input.
+        ///It also stays dirty until the inputs are initialized, so that it is computed again with them.
+        bool inputDirty = false;
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            if ( inputs[i] && inputs[i]->isHashDirty() ) {
+                inputDirty = true;
+                break;
+            }
+        }
+        if ( inputsInitialized && (_imp->hashDirtyAge == dirtyAge) && !inputDirty ) {
+            _imp->hashDirty = false;
+        }
+        
     } // QWriteLocker l(&_imp->knobsAgeMutex);
     
     bool hashChanged = oldHash != newHash;
@@ -1327,23 +1386,56 @@ Node::computeHashInternal()
     return hashChanged;
 }
 
-
 void
-Node::computeHashRecursive(std::list<Node*>& marked)
+Node::refreshDirtyHashes()
 {
-    if (std::find(marked.begin(), marked.end(), this) != marked.end()) {
-        return;
-    }
+    ///Walk upstream through the dirty nodes without recursing, graphs can be thousands of nodes deep,
+    ///then compute their hash from the top of the tree so that each one is computed once
+    std::vector<Node*> sorted;
+    std::list<NodePtr> keepAlive;
+    std::set<Node*> visited;
+    std::vector<std::pair<Node*, bool> > stack; //< <node, inputs pushed>
     
-    bool hasChanged = computeHashInternal();
-    marked.push_back(this);
-    if (!hasChanged) {
-        //Nothing changed, no need to recurse on outputs
-        return;
+    stack.push_back( std::make_pair(this, false) );
+    visited.insert(this);
+    while ( !stack.empty() ) {
+        if (stack.back().second) {
+            sorted.push_back(stack.back().first);
+            stack.pop_back();
+            continue;
+        }
+        stack.back().second = true;
+        std::vector<NodePtr> inputs;
+        stack.back().first->getHashInputs(&inputs);
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            if ( inputs[i] && inputs[i]->isHashDirty() && visited.insert( inputs[i].get() ).second ) {
+                keepAlive.push_back(inputs[i]);
+                stack.push_back( std::make_pair(inputs[i].get(), false) );
+            }
+        }
     }
     
+    for (std::vector<Node*>::iterator it = sorted.begin(); it != sorted.end(); ++it) {
+        ignore_result( (*it)->computeHashInternal() );
+    }
+}
+
+void
+Node::invalidateHashRecursive(bool isOrigin)
+{
+    {
+        QWriteLocker l(&_imp->knobsAgeMutex);
+        ++_imp->hashDirtyAge;
+        bool wasDirty = _imp->hashDirty;
+        _imp->hashDirty = true;
+        
+        ///Everything downstream of a dirty node is already dirty
+        if (wasDirty && !isOrigin) {
+            return;
+        }
+    }
     
-    bool isRotoPaint = _imp->effect->isRotoPaintNode();
+    bool isRotoPaint = _imp->effect && _imp->effect->isRotoPaintNode();
     
     ///call it on all the outputs
     NodesList outputs;
@@ -1356,16 +1448,16 @@ Node::computeHashRecursive(std::list<Node*>& marked)
         if (isRotoPaint && attachedStroke && attachedStroke->getContext()->getNode().get() == this) {
             continue;
         }
-        (*it)->computeHashRecursive(marked);
+        (*it)->invalidateHashRecursive(false);
     }
     
     
-    ///If the node has a rotopaint tree, compute the hash of the nodes in the tree
+    ///If the node has a rotopaint tree, invalidate the hash of the nodes in the tree
     if (_imp->rotoContext) {
         NodesList allItems;
         _imp->rotoContext->getRotoPaintTreeNodes(&allItems);
         for (NodesList::iterator it = allItems.begin(); it!=allItems.end(); ++it) {
-            (*it)->computeHashRecursive(marked);
+            (*it)->invalidateHashRecursive(false);
         }
         
     }
@@ -1411,8 +1503,9 @@ Node::computeHash()
         Q_EMIT mustComputeHashOnMainThread();
         return;
     }
-    std::list<Node*> marked;
-    computeHashRecursive(marked);
+    
+    ///Only mark the hashes dirty down the tree, they are recomputed by getHashValue() when a render or the cache needs them
+    invalidateHashRecursive(true);
     
 } // computeHash
 
@@ -5500,8 +5593,10 @@ Node::makePreviewImage(SequenceTime time,
                 renderPreviewForDepth<unsigned short, 65535>(*img, elemCount, width, height,convertToSrgb, buf);
                 break;
             }
-            case eImageBitDepthHalf:
+            case eImageBitDepthHalf: {
+                renderPreviewForDepth<Half, 1>(*img, elemCount, width, height,convertToSrgb, buf);
                 break;
+            }
             case eImageBitDepthFloat: {
                 renderPreviewForDepth<float, 1>(*img, elemCount, width, height,convertToSrgb, buf);
                 break;
@@ -7060,11 +7155,10 @@ Node::onEffectKnobValueChanged(KnobI* what,
             ///When a group is disabled we have to force a hash change of all nodes inside otherwise the image will stay cached
             
             NodesList nodes = isGroup->getNodes();
-            std::list<Node*> markedNodes;
             for (NodesList::iterator it = nodes.begin(); it != nodes.end(); ++it) {
                 //This will not trigger a hash recomputation
                 (*it)->incrementKnobsAge_internal();
-                (*it)->computeHashRecursive(markedNodes);
+                (*it)->invalidateHashRecursive(true);
             }
         }
         
@@ -202,7 +202,8 @@ public:
     void getChildrenMultiInstance(NodesList* children) const;
 
     /**
-     * @brief Returns the hash value of the node, or 0 if it has never been computed.
+     * @brief Returns the hash value of the node. If something changed upstream since it was last computed,
+     * the hash of this node and of the dirty nodes upstream is recomputed first.
      **/
     U64 getHashValue() const;
 
@@ -1112,10 +1113,27 @@ public:
     
 private:
     
-    void computeHashRecursive(std::list<Node*>& marked);
+    /**
+     * @brief Marks the hash of this node and of all the nodes downstream as dirty. The propagation stops at nodes
+     * that are already dirty, unless isOrigin is true.
+     **/
+    void invalidateHashRecursive(bool isOrigin);
+    
+    /**
+     * @brief Recomputes the hash of this node and of all the dirty nodes upstream, inputs first.
+     **/
+    void refreshDirtyHashes();
+    
+    /**
+     * @brief Returns the inputs that contribute to the hash of this node, in order. Inputs not contributing are NULL.
+     **/
+    void getHashInputs(std::vector<NodePtr>* inputs) const;
+    
+    bool isHashDirty() const;
     
     /**
      * @brief Refreshes the node hash depending on its context (knobs age, inputs etc...)
+     * Can be called from any thread, the hash of the inputs is refreshed first if they are dirty.
      * @return True if the hash has changed, false otherwise
      **/
     bool computeHashInternal() WARN_UNUSED_RETURN;
@@ -1273,8 +1291,9 @@ Q_SIGNALS:
 protected:
 
     /**
-     * @brief Recompute the hash value of this node and notify all the clone effects that the values they store in their
-     * knobs is dirty and that they should refresh it by cloning the live instance.
+     * @brief Marks the hash value of this node and of all the nodes downstream dirty. It is recomputed the next time
+     * getHashValue() is called, at which point the clone effects are notified that the values they store in their
+     * knobs are dirty and that they should refresh it by cloning the live instance.
      **/
     void computeHash();
 
@@ -44,7 +44,6 @@ CLANG_DIAG_ON(deprecated-register)
 #ifdef OFX_SUPPORTS_MULTITHREAD
 #include <QtCore/QThread>
 #include <QtCore/QThreadStorage>
-#include <QtConcurrentMap> // QtCore on Qt4, QtConcurrent on Qt5
 GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
 // /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
 #include <boost/bind.hpp>
@@ -98,6 +97,7 @@ CLANG_DIAG_ON(unknown-pragmas)
 #include "Engine/Project.h"
 #include "Engine/Settings.h"
 #include "Engine/StandardPaths.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/TLSHolder.h"
 
 //An effect may not use more than this amount of threads
@@ -1002,6 +1002,7 @@ threadFunctionWrapper(OfxThreadFunctionV1 func,
                       unsigned int threadIndex,
                       unsigned int threadMax,
                       const QThread* spawnerThread,
+                      const TLSSnapshotPtr& spawnerTLS,
                       void *customArg)
 {
     assert(threadIndex < threadMax);
@@ -1010,7 +1011,7 @@ threadFunctionWrapper(OfxThreadFunctionV1 func,
     
     QThread* spawnedThread = QThread::currentThread();
     if (spawnedThread != spawnerThread) {
-        appPTR->getAppTLS()->softCopy(spawnerThread, spawnedThread);
+        appPTR->getAppTLS()->copyTLS(spawnerTLS);
     }
 
     OfxStatus ret = kOfxStatOK;
@@ -1032,7 +1033,17 @@ threadFunctionWrapper(OfxThreadFunctionV1 func,
     return ret;
 }
 
-    
+static void
+threadFunctionTask(OfxThreadFunctionV1 func,
+                   unsigned int threadIndex,
+                   unsigned int threadMax,
+                   const QThread* spawnerThread,
+                   const TLSSnapshotPtr& spawnerTLS,
+                   void *customArg,
+                   OfxStatus* ret)
+{
+    *ret = threadFunctionWrapper(func, threadIndex, threadMax, spawnerThread, spawnerTLS, customArg);
+}
 
     
 class OfxThread
@@ -1042,13 +1053,13 @@ public:
     OfxThread(OfxThreadFunctionV1 func,
               unsigned int threadIndex,
               unsigned int threadMax,
-              const QThread* spawnerThread,
+              const TLSSnapshotPtr& spawnerTLS,
               void *customArg,
               OfxStatus *stat)
     : _func(func)
     , _threadIndex(threadIndex)
     , _threadMax(threadMax)
-    , _spawnerThread(spawnerThread)
+    , _spawnerTLS(spawnerTLS)
     , _customArg(customArg)
     , _stat(stat)
     {
@@ -1061,7 +1072,7 @@ public:
         OfxHost::OfxHostDataTLSPtr tls = appPTR->getOFXHost()->getTLSData();
         tls->threadIndexes.push_back((int)_threadIndex);
         
-        appPTR->getAppTLS()->softCopy(_spawnerThread, this);
+        appPTR->getAppTLS()->copyTLS(_spawnerTLS);
         
         assert(*_stat == kOfxStatFailed);
         try {
@@ -1082,7 +1093,7 @@ private:
     OfxThreadFunctionV1 *_func;
     unsigned int _threadIndex;
     unsigned int _threadMax;
-    const QThread* _spawnerThread;
+    TLSSnapshotPtr _spawnerTLS;
     void *_customArg;
     OfxStatus *_stat;
 };
@@ -1117,7 +1128,7 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
     // "nThreads can be more than the value returned by multiThreadNumCPUs, however
     // the threads will be limitted to the number of CPUs returned by multiThreadNumCPUs."
 
-    if ( (nThreads == 1) || (maxConcurrentThread <= 1) || (appPTR->getCurrentSettings()->getNumberOfThreads() == -1) ) {
+    if ( (nThreads == 1) || (maxConcurrentThread <= 1) || (appPTR->getNumberOfThreads() == -1) ) {
         try {
             for (unsigned int i = 0; i < nThreads; ++i) {
                 func(i, nThreads, customArg);
@@ -1130,24 +1141,26 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
     }
     
     QThread* spawnerThread = QThread::currentThread();
+    ///The TLS given to the threads is copied now: this thread runs indexes itself while it waits, which may modify its TLS
+    const TLSSnapshotPtr spawnerTLS = appPTR->getAppTLS()->takeSnapshot();
 
     bool useThreadPool = appPTR->getUseThreadPool();
     
     if (useThreadPool) {
         
-        std::vector<unsigned int> threadIndexes(nThreads);
-        for (unsigned int i = 0; i < nThreads; ++i) {
-            threadIndexes[i] = i;
+        /// DON'T set the maximum thread count of the scheduler, this is a global application setting, and see the documentation excerpt above.
+        /// The calling thread runs the indexes that no worker picked up while it waits, so this also works when
+        /// called from a tile being rendered by a worker.
+        std::vector<OfxStatus> status(nThreads, kOfxStatFailed);
+        {
+            TaskGroup group( appPTR->getTaskScheduler() );
+            for (unsigned int i = 0; i < nThreads; ++i) {
+                group.run( boost::bind(threadFunctionTask, func, i, nThreads, spawnerThread, spawnerTLS, customArg, &status[i]) );
+            }
+            group.wait();
         }
         
-        /// DON'T set the maximum thread count, this is a global application setting, and see the documentation excerpt above
-        //QThreadPool::globalInstance()->setMaxThreadCount(nThreads);
-        QFuture<OfxStatus> future = QtConcurrent::mapped( threadIndexes, boost::bind(threadFunctionWrapper,func, _1, nThreads, spawnerThread, customArg) );
-        future.waitForFinished();
-        ///DON'T reset back to the original value the maximum thread count
-        //QThreadPool::globalInstance()->setMaxThreadCount(QThread::idealThreadCount());
-        
-        for (QFuture<OfxStatus>::const_iterator it = future.begin(); it != future.end(); ++it) {
+        for (std::vector<OfxStatus>::const_iterator it = status.begin(); it != status.end(); ++it) {
             OfxStatus stat = *it;
             if (stat != kOfxStatOK) {
                 return stat;
@@ -1161,7 +1174,7 @@ OfxHost::multiThread(OfxThreadFunctionV1 func,
             // at most maxConcurrentThread should be running at the same time
             QVector<OfxThread*> threads(nThreads);
             for (unsigned int i = 0; i < nThreads; ++i) {
-                threads[i] = new OfxThread(func, i, nThreads, spawnerThread, customArg, &status[i]);
+                threads[i] = new OfxThread(func, i, nThreads, spawnerTLS, customArg, &status[i]);
             }
             unsigned int i = 0; // index of next thread to launch
             unsigned int running = 0; // number of running threads
@@ -1223,6 +1236,9 @@ OfxHost::multiThreadNumCPUS(unsigned int *nCPUs) const
         // activeThreadCount may be negative (for example if releaseThread() is called)
         int activeThreadsCount = QThreadPool::globalInstance()->activeThreadCount();
         
+        // Add the workers of the scheduler busy with tiles or other multi-thread suite calls
+        activeThreadsCount += appPTR->getTaskScheduler()->activeThreadCount();
+        
         // Add the number of threads already running by the multiThreadSuite + parallel renders
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
         activeThreadsCount += appPTR->getNRunningThreads();
@@ -498,6 +498,10 @@ OutputEffectInstance::reportStats(int time,
     for (std::map<NodePtr, NodeRenderStats >::const_iterator it = stats.begin(); it != stats.end(); ++it) {
         *ofile << "------------------------------- " << it->first->getScriptName_mt_safe() << "------------------------------- " << std::endl;
         *ofile << "Time spent rendering: " << Timer::printAsTime(it->second.getTotalTimeSpentRendering(), false).toStdString() << std::endl;
+        const std::map<int, double> & branches = it->second.getInputBranchesTimeSpent();
+        for (std::map<int, double>::const_iterator it2 = branches.begin(); it2 != branches.end(); ++it2) {
+            *ofile << "Time spent pre-rendering input " << it2->first << ": " << Timer::printAsTime(it2->second, false).toStdString() << std::endl;
+        }
         const RectD & rod = it->second.getRoD();
         *ofile << "Region of definition: x1 = " << rod.x1  << " y1 = " << rod.y1 << " x2 = " << rod.x2 << " y2 = " << rod.y2 << std::endl;
         *ofile << "Is Identity to Effect? ";
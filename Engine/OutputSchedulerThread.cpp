@@ -29,6 +29,7 @@
 #include <list>
 #include <algorithm> // min, max
 #include <cassert>
+#include <climits> // INT_MIN
 #include <stdexcept>
 
 #include <QtCore/QMetaType>
@@ -53,6 +54,7 @@
 #include "Engine/OpenGLViewerI.h"
 #include "Engine/Project.h"
 #include "Engine/RenderStats.h"
+#include "Engine/RenderThreadsBalancer.h"
 #include "Engine/RotoContext.h"
 #include "Engine/Settings.h"
 #include "Engine/Timer.h"
@@ -63,6 +65,9 @@
 
 #define NATRON_FPS_REFRESH_RATE_SECONDS 1.5
 
+///Weight of the last frame in the moving averages of the render time and size of the frames
+#define NATRON_PLAYBACK_LOOKAHEAD_SMOOTHING 0.2
+
 /*
  When defined, parallel frame renders are spawned from a timer so that the frames
  appear to be rendered all at the same speed. 
@@ -165,12 +170,7 @@ struct ProducedFrame
     bool isAborted;
 };
 
-#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
-static bool isBufferFull(int nbBufferedElement, int hardwardIdealThreadCount)
-{
-    return nbBufferedElement >= hardwardIdealThreadCount * 3;
-}
-#endif
+typedef OutputSchedulerThread::PlaybackSequence PlaybackSequence;
 
 struct OutputSchedulerThreadPrivate
 {
@@ -260,6 +260,32 @@ struct OutputSchedulerThreadPrivate
     ///we store this because when we call pushFramesToRender we need to know what was the last frame that was queued
     ///Protected by framesToRenderMutex
     int lastFramePushedIndex;
+    
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+    ///The frames picked by the render threads that are not rendered yet, protected by framesToRenderMutex
+    std::list<int> framesRendering;
+#endif
+    
+    ///The look-ahead window: how many frames ahead of the playhead the render threads may go.
+    ///Protected by lookAheadMutex
+    mutable QMutex lookAheadMutex;
+    double frameRenderTime; // moving average of the time spent rendering a frame, in seconds
+    double frameSizeInRAM; // moving average of the size of a buffered frame, in bytes
+    int lookAheadThreads; // the number of render threads the frames were last pushed for
+    int lookAheadMaxFrames; // the depth of the window requested by the output device, 0 if computed automatically
+    U64 lookAheadRAMBudget; // the share of the RAM dedicated to playback, bounding the frames held in the buffer
+    U64 nStalls; // number of times the playhead waited for a frame
+    U64 nDroppedFrames; // number of frames dropped because the playhead jumped
+    
+    ///The clock the time frames spend in the buffer and the throughput of the render are measured with, it is only read
+    TimeLapse stageClock;
+    
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+    ///Decides how many frames to render in parallel when the threads are balanced automatically
+    ///Protected by threadsBalancingMutex
+    QMutex threadsBalancingMutex;
+    RenderThreadsBalancer threadsBalancer;
+#endif
  
     boost::weak_ptr<OutputEffectInstance> outputEffect; //< The effect used as output device
     RenderEngine* engine;
@@ -317,6 +343,22 @@ struct OutputSchedulerThreadPrivate
 #endif
     , framesToRenderMutex()
     , lastFramePushedIndex(0)
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+    , framesRendering()
+#endif
+    , lookAheadMutex()
+    , frameRenderTime(0.)
+    , frameSizeInRAM(0.)
+    , lookAheadThreads(1)
+    , lookAheadMaxFrames(0)
+    , lookAheadRAMBudget(0)
+    , nStalls(0)
+    , nDroppedFrames(0)
+    , stageClock()
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+    , threadsBalancingMutex()
+    , threadsBalancer()
+#endif
     , outputEffect(effect)
     , engine(engine)
 #ifdef NATRON_SCHEDULER_SPAWN_THREADS_WITH_TIMER
@@ -341,10 +383,31 @@ struct OutputSchedulerThreadPrivate
         k.view = view;
         k.frame = image;
         k.stats = stats;
+        k.bufferedTime = stageClock.getTimeSinceCreation();
         std::pair<FrameBuffer::iterator,bool> ret = buf.insert(k);
+        
+        if (image) {
+            QMutexLocker l(&lookAheadMutex);
+            double size = (double)image->sizeInRAM();
+            frameSizeInRAM = frameSizeInRAM == 0. ? size :
+            frameSizeInRAM + (size - frameSizeInRAM) * NATRON_PLAYBACK_LOOKAHEAD_SMOOTHING;
+        }
         return ret.second;
     }
     
+    bool isTimeBuffered(int time) const
+    {
+        ///Private, shouldn't lock
+        assert(!bufMutex.tryLock());
+        
+        for (FrameBuffer::const_iterator it = buf.begin(); it != buf.end(); ++it) {
+            if (it->time == time && it->frame) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
     void getFromBufferAndErase(double time,BufferedFrames& frames)
     {
         
@@ -414,6 +477,33 @@ struct OutputSchedulerThreadPrivate
                                      int lastFrame,
                                      int* nextFrame);
     
+    void getPlaybackSequence(PlaybackSequence* sequence)
+    {
+        {
+            QMutexLocker l(&runArgsMutex);
+            sequence->direction = livingRunArgs.timelineDirection;
+            sequence->firstFrame = livingRunArgs.firstFrame;
+            sequence->lastFrame = livingRunArgs.lastFrame;
+            sequence->frameStep = livingRunArgs.frameStep;
+        }
+        sequence->mode = engine->getPlaybackMode();
+    }
+    
+    ///The depth of the look-ahead window, @see OutputSchedulerThread::getLookAheadFrames
+    int getLookAheadFrames(double fps, int hardwareThreads) const
+    {
+        QMutexLocker l(&lookAheadMutex);
+        return OutputSchedulerThread::getLookAheadFrames(lookAheadThreads, lookAheadMaxFrames, fps, frameRenderTime,
+                                                         hardwareThreads, frameSizeInRAM, lookAheadRAMBudget);
+    }
+    
+    bool isInLookAheadWindow(int frame, int playhead, double fps, int hardwareThreads)
+    {
+        PlaybackSequence sequence;
+        getPlaybackSequence(&sequence);
+        return OutputSchedulerThread::getStepsInSequence(sequence, playhead, frame, getLookAheadFrames(fps, hardwareThreads)) != -1;
+    }
+    
     /**
      * @brief Checks if mustQuit has been set to true, if so then it will return true and the scheduler thread should stop
      **/
@@ -664,6 +754,54 @@ OutputSchedulerThreadPrivate::getNearestInSequence(OutputSchedulerThread::Render
     
 }
 
+int
+OutputSchedulerThread::getStepsInSequence(const PlaybackSequence& sequence,
+                                          int playhead,
+                                          int frame,
+                                          int maxSteps)
+{
+    RenderDirectionEnum direction = sequence.direction;
+    int current = playhead;
+    for (int i = 0; i < maxSteps; ++i) {
+        if (current == frame) {
+            return i;
+        }
+        if (!OutputSchedulerThreadPrivate::getNextFrameInSequence(sequence.mode, direction, current, sequence.firstFrame, sequence.lastFrame,
+                                                                  sequence.frameStep, &current, &direction)) {
+            break;
+        }
+    }
+    return -1;
+}
+
+int
+OutputSchedulerThread::getLookAheadFrames(int nThreads,
+                                          int maxFrames,
+                                          double fps,
+                                          double frameRenderTime,
+                                          int hardwareThreads,
+                                          double frameSizeInRAM,
+                                          U64 ramBudget)
+{
+    nThreads = std::max(1, nThreads);
+    int frames = nThreads * 2;
+    if (maxFrames > 0) {
+        frames = maxFrames;
+    } else if (fps > 0.) {
+        frames = std::max( frames, nThreads + (int)std::ceil(frameRenderTime * fps) );
+    } else {
+        ///Rendering as fast as possible: let the buffer absorb the variations of speed of the output device
+        frames = std::max(frames, hardwareThreads * 3);
+    }
+    if ( (frameSizeInRAM > 0.) && (ramBudget > 0) ) {
+        double maxFramesInRAM = (double)ramBudget / frameSizeInRAM;
+        if (maxFramesInRAM < frames) {
+            frames = std::max(1, (int)maxFramesInRAM);
+        }
+    }
+    return frames;
+}
+
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
 void
 OutputSchedulerThread::pushFramesToRender(int startingFrame,int nThreads)
@@ -686,6 +824,14 @@ OutputSchedulerThread::pushFramesToRenderInternal(int startingFrame,int nThreads
         nThreads = 1;
     }
     
+    {
+        QMutexLocker l(&_imp->lookAheadMutex);
+        _imp->lookAheadThreads = nThreads;
+    }
+    ///Keep the look-ahead window filled: the frames out of it wait in the queue until the playhead moves
+    const int nFramesToQueue = std::max( nThreads * 2, _imp->getLookAheadFrames(isFPSRegulationNeeded() ? getDesiredFPS() : 0.,
+                                                                                appPTR->getHardwareIdealThreadCount()) );
+    
     RenderDirectionEnum direction;
     int firstFrame,lastFrame,frameStep;
     {
@@ -701,8 +847,8 @@ OutputSchedulerThread::pushFramesToRenderInternal(int startingFrame,int nThreads
         _imp->framesToRender.push_back(startingFrame);
         _imp->lastFramePushedIndex = startingFrame;
     } else {
-        ///Push 2x the count of threads to be sure no one will be waiting
-        while ((int)_imp->framesToRender.size() < nThreads * 2) {
+        ///Push at least 2x the count of threads to be sure no one will be waiting
+        while ((int)_imp->framesToRender.size() < nFramesToQueue) {
             _imp->framesToRender.push_back(startingFrame);
             _imp->lastFramePushedIndex = startingFrame;
             
@@ -779,6 +925,52 @@ OutputSchedulerThread::pushFramesToRender(int nThreads)
     }
 }
 
+void
+OutputSchedulerThread::rescheduleFromPlayhead(int time)
+{
+    const int nThreads = getNRenderThreads();
+    const double fps = isFPSRegulationNeeded() ? getDesiredFPS() : 0.;
+    const int nbThreadsHardware = appPTR->getHardwareIdealThreadCount();
+    
+    QMutexLocker l(&_imp->framesToRenderMutex);
+    
+    ///The queue follows the playback sequence: if the frame is queued after other frames, these are behind the playhead
+    if ( ( !_imp->framesToRender.empty() && _imp->framesToRender.front() == time ) ||
+         std::find(_imp->framesRendering.begin(), _imp->framesRendering.end(), time) != _imp->framesRendering.end() ) {
+        return;
+    }
+    
+    PlaybackSequence sequence;
+    _imp->getPlaybackSequence(&sequence);
+    const int lookAheadFrames = _imp->getLookAheadFrames(fps, nbThreadsHardware);
+    U64 nDropped = 0;
+    {
+        QMutexLocker k(&_imp->bufMutex);
+        if ( _imp->isTimeBuffered(time) ) {
+            return;
+        }
+        
+        ///Drop the frames the playhead will not reach before a while, they would hold RAM for nothing
+        FrameBuffer newBuf;
+        for (FrameBuffer::iterator it = _imp->buf.begin(); it != _imp->buf.end(); ++it) {
+            if ( !it->frame || OutputSchedulerThread::getStepsInSequence(sequence, time, (int)it->time, lookAheadFrames) != -1 ) {
+                newBuf.insert(*it);
+            } else {
+                ++nDropped;
+            }
+        }
+        _imp->buf = newBuf;
+    }
+    nDropped += _imp->framesToRender.size();
+    _imp->framesToRender.clear();
+    {
+        QMutexLocker k(&_imp->lookAheadMutex);
+        _imp->nDroppedFrames += nDropped;
+    }
+    
+    _imp->lastFramePushedIndex = time;
+    pushFramesToRenderInternal(time, nThreads);
+}
 
 int
 OutputSchedulerThread::pickFrameToRender(RenderThreadTask* thread,bool* enableRenderStats, std::vector<int>* viewsToRender)
@@ -794,41 +986,36 @@ OutputSchedulerThread::pickFrameToRender(RenderThreadTask* thread,bool* enableRe
         _imp->allRenderThreadsInactiveCond.wakeOne();
     }
     
-    ///Simple heuristic to limit the size of the internal buffer.
-    ///If the buffer grows too much, we will keep shared ptr to images, hence keep them in RAM which
-    ///can lead to RAM issue for the end user.
+    ///Frames further from the playhead than the look-ahead window are not rendered until it moves.
+    ///This limits the size of the internal buffer: it keeps shared ptr to images, hence keeps them in RAM.
     ///We can end up in this situation for very simple graphs where the rendering of the output node (the writer or viewer)
     ///is much slower than things upstream, hence the buffer grows quickly, and fills up the RAM.
-    int nbThreadsHardware = appPTR->getHardwareIdealThreadCount();
-    bool bufferFull;
-    {
-        QMutexLocker k(&_imp->bufMutex);
-        bufferFull = isBufferFull((int)_imp->buf.size(),nbThreadsHardware);
-    }
+    ///Renders not using the buffer (eSchedulingPolicyFFA) are not limited.
+    const bool useLookAhead = getSchedulingPolicy() == eSchedulingPolicyOrdered;
+    const double fps = isFPSRegulationNeeded() ? getDesiredFPS() : 0.;
+    const int nbThreadsHardware = appPTR->getHardwareIdealThreadCount();
     
     QMutexLocker l(&_imp->framesToRenderMutex);
-    while ((bufferFull || _imp->framesToRender.empty()) && !thread->mustQuit() ) {
+    while ( ( _imp->framesToRender.empty() ||
+              ( useLookAhead && !_imp->isInLookAheadWindow(_imp->framesToRender.front(), timelineGetTime(), fps, nbThreadsHardware) ) )
+            && !thread->mustQuit() ) {
         
         ///Notify that we're no longer doing work
         thread->notifyIsRunning(false);
         
         
         _imp->framesToRenderNotEmptyCond.wait(&_imp->framesToRenderMutex);
-        {
-            QMutexLocker k(&_imp->bufMutex);
-            bufferFull = isBufferFull((int)_imp->buf.size(),nbThreadsHardware);
-        }
-        
     }
     
    
-    if (!_imp->framesToRender.empty()) {
+    if (!_imp->framesToRender.empty() && !thread->mustQuit()) {
         
         ///Notify that we're running for good, will do nothing if flagged already running
         thread->notifyIsRunning(true);
         
         int ret = _imp->framesToRender.front();
         _imp->framesToRender.pop_front();
+        _imp->framesRendering.push_back(ret);
         ///Flag the thread as active
         {
             QMutexLocker l(&_imp->renderThreadsMutex);
@@ -988,6 +1175,31 @@ OutputSchedulerThread::onThreadSpawnsTimerTriggered()
 #endif
 }
 
+void
+OutputSchedulerThread::notifyFrameRenderFinished(int time,
+                                                 double timeSpent)
+{
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+    {
+        QMutexLocker l(&_imp->framesToRenderMutex);
+        std::list<int>::iterator found = std::find(_imp->framesRendering.begin(), _imp->framesRendering.end(), time);
+        if ( found != _imp->framesRendering.end() ) {
+            _imp->framesRendering.erase(found);
+        }
+    }
+    {
+        QMutexLocker k(&_imp->threadsBalancingMutex);
+        _imp->threadsBalancer.addFrameRendered();
+    }
+#else
+    Q_UNUSED(time);
+#endif
+    
+    QMutexLocker l(&_imp->lookAheadMutex);
+    _imp->frameRenderTime = _imp->frameRenderTime == 0. ? timeSpent :
+    _imp->frameRenderTime + (timeSpent - _imp->frameRenderTime) * NATRON_PLAYBACK_LOOKAHEAD_SMOOTHING;
+}
+
 void
 OutputSchedulerThread::notifyThreadAboutToQuit(RenderThreadTask* thread)
 {
@@ -1040,6 +1252,32 @@ OutputSchedulerThread::startRender()
         forward = _imp->livingRunArgs.timelineDirection == OutputSchedulerThread::eRenderDirectionForward;
     }
     
+    int maxFrames;
+    U64 maxRAM;
+    getBufferLimits(&maxFrames, &maxRAM);
+    {
+        QMutexLocker l(&_imp->lookAheadMutex);
+        _imp->frameRenderTime = 0.;
+        _imp->frameSizeInRAM = 0.;
+        _imp->nStalls = 0;
+        _imp->nDroppedFrames = 0;
+        _imp->lookAheadMaxFrames = maxFrames;
+        if (maxRAM > 0) {
+            _imp->lookAheadRAMBudget = maxRAM;
+        } else {
+            const Settings* settings = appPTR->getCurrentSettings().get();
+            _imp->lookAheadRAMBudget = (U64)( settings->getRamMaximumPercent() * getSystemTotalRAM_conditionnally() *
+                                              settings->getRamPlaybackMaximumPercent() );
+        }
+    }
+    
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+    {
+        QMutexLocker k(&_imp->threadsBalancingMutex);
+        _imp->threadsBalancer.reset( appPTR->getHardwareIdealThreadCount(), appPTR->getHardwareIdealThreadCount() );
+    }
+#endif
+    
     aboutToStartRender();
     
     ///Notify everyone that the render is started
@@ -1133,6 +1371,7 @@ OutputSchedulerThread::stopRender()
     {
         QMutexLocker framesLocker (&_imp->framesToRenderMutex);
         _imp->framesToRender.clear();
+        _imp->framesRendering.clear();
     }
 #endif
     
@@ -1240,6 +1479,12 @@ OutputSchedulerThread::run()
         }
         
         startRender();
+        
+        ///The playhead is waiting for a frame after playback started: the last frame it stalled on
+        bool hasProcessedFrame = false;
+        int stalledTime = INT_MIN;
+        double outputWaitTime = 0.; // time waited for the expected frame since the last one was processed
+        
         for (;;) {
             ///When set to true, we don't sleep in the bufEmptyCondition but in the startCondition instead, indicating
             ///we finished a render
@@ -1292,6 +1537,20 @@ OutputSchedulerThread::run()
                 if (framesToRender.empty()) {
                     break;
                 }
+                
+                ///Report how long the frames waited in the buffer and the output device waited for them
+                {
+                    const double now = _imp->stageClock.getTimeSinceCreation();
+                    for (BufferedFrames::iterator it = framesToRender.begin(); it != framesToRender.end(); ++it) {
+                        if (it->stats) {
+                            it->stats->addStageWaitTime(RenderStats::eRenderStageBuffer, now - it->bufferedTime);
+                        }
+                    }
+                    if (framesToRender.front().stats) {
+                        framesToRender.front().stats->addStageWaitTime(RenderStats::eRenderStageOutput, outputWaitTime);
+                    }
+                    outputWaitTime = 0.;
+                }
     
                 int nextFrameToRender = -1;
                
@@ -1412,7 +1671,15 @@ OutputSchedulerThread::run()
                         timelineGoTo(nextFrameToRender);
                     }
                     
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+                    ///The look-ahead window moved with the playhead, wake up the render threads waiting for it
+                    {
+                        QMutexLocker k(&_imp->framesToRenderMutex);
+                        _imp->framesToRenderNotEmptyCond.wakeAll();
+                    }
+#endif
                 }
+                hasProcessedFrame = true;
                 
                 ////////////
                 /////At this point the frame has been processed by the output device
@@ -1444,10 +1711,27 @@ OutputSchedulerThread::run()
            
             if (!renderFinished && !isAbortRequested) {
                 
+                const bool ordered = getSchedulingPolicy() == eSchedulingPolicyOrdered;
+                const int playhead = timelineGetTime();
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+                if (ordered) {
+                    ///Make sure the frame expected by the playhead is being rendered, it might have jumped
+                    rescheduleFromPlayhead(playhead);
+                }
+#endif
+                
                 QMutexLocker bufLocker (&_imp->bufMutex);
-                ///Wait here for more frames to be rendered, we will be woken up once appendToBuffer(...) is called
-                if (_imp->buf.empty()) {
+                ///Wait here for more frames to be rendered, we will be woken up once appendToBuffer(...) is called.
+                ///When the output is ordered, other frames than the one expected by the playhead are of no use.
+                if ( _imp->buf.empty() || ( ordered && !_imp->isTimeBuffered(playhead) && !isBeingAborted() ) ) {
+                    if (hasProcessedFrame && stalledTime != playhead) {
+                        stalledTime = playhead;
+                        QMutexLocker k(&_imp->lookAheadMutex);
+                        ++_imp->nStalls;
+                    }
+                    TimeLapse timeWaited;
                     _imp->bufCondition.wait(&_imp->bufMutex);
+                    outputWaitTime += timeWaited.getTimeSinceCreation();
                 }
                 /*else {
                     
@@ -1482,7 +1766,7 @@ OutputSchedulerThread::adjustNumberOfThreads(int* newNThreads, int *lastNThreads
     int optimalNThreads;
     
     ///How many parallel renders the user wants
-    int userSettingParallelThreads = appPTR->getCurrentSettings()->getNumberOfParallelRenders();
+    int userSettingParallelThreads = appPTR->getNumberOfParallelRenders();
     
     ///How many threads are running in the application
     int runningThreads = appPTR->getNRunningThreads() + QThreadPool::globalInstance()->activeThreadCount();
@@ -1491,7 +1775,15 @@ OutputSchedulerThread::adjustNumberOfThreads(int* newNThreads, int *lastNThreads
     int currentParallelRenders = getNRenderThreads();
     *lastNThreads = currentParallelRenders;
     
-    if (userSettingParallelThreads == 0) {
+    if ( (userSettingParallelThreads == 0) && appPTR->getCurrentSettings()->isAutoThreadsBalancingEnabled() ) {
+        ///Measure the render to share the cores between the parallel renders and the tiles of each frame.
+        ///The other threads of the application are already accounted for by the CPU activity.
+        {
+            QMutexLocker k(&_imp->threadsBalancingMutex);
+            optimalNThreads = _imp->threadsBalancer.update( _imp->stageClock.getTimeSinceCreation(), getProcessCPUTime() );
+        }
+        runningThreads = currentParallelRenders;
+    } else if (userSettingParallelThreads == 0) {
         ///User wants it to be automatically computed, do a simple heuristic: launch as many parallel renders
         ///as there are cores
         optimalNThreads = appPTR->getHardwareIdealThreadCount();
@@ -1630,6 +1922,16 @@ OutputSchedulerThread::notifyFrameRendered(int frame,
             QString timeRemainingStr = Timer::printAsTime(timeRemaining, true);
             ts << "\nTime elapsed for frame: " << timeSpentStr;
             ts << "\nTime remaining: " << timeRemainingStr;
+            if (policy == eSchedulingPolicyOrdered) {
+                ///Where the pipeline of the sequential writer is waiting: the render threads for the writer to
+                ///catch up, the frame in the buffer for the previous ones, or the writer for the render threads
+                ts << "\nTime waited by the render thread: "
+                   << Timer::printAsTime(stats->getStageWaitTime(RenderStats::eRenderStageRender), false);
+                ts << "\nTime waited in the buffer: "
+                   << Timer::printAsTime(stats->getStageWaitTime(RenderStats::eRenderStageBuffer), false);
+                ts << "\nTime waited by the writer: "
+                   << Timer::printAsTime(stats->getStageWaitTime(RenderStats::eRenderStageOutput), false);
+            }
             frameStr.append(';');
             frameStr.append(QString::number(timeSpent));
             frameStr.append(';');
@@ -2092,6 +2394,58 @@ OutputSchedulerThread::getNActiveRenderThreads() const
     return _imp->getNActiveRenderThreads();
 }
 
+void
+OutputSchedulerThread::getPlaybackBufferStats(PlaybackBufferStats* stats) const
+{
+    assert(stats);
+    
+    const int playhead = timelineGetTime();
+    const double fps = isFPSRegulationNeeded() ? getDesiredFPS() : 0.;
+    PlaybackSequence sequence;
+    _imp->getPlaybackSequence(&sequence);
+    stats->lookAheadFrames = _imp->getLookAheadFrames( fps, appPTR->getHardwareIdealThreadCount() );
+    
+#ifndef NATRON_PLAYBACK_USES_THREAD_POOL
+    {
+        QMutexLocker l(&_imp->framesToRenderMutex);
+        stats->framesQueued = (int)_imp->framesToRender.size();
+        stats->framesRendering = (int)_imp->framesRendering.size();
+    }
+#else
+    stats->framesQueued = 0;
+    stats->framesRendering = getNActiveRenderThreads();
+#endif
+    
+    {
+        QMutexLocker l(&_imp->bufMutex);
+        std::set<int> bufferedTimes;
+        stats->bufferedBytes = 0;
+        for (FrameBuffer::const_iterator it = _imp->buf.begin(); it != _imp->buf.end(); ++it) {
+            if (it->frame) {
+                stats->bufferedBytes += it->frame->sizeInRAM();
+                bufferedTimes.insert( (int)it->time );
+            }
+        }
+        
+        ///Count the frames the playhead can go through without waiting
+        stats->framesAhead = 0;
+        int frame = playhead;
+        RenderDirectionEnum direction = sequence.direction;
+        while ( stats->framesAhead < (int)bufferedTimes.size() && bufferedTimes.find(frame) != bufferedTimes.end() ) {
+            ++stats->framesAhead;
+            if ( !OutputSchedulerThreadPrivate::getNextFrameInSequence(sequence.mode, direction, frame, sequence.firstFrame, sequence.lastFrame,
+                                                                       sequence.frameStep, &frame, &direction) ) {
+                break;
+            }
+        }
+    }
+    
+    QMutexLocker l(&_imp->lookAheadMutex);
+    stats->frameRenderTime = _imp->frameRenderTime;
+    stats->stalls = _imp->nStalls;
+    stats->droppedFrames = _imp->nDroppedFrames;
+}
+
 void
 OutputSchedulerThread::stopRenderThreads(int nThreadsToStop)
 {
@@ -2188,6 +2542,9 @@ struct RenderThreadTaskPrivate
     std::vector<int> viewsToRender;
 #endif
     
+    ///The time waited in pickFrameToRender() for the frame being rendered
+    double timeWaitedForFrame;
+    
     RenderThreadTaskPrivate(const boost::shared_ptr<OutputEffectInstance>& output,
                             OutputSchedulerThread* scheduler
                             #ifdef NATRON_PLAYBACK_USES_THREAD_POOL
@@ -2210,6 +2567,7 @@ struct RenderThreadTaskPrivate
     , useRenderStats(useRenderStats)
     , viewsToRender(viewsToRender)
 #endif
+    , timeWaitedForFrame(0)
     {
         
     }
@@ -2251,13 +2609,17 @@ RenderThreadTask::run()
         
         bool enableRenderStats;
         std::vector<int> viewsToRender;
+        TimeLapse timeWaited;
         int time = _imp->scheduler->pickFrameToRender(this,&enableRenderStats, &viewsToRender);
+        _imp->timeWaitedForFrame = timeWaited.getTimeSinceCreation();
         
         if ( mustQuit() ) {
             break;
         }
         
+        TimeLapse timeSpent;
         renderFrame(time, viewsToRender, enableRenderStats);
+        _imp->scheduler->notifyFrameRenderFinished( time, timeSpent.getTimeSinceCreation() );
         
         appPTR->getAppTLS()->cleanupTLSForThread();
         
@@ -2273,7 +2635,9 @@ RenderThreadTask::run()
     notifyIsRunning(false);
     _imp->scheduler->notifyThreadAboutToQuit(this);
 #else // NATRON_PLAYBACK_USES_THREAD_POOL
+    TimeLapse timeSpent;
     renderFrame(_imp->time, _imp->viewsToRender, _imp->useRenderStats);
+    _imp->scheduler->notifyFrameRenderFinished( _imp->time, timeSpent.getTimeSinceCreation() );
     _imp->scheduler->notifyThreadAboutToQuit(this);
 #endif
 
@@ -2388,6 +2752,9 @@ private:
         ///Even if enableRenderStats is false, we at least profile the time spent rendering the frame when rendering with a Write node.
         ///Though we don't enable render stats for sequential renders (e.g: WriteFFMPEG) since this is 1 file.
         RenderStatsPtr stats(new RenderStats(renderDirectly && enableRenderStats));
+        if (!renderDirectly) {
+            stats->addStageWaitTime(RenderStats::eRenderStageRender, _imp->timeWaitedForFrame);
+        }
         
         NodePtr outputNode = output->getNode();
         
@@ -2842,6 +3209,21 @@ DefaultScheduler::onRenderStopped(bool aborted)
 
 }
 
+void
+DefaultScheduler::getBufferLimits(int* maxFrames,
+                                  U64* maxRAM) const
+{
+    ///Only sequential writers hold the frames rendered ahead in the buffer
+    if (getSchedulingPolicy() == eSchedulingPolicyOrdered) {
+        const Settings* settings = appPTR->getCurrentSettings().get();
+        *maxFrames = settings->getOrderedWriterBufferFrames();
+        *maxRAM = settings->getOrderedWriterBufferMaxRAM();
+    } else {
+        *maxFrames = 0;
+        *maxRAM = 0;
+    }
+}
+
 ////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////
 //////////////////////// ViewerDisplayScheduler ////////////
@@ -3369,6 +3751,16 @@ RenderEngine::getDesiredFPS() const
     return _imp->scheduler ? _imp->scheduler->getDesiredFPS() : 24;
 }
 
+void
+RenderEngine::getPlaybackBufferStats(PlaybackBufferStats* stats) const
+{
+    if (_imp->scheduler) {
+        _imp->scheduler->getPlaybackBufferStats(stats);
+    } else {
+        *stats = PlaybackBufferStats();
+    }
+}
+
 
 void
 RenderEngine::notifyFrameProduced(const BufferableObjectList& frames, const RenderStatsPtr& stats, const boost::shared_ptr<RequestedFrame>& request)
@@ -4004,7 +4396,7 @@ ViewerCurrentFrameRequestScheduler::renderCurrentFrame(bool enableRenderStats,bo
     functorArgs->args[0] = args[0];
     functorArgs->args[1] = args[1];
     
-    if (appPTR->getCurrentSettings()->getNumberOfThreads() == -1) {
+    if (appPTR->getNumberOfThreads() == -1) {
         RenderCurrentFrameFunctorRunnable task(functorArgs);
         task.run();
     } else {
@@ -76,12 +76,14 @@ struct BufferedFrame
     double time;
     RenderStatsPtr stats;
     boost::shared_ptr<BufferableObject> frame;
+    double bufferedTime; //< when the frame was appended to the buffer, in seconds on the clock of the scheduler
     
     BufferedFrame()
     : view(0)
     , time(0)
     , stats()
     , frame()
+    , bufferedTime(0)
     {
         
     }
@@ -89,6 +91,34 @@ struct BufferedFrame
 
 typedef std::list<BufferedFrame> BufferedFrames;
 
+/**
+ * @brief The health of the playback buffer of a scheduler, @see OutputSchedulerThread::getPlaybackBufferStats()
+ **/
+struct PlaybackBufferStats
+{
+    int framesAhead; //< frames ready in the buffer that the playhead can reach without waiting
+    int framesRendering; //< frames being rendered by the render threads
+    int framesQueued; //< frames waiting for a render thread
+    int lookAheadFrames; //< the depth of the look-ahead window: frames further from the playhead are not rendered yet
+    double frameRenderTime; //< the average time spent rendering a frame, in seconds
+    U64 bufferedBytes; //< the memory held by the frames in the buffer
+    U64 stalls; //< how many times the playhead had to wait for a frame since the render started
+    U64 droppedFrames; //< frames dropped from the work queue and the buffer because the playhead jumped away
+    
+    PlaybackBufferStats()
+    : framesAhead(0)
+    , framesRendering(0)
+    , framesQueued(0)
+    , lookAheadFrames(0)
+    , frameRenderTime(0.)
+    , bufferedBytes(0)
+    , stalls(0)
+    , droppedFrames(0)
+    {
+        
+    }
+};
+
 class OutputSchedulerThread;
 
 struct RenderThreadTaskPrivate;
@@ -166,7 +196,39 @@ public:
         eProcessFrameBySchedulerThread = 0, //< the processFrame function will be called by the OutputSchedulerThread thread.
         eProcessFrameByMainThread //< the processFrame function will be called by the application's main-thread.
     };
-    
+
+    ///The frames the playhead will go through, starting from it
+    struct PlaybackSequence
+    {
+        PlaybackModeEnum mode;
+        RenderDirectionEnum direction;
+        int firstFrame,lastFrame,frameStep;
+    };
+
+    /**
+     * @brief Returns the number of steps of the sequence from playhead to frame, or -1 if frame is not reached
+     * in less than maxSteps steps. In bounce mode the sequence turns back at the bounds of the frame range, so
+     * near them the frames on both sides of the playhead are in the look-ahead window.
+     **/
+    static int getStepsInSequence(const PlaybackSequence& sequence,
+                                  int playhead,
+                                  int frame,
+                                  int maxSteps);
+
+    /**
+     * @brief Returns how many frames of the playback sequence, starting at the playhead, may be rendered.
+     * This is enough to keep the nThreads render threads busy and, when playing at fps, to cover the
+     * frameRenderTime seconds spent rendering a frame, unless the output device requested a fixed depth
+     * (maxFrames > 0). The frames held in the buffer, of frameSizeInRAM bytes each, are kept within ramBudget.
+     **/
+    static int getLookAheadFrames(int nThreads,
+                                  int maxFrames,
+                                  double fps,
+                                  double frameRenderTime,
+                                  int hardwareThreads,
+                                  double frameSizeInRAM,
+                                  U64 ramBudget);
+
     OutputSchedulerThread(RenderEngine* engine,const boost::shared_ptr<OutputEffectInstance>& effect,ProcessFrameModeEnum mode);
     
     virtual ~OutputSchedulerThread();
@@ -286,6 +348,11 @@ public:
      **/
     int getNActiveRenderThreads() const;
     
+    /**
+     * @brief Returns the health of the playback buffer: how far ahead of the playhead the render threads are.
+     **/
+    void getPlaybackBufferStats(PlaybackBufferStats* stats) const;
+    
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
     /**
      * @brief Called by render-threads to pick some work to do or to get asleep if theres nothing to do
@@ -298,6 +365,12 @@ public:
      **/
     void notifyThreadAboutToQuit(RenderThreadTask* thread);
     
+    /**
+     * @brief Called by the render-threads once they rendered the given time, timeSpent being in seconds.
+     * The average time spent sets the depth of the look-ahead window.
+     **/
+    void notifyFrameRenderFinished(int time, double timeSpent);
+    
     /**
      *@brief The slot called by the GUI to set the requested fps.
      **/
@@ -433,6 +506,13 @@ protected:
      **/
     virtual void onRenderStopped(bool /*aborted*/) {}
     
+    /**
+     * @brief Called when starting a render to bound the frames that may be rendered ahead of the frame expected
+     * by the output device: at most maxFrames frames, holding at most maxRAM bytes. 0 means the bound is computed
+     * automatically.
+     **/
+    virtual void getBufferLimits(int* maxFrames, U64* maxRAM) const { *maxFrames = 0; *maxRAM = 0; }
+    
     RenderEngine* getEngine() const;
     
     
@@ -458,15 +538,23 @@ private:
     
     void pushAllFrameRange();
     
+    /**
+     * @brief Called by the scheduler thread when the frame expected by the playhead is not rendered yet.
+     * If it is neither queued nor being rendered the playhead jumped (e.g: the user scrubbed the timeline):
+     * the frames queued and buffered out of the look-ahead window of the new playhead are dropped and
+     * frames are pushed again starting at the playhead.
+     **/
+    void rescheduleFromPlayhead(int time);
+    
     /**
      * @brief Starts/stops more threads according to CPU activity and user preferences 
      * @param optimalNThreads[out] Will be set to the new number of threads
      **/
     void adjustNumberOfThreads(int* newNThreads, int *lastNThreads);
-#else
+#else // NATRON_PLAYBACK_USES_THREAD_POOL
     void startTasksFromLastStartedFrame();
     void startTasks(int startingFrame);
-#endif
+#endif // NATRON_PLAYBACK_USES_THREAD_POOL
     
     /**
      * @brief Make nThreadsToStop quit running. If 0 then all threads will be destroyed.
@@ -519,6 +607,8 @@ private:
     
     virtual void onRenderStopped(bool aborted) OVERRIDE FINAL;
     
+    virtual void getBufferLimits(int* maxFrames, U64* maxRAM) const OVERRIDE FINAL;
+    
 
     
     boost::weak_ptr<OutputEffectInstance> _effect;
@@ -701,6 +791,11 @@ public:
      **/
     double getDesiredFPS() const;
     
+    /**
+     * @brief Returns the health of the playback buffer of the internal scheduler
+     **/
+    void getPlaybackBufferStats(PlaybackBufferStats* stats) const;
+    
     /**
      * @brief Quit all processing, making sure all threads are finished.
      **/
@@ -27,17 +27,164 @@
 #include <cassert>
 #include <stdexcept>
 
+#include <QtCore/QThread>
+
+#if !defined(SBK_RUN) && !defined(Q_MOC_RUN)
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+#endif
+
 #include "Engine/AppManager.h"
 #include "Engine/Settings.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Image.h"
 #include "Engine/Node.h"
 #include "Engine/NodeGroup.h"
+#include "Engine/RenderStats.h"
 #include "Engine/RotoContext.h"
 #include "Engine/RotoDrawableItem.h"
+#include "Engine/TaskScheduler.h"
+#include "Engine/Timer.h"
+#include "Engine/TLSHolder.h"
 
 NATRON_NAMESPACE_ENTER;
 
+namespace {
+
+/**
+ * @brief The render of one input image (for one frame/view) needed by an effect before its render action,
+ * when the input branches are pre-rendered in parallel.
+ **/
+struct InputPreRenderJob
+{
+    EffectInstPtr inputEffect;
+    int inputNb;
+    EffectInstance::RenderRoIArgs args;
+    ImageList* inputImagesList; //< where to append the images once all jobs are done, may be NULL
+
+    //Results
+    ImageList images;
+    EffectInstance::RenderRoIRetCode ret;
+    double timeSpent;
+
+    InputPreRenderJob(const EffectInstPtr& inputEffect,
+                      int inputNb,
+                      const EffectInstance::RenderRoIArgs& args,
+                      ImageList* inputImagesList)
+    : inputEffect(inputEffect)
+    , inputNb(inputNb)
+    , args(args)
+    , inputImagesList(inputImagesList)
+    , images()
+    , ret(EffectInstance::eRenderRoIRetCodeFailed)
+    , timeSpent(0)
+    {
+    }
+};
+
+typedef boost::shared_ptr<InputPreRenderJob> InputPreRenderJobPtr;
+
+/**
+ * @brief A range of frames needed from an input, when the input branches are pre-rendered in parallel.
+ * Like the sequential pre-render, at most NATRON_MAX_FRAMES_NEEDED_PRE_FETCHING frames producing images
+ * are pre-rendered from the range.
+ **/
+struct InputPreRenderRange
+{
+    EffectInstPtr inputEffect;
+    int inputNb;
+    EffectInstance::RenderRoIArgs args; //< the arguments of the first frame
+    ImageList* inputImagesList;
+
+    ///When set, the RoI of each frame is read from the request pass, otherwise it is the one of args
+    boost::shared_ptr<NodeFrameRequest> request;
+    RectD canonicalRoI;
+    double inputPar;
+
+    double nextFrame;
+    double lastFrame;
+    int nbFramesPreFetched;
+    std::vector<InputPreRenderJobPtr> jobs; //< in frame order
+    std::size_t firstJobOfRound;
+
+    InputPreRenderRange(const EffectInstPtr& inputEffect,
+                        int inputNb,
+                        const EffectInstance::RenderRoIArgs& args,
+                        ImageList* inputImagesList,
+                        double lastFrame)
+    : inputEffect(inputEffect)
+    , inputNb(inputNb)
+    , args(args)
+    , inputImagesList(inputImagesList)
+    , request()
+    , canonicalRoI()
+    , inputPar(1.)
+    , nextFrame(args.time)
+    , lastFrame(lastFrame)
+    , nbFramesPreFetched(0)
+    , jobs()
+    , firstJobOfRound(0)
+    {
+    }
+};
+
+typedef boost::shared_ptr<InputPreRenderRange> InputPreRenderRangePtr;
+
+/**
+ * @brief Queues the renders of the next frames of the range, as many as images are still missing: whatever the
+ * results of these frames, the sequential pre-render would have rendered all of them too.
+ **/
+static void
+queueInputPreRenderJobs(InputPreRenderRange* range,
+                        std::vector<InputPreRenderJobPtr>* jobs)
+{
+    range->firstJobOfRound = range->jobs.size();
+    for (int i = range->nbFramesPreFetched;
+         i < NATRON_MAX_FRAMES_NEEDED_PRE_FETCHING && range->nextFrame <= range->lastFrame;
+         ++i, range->nextFrame += 1.) {
+        EffectInstance::RenderRoIArgs args = range->args;
+        args.time = range->nextFrame;
+        if (range->request) {
+            range->request->getFrameViewCanonicalRoI(args.time, args.view, &range->canonicalRoI);
+            range->canonicalRoI.toPixelEnclosing(args.mipMapLevel, range->inputPar, &args.roi);
+        }
+        InputPreRenderJobPtr job( new InputPreRenderJob(range->inputEffect, range->inputNb, args, range->inputImagesList) );
+        range->jobs.push_back(job);
+        jobs->push_back(job);
+    }
+}
+
+static void
+renderInputPreRenderJob(InputPreRenderJob* job,
+                        const EffectInstance* effect,
+                        const QThread* callingThread,
+                        const TLSSnapshotPtr& callingThreadTLS)
+{
+    if (effect->aborted()) {
+        job->ret = EffectInstance::eRenderRoIRetCodeAborted;
+        return;
+    }
+
+    ///Same as for the tiles in host frame threading: the render of the input needs the TLS of the thread that
+    ///started the render of the effect
+    QThread* curThread = QThread::currentThread();
+    if (curThread != callingThread) {
+        appPTR->getAppTLS()->copyTLS(callingThreadTLS);
+    }
+
+    TimeLapse timer;
+    job->ret = job->inputEffect->renderRoI(job->args, &job->images);
+    job->timeSpent = timer.getTimeSinceCreation();
+
+    if (curThread != callingThread) {
+        appPTR->getAppTLS()->cleanupTLSForThread();
+    }
+}
+
+} // anon namespace
+
 EffectInstance::RenderRoIRetCode EffectInstance::treeRecurseFunctor(bool isRenderFunctor,
                                                                             const NodePtr& node,
                                                                             const FramesNeededMap& framesNeeded,
@@ -59,6 +206,21 @@ EffectInstance::RenderRoIRetCode EffectInstance::treeRecurseFunctor(bool isRende
     EffectInstPtr effect = node->getEffectInstance();
     bool isRoto = node->isRotoPaintingNode();
     
+    ///When enabled, the render functor only collects the ranges of frames to render from the inputs in preRenderRanges and
+    ///renders them all at once on the TaskScheduler, after all inputs have been visited. The jobs share the threads of the
+    ///scheduler with the tiles they spawn, so this never uses more threads than allowed in the settings.
+    bool renderInputsInParallel = isRenderFunctor && appPTR->getCurrentSettings()->isParallelInputsRenderEnabled();
+    std::vector<InputPreRenderRangePtr> preRenderRanges;
+    std::list<boost::shared_ptr<EffectInstance::NotifyInputNRenderingStarted_RAII> > inputsRenderingNotifiers;
+    
+    boost::shared_ptr<RenderStats> stats;
+    if (isRenderFunctor) {
+        boost::shared_ptr<ParallelRenderArgs> effectFrameArgs = effect->getParallelRenderArgsTLS();
+        if ( effectFrameArgs && effectFrameArgs->stats && effectFrameArgs->stats->isInDepthProfilingEnabled() ) {
+            stats = effectFrameArgs->stats;
+        }
+    }
+    
     //Same as FramesNeededMap but we also get a pointer to EffectInstance* as key
     typedef std::map<EffectInstPtr, std::pair<int,std::map<int, std::vector<OfxRangeD> > > > PreRenderFrames;
     
@@ -209,6 +371,9 @@ EffectInstance::RenderRoIRetCode EffectInstance::treeRecurseFunctor(bool isRende
             if (isRenderFunctor) {
                 assert(it->second.first != -1); //< see getInputNumber
                 inputNIsRendering_RAII.reset(new EffectInstance::NotifyInputNRenderingStarted_RAII(node.get(),inputNb));
+                if (renderInputsInParallel) {
+                    inputsRenderingNotifiers.push_back(inputNIsRendering_RAII);
+                }
             }
             
             ///For all views requested in input
@@ -292,11 +457,28 @@ EffectInstance::RenderRoIRetCode EffectInstance::treeRecurseFunctor(bool isRende
                                 
                                 
                                 
+                                if (renderInputsInParallel) {
+                                    ///The frames of the range are queued once all inputs are visited, see queueInputPreRenderJobs
+                                    InputPreRenderRangePtr preRenderRange( new InputPreRenderRange(inputEffect, inputNb, inArgs, inputImagesList,
+                                                                                                   viewIt->second[range].max) );
+                                    if (roiIsInRequestPass) {
+                                        preRenderRange->request = frameArgs->request;
+                                        preRenderRange->canonicalRoI = roi;
+                                        preRenderRange->inputPar = inputPar;
+                                    }
+                                    preRenderRanges.push_back(preRenderRange);
+                                    break;
+                                }
+                                
                                 ImageList inputImgs;
+                                TimeLapse inputTimer;
                                 EffectInstance::RenderRoIRetCode ret = inputEffect->renderRoI(inArgs, &inputImgs); //< requested bitdepth
                                 if (ret != EffectInstance::eRenderRoIRetCodeOk) {
                                     return ret;
                                 }
+                                if (stats) {
+                                    stats->addInputBranchRenderInfosForNode(node, inputNb, inputTimer.getTimeSinceCreation());
+                                }
                                 
                                 for (ImageList::iterator it3 = inputImgs.begin(); it3 != inputImgs.end(); ++it3) {
                                     if (inputImagesList && *it3) {
@@ -322,7 +504,81 @@ EffectInstance::RenderRoIRetCode EffectInstance::treeRecurseFunctor(bool isRende
         
         
     } // for all inputs
-        return EffectInstance::eRenderRoIRetCodeOk;
+    
+    if ( !preRenderRanges.empty() ) {
+        TaskScheduler* scheduler = appPTR->getTaskScheduler();
+        const QThread* currentThread = QThread::currentThread();
+        ///Taken before queuing the jobs: this thread then renders jobs itself, which modifies its TLS
+        const TLSSnapshotPtr currentThreadTLS = appPTR->getAppTLS()->takeSnapshot();
+        
+        ///Each round renders the next frames of all ranges that still miss images, the frames are counted
+        ///once their render is done, as in the sequential pre-render
+        for (;;) {
+            std::vector<InputPreRenderJobPtr> preRenderJobs;
+            for (std::vector<InputPreRenderRangePtr>::iterator it = preRenderRanges.begin(); it != preRenderRanges.end(); ++it) {
+                queueInputPreRenderJobs(it->get(), &preRenderJobs);
+            }
+            if ( preRenderJobs.empty() ) {
+                break;
+            }
+            
+            if ( (preRenderJobs.size() == 1) || (scheduler->maxThreadCount() == 1) ) {
+                for (std::vector<InputPreRenderJobPtr>::iterator it = preRenderJobs.begin(); it != preRenderJobs.end(); ++it) {
+                    renderInputPreRenderJob(it->get(), effect.get(), currentThread, currentThreadTLS);
+                }
+            } else {
+                ///While waiting, this thread renders the jobs no worker has picked up yet
+                TaskGroup group(scheduler);
+                for (std::vector<InputPreRenderJobPtr>::iterator it = preRenderJobs.begin(); it != preRenderJobs.end(); ++it) {
+                    group.run( boost::bind(renderInputPreRenderJob, it->get(), effect.get(), currentThread, currentThreadTLS) );
+                }
+                if ( !group.wait() ) {
+                    return EffectInstance::eRenderRoIRetCodeFailed;
+                }
+            }
+            
+            bool failed = false;
+            for (std::vector<InputPreRenderRangePtr>::iterator it = preRenderRanges.begin(); it != preRenderRanges.end(); ++it) {
+                InputPreRenderRange& range = **it;
+                for (std::size_t i = range.firstJobOfRound; i < range.jobs.size(); ++i) {
+                    if (range.jobs[i]->ret != EffectInstance::eRenderRoIRetCodeOk) {
+                        failed = true;
+                    } else if ( !range.jobs[i]->images.empty() ) {
+                        ++range.nbFramesPreFetched;
+                    }
+                }
+            }
+            if ( failed || effect->aborted() ) {
+                break;
+            }
+        }
+        
+        ///Report in the same order as the sequential pre-render so that the input images lists are identical
+        for (std::vector<InputPreRenderRangePtr>::iterator it = preRenderRanges.begin(); it != preRenderRanges.end(); ++it) {
+            for (std::vector<InputPreRenderJobPtr>::iterator it2 = (*it)->jobs.begin(); it2 != (*it)->jobs.end(); ++it2) {
+                const InputPreRenderJob& job = **it2;
+                if (job.ret != EffectInstance::eRenderRoIRetCodeOk) {
+                    return job.ret;
+                }
+                if (stats) {
+                    stats->addInputBranchRenderInfosForNode(node, job.inputNb, job.timeSpent);
+                }
+                if (job.inputImagesList) {
+                    for (ImageList::const_iterator it3 = job.images.begin(); it3 != job.images.end(); ++it3) {
+                        if (*it3) {
+                            job.inputImagesList->push_back(*it3);
+                        }
+                    }
+                }
+            }
+        }
+        
+        if (effect->aborted()) {
+            return EffectInstance::eRenderRoIRetCodeAborted;
+        }
+    }
+    
+    return EffectInstance::eRenderRoIRetCodeOk;
 }
 
 StatusEnum EffectInstance::getInputsRoIsFunctor(bool useTransforms,
@@ -45,7 +45,8 @@
 NATRON_NAMESPACE_ENTER;
 
 ProcessHandler::ProcessHandler(const QString & projectPath,
-                               OutputEffectInstance* writer)
+                               OutputEffectInstance* writer,
+                               const QStringList& extraArgs)
 : _process(new QProcess)
 ,_writer(writer)
 ,_ipcServer(0)
@@ -70,6 +71,7 @@ ProcessHandler::ProcessHandler(const QString & projectPath,
 
     _processArgs << "-b" << "-w" << writer->getScriptName_mt_safe().c_str();
     _processArgs << "--IPCpipe" << QString("\"") + _ipcServer->fullServerName() + QString("\"");
+    _processArgs << extraArgs;
     _processArgs << QString("\"") + projectPath + QString("\"");
 
     ///connect the useful slots of the process
@@ -137,55 +139,58 @@ ProcessHandler::onDataWrittenToSocket()
     ///always running in the main thread
     assert( QThread::currentThread() == qApp->thread() );
 
-    QString str = _bgProcessOutputSocket->readLine();
-    while ( str.endsWith('\n') ) {
-        str.chop(1);
-    }
-    _processLog.append("Message received: " + str + '\n');
-    if ( str.startsWith(kFrameRenderedStringShort) ) {
-        str = str.remove(kFrameRenderedStringShort);
+    ///Several messages may have been written since the last notification
+    while ( _bgProcessOutputSocket->canReadLine() ) {
+        QString str = _bgProcessOutputSocket->readLine();
+        while ( str.endsWith('\n') ) {
+            str.chop(1);
+        }
+        _processLog.append("Message received: " + str + '\n');
+        if ( str.startsWith(kFrameRenderedStringShort) ) {
+            str = str.remove(kFrameRenderedStringShort);
         
-        if (!str.isEmpty()) {
-            if (!str.contains(';')) {
-                //The report does not have extended timer infos
-                Q_EMIT frameRendered( str.toInt() );
-            } else {
-                QStringList splits = str.split(';');
-                if (splits.size() == 3) {
-                    Q_EMIT frameRenderedWithTimer(splits[0].toInt(), splits[1].toDouble(), splits[2].toDouble());
+            if (!str.isEmpty()) {
+                if (!str.contains(';')) {
+                    //The report does not have extended timer infos
+                    Q_EMIT frameRendered( str.toInt() );
                 } else {
-                    if (!splits.isEmpty()) {
-                        Q_EMIT frameRendered(splits[0].toInt());
+                    QStringList splits = str.split(';');
+                    if (splits.size() == 3) {
+                        Q_EMIT frameRenderedWithTimer(splits[0].toInt(), splits[1].toDouble(), splits[2].toDouble());
+                    } else {
+                        if (!splits.isEmpty()) {
+                            Q_EMIT frameRendered(splits[0].toInt());
+                        }
                     }
                 }
             }
-        }
         
-    } else if ( str.startsWith(kRenderingFinishedStringShort) ) {
-        ///don't do anything
-    } else if ( str.startsWith(kProgressChangedStringShort) ) {
-        str = str.remove(kProgressChangedStringShort);
-        Q_EMIT frameProgress( str.toInt() );
-    } else if ( str.startsWith(kBgProcessServerCreatedShort) ) {
-        str = str.remove(kBgProcessServerCreatedShort);
-        ///the bg process wants us to create the pipe for its input
-        if (!_bgProcessInputSocket) {
-            _bgProcessInputSocket = new QLocalSocket();
-            QObject::connect( _bgProcessInputSocket, SIGNAL( connected() ), this, SLOT( onInputPipeConnectionMade() ) );
-            _bgProcessInputSocket->connectToServer(str,QLocalSocket::ReadWrite);
-        }
-    } else if ( str.startsWith(kRenderingStartedShort) ) {
-        ///if the user pressed cancel prior to the pipe being created, wait for it to be created and send the abort
-        ///message right away
-        if (_earlyCancel) {
-            _bgProcessInputSocket->waitForConnected(5000);
-            _earlyCancel = false;
-            onProcessCanceled();
+        } else if ( str.startsWith(kRenderingFinishedStringShort) ) {
+            ///don't do anything
+        } else if ( str.startsWith(kProgressChangedStringShort) ) {
+            str = str.remove(kProgressChangedStringShort);
+            Q_EMIT frameProgress( str.toInt() );
+        } else if ( str.startsWith(kBgProcessServerCreatedShort) ) {
+            str = str.remove(kBgProcessServerCreatedShort);
+            ///the bg process wants us to create the pipe for its input
+            if (!_bgProcessInputSocket) {
+                _bgProcessInputSocket = new QLocalSocket();
+                QObject::connect( _bgProcessInputSocket, SIGNAL( connected() ), this, SLOT( onInputPipeConnectionMade() ) );
+                _bgProcessInputSocket->connectToServer(str,QLocalSocket::ReadWrite);
+            }
+        } else if ( str.startsWith(kRenderingStartedShort) ) {
+            ///if the user pressed cancel prior to the pipe being created, wait for it to be created and send the abort
+            ///message right away
+            if (_earlyCancel) {
+                _bgProcessInputSocket->waitForConnected(5000);
+                _earlyCancel = false;
+                onProcessCanceled();
+            }
+        } else {
+            _processLog.append("Error: Unable to interpret message.\n");
+            throw std::runtime_error("ProcessHandler::onDataWrittenToSocket() received erroneous message");
         }
-    } else {
-        _processLog.append("Error: Unable to interpret message.\n");
-        throw std::runtime_error("ProcessHandler::onDataWrittenToSocket() received erroneous message");
-    }
+    } // while(canReadLine)
 }
 
 void
@@ -235,6 +240,7 @@ ProcessHandler::onProcessError(QProcess::ProcessError err)
 {
     if (err == QProcess::FailedToStart) {
         Dialogs::errorDialog( _writer->getScriptName(),QObject::tr("The render process failed to start").toStdString() );
+        Q_EMIT processFailedToStart();
     } else if (err == QProcess::Crashed) {
         //@TODO: find out a way to get the backtrace
     }
@@ -244,6 +250,15 @@ void
 ProcessHandler::onProcessEnd(int exitCode,
                              QProcess::ExitStatus stat)
 {
+    ///Process the messages written right before the process exited, so that all the frames it rendered are
+    ///reported before it finishes
+    if (_bgProcessOutputSocket) {
+        _bgProcessOutputSocket->waitForReadyRead(0);
+        if ( _bgProcessOutputSocket->canReadLine() ) {
+            onDataWrittenToSocket();
+        }
+    }
+
     int returnCode = 0;
 
     if (stat == QProcess::CrashExit) {
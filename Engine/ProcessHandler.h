@@ -101,9 +101,11 @@ public:
     /**
      * @brief Starts a new process which will load the project specified by "projectPath".
      * The process will render using the effect specified by writer.
+     * extraArgs are passed to the process command-line, e.g: the frames to render.
      **/
     ProcessHandler(const QString & projectPath,
-                   OutputEffectInstance* writer);
+                   OutputEffectInstance* writer,
+                   const QStringList& extraArgs = QStringList());
 
     virtual ~ProcessHandler();
 
@@ -179,6 +181,11 @@ Q_SIGNALS:
      * 2: Crash.
      **/
     void processFinished(int);
+
+    /**
+     * @brief Emitted when the process could not be started: processFinished() is never emitted then.
+     **/
+    void processFailedToStart();
 };
 
 /**
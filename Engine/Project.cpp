@@ -481,9 +481,7 @@ Project::saveProjectInternal(const QString & path,
             if (appendTimeHash) {
                 Hash64 timeHash;
                 
-                for (int i = 0; i < timeStr.size(); ++i) {
-                    timeHash.append<unsigned short>( timeStr.at(i).unicode() );
-                }
+                Hash64_appendQString(&timeHash, timeStr);
                 timeHash.computeHash();
                 QString timeHashStr = QString::number( timeHash.value() );
                 filePath.append("." + timeHashStr);
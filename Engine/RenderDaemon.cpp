@@ -0,0 +1,468 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderDaemon.h"
+
+#include <cassert>
+#include <csignal>
+#include <iostream>
+#include <stdexcept>
+
+#if defined(__NATRON_UNIX__)
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <unistd.h>        // geteuid, getpeereid
+#endif
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QByteArray>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+CLANG_DIAG_ON(deprecated)
+
+#include "Engine/AppInstance.h"
+#include "Engine/CLArgs.h"
+#include "Engine/Project.h"
+#include "Engine/StandardPaths.h"
+
+// How long the daemon waits for a connection before processing the pending events, in milliseconds
+#define NATRON_RENDER_DAEMON_POLL_MS 1000
+
+NATRON_NAMESPACE_ENTER;
+
+namespace {
+
+///Both ends use the same format, so that a client and a daemon built against different Qt versions understand each other
+void
+setStreamVersion(QDataStream& stream)
+{
+    stream.setVersion(QDataStream::Qt_4_8);
+}
+
+///True if the client of the socket runs as the user of the daemon. With Qt 4 the socket is only protected by the
+///permissions of its directory, so the daemon checks who connected.
+bool
+isClientOfThisUser(QLocalSocket* socket)
+{
+#if defined(__NATRON_UNIX__)
+    const int fd = (int)socket->socketDescriptor();
+#if defined(SO_PEERCRED)
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) {
+        return false;
+    }
+
+    return cred.uid == geteuid();
+#else
+    uid_t uid;
+    gid_t gid;
+    if (getpeereid(fd, &uid, &gid) != 0) {
+        return false;
+    }
+
+    return uid == geteuid();
+#endif
+#else
+    ///The named pipe is restricted to the user by QLocalServer::UserAccessOption
+    (void)socket;
+
+    return true;
+#endif
+}
+}
+
+struct RenderDaemonPrivate
+{
+    AppInstance* app;
+    QString serverName;
+    QLocalServer server;
+
+    ///Protects client and clientMessages. Only the main thread, which owns the socket, writes to the client: the
+    ///messages of the render threads are queued until it flushes them.
+    QMutex clientMutex;
+    QLocalSocket* client; // the client of the job being rendered, or NULL
+    QStringList clientMessages;
+
+    ///The project kept loaded from the last job, empty if it must be loaded again
+    QString loadedProjectPath;
+    QDateTime loadedProjectLastModified;
+    bool projectOpened; // a job already loaded something in the project
+
+    volatile std::sig_atomic_t quitRequested; // set by requestQuit(), possibly from a signal handler
+
+    RenderDaemonPrivate(AppInstance* app,
+                        const QString& serverName)
+        : app(app)
+        , serverName(serverName)
+        , server()
+        , clientMutex()
+        , client(0)
+        , clientMessages()
+        , loadedProjectPath()
+        , loadedProjectLastModified()
+        , projectOpened(false)
+        , quitRequested(0)
+    {
+    }
+
+    void serveClient(QLocalSocket* socket);
+
+    void flushClientMessages();
+
+    bool renderJob(const QString& clientDir,
+                   const QStringList& arguments,
+                   QString* error);
+};
+
+RenderDaemon::RenderDaemon(AppInstance* app,
+                           const QString& serverName)
+    : _imp( new RenderDaemonPrivate(app, getServerName(serverName)) )
+{
+}
+
+RenderDaemon::~RenderDaemon()
+{
+}
+
+QString
+RenderDaemon::getServerName(const QString& name)
+{
+#if defined(__NATRON_UNIX__)
+    ///Another user could create a socket of the same name in the shared temporary directory first and receive the jobs:
+    ///the socket is created in the runtime directory of the user, which only they can access
+    if ( name.contains( QLatin1Char('/') ) ) {
+        return name;
+    }
+    QString dir = StandardPaths::writableLocation(StandardPaths::eStandardLocationRuntime);
+    if ( dir.isEmpty() ) {
+        dir = QDir::homePath();
+    }
+
+    return dir + QLatin1Char('/') + ( name.isEmpty() ? QString(NATRON_APPLICATION_NAME "RenderDaemon") : name );
+#else
+    if ( !name.isEmpty() ) {
+        return name;
+    }
+    QString user = QString::fromLocal8Bit( qgetenv("USER") );
+    if ( user.isEmpty() ) {
+        user = QString::fromLocal8Bit( qgetenv("USERNAME") );
+    }
+
+    return QString(NATRON_APPLICATION_NAME "RenderDaemon-%1").arg(user);
+#endif
+}
+
+bool
+RenderDaemon::exec()
+{
+    {
+        ///Do not take over the socket of a daemon that is running, but remove the one left by a daemon that crashed
+        QLocalSocket probe;
+        probe.connectToServer(_imp->serverName);
+        if ( probe.waitForConnected(NATRON_RENDER_DAEMON_POLL_MS) ) {
+            std::cerr << QObject::tr("A render daemon is already listening on %1").arg(_imp->serverName).toStdString() << std::endl;
+
+            return false;
+        }
+        QLocalServer::removeServer(_imp->serverName);
+    }
+
+#if QT_VERSION >= 0x050000
+    ///Only the user who started the daemon may submit jobs to it. Qt 4 cannot set the permissions of the socket: it
+    ///relies on the runtime directory of the user and on the check of the clients
+    _imp->server.setSocketOptions(QLocalServer::UserAccessOption);
+#endif
+    if ( !_imp->server.listen(_imp->serverName) ) {
+        std::cerr << QObject::tr("The render daemon could not listen on %1: %2").arg(_imp->serverName).arg( _imp->server.errorString() ).toStdString() << std::endl;
+
+        return false;
+    }
+    std::cout << QObject::tr("Render daemon listening on %1").arg( _imp->server.fullServerName() ).toStdString() << std::endl;
+
+    while (!_imp->quitRequested) {
+        if ( _imp->server.waitForNewConnection(NATRON_RENDER_DAEMON_POLL_MS) ) {
+            QLocalSocket* socket = _imp->server.nextPendingConnection();
+            if (socket) {
+                if ( isClientOfThisUser(socket) ) {
+                    _imp->serveClient(socket);
+                } else {
+                    std::cerr << QObject::tr("The render daemon refused a job from another user").toStdString() << std::endl;
+                }
+                socket->disconnectFromServer();
+                if (socket->state() != QLocalSocket::UnconnectedState) {
+                    socket->waitForDisconnected(NATRON_RENDER_DAEMON_POLL_MS);
+                }
+                delete socket;
+            }
+        }
+        ///Process the events posted during the renders, e.g: the deferred deletions
+        QCoreApplication::processEvents();
+    }
+    _imp->server.close();
+    std::cout << QObject::tr("Render daemon stopped").toStdString() << std::endl;
+
+    return true;
+}
+
+void
+RenderDaemon::requestQuit()
+{
+    _imp->quitRequested = 1;
+}
+
+void
+RenderDaemonPrivate::serveClient(QLocalSocket* socket)
+{
+    QStringList job;
+    QString error;
+    bool ok = RenderDaemon::readJob(socket, &job) && !job.isEmpty();
+
+    if (!ok) {
+        error = QObject::tr("The render daemon could not read the job");
+    } else {
+        const QString clientDir = job.takeFirst();
+        {
+            QMutexLocker k(&clientMutex);
+            client = socket;
+        }
+        ok = renderJob(clientDir, job, &error);
+        flushClientMessages();
+        {
+            QMutexLocker k(&clientMutex);
+            client = 0;
+        }
+    }
+
+    if (!ok) {
+        std::cerr << error.toStdString() << std::endl;
+        socket->write( (error + '\n').toUtf8() );
+    }
+    socket->write( (QString(ok ? kRenderDaemonJobSucceededShort : kRenderDaemonJobFailedShort) + '\n').toUtf8() );
+    socket->waitForBytesWritten(NATRON_RENDER_DAEMON_TIMEOUT_MS);
+}
+
+bool
+RenderDaemonPrivate::renderJob(const QString& clientDir,
+                               const QStringList& arguments,
+                               QString* error)
+{
+    ///Relative paths of the job are relative to the directory of the client
+    if ( !QDir::setCurrent(clientDir) ) {
+        *error = QObject::tr("The render daemon cannot access the directory %1").arg(clientDir);
+
+        return false;
+    }
+
+    CLArgs cl(QStringList(QCoreApplication::applicationFilePath()) + arguments, true);
+    if (cl.getError() > 0) {
+        *error = QObject::tr("Invalid render job: %1").arg( arguments.join( QString(' ') ) );
+
+        return false;
+    }
+    if ( cl.isRenderDaemon() || cl.isRenderDaemonClient() || cl.isInterpreterMode() || (cl.getWorkersCount() > 0) ) {
+        *error = QObject::tr("The --daemon, --submit, --workers and interpreter options cannot be used in a render job");
+
+        return false;
+    }
+
+    const QFileInfo info( cl.getScriptFilename() );
+    const QString projectPath = info.canonicalFilePath();
+    const QDateTime lastModified = info.lastModified();
+    const bool reuseLoadedProject = !projectPath.isEmpty() && projectPath == loadedProjectPath && lastModified == loadedProjectLastModified;
+
+    std::cout << QObject::tr("Render job: %1").arg( arguments.join( QString(' ') ) ).toStdString() << std::endl;
+
+    loadedProjectPath.clear();
+    try {
+        if (!reuseLoadedProject && projectOpened) {
+            app->getProject()->closeProject(false);
+        }
+        projectOpened = true;
+        app->renderCommandLineJob(cl, reuseLoadedProject);
+    } catch (const std::exception& e) {
+        *error = QString::fromUtf8( e.what() );
+
+        return false;
+    }
+
+    if ( !RenderDaemon::jobModifiesProject(cl) ) {
+        loadedProjectPath = projectPath;
+        loadedProjectLastModified = lastModified;
+    }
+
+    return true;
+}
+
+bool
+RenderDaemon::writeToClient(const QString& message)
+{
+    {
+        QMutexLocker k(&_imp->clientMutex);
+
+        if (!_imp->client) {
+            return false;
+        }
+        _imp->clientMessages.push_back(message);
+    }
+    if ( QThread::currentThread() == qApp->thread() ) {
+        _imp->flushClientMessages();
+    }
+
+    return true;
+}
+
+void
+RenderDaemon::flushClientMessages()
+{
+    _imp->flushClientMessages();
+}
+
+void
+RenderDaemonPrivate::flushClientMessages()
+{
+    assert( QThread::currentThread() == qApp->thread() );
+
+    QMutexLocker k(&clientMutex);
+    if ( !client || clientMessages.isEmpty() ) {
+        clientMessages.clear();
+
+        return;
+    }
+    for (QStringList::const_iterator it = clientMessages.begin(); it != clientMessages.end(); ++it) {
+        client->write( (*it + '\n').toUtf8() );
+    }
+    clientMessages.clear();
+    client->flush();
+}
+
+bool
+RenderDaemon::writeJob(QLocalSocket* socket,
+                       const QStringList& job)
+{
+    QByteArray block;
+    {
+        QDataStream out(&block, QIODevice::WriteOnly);
+        setStreamVersion(out);
+        out << (quint32)0 << job;
+        out.device()->seek(0);
+        out << (quint32)(block.size() - sizeof(quint32));
+    }
+    socket->write(block);
+
+    return socket->waitForBytesWritten(NATRON_RENDER_DAEMON_TIMEOUT_MS);
+}
+
+bool
+RenderDaemon::readJob(QLocalSocket* socket,
+                      QStringList* job)
+{
+    while ( socket->bytesAvailable() < (qint64)sizeof(quint32) ) {
+        if ( !socket->waitForReadyRead(NATRON_RENDER_DAEMON_TIMEOUT_MS) ) {
+            return false;
+        }
+    }
+    QDataStream in(socket);
+    setStreamVersion(in);
+    quint32 size = 0;
+    in >> size;
+    while ( socket->bytesAvailable() < (qint64)size ) {
+        if ( !socket->waitForReadyRead(NATRON_RENDER_DAEMON_TIMEOUT_MS) ) {
+            return false;
+        }
+    }
+    in >> *job;
+
+    return in.status() == QDataStream::Ok;
+}
+
+bool
+RenderDaemon::jobModifiesProject(const CLArgs& cl)
+{
+    if ( !cl.getPythonCommands().empty() || !cl.getDefaultOnProjectLoadedScript().isEmpty() || !cl.getReaderArgs().empty() ) {
+        return true;
+    }
+    const std::list<CLArgs::WriterArg>& writers = cl.getWriterArgs();
+    for (std::list<CLArgs::WriterArg>::const_iterator it = writers.begin(); it != writers.end(); ++it) {
+        if ( it->mustCreate || !it->filename.isEmpty() ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int
+RenderDaemon::submitJob(const CLArgs& cl)
+{
+    const QString serverName = getServerName( cl.getRenderDaemonName() );
+    QLocalSocket socket;
+
+    socket.connectToServer(serverName);
+    if ( !socket.waitForConnected(NATRON_RENDER_DAEMON_TIMEOUT_MS) ) {
+        std::cerr << QObject::tr("No render daemon is listening on %1: start one with the --daemon option").arg(serverName).toStdString() << std::endl;
+
+        return 1;
+    }
+
+    QStringList job;
+    job << QDir::currentPath() << cl.getRenderDaemonJobArguments();
+    if ( !writeJob(&socket, job) ) {
+        std::cerr << QObject::tr("The job could not be sent to the render daemon").toStdString() << std::endl;
+
+        return 1;
+    }
+
+    ///Print the messages of the render until the daemon tells how the job ended. There is no time-out: renders may be long.
+    for (;;) {
+        while ( socket.canReadLine() ) {
+            QString line = QString::fromUtf8( socket.readLine() );
+            while ( line.endsWith('\n') ) {
+                line.chop(1);
+            }
+            if (line == kRenderDaemonJobSucceededShort) {
+                return 0;
+            } else if (line == kRenderDaemonJobFailedShort) {
+                return 1;
+            }
+            std::cout << line.toStdString() << std::endl;
+        }
+        if ( !socket.waitForReadyRead(-1) && !socket.canReadLine() ) {
+            std::cerr << QObject::tr("The render daemon closed the connection before the end of the job").toStdString() << std::endl;
+
+            return 1;
+        }
+    }
+
+    return 1;
+}
+
+NATRON_NAMESPACE_EXIT;
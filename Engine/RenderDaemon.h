@@ -0,0 +1,130 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_RENDERDAEMON_H
+#define NATRON_ENGINE_RENDERDAEMON_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+CLANG_DIAG_ON(deprecated)
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/EngineFwd.h"
+
+///How long the daemon and the client wait for each other before giving up, in milliseconds
+#define NATRON_RENDER_DAEMON_TIMEOUT_MS 30000
+
+NATRON_NAMESPACE_ENTER;
+
+struct RenderDaemonPrivate;
+
+/**
+ * @brief Serves the background renders submitted to a local socket (the --daemon option), so that the start-up
+ * of the application (Python, the plug-ins, the project) is paid once instead of for every render.
+ *
+ * A job is the command-line of a background render, sent by a client started with the --submit option along with
+ * its current directory. The jobs are rendered one after the other in the AppInstance of the daemon, and the
+ * messages of the render are streamed back to the client of the job.
+ *
+ * The project of the last job is kept loaded: a job on the same project file, unmodified on disk, renders it
+ * as it is, with the images of its nodes still in the cache. The project is loaded again when the previous job
+ * modified it from the command-line (Python commands, --onload script, Read or Write node filenames).
+ **/
+class RenderDaemon
+{
+public:
+
+    RenderDaemon(AppInstance* app,
+                 const QString& serverName);
+
+    ~RenderDaemon();
+
+    /**
+     * @brief Listens to the socket and renders the jobs submitted to it until requestQuit() is called. Returns false
+     * if the socket could not be created, e.g: because another daemon is already listening to it.
+     **/
+    bool exec();
+
+    /**
+     * @brief Makes exec() return once the job being rendered, if any, is over.
+     * This only sets a flag, so that it may be called from a signal handler.
+     **/
+    void requestQuit();
+
+    /**
+     * @brief Queues a message for the client of the job being rendered. Returns false if no job is being rendered.
+     * This is thread-safe: the message is sent right away on the main thread, otherwise by flushClientMessages().
+     **/
+    bool writeToClient(const QString& message);
+
+    /**
+     * @brief Sends the queued messages to the client of the job being rendered.
+     * This must be called on the main thread, which owns the socket of the client.
+     **/
+    void flushClientMessages();
+
+    /**
+     * @brief Returns the name of the socket of the daemon. On Unix, a name that is not a path is turned into a socket
+     * in the runtime directory of the user, which other users cannot access.
+     **/
+    static QString getServerName(const QString& name);
+
+    /**
+     * @brief Submits the job given on the command-line to the daemon and prints its messages until it is rendered.
+     * Returns the exit code of the client process.
+     **/
+    static int submitJob(const CLArgs& cl);
+
+    /**
+     * @brief Sends a job to the socket: its size followed by the list of its arguments, the first one being the
+     * directory of the client. Returns false if it could not be written in time.
+     **/
+    static bool writeJob(QLocalSocket* socket,
+                         const QStringList& job);
+
+    /**
+     * @brief Reads a job sent by writeJob(). Returns false if it could not be read in time.
+     **/
+    static bool readJob(QLocalSocket* socket,
+                        QStringList* job);
+
+    /**
+     * @brief True if the job changes the project from the command-line: the next job cannot render it again as it is.
+     **/
+    static bool jobModifiesProject(const CLArgs& cl);
+
+private:
+
+    boost::scoped_ptr<RenderDaemonPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_RENDERDAEMON_H
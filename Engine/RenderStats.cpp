@@ -26,6 +26,7 @@
 
 #include "RenderStats.h"
 
+#include <algorithm> // fill
 #include <cassert>
 #include <stdexcept>
 
@@ -78,6 +79,9 @@ struct NodeRenderStatsPrivate
     //Premultiplication of the output imge
     ImagePremultiplicationEnum outputPremult;
     
+    //For each input number, the time spent pre-rendering the input branch
+    std::map<int,double> inputBranchesTimeSpent;
+    
     NodeRenderStatsPrivate()
     : totalTimeSpentRendering(0)
     , rod()
@@ -93,6 +97,7 @@ struct NodeRenderStatsPrivate
     , renderScaleSupportEnabled(false)
     , channelsEnabled()
     , outputPremult(eImagePremultiplicationOpaque)
+    , inputBranchesTimeSpent()
     {
         for (int i = 0; i < 4; ++i) {
             channelsEnabled[i] = false;
@@ -136,6 +141,7 @@ NodeRenderStats::operator=(const NodeRenderStats& other)
         _imp->channelsEnabled[i] = other._imp->channelsEnabled[i];
     }
     _imp->outputPremult = other._imp->outputPremult;
+    _imp->inputBranchesTimeSpent = other._imp->inputBranchesTimeSpent;
 }
 
 void
@@ -299,6 +305,18 @@ NodeRenderStats::getOutputPremult() const
     return _imp->outputPremult;
 }
 
+void
+NodeRenderStats::addInputBranchTimeSpent(int inputNb, double time)
+{
+    _imp->inputBranchesTimeSpent[inputNb] += time;
+}
+
+const std::map<int,double>&
+NodeRenderStats::getInputBranchesTimeSpent() const
+{
+    return _imp->inputBranchesTimeSpent;
+}
+
 struct RenderStatsPrivate
 {
     mutable QMutex lock;
@@ -312,7 +330,8 @@ struct RenderStatsPrivate
     typedef std::map<NodeWPtr,NodeRenderStats > NodeInfosMap;
     NodeInfosMap nodeInfos;
     
-    
+    //The time the frame waited at each stage of an ordered render
+    double stageWaitTime[RenderStats::eRenderStageCount];
     
     RenderStatsPrivate()
     : lock()
@@ -320,7 +339,7 @@ struct RenderStatsPrivate
     , doNodesProfiling(false)
     , nodeInfos()
     {
-        
+        std::fill(stageWaitTime, stageWaitTime + RenderStats::eRenderStageCount, 0.);
     }
     
     NodeInfosMap::iterator findNode(const NodePtr& node)
@@ -431,6 +450,18 @@ RenderStats::addRenderInfosForNode(const NodePtr& node,
     stats.addPlaneRendered(plane);
 }
 
+void
+RenderStats::addInputBranchRenderInfosForNode(const NodePtr& node,
+                                              int inputNb,
+                                              double timeSpent)
+{
+    QMutexLocker k(&_imp->lock);
+    assert(_imp->doNodesProfiling);
+    
+    NodeRenderStats& stats = _imp->findOrCreateNodeStats(node);
+    stats.addInputBranchTimeSpent(inputNb, timeSpent);
+}
+
 std::map<NodePtr,NodeRenderStats >
 RenderStats::getStats(double *totalTimeSpent) const
 {
@@ -449,4 +480,21 @@ RenderStats::getStats(double *totalTimeSpent) const
     return ret;
 }
 
+void
+RenderStats::addStageWaitTime(RenderStageEnum stage,
+                              double timeSpent)
+{
+    assert(stage >= 0 && stage < eRenderStageCount);
+    QMutexLocker k(&_imp->lock);
+    _imp->stageWaitTime[stage] += timeSpent;
+}
+
+double
+RenderStats::getStageWaitTime(RenderStageEnum stage) const
+{
+    assert(stage >= 0 && stage < eRenderStageCount);
+    QMutexLocker k(&_imp->lock);
+    return _imp->stageWaitTime[stage];
+}
+
 NATRON_NAMESPACE_EXIT;
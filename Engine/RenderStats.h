@@ -97,6 +97,9 @@ public:
     void setOutputPremult(ImagePremultiplicationEnum premult);
     ImagePremultiplicationEnum getOutputPremult() const;
     
+    void addInputBranchTimeSpent(int inputNb, double time);
+    const std::map<int,double>& getInputBranchesTimeSpent() const;
+    
 private:
     
     boost::scoped_ptr<NodeRenderStatsPrivate> _imp;
@@ -110,6 +113,17 @@ class RenderStats
 {
 public:
     
+    /**
+     * @brief The stages a frame waits at in an ordered render (e.g: a sequential writer), @see addStageWaitTime()
+     **/
+    enum RenderStageEnum
+    {
+        eRenderStageRender = 0, //< the render thread waiting for the frame to be picked, i.e. for the output device to catch up
+        eRenderStageBuffer, //< the rendered frame waiting in the buffer for the frames before it to be output
+        eRenderStageOutput, //< the output device waiting for the frame to be rendered
+        eRenderStageCount
+    };
+    
     /**
      * @brief If enableInDepthProfiling is true, a detailed breakdown for each node will be available in getStats()
      * otherwise just the totalTimeSpent for the frame will be computed.
@@ -140,8 +154,24 @@ public:
                         const RectI& rectangle,
                         double timeSpent);
     
+    /**
+     * @brief Accumulates the time spent by node to pre-render the images of its input inputNb, including the whole
+     * upstream branch, before its own render action.
+     **/
+    void addInputBranchRenderInfosForNode(const NodePtr& node,
+                                          int inputNb,
+                                          double timeSpent);
+    
     std::map<NodePtr,NodeRenderStats > getStats(double *totalTimeSpent) const;
     
+    /**
+     * @brief Accumulates the time the frame waited at the given stage, in seconds. Unlike the other infos
+     * this is recorded even if in-depth profiling is disabled.
+     **/
+    void addStageWaitTime(RenderStageEnum stage, double timeSpent);
+    
+    double getStageWaitTime(RenderStageEnum stage) const;
+    
 private:
     
     boost::scoped_ptr<RenderStatsPrivate> _imp;
@@ -0,0 +1,145 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderThreadsBalancer.h"
+
+#include <algorithm> // min, max
+
+// The minimum duration of a measurement period, in seconds
+#define NATRON_THREADS_BALANCING_PERIOD 1.
+// The relative change of throughput under which two periods are considered equally fast
+#define NATRON_THREADS_BALANCING_TOLERANCE 0.03
+// The number of periods without a move after a move was rejected
+#define NATRON_THREADS_BALANCING_HOLD_PERIODS 4
+
+NATRON_NAMESPACE_ENTER;
+
+RenderThreadsBalancer::RenderThreadsBalancer()
+    : _hardwareThreads(1)
+    , _maxThreads(1)
+    , _target(1)
+    , _lastTarget(1)
+    , _lastThroughput(-1)
+    , _lastUtilization(-1)
+    , _holdPeriods(0)
+    , _periodStarted(false)
+    , _periodWallTime(0)
+    , _periodCPUTime(0)
+    , _periodFrames(0)
+{
+}
+
+void
+RenderThreadsBalancer::reset(int hardwareThreads,
+                             int maxThreads)
+{
+    _hardwareThreads = std::max(1, hardwareThreads);
+    _maxThreads = std::max(1, maxThreads);
+    _target = _maxThreads;
+    _lastTarget = _target;
+    _lastThroughput = -1;
+    _lastUtilization = -1;
+    _holdPeriods = 0;
+    _periodStarted = false;
+    _periodFrames = 0;
+}
+
+void
+RenderThreadsBalancer::addFrameRendered()
+{
+    ++_periodFrames;
+}
+
+void
+RenderThreadsBalancer::startPeriod(double wallTime,
+                                   double cpuTime)
+{
+    _periodStarted = true;
+    _periodWallTime = wallTime;
+    _periodCPUTime = cpuTime;
+    _periodFrames = 0;
+}
+
+int
+RenderThreadsBalancer::update(double wallTime,
+                              double cpuTime)
+{
+    if (!_periodStarted) {
+        startPeriod(wallTime, cpuTime);
+
+        return _target;
+    }
+
+    const double elapsed = wallTime - _periodWallTime;
+    ///Wait for each render thread to have finished a frame, otherwise the throughput is meaningless
+    if ( (elapsed < NATRON_THREADS_BALANCING_PERIOD) || (_periodFrames < _target) ) {
+        return _target;
+    }
+
+    const double throughput = _periodFrames / elapsed;
+    if ( (cpuTime >= 0.) && (_periodCPUTime >= 0.) ) {
+        _lastUtilization = (cpuTime - _periodCPUTime) / (elapsed * _hardwareThreads);
+    } else {
+        _lastUtilization = -1;
+    }
+    startPeriod(wallTime, cpuTime);
+
+    if ( (_target != _lastTarget) && (_lastThroughput > 0.) ) {
+        ///This period measured the last move: more frames in parallel must be faster, less must not be slower
+        const bool moreThreads = _target > _lastTarget;
+        const bool keep = moreThreads ? throughput > _lastThroughput * (1. + NATRON_THREADS_BALANCING_TOLERANCE) :
+                          throughput >= _lastThroughput * (1. - NATRON_THREADS_BALANCING_TOLERANCE);
+        if (keep) {
+            _lastThroughput = throughput;
+        } else {
+            _target = _lastTarget;
+            _holdPeriods = NATRON_THREADS_BALANCING_HOLD_PERIODS;
+            ///This period was measured with the rejected setting, it is not a reference
+            _lastThroughput = -1;
+        }
+        _lastTarget = _target;
+
+        return _target;
+    }
+
+    _lastTarget = _target;
+    _lastThroughput = throughput;
+    if (_holdPeriods > 0) {
+        --_holdPeriods;
+
+        return _target;
+    }
+
+    if ( (_lastUtilization >= 0.) && (_lastUtilization < lowUtilization()) ) {
+        if (_target < _maxThreads) {
+            ++_target;
+        }
+    } else if ( (_target > 1) && ( (_lastUtilization < 0.) || (_lastUtilization >= highUtilization()) ) ) {
+        --_target;
+    }
+
+    return _target;
+} // update
+
+NATRON_NAMESPACE_EXIT;
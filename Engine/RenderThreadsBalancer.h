@@ -0,0 +1,118 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_RENDERTHREADSBALANCER_H
+#define NATRON_ENGINE_RENDERTHREADSBALANCER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Decides how many frames a sequence render should render in parallel, the cores left being used by
+ * the tiles of each frame (host frame threading).
+ *
+ * The render is measured over periods of at least minPeriod seconds. At the end of each period:
+ * - if the CPU is under-used (e.g. light nodes, or nodes serialized on a lock or the GIL) one more frame is rendered
+ * in parallel, and the move is kept only if it improves the throughput (frames per second);
+ * - if the CPU is saturated one less frame is rendered in parallel, giving its cores back to the tiles of the
+ * other frames, and the move is kept as long as the throughput does not drop: fewer frames in flight hold less
+ * memory and contend less for the caches.
+ * A rejected move is reverted and no other move is tried for a few periods.
+ *
+ * This class is not thread-safe, the caller must serialize the calls.
+ **/
+class RenderThreadsBalancer
+{
+public:
+
+    RenderThreadsBalancer();
+
+    /**
+     * @brief Starts balancing a new render on hardwareThreads cores, rendering initially maxThreads frames in
+     * parallel. The number of parallel frames is never greater than maxThreads.
+     **/
+    void reset(int hardwareThreads, int maxThreads);
+
+    /**
+     * @brief To be called whenever a frame finished rendering.
+     **/
+    void addFrameRendered();
+
+    /**
+     * @brief Returns the number of frames that should be rendered in parallel. wallTime and cpuTime are the
+     * current readings of the wall clock and of the CPU time consumed by the process, in seconds. If the CPU
+     * time cannot be measured, pass a negative cpuTime: only the throughput is used.
+     **/
+    int update(double wallTime, double cpuTime);
+
+    int getTargetThreads() const
+    {
+        return _target;
+    }
+
+    /**
+     * @brief The fraction of the cores that was used during the last period, or -1 if unknown.
+     **/
+    double getLastUtilization() const
+    {
+        return _lastUtilization;
+    }
+
+    /**
+     * @brief The CPU utilization under which one more frame is rendered in parallel
+     **/
+    static double lowUtilization()
+    {
+        return 0.85;
+    }
+
+    /**
+     * @brief The CPU utilization from which one less frame in parallel is tried
+     **/
+    static double highUtilization()
+    {
+        return 0.95;
+    }
+
+private:
+
+    void startPeriod(double wallTime, double cpuTime);
+
+    int _hardwareThreads;
+    int _maxThreads;
+    int _target; // the number of frames to render in parallel
+    int _lastTarget; // the number of frames rendered in parallel before the last move
+    double _lastThroughput; // frames per second during the last period, -1 if unknown
+    double _lastUtilization;
+    int _holdPeriods; // the number of periods to wait before trying another move
+    bool _periodStarted;
+    double _periodWallTime;
+    double _periodCPUTime;
+    int _periodFrames;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_RENDERTHREADSBALANCER_H
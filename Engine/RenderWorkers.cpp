@@ -0,0 +1,421 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RenderWorkers.h"
+
+#include <algorithm> // min, max
+#include <iostream>
+#include <set>
+#include <stdexcept>
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QCoreApplication>
+#include <QtCore/QEventLoop>
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+CLANG_DIAG_ON(deprecated)
+
+#include "Engine/AppManager.h"
+#include "Engine/OutputEffectInstance.h"
+#include "Engine/ProcessHandler.h"
+#include "Engine/Project.h"
+#include "Engine/Timer.h"
+
+// How many times the frames of a failed render process are given to another process
+#define NATRON_RENDER_WORKERS_MAX_RETRIES 2
+
+NATRON_NAMESPACE_ENTER;
+
+namespace {
+struct WorkerShard
+{
+    OutputEffectInstance* writer;
+    std::vector<int> frames; // sorted
+    bool wholeSequence; // the frames are written to a single file (a video): they can only be rendered again together
+    int attempt;
+
+    WorkerShard()
+        : writer(0)
+        , frames()
+        , wholeSequence(false)
+        , attempt(0)
+    {
+    }
+};
+
+struct RunningWorker
+{
+    boost::shared_ptr<ProcessHandler> process;
+    WorkerShard shard;
+    std::set<int> renderedFrames;
+    int index;
+};
+}
+
+struct RenderWorkersPrivate
+{
+    RenderWorkers* _publicInterface;
+    AppInstance* app;
+    int nWorkers;
+    int threadsPerWorker;
+    bool enableRenderStats;
+    QString projectPath; // the snapshot of the project loaded by the processes
+    std::list<WorkerShard> pending;
+    std::list<RunningWorker> running;
+
+    // a process cannot be deleted from its own signal: keep them until the render is finished
+    std::list<boost::shared_ptr<ProcessHandler> > finished;
+    QStringList errors;
+    int nextWorkerIndex;
+    int nFramesTotal;
+    int nFramesRendered;
+    QEventLoop loop;
+
+    RenderWorkersPrivate(RenderWorkers* publicInterface,
+                         AppInstance* app,
+                         int nWorkers,
+                         int threadsPerWorker,
+                         bool enableRenderStats)
+        : _publicInterface(publicInterface)
+        , app(app)
+        , nWorkers( std::max(1, nWorkers) )
+        , threadsPerWorker(threadsPerWorker)
+        , enableRenderStats(enableRenderStats)
+        , projectPath()
+        , pending()
+        , running()
+        , finished()
+        , errors()
+        , nextWorkerIndex(0)
+        , nFramesTotal(0)
+        , nFramesRendered(0)
+        , loop()
+    {
+        if (this->threadsPerWorker <= 0) {
+            ///Share the cores equally, the processes would otherwise each size their threads on all the cores
+            this->threadsPerWorker = std::max(1, appPTR->getHardwareIdealThreadCount() / this->nWorkers);
+        }
+    }
+
+    void addWork(const AppInstance::RenderWork& work);
+
+    void startWorkers();
+
+    void startWorker(const WorkerShard& shard);
+
+    std::list<RunningWorker>::iterator findWorker(QObject* process);
+
+    void onFrameRendered(QObject* process, int frame, double timeSpent);
+
+    void onProcessFinished(QObject* process, int returnCode);
+};
+
+RenderWorkers::RenderWorkers(AppInstance* app,
+                             int nWorkers,
+                             int threadsPerWorker,
+                             bool enableRenderStats)
+    : QObject()
+    , _imp( new RenderWorkersPrivate(this, app, nWorkers, threadsPerWorker, enableRenderStats) )
+{
+}
+
+RenderWorkers::~RenderWorkers()
+{
+    _imp->running.clear();
+    _imp->finished.clear();
+    if ( !_imp->projectPath.isEmpty() ) {
+        QFile::remove(_imp->projectPath);
+    }
+}
+
+void
+RenderWorkers::shardFrames(const std::vector<int>& frames,
+                           int nShards,
+                           bool contiguous,
+                           std::vector<std::vector<int> >* shards)
+{
+    shards->clear();
+    if ( frames.empty() ) {
+        return;
+    }
+    nShards = std::max( 1, std::min( nShards, (int)frames.size() ) );
+    shards->resize(nShards);
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        const std::size_t shard = contiguous ? (i * nShards) / frames.size() : i % nShards;
+        (*shards)[shard].push_back(frames[i]);
+    }
+}
+
+QString
+RenderWorkers::getFrameRangesArgument(const std::vector<int>& frames)
+{
+    QStringList ranges;
+    std::size_t i = 0;
+
+    while ( i < frames.size() ) {
+        ///The command-line splits a range at its dashes: negative frames can only be given one by one
+        if ( (i + 1 == frames.size()) || (frames[i] < 0) ) {
+            ranges.push_back( QString::number(frames[i]) );
+            ++i;
+            continue;
+        }
+        ///Extend the run while the step between the frames is constant
+        const int step = frames[i + 1] - frames[i];
+        std::size_t last = i + 1;
+        while ( (last + 1 < frames.size()) && (frames[last + 1] - frames[last] == step) ) {
+            ++last;
+        }
+        ///Always give the step, otherwise the frame step of the writer would be used
+        ranges.push_back( QString("%1-%2:%3").arg(frames[i]).arg(frames[last]).arg(step) );
+        i = last + 1;
+    }
+
+    return ranges.join(",");
+}
+
+void
+RenderWorkersPrivate::addWork(const AppInstance::RenderWork& work)
+{
+    int first, last, frameStep;
+
+    app->getFrameRangeToRender(work, &first, &last, &frameStep);
+    frameStep = std::max(1, frameStep);
+
+    std::vector<int> frames;
+    for (int f = first; f <= last; f += frameStep) {
+        frames.push_back(f);
+    }
+    if ( frames.empty() ) {
+        return;
+    }
+    nFramesTotal += (int)frames.size();
+
+    ///A video can only be written by a single process, and a writer that prefers to render sequentially
+    ///is given contiguous frames
+    const SequentialPreferenceEnum pref = work.writer->getSequentialPreference();
+    const bool contiguous = pref == eSequentialPreferencePreferSequential;
+    const int nShards = pref == eSequentialPreferenceOnlySequential ? 1 : nWorkers;
+
+    std::vector<std::vector<int> > shards;
+    RenderWorkers::shardFrames(frames, nShards, contiguous, &shards);
+    for (std::size_t i = 0; i < shards.size(); ++i) {
+        WorkerShard shard;
+        shard.writer = work.writer;
+        shard.frames = shards[i];
+        shard.wholeSequence = pref == eSequentialPreferenceOnlySequential;
+        pending.push_back(shard);
+    }
+}
+
+void
+RenderWorkersPrivate::startWorker(const WorkerShard& shard)
+{
+    QStringList args;
+
+    args << RenderWorkers::getFrameRangesArgument(shard.frames);
+    args << "--threads" << QString::number(threadsPerWorker);
+    if (enableRenderStats) {
+        args << "-s";
+    }
+
+    RunningWorker worker;
+    worker.process.reset( new ProcessHandler(projectPath, shard.writer, args) );
+    worker.shard = shard;
+    worker.index = nextWorkerIndex++;
+    QObject::connect( worker.process.get(), SIGNAL( frameRendered(int) ), _publicInterface, SLOT( onFrameRendered(int) ) );
+    QObject::connect( worker.process.get(), SIGNAL( frameRenderedWithTimer(int,double,double) ), _publicInterface,
+                      SLOT( onFrameRenderedWithTimer(int,double,double) ) );
+    QObject::connect( worker.process.get(), SIGNAL( processFinished(int) ), _publicInterface, SLOT( onProcessFinished(int) ) );
+    QObject::connect( worker.process.get(), SIGNAL( processFailedToStart() ), _publicInterface, SLOT( onProcessFailedToStart() ) );
+    running.push_back(worker);
+
+    std::cout << QObject::tr("Render process %1 started for %2: frames %3")
+        .arg(worker.index)
+        .arg( shard.writer->getScriptName_mt_safe().c_str() )
+        .arg( args.front() ).toStdString() << std::endl;
+    running.back().process->startProcess();
+}
+
+void
+RenderWorkersPrivate::startWorkers()
+{
+    while ( !pending.empty() && ( (int)running.size() < nWorkers ) ) {
+        WorkerShard shard = pending.front();
+        pending.pop_front();
+        startWorker(shard);
+    }
+    if ( running.empty() ) {
+        loop.quit();
+    }
+}
+
+std::list<RunningWorker>::iterator
+RenderWorkersPrivate::findWorker(QObject* process)
+{
+    for (std::list<RunningWorker>::iterator it = running.begin(); it != running.end(); ++it) {
+        if (it->process.get() == process) {
+            return it;
+        }
+    }
+
+    return running.end();
+}
+
+void
+RenderWorkers::render(const std::list<AppInstance::RenderWork>& work)
+{
+    ///The processes load a snapshot of the project as it is now, i.e: with the modifications of the command-line
+    QString snapshotName = QString("RENDER_SAVE_%1.ntp").arg( QCoreApplication::applicationPid() );
+    _imp->app->getProject()->saveProject_imp("", snapshotName, true, false, &_imp->projectPath);
+    if ( _imp->projectPath.isEmpty() ) {
+        throw std::runtime_error( tr("Failed to save the project for the render processes").toStdString() );
+    }
+
+    for (std::list<AppInstance::RenderWork>::const_iterator it = work.begin(); it != work.end(); ++it) {
+        _imp->addWork(*it);
+    }
+
+    std::cout << tr("Rendering %1 frames with %2 processes of %3 threads")
+        .arg(_imp->nFramesTotal).arg(_imp->nWorkers).arg(_imp->threadsPerWorker).toStdString() << std::endl;
+
+    _imp->startWorkers();
+    if ( !_imp->running.empty() ) {
+        _imp->loop.exec();
+    }
+
+    if ( !_imp->errors.isEmpty() ) {
+        throw std::runtime_error( _imp->errors.join("\n").toStdString() );
+    }
+}
+
+void
+RenderWorkersPrivate::onFrameRendered(QObject* process,
+                                      int frame,
+                                      double timeSpent)
+{
+    std::list<RunningWorker>::iterator found = findWorker(process);
+
+    if ( found == running.end() ) {
+        return;
+    }
+    ///With several views the frame is reported for each view
+    if ( !found->renderedFrames.insert(frame).second ) {
+        return;
+    }
+    ++nFramesRendered;
+
+    QString longMessage;
+    QTextStream ts(&longMessage);
+    const double percentage = nFramesTotal ? (double)nFramesRendered / nFramesTotal : 1.;
+    ts << kFrameRenderedStringLong << frame << " (" << QString::number(percentage * 100, 'f', 1) << "%)";
+    if (timeSpent >= 0) {
+        ts << "\nTime elapsed for frame: " << Timer::printAsTime(timeSpent, false);
+    }
+    ts.flush();
+    appPTR->writeToOutputPipe( longMessage, kFrameRenderedStringShort + QString::number(frame) );
+}
+
+void
+RenderWorkers::onFrameRendered(int frame)
+{
+    _imp->onFrameRendered(sender(), frame, -1);
+}
+
+void
+RenderWorkers::onFrameRenderedWithTimer(int frame,
+                                        double timeSpent,
+                                        double /*timeRemaining*/)
+{
+    _imp->onFrameRendered(sender(), frame, timeSpent);
+}
+
+void
+RenderWorkers::onProcessFinished(int returnCode)
+{
+    _imp->onProcessFinished(sender(), returnCode);
+}
+
+void
+RenderWorkers::onProcessFailedToStart()
+{
+    _imp->onProcessFinished(sender(), 1);
+}
+
+void
+RenderWorkersPrivate::onProcessFinished(QObject* process,
+                                        int returnCode)
+{
+    std::list<RunningWorker>::iterator found = findWorker(process);
+
+    if ( found == running.end() ) {
+        return;
+    }
+
+    ///The frames that were not reported are rendered again by another process
+    WorkerShard missing = found->shard;
+    missing.frames.clear();
+    for (std::size_t i = 0; i < found->shard.frames.size(); ++i) {
+        if ( found->renderedFrames.find(found->shard.frames[i]) == found->renderedFrames.end() ) {
+            missing.frames.push_back(found->shard.frames[i]);
+        }
+    }
+
+    const QString writerName( found->shard.writer->getScriptName_mt_safe().c_str() );
+    const QString reason = returnCode == 2 ? QObject::tr("crashed") : QObject::tr("failed");
+    if ( !missing.frames.empty() ) {
+        std::cerr << QObject::tr("Render process %1 %2 before rendering %3 frames of %4. Its log is:")
+            .arg(found->index).arg(reason).arg( (int)missing.frames.size() ).arg(writerName).toStdString() << std::endl;
+        std::cerr << found->process->getProcessLog().toStdString() << std::endl;
+        if (missing.wholeSequence) {
+            ///Rendering only the missing frames would overwrite the file with them: render the whole sequence again
+            missing.frames = found->shard.frames;
+            nFramesRendered -= (int)found->renderedFrames.size();
+        }
+        if (missing.attempt < NATRON_RENDER_WORKERS_MAX_RETRIES) {
+            ++missing.attempt;
+            ///Retry first, the other processes have their own frames
+            pending.push_front(missing);
+        } else {
+            errors.push_back( QObject::tr("%1: failed to render the frames %2")
+                              .arg(writerName).arg( RenderWorkers::getFrameRangesArgument(missing.frames) ) );
+        }
+    } else if (returnCode != 0) {
+        ///All the frames were reported but the process did not end well, e.g: the file could not be finalized
+        std::cerr << QObject::tr("Render process %1 %2 after rendering the frames of %3. Its log is:")
+            .arg(found->index).arg(reason).arg(writerName).toStdString() << std::endl;
+        std::cerr << found->process->getProcessLog().toStdString() << std::endl;
+        errors.push_back( QObject::tr("%1: the render process of the frames %2 %3")
+                          .arg(writerName).arg( RenderWorkers::getFrameRangesArgument(found->shard.frames) ).arg(reason) );
+    }
+
+    finished.push_back(found->process);
+    running.erase(found);
+    startWorkers();
+}
+
+NATRON_NAMESPACE_EXIT;
+
+NATRON_NAMESPACE_USING;
+#include "moc_RenderWorkers.cpp"
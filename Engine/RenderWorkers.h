@@ -0,0 +1,115 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_RENDERWORKERS_H
+#define NATRON_ENGINE_RENDERWORKERS_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <vector>
+
+CLANG_DIAG_OFF(deprecated)
+#include <QtCore/QObject>
+#include <QtCore/QString>
+CLANG_DIAG_ON(deprecated)
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/scoped_ptr.hpp>
+#endif
+
+#include "Engine/AppInstance.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+struct RenderWorkersPrivate;
+
+/**
+ * @brief Renders the Write nodes of a background render with several render processes (the --workers option).
+ *
+ * A snapshot of the project is saved, then the frames of each writer are shared between the processes, which
+ * each load the snapshot and render their frames with their share of the cores. The frames are interleaved
+ * between the processes, or split in contiguous chunks for the writers that prefer to render sequentially.
+ * Writers that can only render sequentially (e.g: video files) are rendered by a single process.
+ *
+ * The processes report the frames they rendered through the IPC of the ProcessHandler. When a process fails or
+ * crashes, the frames it did not report are rendered again by another process, at most
+ * NATRON_RENDER_WORKERS_MAX_RETRIES times.
+ **/
+class RenderWorkers
+    : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * @brief threadsPerWorker is the number of cores given to each process, or 0 to share the cores equally.
+     **/
+    RenderWorkers(AppInstance* app,
+                  int nWorkers,
+                  int threadsPerWorker,
+                  bool enableRenderStats);
+
+    virtual ~RenderWorkers();
+
+    /**
+     * @brief Renders the given work with the processes and returns once all the processes are finished.
+     * Throws std::runtime_error if some frames could not be rendered.
+     **/
+    void render(const std::list<AppInstance::RenderWork>& work);
+
+    /**
+     * @brief Splits frames in nShards lists, interleaved or in contiguous chunks.
+     **/
+    static void shardFrames(const std::vector<int>& frames,
+                            int nShards,
+                            bool contiguous,
+                            std::vector<std::vector<int> >* shards);
+
+    /**
+     * @brief Returns the frame ranges argument of the command-line rendering the given sorted frames,
+     * e.g: "-3,-2,1-9:2,12,20-30:1". Negative frames are given one by one.
+     **/
+    static QString getFrameRangesArgument(const std::vector<int>& frames);
+
+public Q_SLOTS:
+
+    void onFrameRendered(int frame);
+
+    void onFrameRenderedWithTimer(int frame, double timeSpent, double timeRemaining);
+
+    void onProcessFinished(int returnCode);
+
+    void onProcessFailedToStart();
+
+private:
+
+    boost::scoped_ptr<RenderWorkersPrivate> _imp;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_RENDERWORKERS_H
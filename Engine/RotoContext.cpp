@@ -58,8 +58,10 @@ GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
 #include "Engine/RotoContextSerialization.h"
 #include "Engine/RotoDrawableItem.h"
 #include "Engine/RotoLayer.h"
+#include "Engine/RotoRasterizer.h"
 #include "Engine/RotoStrokeItem.h"
 #include "Engine/Settings.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Transform.h"
 #include "Engine/ViewerInstance.h"
@@ -2080,18 +2082,6 @@ RotoContext::evaluateNeatStrokeRender()
     }
 }
 
-static void
-adjustToPointToScale(unsigned int mipmapLevel,
-                     double &x,
-                     double &y)
-{
-    if (mipmapLevel != 0) {
-        int pot = (1 << mipmapLevel);
-        x /= pot;
-        y /= pot;
-    }
-}
-
 template <typename PIX,int maxValue, int dstNComps, int srcNComps, bool useOpacity>
 static void
 convertCairoImageToNatronImageForDstComponents_noColor(cairo_surface_t* cairoImg,
@@ -2765,6 +2755,14 @@ RotoContext::renderMaskInternal(const boost::shared_ptr<RotoDrawableItem>& strok
     
     RotoStrokeItem* isStroke = dynamic_cast<RotoStrokeItem*>(stroke.get());
     Bezier* isBezier = dynamic_cast<Bezier*>(stroke.get());
+    
+    ///Closed shapes are rendered without cairo, directly into the image
+    if ( isBezier && !isBezier->isOpenBezier() ) {
+        _imp->renderBezier(isBezier, stroke->getOpacity(time), time, mipmapLevel, roi, image.get());
+        
+        return image;
+    }
+    
     cairo_format_t cairoImgFormat;
     
     int srcNComps;
@@ -2790,81 +2788,59 @@ RotoContext::renderMaskInternal(const boost::shared_ptr<RotoDrawableItem>& strok
     }
     
 
-    ////Allocate the cairo temporary buffer
-    cairo_surface_t* cairoImg = cairo_image_surface_create(cairoImgFormat, roi.width(), roi.height() );
-    cairo_surface_set_device_offset(cairoImg, -roi.x1, -roi.y1);
-    if (cairo_surface_status(cairoImg) != CAIRO_STATUS_SUCCESS) {
-        return image;
-    }
-    cairo_t* cr = cairo_create(cairoImg);
-    //cairo_set_fill_rule(cr, CAIRO_FILL_RULE_EVEN_ODD); // creates holes on self-overlapping shapes
-    cairo_set_fill_rule(cr, CAIRO_FILL_RULE_WINDING);
-    
-    // these Roto shapes must be rendered WITHOUT antialias, or the junction between the inner
-    // polygon and the feather zone will have artifacts. This is partly due to the fact that cairo
-    // meshes are not antialiased.
-    // Use a default feather distance of 1 pixel instead!
-    // UPDATE: unfortunately, this produces less artifacts, but there are still some remaining (use opacity=0.5 to test)
-    // maybe the inner polygon should be made of mesh patterns too?
-    cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
-
-    
     double shapeColor[3];
     stroke->getColor(time, shapeColor);
 
     double opacity = stroke->getOpacity(time);
 
     assert(isStroke || isBezier);
-    if (isStroke || !isBezier || (isBezier && isBezier->isOpenBezier())) {
-        std::vector<cairo_pattern_t*> dotPatterns(ROTO_PRESSURE_LEVELS);
-        for (std::size_t i = 0; i < dotPatterns.size(); ++i) {
-            dotPatterns[i] = (cairo_pattern_t*)0;
-        }
-        _imp->renderStroke(cr, dotPatterns, strokes, 0, stroke, doBuildUp, opacity, time, mipmapLevel);
-        
-        for (std::size_t i = 0; i < dotPatterns.size(); ++i) {
-            if (dotPatterns[i]) {
-                cairo_pattern_destroy(dotPatterns[i]);
-                dotPatterns[i] = 0;
-            }
+    
+    ///The dots are computed once, then the roi is split in tiles rendered in parallel, each one drawing only the dots touching it
+    std::vector<StrokeDot> dots;
+    _imp->computeStrokeDots(strokes, 0, stroke, opacity, time, mipmapLevel, &dots);
+    
+    const std::vector<RectI> tiles = roi.splitIntoSmallerRects(0);
+    std::vector<cairo_surface_t*> tileImgs( tiles.size(), (cairo_surface_t*)0 );
+    TaskScheduler* scheduler = appPTR ? appPTR->getTaskScheduler() : 0;
+    if ( !scheduler || (scheduler->maxThreadCount() <= 1) || (tiles.size() <= 1) ) {
+        for (std::size_t i = 0; i < tiles.size(); ++i) {
+            _imp->renderStrokeTile(tiles[i], cairoImgFormat, &dots, doBuildUp, opacity, &tileImgs[i]);
         }
-        
-        
     } else {
-        _imp->renderBezier(cr, isBezier, opacity, time, mipmapLevel);
+        TaskGroup group(scheduler);
+        for (std::size_t i = 0; i < tiles.size(); ++i) {
+            group.run( boost::bind(&RotoContextPrivate::renderStrokeTile, _imp.get(), tiles[i], cairoImgFormat, &dots, doBuildUp, opacity, &tileImgs[i]) );
+        }
+        group.wait();
     }
     
+    ///The tiles are converted by this thread, since the write access to the image is per-thread
     bool useOpacityToConvert = (isBezier != 0);
     
-    switch (depth) {
-        case eImageBitDepthFloat:
-            convertCairoImageToNatronImage_noColor<float, 1>(cairoImg, srcNComps, image.get(), roi, shapeColor, opacity, useOpacityToConvert);
-            break;
-        case eImageBitDepthByte:
-            convertCairoImageToNatronImage_noColor<unsigned char, 255>(cairoImg, srcNComps,  image.get(), roi,shapeColor, opacity, useOpacityToConvert);
-            break;
-        case eImageBitDepthShort:
-            convertCairoImageToNatronImage_noColor<unsigned short, 65535>(cairoImg, srcNComps, image.get(), roi,shapeColor, opacity, useOpacityToConvert);
-            break;
-        case eImageBitDepthHalf:
-        case eImageBitDepthNone:
-            assert(false);
-            break;
+    for (std::size_t i = 0; i < tiles.size(); ++i) {
+        if (!tileImgs[i]) {
+            image->fillZero(tiles[i]);
+            continue;
+        }
+        assert(cairo_surface_status(tileImgs[i]) == CAIRO_STATUS_SUCCESS);
+        switch (depth) {
+            case eImageBitDepthFloat:
+                convertCairoImageToNatronImage_noColor<float, 1>(tileImgs[i], srcNComps, image.get(), tiles[i], shapeColor, opacity, useOpacityToConvert);
+                break;
+            case eImageBitDepthByte:
+                convertCairoImageToNatronImage_noColor<unsigned char, 255>(tileImgs[i], srcNComps,  image.get(), tiles[i], shapeColor, opacity, useOpacityToConvert);
+                break;
+            case eImageBitDepthShort:
+                convertCairoImageToNatronImage_noColor<unsigned short, 65535>(tileImgs[i], srcNComps, image.get(), tiles[i], shapeColor, opacity, useOpacityToConvert);
+                break;
+            case eImageBitDepthHalf:
+            case eImageBitDepthNone:
+                assert(false);
+                break;
+        }
+        ////Free the buffer used by Cairo
+        cairo_surface_destroy(tileImgs[i]);
     }
-
-    
-    assert(cairo_surface_status(cairoImg) == CAIRO_STATUS_SUCCESS);
-    
-    ///A call to cairo_surface_flush() is required before accessing the pixel data
-    ///to ensure that all pending drawing operations are finished.
-    cairo_surface_flush(cairoImg);
-    
-    
-    
-    cairo_destroy(cr);
-    ////Free the buffer used by Cairo
-    cairo_surface_destroy(cairoImg);
-
     
     return image;
 }
@@ -2920,6 +2896,10 @@ RotoContextPrivate::renderDot(cairo_t* cr,
         cairo_translate(cr, center.x, center.y);
         cairo_set_source(cr, pattern);
         cairo_translate(cr, -center.x, -center.y);
+        if (!dotPatterns[pressureInt]) {
+            ///cr holds a reference on the pattern
+            cairo_pattern_destroy(pattern);
+        }
     } else {
         if (doBuildUp) {
             cairo_set_source_rgba(cr, 1., 1., 1., opacity);
@@ -2927,16 +2907,6 @@ RotoContextPrivate::renderDot(cairo_t* cr,
             cairo_set_source_rgba(cr, opacity, opacity, opacity, 1.);
         }
     }
-#ifdef DEBUG
-    //Make sure the dot we are about to render falls inside the clip region, otherwise the bounds of the image are mis-calculated.
-    cairo_surface_t* target = cairo_get_target(cr);
-    int w = cairo_image_surface_get_width(target);
-    int h = cairo_image_surface_get_height(target);
-    double x1,y1;
-    cairo_surface_get_device_offset(target, &x1, &y1);
-    assert(std::floor(center.x - externalDotRadius) >= -x1 && std::floor(center.x + externalDotRadius) < -x1 + w &&
-           std::floor(center.y - externalDotRadius) >= -y1 && std::floor(center.y + externalDotRadius) < -y1 + h);
-#endif
     cairo_arc(cr, center.x, center.y, externalDotRadius, 0, M_PI * 2);
     cairo_fill(cr);
 }
@@ -2974,15 +2944,13 @@ static void getRenderDotParams(double alpha, double brushSizePixel, double brush
 }
 
 double
-RotoContextPrivate::renderStroke(cairo_t* cr,
-                                 std::vector<cairo_pattern_t*>& dotPatterns,
-                                 const std::list<std::list<std::pair<Point,double> > >& strokes,
-                                 double distToNext,
-                                 const boost::shared_ptr<RotoDrawableItem>&  stroke,
-                                 bool doBuildup,
-                                 double alpha,
-                                 double time,
-                                 unsigned int mipmapLevel)
+RotoContextPrivate::computeStrokeDots(const std::list<std::list<std::pair<Point,double> > >& strokes,
+                                      double distToNext,
+                                      const boost::shared_ptr<RotoDrawableItem>&  stroke,
+                                      double alpha,
+                                      double time,
+                                      unsigned int mipmapLevel,
+                                      std::vector<StrokeDot>* dots)
 {
     if (strokes.empty()) {
         return distToNext;
@@ -2992,8 +2960,6 @@ RotoContextPrivate::renderStroke(cairo_t* cr,
         return distToNext;
     }
     
-    assert(dotPatterns.size() == ROTO_PRESSURE_LEVELS);
-    
     boost::shared_ptr<KnobDouble> brushSizeKnob = stroke->getBrushSizeKnob();
     double brushSize = brushSizeKnob->getValueAtTime(time);
     boost::shared_ptr<KnobDouble> brushSpacingKnob = stroke->getBrushSpacingKnob();
@@ -3025,9 +2991,6 @@ RotoContextPrivate::renderStroke(cairo_t* cr,
     if (mipmapLevel != 0) {
         brushSizePixel = std::max(1.,brushSizePixel / (1 << mipmapLevel));
     }
-    cairo_set_operator(cr,doBuildup ? CAIRO_OPERATOR_OVER : CAIRO_OPERATOR_LIGHTEN);
-
-    
     for (std::list<std::list<std::pair<Point,double> > >::const_iterator strokeIt = strokes.begin() ;strokeIt != strokes.end() ;++strokeIt) {
         int firstPoint = (int)std::floor((strokeIt->size() * writeOnStart));
         int endPoint = (int)std::ceil((strokeIt->size() * writeOnEnd));
@@ -3050,10 +3013,12 @@ RotoContextPrivate::renderStroke(cairo_t* cr,
         std::list<std::pair<Point,double> >::iterator it = visiblePortion.begin();
         
         if (visiblePortion.size() == 1) {
-            double internalDotRadius, externalDotRadius, spacing;
-            std::vector<std::pair<double,double> > opacityStops;
-            getRenderDotParams(alpha, brushSizePixel, brushHardness, brushSpacing, it->second, pressureAffectsOpacity, pressureAffectsSize, pressureAffectsHardness, &internalDotRadius, &externalDotRadius, &spacing, &opacityStops);
-            renderDot(cr, dotPatterns, it->first, internalDotRadius, externalDotRadius, it->second, doBuildup, opacityStops, alpha);
+            StrokeDot dot;
+            double spacing;
+            dot.center = it->first;
+            dot.pressure = it->second;
+            getRenderDotParams(alpha, brushSizePixel, brushHardness, brushSpacing, it->second, pressureAffectsOpacity, pressureAffectsSize, pressureAffectsHardness, &dot.internalRadius, &dot.externalRadius, &spacing, &dot.opacityStops);
+            dots->push_back(dot);
             continue;
         }
         
@@ -3076,11 +3041,13 @@ RotoContextPrivate::renderStroke(cairo_t* cr,
                 };
                 double pressure = it->second * (1 - a) + next->second * a;
                 
-                // draw the dot
-                double internalDotRadius, externalDotRadius, spacing;
-                std::vector<std::pair<double,double> > opacityStops;
-                getRenderDotParams(alpha, brushSizePixel, brushHardness, brushSpacing, pressure, pressureAffectsOpacity, pressureAffectsSize, pressureAffectsHardness, &internalDotRadius, &externalDotRadius, &spacing, &opacityStops);
-                renderDot(cr, dotPatterns, center, internalDotRadius, externalDotRadius, pressure, doBuildup, opacityStops, alpha);
+                // add the dot
+                StrokeDot dot;
+                double spacing;
+                dot.center = center;
+                dot.pressure = pressure;
+                getRenderDotParams(alpha, brushSizePixel, brushHardness, brushSpacing, pressure, pressureAffectsOpacity, pressureAffectsSize, pressureAffectsHardness, &dot.internalRadius, &dot.externalRadius, &spacing, &dot.opacityStops);
+                dots->push_back(dot);
                 
                 distToNext += spacing;
             }
@@ -3099,109 +3066,133 @@ RotoContextPrivate::renderStroke(cairo_t* cr,
 
 
 void
-RotoContextPrivate::renderBezier(cairo_t* cr,const Bezier* bezier,double opacity, double time, unsigned int mipmapLevel)
+RotoContextPrivate::renderDots(cairo_t* cr,
+                               std::vector<cairo_pattern_t*>& dotPatterns,
+                               const std::vector<StrokeDot>& dots,
+                               bool doBuildup,
+                               double opacity)
 {
-    ///render the bezier only if finished (closed) and activated
-    if ( !bezier->isCurveFinished() || !bezier->isActivated(time) || ( bezier->getControlPointsCount() <= 1 ) ) {
-        return;
-    }
-    
-    
-    double fallOff = bezier->getFeatherFallOff(time);
-    double featherDist = bezier->getFeatherDistance(time);
-#ifdef NATRON_ROTO_INVERTIBLE
-    bool inverted = (*it2)->getInverted(time);
-#else
-    const bool inverted = false;
-#endif
-    double shapeColor[3];
-    bezier->getColor(time, shapeColor);
-    
-    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+    assert(dotPatterns.size() == ROTO_PRESSURE_LEVELS);
     
-    BezierCPs cps = bezier->getControlPoints_mt_safe();
+    cairo_set_operator(cr,doBuildup ? CAIRO_OPERATOR_OVER : CAIRO_OPERATOR_LIGHTEN);
     
-    BezierCPs fps = bezier->getFeatherPoints_mt_safe();
+    ///Skip the dots outside of the target image, which may only be a tile of the render
+    cairo_surface_t* target = cairo_get_target(cr);
+    double offsetX, offsetY;
+    cairo_surface_get_device_offset(target, &offsetX, &offsetY);
+    const double x1 = -offsetX;
+    const double y1 = -offsetY;
+    const double x2 = x1 + cairo_image_surface_get_width(target);
+    const double y2 = y1 + cairo_image_surface_get_height(target);
+    
+    for (std::vector<StrokeDot>::const_iterator it = dots.begin(); it != dots.end(); ++it) {
+        if (it->center.x + it->externalRadius < x1 || it->center.x - it->externalRadius >= x2 ||
+            it->center.y + it->externalRadius < y1 || it->center.y - it->externalRadius >= y2) {
+            continue;
+        }
+        renderDot(cr, dotPatterns, it->center, it->internalRadius, it->externalRadius, it->pressure, doBuildup, it->opacityStops, opacity);
+    }
+}
+
+double
+RotoContextPrivate::renderStroke(cairo_t* cr,
+                                 std::vector<cairo_pattern_t*>& dotPatterns,
+                                 const std::list<std::list<std::pair<Point,double> > >& strokes,
+                                 double distToNext,
+                                 const boost::shared_ptr<RotoDrawableItem>&  stroke,
+                                 bool doBuildup,
+                                 double alpha,
+                                 double time,
+                                 unsigned int mipmapLevel)
+{
+    std::vector<StrokeDot> dots;
+    distToNext = computeStrokeDots(strokes, distToNext, stroke, alpha, time, mipmapLevel, &dots);
+    renderDots(cr, dotPatterns, dots, doBuildup, alpha);
     
-    assert( cps.size() == fps.size() );
+    return distToNext;
+}
+
+void
+RotoContextPrivate::renderStrokeTile(const RectI& tile,
+                                     cairo_format_t format,
+                                     const std::vector<StrokeDot>* dots,
+                                     bool doBuildup,
+                                     double opacity,
+                                     cairo_surface_t** surface)
+{
+    *surface = 0;
     
-    if ( cps.empty() ) {
+    bool touched = false;
+    for (std::vector<StrokeDot>::const_iterator it = dots->begin(); it != dots->end(); ++it) {
+        if (it->center.x + it->externalRadius >= tile.x1 && it->center.x - it->externalRadius < tile.x2 &&
+            it->center.y + it->externalRadius >= tile.y1 && it->center.y - it->externalRadius < tile.y2) {
+            touched = true;
+            break;
+        }
+    }
+    if (!touched) {
         return;
     }
     
-    cairo_new_path(cr);
-    
-    ////Define the feather edge pattern
-    cairo_pattern_t* mesh = cairo_pattern_create_mesh();
-    if (cairo_pattern_status(mesh) != CAIRO_STATUS_SUCCESS) {
-        cairo_pattern_destroy(mesh);
+    ////Allocate the cairo temporary buffer
+    cairo_surface_t* cairoImg = cairo_image_surface_create(format, tile.width(), tile.height() );
+    if (cairo_surface_status(cairoImg) != CAIRO_STATUS_SUCCESS) {
+        cairo_surface_destroy(cairoImg);
         return;
     }
+    cairo_surface_set_device_offset(cairoImg, -tile.x1, -tile.y1);
+    cairo_t* cr = cairo_create(cairoImg);
+    cairo_set_fill_rule(cr, CAIRO_FILL_RULE_WINDING);
+    cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
     
-    ///Adjust the feather distance so it takes the mipmap level into account
-    if (mipmapLevel != 0) {
-        featherDist /= (1 << mipmapLevel);
+    std::vector<cairo_pattern_t*> dotPatterns( ROTO_PRESSURE_LEVELS, (cairo_pattern_t*)0 );
+    renderDots(cr, dotPatterns, *dots, doBuildup, opacity);
+    for (std::size_t i = 0; i < dotPatterns.size(); ++i) {
+        if (dotPatterns[i]) {
+            cairo_pattern_destroy(dotPatterns[i]);
+        }
     }
     
-    Transform::Matrix3x3 transform;
-    bezier->getTransformAtTime(time, &transform);
-    
-    
-    renderFeather(bezier, time, mipmapLevel, inverted, shapeColor, opacity, featherDist, fallOff, mesh);
-    
-    
-    if (!inverted) {
-        // strangely, the above-mentioned cairo bug doesn't affect this function
-        renderInternalShape(time, mipmapLevel, shapeColor, opacity, transform, cr, mesh, cps);
-#ifdef NATRON_ROTO_INVERTIBLE
-    } else {
-#pragma message WARN("doesn't work! the image should be infinite for this to work!")
-        // Doesn't work! the image should be infinite for this to work!
-        // Or at least it should contain the Union of the source RoDs.
-        // Here, it only contains the boinding box of the Bezier.
-        // If there's a transform after the roto node, a black border will appear.
-        // The only solution would be to have a color parameter which specifies how on image is outside of its RoD.
-        // Unfortunately, the OFX definition is: "it is black and transparent"
-        
-        ///If inverted, draw an inverted rectangle on all the image first
-        // with a hole consisting of the feather polygon
-        
-        double xOffset, yOffset;
-        cairo_surface_get_device_offset(cairoImg, &xOffset, &yOffset);
-        int width = cairo_image_surface_get_width(cairoImg);
-        int height = cairo_image_surface_get_height(cairoImg);
-        
-        cairo_move_to(cr, -xOffset, -yOffset);
-        cairo_line_to(cr, -xOffset + width, -yOffset);
-        cairo_line_to(cr, -xOffset + width, -yOffset + height);
-        cairo_line_to(cr, -xOffset, -yOffset + height);
-        cairo_line_to(cr, -xOffset, -yOffset);
-        // strangely, the above-mentioned cairo bug doesn't affect this function
-#pragma message WARN("WRONG! should use the outer feather contour, *displaced* by featherDistance, not fps")
-        renderInternalShape(time, mipmapLevel, cr, fps);
-#endif
-    }
+    ///A call to cairo_surface_flush() is required before accessing the pixel data
+    ///to ensure that all pending drawing operations are finished.
+    cairo_surface_flush(cairoImg);
+    cairo_destroy(cr);
     
-    applyAndDestroyMask(cr, mesh);
-
+    *surface = cairoImg;
 }
 
+
+
 void
-RotoContextPrivate::renderFeather(const Bezier* bezier,double time, unsigned int mipmapLevel, bool inverted, double shapeColor[3], double /*opacity*/, double featherDist, double fallOff, cairo_pattern_t* mesh)
+RotoContextPrivate::renderBezier(const Bezier* bezier,
+                                 double opacity,
+                                 double time,
+                                 unsigned int mipmapLevel,
+                                 const RectI& roi,
+                                 Image* image)
 {
+    ///render the bezier only if finished (closed) and activated
+    if ( !bezier->isCurveFinished() || !bezier->isActivated(time) || ( bezier->getControlPointsCount() <= 1 ) ) {
+        image->fillZero(roi);
+        return;
+    }
     
-    ///Note that we do not use the opacity when rendering the bezier, it is rendered with correct floating point opacity/color when converting
-    ///to the Natron image.
+    double fallOff = bezier->getFeatherFallOff(time);
+    double featherDist = bezier->getFeatherDistance(time);
+    double shapeColor[3];
+    bezier->getColor(time, shapeColor);
+    
+    ///Adjust the feather distance so it takes the mipmap level into account
+    if (mipmapLevel != 0) {
+        featherDist /= (1 << mipmapLevel);
+    }
     
-    double fallOffInverse = 1. / fallOff;
     /*
      * We descretize the feather control points to obtain a polygon so that the feather distance will be of the same thickness around all the shape.
      * If we were to extend only the end points, the resulting bezier interpolation would create a feather with different thickness around the shape,
      * yielding an unwanted behaviour for the end user.
+     * The inner polygon is the same as the inner edge of the feather, so that there is no gap between the two.
      */
-    ///here is the polygon of the feather bezier
-    ///This is used only if the feather distance is different of 0 and the feather points equal
-    ///the control points in order to still be able to apply the feather distance.
     std::list<Point> featherPolygon;
     std::list<Point> bezierPolygon;
     RectD featherPolyBBox;
@@ -3209,408 +3200,18 @@ RotoContextPrivate::renderFeather(const Bezier* bezier,double time, unsigned int
     
     bezier->evaluateFeatherPointsAtTime_DeCasteljau(false, time, mipmapLevel, 50, true, &featherPolygon, &featherPolyBBox);
     bezier->evaluateAtTime_DeCasteljau(false, time, mipmapLevel, 50, &bezierPolygon, NULL);
-    
-    bool clockWise = bezier->isFeatherPolygonClockwiseOriented(false,time);
-    
-    assert( !featherPolygon.empty() && !bezierPolygon.empty());
-
-
-    std::list<Point> featherContour;
-
-    // prepare iterators
-    std::list<Point>::iterator next = featherPolygon.begin();
-    ++next;  // can only be valid since we assert the list is not empty
-    if (next == featherPolygon.end()) {
-        next = featherPolygon.begin();
-    }
-    std::list<Point>::iterator prev = featherPolygon.end();
-    --prev; // can only be valid since we assert the list is not empty
-    std::list<Point>::iterator bezIT = bezierPolygon.begin();
-    std::list<Point>::iterator prevBez = bezierPolygon.end();
-    --prevBez; // can only be valid since we assert the list is not empty
-
-    // prepare p1
-    double absFeatherDist = std::abs(featherDist);
-    Point p1 = *featherPolygon.begin();
-    double norm = sqrt( (next->x - prev->x) * (next->x - prev->x) + (next->y - prev->y) * (next->y - prev->y) );
-    assert(norm != 0);
-    double dx = -( (next->y - prev->y) / norm );
-    double dy = ( (next->x - prev->x) / norm );
-
-    if (!clockWise) {
-        p1.x -= dx * absFeatherDist;
-        p1.y -= dy * absFeatherDist;
-    } else {
-        p1.x += dx * absFeatherDist;
-        p1.y += dy * absFeatherDist;
-    }
-    
-    Point origin = p1;
-    featherContour.push_back(p1);
-
-
-    // increment for first iteration
-    std::list<Point>::iterator cur = featherPolygon.begin();
-    // ++cur, ++prev, ++next, ++bezIT, ++prevBez
-    // all should be valid, actually
-    assert(cur != featherPolygon.end() &&
-           prev != featherPolygon.end() &&
-           next != featherPolygon.end() &&
-           bezIT != bezierPolygon.end() &&
-           prevBez != bezierPolygon.end());
-    if (cur != featherPolygon.end()) {
-        ++cur;
-    }
-    if (prev != featherPolygon.end()) {
-        ++prev;
-    }
-    if (next != featherPolygon.end()) {
-        ++next;
-    }
-    if (bezIT != bezierPolygon.end()) {
-        ++bezIT;
-    }
-    if (prevBez != bezierPolygon.end()) {
-        ++prevBez;
-    }
-
-    for (;; ++cur) { // for each point in polygon
-        if ( next == featherPolygon.end() ) {
-            next = featherPolygon.begin();
-        }
-        if ( prev == featherPolygon.end() ) {
-            prev = featherPolygon.begin();
-        }
-        if ( bezIT == bezierPolygon.end() ) {
-            bezIT = bezierPolygon.begin();
-        }
-        if ( prevBez == bezierPolygon.end() ) {
-            prevBez = bezierPolygon.begin();
-        }
-        bool mustStop = false;
-        if ( cur == featherPolygon.end() ) {
-            mustStop = true;
-            cur = featherPolygon.begin();
-        }
-        
-        ///skip it
-        if ( (cur->x == prev->x) && (cur->y == prev->y) ) {
-            continue;
-        }
-        
-        Point p0, p0p1, p1p0, p2, p2p3, p3p2, p3;
-        p0.x = prevBez->x;
-        p0.y = prevBez->y;
-        p3.x = bezIT->x;
-        p3.y = bezIT->y;
-        
-        if (!mustStop) {
-            norm = sqrt( (next->x - prev->x) * (next->x - prev->x) + (next->y - prev->y) * (next->y - prev->y) );
-            assert(norm != 0);
-            dx = -( (next->y - prev->y) / norm );
-            dy = ( (next->x - prev->x) / norm );
-            p2 = *cur;
-
-            if (!clockWise) {
-                p2.x -= dx * absFeatherDist;
-                p2.y -= dy * absFeatherDist;
-            } else {
-                p2.x += dx * absFeatherDist;
-                p2.y += dy * absFeatherDist;
-            }
-        } else {
-            p2 = origin;
-        }
-        featherContour.push_back(p2);
-        
-        ///linear interpolation
-        p0p1.x = (p0.x * fallOff * 2. + fallOffInverse * p1.x) / (fallOff * 2. + fallOffInverse);
-        p0p1.y = (p0.y * fallOff * 2. + fallOffInverse * p1.y) / (fallOff * 2. + fallOffInverse);
-        p1p0.x = (p0.x * fallOff + 2. * fallOffInverse * p1.x) / (fallOff + 2. * fallOffInverse);
-        p1p0.y = (p0.y * fallOff + 2. * fallOffInverse * p1.y) / (fallOff + 2. * fallOffInverse);
-
-        
-        p2p3.x = (p3.x * fallOff + 2. * fallOffInverse * p2.x) / (fallOff + 2. * fallOffInverse);
-        p2p3.y = (p3.y * fallOff + 2. * fallOffInverse * p2.y) / (fallOff + 2. * fallOffInverse);
-        p3p2.x = (p3.x * fallOff * 2. + fallOffInverse * p2.x) / (fallOff * 2. + fallOffInverse);
-        p3p2.y = (p3.y * fallOff * 2. + fallOffInverse * p2.y) / (fallOff * 2. + fallOffInverse);
-
-        
-        ///move to the initial point
-        cairo_mesh_pattern_begin_patch(mesh);
-        cairo_mesh_pattern_move_to(mesh, p0.x, p0.y);
-        cairo_mesh_pattern_curve_to(mesh, p0p1.x, p0p1.y, p1p0.x, p1p0.y, p1.x, p1.y);
-        cairo_mesh_pattern_line_to(mesh, p2.x, p2.y);
-        cairo_mesh_pattern_curve_to(mesh, p2p3.x, p2p3.y, p3p2.x, p3p2.y, p3.x, p3.y);
-        cairo_mesh_pattern_line_to(mesh, p0.x, p0.y);
-        ///Set the 4 corners color
-        ///inner is full color
-        
-        // IMPORTANT NOTE:
-        // The two sqrt below are due to a probable cairo bug.
-        // To check wether the bug is present is a given cairo version,
-        // make any shape with a very large feather and set
-        // opacity to 0.5. Then, zoom on the polygon border to check if the intensity is continuous
-        // and approximately equal to 0.5.
-        // If the bug if ixed in cairo, please use #if CAIRO_VERSION>xxx to keep compatibility with
-        // older Cairo versions.
-        cairo_mesh_pattern_set_corner_color_rgba( mesh, 0, shapeColor[0], shapeColor[1], shapeColor[2],
-                                                 std::sqrt(inverted ? 0. : 1.) );
-        ///outter is faded
-        cairo_mesh_pattern_set_corner_color_rgba(mesh, 1, shapeColor[0], shapeColor[1], shapeColor[2],
-                                                 inverted ? 1. : 0.);
-        cairo_mesh_pattern_set_corner_color_rgba(mesh, 2, shapeColor[0], shapeColor[1], shapeColor[2],
-                                                 inverted ? 1. : 0.);
-        ///inner is full color
-        cairo_mesh_pattern_set_corner_color_rgba(mesh, 3, shapeColor[0], shapeColor[1], shapeColor[2],
-                                                 std::sqrt(inverted ? 0. : 1.));
-        assert(cairo_pattern_status(mesh) == CAIRO_STATUS_SUCCESS);
-        
-        cairo_mesh_pattern_end_patch(mesh);
-        
-        if (mustStop) {
-            break;
-        }
-        
-        p1 = p2;
-
-        // increment for next iteration
-        // ++prev, ++next, ++bezIT, ++prevBez
-        if (prev != featherPolygon.end()) {
-            ++prev;
-        }
-        if (next != featherPolygon.end()) {
-            ++next;
-        }
-        if (bezIT != bezierPolygon.end()) {
-            ++bezIT;
-        }
-        if (prevBez != bezierPolygon.end()) {
-            ++prevBez;
-        }
-
-    }  // for each point in polygon
-
-}
-
-void
-RotoContextPrivate::renderInternalShape(double time,
-                                        unsigned int mipmapLevel,
-                                        double /*shapeColor*/[3],
-                                        double /*opacity*/,
-                                        const Transform::Matrix3x3& transform,
-                                        cairo_t* cr,
-#ifdef ROTO_USE_MESH_PATTERN_ONLY
-                                        cairo_pattern_t* mesh,
-#else
-                                        cairo_pattern_t* /*mesh*/,
-#endif
-                                        const BezierCPs & cps)
-{
-    assert(!cps.empty());
-#ifdef ROTO_USE_MESH_PATTERN_ONLY
-    std::list<BezierCPs> coonPatches;
-    bezulate(time, cps, &coonPatches);
-    
-    for (std::list<BezierCPs>::iterator it = coonPatches.begin(); it != coonPatches.end(); ++it) {
-        
-        std::list<BezierCPs> fixedPatch;
-        CoonsRegularization::regularize(*it, time, &fixedPatch);
-        for (std::list<BezierCPs>::iterator it2 = fixedPatch.begin(); it2 != fixedPatch.end(); ++it2) {
-            
-            
-            
-            std::size_t size = it2->size();
-            assert(size <= 4 && size >= 2);
-            
-            BezierCPs::iterator patchIT = it2->begin();
-            boost::shared_ptr<BezierCP> p0ptr,p1ptr,p2ptr,p3ptr;
-            p0ptr = *patchIT;
-            ++patchIT;
-            if (size == 2) {
-                p1ptr = p0ptr;
-                p2ptr = *patchIT;
-                p3ptr = p2ptr;
-            } else if (size == 3) {
-                p1ptr = *patchIT;
-                p2ptr = *patchIT;
-                ++patchIT;
-                p3ptr = *patchIT;
-            } else if (size == 4) {
-                p1ptr = *patchIT;
-                ++patchIT;
-                p2ptr = *patchIT;
-                ++patchIT;
-                p3ptr = *patchIT;
-            }
-            assert(p0ptr && p1ptr && p2ptr && p3ptr);
-            
-            Point p0,p0p1,p1p0,p1,p1p2,p2p1,p2p3,p3p2,p2,p3,p3p0,p0p3;
-            
-            p0ptr->getLeftBezierPointAtTime(time, &p0p3.x, &p0p3.y);
-            p0ptr->getPositionAtTime(time, &p0.x, &p0.y);
-            p0ptr->getRightBezierPointAtTime(time, &p0p1.x, &p0p1.y);
-            
-            p1ptr->getLeftBezierPointAtTime(time, &p1p0.x, &p1p0.y);
-            p1ptr->getPositionAtTime(time, &p1.x, &p1.y);
-            p1ptr->getRightBezierPointAtTime(time, &p1p2.x, &p1p2.y);
-            
-            p2ptr->getLeftBezierPointAtTime(time, &p2p1.x, &p2p1.y);
-            p2ptr->getPositionAtTime(time, &p2.x, &p2.y);
-            p2ptr->getRightBezierPointAtTime(time, &p2p3.x, &p2p3.y);
-            
-            p3ptr->getLeftBezierPointAtTime(time, &p3p2.x, &p3p2.y);
-            p3ptr->getPositionAtTime(time, &p3.x, &p3.y);
-            p3ptr->getRightBezierPointAtTime(time, &p3p0.x, &p3p0.y);
-            
-            
-            adjustToPointToScale(mipmapLevel, p0.x, p0.y);
-            adjustToPointToScale(mipmapLevel, p0p1.x, p0p1.y);
-            adjustToPointToScale(mipmapLevel, p1p0.x, p1p0.y);
-            adjustToPointToScale(mipmapLevel, p1.x, p1.y);
-            adjustToPointToScale(mipmapLevel, p1p2.x, p1p2.y);
-            adjustToPointToScale(mipmapLevel, p2p1.x, p2p1.y);
-            adjustToPointToScale(mipmapLevel, p2.x, p2.y);
-            adjustToPointToScale(mipmapLevel, p2p3.x, p2p3.y);
-            adjustToPointToScale(mipmapLevel, p3p2.x, p3p2.y);
-            adjustToPointToScale(mipmapLevel, p3.x, p3.y);
-            adjustToPointToScale(mipmapLevel, p3p0.x, p3p0.y);
-            adjustToPointToScale(mipmapLevel, p0p3.x, p0p3.y);
-            
-            
-            /*
-             Add a Coons patch such as:
-             
-             C1  Side 1   C2
-             +---------------+
-             |               |
-             |  P1       P2  |
-             |               |
-             Side 0 |               | Side 2
-             |               |
-             |               |
-             |  P0       P3  |
-             |               |
-             +---------------+
-             C0     Side 3   C3
-             
-             In the above drawing, C0 is p0, P0 is p0p1, P1 is p1p0, C1 is p1 and so on...
-             */
-            
-            ///move to C0
-            cairo_mesh_pattern_begin_patch(mesh);
-            cairo_mesh_pattern_move_to(mesh, p0.x, p0.y);
-            if (size == 4) {
-                cairo_mesh_pattern_curve_to(mesh, p0p1.x, p0p1.y, p1p0.x, p1p0.y, p1.x, p1.y);
-                cairo_mesh_pattern_curve_to(mesh, p1p2.x, p1p2.y, p2p1.x, p2p1.y, p2.x, p2.y);
-                cairo_mesh_pattern_curve_to(mesh, p2p3.x, p2p3.y, p3p2.x, p3p2.y, p3.x, p3.y);
-                cairo_mesh_pattern_curve_to(mesh, p3p0.x, p3p0.y, p0p3.x, p0p3.y, p0.x, p0.y);
-            } else if (size == 3) {
-                cairo_mesh_pattern_curve_to(mesh, p0p1.x, p0p1.y, p1p0.x, p1p0.y, p1.x, p1.y);
-                cairo_mesh_pattern_line_to(mesh, p2.x, p2.y);
-                cairo_mesh_pattern_curve_to(mesh, p2p3.x, p2p3.y, p3p2.x, p3p2.y, p3.x, p3.y);
-                cairo_mesh_pattern_curve_to(mesh, p3p0.x, p3p0.y, p0p3.x, p0p3.y, p0.x, p0.y);
-            } else {
-                assert(size == 2);
-                cairo_mesh_pattern_line_to(mesh, p1.x, p1.y);
-                cairo_mesh_pattern_curve_to(mesh, p1p2.x, p1p2.y, p2p1.x, p2p1.y, p2.x, p2.y);
-                cairo_mesh_pattern_line_to(mesh, p3.x, p3.y);
-                cairo_mesh_pattern_curve_to(mesh, p3p0.x, p3p0.y, p0p3.x, p0p3.y, p0.x, p0.y);
-            }
-            ///Set the 4 corners color
-            
-            // IMPORTANT NOTE:
-            // The two sqrt below are due to a probable cairo bug.
-            // To check wether the bug is present is a given cairo version,
-            // make any shape with a very large feather and set
-            // opacity to 0.5. Then, zoom on the polygon border to check if the intensity is continuous
-            // and approximately equal to 0.5.
-            // If the bug if ixed in cairo, please use #if CAIRO_VERSION>xxx to keep compatibility with
-            // older Cairo versions.
-            cairo_mesh_pattern_set_corner_color_rgba( mesh, 0, shapeColor[0], shapeColor[1], shapeColor[2],
-                                                     std::sqrt(opacity) );
-            cairo_mesh_pattern_set_corner_color_rgba(mesh, 1, shapeColor[0], shapeColor[1], shapeColor[2],
-                                                     opacity);
-            cairo_mesh_pattern_set_corner_color_rgba(mesh, 2, shapeColor[0], shapeColor[1], shapeColor[2],
-                                                     opacity);
-            cairo_mesh_pattern_set_corner_color_rgba(mesh, 3, shapeColor[0], shapeColor[1], shapeColor[2],
-                                                     std::sqrt(opacity));
-            assert(cairo_pattern_status(mesh) == CAIRO_STATUS_SUCCESS);
-            
-            cairo_mesh_pattern_end_patch(mesh);
-            
-        }
-    }
-#else
-    
-    cairo_set_source_rgba(cr, 1, 1, 1, 1);
-    
-    BezierCPs::const_iterator point = cps.begin();
-    assert(point != cps.end());
-    if (point == cps.end()) {
+    if ( featherPolygon.empty() || bezierPolygon.empty() ) {
+        image->fillZero(roi);
         return;
     }
-    BezierCPs::const_iterator nextPoint = point;
-    if (nextPoint != cps.end()) {
-        ++nextPoint;
-    }
-
     
-    Transform::Point3D initCp;
-    (*point)->getPositionAtTime(false,time, /*view*/0,&initCp.x,&initCp.y);
-    initCp.z = 1.;
-    initCp = Transform::matApply(transform, initCp);
+    bool clockWise = bezier->isFeatherPolygonClockwiseOriented(false,time);
     
-    adjustToPointToScale(mipmapLevel,initCp.x,initCp.y);
-
-    cairo_move_to(cr, initCp.x,initCp.y);
-
-    while ( point != cps.end() ) {
-        if ( nextPoint == cps.end() ) {
-            nextPoint = cps.begin();
-        }
-        
-        Transform::Point3D right,nextLeft,next;
-        (*point)->getRightBezierPointAtTime(false,time, /*view*/0,&right.x, &right.y);
-        right.z = 1;
-        (*nextPoint)->getLeftBezierPointAtTime(false,time, /*view*/0,&nextLeft.x, &nextLeft.y);
-        nextLeft.z = 1;
-        (*nextPoint)->getPositionAtTime(false,time, /*view*/0,&next.x, &next.y);
-        next.z = 1;
-
-        right = Transform::matApply(transform, right);
-        nextLeft = Transform::matApply(transform, nextLeft);
-        next = Transform::matApply(transform, next);
-        
-        adjustToPointToScale(mipmapLevel,right.x,right.y);
-        adjustToPointToScale(mipmapLevel,next.x,next.y);
-        adjustToPointToScale(mipmapLevel,nextLeft.x,nextLeft.y);
-        cairo_curve_to(cr, right.x, right.y, nextLeft.x, nextLeft.y, next.x, next.y);
-
-        // increment for next iteration
-        ++point;
-        if (nextPoint != cps.end()) {
-            ++nextPoint;
-        }
-    } // while()
-//    if (cairo_get_antialias(cr) != CAIRO_ANTIALIAS_NONE ) {
-//        cairo_fill_preserve(cr);
-//        // These line properties make for a nicer looking polygon mesh
-//        cairo_set_line_join(cr, CAIRO_LINE_JOIN_BEVEL);
-//        cairo_set_line_cap(cr, CAIRO_LINE_CAP_BUTT);
-//        // Comment out the following call to cairo_set_line width
-//        // since the hard-coded width value of 1.0 is not appropriate
-//        // for fills of small areas. Instead, use the line width that
-//        // has already been set by the user via the above call of
-//        // poly_line which in turn calls set_current_context which in
-//        // turn calls cairo_set_line_width for the user-specified
-//        // width.
-//        cairo_set_line_width(cr, 1.0);
-//        cairo_stroke(cr);
-//    } else {
-    cairo_fill(cr);
-//    }
-#endif
+    std::vector<RotoRasterizer::FeatherQuad> quads;
+    RotoRasterizer::computeFeatherQuads(featherPolygon, bezierPolygon, clockWise, featherDist, &quads);
+    
+    std::vector<Point> polygon(bezierPolygon.begin(), bezierPolygon.end());
+    RotoRasterizer::renderShape(polygon, quads, fallOff, shapeColor, opacity, roi, image);
 }
 
 struct qpointf_compare_less
@@ -3843,19 +3444,6 @@ RotoContextPrivate::bezulate(double time, const BezierCPs& cps,std::list<BezierC
     }
 }
 
-void
-RotoContextPrivate::applyAndDestroyMask(cairo_t* cr,
-                                        cairo_pattern_t* mesh)
-{
-    assert(cairo_pattern_status(mesh) == CAIRO_STATUS_SUCCESS);
-    cairo_set_source(cr, mesh);
-
-    ///paint with the feather with the pattern as a mask
-    cairo_mask(cr, mesh);
-
-    cairo_pattern_destroy(mesh);
-}
-
 void
 RotoContext::changeItemScriptName(const std::string& oldFullyQualifiedName,const std::string& newFullyQUalifiedName)
 {
@@ -68,6 +68,9 @@
 #define ROTO_DEFAULT_COLOR_G 1.
 #define ROTO_DEFAULT_COLOR_B 1.
 
+///Number of evaluations of a Bezier kept in its cache, the least recently used ones are dropped first
+#define NATRON_BEZIER_EVALUATION_CACHE_SIZE 16
+
 
 #define kRotoScriptNameHint "Script-name of the item for Python scripts. It cannot be edited."
 
@@ -350,6 +353,65 @@
 
 NATRON_NAMESPACE_ENTER;
 
+/**
+ * @brief An evaluation of a Bezier at a given time, cached until its points or their animation change.
+ * An evaluation is identified by all the parameters it depends on, including the transform of the item and the
+ * offsets of the tracks the points are slaved to at that time, so that the transform and the tracks may change
+ * without invalidating the cache.
+ **/
+struct BezierEvaluation
+{
+    enum TypeEnum
+    {
+        eTypePolygon = 0, //< the points of evaluateAtTime_DeCasteljau
+        eTypeFeatherPolygon, //< the points of evaluateFeatherPointsAtTime_DeCasteljau, without the segments equal to the control points
+        eTypeFeatherPolygonAllSegments, //< the points of evaluateFeatherPointsAtTime_DeCasteljau, with all the segments
+        eTypeBoundingBox, //< the bounding box of the control points and feather points segments
+        eTypeControlPoints, //< the transformed positions of the control points
+        eTypeFeatherPoints //< the transformed positions of the feather points
+    };
+    
+    TypeEnum type;
+    bool useGuiCurves;
+    double time;
+    unsigned int mipMapLevel;
+    int nbPointsPerSegment;
+    Transform::Matrix3x3 transform;
+    std::vector<double> trackOffsets; //< for each slaved point: its index and the x and y offsets of its track
+    
+    std::vector<Point> points;
+    RectD bbox;
+    
+    BezierEvaluation(TypeEnum type,
+                     bool useGuiCurves,
+                     double time,
+                     unsigned int mipMapLevel,
+                     int nbPointsPerSegment,
+                     const Transform::Matrix3x3& transform)
+    : type(type)
+    , useGuiCurves(useGuiCurves)
+    , time(time)
+    , mipMapLevel(mipMapLevel)
+    , nbPointsPerSegment(nbPointsPerSegment)
+    , transform(transform)
+    , trackOffsets()
+    , points()
+    , bbox()
+    {
+        bbox.setupInfinity();
+    }
+    
+    bool hasSameKey(const BezierEvaluation& other) const
+    {
+        return type == other.type && useGuiCurves == other.useGuiCurves && time == other.time &&
+        mipMapLevel == other.mipMapLevel && nbPointsPerSegment == other.nbPointsPerSegment &&
+        transform.a == other.transform.a && transform.b == other.transform.b && transform.c == other.transform.c &&
+        transform.d == other.transform.d && transform.e == other.transform.e && transform.f == other.transform.f &&
+        transform.g == other.transform.g && transform.h == other.transform.h && transform.i == other.transform.i &&
+        trackOffsets == other.trackOffsets;
+    }
+};
+
 struct BezierPrivate
 {
     BezierCPs points; //< the control points of the curve
@@ -372,6 +434,12 @@ struct BezierPrivate
     mutable QMutex guiCopyMutex;
     bool mustCopyGui;
     
+    ///The most recently used evaluations come first. evaluationsAge is incremented by each invalidation,
+    ///so that an evaluation computed while the points were changed is not cached
+    mutable QMutex evaluationsMutex;
+    mutable std::list<BezierEvaluation> evaluations;
+    U64 evaluationsAge;
+    
     BezierPrivate(bool isOpenBezier)
     : points()
     , featherPoints()
@@ -384,6 +452,9 @@ struct BezierPrivate
     , isOpenBezier(isOpenBezier)
     , guiCopyMutex()
     , mustCopyGui(false)
+    , evaluationsMutex()
+    , evaluations()
+    , evaluationsAge(0)
     {
     }
     
@@ -392,6 +463,66 @@ struct BezierPrivate
         QMutexLocker k(&guiCopyMutex);
         mustCopyGui = copy;
     }
+    
+    /**
+     * @brief If an evaluation with the same key as eval is cached, copies it to eval and returns true.
+     * Otherwise returns false and the age of the cache, to be given to insertEvaluation.
+     **/
+    bool findEvaluation(BezierEvaluation* eval, U64* age) const
+    {
+        QMutexLocker k(&evaluationsMutex);
+        for (std::list<BezierEvaluation>::iterator it = evaluations.begin(); it != evaluations.end(); ++it) {
+            if ( it->hasSameKey(*eval) ) {
+                evaluations.splice(evaluations.begin(), evaluations, it);
+                eval->points = evaluations.front().points;
+                eval->bbox = evaluations.front().bbox;
+                
+                return true;
+            }
+        }
+        *age = evaluationsAge;
+        
+        return false;
+    }
+    
+    void insertEvaluation(const BezierEvaluation& eval, U64 age) const
+    {
+        QMutexLocker k(&evaluationsMutex);
+        if (age != evaluationsAge) {
+            return;
+        }
+        evaluations.push_front(eval);
+        if (evaluations.size() > NATRON_BEZIER_EVALUATION_CACHE_SIZE) {
+            evaluations.pop_back();
+        }
+    }
+    
+    ///Fills the offsets of the tracks of the slaved points at the given time, part of the key of the evaluations
+    void getTrackOffsetsAtTime(double time, std::vector<double>* offsets) const
+    {
+        // PRIVATE - should not lock
+        offsets->clear();
+        int index = 0;
+        const BezierCPs* cps[2] = { &points, &featherPoints };
+        for (int i = 0; i < 2; ++i) {
+            for (BezierCPs::const_iterator it = cps[i]->begin(); it != cps[i]->end(); ++it, ++index) {
+                double x, y;
+                if ( (*it)->getMasterTrackOffsetAtTime(time, /*view*/0, &x, &y) ) {
+                    offsets->push_back(index);
+                    offsets->push_back(x);
+                    offsets->push_back(y);
+                }
+            }
+        }
+    }
+
+    ///Must be called after the points or their animation changed
+    void invalidateEvaluations()
+    {
+        QMutexLocker k(&evaluationsMutex);
+        evaluations.clear();
+        ++evaluationsAge;
+    }
 
     bool hasKeyframeAtTime(bool useGuiCurves, double time) const
     {
@@ -444,22 +575,19 @@ struct BezierPrivate
         return it;
     }
 
-    BezierCPs::const_iterator findControlPointNearby(double x,
-                                                     double y,
-                                                     double acceptance,
-                                                     double time,
-                                                     int view,
-                                                     const Transform::Matrix3x3& transform,
-                                                     int* index) const
+    static BezierCPs::const_iterator findPointNearby(const BezierCPs& cps,
+                                                      const std::vector<Point>& positions,
+                                                      double x,
+                                                      double y,
+                                                      double acceptance,
+                                                      int* index)
     {
         // PRIVATE - should not lock
+        assert( positions.size() == cps.size() );
         int i = 0;
 
-        for (BezierCPs::const_iterator it = points.begin(); it != points.end(); ++it, ++i) {
-            Transform::Point3D p;
-            p.z = 1;
-            (*it)->getPositionAtTime(true, time, view, &p.x, &p.y);
-            p = Transform::matApply(transform, p);
+        for (BezierCPs::const_iterator it = cps.begin(); it != cps.end(); ++it, ++i) {
+            const Point& p = positions[i];
             if ( ( p.x >= (x - acceptance) ) && ( p.x <= (x + acceptance) ) && ( p.y >= (y - acceptance) ) && ( p.y <= (y + acceptance) ) ) {
                 *index = i;
 
@@ -467,33 +595,27 @@ struct BezierPrivate
             }
         }
 
-        return points.end();
+        return cps.end();
     }
 
-    BezierCPs::const_iterator findFeatherPointNearby(double x,
+    ///controlPositions are the positions of the control points evaluated with the gui curves, see BezierEvaluation::eTypeControlPoints
+    BezierCPs::const_iterator findControlPointNearby(double x,
                                                      double y,
                                                      double acceptance,
-                                                     double time,
-                                                     int view,
-                                                     const Transform::Matrix3x3& transform,
+                                                     const std::vector<Point>& controlPositions,
                                                      int* index) const
     {
-        // PRIVATE - should not lock
-        int i = 0;
-        
-        for (BezierCPs::const_iterator it = featherPoints.begin(); it != featherPoints.end(); ++it, ++i) {
-            Transform::Point3D p;
-            p.z = 1;
-            (*it)->getPositionAtTime(true, time, view, &p.x, &p.y);
-            p = Transform::matApply(transform, p);
-            if ( ( p.x >= (x - acceptance) ) && ( p.x <= (x + acceptance) ) && ( p.y >= (y - acceptance) ) && ( p.y <= (y + acceptance) ) ) {
-                *index = i;
-
-                return it;
-            }
-        }
+        return findPointNearby(points, controlPositions, x, y, acceptance, index);
+    }
 
-        return featherPoints.end();
+    ///featherPositions are the positions of the feather points evaluated with the gui curves, see BezierEvaluation::eTypeFeatherPoints
+    BezierCPs::const_iterator findFeatherPointNearby(double x,
+                                                     double y,
+                                                     double acceptance,
+                                                     const std::vector<Point>& featherPositions,
+                                                     int* index) const
+    {
+        return findPointNearby(featherPoints, featherPositions, x, y, acceptance, index);
     }
 };
 
@@ -1238,6 +1360,17 @@ struct RotoStrokeItemPrivate
     }
 };
 
+/**
+ * @brief A dot of a paint stroke, in pixel coordinates at the mipmap level of the render
+ **/
+struct StrokeDot
+{
+    Point center;
+    double pressure;
+    double internalRadius, externalRadius;
+    std::vector<std::pair<double, double> > opacityStops;
+};
+
 struct RotoContextPrivate
 {
     mutable QMutex rotoContextMutex;
@@ -2141,6 +2274,27 @@ struct RotoContextPrivate
                    double opacity);
 
     
+    /**
+     * @brief Computes the dots of the strokes without drawing them, and returns the distance to the next dot
+     * to continue the stroke from.
+     **/
+    double computeStrokeDots(const std::list<std::list<std::pair<Point,double> > >& strokes,
+                             double distToNext,
+                             const boost::shared_ptr<RotoDrawableItem>& stroke,
+                             double opacity,
+                             double time,
+                             unsigned int mipmapLevel,
+                             std::vector<StrokeDot>* dots);
+    
+    /**
+     * @brief Draws the dots with cr, skipping the ones that do not touch its target image.
+     **/
+    void renderDots(cairo_t* cr,
+                    std::vector<cairo_pattern_t*>& dotPatterns,
+                    const std::vector<StrokeDot>& dots,
+                    bool doBuildup,
+                    double opacity);
+    
     double renderStroke(cairo_t* cr,
                         std::vector<cairo_pattern_t*>& dotPatterns,
                         const std::list<std::list<std::pair<Point,double> > >& strokes,
@@ -2151,15 +2305,24 @@ struct RotoContextPrivate
                         double time,
                         unsigned int mipmapLevel);
     
-    void renderBezier(cairo_t* cr,const Bezier* bezier, double opacity, double time, unsigned int mipmapLevel);
+    /**
+     * @brief Draws the dots touching tile into a new cairo image covering it, returned in surface.
+     * surface is set to NULL if no dot touches the tile. This may be called concurrently for distinct tiles.
+     **/
+    void renderStrokeTile(const RectI& tile,
+                          cairo_format_t format,
+                          const std::vector<StrokeDot>* dots,
+                          bool doBuildup,
+                          double opacity,
+                          cairo_surface_t** surface);
     
-    void renderFeather(const Bezier* bezier,double time, unsigned int mipmapLevel, bool inverted, double shapeColor[3], double opacity, double featherDist, double fallOff, cairo_pattern_t* mesh);
-
-    void renderInternalShape(double time,unsigned int mipmapLevel,double shapeColor[3], double opacity,const Transform::Matrix3x3& transform, cairo_t* cr, cairo_pattern_t* mesh, const BezierCPs & cps);
+    /**
+     * @brief Renders the closed bezier in the roi of image with the RotoRasterizer, image must contain the roi.
+     * The roi is cleared if the bezier is not rendered.
+     **/
+    void renderBezier(const Bezier* bezier, double opacity, double time, unsigned int mipmapLevel, const RectI& roi, Image* image);
     
     static void bezulate(double time,const BezierCPs& cps,std::list<BezierCPs>* patches);
-
-    void applyAndDestroyMask(cairo_t* cr,cairo_pattern_t* mesh);
 };
 
 NATRON_NAMESPACE_EXIT;
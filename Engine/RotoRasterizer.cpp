@@ -0,0 +1,617 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "RotoRasterizer.h"
+
+#include <algorithm> // min, max
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_OFF
+// /usr/local/include/boost/bind/arg.hpp:37:9: warning: unused typedef 'boost_static_assert_typedef_37' [-Wunused-local-typedef]
+#include <boost/bind.hpp>
+GCC_DIAG_UNUSED_LOCAL_TYPEDEFS_ON
+
+#include "Engine/AppManager.h"
+#include "Engine/Half.h"
+#include "Engine/Image.h"
+#include "Engine/TaskScheduler.h"
+
+///Number of intervals of the table of the feather fall-off
+#define NATRON_ROTO_FALLOFF_TABLE_SIZE 1024
+
+///Coverages this close to 0 or 1 are rounding errors of the accumulation
+#define NATRON_ROTO_COVERAGE_EPSILON 1e-6
+
+NATRON_NAMESPACE_ENTER;
+
+namespace RotoRasterizer {
+
+void
+computeFeatherQuads(const std::list<Point>& featherPolygon,
+                    const std::list<Point>& bezierPolygon,
+                    bool clockWise,
+                    double featherDist,
+                    std::vector<FeatherQuad>* quads)
+{
+    assert( !featherPolygon.empty() && !bezierPolygon.empty() );
+    if ( featherPolygon.empty() || bezierPolygon.empty() ) {
+        return;
+    }
+
+    // prepare iterators
+    std::list<Point>::const_iterator next = featherPolygon.begin();
+    ++next;  // can only be valid since we checked the list is not empty
+    if ( next == featherPolygon.end() ) {
+        next = featherPolygon.begin();
+    }
+    std::list<Point>::const_iterator prev = featherPolygon.end();
+    --prev; // can only be valid since we checked the list is not empty
+    std::list<Point>::const_iterator bezIT = bezierPolygon.begin();
+    std::list<Point>::const_iterator prevBez = bezierPolygon.end();
+    --prevBez; // can only be valid since we checked the list is not empty
+
+    // prepare p1
+    double absFeatherDist = std::abs(featherDist);
+    Point p1 = *featherPolygon.begin();
+    double norm = std::sqrt( (next->x - prev->x) * (next->x - prev->x) + (next->y - prev->y) * (next->y - prev->y) );
+    assert(norm != 0);
+    double dx = -( (next->y - prev->y) / norm );
+    double dy = ( (next->x - prev->x) / norm );
+
+    if (!clockWise) {
+        p1.x -= dx * absFeatherDist;
+        p1.y -= dy * absFeatherDist;
+    } else {
+        p1.x += dx * absFeatherDist;
+        p1.y += dy * absFeatherDist;
+    }
+
+    Point origin = p1;
+
+    // increment for first iteration
+    std::list<Point>::const_iterator cur = featherPolygon.begin();
+    ++cur;
+    ++prev;
+    ++next;
+    ++bezIT;
+    ++prevBez;
+
+    for (;; ++cur) { // for each point in polygon
+        if ( next == featherPolygon.end() ) {
+            next = featherPolygon.begin();
+        }
+        if ( prev == featherPolygon.end() ) {
+            prev = featherPolygon.begin();
+        }
+        if ( bezIT == bezierPolygon.end() ) {
+            bezIT = bezierPolygon.begin();
+        }
+        if ( prevBez == bezierPolygon.end() ) {
+            prevBez = bezierPolygon.begin();
+        }
+        bool mustStop = false;
+        if ( cur == featherPolygon.end() ) {
+            mustStop = true;
+            cur = featherPolygon.begin();
+        }
+
+        ///skip it
+        if ( (cur->x == prev->x) && (cur->y == prev->y) ) {
+            continue;
+        }
+
+        FeatherQuad q;
+        q.inner0 = *prevBez;
+        q.outer0 = p1;
+        q.inner1 = *bezIT;
+
+        if (!mustStop) {
+            norm = std::sqrt( (next->x - prev->x) * (next->x - prev->x) + (next->y - prev->y) * (next->y - prev->y) );
+            assert(norm != 0);
+            dx = -( (next->y - prev->y) / norm );
+            dy = ( (next->x - prev->x) / norm );
+            q.outer1 = *cur;
+
+            if (!clockWise) {
+                q.outer1.x -= dx * absFeatherDist;
+                q.outer1.y -= dy * absFeatherDist;
+            } else {
+                q.outer1.x += dx * absFeatherDist;
+                q.outer1.y += dy * absFeatherDist;
+            }
+        } else {
+            q.outer1 = origin;
+        }
+        quads->push_back(q);
+
+        if (mustStop) {
+            break;
+        }
+
+        p1 = q.outer1;
+
+        // increment for next iteration
+        ++prev;
+        ++next;
+        ++bezIT;
+        ++prevBez;
+    }  // for each point in polygon
+} // computeFeatherQuads
+
+double
+featherFallOffValue(double x,
+                    double fallOff)
+{
+    /*
+     * The sides of the feather patches going from the shape to the feather contour were cubic curves with their control points
+     * at the fractions a and b of the side, while the opacity was linear in the parameter t of the curves.
+     * The point at t is at the fraction x(t) of the side, we find t by bisection since x is increasing (a <= b).
+     * The patches were used both as the source and the mask of the compositing, hence the square.
+     */
+    x = std::max( 0., std::min(x, 1.) );
+    const double a = 1. / (2. * fallOff * fallOff + 1.);
+    const double b = 2. / (fallOff * fallOff + 2.);
+    double t0 = 0.;
+    double t1 = 1.;
+    for (int i = 0; i < 40; ++i) {
+        const double t = (t0 + t1) / 2.;
+        const double xt = 3. * a * t * (1. - t) * (1. - t) + 3. * b * t * t * (1. - t) + t * t * t;
+        if (xt < x) {
+            t0 = t;
+        } else {
+            t1 = t;
+        }
+    }
+    const double t = (t0 + t1) / 2.;
+
+    return (1. - t) * (1. - t);
+}
+} // namespace RotoRasterizer
+
+namespace {
+
+///A feather quad in the coordinates of the roi, with its bounding box
+struct LocalQuad
+{
+    Point a, b, c, d;
+    double x1, y1, x2, y2;
+};
+
+struct ShapeRenderArgs
+{
+    std::vector<Point> polygon;
+    std::vector<LocalQuad> quads;
+    std::vector<double> fallOffTable;
+    int width, height;
+    int nComps;
+    double color[3];
+    double opacity;
+    unsigned char* pixels; // pixel (roi.x1, roi.y1)
+    std::size_t rowBytes;
+};
+
+/*
+ * The fill accumulates, for each pixel of a row, the change of the signed area covered by the edges of the polygon
+ * between this pixel and the previous one: the coverage of a pixel is the sum of the accumulation up to it.
+ * Rows have 2 more cells than the roi, for the edges on its right border.
+ */
+static void
+accumulateLine(Point p0,
+               Point p1,
+               int width,
+               int bandY1,
+               int bandY2,
+               double* acc)
+{
+    if (p0.y == p1.y) {
+        return;
+    }
+    double dir = 1.;
+    if (p0.y > p1.y) {
+        std::swap(p0, p1);
+        dir = -1.;
+    }
+    const double dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+    const int yStart = std::max( (int)std::floor(p0.y), bandY1 );
+    const int yEnd = std::min( (int)std::ceil(p1.y), bandY2 );
+    for (int y = yStart; y < yEnd; ++y) {
+        const double ya = std::max( (double)y, p0.y );
+        const double yb = std::min( (double)(y + 1), p1.y );
+        if (yb <= ya) {
+            continue;
+        }
+        const double xa = std::max( 0., std::min(p0.x + (ya - p0.y) * dxdy, (double)width) );
+        const double xb = std::max( 0., std::min(p0.x + (yb - p0.y) * dxdy, (double)width) );
+        const double d = (yb - ya) * dir;
+        double* row = acc + (std::size_t)(y - bandY1) * (width + 2);
+
+        const double x0 = std::min(xa, xb);
+        const double x1 = std::max(xa, xb);
+        const double x0floor = std::floor(x0);
+        const int x0i = (int)x0floor;
+        const double x1ceil = std::ceil(x1);
+        const int x1i = (int)x1ceil;
+        if (x1i <= x0i + 1) {
+            // the line stays in one pixel, which it splits at the mean of its ends
+            const double xmf = 0.5 * (xa + xb) - x0floor;
+            row[x0i] += d - d * xmf;
+            row[x0i + 1] += d * xmf;
+        } else {
+            const double s = 1. / (x1 - x0);
+            const double x0f = x0 - x0floor;
+            const double a0 = 0.5 * s * (1. - x0f) * (1. - x0f);
+            const double x1f = x1 - x1ceil + 1.;
+            const double am = 0.5 * s * x1f * x1f;
+            row[x0i] += d * a0;
+            if (x1i == x0i + 2) {
+                row[x0i + 1] += d * (1. - a0 - am);
+            } else {
+                const double a1 = s * (1.5 - x0f);
+                row[x0i + 1] += d * (a1 - a0);
+                for (int xi = x0i + 2; xi < x1i - 1; ++xi) {
+                    row[xi] += d * s;
+                }
+                const double a2 = a1 + (x1i - x0i - 3) * s;
+                row[x1i - 1] += d * (1. - a2 - am);
+            }
+            row[x1i] += d * am;
+        }
+    }
+} // accumulateLine
+
+///Splits the line at the left and right borders of the roi: the parts on the left still cover all the pixels on their right
+///so they are moved on the left border, the parts on the right cover nothing.
+static void
+accumulateClippedLine(const Point& p0,
+                      const Point& p1,
+                      int width,
+                      int bandY1,
+                      int bandY2,
+                      double* acc)
+{
+    if ( (p0.y == p1.y) || (std::max(p0.y, p1.y) <= bandY1) || (std::min(p0.y, p1.y) >= bandY2) ) {
+        return;
+    }
+    double ts[4];
+    int nTs = 0;
+    ts[nTs++] = 0.;
+    const double borders[2] = { 0., (double)width };
+    for (int i = 0; i < 2; ++i) {
+        if ( (p0.x - borders[i]) * (p1.x - borders[i]) < 0. ) {
+            ts[nTs++] = (borders[i] - p0.x) / (p1.x - p0.x);
+        }
+    }
+    if ( (nTs == 3) && (ts[2] < ts[1]) ) {
+        std::swap(ts[1], ts[2]);
+    }
+    ts[nTs++] = 1.;
+
+    Point prev = p0;
+    for (int i = 1; i < nTs; ++i) {
+        Point p;
+        if (i == nTs - 1) {
+            p = p1;
+        } else {
+            p.x = p0.x + (p1.x - p0.x) * ts[i];
+            p.y = p0.y + (p1.y - p0.y) * ts[i];
+        }
+        Point a = prev;
+        Point b = p;
+        a.x = std::max( 0., std::min(a.x, (double)width) );
+        b.x = std::max( 0., std::min(b.x, (double)width) );
+        accumulateLine(a, b, width, bandY1, bandY2, acc);
+        prev = p;
+    }
+}
+
+///Finds the (u,v) in [0,1]x[0,1] such that p = a + u (b - a) + v (d - a) + u v (a - b + c - d) and returns v,
+///or returns false if p is outside the quad
+static bool
+invertBilinear(const LocalQuad& q,
+               double px,
+               double py,
+               double* v)
+{
+    const double eps = 1e-9;
+    const double ex = q.b.x - q.a.x;
+    const double ey = q.b.y - q.a.y;
+    const double fx = q.d.x - q.a.x;
+    const double fy = q.d.y - q.a.y;
+    const double gx = q.a.x - q.b.x + q.c.x - q.d.x;
+    const double gy = q.a.y - q.b.y + q.c.y - q.d.y;
+    const double hx = px - q.a.x;
+    const double hy = py - q.a.y;
+
+    // v is a root of k2 v^2 + k1 v + k0
+    const double k2 = gx * fy - gy * fx;
+    const double k1 = (ex * fy - ey * fx) + (hx * gy - hy * gx);
+    const double k0 = hx * ey - hy * ex;
+
+    double roots[2];
+    int nRoots = 0;
+    if ( std::abs(k2) <= eps * std::abs(k1) ) {
+        // the sides a-b and d-c are parallel
+        roots[nRoots++] = -k0 / k1;
+    } else {
+        const double w = k1 * k1 - 4. * k0 * k2;
+        if (w < 0.) {
+            return false;
+        }
+        // numerically stable roots
+        const double sq = std::sqrt(w);
+        const double r = -0.5 * ( k1 + (k1 < 0. ? -sq : sq) );
+        roots[nRoots++] = r / k2;
+        if (r != 0.) {
+            roots[nRoots++] = k0 / r;
+        }
+    }
+    for (int i = 0; i < nRoots; ++i) {
+        const double rv = roots[i];
+        if ( (rv < -eps) || (rv > 1. + eps) || (rv != rv) ) {
+            continue;
+        }
+        // u from the coordinate with the largest denominator
+        const double denx = ex + gx * rv;
+        const double deny = ey + gy * rv;
+        double u;
+        if ( std::abs(denx) >= std::abs(deny) ) {
+            if (denx == 0.) {
+                continue;
+            }
+            u = (hx - fx * rv) / denx;
+        } else {
+            u = (hy - fy * rv) / deny;
+        }
+        if ( (u >= -eps) && (u <= 1. + eps) ) {
+            *v = std::max( 0., std::min(rv, 1.) );
+
+            return true;
+        }
+    }
+
+    return false;
+} // invertBilinear
+
+static inline double
+lookupFallOff(const std::vector<double>& table,
+              double v)
+{
+    const double x = v * NATRON_ROTO_FALLOFF_TABLE_SIZE;
+    const int i = std::min( (int)x, NATRON_ROTO_FALLOFF_TABLE_SIZE - 1 );
+    const double f = x - i;
+
+    return table[i] + (table[i + 1] - table[i]) * f;
+}
+
+template <typename PIX, int maxValue>
+static void
+writeCoverageRow(const double* coverage,
+                 int width,
+                 const ShapeRenderArgs& args,
+                 PIX* dstPix)
+{
+    const int nComps = args.nComps;
+
+    for (int x = 0; x < width; ++x, dstPix += nComps) {
+        const double c = coverage[x];
+        switch (nComps) {
+        case 4:
+            dstPix[0] = PIX( (float)(c * args.color[0] * maxValue) );
+            dstPix[1] = PIX( (float)(c * args.color[1] * maxValue) );
+            dstPix[2] = PIX( (float)(c * args.color[2] * maxValue) );
+            dstPix[3] = PIX( (float)(c * args.opacity * maxValue) );
+            break;
+        case 3:
+            dstPix[0] = PIX( (float)(c * args.color[0] * maxValue) );
+            dstPix[1] = PIX( (float)(c * args.color[1] * maxValue) );
+            dstPix[2] = PIX( (float)(c * args.color[2] * maxValue) );
+            break;
+        case 2:
+            dstPix[0] = PIX( (float)(c * args.color[0] * maxValue) );
+            dstPix[1] = PIX( (float)(c * args.color[1] * maxValue) );
+            break;
+        case 1:
+            dstPix[0] = PIX( (float)(c * args.opacity * maxValue) );
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+///Renders a tile of the roi, given in the coordinates of the roi
+template <typename PIX, int maxValue>
+static void
+renderShapeTile(const ShapeRenderArgs* args,
+                const RectI& tile)
+{
+    const int width = tile.width();
+    const int height = tile.height();
+    const std::size_t rowSize = width + 2;
+    std::vector<double> acc(rowSize * height, 0.);
+    std::vector<double> feather(rowSize * height, 0.);
+
+    ///Fill the polygon: the edges above, below or on the right of the tile do not cover it
+    const std::vector<Point>& polygon = args->polygon;
+    for (std::size_t i = 0; i < polygon.size(); ++i) {
+        Point p0 = polygon[i];
+        Point p1 = (i + 1 == polygon.size()) ? polygon[0] : polygon[i + 1];
+        if ( (std::max(p0.y, p1.y) <= tile.y1) || (std::min(p0.y, p1.y) >= tile.y2) || (std::min(p0.x, p1.x) >= tile.x2) ) {
+            continue;
+        }
+        p0.x -= tile.x1;
+        p1.x -= tile.x1;
+        accumulateClippedLine(p0, p1, width, tile.y1, tile.y2, &acc[0]);
+    }
+
+    ///The feather value of each pixel is the largest of the quads containing its center
+    for (std::vector<LocalQuad>::const_iterator it = args->quads.begin(); it != args->quads.end(); ++it) {
+        const int qy1 = std::max( (int)std::ceil(it->y1 - 0.5), tile.y1 );
+        const int qy2 = std::min( (int)std::floor(it->y2 - 0.5) + 1, tile.y2 );
+        const int qx1 = std::max( (int)std::ceil(it->x1 - 0.5), tile.x1 );
+        const int qx2 = std::min( (int)std::floor(it->x2 - 0.5) + 1, tile.x2 );
+        for (int y = qy1; y < qy2; ++y) {
+            double* row = &feather[(y - tile.y1) * rowSize];
+            for (int x = qx1; x < qx2; ++x) {
+                double v;
+                if ( invertBilinear(*it, x + 0.5, y + 0.5, &v) ) {
+                    row[x - tile.x1] = std::max( row[x - tile.x1], lookupFallOff(args->fallOffTable, v) );
+                }
+            }
+        }
+    }
+
+    for (int y = 0; y < height; ++y) {
+        double* row = &acc[y * rowSize];
+        const double* featherRow = &feather[y * rowSize];
+        double sum = 0.;
+        for (int x = 0; x < width; ++x) {
+            sum += row[x];
+            // non-zero winding rule
+            double c = std::min(std::abs(sum), 1.);
+            if (c < NATRON_ROTO_COVERAGE_EPSILON) {
+                c = 0.;
+            } else if (c > 1. - NATRON_ROTO_COVERAGE_EPSILON) {
+                c = 1.;
+            }
+            // the feather is composited over the fill
+            row[x] = c + featherRow[x] - c * featherRow[x];
+        }
+        PIX* dstPix = (PIX*)(args->pixels + (tile.y1 + y) * args->rowBytes) + tile.x1 * args->nComps;
+        writeCoverageRow<PIX, maxValue>(row, width, *args, dstPix);
+    }
+} // renderShapeTile
+
+template <typename PIX, int maxValue>
+static void
+renderShapeForDepth(const ShapeRenderArgs& args)
+{
+    ///Large shapes are split in tiles rendered in parallel, each tile only visits the edges and the quads that touch it
+    const std::vector<RectI> tiles = RectI(0, 0, args.width, args.height).splitIntoSmallerRects(0);
+    TaskScheduler* scheduler = appPTR ? appPTR->getTaskScheduler() : 0;
+
+    if ( !scheduler || (scheduler->maxThreadCount() <= 1) || (tiles.size() <= 1) ) {
+        for (std::size_t i = 0; i < tiles.size(); ++i) {
+            renderShapeTile<PIX, maxValue>(&args, tiles[i]);
+        }
+    } else {
+        TaskGroup group(scheduler);
+        for (std::size_t i = 0; i < tiles.size(); ++i) {
+            group.run( boost::bind(&renderShapeTile<PIX, maxValue>, &args, tiles[i]) );
+        }
+        group.wait();
+    }
+}
+} // anon namespace
+
+void
+RotoRasterizer::renderShape(const std::vector<Point>& polygon,
+                            const std::vector<FeatherQuad>& quads,
+                            double fallOff,
+                            const double shapeColor[3],
+                            double opacity,
+                            const RectI& roi,
+                            Image* image)
+{
+    if ( roi.isNull() ) {
+        return;
+    }
+    assert( image->getBounds().contains(roi) );
+
+    ShapeRenderArgs args;
+    args.width = roi.width();
+    args.height = roi.height();
+    args.nComps = (int)image->getComponentsCount();
+    for (int i = 0; i < 3; ++i) {
+        args.color[i] = shapeColor[i] * opacity;
+    }
+    args.opacity = opacity;
+
+    ///Everything is expressed relative to the bottom left corner of the roi
+    args.polygon.resize( polygon.size() );
+    for (std::size_t i = 0; i < polygon.size(); ++i) {
+        args.polygon[i].x = polygon[i].x - roi.x1;
+        args.polygon[i].y = polygon[i].y - roi.y1;
+    }
+    args.quads.reserve( quads.size() );
+    for (std::vector<FeatherQuad>::const_iterator it = quads.begin(); it != quads.end(); ++it) {
+        LocalQuad q;
+        // u goes along the shape and v from the shape to the feather contour
+        q.a = it->inner0;
+        q.b = it->inner1;
+        q.c = it->outer1;
+        q.d = it->outer0;
+        const double area = (q.c.x - q.a.x) * (q.d.y - q.b.y) - (q.c.y - q.a.y) * (q.d.x - q.b.x);
+        if (std::abs(area) < 1e-9) {
+            // no feather
+            continue;
+        }
+        Point* pts[4] = { &q.a, &q.b, &q.c, &q.d };
+        q.x1 = q.y1 = std::numeric_limits<double>::infinity();
+        q.x2 = q.y2 = -std::numeric_limits<double>::infinity();
+        for (int i = 0; i < 4; ++i) {
+            pts[i]->x -= roi.x1;
+            pts[i]->y -= roi.y1;
+            q.x1 = std::min(q.x1, pts[i]->x);
+            q.x2 = std::max(q.x2, pts[i]->x);
+            q.y1 = std::min(q.y1, pts[i]->y);
+            q.y2 = std::max(q.y2, pts[i]->y);
+        }
+        args.quads.push_back(q);
+    }
+    args.fallOffTable.resize(NATRON_ROTO_FALLOFF_TABLE_SIZE + 1);
+    if ( !args.quads.empty() ) {
+        for (int i = 0; i <= NATRON_ROTO_FALLOFF_TABLE_SIZE; ++i) {
+            args.fallOffTable[i] = featherFallOffValue( (double)i / NATRON_ROTO_FALLOFF_TABLE_SIZE, fallOff );
+        }
+    }
+
+    ///The tiles write through this pointer while the access is held
+    Image::WriteAccess acc = image->getWriteRights();
+    args.pixels = acc.pixelAt(roi.x1, roi.y1);
+    args.rowBytes = (std::size_t)image->getBounds().width() * args.nComps * getSizeOfForBitDepth( image->getBitDepth() );
+    assert(args.pixels);
+
+    switch ( image->getBitDepth() ) {
+    case eImageBitDepthFloat:
+        renderShapeForDepth<float, 1>(args);
+        break;
+    case eImageBitDepthHalf:
+        renderShapeForDepth<Half, 1>(args);
+        break;
+    case eImageBitDepthByte:
+        renderShapeForDepth<unsigned char, 255>(args);
+        break;
+    case eImageBitDepthShort:
+        renderShapeForDepth<unsigned short, 65535>(args);
+        break;
+    case eImageBitDepthNone:
+        assert(false);
+        break;
+    }
+} // renderShape
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,88 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_ROTORASTERIZER_H
+#define NATRON_ENGINE_ROTORASTERIZER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#include <list>
+#include <vector>
+
+#include "Global/GlobalDefines.h"
+#include "Engine/RectI.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+namespace RotoRasterizer {
+
+/**
+ * @brief A quadrilateral of the feather of a shape: inner0 and inner1 are consecutive points of the polygon of the
+ * shape and outer0, outer1 the matching points of the feather contour. The feather fades from the inner edge
+ * to the outer edge, with a profile given by the fall-off of the shape.
+ **/
+struct FeatherQuad
+{
+    Point inner0, outer0, outer1, inner1;
+};
+
+/**
+ * @brief Builds the feather quads of a shape from the polygon of its feather points and the polygon of its control points,
+ * both evaluated with the same number of points per segment. The feather polygon is pushed by featherDist along its normals,
+ * so that the feather has the same thickness around the whole shape.
+ **/
+void computeFeatherQuads(const std::list<Point>& featherPolygon,
+                         const std::list<Point>& bezierPolygon,
+                         bool clockWise,
+                         double featherDist,
+                         std::vector<FeatherQuad>* quads);
+
+/**
+ * @brief The value of the feather at the fraction x of the distance from the inner edge (0) to the outer edge (1):
+ * this is the profile the cairo mesh patches used to have, whose control points are moved by the fall-off.
+ **/
+double featherFallOffValue(double x, double fallOff);
+
+/**
+ * @brief Renders a closed shape into the roi of image, which must be contained in its bounds:
+ * the polygon is filled with the non-zero winding rule, its edges anti-aliased by the exact area covered in each pixel,
+ * and the feather quads are composited over it. The coverage is written as the conversion of the cairo
+ * image used to be: the color channels get coverage * shapeColor * opacity and the alpha channel coverage * opacity.
+ * Where the shape overlaps itself, the coverage is only approximated in the pixels where its edges cross.
+ * Large rois are split in tiles rendered on the TaskScheduler, each tile only visits the edges and feather quads touching it.
+ **/
+void renderShape(const std::vector<Point>& polygon,
+                 const std::vector<FeatherQuad>& quads,
+                 double fallOff,
+                 const double shapeColor[3],
+                 double opacity,
+                 const RectI& roi,
+                 Image* image);
+
+} // namespace RotoRasterizer
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_ROTORASTERIZER_H
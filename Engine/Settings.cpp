@@ -51,6 +51,7 @@
 #include "Engine/Plugin.h"
 #include "Engine/Project.h"
 #include "Engine/StandardPaths.h"
+#include "Engine/TaskScheduler.h"
 #include "Engine/ViewIdx.h"
 #include "Engine/ViewerInstance.h"
 
@@ -233,6 +234,17 @@ Settings::initializeKnobsGeneral()
     _generalTab->addKnob(_numberOfParallelRenders);
 #endif
     
+    _autoThreadsBalancing = AppManager::createKnob<KnobBool>(this, "Balance parallel renders and tiles automatically");
+    _autoThreadsBalancing->setName("autoThreadsBalancing");
+    _autoThreadsBalancing->setAnimationEnabled(false);
+    _autoThreadsBalancing->setHintToolTip("When checked, the cores are shared between the frames rendered in parallel and the tiles "
+                                          "of each frame by measuring the render instead of using a fixed heuristic. "
+                                          "The number of parallel renders is adjusted during the render from the CPU activity "
+                                          "and the frames rendered per second, if the number of parallel renders above is 0. "
+                                          "Each node is rendered in tiles only as long as its tiles actually render faster "
+                                          "in parallel. This is most useful for long renders of sequences, e.g. on a render farm.");
+    _generalTab->addKnob(_autoThreadsBalancing);
+    
     _useThreadPool = AppManager::createKnob<KnobBool>(this, "Effects use thread-pool");
     _useThreadPool->setName("useThreadPool");
     _useThreadPool->setHintToolTip("When checked, all effects will use a global thread-pool to do their processing instead of launching "
@@ -258,6 +270,40 @@ Settings::initializeKnobsGeneral()
     _nThreadsPerEffect->setMinimum(0);
     _nThreadsPerEffect->disableSlider();
     _generalTab->addKnob(_nThreadsPerEffect);
+    
+    _parallelInputsRender = AppManager::createKnob<KnobBool>(this, "Render inputs in parallel");
+    _parallelInputsRender->setName("parallelInputsRender");
+    _parallelInputsRender->setAnimationEnabled(false);
+    _parallelInputsRender->setHintToolTip("When checked, the images needed by an effect from its different inputs (e.g. the A, B and mask "
+                                          "inputs of a Merge) and at different times (e.g. for a retime) are rendered at the same time "
+                                          "instead of one after another. They share the threads of the renderer with the tiles "
+                                          "of the images, so this does not start more threads than set above. "
+                                          "This helps when the upstream branches are long and made of effects that do not use "
+                                          "all the cores, but uses more memory as more images are alive at the same time.");
+    _generalTab->addKnob(_parallelInputsRender);
+    
+    _orderedWriterBufferFrames = AppManager::createKnob<KnobInt>(this, "Sequential writers buffer (frames, 0=\"guess\")");
+    _orderedWriterBufferFrames->setName("orderedWriterBufferFrames");
+    _orderedWriterBufferFrames->setAnimationEnabled(false);
+    _orderedWriterBufferFrames->setHintToolTip("Writers producing a single file (e.g. a movie) write the frames in order, while the "
+                                               "frames are rendered in parallel and out of order. This controls how many frames may be "
+                                               "rendered ahead of the frame being written: a deeper buffer keeps the render threads busy "
+                                               "when writing a frame is slow, but holds more images in memory. "
+                                               "By default (0) it is computed from the number of cores.");
+    _orderedWriterBufferFrames->setMinimum(0);
+    _orderedWriterBufferFrames->disableSlider();
+    _orderedWriterBufferFrames->setAddNewLine(false);
+    _generalTab->addKnob(_orderedWriterBufferFrames);
+    
+    _orderedWriterBufferMaxRAM = AppManager::createKnob<KnobInt>(this, "Max RAM (MB, 0=\"guess\")");
+    _orderedWriterBufferMaxRAM->setName("orderedWriterBufferMaxRAM");
+    _orderedWriterBufferMaxRAM->setAnimationEnabled(false);
+    _orderedWriterBufferMaxRAM->setHintToolTip("The memory the frames rendered ahead of a sequential writer may hold at most, in megabytes. "
+                                               "The buffer holds less frames than set above if they do not fit. "
+                                               "By default (0) this is the share of the cache RAM dedicated to playback.");
+    _orderedWriterBufferMaxRAM->setMinimum(0);
+    _orderedWriterBufferMaxRAM->disableSlider();
+    _generalTab->addKnob(_orderedWriterBufferMaxRAM);
 
     _renderInSeparateProcess = AppManager::createKnob<KnobBool>(this, "Render in a separate process");
     _renderInSeparateProcess->setName("renderNewProcess");
@@ -1092,6 +1138,17 @@ Settings::initializeKnobsCaching()
                                                                                                                            "which have multiple outputs, or their parameter \"Force caching\" checked or if one of its "
                                                                                                                            "output has its settings panel opened.");
     _cachingTab->addKnob(_aggressiveCaching);
+
+    _halfFloatCache = AppManager::createKnob<KnobBool>(this, "Store cached images as half-float");
+    _halfFloatCache->setName("halfFloatCache");
+    _halfFloatCache->setAnimationEnabled(false);
+    _halfFloatCache->setHintToolTip("When checked, the 32-bit floating point images rendered by the nodes are stored in the cache "
+                                    "as 16-bit half floats, which halves the memory they use so that twice as many images can be cached. "
+                                    "Plug-ins still render and receive images in 32-bit floating point.\n"
+                                    "Half floats have 11 bits of precision (about 3 decimal digits) and cannot represent values "
+                                    "above 65504, which is enough for images but not for data such as depth or motion vectors "
+                                    "of large magnitude.");
+    _cachingTab->addKnob(_halfFloatCache);
     
     _maxRAMPercent = AppManager::createKnob<KnobInt>(this, "Maximum amount of RAM memory used for caching (% of total RAM)");
     _maxRAMPercent->setName("maxRAMPercent");
@@ -1387,9 +1444,13 @@ Settings::setDefaultValues()
 #ifndef NATRON_PLAYBACK_USES_THREAD_POOL
     _numberOfParallelRenders->setDefaultValue(0,0);
 #endif
+    _autoThreadsBalancing->setDefaultValue(false);
     
     _useThreadPool->setDefaultValue(true);
     _nThreadsPerEffect->setDefaultValue(0);
+    _parallelInputsRender->setDefaultValue(false);
+    _orderedWriterBufferFrames->setDefaultValue(0);
+    _orderedWriterBufferMaxRAM->setDefaultValue(0);
     _renderInSeparateProcess->setDefaultValue(false,0);
     _autoPreviewEnabledForNewProjects->setDefaultValue(true,0);
     _firstReadSetProjectFormat->setDefaultValue(true);
@@ -1422,6 +1483,7 @@ Settings::setDefaultValues()
     _ocioStartupCheck->setDefaultValue(true);
 
     _aggressiveCaching->setDefaultValue(false);
+    _halfFloatCache->setDefaultValue(false);
     _maxRAMPercent->setDefaultValue(50,0);
     _maxPlayBackPercent->setDefaultValue(25,0);
     _unreachableRAMPercent->setDefaultValue(5);
@@ -1894,7 +1956,7 @@ Settings::restoreSettings()
         }
 
         appPTR->setNThreadsPerEffect(getNumberOfThreadsPerEffect());
-        appPTR->setNThreadsToRender(getNumberOfThreads());
+        appPTR->setNThreadsToRender( appPTR->getNumberOfThreads() );
         appPTR->setUseThreadPool(_useThreadPool->getValue());
     } catch (std::logic_error) {
         // ignore
@@ -2025,16 +2087,20 @@ Settings::onKnobValueChanged(KnobI* k,
     } else if ( k == _wipeDiskCache.get() ) {
         appPTR->wipeAndCreateDiskCacheStructure();
     } else if ( k == _numberOfThreads.get() ) {
-        int nbThreads = getNumberOfThreads();
+        ///The --threads option overrides the setting
+        int nbThreads = appPTR->getNumberOfThreads();
         appPTR->setNThreadsToRender(nbThreads);
+        int maxThreadCount;
         if (nbThreads == -1) {
-            QThreadPool::globalInstance()->setMaxThreadCount(1);
+            maxThreadCount = 1;
             appPTR->abortAnyProcessing();
         } else if (nbThreads == 0) {
-            QThreadPool::globalInstance()->setMaxThreadCount( QThread::idealThreadCount() );
+            maxThreadCount = QThread::idealThreadCount();
         } else {
-            QThreadPool::globalInstance()->setMaxThreadCount(nbThreads);
+            maxThreadCount = nbThreads;
         }
+        QThreadPool::globalInstance()->setMaxThreadCount(maxThreadCount);
+        appPTR->getTaskScheduler()->setMaxThreadCount(maxThreadCount);
     } else if ( k == _nThreadsPerEffect.get() ) {
         appPTR->setNThreadsPerEffect( getNumberOfThreadsPerEffect() );
     } else if ( k == _ocioConfigKnob.get() ) {
@@ -2972,6 +3038,12 @@ Settings::setNumberOfParallelRenders(int nb)
 #endif
 }
 
+bool
+Settings::isAutoThreadsBalancingEnabled() const
+{
+    return _autoThreadsBalancing->getValue();
+}
+
 bool
 Settings::areRGBPixelComponentsSupported() const
 {
@@ -2996,6 +3068,24 @@ Settings::setUseGlobalThreadPool(bool use)
     _useThreadPool->setValue(use);
 }
 
+bool
+Settings::isParallelInputsRenderEnabled() const
+{
+    return _parallelInputsRender->getValue();
+}
+
+int
+Settings::getOrderedWriterBufferFrames() const
+{
+    return _orderedWriterBufferFrames->getValue();
+}
+
+U64
+Settings::getOrderedWriterBufferMaxRAM() const
+{
+    return (U64)( _orderedWriterBufferMaxRAM->getValue() ) * 1024 * 1024;
+}
+
 bool
 Settings::isMergeAutoConnectingToAInput() const
 {
@@ -3082,6 +3172,12 @@ Settings::isAggressiveCachingEnabled() const
     return _aggressiveCaching->getValue();
 }
 
+bool
+Settings::isHalfFloatCacheEnabled() const
+{
+    return _halfFloatCache->getValue();
+}
+
 bool
 Settings::isAutoTurboEnabled() const
 {
@@ -117,11 +117,31 @@ public:
     
     void setNumberOfParallelRenders(int nb);
     
+    /**
+     * @brief When true, the number of parallel renders (if set to 0) and the use of tiles by each node are
+     * adjusted from measurements of the render.
+     **/
+    bool isAutoThreadsBalancingEnabled() const;
+    
     int getNumberOfThreadsPerEffect() const;
     
     bool useGlobalThreadPool() const;
     
     void setUseGlobalThreadPool(bool use) ;
+    
+    bool isParallelInputsRenderEnabled() const;
+    
+    /**
+     * @brief The number of frames that may be rendered ahead of the frame being written by a sequential writer,
+     * 0 meaning it is computed automatically.
+     **/
+    int getOrderedWriterBufferFrames() const;
+    
+    /**
+     * @brief The memory in bytes the frames rendered ahead of a sequential writer may hold, 0 meaning it is
+     * computed automatically.
+     **/
+    U64 getOrderedWriterBufferMaxRAM() const;
 
     std::string getReaderPluginIDForFileType(const std::string & extension);
     std::string getWriterPluginIDForFileType(const std::string & extension);
@@ -263,6 +283,8 @@ public:
     bool notifyOnFileChange() const;
     
     bool isAggressiveCachingEnabled() const;
+
+    bool isHalfFloatCacheEnabled() const;
     
     bool isAutoTurboEnabled() const;
     
@@ -385,8 +407,12 @@ private:
     boost::shared_ptr<KnobBool> _convertNaNValues;
     boost::shared_ptr<KnobInt> _numberOfThreads;
     boost::shared_ptr<KnobInt> _numberOfParallelRenders;
+    boost::shared_ptr<KnobBool> _autoThreadsBalancing;
     boost::shared_ptr<KnobBool> _useThreadPool;
     boost::shared_ptr<KnobInt> _nThreadsPerEffect;
+    boost::shared_ptr<KnobBool> _parallelInputsRender;
+    boost::shared_ptr<KnobInt> _orderedWriterBufferFrames;
+    boost::shared_ptr<KnobInt> _orderedWriterBufferMaxRAM;
     boost::shared_ptr<KnobBool> _renderInSeparateProcess;
     boost::shared_ptr<KnobBool> _autoPreviewEnabledForNewProjects;
     boost::shared_ptr<KnobBool> _firstReadSetProjectFormat;
@@ -409,6 +435,7 @@ private:
     boost::shared_ptr<KnobPage> _cachingTab;
 
     boost::shared_ptr<KnobBool> _aggressiveCaching;
+    boost::shared_ptr<KnobBool> _halfFloatCache;
     ///The percentage of the value held by _maxRAMPercent to dedicate to playback cache (viewer cache's in-RAM portion) only
     boost::shared_ptr<KnobInt> _maxPlayBackPercent;
     boost::shared_ptr<KnobString> _maxPlaybackLabel;
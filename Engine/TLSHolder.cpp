@@ -25,7 +25,9 @@
 #include "TLSHolder.h"
 #include "TLSHolderImpl.h"
 
+#include <algorithm> // swap
 #include <cassert>
+#include <set>
 #include <stdexcept>
 
 #include "Engine/OfxClipInstance.h"
@@ -33,18 +35,124 @@
 #include "Engine/OfxParamInstance.h"
 #include "Engine/Project.h"
 
-#include <QWaitCondition>
-#include <QThreadPool>
+#include <QMutex>
+#include <QReadWriteLock>
 #include <QThread>
-#include <QDebug>
+#include <QThreadStorage>
 
 NATRON_NAMESPACE_ENTER;
 
 
+namespace {
+
+//The slots allocated to the TLSHolders
+struct TLSSlotsAllocator
+{
+    QMutex lock;
+    std::size_t nSlots;
+    std::vector<std::size_t> freeSlots;
+    U64 lastSerial;
+    
+    TLSSlotsAllocator()
+    : lock()
+    , nSlots(0)
+    , freeSlots()
+    , lastSerial(0)
+    {
+    }
+};
+
+TLSSlotsAllocator slotsAllocator;
+
+//The TLS of the calling thread. It is owned by threadsData, which deletes it when the thread exits
+NATRON_THREAD_LOCAL ThreadTLSData* currentThreadData = 0;
+QThreadStorage<ThreadTLSData*> threadsData;
+
+//The TLS of all threads, used to release the values of a holder when it is destroyed
+typedef std::set<ThreadTLSData*> ThreadsDataSet;
+QReadWriteLock threadsSetLock;
+ThreadsDataSet threadsSet;
+
+//Copies the TLS of a thread for the threads it spawns. The values this thread did not access yet are those of
+//the snapshot of its own spawner.
+TLSSnapshotPtr
+makeSnapshot(const std::vector<ThreadTLSSlot>& slots, const TLSSnapshotPtr& spawner)
+{
+    boost::shared_ptr<TLSSnapshot> snapshot(new TLSSnapshot);
+    if (spawner) {
+        snapshot->slots = spawner->slots;
+    }
+    if ( snapshot->slots.size() < slots.size() ) {
+        snapshot->slots.resize( slots.size() );
+    }
+    for (std::size_t i = 0; i < slots.size(); ++i) {
+        const ThreadTLSSlot& slot = slots[i];
+        if (!slot.serial) {
+            continue;
+        }
+        ThreadTLSSlot& copy = snapshot->slots[i];
+        copy = ThreadTLSSlot();
+        if (slot.value && slot.copy) {
+            copy.value = slot.copy(slot.value);
+            if (copy.value) {
+                copy.serial = slot.serial;
+                copy.copy = slot.copy;
+            }
+        }
+    }
+    return snapshot;
+}
+
+} // anon namespace
+
+TLSHolderBase::TLSHolderBase()
+: _slot(0)
+, _serial(0)
+{
+    QMutexLocker k(&slotsAllocator.lock);
+    if ( !slotsAllocator.freeSlots.empty() ) {
+        _slot = slotsAllocator.freeSlots.back();
+        slotsAllocator.freeSlots.pop_back();
+    } else {
+        _slot = slotsAllocator.nSlots++;
+    }
+    _serial = ++slotsAllocator.lastSerial;
+}
+
+TLSHolderBase::~TLSHolderBase()
+{
+    //Release the values of this holder in the TLS of all threads before the slot can be reused by another holder.
+    //Only this slot is modified: the threads keep reading their other slots without locking.
+    //The values are destroyed outside of the locks.
+    std::vector<ThreadTLSSlot> oldValues;
+    {
+        QReadLocker k(&threadsSetLock);
+        for (ThreadsDataSet::iterator it = threadsSet.begin(); it != threadsSet.end(); ++it) {
+            ThreadTLSData* data = *it;
+            QMutexLocker l(&data->slotsMutex);
+            if ( ( _slot < data->slots.size() ) && (data->slots[_slot].serial == _serial) ) {
+                oldValues.push_back( ThreadTLSSlot() );
+                std::swap(oldValues.back(), data->slots[_slot]);
+            }
+        }
+    }
+    
+    QMutexLocker k(&slotsAllocator.lock);
+    slotsAllocator.freeSlots.push_back(_slot);
+}
+
+ThreadTLSData::~ThreadTLSData()
+{
+    {
+        QWriteLocker k(&threadsSetLock);
+        threadsSet.erase(this);
+    }
+    if (currentThreadData == this) {
+        currentThreadData = 0;
+    }
+}
+
 AppTLS::AppTLS()
-: _objectMutex()
-, _object(new GLobalTLSObject())
-, _spawns()
 {
 }
 
@@ -53,76 +161,90 @@ AppTLS::~AppTLS()
     
 }
 
-void
-AppTLS::registerTLSHolder(const boost::shared_ptr<const TLSHolderBase>& holder)
+ThreadTLSData*
+AppTLS::getCurrentThreadData()
 {
-    //This must be the first time for this thread that we reach here since cleanupTLSForThread() was made, otherwise
-    //the TLS data should always be available on the TLSHolder
-    {
-        QWriteLocker k(&_objectMutex);
-        //The insert call might not succeed because another thread inserted this holder in the set already, that's fine
-        _object->objects.insert(holder);
+    ThreadTLSData* data = currentThreadData;
+    if (data) {
+        return data;
     }
     
+    //First use of the TLS on this thread
+    data = new ThreadTLSData;
+    threadsData.setLocalData(data);
+    currentThreadData = data;
+    {
+        QWriteLocker k(&threadsSetLock);
+        threadsSet.insert(data);
+    }
+    return data;
 }
 
 void
-AppTLS::copyTLS(const QThread* fromThread,const QThread* toThread)
+AppTLS::setCurrentThreadData(ThreadTLSData* data, std::size_t slot, U64 serial, const boost::shared_ptr<void>& value, TLSCopyFunction copy)
 {
-    if (fromThread == toThread || !fromThread || !toThread) {
-        return;
-    }
-    QReadLocker k(&_objectMutex);
-    for (TLSObjects::iterator it = _object->objects.begin();
-         it!=_object->objects.end(); ++it) {
-        boost::shared_ptr<const TLSHolderBase> p = (*it).lock();
-        if (p) {
-            p->copyTLS(fromThread, toThread);
+    assert(data == currentThreadData);
+    ThreadTLSSlot old;
+    {
+        QMutexLocker k(&data->slotsMutex);
+        if ( slot >= data->slots.size() ) {
+            data->slots.resize(slot + 1);
         }
-    
+        std::swap(old, data->slots[slot]);
+        data->slots[slot].serial = serial;
+        data->slots[slot].value = value;
+        data->slots[slot].copy = copy;
+    }
+}
+
+TLSSnapshotPtr
+AppTLS::takeSnapshot() const
+{
+    const ThreadTLSData* data = currentThreadData;
+    if (!data) {
+        return TLSSnapshotPtr();
+    }
+    //A holder being destroyed releases its slot in the TLS of all threads: copy the slots under the lock, then
+    //copy the values outside of it
+    std::vector<ThreadTLSSlot> slots;
+    TLSSnapshotPtr spawner;
+    {
+        QMutexLocker k(&data->slotsMutex);
+        slots = data->slots;
+        spawner = data->spawner;
     }
+    return makeSnapshot(slots, spawner);
 }
 
 void
-AppTLS::softCopy(const QThread* fromThread,const QThread* toThread)
+AppTLS::copyTLS(const TLSSnapshotPtr& snapshot)
 {
-    if (fromThread == toThread || !fromThread || !toThread) {
+    if (!snapshot) {
         return;
     }
-    QWriteLocker k(&_objectMutex);
-    _spawns[toThread] = fromThread;
+    ThreadTLSData* data = getCurrentThreadData();
+    TLSSnapshotPtr old;
+    QMutexLocker k(&data->slotsMutex);
+    old = data->spawner;
+    data->spawner = snapshot;
 }
 
 void
 AppTLS::cleanupTLSForThread()
 {
+    ThreadTLSData* data = currentThreadData;
+    if (!data) {
+        //This thread never used TLS
+        return;
+    }
     
-    QThread* curThread = QThread::currentThread();
-
-    //Cleanup any cached data on the TLSHolder
+    //Destroy the values outside of the lock
+    std::vector<ThreadTLSSlot> slots;
+    TLSSnapshotPtr spawner;
     {
-        QWriteLocker k(&_objectMutex);
-        
-        //This thread was spawned, but TLS not used, do not bother to clean-up
-        ThreadSpawnMap::iterator foundSpawned = _spawns.find(curThread);
-        if (foundSpawned != _spawns.end()) {
-            _spawns.erase(foundSpawned);
-            return;
-        }
-        
-        TLSObjects newObjects;
-        for (TLSObjects::iterator it = _object->objects.begin();
-             it!=_object->objects.end(); ++it) {
-            boost::shared_ptr<const TLSHolderBase> p = (*it).lock();
-            if (p) {
-                if (!p->cleanupPerThreadData(curThread)) {
-                    //The TLSHolder still has TLS on it for another thread and is still alive,
-                    //then leave it in the set
-                    newObjects.insert(p);
-                }
-            }
-        }
-        _object->objects = newObjects;
+        QMutexLocker k(&data->slotsMutex);
+        slots.swap(data->slots);
+        spawner.swap(data->spawner);
     }
 }
 
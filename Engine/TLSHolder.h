@@ -42,13 +42,21 @@
 #endif
 
 
-#include <QReadWriteLock>
+#include <QMutex>
 #include <QThread>
 
 #include "Engine/EngineFwd.h"
 
 NATRON_NAMESPACE_ENTER;
 
+struct ThreadTLSData;
+struct TLSSnapshot;
+
+typedef boost::shared_ptr<const TLSSnapshot> TLSSnapshotPtr;
+
+///Returns the copy of a TLS value to give to a spawned thread, or NULL if the value is not copied, see TLSHolder::copyTLS
+typedef boost::shared_ptr<void> (*TLSCopyFunction)(const boost::shared_ptr<void>& value);
+
 ///This must be stored as a shared_ptr
 class TLSHolderBase : public boost::enable_shared_from_this<TLSHolderBase>
 {
@@ -57,22 +65,23 @@ class TLSHolderBase : public boost::enable_shared_from_this<TLSHolderBase>
 
 public:
     
-    TLSHolderBase() {}
-    
-    virtual ~TLSHolderBase() {}
-    
-protected:
-    
     /**
-     * @brief Must clean-up any data stored for the given thread 'curThread'
-     * @returns True if this object no longer holds any per-thread data
+     * @brief Allocates the slot of this holder in the TLS of the threads
      **/
-    virtual bool cleanupPerThreadData(const QThread* curThread) const = 0;
+    TLSHolderBase();
     
     /**
-     * @brief Copy all the TLS from fromThread to toThread
+     * @brief Releases the values of this holder in the TLS of all threads and its slot, so that it can be reused
+     * by another holder.
      **/
-    virtual void copyTLS(const QThread* fromThread, const QThread* toThread) const = 0;
+    virtual ~TLSHolderBase();
+    
+protected:
+    
+    //Index of the slot of this holder in the TLS of the threads. Slots are reused once their holder is destroyed,
+    //the serial tells whether the value stored in a slot belongs to this holder or to a previous one.
+    std::size_t _slot;
+    U64 _serial;
 };
 
 
@@ -81,106 +90,110 @@ protected:
 /**
  * @brief Stores globally to the application any thread-local storage object so that it gets
  * destroyed when all threads are shutdown.
+ * Each thread has an array with one slot per TLSHolder, that only the thread itself modifies. Accessing the TLS
+ * of the calling thread is an index in that array and never takes a lock.
+ * Before spawning threads, a thread takes a snapshot of its TLS: a copy that is never modified afterwards, so that
+ * the spawner may keep rendering while the spawned threads start. A spawned thread only keeps the snapshot: when a
+ * holder is accessed for the first time in the spawned thread, its value is copied from the snapshot.
  **/
 class AppTLS
 {
-    //This is the object in the QThreadStorage, it is duplicated on every thread
-    
-    typedef std::set<boost::weak_ptr<const TLSHolderBase> > TLSObjects;
-    struct GLobalTLSObject
-    {
-        TLSObjects objects;
-    };
-    
-    typedef boost::shared_ptr<GLobalTLSObject> GLobalTLSObjectPtr;
-    
-    //<spawned thread, spawner thread>
-    typedef std::map<const QThread*,const QThread*> ThreadSpawnMap;
-    
 public:
 
     AppTLS();
     
     virtual ~AppTLS();
-
-    /**
-     * @brief Registers the holder as using TLS.
-     **/
-    void registerTLSHolder(const boost::shared_ptr<const TLSHolderBase>& holder);
-    
     
     /**
-     * @brief Copy all the TLS from fromThread to toThread
+     * @brief Returns a copy of the TLS of the calling thread to give to the threads it spawns. The values are
+     * copied now, the calling thread may thus modify its TLS while the spawned threads use the snapshot.
+     * Returns NULL if the calling thread has no TLS.
      **/
-    void copyTLS(const QThread* fromThread,const QThread* toThread);
-
-    /**
-     * @brief This function registers fromThread as a thread who spawned toThread.
-     * The first time attempting to call getOrCreateTLSData() for toThread, it will 
-     * call copyTLS() first before returning the TLS value.
-     * This is to ensure that threads that "may" need TLS do not always copy the TLS 
-     * if it is not needed.
-     * Note that when calling softCopy,  fromThread may not already have
-     * the TLS that may be required for the copy to happen, in which case a new value will
-     * be constructed.
-     **/
-    void softCopy(const QThread* fromThread,const QThread* toThread);
+    TLSSnapshotPtr takeSnapshot() const WARN_UNUSED_RETURN;
     
     /**
-     * @brief Same as copyTLS() except that if a spawner thread was register for curThread beforehand
-     * with softCopy() then the TLS will be copied from the spawner thread.
-     * This function also returns the TLS for the given holder for convenience.
+     * @brief Makes the calling thread use the given snapshot, taken by the thread which spawned it, as its TLS.
+     * The value of a holder is copied from the snapshot the first time it is accessed on the calling thread.
      **/
-    template <typename T>
-    boost::shared_ptr<T> copyTLSFromSpawnerThread(const boost::shared_ptr<const TLSHolderBase>& holder,
-                                                  const QThread* curThread);
-
+    void copyTLS(const TLSSnapshotPtr& snapshot);
     
     /**
      * @brief Should be called by any thread using TLS when done to cleanup its TLS
      **/
     void cleanupTLSForThread();
     
+    /**
+     * @brief Returns the TLS of the calling thread, it is created if needed.
+     **/
+    static ThreadTLSData* getCurrentThreadData() WARN_UNUSED_RETURN;
     
-private:
-    
-    template <typename T>
-    boost::shared_ptr<T> copyTLSFromSpawnerThreadInternal(const boost::shared_ptr<const TLSHolderBase>& holder,
-                                                  const QThread* curThread,
-                                                          ThreadSpawnMap::iterator foundSpawned);
+    /**
+     * @brief Sets the value of the given slot in the TLS of the calling thread.
+     **/
+    static void setCurrentThreadData(ThreadTLSData* data, std::size_t slot, U64 serial, const boost::shared_ptr<void>& value, TLSCopyFunction copy);
+};
 
+/**
+ * @brief A slot in the TLS of a thread.
+ **/
+struct ThreadTLSSlot
+{
+    //The serial of the holder which set the value, 0 if empty
+    U64 serial;
+    boost::shared_ptr<void> value;
+    TLSCopyFunction copy;
+    
+    ThreadTLSSlot()
+    : serial(0)
+    , value()
+    , copy(0)
+    {
+    }
+};
 
+/**
+ * @brief A copy of the TLS of a thread, taken before spawning threads. It is never modified once taken, so that
+ * the spawned threads read it without locking. The values are copies made for the spawned threads, which copy
+ * them again when they access them since several threads share a snapshot.
+ **/
+struct TLSSnapshot
+{
+    std::vector<ThreadTLSSlot> slots;
+};
+
+/**
+ * @brief The TLS of a thread. A holder being destroyed releases its slot in the TLS of all threads, so the slots
+ * are modified under the mutex, and read under it when the thread copies all of them (AppTLS::takeSnapshot()).
+ * The owning thread reads the slot of a live holder without locking: no other thread modifies it.
+ **/
+struct ThreadTLSData
+{
+    mutable QMutex slotsMutex;
+    std::vector<ThreadTLSSlot> slots;
     
-    //This is the "TLS" object: it stores a set of all TLSHolder's who used the TLS to clean it up afterwards
-    mutable QReadWriteLock _objectMutex;
-    GLobalTLSObjectPtr _object;
+    //The TLS of the thread which spawned this thread, set by AppTLS::copyTLS()
+    TLSSnapshotPtr spawner;
     
-    //if a thread is a spawned thread, then copy the tls from the spawner thread instead
-    //of creating a new object and no longer mark it as spawned
-    ThreadSpawnMap _spawns;
-
+    ThreadTLSData()
+    : slotsMutex()
+    , slots()
+    , spawner()
+    {
+    }
     
+    ~ThreadTLSData();
 };
 
 
 /**
  * @brief Use this class if you need to hold TLS data on an object. 
  * @param T is the data type held in the thread local storage.
- * @param multipleInstance If true, then the TLS object will be mapped against this object
- * so that there can be multiple instance of it in the global TLS. Otherwise only
- * a single instance of the TLS object will be present.
  **/
 template <typename T>
 class TLSHolder : public TLSHolderBase
 {
     
     friend class AppTLS;
-
-    struct ThreadData
-    {
-        boost::shared_ptr<T> value;
-    };
-    typedef std::map<const QThread*, ThreadData> ThreadDataMap;
     
 public:
     
@@ -194,15 +207,15 @@ public:
     
 private:
     
-    virtual bool cleanupPerThreadData(const QThread* curThread) const OVERRIDE FINAL WARN_UNUSED_RETURN;
+    boost::shared_ptr<T> getTLSDataInternal(bool create) const;
     
-    virtual void copyTLS(const QThread* fromThread, const QThread* toThread) const OVERRIDE FINAL;
-
-    boost::shared_ptr<T> copyAndReturnNewTLS(const QThread* fromThread, const QThread* toThread) const WARN_UNUSED_RETURN;
+    /**
+     * @brief Returns a copy of the TLS of a spawner thread to use in the spawned thread, or NULL
+     * if a new value should be used instead.
+     **/
+    static boost::shared_ptr<T> copyTLS(const boost::shared_ptr<T>& fromThreadData) WARN_UNUSED_RETURN;
     
-    //Store a cache on the object to be faster than using the getOrCreate... function from AppTLS
-    mutable QReadWriteLock perThreadDataMutex;
-    mutable ThreadDataMap perThreadData;
+    static boost::shared_ptr<void> copyTLSValue(const boost::shared_ptr<void>& fromThreadData);
 };
 
 NATRON_NAMESPACE_EXIT;
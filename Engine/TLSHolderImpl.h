@@ -27,7 +27,6 @@
 
 #include "TLSHolder.h"
 
-#include "Engine/AppManager.h"
 #include "Engine/EffectInstance.h"
 
 NATRON_NAMESPACE_ENTER;
@@ -44,186 +43,70 @@ NATRON_NAMESPACE_ENTER;
 
 template <>
 boost::shared_ptr<EffectInstance::EffectTLSData>
-TLSHolder<EffectInstance::EffectTLSData>::copyAndReturnNewTLS(const QThread* fromThread, const QThread* toThread) const
+TLSHolder<EffectInstance::EffectTLSData>::copyTLS(const boost::shared_ptr<EffectInstance::EffectTLSData>& fromThreadData)
 {
-    QWriteLocker k(&perThreadDataMutex);
-    ThreadDataMap::iterator found = perThreadData.find(fromThread);
-    if (found == perThreadData.end()) {
-        ///No TLS for fromThread
-        return boost::shared_ptr<EffectInstance::EffectTLSData>();
-    }
-    
-    ThreadData data;
     //Copy constructor
-    data.value.reset(new EffectInstance::EffectTLSData(*(found->second.value)));
-    perThreadData[toThread] = data;
-    return data.value;
-    
-}
-
-template <>
-void
-TLSHolder<EffectInstance::EffectTLSData>::copyTLS(const QThread* fromThread, const QThread* toThread) const
-{
-    (void)copyAndReturnNewTLS(fromThread, toThread);
-}
-
-template <typename T>
-void
-TLSHolder<T>::copyTLS(const QThread* /*fromThread*/, const QThread* /*toThread*/) const
-{
-    
+    return boost::shared_ptr<EffectInstance::EffectTLSData>( new EffectInstance::EffectTLSData(*fromThreadData) );
 }
 
 template <typename T>
 boost::shared_ptr<T>
-TLSHolder<T>::copyAndReturnNewTLS(const QThread* /*fromThread*/, const QThread* /*toThread*/) const
+TLSHolder<T>::copyTLS(const boost::shared_ptr<T>& /*fromThreadData*/)
 {
     return boost::shared_ptr<T>();
 }
 
-
-
 template <typename T>
-bool
-TLSHolder<T>::cleanupPerThreadData(const QThread* curThread) const
+boost::shared_ptr<void>
+TLSHolder<T>::copyTLSValue(const boost::shared_ptr<void>& fromThreadData)
 {
-    QWriteLocker k(&perThreadDataMutex);
-    typename ThreadDataMap::iterator found = perThreadData.find(curThread);
-    if (found != perThreadData.end()) {
-        perThreadData.erase(found);
-    }
-    return perThreadData.empty();
+    return copyTLS( boost::static_pointer_cast<T>(fromThreadData) );
 }
 
 template <typename T>
 boost::shared_ptr<T>
-TLSHolder<T>::getTLSData() const
+TLSHolder<T>::getTLSDataInternal(bool create) const
 {
-    QThread* curThread  = QThread::currentThread();
-    
-    //This thread might be registered by a spawner thread, copy the TLS and attempt to find the TLS for this holder.
-    boost::shared_ptr<const TLSHolderBase> thisShared = shared_from_this();
-    boost::shared_ptr<T> ret = appPTR->getAppTLS()->copyTLSFromSpawnerThread<T>(thisShared, curThread);
-    if (ret) {
-        return ret;
-    }
+    ThreadTLSData* data = AppTLS::getCurrentThreadData();
     
-    
-    //Attempt to find an object in the map. It will be there if we already called getOrCreateTLSData() for this thread
-    {
-        QReadLocker k(&perThreadDataMutex);
-        typename ThreadDataMap::iterator found = perThreadData.find(curThread);
-        if (found != perThreadData.end()) {
-            return found->second.value;
+    //The value is already there if we already called getOrCreateTLSData() for this thread.
+    //Only this thread modifies its slots, there is no need to lock.
+    if ( _slot < data->slots.size() ) {
+        const ThreadTLSSlot& slot = data->slots[_slot];
+        if (slot.serial == _serial) {
+            return boost::static_pointer_cast<T>(slot.value);
         }
     }
     
-    return boost::shared_ptr<T>();
-}
-
-template <typename T>
-boost::shared_ptr<T>
-TLSHolder<T>::getOrCreateTLSData() const
-{
-    QThread* curThread  = QThread::currentThread();
-    
-    //This thread might be registered by a spawner thread, copy the TLS and attempt to find the TLS for this holder.
-    boost::shared_ptr<const TLSHolderBase> thisShared = shared_from_this();
-    boost::shared_ptr<T> ret = appPTR->getAppTLS()->copyTLSFromSpawnerThread<T>(thisShared, curThread);
-    if (ret) {
-        return ret;
+    //This thread might have been spawned by a thread that has TLS for this holder, copy it.
+    //The snapshot is shared with the other spawned threads: its value must be copied again.
+    boost::shared_ptr<T> ret;
+    const TLSSnapshot* spawner = data->spawner.get();
+    if ( spawner && ( _slot < spawner->slots.size() ) && (spawner->slots[_slot].serial == _serial) ) {
+        ret = copyTLS( boost::static_pointer_cast<T>(spawner->slots[_slot].value) );
     }
-    
-    //Attempt to find an object in the map. It will be there if we already called getOrCreateTLSData() for this thread
-    //Note that if present, this call is extremely fast as we do not block other threads
-    {
-        QReadLocker k(&perThreadDataMutex);
-        typename ThreadDataMap::iterator found = perThreadData.find(curThread);
-        if (found != perThreadData.end()) {
-            assert(found->second.value);
-            return found->second.value;
+    if (!ret) {
+        if (!create) {
+            return ret;
         }
+        ret.reset(new T);
     }
-    
-    //getOrCreateTLSData() has never been called on the thread, lookup the TLS
-    ThreadData data;
-    appPTR->getAppTLS()->registerTLSHolder(thisShared);
-    data.value.reset(new T);
-    {
-        QWriteLocker k(&perThreadDataMutex);
-        perThreadData.insert(std::make_pair(curThread,data));
-    }
-    assert(data.value);
-    return data.value;
+    AppTLS::setCurrentThreadData(data, _slot, _serial, ret, &TLSHolder<T>::copyTLSValue);
+    return ret;
 }
 
-
 template <typename T>
 boost::shared_ptr<T>
-AppTLS::copyTLSFromSpawnerThread(const boost::shared_ptr<const TLSHolderBase>& holder,
-                                 const QThread* curThread)
+TLSHolder<T>::getTLSData() const
 {
-    //3 cases where this function returns NULL:
-    // 1) No spawner thread registered
-    // 2) T is not a ParallelRenderArgs (see comments above copyAndReturnNewTLS explicit template instanciation
-    // 3) The spawner thread did not have TLS but was marked in the spawn map...
-    // Either way: return a new object
-
-    
-    ThreadSpawnMap::iterator foundSpawned;
-    {
-        QReadLocker k(&_objectMutex);
-        foundSpawned = _spawns.find(curThread);
-        if (foundSpawned == _spawns.end()) {
-            //This is not a spawned thread and it did not have TLS already
-            return boost::shared_ptr<T>();
-        }
-    }
-    {
-        QWriteLocker k(&_objectMutex);
-        return copyTLSFromSpawnerThreadInternal<T>(holder, curThread, foundSpawned);
-    }
+    return getTLSDataInternal(false);
 }
 
 template <typename T>
 boost::shared_ptr<T>
-AppTLS::copyTLSFromSpawnerThreadInternal(const boost::shared_ptr<const TLSHolderBase>& holder,
-                                              const QThread* curThread,
-                                         ThreadSpawnMap::iterator foundSpawned)
+TLSHolder<T>::getOrCreateTLSData() const
 {
-    //Private - should be locked
-    assert(!_objectMutex.tryLockForWrite());
-    
-    boost::shared_ptr<T> tls;
-    
-    //This is a spawned thread and the first time we need the TLS for this thread, copy the whole TLS on all objects
-    for (TLSObjects::iterator it = _object->objects.begin();
-         it!=_object->objects.end(); ++it) {
-        boost::shared_ptr<const TLSHolderBase> p = (*it).lock();
-        if (p) {
-            const TLSHolder<T>* foundHolder = 0;
-            if (p.get() == holder.get()) {
-                //This is the object from which it has been required to create the TLS data, copy
-                //the TLS data from the spawner thread and mark it to 'tls'.
-                foundHolder = dynamic_cast<const TLSHolder<T>*>(p.get());
-                if (foundHolder) {
-                    tls = foundHolder->copyAndReturnNewTLS(foundSpawned->second, curThread);
-                }
-            }
-            
-            if (!foundHolder) {
-                //Copy anyway
-                p->copyTLS(foundSpawned->second, curThread);
-            }
-        }
-    }
-    
-    
-    //Erase the thread from the spawn map
-    _spawns.erase(foundSpawned);
-    return tls;
-
+    return getTLSDataInternal(true);
 }
 
 NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,465 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "TaskScheduler.h"
+
+#include <algorithm> // max
+#include <deque>
+#include <list>
+#include <vector>
+#include <cassert>
+#include <stdexcept>
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/shared_ptr.hpp>
+#endif
+
+#include <QtCore/QThread>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QDebug>
+
+NATRON_NAMESPACE_ENTER;
+
+namespace {
+
+struct TaskEntry
+{
+    TaskScheduler::Task task;
+    TaskGroupPrivate* group; //< only dereferenced by the thread that claimed the entry, the group cannot finish before
+    QAtomicInt claimed; //< set to 1 by the first thread that takes the entry, the other threads drop it
+
+    TaskEntry(const TaskScheduler::Task & task,
+              TaskGroupPrivate* group)
+        : task(task)
+        , group(group)
+        , claimed(0)
+    {
+    }
+};
+
+typedef boost::shared_ptr<TaskEntry> TaskEntryPtr;
+
+struct TaskQueue
+{
+    QMutex lock;
+    std::deque<TaskEntryPtr> tasks;
+
+    TaskQueue()
+        : lock()
+        , tasks()
+    {
+    }
+};
+
+} // anon namespace
+
+struct TaskGroupPrivate
+{
+    TaskScheduler* scheduler;
+    QMutex lock;
+    QWaitCondition finishedCond;
+    int pending; //< tasks submitted and not finished yet
+    bool failed; //< true if a task threw an exception
+    std::list<TaskEntryPtr> entries; //< tasks submitted that may not have been claimed yet, for the waiting thread to help
+
+    TaskGroupPrivate(TaskScheduler* scheduler)
+        : scheduler(scheduler)
+        , lock()
+        , finishedCond()
+        , pending(0)
+        , failed(false)
+        , entries()
+    {
+    }
+};
+
+class TaskSchedulerWorker
+    : public QThread
+{
+public:
+
+    TaskSchedulerWorker(TaskSchedulerPrivate* scheduler,
+                        int index)
+        : QThread()
+        , queue()
+        , _scheduler(scheduler)
+        , _index(index)
+    {
+        setObjectName( QString::fromUtf8("TaskScheduler worker ") + QString::number(index) );
+    }
+
+    virtual ~TaskSchedulerWorker()
+    {
+    }
+
+    int getIndex() const
+    {
+        return _index;
+    }
+
+    const TaskSchedulerPrivate* getScheduler() const
+    {
+        return _scheduler;
+    }
+
+    TaskQueue queue;
+
+private:
+
+    virtual void run() OVERRIDE FINAL;
+
+    TaskSchedulerPrivate* _scheduler;
+    int _index;
+};
+
+struct TaskSchedulerPrivate
+{
+    mutable QReadWriteLock workersLock; //< protects workers, which only grows
+    std::vector<TaskSchedulerWorker*> workers;
+    TaskQueue injectionQueue; //< tasks submitted by threads which are not workers
+    QAtomicInt queuedCount; //< number of entries in all queues, including the stale ones already claimed by a waiter
+    QAtomicInt activeCount; //< number of workers executing a task
+
+    //Workers sleep on sleepCond when there's nothing to do, parked workers sleep on parkCond
+    mutable QMutex sleepMutex;
+    QWaitCondition sleepCond;
+    QWaitCondition parkCond;
+    int maxThreads; //< protected by sleepMutex
+    bool quit; //< protected by sleepMutex
+
+    TaskSchedulerPrivate(int maxThreadCount)
+        : workersLock()
+        , workers()
+        , injectionQueue()
+        , queuedCount()
+        , activeCount()
+        , sleepMutex()
+        , sleepCond()
+        , parkCond()
+        , maxThreads( std::max(1, maxThreadCount) )
+        , quit(false)
+    {
+        queuedCount = 0;
+        activeCount = 0;
+    }
+
+    TaskSchedulerWorker* getCurrentWorker() const
+    {
+        TaskSchedulerWorker* worker = dynamic_cast<TaskSchedulerWorker*>( QThread::currentThread() );
+
+        return (worker && worker->getScheduler() == this) ? worker : 0;
+    }
+
+    void ensureWorkersStarted();
+
+    void push(const TaskEntryPtr & entry);
+
+    TaskEntryPtr takeTask(TaskSchedulerWorker* worker);
+
+    static TaskEntryPtr popFront(TaskQueue & queue);
+};
+
+/**
+ * @brief Executes the entry if no other thread took it yet and notifies its group. Returns false if the entry was stale.
+ **/
+static bool
+executeEntry(const TaskEntryPtr & entry)
+{
+    if ( !entry->claimed.testAndSetAcquire(0, 1) ) {
+        return false;
+    }
+    TaskGroupPrivate* group = entry->group;
+    bool ok = true;
+    try {
+        entry->task();
+    } catch (const std::exception & e) {
+        qDebug() << "Exception caught in a task of the TaskScheduler:" << e.what();
+        ok = false;
+    } catch (...) {
+        qDebug() << "Unknown exception caught in a task of the TaskScheduler";
+        ok = false;
+    }
+    ///Release what the task was bound to before the waiter returns
+    entry->task.clear();
+
+    ///The group may be destroyed as soon as pending reaches 0 and the lock is released
+    QMutexLocker k(&group->lock);
+    if (!ok) {
+        group->failed = true;
+    }
+    --group->pending;
+    assert(group->pending >= 0);
+    if (group->pending == 0) {
+        group->finishedCond.wakeAll();
+    }
+
+    return true;
+}
+
+void
+TaskSchedulerPrivate::ensureWorkersStarted()
+{
+    int nWorkers;
+    {
+        QMutexLocker k(&sleepMutex);
+        nWorkers = maxThreads;
+    }
+    {
+        QReadLocker k(&workersLock);
+        if ( (int)workers.size() >= nWorkers ) {
+            return;
+        }
+    }
+    QWriteLocker k(&workersLock);
+    while ( (int)workers.size() < nWorkers ) {
+        TaskSchedulerWorker* worker = new TaskSchedulerWorker(this, (int)workers.size());
+        workers.push_back(worker);
+        worker->start();
+    }
+}
+
+void
+TaskSchedulerPrivate::push(const TaskEntryPtr & entry)
+{
+    TaskSchedulerWorker* worker = getCurrentWorker();
+    TaskQueue & queue = worker ? worker->queue : injectionQueue;
+    {
+        QMutexLocker k(&queue.lock);
+        queue.tasks.push_back(entry);
+    }
+    queuedCount.fetchAndAddOrdered(1);
+
+    ensureWorkersStarted();
+
+    ///Take the mutex so that a worker cannot miss the wake-up between checking queuedCount and going to sleep
+    QMutexLocker k(&sleepMutex);
+    sleepCond.wakeOne();
+}
+
+TaskEntryPtr
+TaskSchedulerPrivate::popFront(TaskQueue & queue)
+{
+    QMutexLocker k(&queue.lock);
+
+    if ( queue.tasks.empty() ) {
+        return TaskEntryPtr();
+    }
+    TaskEntryPtr ret = queue.tasks.front();
+    queue.tasks.pop_front();
+
+    return ret;
+}
+
+TaskEntryPtr
+TaskSchedulerPrivate::takeTask(TaskSchedulerWorker* worker)
+{
+    TaskEntryPtr ret;
+
+    ///First the most recent task we spawned ourselves
+    {
+        QMutexLocker k(&worker->queue.lock);
+        if ( !worker->queue.tasks.empty() ) {
+            ret = worker->queue.tasks.back();
+            worker->queue.tasks.pop_back();
+        }
+    }
+
+    if (!ret) {
+        bool parked;
+        {
+            QMutexLocker k(&sleepMutex);
+            parked = worker->getIndex() >= maxThreads;
+        }
+        if (parked) {
+            return ret;
+        }
+
+        ///Then tasks from outside the pool
+        ret = popFront(injectionQueue);
+
+        ///Then steal the oldest task of another worker, those are the largest pieces of work
+        if (!ret) {
+            QReadLocker k(&workersLock);
+            int nWorkers = (int)workers.size();
+            for (int i = 1; i < nWorkers && !ret; ++i) {
+                ret = popFront(workers[(worker->getIndex() + i) % nWorkers]->queue);
+            }
+        }
+    }
+
+    if (ret) {
+        queuedCount.fetchAndAddOrdered(-1);
+    }
+
+    return ret;
+}
+
+void
+TaskSchedulerWorker::run()
+{
+    for (;;) {
+        TaskEntryPtr entry = _scheduler->takeTask(this);
+
+        if (entry) {
+            _scheduler->activeCount.fetchAndAddOrdered(1);
+            executeEntry(entry);
+            _scheduler->activeCount.fetchAndAddOrdered(-1);
+            continue;
+        }
+
+        QMutexLocker k(&_scheduler->sleepMutex);
+        if (_scheduler->quit) {
+            ///Queues are drained, all tasks are done
+            return;
+        }
+        if (_index >= _scheduler->maxThreads) {
+            ///Parked workers have their own condition so that they do not swallow the wake-ups of push()
+            _scheduler->parkCond.wait(&_scheduler->sleepMutex);
+        } else if ( (int)_scheduler->queuedCount == 0 ) {
+            _scheduler->sleepCond.wait(&_scheduler->sleepMutex);
+        }
+    }
+}
+
+TaskScheduler::TaskScheduler(int maxThreadCount)
+    : _imp( new TaskSchedulerPrivate(maxThreadCount) )
+{
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    std::vector<TaskSchedulerWorker*> workers;
+    {
+        QReadLocker k(&_imp->workersLock);
+        workers = _imp->workers;
+    }
+    {
+        QMutexLocker k(&_imp->sleepMutex);
+        _imp->quit = true;
+        ///Un-park everyone so that the queues get drained
+        _imp->maxThreads = std::max( _imp->maxThreads, (int)workers.size() );
+        _imp->sleepCond.wakeAll();
+        _imp->parkCond.wakeAll();
+    }
+    ///Don't hold workersLock while waiting, the workers need it to steal.
+    ///Only delete them once they're all stopped: a running worker may still be stealing from the queue of another.
+    for (std::size_t i = 0; i < workers.size(); ++i) {
+        workers[i]->wait();
+    }
+    for (std::size_t i = 0; i < workers.size(); ++i) {
+        delete workers[i];
+    }
+    delete _imp;
+}
+
+void
+TaskScheduler::setMaxThreadCount(int maxThreadCount)
+{
+    {
+        QMutexLocker k(&_imp->sleepMutex);
+        _imp->maxThreads = std::max(1, maxThreadCount);
+        _imp->sleepCond.wakeAll();
+        _imp->parkCond.wakeAll();
+    }
+    if ( (int)_imp->queuedCount > 0 ) {
+        _imp->ensureWorkersStarted();
+    }
+}
+
+int
+TaskScheduler::maxThreadCount() const
+{
+    QMutexLocker k(&_imp->sleepMutex);
+
+    return _imp->maxThreads;
+}
+
+int
+TaskScheduler::activeThreadCount() const
+{
+    return (int)_imp->activeCount;
+}
+
+bool
+TaskScheduler::isWorkerThread() const
+{
+    return _imp->getCurrentWorker() != 0;
+}
+
+TaskGroup::TaskGroup(TaskScheduler* scheduler)
+    : _imp( new TaskGroupPrivate(scheduler) )
+{
+    assert(scheduler);
+}
+
+TaskGroup::~TaskGroup()
+{
+    wait();
+    delete _imp;
+}
+
+void
+TaskGroup::run(const TaskScheduler::Task & task)
+{
+    TaskEntryPtr entry( new TaskEntry(task, _imp) );
+    {
+        QMutexLocker k(&_imp->lock);
+        ++_imp->pending;
+        _imp->entries.push_back(entry);
+    }
+    _imp->scheduler->_imp->push(entry);
+}
+
+bool
+TaskGroup::wait()
+{
+    ///Help: run the tasks nobody has started yet. Only tasks of this group are executed here so that
+    ///the thread local storage of the calling thread is the one the tasks expect.
+    for (;;) {
+        TaskEntryPtr entry;
+        {
+            QMutexLocker k(&_imp->lock);
+            if ( _imp->entries.empty() ) {
+                break;
+            }
+            entry = _imp->entries.back();
+            _imp->entries.pop_back();
+        }
+        executeEntry(entry);
+    }
+
+    QMutexLocker k(&_imp->lock);
+    while (_imp->pending > 0) {
+        _imp->finishedCond.wait(&_imp->lock);
+    }
+    bool ret = !_imp->failed;
+    _imp->failed = false;
+
+    return ret;
+}
+
+NATRON_NAMESPACE_EXIT;
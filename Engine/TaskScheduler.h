@@ -0,0 +1,127 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_TASKSCHEDULER_H
+#define NATRON_ENGINE_TASKSCHEDULER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "Global/Macros.h"
+
+#if !defined(Q_MOC_RUN) && !defined(SBK_RUN)
+#include <boost/function.hpp>
+#endif
+
+#include "Global/GlobalDefines.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+struct TaskSchedulerPrivate;
+struct TaskGroupPrivate;
+
+/**
+ * @brief A pool of worker threads scheduling tasks with work-stealing.
+ * Each worker owns a queue: tasks submitted from a worker go to the back of its own queue and the worker
+ * pops them back in LIFO order, so that nested work (e.g. the tiles of an upstream node requested while
+ * rendering a tile) is processed first by the thread that spawned it. Idle workers steal from the front of
+ * the other queues. Tasks submitted by threads that are not workers go to a shared injection queue.
+ *
+ * Tasks are submitted through a TaskGroup. A thread waiting on a TaskGroup does not sleep while tasks of the
+ * group are still queued: it executes them itself. This is what makes nested parallelism safe: a worker
+ * blocked on the tiles of an upstream node keeps working instead of holding a slot of the pool.
+ *
+ * This class is thread-safe.
+ **/
+class TaskScheduler
+{
+    friend class TaskGroup;
+
+public:
+
+    typedef boost::function0<void> Task;
+
+    /**
+     * @param maxThreadCount The number of worker threads, clamped to at least 1. Workers are started lazily.
+     **/
+    TaskScheduler(int maxThreadCount);
+
+    /**
+     * @brief Waits for all queued tasks to be executed and then stops the worker threads.
+     **/
+    ~TaskScheduler();
+
+    /**
+     * @brief Changes the number of workers allowed to pick up tasks. Workers beyond this count are parked,
+     * not destroyed, so that this is cheap to call when the user changes the settings.
+     **/
+    void setMaxThreadCount(int maxThreadCount);
+
+    int maxThreadCount() const;
+
+    /**
+     * @brief Returns the number of workers currently executing a task.
+     **/
+    int activeThreadCount() const;
+
+    /**
+     * @brief Returns true if the calling thread is a worker of this scheduler
+     **/
+    bool isWorkerThread() const;
+
+private:
+
+    TaskSchedulerPrivate* _imp;
+};
+
+/**
+ * @brief A set of tasks submitted to a TaskScheduler that can be waited upon together.
+ * The group must be waited upon by the thread that created it, the destructor waits if wait() was not called.
+ **/
+class TaskGroup
+{
+public:
+
+    TaskGroup(TaskScheduler* scheduler);
+
+    ~TaskGroup();
+
+    /**
+     * @brief Queue a task. It might start right away on another thread.
+     **/
+    void run(const TaskScheduler::Task & task);
+
+    /**
+     * @brief Executes the tasks of this group that no worker has started yet in the calling thread, then
+     * blocks until all the tasks of the group are finished.
+     * Returns false if any task has thrown an exception.
+     **/
+    bool wait();
+
+private:
+
+    TaskGroupPrivate* _imp;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_TASKSCHEDULER_H
@@ -30,6 +30,12 @@
 #include <cassert>
 #include <stdexcept>
 
+#ifdef __NATRON_WIN32__
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
 #include <QMutexLocker>
 
 #include "Global/GlobalDefines.h"
@@ -333,6 +339,32 @@ TimeLapseReporter::~TimeLapseReporter()
     std::cout << message << ' ' << dt << std::endl;
 }
 
+double
+getProcessCPUTime()
+{
+#ifdef __NATRON_WIN32__
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if ( !GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime) ) {
+        return -1.;
+    }
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernelTime.dwLowDateTime;
+    kernel.HighPart = kernelTime.dwHighDateTime;
+    user.LowPart = userTime.dwLowDateTime;
+    user.HighPart = userTime.dwHighDateTime;
+
+    // FILETIME is in 100ns units
+    return (kernel.QuadPart + user.QuadPart) * 1e-7;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1.;
+    }
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+#endif
+}
+
 NATRON_NAMESPACE_EXIT;
 
 NATRON_NAMESPACE_USING;
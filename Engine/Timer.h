@@ -163,6 +163,12 @@ public:
     ~TimeLapseReporter();
 };
 
+/**
+ * @brief Returns the CPU time (user and system) consumed so far by all the threads of the process, in seconds,
+ * or -1 if it cannot be determined on this system.
+ **/
+double getProcessCPUTime();
+
 NATRON_NAMESPACE_EXIT;
 
 #endif // ifndef NATRON_ENGINE_TIMER_H
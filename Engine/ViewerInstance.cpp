@@ -52,6 +52,7 @@ CLANG_DIAG_ON(deprecated)
 #include "Engine/Image.h"
 #include "Engine/ImageInfo.h"
 #include "Engine/ImageInfo.h"
+#include "Engine/ImageRow.h"
 #include "Engine/Log.h"
 #include "Engine/Lut.h"
 #include "Engine/MemoryFile.h"
@@ -67,6 +68,7 @@ CLANG_DIAG_ON(deprecated)
 #include "Engine/Settings.h"
 #include "Engine/TimeLine.h"
 #include "Engine/Timer.h"
+#include "Engine/ViewerRowConverter.h"
 
 
 #ifndef M_LN2
@@ -91,26 +93,13 @@ static void scaleToTexture32bits(const RectI& roi,
 static std::pair<double, double>
 findAutoContrastVminVmax(boost::shared_ptr<const Image> inputImage,
                          DisplayChannelsEnum channels,
-                         const RectI & rect);
+                         const RectI & rect,
+                         bool parallel);
 static void renderFunctor(const RectI& roi,
                           const RenderViewerArgs & args,
                           ViewerInstance* viewer,
                           void *buffer);
 
-/**
- *@brief Actually converting to ARGB... but it is called BGRA by
-   the texture format GL_UNSIGNED_INT_8_8_8_8_REV
- **/
-static unsigned int toBGRA(unsigned char r, unsigned char g, unsigned char b, unsigned char a) WARN_UNUSED_RETURN;
-unsigned int
-toBGRA(unsigned char r,
-       unsigned char g,
-       unsigned char b,
-       unsigned char a)
-{
-    return (a << 24) | (r << 16) | (g << 8) | b;
-}
-
 const Color::Lut*
 ViewerInstance::lutFromColorspace(ViewerColorSpaceEnum cs)
 {
@@ -128,9 +117,6 @@ ViewerInstance::lutFromColorspace(ViewerColorSpaceEnum cs)
         lut = 0;
         break;
     }
-    if (lut) {
-        lut->validate();
-    }
 
     return lut;
 }
@@ -1583,7 +1569,7 @@ ViewerInstance::renderViewer_internal(int view,
         if (singleThreaded) {
             if (inArgs.autoContrast) {
                 double vmin, vmax;
-                std::pair<double,double> vMinMax = findAutoContrastVminVmax(colorImage, inArgs.channels, viewerRenderRoI);
+                std::pair<double,double> vMinMax = findAutoContrastVminVmax(colorImage, inArgs.channels, viewerRenderRoI, false);
                 vmin = vMinMax.first;
                 vmax = vMinMax.second;
                 
@@ -1628,32 +1614,10 @@ ViewerInstance::renderViewer_internal(int view,
             ///if autoContrast is enabled, find out the vmin/vmax before rendering and mapping against new values
             if (inArgs.autoContrast) {
                 
-                double vmin = std::numeric_limits<double>::infinity();
-                double vmax = -std::numeric_limits<double>::infinity();
-                
-                if (!runInCurrentThread) {
-                    
-                    QFuture<std::pair<double,double> > future = QtConcurrent::mapped( splitRects,
-                                                                                     boost::bind(findAutoContrastVminVmax,
-                                                                                                 colorImage,
-                                                                                                 inArgs.channels,
-                                                                                                 _1) );
-                    future.waitForFinished();
-                    
-                    std::pair<double,double> vMinMax;
-                    Q_FOREACH ( vMinMax, future.results() ) {
-                        if (vMinMax.first < vmin) {
-                            vmin = vMinMax.first;
-                        }
-                        if (vMinMax.second > vmax) {
-                            vmax = vMinMax.second;
-                        }
-                    }
-                } else { //!runInCurrentThread
-                    std::pair<double,double> vMinMax = findAutoContrastVminVmax(colorImage, inArgs.channels, viewerRenderRoI);
-                    vmin = vMinMax.first;
-                    vmax = vMinMax.second;
-                }
+                ///the min/max is a reduction over bands of rows on the TaskScheduler, unless the viewer renders in this thread
+                std::pair<double,double> vMinMax = findAutoContrastVminVmax(colorImage, inArgs.channels, viewerRenderRoI, !runInCurrentThread);
+                double vmin = vMinMax.first;
+                double vmax = vMinMax.second;
                 
                 if (vmax == vmin) {
                     vmin = vmax - 1.;
@@ -1787,126 +1751,203 @@ renderFunctor(const RectI& roi,
     }
 }
 
-inline
-std::pair<double, double>
-findAutoContrastVminVmax_generic(boost::shared_ptr<const Image> inputImage,
-                                 int nComps,
-                                 DisplayChannelsEnum channels,
-                                 const RectI & rect)
+struct AutoContrastReduction
+{
+    const float* pixels; // the first pixel of the rect
+    int rowElements;
+    int nComps;
+    RectI rect;
+    DisplayChannelsEnum channels;
+    QMutex lock;
+    double vmin, vmax;
+};
+
+static void
+findAutoContrastVminVmaxRows(AutoContrastReduction* reduction,
+                             int y1,
+                             int y2)
 {
     double localVmin = std::numeric_limits<double>::infinity();
     double localVmax = -std::numeric_limits<double>::infinity();
-    
-    Image::ReadAccess acc = inputImage->getReadRights();
-    
-    for (int y = rect.bottom(); y < rect.top(); ++y) {
-        const float* src_pixels = (const float*)acc.pixelAt(rect.left(),y);
-        ///we fill the scan-line with all the pixels of the input image
-        for (int x = rect.left(); x < rect.right(); ++x) {
-            
-            double r = 0.;
-            double g = 0.;
-            double b = 0.;
-            double a = 0.;
-            switch (nComps) {
-                case 4:
-                    r = src_pixels[0];
-                    g = src_pixels[1];
-                    b = src_pixels[2];
-                    a = src_pixels[3];
-                    break;
-                case 3:
-                    r = src_pixels[0];
-                    g = src_pixels[1];
-                    b = src_pixels[2];
-                    a = 1.;
-                    break;
-                case 2:
-                    r = src_pixels[0];
-                    g = src_pixels[1];
-                    b = 0.;
-                    a = 1.;
-                    break;
-                case 1:
-                    a = src_pixels[0];
-                    r = g = b = 0.;
-                    break;
-                default:
-                    r = g = b = a = 0.;
-            }
-            
-            double mini, maxi;
-            switch (channels) {
-                case eDisplayChannelsRGB:
-                    mini = std::min(std::min(r,g),b);
-                    maxi = std::max(std::max(r,g),b);
-                    break;
-                case eDisplayChannelsY:
-                    mini = r = 0.299 * r + 0.587 * g + 0.114 * b;
-                    maxi = mini;
-                    break;
-                case eDisplayChannelsR:
-                    mini = r;
-                    maxi = mini;
-                    break;
-                case eDisplayChannelsG:
-                    mini = g;
-                    maxi = mini;
-                    break;
-                case eDisplayChannelsB:
-                    mini = b;
-                    maxi = mini;
-                    break;
-                case eDisplayChannelsA:
-                    mini = a;
-                    maxi = mini;
-                    break;
-                default:
-                    mini = 0.;
-                    maxi = 0.;
-                    break;
-            }
-            if (mini < localVmin) {
-                localVmin = mini;
-            }
-            if (maxi > localVmax) {
-                localVmax = maxi;
-            }
-            
-            src_pixels += nComps;
-        }
+    const RectI& rect = reduction->rect;
+
+    for (int y = y1; y < y2; ++y) {
+        ViewerRowConverter::findMinMax(reduction->pixels + (std::size_t)(y - rect.y1) * reduction->rowElements, reduction->nComps,
+                                       rect.width(), reduction->channels, &localVmin, &localVmax);
     }
-    
-    return std::make_pair(localVmin, localVmax);
-}
 
-template <int nComps>
-std::pair<double, double>
-findAutoContrastVminVmax_internal(boost::shared_ptr<const Image> inputImage,
-                                  DisplayChannelsEnum channels,
-                                  const RectI & rect)
-{
-    return findAutoContrastVminVmax_generic(inputImage, nComps, channels, rect);
+    QMutexLocker k(&reduction->lock);
+    if (localVmin < reduction->vmin) {
+        reduction->vmin = localVmin;
+    }
+    if (localVmax > reduction->vmax) {
+        reduction->vmax = localVmax;
+    }
 }
 
 std::pair<double, double>
 findAutoContrastVminVmax(boost::shared_ptr<const Image> inputImage,
                          DisplayChannelsEnum channels,
-                         const RectI & rect)
-{
-    int nComps = inputImage->getComponents().getNumComponents();
-    if (nComps == 4) {
-        return findAutoContrastVminVmax_internal<4>(inputImage, channels, rect);
-    } else if (nComps == 3) {
-        return findAutoContrastVminVmax_internal<3>(inputImage, channels, rect);
-    } else if (nComps == 1) {
-        return findAutoContrastVminVmax_internal<1>(inputImage, channels, rect);
+                         const RectI & rect,
+                         bool parallel)
+{
+    AutoContrastReduction reduction;
+    reduction.vmin = std::numeric_limits<double>::infinity();
+    reduction.vmax = -std::numeric_limits<double>::infinity();
+    if ( rect.isNull() ) {
+        return std::make_pair(reduction.vmin, reduction.vmax);
+    }
+
+    ///the lock is held by this thread while the bands read the pixels
+    Image::ReadAccess acc = inputImage->getReadRights();
+    reduction.pixels = (const float*)acc.pixelAt( rect.left(), rect.bottom() );
+    reduction.nComps = inputImage->getComponents().getNumComponents();
+    reduction.rowElements = inputImage->getBounds().width() * reduction.nComps;
+    reduction.rect = rect;
+    reduction.channels = channels;
+    assert(reduction.pixels);
+
+    if (parallel) {
+        ImageRow::processRowBands( rect, boost::bind(&findAutoContrastVminVmaxRows, &reduction, _1, _2) );
     } else {
-        return findAutoContrastVminVmax_generic(inputImage, nComps, channels, rect);
+        findAutoContrastVminVmaxRows( &reduction, rect.bottom(), rect.top() );
     }
-    
+
+    return std::make_pair(reduction.vmin, reduction.vmax);
 } // findAutoContrastVminVmax
 
+static inline float
+viewerLinearValue(unsigned char v,
+                  const Color::Lut* srcColorSpace)
+{
+    return srcColorSpace ? srcColorSpace->fromColorSpaceUint8ToLinearFloatFast(v) : Image::convertPixelDepth<unsigned char, float>(v);
+}
+
+static inline float
+viewerLinearValue(unsigned short v,
+                  const Color::Lut* srcColorSpace)
+{
+    return srcColorSpace ? srcColorSpace->fromColorSpaceUint16ToLinearFloatFast(v) : Image::convertPixelDepth<unsigned short, float>(v);
+}
+
+static inline float
+viewerLinearValue(float v,
+                  const Color::Lut* srcColorSpace)
+{
+    return srcColorSpace ? srcColorSpace->fromColorSpaceFloatToLinearFloat(v) : v;
+}
+
+static inline float
+viewerLinearValue(Half v,
+                  const Color::Lut* srcColorSpace)
+{
+    return viewerLinearValue( (float)v, srcColorSpace );
+}
+
+/**
+ * @brief Reads width pixels of a row of the input image to the linear float planes of the converter.
+ * src_pixels may be NULL if the row is not in the image, the planes are then black and transparent.
+ **/
+template <typename PIX,bool opaque,int rOffset,int gOffset,int bOffset>
+void
+loadViewerRow(const PIX* src_pixels,
+              int nComps,
+              int width,
+              const Color::Lut* srcColorSpace,
+              ViewerRowConverter& converter)
+{
+    float* r = converter.red();
+    float* g = converter.green();
+    float* b = converter.blue();
+    float* a = converter.alpha();
+
+    if (!src_pixels) {
+        const float zero = viewerLinearValue( (PIX)0, srcColorSpace );
+        std::fill(r, r + width, zero);
+        std::fill(g, g + width, zero);
+        std::fill(b, b + width, zero);
+        std::fill(a, a + width, 0.f);
+
+        return;
+    }
+
+    for (int x = 0; x < width; ++x, src_pixels += nComps) {
+        PIX vr = 0;
+        PIX vg = 0;
+        PIX vb = 0;
+        if (nComps >= 4) {
+            vr = src_pixels[rOffset];
+            vg = src_pixels[gOffset];
+            vb = src_pixels[bOffset];
+            a[x] = opaque ? 1.f : Image::convertPixelDepth<PIX, float>(src_pixels[3]);
+        } else {
+            // coverity[dead_error_line]
+            vr = (rOffset < nComps) ? src_pixels[rOffset] : PIX(0);
+            if (nComps == 1) {
+                vg = vb = vr;
+            } else {
+                // coverity[dead_error_line]
+                vg = (gOffset < nComps) ? src_pixels[gOffset] : PIX(0);
+                // coverity[dead_error_line]
+                vb = (bOffset < nComps) ? src_pixels[bOffset] : PIX(0);
+            }
+            a[x] = 1.f;
+        }
+        r[x] = viewerLinearValue(vr, srcColorSpace);
+        g[x] = viewerLinearValue(vg, srcColorSpace);
+        b[x] = viewerLinearValue(vb, srcColorSpace);
+    }
+}
+
+/**
+ * @brief Returns the values of the matte channel for the pixels [x1, x2[ of the row y. When the matte is
+ * a channel of the input image this is one of the planes of the converter, otherwise the row is read
+ * from the matte image to matteRow. Returns NULL if there is no matte to display.
+ **/
+template <typename PIX>
+const float*
+getViewerMatteRow(const RenderViewerArgs & args,
+                  const Image::ReadAccess& matteAcc,
+                  int x1,
+                  int x2,
+                  int y,
+                  ViewerRowConverter& converter,
+                  std::vector<float>& matteRow)
+{
+    if (args.matteImage == args.inputImage) {
+        switch (args.alphaChannelIndex) {
+            case 0:
+                return converter.red();
+            case 1:
+                return converter.green();
+            case 2:
+                return converter.blue();
+            case 3:
+                return converter.alpha();
+            default:
+                return NULL;
+        }
+    }
+
+    std::fill(matteRow.begin(), matteRow.end(), 0.f);
+    const RectI& matteBounds = args.matteImage->getBounds();
+    const int matteX1 = std::max(x1, matteBounds.x1);
+    const int matteX2 = std::min(x2, matteBounds.x2);
+    if ( (y >= matteBounds.y1) && (y < matteBounds.y2) && (matteX1 < matteX2) ) {
+        const int matteComps = (int)args.matteImage->getComponentsCount();
+        assert(args.alphaChannelIndex < matteComps);
+        const PIX* matte_pixels = (const PIX*)matteAcc.pixelAt(matteX1, y);
+        if (matte_pixels) {
+            matte_pixels += args.alphaChannelIndex;
+            for (int x = matteX1; x < matteX2; ++x, matte_pixels += matteComps) {
+                matteRow[x - x1] = Image::convertPixelDepth<PIX, float>(*matte_pixels);
+            }
+        }
+    }
+
+    return &matteRow[0];
+}
+
 template <typename PIX,int maxValue,bool opaque, bool applyMatte,int rOffset,int gOffset,int bOffset>
 void
 scaleToTexture8bits_generic(const RectI& roi,
@@ -1915,12 +1956,7 @@ scaleToTexture8bits_generic(const RectI& roi,
                             ViewerInstance* viewer,
                             U32* output)
 {
-    size_t pixelSize = sizeof(PIX);
-    
-    const bool luminance = (args.channels == eDisplayChannelsY);
-    
     Image::ReadAccess acc = Image::ReadAccess(args.inputImage.get());
-    const RectI srcImgBounds = args.inputImage->getBounds();
     
     ///offset the output buffer at the starting point
     U32* dst_pixels = output + (roi.y1 - args.texRect.y1) * args.texRect.w + (roi.x1 - args.texRect.x1);
@@ -1930,205 +1966,38 @@ scaleToTexture8bits_generic(const RectI& roi,
     
     const PIX* src_pixels = (const PIX*)acc.pixelAt(roi.x1, roi.y1);
     const int srcRowElements = (int)args.inputImage->getRowElements();
+    const int width = roi.x2 - roi.x1;
+    if (width <= 0) {
+        return;
+    }
     
     boost::shared_ptr<Image::ReadAccess> matteAcc;
+    std::vector<float> matteRow;
     if (applyMatte) {
         matteAcc.reset(new Image::ReadAccess(args.matteImage.get()));
+        matteRow.resize(width);
     }
+
+    ViewerRowConverter::Params params;
+    params.gain = args.gain;
+    params.offset = args.offset;
+    params.gamma = args.gamma;
+    params.gammaLut = viewer->getGammaLut(&params.gammaLutValuesCount);
+    params.luminance = (args.channels == eDisplayChannelsY);
+    params.colorSpace = args.colorSpace;
+    ViewerRowConverter converter(params, width);
     
     for (int y = roi.y1; y < roi.y2;
          ++y,
          dst_pixels += args.texRect.w) {
         
-        // coverity[dont_call]
-        int start = (int)(rand() % (roi.x2 - roi.x1));
+        loadViewerRow<PIX, opaque, rOffset, gOffset, bOffset>(src_pixels, nComps, width, args.srcColorSpace, converter);
         
-
-        for (int backward = 0; backward < 2; ++backward) {
-            
-            int index = backward ? start - 1 : start;
-            
-            assert( backward == 1 || ( index >= 0 && index < (args.texRect.x2 - args.texRect.x1) ) );
-
-            unsigned error_r = 0x80;
-            unsigned error_g = 0x80;
-            unsigned error_b = 0x80;
-            
-            while (index < (roi.x2 - roi.x1) && index >= 0) {
-                
-                double r = 0.;
-                double g = 0.;
-                double b = 0.;
-                int uA = 0;
-                double a = 0;
-                if (nComps >= 4) {
-                    r = (src_pixels ? src_pixels[index * nComps + rOffset] : 0.);
-                    g = (src_pixels ? src_pixels[index * nComps + gOffset] : 0.);
-                    b = (src_pixels ? src_pixels[index * nComps + bOffset] : 0.);
-                    if (opaque) {
-                        a = 1;
-                        uA = 255;
-                    } else {
-                        a = src_pixels ? src_pixels[index * nComps + 3] : 0;
-                        uA = Color::floatToInt<256>(a);
-                    }
-                } else if (nComps == 3) {
-                    // coverity[dead_error_line]
-                    r = (src_pixels && rOffset < nComps) ? src_pixels[index * nComps + rOffset] : 0.;
-                    // coverity[dead_error_line]
-                    g = (src_pixels && gOffset < nComps) ? src_pixels[index * nComps + gOffset] : 0.;
-                    // coverity[dead_error_line]
-                    b = (src_pixels && bOffset < nComps) ? src_pixels[index * nComps + bOffset] : 0.;
-                    a = (src_pixels ? 1 : 0);
-                    uA = a * 255;
-                } else if (nComps == 2) {
-                    // coverity[dead_error_line]
-                    r = (src_pixels && rOffset < nComps) ? src_pixels[index * nComps + rOffset] : 0.;
-                    // coverity[dead_error_line]
-                    g = (src_pixels && gOffset < nComps) ? src_pixels[index * nComps + gOffset] : 0.;
-                    b = 0;
-                    a = (src_pixels ? 1 : 0);
-                    uA = a * 255;
-                } else if (nComps == 1) {
-                    // coverity[dead_error_line]
-                    r = (src_pixels && rOffset < nComps) ? src_pixels[index * nComps + rOffset] : 0.;
-                    g = b = r;
-                    a = (src_pixels ? 1 : 0);
-                    uA = a * 255;
-                } else {
-                    assert(false);
-                }
-
-                
-                switch ( pixelSize ) {
-                    case sizeof(unsigned char): //byte
-                        if (args.srcColorSpace) {
-                            r = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)r );
-                            g = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)g );
-                            b = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)b );
-                        } else {
-                            r = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)r );
-                            g = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)g );
-                            b = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)b );
-                        }
-                        break;
-                    case sizeof(unsigned short): //short
-                        if (args.srcColorSpace) {
-                            r = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)r );
-                            g = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)g );
-                            b = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)b );
-                        } else {
-                            r = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)r );
-                            g = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)g );
-                            b = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)b );
-                        }
-                        break;
-                    case sizeof(float): //float
-                        if (args.srcColorSpace) {
-                            r = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(r);
-                            g = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(g);
-                            b = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(b);
-                        }
-                        break;
-                    default:
-                        break;
-                }
-                
-                //args.gamma is in fact 1. / gamma at this point
-                if  (args.gamma == 0) {
-                    r = 0;
-                    g = 0.;
-                    b = 0.;
-                } else if (args.gamma == 1.) {
-                    r = r * args.gain + args.offset;
-                    g = g * args.gain + args.offset;
-                    b = b * args.gain + args.offset;
-                } else {
-                    r = viewer->interpolateGammaLut(r * args.gain + args.offset);
-                    g = viewer->interpolateGammaLut(g * args.gain + args.offset);
-                    b = viewer->interpolateGammaLut(b * args.gain + args.offset);
-                }
+        const float* matte = applyMatte ? getViewerMatteRow<PIX>(args, *matteAcc, roi.x1, roi.x2, y, converter, matteRow) : NULL;
+        
+        // the dither is indexed by the pixel coordinates so that the tiles rendered by different threads match
+        converter.toBGRA8(width, roi.x1, y, matte, dst_pixels);
         
-                
-                if (luminance) {
-                    r = 0.299 * r + 0.587 * g + 0.114 * b;
-                    g = r;
-                    b = r;
-                }
-            
-                
-                U8 uR,uG,uB;
-                if (!args.colorSpace) {
-                    uR = Color::floatToInt<256>(r);
-                    uG = Color::floatToInt<256>(g);
-                    uB = Color::floatToInt<256>(b);
-                    
-                } else {
-                    error_r = (error_r & 0xff) + args.colorSpace->toColorSpaceUint8xxFromLinearFloatFast(r);
-                    error_g = (error_g & 0xff) + args.colorSpace->toColorSpaceUint8xxFromLinearFloatFast(g);
-                    error_b = (error_b & 0xff) + args.colorSpace->toColorSpaceUint8xxFromLinearFloatFast(b);
-                    assert(error_r < 0x10000 && error_g < 0x10000 && error_b < 0x10000);
-                    uR = (U8)(error_r >> 8);
-                    uG = (U8)(error_g >> 8);
-                    uB = (U8)(error_b >> 8);
-                }
-                
-                if (applyMatte) {
-                    double alphaMatteValue = 0;
-                    if (args.matteImage == args.inputImage) {
-                        switch (args.alphaChannelIndex) {
-                            case 0:
-                                alphaMatteValue = r;
-                                break;
-                            case 1:
-                                alphaMatteValue = g;
-                                break;
-                            case 2:
-                                alphaMatteValue = b;
-                                break;
-                            case 3:
-                                alphaMatteValue = a;
-                                break;
-                            default:
-                                break;
-                        }
-                    } else {
-                        const PIX* src_pixels = (const PIX*)matteAcc->pixelAt(roi.x1 + index, y);
-                        if (src_pixels) {
-                            alphaMatteValue = (double)src_pixels[args.alphaChannelIndex];
-                            switch ( pixelSize ) {
-                                case sizeof(unsigned char): //byte
-                                    alphaMatteValue = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)r );
-                                    break;
-                                case sizeof(unsigned short): //short
-                                    alphaMatteValue = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned short)r );
-                                    break;
-                                default:
-                                    break;
-                            }
-                        }
-                    }
-                    U8 matteA;
-                    if (args.colorSpace) {
-                        matteA = args.colorSpace->toColorSpaceUint8FromLinearFloatFast(alphaMatteValue) / 2;
-                    } else {
-                        matteA = Color::floatToInt<256>(alphaMatteValue) / 2;
-                    }
-                    uR = Image::clampIfInt<U8>((double)uR + matteA);
-                    
-                }
-                
-                dst_pixels[index] = toBGRA(uR,uG,uB,uA);
-                
-                if (backward) {
-                    --index;
-                } else {
-                    ++index;
-                }
-                
-            } // while (index < args.texRect.w && index >= 0) {
-            
-        } // for (int backward = 0; backward < 2; ++backward) {
         if (src_pixels) {
             src_pixels += srcRowElements;
         }
@@ -2288,17 +2157,22 @@ scaleToTexture8bits(const RectI& roi,
             scaleToTexture8bitsForDepth<unsigned short, 65535>(roi, args,viewer,output);
             break;
         case eImageBitDepthHalf:
-            assert(false);
+            scaleToTexture8bitsForDepth<Half, 1>(roi, args,viewer, output);
             break;
         case eImageBitDepthNone:
             break;
     }
 } // scaleToTexture8bits
 
-float
-ViewerInstance::interpolateGammaLut(float value)
+const float*
+ViewerInstance::getGammaLut(int* valuesCount) const
 {
-    return _imp->lookupGammaLut(value);
+    *valuesCount = GAMMA_LUT_NB_VALUES;
+    if ( _imp->gammaLookup.empty() ) {
+        return NULL;
+    }
+    
+    return &_imp->gammaLookup[0];
 }
 
 void
@@ -2314,158 +2188,45 @@ scaleToTexture32bitsGeneric(const RectI& roi,
                             int nComps,
                             float *output)
 {
-    size_t pixelSize = sizeof(PIX);
-    const bool luminance = (args.channels == eDisplayChannelsY);
-
     ///the width of the output buffer multiplied by the channels count
     const int dstRowElements = args.texRect.w * 4;
 
     
     Image::ReadAccess acc = Image::ReadAccess(args.inputImage.get());
-    boost::shared_ptr<Image::ReadAccess> matteAcc;
-    if (applyMatte) {
-        matteAcc.reset(new Image::ReadAccess(args.matteImage.get()));
-    }
     
     float* dst_pixels =  output + (roi.y1 - args.texRect.y1) * dstRowElements + (roi.x1 - args.texRect.x1) * 4;
-    const float* src_pixels = (const float*)acc.pixelAt(roi.x1, roi.y1);
+    const PIX* src_pixels = (const PIX*)acc.pixelAt(roi.x1, roi.y1);
 
     assert(args.texRect.w == args.texRect.x2 - args.texRect.x1);
     
     const int srcRowElements = (const int)args.inputImage->getRowElements();
+    const int width = roi.x2 - roi.x1;
+    if (width <= 0) {
+        return;
+    }
+
+    boost::shared_ptr<Image::ReadAccess> matteAcc;
+    std::vector<float> matteRow;
+    if (applyMatte) {
+        matteAcc.reset(new Image::ReadAccess(args.matteImage.get()));
+        matteRow.resize(width);
+    }
+
+    // the image is stored as linear, the OpenGL shader does gamma, gain and offset
+    ViewerRowConverter::Params params;
+    params.luminance = (args.channels == eDisplayChannelsY);
+    ViewerRowConverter converter(params, width);
     
     for (int y = roi.y1; y < roi.y2;
          ++y,
          dst_pixels += dstRowElements) {
 
-        for (int x = 0; x < roi.width();
-             ++x) {
-            
-            double r = 0.;
-            double g = 0.;
-            double b = 0.;
-            double a = 0.;
-            
-            if (nComps >= 4) {
-                r = (src_pixels && rOffset < nComps) ? src_pixels[x * nComps + rOffset] : 0.;
-                g = (src_pixels && gOffset < nComps) ? src_pixels[x * nComps + gOffset] : 0.;
-                b = (src_pixels && bOffset < nComps) ? src_pixels[x * nComps + bOffset] : 0.;
-                if (opaque) {
-                    a = 1.;
-                } else {
-                    a = src_pixels ? src_pixels[x * nComps + 3] : 0.;
-                }
-            } else if (nComps == 3) {
-                // coverity[dead_error_line]
-                r = (src_pixels && rOffset < nComps) ? src_pixels[x * nComps + rOffset] : 0.;
-                // coverity[dead_error_line]
-                g = (src_pixels && gOffset < nComps) ? src_pixels[x * nComps + gOffset] : 0.;
-                // coverity[dead_error_line]
-                b = (src_pixels && bOffset < nComps) ? src_pixels[x * nComps + bOffset] : 0.;
-                a = 1.;
-            } else if (nComps == 2) {
-                // coverity[dead_error_line]
-                r = (src_pixels && rOffset < nComps) ? src_pixels[x * nComps + rOffset] : 0.;
-                // coverity[dead_error_line]
-                g = (src_pixels && gOffset < nComps) ? src_pixels[x * nComps + gOffset] : 0.;
-                b = 0.;
-                a = 1.;
-            } else if (nComps == 1) {
-                // coverity[dead_error_line]
-                r = (src_pixels && rOffset < nComps) ? src_pixels[x * nComps + rOffset] : 0.;
-                g = b = r;
-                a = 1.;
-            } else {
-                assert(false);
-            }
-            
-            
-            switch ( pixelSize ) {
-            case sizeof(unsigned char):
-                if (args.srcColorSpace) {
-                    r = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)r );
-                    g = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)g );
-                    b = args.srcColorSpace->fromColorSpaceUint8ToLinearFloatFast( (unsigned char)b );
-                } else {
-                    r = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)r );
-                    g = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)g );
-                    b = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)b );
-                }
-                break;
-            case sizeof(unsigned short):
-                if (args.srcColorSpace) {
-                    r = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)r );
-                    g = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)g );
-                    b = args.srcColorSpace->fromColorSpaceUint16ToLinearFloatFast( (unsigned short)b );
-                } else {
-                    r = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)r );
-                    g = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)g );
-                    b = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned char)b );
-                }
-                break;
-            case sizeof(float):
-                if (args.srcColorSpace) {
-                    r = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(r);
-                    g = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(g);
-                    b = args.srcColorSpace->fromColorSpaceFloatToLinearFloat(b);
-                }
-                break;
-            default:
-                break;
-            }
-
+        loadViewerRow<PIX, opaque, rOffset, gOffset, bOffset>(src_pixels, nComps, width, args.srcColorSpace, converter);
 
-            if (luminance) {
-                r = 0.299 * r + 0.587 * g + 0.114 * b;
-                g = r;
-                b = r;
-            }
-            
-            if (applyMatte) {
-                double alphaMatteValue = 0;
-                if (args.matteImage == args.inputImage) {
-                    switch (args.alphaChannelIndex) {
-                        case 0:
-                            alphaMatteValue = r;
-                            break;
-                        case 1:
-                            alphaMatteValue = g;
-                            break;
-                        case 2:
-                            alphaMatteValue = b;
-                            break;
-                        case 3:
-                            alphaMatteValue = a;
-                            break;
-                        default:
-                            break;
-                    }
-                } else {
-                    const PIX* src_pixels = (const PIX*)matteAcc->pixelAt(x, y);
-                    if (src_pixels) {
-                        alphaMatteValue = (double)src_pixels[args.alphaChannelIndex];
-                        switch ( pixelSize ) {
-                            case sizeof(unsigned char): //byte
-                                alphaMatteValue = (double)Image::convertPixelDepth<unsigned char, float>( (unsigned char)r );
-                                break;
-                            case sizeof(unsigned short): //short
-                                alphaMatteValue = (double)Image::convertPixelDepth<unsigned short, float>( (unsigned short)r );
-                                break;
-                            default:
-                                break;
-                        }
-                    }
-                }
-                r += alphaMatteValue * 0.5;
-            }
+        const float* matte = applyMatte ? getViewerMatteRow<PIX>(args, *matteAcc, roi.x1, roi.x2, y, converter, matteRow) : NULL;
 
-            
-            dst_pixels[x * 4] = Image::clamp(r, 0., 1.);
-            dst_pixels[x * 4 + 1] = Image::clamp(g, 0., 1.);
-            dst_pixels[x * 4 + 2] = Image::clamp(b, 0., 1.);
-            dst_pixels[x * 4 + 3] = Image::clamp(a, 0., 1.);
+        converter.toRGBA32(width, matte, dst_pixels);
 
-        }
         if (src_pixels) {
             src_pixels += srcRowElements;
         }
@@ -2616,7 +2377,7 @@ scaleToTexture32bits(const RectI& roi,
             scaleToTexture32bitsForPremult<unsigned short, 65535>(roi, args, output);
             break;
         case eImageBitDepthHalf:
-            assert(false);
+            scaleToTexture32bitsForPremult<Half, 1>(roi, args, output);
             break;
         case eImageBitDepthNone:
             break;
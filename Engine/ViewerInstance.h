@@ -252,7 +252,11 @@ public:
     
     struct ViewerInstancePrivate;
     
-    float interpolateGammaLut(float value);
+    /**
+     * @brief Returns the look-up table of the viewer gamma, which has valuesCount + 1 entries, or NULL if it was not filled yet.
+     * The gamma look-up mutex must be locked for reading while it is used, as it is during the texture conversion.
+     **/
+    const float* getGammaLut(int* valuesCount) const;
     
     void markAllOnGoingRendersAsAborted();
     
@@ -412,23 +412,6 @@ public:
         }
     }
     
-    float lookupGammaLut(float value) const
-    {
-        if (value < 0.) {
-            return 0.;
-        } else if (value > 1.) {
-            return 1.;
-        } else {
-            int i = (int)(value * GAMMA_LUT_NB_VALUES);
-            assert(0 <= i && i <= GAMMA_LUT_NB_VALUES);
-            float alpha = std::max(0.f,std::min(value * GAMMA_LUT_NB_VALUES - i, 1.f));
-            float a = gammaLookup[i];
-            float b = (i  < GAMMA_LUT_NB_VALUES) ? gammaLookup[i + 1] : 0.f;
-            return a * (1.f - alpha) + b * alpha;
-        }
-
-    }
-    
     void reportProgress(const boost::shared_ptr<UpdateViewerParams>& originalParams,
                         const std::list<RectI>& rectangles,
                         const boost::shared_ptr<RenderStats>& stats,
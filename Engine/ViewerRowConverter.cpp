@@ -0,0 +1,744 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include "ViewerRowConverter.h"
+
+#include <cstring> // for memcpy
+#include <algorithm> // min, max
+#include <cassert>
+#include <limits>
+
+// SSE2 is part of x86-64
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define NATRON_VIEWER_SSE2
+#include <emmintrin.h>
+#endif
+
+NATRON_NAMESPACE_ENTER;
+
+/*
+ * 8x8 Bayer matrix. Each entry k is turned into the threshold 4 * k + 2, which is added to the
+ * 0x0-0xff00 output of the color-space lookup before keeping the high byte: on average this rounds
+ * like Color::uint8xxToChar() but the quantization error is spread over the block, so that
+ * smooth gradients do not band.
+ */
+static const unsigned char bayer8x8[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+///clamps to [0, 1], NaN being mapped to 0 like _mm_max_ps does
+static inline float
+clamp01(float v)
+{
+    v = (v > 0.f) ? v : 0.f;
+
+    return (v < 1.f) ? v : 1.f;
+}
+
+static void
+gainGammaRow_scalar(float* values,
+                    int n,
+                    float gain,
+                    float offset,
+                    const float* lut,
+                    int lutN)
+{
+    for (int i = 0; i < n; ++i) {
+        float x = clamp01(values[i] * gain + offset) * (float)lutN;
+        int idx = (int)std::min(x, (float)(lutN - 1));
+        float alpha = x - (float)idx;
+        values[i] = lut[idx] * (1.f - alpha) + lut[idx + 1] * alpha;
+    }
+}
+
+static void
+gainRow_scalar(float* values,
+               int n,
+               float gain,
+               float offset)
+{
+    for (int i = 0; i < n; ++i) {
+        values[i] = values[i] * gain + offset;
+    }
+}
+
+static void
+luminanceRow_scalar(float* r,
+                    float* g,
+                    float* b,
+                    int n)
+{
+    for (int i = 0; i < n; ++i) {
+        float l = 0.299f * r[i] + 0.587f * g[i] + 0.114f * b[i];
+        r[i] = g[i] = b[i] = l;
+    }
+}
+
+static void
+floatToByteRow_scalar(const float* from,
+                      unsigned char* to,
+                      int n)
+{
+    for (int i = 0; i < n; ++i) {
+        to[i] = (unsigned char)(int)(clamp01(from[i]) * 255.f + 0.5f);
+    }
+}
+
+static void
+ditherRow_scalar(const unsigned short* from,
+                 const unsigned short* thresholds,
+                 unsigned char* to,
+                 int n)
+{
+    for (int i = 0; i < n; ++i) {
+        to[i] = (unsigned char)( (from[i] + thresholds[i & 7]) >> 8 );
+    }
+}
+
+static void
+addMatteRow_scalar(const unsigned char* matte,
+                   unsigned char* to,
+                   int n)
+{
+    for (int i = 0; i < n; ++i) {
+        int v = to[i] + matte[i];
+        to[i] = (unsigned char)std::min(v, 255);
+    }
+}
+
+/// Actually converting to ARGB... but it is called BGRA by the texture format GL_UNSIGNED_INT_8_8_8_8_REV
+static void
+packBGRARow_scalar(const unsigned char* r,
+                   const unsigned char* g,
+                   const unsigned char* b,
+                   const unsigned char* a,
+                   U32* dst,
+                   int n)
+{
+    for (int i = 0; i < n; ++i) {
+        dst[i] = ( (U32)a[i] << 24 ) | ( (U32)r[i] << 16 ) | ( (U32)g[i] << 8 ) | (U32)b[i];
+    }
+}
+
+static void
+packRGBA32Row_scalar(const float* r,
+                     const float* g,
+                     const float* b,
+                     const float* a,
+                     float* dst,
+                     int n)
+{
+    for (int i = 0; i < n; ++i) {
+        dst[i * 4] = clamp01(r[i]);
+        dst[i * 4 + 1] = clamp01(g[i]);
+        dst[i * 4 + 2] = clamp01(b[i]);
+        dst[i * 4 + 3] = clamp01(a[i]);
+    }
+}
+
+static void
+findMinMaxRow_scalar(const float* pixels,
+                     int nComps,
+                     int n,
+                     DisplayChannelsEnum channels,
+                     double* vmin,
+                     double* vmax)
+{
+    double localVmin = *vmin;
+    double localVmax = *vmax;
+
+    for (int x = 0; x < n; ++x, pixels += nComps) {
+        double r = 0.;
+        double g = 0.;
+        double b = 0.;
+        double a = 0.;
+        switch (nComps) {
+        case 4:
+            r = pixels[0];
+            g = pixels[1];
+            b = pixels[2];
+            a = pixels[3];
+            break;
+        case 3:
+            r = pixels[0];
+            g = pixels[1];
+            b = pixels[2];
+            a = 1.;
+            break;
+        case 2:
+            r = pixels[0];
+            g = pixels[1];
+            b = 0.;
+            a = 1.;
+            break;
+        case 1:
+            a = pixels[0];
+            r = g = b = 0.;
+            break;
+        default:
+            r = g = b = a = 0.;
+        }
+
+        double mini, maxi;
+        switch (channels) {
+        case eDisplayChannelsRGB:
+            mini = std::min(std::min(r, g), b);
+            maxi = std::max(std::max(r, g), b);
+            break;
+        case eDisplayChannelsY:
+            mini = 0.299 * r + 0.587 * g + 0.114 * b;
+            maxi = mini;
+            break;
+        case eDisplayChannelsR:
+            mini = r;
+            maxi = mini;
+            break;
+        case eDisplayChannelsG:
+            mini = g;
+            maxi = mini;
+            break;
+        case eDisplayChannelsB:
+            mini = b;
+            maxi = mini;
+            break;
+        case eDisplayChannelsA:
+            mini = a;
+            maxi = mini;
+            break;
+        default:
+            mini = 0.;
+            maxi = 0.;
+            break;
+        }
+        if (mini < localVmin) {
+            localVmin = mini;
+        }
+        if (maxi > localVmax) {
+            localVmax = maxi;
+        }
+    }
+    *vmin = localVmin;
+    *vmax = localVmax;
+} // findMinMaxRow_scalar
+
+#ifdef NATRON_VIEWER_SSE2
+// SSE2 has no gather: the gamma interpolation is vectorized, the two look-ups per value are not
+static void
+gainGammaRow_SSE2(float* values,
+                  int n,
+                  float gain,
+                  float offset,
+                  const float* lut,
+                  int lutN)
+{
+    const __m128 gain4 = _mm_set1_ps(gain);
+    const __m128 offset4 = _mm_set1_ps(offset);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 scale = _mm_set1_ps( (float)lutN );
+    const __m128 maxIndex = _mm_set1_ps( (float)(lutN - 1) );
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(values + i), gain4), offset4);
+        __m128 x = _mm_mul_ps(_mm_min_ps(_mm_max_ps(v, zero), one), scale);
+        __m128i idx = _mm_cvttps_epi32( _mm_min_ps(x, maxIndex) );
+        __m128 alpha = _mm_sub_ps( x, _mm_cvtepi32_ps(idx) );
+        int k[4];
+        _mm_storeu_si128( (__m128i*)k, idx );
+        __m128 lo = _mm_setr_ps(lut[k[0]], lut[k[1]], lut[k[2]], lut[k[3]]);
+        __m128 hi = _mm_setr_ps(lut[k[0] + 1], lut[k[1] + 1], lut[k[2] + 1], lut[k[3] + 1]);
+        _mm_storeu_ps( values + i, _mm_add_ps( _mm_mul_ps( lo, _mm_sub_ps(one, alpha) ), _mm_mul_ps(hi, alpha) ) );
+    }
+    gainGammaRow_scalar(values + i, n - i, gain, offset, lut, lutN);
+}
+
+static void
+gainRow_SSE2(float* values,
+             int n,
+             float gain,
+             float offset)
+{
+    const __m128 gain4 = _mm_set1_ps(gain);
+    const __m128 offset4 = _mm_set1_ps(offset);
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps( values + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(values + i), gain4), offset4) );
+    }
+    gainRow_scalar(values + i, n - i, gain, offset);
+}
+
+static void
+luminanceRow_SSE2(float* r,
+                  float* g,
+                  float* b,
+                  int n)
+{
+    const __m128 kr = _mm_set1_ps(0.299f);
+    const __m128 kg = _mm_set1_ps(0.587f);
+    const __m128 kb = _mm_set1_ps(0.114f);
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 l = _mm_add_ps( _mm_add_ps( _mm_mul_ps( kr, _mm_loadu_ps(r + i) ), _mm_mul_ps( kg, _mm_loadu_ps(g + i) ) ),
+                               _mm_mul_ps( kb, _mm_loadu_ps(b + i) ) );
+        _mm_storeu_ps(r + i, l);
+        _mm_storeu_ps(g + i, l);
+        _mm_storeu_ps(b + i, l);
+    }
+    luminanceRow_scalar(r + i, g + i, b + i, n - i);
+}
+
+static void
+floatToByteRow_SSE2(const float* from,
+                    unsigned char* to,
+                    int n)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 scale = _mm_set1_ps(255.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128 v0 = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(from + i), zero), one);
+        __m128 v1 = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(from + i + 4), zero), one);
+        __m128i i0 = _mm_cvttps_epi32( _mm_add_ps(_mm_mul_ps(v0, scale), half) );
+        __m128i i1 = _mm_cvttps_epi32( _mm_add_ps(_mm_mul_ps(v1, scale), half) );
+        __m128i s = _mm_packs_epi32(i0, i1);
+        _mm_storel_epi64( (__m128i*)(to + i), _mm_packus_epi16(s, s) );
+    }
+    floatToByteRow_scalar(from + i, to + i, n - i);
+}
+
+static void
+ditherRow_SSE2(const unsigned short* from,
+               const unsigned short* thresholds,
+               unsigned char* to,
+               int n)
+{
+    const __m128i t = _mm_loadu_si128( (const __m128i*)thresholds );
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_srli_epi16( _mm_add_epi16(_mm_loadu_si128( (const __m128i*)(from + i) ), t), 8 );
+        _mm_storel_epi64( (__m128i*)(to + i), _mm_packus_epi16(v, v) );
+    }
+    // i is a multiple of 8, the thresholds are still aligned with the pixels
+    ditherRow_scalar(from + i, thresholds, to + i, n - i);
+}
+
+static void
+addMatteRow_SSE2(const unsigned char* matte,
+                 unsigned char* to,
+                 int n)
+{
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_adds_epu8( _mm_loadu_si128( (const __m128i*)(to + i) ), _mm_loadu_si128( (const __m128i*)(matte + i) ) );
+        _mm_storeu_si128( (__m128i*)(to + i), v );
+    }
+    addMatteRow_scalar(matte + i, to + i, n - i);
+}
+
+static void
+packBGRARow_SSE2(const unsigned char* r,
+                 const unsigned char* g,
+                 const unsigned char* b,
+                 const unsigned char* a,
+                 U32* dst,
+                 int n)
+{
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i vr = _mm_loadu_si128( (const __m128i*)(r + i) );
+        __m128i vg = _mm_loadu_si128( (const __m128i*)(g + i) );
+        __m128i vb = _mm_loadu_si128( (const __m128i*)(b + i) );
+        __m128i va = _mm_loadu_si128( (const __m128i*)(a + i) );
+        // bytes in memory are B,G,R,A: on x86 this is the U32 (a << 24) | (r << 16) | (g << 8) | b
+        __m128i bgLo = _mm_unpacklo_epi8(vb, vg);
+        __m128i bgHi = _mm_unpackhi_epi8(vb, vg);
+        __m128i raLo = _mm_unpacklo_epi8(vr, va);
+        __m128i raHi = _mm_unpackhi_epi8(vr, va);
+        __m128i* out = (__m128i*)(dst + i);
+        _mm_storeu_si128( out, _mm_unpacklo_epi16(bgLo, raLo) );
+        _mm_storeu_si128( out + 1, _mm_unpackhi_epi16(bgLo, raLo) );
+        _mm_storeu_si128( out + 2, _mm_unpacklo_epi16(bgHi, raHi) );
+        _mm_storeu_si128( out + 3, _mm_unpackhi_epi16(bgHi, raHi) );
+    }
+    packBGRARow_scalar(r + i, g + i, b + i, a + i, dst + i, n - i);
+}
+
+static void
+packRGBA32Row_SSE2(const float* r,
+                   const float* g,
+                   const float* b,
+                   const float* a,
+                   float* dst,
+                   int n)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 vr = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(r + i), zero), one);
+        __m128 vg = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(g + i), zero), one);
+        __m128 vb = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(b + i), zero), one);
+        __m128 va = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(a + i), zero), one);
+        _MM_TRANSPOSE4_PS(vr, vg, vb, va);
+        _mm_storeu_ps(dst + i * 4, vr);
+        _mm_storeu_ps(dst + i * 4 + 4, vg);
+        _mm_storeu_ps(dst + i * 4 + 8, vb);
+        _mm_storeu_ps(dst + i * 4 + 12, va);
+    }
+    packRGBA32Row_scalar(r + i, g + i, b + i, a + i, dst + i * 4, n - i);
+}
+
+// _mm_min_ps(v, acc) is v < acc ? v : acc, like the comparisons of the scalar loop: NaNs are never kept.
+// std::min(a, b) is b < a ? b : a and std::max(a, b) is a < b ? b : a, hence the order of the operands below.
+// Returns the number of pixels done, the caller finishes the row with the scalar loop
+static int
+findMinMaxRow_SSE2(const float* pixels,
+                   int nComps,
+                   int n,
+                   DisplayChannelsEnum channels,
+                   double* vmin,
+                   double* vmax)
+{
+    int x = 0;
+
+    if ( (nComps == 4) && (channels == eDisplayChannelsY) ) {
+        // the luminance is computed in double precision as the scalar loop does
+        const __m128d kr = _mm_set1_pd(0.299);
+        const __m128d kg = _mm_set1_pd(0.587);
+        const __m128d kb = _mm_set1_pd(0.114);
+        __m128d lo = _mm_set1_pd(*vmin);
+        __m128d hi = _mm_set1_pd(*vmax);
+        for (; x + 2 <= n; x += 2) {
+            const __m128 p0 = _mm_loadu_ps(pixels + x * 4);
+            const __m128 p1 = _mm_loadu_ps(pixels + x * 4 + 4);
+            const __m128 rg = _mm_unpacklo_ps(p0, p1); // r0 r1 g0 g1
+            const __m128 ba = _mm_unpackhi_ps(p0, p1); // b0 b1 a0 a1
+            const __m128d r = _mm_cvtps_pd(rg);
+            const __m128d g = _mm_cvtps_pd( _mm_movehl_ps(rg, rg) );
+            const __m128d b = _mm_cvtps_pd(ba);
+            const __m128d y = _mm_add_pd( _mm_add_pd( _mm_mul_pd(kr, r), _mm_mul_pd(kg, g) ), _mm_mul_pd(kb, b) );
+            lo = _mm_min_pd(y, lo);
+            hi = _mm_max_pd(y, hi);
+        }
+        double los[2], his[2];
+        _mm_storeu_pd(los, lo);
+        _mm_storeu_pd(his, hi);
+        *vmin = std::min(los[0], los[1]);
+        *vmax = std::max(his[0], his[1]);
+
+        return x;
+    }
+
+    if ( (nComps != 4) && !(nComps == 1 && channels == eDisplayChannelsA) ) {
+        return 0;
+    }
+
+    __m128 lo = _mm_set1_ps( std::numeric_limits<float>::infinity() );
+    __m128 hi = _mm_set1_ps( -std::numeric_limits<float>::infinity() );
+    if (nComps == 1) {
+        for (; x + 4 <= n; x += 4) {
+            const __m128 v = _mm_loadu_ps(pixels + x);
+            lo = _mm_min_ps(v, lo);
+            hi = _mm_max_ps(v, hi);
+        }
+    } else {
+        for (; x + 4 <= n; x += 4) {
+            __m128 r = _mm_loadu_ps(pixels + x * 4);
+            __m128 g = _mm_loadu_ps(pixels + x * 4 + 4);
+            __m128 b = _mm_loadu_ps(pixels + x * 4 + 8);
+            __m128 a = _mm_loadu_ps(pixels + x * 4 + 12);
+            _MM_TRANSPOSE4_PS(r, g, b, a);
+            __m128 mini, maxi;
+            switch (channels) {
+            case eDisplayChannelsRGB:
+                mini = _mm_min_ps( b, _mm_min_ps(g, r) );
+                maxi = _mm_max_ps( b, _mm_max_ps(g, r) );
+                break;
+            case eDisplayChannelsR:
+                mini = maxi = r;
+                break;
+            case eDisplayChannelsG:
+                mini = maxi = g;
+                break;
+            case eDisplayChannelsB:
+                mini = maxi = b;
+                break;
+            case eDisplayChannelsA:
+                mini = maxi = a;
+                break;
+            default:
+                mini = maxi = _mm_setzero_ps();
+                break;
+            }
+            lo = _mm_min_ps(mini, lo);
+            hi = _mm_max_ps(maxi, hi);
+        }
+    }
+    float los[4], his[4];
+    _mm_storeu_ps(los, lo);
+    _mm_storeu_ps(his, hi);
+    for (int i = 0; i < 4; ++i) {
+        if (los[i] < *vmin) {
+            *vmin = los[i];
+        }
+        if (his[i] > *vmax) {
+            *vmax = his[i];
+        }
+    }
+
+    return x;
+} // findMinMaxRow_SSE2
+
+#endif // NATRON_VIEWER_SSE2
+
+ViewerRowConverter::ViewerRowConverter(const Params& params,
+                                       int maxWidth,
+                                       Color::SIMDLevelEnum simd)
+    : _params(params)
+    , _simd(simd)
+    , _r(maxWidth)
+    , _g(maxWidth)
+    , _b(maxWidth)
+    , _a(maxWidth)
+    , _uint8xx(maxWidth)
+    , _uR(maxWidth)
+    , _uG(maxWidth)
+    , _uB(maxWidth)
+    , _uA(maxWidth)
+    , _uMatte(maxWidth)
+{
+    assert(maxWidth > 0);
+    assert(params.gamma == 1. || params.gamma == 0. || (params.gammaLut && params.gammaLutValuesCount > 0));
+#ifndef NATRON_VIEWER_SSE2
+    _simd = Color::eSIMDLevelNone;
+#endif
+}
+
+void
+ViewerRowConverter::applyGainGamma(float* values,
+                                   int n) const
+{
+    //_params.gamma is in fact 1. / gamma at this point
+    if (_params.gamma == 0.) {
+        std::fill(values, values + n, 0.f);
+    } else if (_params.gamma == 1.) {
+#ifdef NATRON_VIEWER_SSE2
+        if (_simd != Color::eSIMDLevelNone) {
+            gainRow_SSE2(values, n, (float)_params.gain, (float)_params.offset);
+
+            return;
+        }
+#endif
+        gainRow_scalar(values, n, (float)_params.gain, (float)_params.offset);
+    } else {
+#ifdef NATRON_VIEWER_SSE2
+        if (_simd != Color::eSIMDLevelNone) {
+            gainGammaRow_SSE2(values, n, (float)_params.gain, (float)_params.offset, _params.gammaLut, _params.gammaLutValuesCount);
+
+            return;
+        }
+#endif
+        gainGammaRow_scalar(values, n, (float)_params.gain, (float)_params.offset, _params.gammaLut, _params.gammaLutValuesCount);
+    }
+}
+
+void
+ViewerRowConverter::applyLuminance(int n)
+{
+#ifdef NATRON_VIEWER_SSE2
+    if (_simd != Color::eSIMDLevelNone) {
+        luminanceRow_SSE2(&_r[0], &_g[0], &_b[0], n);
+
+        return;
+    }
+#endif
+    luminanceRow_scalar(&_r[0], &_g[0], &_b[0], n);
+}
+
+void
+ViewerRowConverter::quantize(const float* values,
+                             int n,
+                             int x,
+                             int y,
+                             bool dither,
+                             unsigned char* to)
+{
+    if (!dither || !_params.colorSpace) {
+#ifdef NATRON_VIEWER_SSE2
+        if (_simd != Color::eSIMDLevelNone) {
+            floatToByteRow_SSE2(values, to, n);
+
+            return;
+        }
+#endif
+        floatToByteRow_scalar(values, to, n);
+
+        return;
+    }
+
+    _params.colorSpace->toColorSpaceUint8xxFromLinearFloatFast(values, &_uint8xx[0], n, 1, -1, _simd);
+
+    unsigned short thresholds[8];
+    for (int i = 0; i < 8; ++i) {
+        thresholds[i] = bayer8x8[y & 7][(x + i) & 7] * 4 + 2;
+    }
+#ifdef NATRON_VIEWER_SSE2
+    if (_simd != Color::eSIMDLevelNone) {
+        ditherRow_SSE2(&_uint8xx[0], thresholds, to, n);
+
+        return;
+    }
+#endif
+    ditherRow_scalar(&_uint8xx[0], thresholds, to, n);
+}
+
+void
+ViewerRowConverter::toBGRA8(int n,
+                            int x,
+                            int y,
+                            const float* matte,
+                            U32* dst)
+{
+    assert( n >= 0 && n <= (int)_r.size() );
+    if (n <= 0) {
+        return;
+    }
+
+    applyGainGamma(&_r[0], n);
+    applyGainGamma(&_g[0], n);
+    applyGainGamma(&_b[0], n);
+    if (_params.luminance) {
+        applyLuminance(n);
+    }
+
+    quantize(&_r[0], n, x, y, true, &_uR[0]);
+    if (_params.luminance) {
+        std::memcpy( &_uG[0], &_uR[0], n * sizeof(unsigned char) );
+        std::memcpy( &_uB[0], &_uR[0], n * sizeof(unsigned char) );
+    } else {
+        quantize(&_g[0], n, x, y, true, &_uG[0]);
+        quantize(&_b[0], n, x, y, true, &_uB[0]);
+    }
+    quantize(&_a[0], n, x, y, false, &_uA[0]);
+
+    if (matte) {
+        if (_params.colorSpace) {
+            _params.colorSpace->toColorSpaceUint8xxFromLinearFloatFast(matte, &_uint8xx[0], n, 1, -1, _simd);
+            for (int i = 0; i < n; ++i) {
+                _uMatte[i] = Color::uint8xxToChar(_uint8xx[i]) / 2;
+            }
+        } else {
+            quantize(matte, n, x, y, false, &_uMatte[0]);
+            for (int i = 0; i < n; ++i) {
+                _uMatte[i] /= 2;
+            }
+        }
+#ifdef NATRON_VIEWER_SSE2
+        if (_simd != Color::eSIMDLevelNone) {
+            addMatteRow_SSE2(&_uMatte[0], &_uR[0], n);
+        } else
+#endif
+        {
+            addMatteRow_scalar(&_uMatte[0], &_uR[0], n);
+        }
+    }
+
+#ifdef NATRON_VIEWER_SSE2
+    if (_simd != Color::eSIMDLevelNone) {
+        packBGRARow_SSE2(&_uR[0], &_uG[0], &_uB[0], &_uA[0], dst, n);
+
+        return;
+    }
+#endif
+    packBGRARow_scalar(&_uR[0], &_uG[0], &_uB[0], &_uA[0], dst, n);
+} // ViewerRowConverter::toBGRA8
+
+void
+ViewerRowConverter::toRGBA32(int n,
+                             const float* matte,
+                             float* dst)
+{
+    assert( n >= 0 && n <= (int)_r.size() );
+    if (n <= 0) {
+        return;
+    }
+
+    if (_params.luminance) {
+        applyLuminance(n);
+    }
+    if (matte) {
+        for (int i = 0; i < n; ++i) {
+            _r[i] += matte[i] * 0.5f;
+        }
+    }
+
+#ifdef NATRON_VIEWER_SSE2
+    if (_simd != Color::eSIMDLevelNone) {
+        packRGBA32Row_SSE2(&_r[0], &_g[0], &_b[0], &_a[0], dst, n);
+
+        return;
+    }
+#endif
+    packRGBA32Row_scalar(&_r[0], &_g[0], &_b[0], &_a[0], dst, n);
+}
+
+void
+ViewerRowConverter::findMinMax(const float* pixels,
+                               int nComps,
+                               int n,
+                               DisplayChannelsEnum channels,
+                               double* vmin,
+                               double* vmax,
+                               Color::SIMDLevelEnum simd)
+{
+    int done = 0;
+
+#ifdef NATRON_VIEWER_SSE2
+    if (simd != Color::eSIMDLevelNone) {
+        done = findMinMaxRow_SSE2(pixels, nComps, n, channels, vmin, vmax);
+    }
+#else
+    (void)simd;
+#endif
+    findMinMaxRow_scalar(pixels + done * nComps, nComps, n - done, channels, vmin, vmax);
+}
+
+NATRON_NAMESPACE_EXIT;
@@ -0,0 +1,145 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+#ifndef NATRON_ENGINE_VIEWERROWCONVERTER_H
+#define NATRON_ENGINE_VIEWERROWCONVERTER_H
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <vector>
+
+#include "Global/Macros.h"
+#include "Global/GlobalDefines.h"
+#include "Engine/Lut.h"
+#include "Engine/EngineFwd.h"
+
+NATRON_NAMESPACE_ENTER;
+
+/**
+ * @brief Converts rows of linear float planes to the textures uploaded by the viewer: 8-bit BGRA compressed
+ * to the display color-space, or 32-bit float RGBA left linear for the shader.
+ *
+ * The caller fills the red(), green(), blue() and alpha() planes with the linear values of the first n pixels
+ * of a row and then calls toBGRA8() or toRGBA32(). All stages work on whole rows with SSE2 when available.
+ *
+ * The 8-bit output is dithered with an 8x8 ordered (Bayer) matrix indexed by the pixel coordinates in the
+ * texture: the result is deterministic and does not depend on how the texture is split in tiles across threads.
+ *
+ * An instance holds the scratch buffers of one thread, it is not thread-safe but is cheap to create per tile.
+ **/
+class ViewerRowConverter
+{
+public:
+
+    struct Params
+    {
+        Params()
+        : gain(1.)
+        , offset(0.)
+        , gamma(1.)
+        , gammaLut(0)
+        , gammaLutValuesCount(0)
+        , luminance(false)
+        , colorSpace(0)
+        {
+        }
+
+        double gain;
+        double offset;
+
+        /// This is 1 / the gamma of the viewer. Only used by toBGRA8()
+        double gamma;
+
+        /// The lookup table of pow(x, gamma) sampled at gammaLutValuesCount + 1 positions in [0, 1]
+        const float* gammaLut;
+        int gammaLutValuesCount;
+
+        /// When true the red plane receives the Rec.601 luminance, which is then displayed on all channels
+        bool luminance;
+
+        /// The display color-space for toBGRA8(), NULL for linear
+        const Color::Lut* colorSpace;
+    };
+
+    /**
+     * @param maxWidth The maximum number of pixels converted by a call
+     * @param simd Only exposed for testing: the output is the same with any level
+     **/
+    ViewerRowConverter(const Params& params,
+                       int maxWidth,
+                       Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+    float* red() { return &_r[0]; }
+
+    float* green() { return &_g[0]; }
+
+    float* blue() { return &_b[0]; }
+
+    float* alpha() { return &_a[0]; }
+
+    /**
+     * @brief Applies gain, offset, gamma and luminance to the planes, quantizes them with the ordered dither
+     * of the pixels (x, y) to (x + n - 1, y) and packs them to dst.
+     * If matte is not NULL, half of its value is added to the red channel after the quantization.
+     * matte may point to one of the planes of this converter, it is then read after gamma and luminance.
+     * The planes are modified.
+     **/
+    void toBGRA8(int n, int x, int y, const float* matte, U32* dst);
+
+    /**
+     * @brief Applies luminance to the planes, adds half of matte (if not NULL) to red, clamps all channels
+     * to [0, 1] and interleaves them to dst, which receives 4 * n floats. Gain and gamma are left to the shader.
+     * The planes are modified.
+     **/
+    void toRGBA32(int n, const float* matte, float* dst);
+
+    /**
+     * @brief Lowers vmin and raises vmax to the minimum and maximum of the values displayed for channels
+     * in n pixels of nComps interleaved floats: this is what the auto-contrast of the viewer looks for.
+     * NaNs are ignored. The result is the same with any SIMD level, which is only exposed for testing.
+     **/
+    static void findMinMax(const float* pixels,
+                           int nComps,
+                           int n,
+                           DisplayChannelsEnum channels,
+                           double* vmin,
+                           double* vmax,
+                           Color::SIMDLevelEnum simd = Color::getSupportedSIMDLevel());
+
+private:
+
+    void applyGainGamma(float* values, int n) const;
+
+    void applyLuminance(int n);
+
+    void quantize(const float* values, int n, int x, int y, bool dither, unsigned char* to);
+
+    Params _params;
+    Color::SIMDLevelEnum _simd;
+    std::vector<float> _r, _g, _b, _a;
+    std::vector<unsigned short> _uint8xx;
+    std::vector<unsigned char> _uR, _uG, _uB, _uA, _uMatte;
+};
+
+NATRON_NAMESPACE_EXIT;
+
+#endif // NATRON_ENGINE_VIEWERROWCONVERTER_H
@@ -116,8 +116,14 @@ typedef OfxRangeD RangeD;
 
 #define kBgProcessServerCreatedShort "--bg_server_created"
 
+///sent by the render daemon to the client once the job it submitted is over
+#define kRenderDaemonJobSucceededShort "--job_succeeded"
+#define kRenderDaemonJobFailedShort "--job_failed"
+
 //Increment this to wipe all disk cache structure and ensure that the user has a clean cache when starting the next version of Natron
-#define NATRON_CACHE_VERSION 3
+//5: the keys of the cache are hashed with XXH64 instead of CRC64, see Hash64
+//6: the node hash combines the memoized hash of the node itself with the hash of its inputs, see Node::computeHashInternal
+#define NATRON_CACHE_VERSION 6
 #define kNatronCacheVersionSettingsKey "NatronCacheVersionSettingsKey"
 
 
@@ -93,7 +93,6 @@ namespace NATRON_NAMESPACE { }
 #define NATRON_ENV_VAR_VALUE_END_TAG "</Value>"
 
 #define NATRON_PROJECT_ENV_VAR_MAX_RECURSION 100
-#define NATRON_MAX_CACHE_FILES_OPENED 20000
 #define NATRON_CUSTOM_HTML_TAG_START "<" NATRON_APPLICATION_NAME ">"
 #define NATRON_CUSTOM_HTML_TAG_END "</" NATRON_APPLICATION_NAME ">"
 
@@ -471,6 +470,15 @@ inline T ignore_result(T x)
 }
 #endif
 
+/* NATRON_THREAD_LOCAL */
+
+// Storage class of variables with one instance per thread, the variable must be a POD with static storage.
+#if COMPILER(MSVC)
+#define NATRON_THREAD_LOCAL __declspec(thread)
+#else
+#define NATRON_THREAD_LOCAL __thread
+#endif
+
 /* OVERRIDE and FINAL */
 
 #if COMPILER_SUPPORTS(CXX_OVERRIDE_CONTROL) &&  !COMPILER(MSVC) //< patch so msvc 2010 ignores the override and final keywords.
@@ -30,6 +30,7 @@
 
 #include "Engine/AppManager.h"
 #include "Engine/CLArgs.h"
+#include "Engine/RenderDaemon.h"
 
 NATRON_NAMESPACE_USING
 
@@ -42,6 +43,12 @@ main(int argc,
         return 1;
     }
 
+    if ( args.isRenderDaemonClient() ) {
+        ///The render is done by the daemon: do not load anything
+        QCoreApplication app(argc,argv);
+        return RenderDaemon::submitJob(args);
+    }
+
     AppManager manager;
 
     // coverity[tainted_data]
@@ -25,6 +25,10 @@
 
 #include "BaseTest.h"
 
+#include <algorithm>
+#include <iostream>
+#include <set>
+
 #include <QFile>
 
 #include "Engine/Node.h"
@@ -32,11 +36,17 @@
 #include "Engine/AppManager.h"
 #include "Engine/AppInstance.h"
 #include "Engine/KnobTypes.h"
+#include "Engine/NativeExpression.h"
+#include "Engine/ParallelRenderArgs.h"
 #include "Engine/EffectInstance.h"
 #include "Engine/Plugin.h"
+#include "Engine/Settings.h"
+#include "Engine/TimeLine.h"
+#include "Engine/Image.h"
 #include "Engine/Curve.h"
 #include "Engine/CLArgs.h"
 #include "Engine/ViewIdx.h"
+#include "Engine/Timer.h"
 
 NATRON_NAMESPACE_USING
 
@@ -281,6 +291,359 @@ TEST_F(BaseTest,SetValues)
     
 }
 
+///1000 nodes whose radius is an expression of the radius of a single base node: the expressions must give the
+///same results when they are evaluated for the first time at a frame and when their result is already cached,
+///and changing the base must invalidate all results.
+TEST_F(BaseTest,ExpressionLinkedComp)
+{
+    const int nNodes = 1000;
+    const int nFrames = 10;
+    
+    NodePtr base = createNode(_dotGeneratorPluginID);
+    ASSERT_TRUE(base);
+    KnobDouble* baseRadius = dynamic_cast<KnobDouble*>(base->getKnobByName("radius").get());
+    ASSERT_TRUE(baseRadius);
+    baseRadius->setValue(1.);
+    
+    std::vector<KnobDouble*> radii;
+    std::string expr = base->getScriptName() + ".radius.get() * 2 + frame";
+    for (int i = 0; i < nNodes; ++i) {
+        NodePtr node = createNode(_dotGeneratorPluginID);
+        ASSERT_TRUE(node);
+        KnobDouble* radius = dynamic_cast<KnobDouble*>(node->getKnobByName("radius").get());
+        ASSERT_TRUE(radius);
+        radius->setExpression(0, expr, false);
+        radii.push_back(radius);
+    }
+    
+    for (int f = 0; f < nFrames; ++f) {
+        for (int i = 0; i < nNodes; ++i) {
+            EXPECT_EQ(radii[i]->getValueAtTime(f), 2. + f);
+        }
+    }
+    double sum = 0.;
+    for (int f = 0; f < nFrames; ++f) {
+        for (int i = 0; i < nNodes; ++i) {
+            sum += radii[i]->getValueAtTime(f);
+        }
+    }
+    EXPECT_EQ(sum, nNodes * (2. * nFrames + nFrames * (nFrames - 1) / 2.));
+    
+    ///The results must not outlive a change of a parameter the expressions depend on
+    baseRadius->setValue(10.);
+    for (int f = 0; f < nFrames; ++f) {
+        for (int i = 0; i < nNodes; ++i) {
+            EXPECT_EQ(radii[i]->getValueAtTime(f), 20. + f);
+        }
+    }
+}
+
+///Benchmark, run with --gtest_also_run_disabled_tests --gtest_filter=BaseTest.DISABLED_ExpressionLinkedCompBenchmark
+///Prints the evaluation rate of the expressions of the comp of ExpressionLinkedComp when they are evaluated for the
+///first time at a frame and when their result is already cached
+TEST_F(BaseTest,DISABLED_ExpressionLinkedCompBenchmark)
+{
+    const int nNodes = 1000;
+    const int nFrames = 10;
+    
+    NodePtr base = createNode(_dotGeneratorPluginID);
+    ASSERT_TRUE(base);
+    KnobDouble* baseRadius = dynamic_cast<KnobDouble*>(base->getKnobByName("radius").get());
+    ASSERT_TRUE(baseRadius);
+    baseRadius->setValue(1.);
+    
+    std::vector<KnobDouble*> radii;
+    std::string expr = base->getScriptName() + ".radius.get() * 2 + frame";
+    for (int i = 0; i < nNodes; ++i) {
+        NodePtr node = createNode(_dotGeneratorPluginID);
+        ASSERT_TRUE(node);
+        KnobDouble* radius = dynamic_cast<KnobDouble*>(node->getKnobByName("radius").get());
+        ASSERT_TRUE(radius);
+        radius->setExpression(0, expr, false);
+        radii.push_back(radius);
+    }
+    
+    TimeLapse timer;
+    double sum = 0.;
+    for (int f = 0; f < nFrames; ++f) {
+        for (int i = 0; i < nNodes; ++i) {
+            sum += radii[i]->getValueAtTime(f);
+        }
+    }
+    double evalTime = timer.getTimeElapsedReset();
+    for (int f = 0; f < nFrames; ++f) {
+        for (int i = 0; i < nNodes; ++i) {
+            sum += radii[i]->getValueAtTime(f);
+        }
+    }
+    double cachedTime = timer.getTimeElapsedReset();
+    EXPECT_EQ(sum, 2. * nNodes * (2. * nFrames + nFrames * (nFrames - 1) / 2.));
+    
+    std::cout << "Expressions evaluated: " << (nNodes * nFrames) / std::max(evalTime, 1e-9) << " /s, "
+              << "cached: " << (nNodes * nFrames) / std::max(cachedTime, 1e-9) << " /s" << std::endl;
+}
+
+///The expressions evaluated without Python must give the same results as Python: each expression must compile
+///to a native program and is compared to the same expression made unsupported by the native evaluator with a call to random()
+TEST_F(BaseTest,NativeExpressions)
+{
+    NodePtr base = createNode(_dotGeneratorPluginID);
+    NodePtr node = createNode(_dotGeneratorPluginID);
+    ASSERT_TRUE(base && node);
+    KnobDouble* baseRadius = dynamic_cast<KnobDouble*>(base->getKnobByName("radius").get());
+    KnobDouble* radius = dynamic_cast<KnobDouble*>(node->getKnobByName("radius").get());
+    ASSERT_TRUE(baseRadius && radius);
+    baseRadius->setValue(3.5);
+    
+    const std::string b = base->getScriptName() + ".radius";
+    const char* expressions[] = {
+        "frame / 2", "frame // 2", "-frame % 3", "7 / 2", "-7 // 2", "2 ** -1", "-2 ** 2",
+        "sqrt(frame) + cos(pi)", "1 / (frame - 3)", "min(frame, 2.0)", "abs(-frame) + int(-2.7)", "view * 2",
+        0
+    };
+    std::vector<std::string> exprs;
+    for (int i = 0; expressions[i]; ++i) {
+        exprs.push_back(expressions[i]);
+    }
+    exprs.push_back(b + ".get() * 2 + frame");
+    exprs.push_back(b + ".get(frame) / " + b + ".getValue(0)");
+    exprs.push_back("thisGroup." + b + ".getValueAtTime(frame - 1) ** 2");
+    
+    const double times[] = { 0., 3., 2.5, -4. };
+    for (std::size_t i = 0; i < exprs.size(); ++i) {
+        EXPECT_TRUE( NativeExpression::compile(exprs[i], radius, 0) ) << exprs[i];
+        EXPECT_FALSE( NativeExpression::compile("(" + exprs[i] + ") + 0 * random()", radius, 0) ) << exprs[i];
+        
+        std::vector<double> nativeResults, pythonResults;
+        radius->setExpression(0, exprs[i], false);
+        for (int t = 0; t < 4; ++t) {
+            nativeResults.push_back(radius->getValueAtTime(times[t], 0, ViewIdx(0), false));
+        }
+        radius->setExpression(0, "(" + exprs[i] + ") + 0 * random()", false);
+        for (int t = 0; t < 4; ++t) {
+            pythonResults.push_back(radius->getValueAtTime(times[t], 0, ViewIdx(0), false));
+        }
+        for (int t = 0; t < 4; ++t) {
+            EXPECT_EQ(nativeResults[t], pythonResults[t]) << exprs[i] << " at frame " << times[t];
+        }
+    }
+}
+
+///The expressions outside of the subset understood by the native evaluator must be left to Python
+TEST_F(BaseTest,NativeExpressionsRejected)
+{
+    NodePtr base = createNode(_dotGeneratorPluginID);
+    NodePtr node = createNode(_dotGeneratorPluginID);
+    ASSERT_TRUE(base && node);
+    KnobDouble* radius = dynamic_cast<KnobDouble*>(node->getKnobByName("radius").get());
+    KnobString* label = dynamic_cast<KnobString*>(node->getKnobByName(kUserLabelKnobName).get());
+    ASSERT_TRUE(radius && label);
+    
+    const std::string b = base->getScriptName() + ".radius";
+    const char* expressions[] = {
+        "random()", "randomInt(0, 10)", "curve(frame)", "round(frame)", "min(frame)", "len(str(frame))",
+        "'frame'", "frame > 2", "frame if view else 1", "[frame][0]", "frame; 2", "ret = frame",
+        0
+    };
+    std::vector<std::string> exprs;
+    for (int i = 0; expressions[i]; ++i) {
+        exprs.push_back(expressions[i]);
+    }
+    exprs.push_back(b + ".getKeyIndex(frame)");
+    exprs.push_back(b + ".get().x");
+    exprs.push_back("NoSuchNode.radius.get()");
+    exprs.push_back(base->getScriptName() + ".noSuchParam.get()");
+    
+    for (std::size_t i = 0; i < exprs.size(); ++i) {
+        EXPECT_FALSE( NativeExpression::compile(exprs[i], radius, 0) ) << exprs[i];
+    }
+    
+    ///String parameters interpret the result of their expression, even a supported expression is run by Python
+    ASSERT_TRUE( NativeExpression::compile("frame * 2", radius, 0) );
+    EXPECT_FALSE( NativeExpression::compile("frame * 2", label, 0) );
+    EXPECT_FALSE( NativeExpression::compile(b + ".get()", label, 0) );
+}
+
+///Hash of a long chain of nodes: every change of the first node reaches the last one, whether the hash is read
+///after each change or once after several of them
+TEST_F(BaseTest,HashLongChain)
+{
+    const int nNodes = 1000;
+    const int nChanges = 20;
+    
+    NodePtr generator = createNode(_dotGeneratorPluginID);
+    ASSERT_TRUE(generator);
+    NodePtr last = generator;
+    for (int i = 0; i < nNodes; ++i) {
+        NodePtr dot = createNode(PLUGINID_NATRON_DOT);
+        ASSERT_TRUE(dot);
+        connectNodes(last, dot, 0, true);
+        last = dot;
+    }
+    
+    std::set<U64> hashes;
+    hashes.insert( last->getHashValue() );
+    for (int i = 0; i < nChanges; ++i) {
+        generator->incrementKnobsAge();
+        U64 hash = last->getHashValue();
+        EXPECT_EQ( hash, last->getHashValue() );
+        EXPECT_TRUE( hashes.insert(hash).second ) << "edit " << i << " gave the hash of a previous state";
+    }
+    
+    ///Successive edits only mark the chain dirty, it is recomputed once when the hash is needed
+    for (int i = 0; i < nChanges; ++i) {
+        generator->incrementKnobsAge();
+    }
+    U64 newHash = last->getHashValue();
+    EXPECT_TRUE( hashes.insert(newHash).second );
+    EXPECT_EQ( newHash, last->getHashValue() );
+}
+
+///Benchmark, run with --gtest_also_run_disabled_tests --gtest_filter=BaseTest.DISABLED_HashLongChainBenchmark
+///Prints how long the hash of a long chain of nodes takes to be recomputed downstream of the first node
+TEST_F(BaseTest,DISABLED_HashLongChainBenchmark)
+{
+    const int nNodes = 5000;
+    const int nChanges = 100;
+    
+    NodePtr generator = createNode(_dotGeneratorPluginID);
+    ASSERT_TRUE(generator);
+    NodePtr last = generator;
+    for (int i = 0; i < nNodes; ++i) {
+        NodePtr dot = createNode(PLUGINID_NATRON_DOT);
+        ASSERT_TRUE(dot);
+        connectNodes(last, dot, 0, true);
+        last = dot;
+    }
+    
+    TimeLapse timer;
+    for (int i = 0; i < nChanges; ++i) {
+        generator->incrementKnobsAge();
+        last->getHashValue();
+    }
+    double elapsed = timer.getTimeSinceCreation();
+    std::cout << "Hash of " << nNodes << " nodes recomputed in " << elapsed * 1000. / nChanges << " ms" << std::endl;
+    
+    TimeLapse dirtyTimer;
+    for (int i = 0; i < nChanges; ++i) {
+        generator->incrementKnobsAge();
+    }
+    last->getHashValue();
+    elapsed = dirtyTimer.getTimeSinceCreation();
+    std::cout << nChanges << " edits of the top of the chain hashed in " << elapsed * 1000. << " ms" << std::endl;
+}
+
+///The hash read right after the creation of a node must not outlive a change of its inputs
+TEST_F(BaseTest,HashFollowsInputs)
+{
+    NodePtr first = createNode(_dotGeneratorPluginID);
+    NodePtr second = createNode(_dotGeneratorPluginID);
+    NodePtr dot = createNode(PLUGINID_NATRON_DOT);
+    ASSERT_TRUE(first && second && dot);
+
+    const U64 unconnectedHash = dot->getHashValue();
+    EXPECT_EQ( unconnectedHash, dot->getHashValue() );
+
+    connectNodes(first, dot, 0, true);
+    const U64 firstHash = dot->getHashValue();
+    EXPECT_NE(unconnectedHash, firstHash);
+
+    disconnectNodes(first, dot, true);
+    connectNodes(second, dot, 0, true);
+    const U64 secondHash = dot->getHashValue();
+    EXPECT_NE(firstHash, secondHash);
+
+    ///A change upstream reaches the hash of the node
+    second->incrementKnobsAge();
+    const U64 editedHash = dot->getHashValue();
+    EXPECT_NE(secondHash, editedHash);
+
+    disconnectNodes(second, dot, true);
+    EXPECT_NE( editedHash, dot->getHashValue() );
+}
+
+///Pre-renders the frames 0 to 9 and 20 to 21 of the first input of node and returns the images that the render of
+///node would get, with the input branches pre-rendered either in parallel or one after another
+static EffectInstance::RenderRoIRetCode
+preRenderInputImages(const NodePtr& node,
+                     bool parallel,
+                     ImageList* images)
+{
+    KnobBool* parallelKnob = dynamic_cast<KnobBool*>(appPTR->getCurrentSettings()->getKnobByName("parallelInputsRender").get());
+    EXPECT_TRUE(parallelKnob);
+    if (!parallelKnob) {
+        return EffectInstance::eRenderRoIRetCodeFailed;
+    }
+    parallelKnob->setValue(parallel);
+    
+    EffectInstPtr input = node->getEffectInstance()->getInput(0);
+    FramesNeededMap framesNeeded;
+    OfxRangeD range;
+    range.min = 0;
+    range.max = 9;
+    framesNeeded[0][0].push_back(range);
+    range.min = 20;
+    range.max = 21;
+    framesNeeded[0][0].push_back(range);
+    RoIMap inputRois;
+    inputRois[input] = RectD(0, 0, 200, 100);
+    EffectInstance::ComponentsNeededMap neededComps;
+    neededComps[0].push_back( ImageComponents::getRGBAComponents() );
+    
+    EffectInstance::InputImagesMap inputImages;
+    EffectInstance::RenderRoIRetCode ret;
+    {
+        ParallelRenderArgsSetter frameRenderArgs(0, 0, false, true, false, 0, node, 0, 0,
+                                                 node->getApp()->getTimeLine().get(),
+                                                 NodePtr(), false, false, false, boost::shared_ptr<RenderStats>());
+        ///Bypass the cache so that the second render does not just read the images of the first one
+        ret = EffectInstance::treeRecurseFunctor(true, node, framesNeeded, inputRois, boost::shared_ptr<InputMatrixMap>(),
+                                                 false, 0, 0, 0, NodePtr(), 0, &inputImages, &neededComps, false, true);
+    }
+    parallelKnob->setValue(false);
+    
+    *images = inputImages[0];
+    return ret;
+}
+
+///The input branches pre-rendered in parallel must give the same input images as when they are rendered one after another:
+///at most NATRON_MAX_FRAMES_NEEDED_PRE_FETCHING frames producing an image per range of frames needed
+TEST_F(BaseTest,ParallelInputsPreRender)
+{
+    NodePtr generator = createNode(_dotGeneratorPluginID);
+    NodePtr dot = createNode(PLUGINID_NATRON_DOT);
+    ASSERT_TRUE(generator && dot);
+    connectNodes(generator, dot, 0, true);
+    
+    ImageList sequentialImages, parallelImages;
+    ASSERT_EQ( EffectInstance::eRenderRoIRetCodeOk, preRenderInputImages(dot, false, &sequentialImages) );
+    ASSERT_EQ( EffectInstance::eRenderRoIRetCodeOk, preRenderInputImages(dot, true, &parallelImages) );
+    
+    std::vector<double> expectedTimes;
+    for (int f = 0; f <= 9 && f < NATRON_MAX_FRAMES_NEEDED_PRE_FETCHING; ++f) {
+        expectedTimes.push_back(f);
+    }
+    expectedTimes.push_back(20);
+    expectedTimes.push_back(21);
+    ASSERT_EQ( expectedTimes.size(), sequentialImages.size() );
+    ASSERT_EQ( sequentialImages.size(), parallelImages.size() );
+    
+    std::size_t i = 0;
+    for (ImageList::iterator it = sequentialImages.begin(), it2 = parallelImages.begin(); it != sequentialImages.end(); ++it, ++it2, ++i) {
+        EXPECT_EQ( expectedTimes[i], (*it)->getKey().getTime() );
+        EXPECT_TRUE( (*it)->getKey() == (*it2)->getKey() ) << "image " << i;
+        EXPECT_EQ( (*it)->getBounds(), (*it2)->getBounds() ) << "image " << i;
+        EXPECT_EQ( (*it)->getMipMapLevel(), (*it2)->getMipMapLevel() ) << "image " << i;
+    }
+    
+    ///A disabled generator gives no image: all the frames needed are rendered, none is pre-fetched
+    generator->setNodeDisabled(true);
+    ASSERT_EQ( EffectInstance::eRenderRoIRetCodeOk, preRenderInputImages(dot, false, &sequentialImages) );
+    ASSERT_EQ( EffectInstance::eRenderRoIRetCodeOk, preRenderInputImages(dot, true, &parallelImages) );
+    EXPECT_TRUE( sequentialImages.empty() );
+    EXPECT_TRUE( parallelImages.empty() );
+}
+
 ///High level test: simple node connections test
 TEST_F(BaseTest,SimpleNodeConnections) {
     ///create the generator
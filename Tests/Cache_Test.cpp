@@ -0,0 +1,207 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QThread>
+
+#include "BaseTest.h"
+
+#include "Engine/Cache.h"
+#include "Engine/Image.h"
+#include "Engine/ImageParams.h"
+#include "Engine/Timer.h"
+
+NATRON_NAMESPACE_USING
+
+#define CACHE_TEST_N_KEYS 2048
+#define CACHE_TEST_N_ITERATIONS 20000
+
+namespace {
+
+///Returns nKeys image keys, only taken from the given bucket of the cache if bucket is not -1
+std::vector<ImageKey>
+makeCacheTestKeys(int nKeys,
+                  int bucket)
+{
+    std::vector<ImageKey> keys;
+
+    for (int i = 0; (int)keys.size() < nKeys; ++i) {
+        ImageKey key(0, i + 1, false, 0, 0, 1., false, false);
+        if ( (bucket == -1) || (Cache<Image>::getBucketIndex( key.getHash() ) == bucket) ) {
+            keys.push_back(key);
+        }
+    }
+
+    return keys;
+}
+
+/**
+ * @brief Hammers the cache with getOrCreate() calls over a fixed set of keys, as tile threads do during a render.
+ **/
+class CacheContentionThread
+    : public QThread
+{
+    Cache<Image>* _cache;
+    const std::vector<ImageKey>* _keys;
+    int _seed;
+
+public:
+
+    int nCreated;
+    int nFound;
+    int nMismatch;
+
+    CacheContentionThread(Cache<Image>* cache,
+                          const std::vector<ImageKey>* keys,
+                          int seed)
+        : QThread()
+        , _cache(cache)
+        , _keys(keys)
+        , _seed(seed)
+        , nCreated(0)
+        , nFound(0)
+        , nMismatch(0)
+    {
+    }
+
+private:
+
+    virtual void run() OVERRIDE FINAL
+    {
+        std::map<int, std::map<int, std::vector<RangeD> > > framesNeeded;
+        RectD rod(0, 0, 32, 32);
+        // Simple linear congruential generator, rand() is not thread-safe
+        unsigned int state = (unsigned int)_seed;
+
+        for (int i = 0; i < CACHE_TEST_N_ITERATIONS; ++i) {
+            state = state * 1103515245u + 12345u;
+            const ImageKey& key = (*_keys)[(state >> 16) % _keys->size()];
+            boost::shared_ptr<ImageParams> params = Image::makeParams( 0, rod, 1., 0, false, ImageComponents::getRGBAComponents(),
+                                                                       eImageBitDepthByte, framesNeeded );
+            boost::shared_ptr<Image> image;
+            if ( _cache->getOrCreate(key, params, &image) ) {
+                ++nFound;
+            } else {
+                ++nCreated;
+                if (image) {
+                    image->allocateMemory();
+                }
+            }
+            if ( !image || !( image->getKey() == key ) ) {
+                ++nMismatch;
+            }
+            if ( (state & 0xff) == 0 ) {
+                _cache->removeEntry(image);
+            }
+        }
+    }
+};
+}
+
+///Runs the threads on the keys and returns how long they took, in seconds
+static double
+runCacheContention(Cache<Image>* cache,
+                   const std::vector<ImageKey>& keys,
+                   int* nCreated,
+                   int* nFound,
+                   int* nMismatch)
+{
+    int nThreads = std::max(2, QThread::idealThreadCount() * 2);
+    std::vector<CacheContentionThread*> threads;
+
+    for (int i = 0; i < nThreads; ++i) {
+        threads.push_back( new CacheContentionThread(cache, &keys, i + 1) );
+    }
+
+    TimeLapse timer;
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->start();
+    }
+    for (int i = 0; i < nThreads; ++i) {
+        threads[i]->wait();
+    }
+    double elapsed = timer.getTimeSinceCreation();
+
+    *nCreated = *nFound = *nMismatch = 0;
+    for (int i = 0; i < nThreads; ++i) {
+        *nCreated += threads[i]->nCreated;
+        *nFound += threads[i]->nFound;
+        *nMismatch += threads[i]->nMismatch;
+        delete threads[i];
+    }
+
+    return elapsed;
+}
+
+/**
+ * @brief Drives a Cache<Image> from many threads and checks that the get/create semantics hold under concurrency.
+ **/
+TEST_F(BaseTest, CacheContention)
+{
+    Cache<Image> cache("CacheContentionTest", NATRON_CACHE_VERSION, (U64)512 * 1024 * 1024, 1.);
+    const std::vector<ImageKey> keys = makeCacheTestKeys(CACHE_TEST_N_KEYS, -1);
+    int nCreated, nFound, nMismatch;
+
+    runCacheContention(&cache, keys, &nCreated, &nFound, &nMismatch);
+
+    const int nThreads = std::max(2, QThread::idealThreadCount() * 2);
+    EXPECT_EQ(0, nMismatch);
+    EXPECT_EQ(nThreads * CACHE_TEST_N_ITERATIONS, nCreated + nFound);
+    EXPECT_GT(nFound, 0);
+    ///Every key is created at least once, and the entries are only created again after being removed
+    EXPECT_GE(nCreated, CACHE_TEST_N_KEYS);
+    EXPECT_LE( cache.getMemoryCacheSize(), cache.getMaximumSize() );
+
+    cache.clear();
+    cache.waitForDeleterThread();
+}
+
+/**
+ * @brief Benchmark, run with --gtest_also_run_disabled_tests --gtest_filter=BaseTest.DISABLED_CacheContentionBenchmark
+ * Prints the throughput of getOrCreate() from many threads with keys spread over all the buckets of the cache, and
+ * with keys that all fall in one bucket, i.e: the contention of a cache with a single lock.
+ **/
+TEST_F(BaseTest, DISABLED_CacheContentionBenchmark)
+{
+    const char* names[] = { "sharded", "one bucket" };
+
+    for (int oneBucket = 0; oneBucket < 2; ++oneBucket) {
+        Cache<Image> cache("CacheContentionTest", NATRON_CACHE_VERSION, (U64)512 * 1024 * 1024, 1.);
+        const std::vector<ImageKey> keys = makeCacheTestKeys(CACHE_TEST_N_KEYS, oneBucket ? 0 : -1);
+        int nCreated, nFound, nMismatch;
+        double elapsed = runCacheContention(&cache, keys, &nCreated, &nFound, &nMismatch);
+
+        std::cout << "Cache<Image> contention (" << names[oneBucket] << "): " << (nCreated + nFound) << " getOrCreate calls in "
+                  << elapsed << " s (" << (int)( (nCreated + nFound) / std::max(elapsed, 1e-6) ) << " calls/s), "
+                  << nCreated << " created, " << nFound << " found" << std::endl;
+
+        cache.clear();
+        cache.waitForDeleterThread();
+    }
+}
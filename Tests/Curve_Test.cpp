@@ -22,10 +22,13 @@
 #include <Python.h>
 // ***** END PYTHON BLOCK *****
 
+#include <vector>
 #include <gtest/gtest.h>
 
 #include <QString>
 #include <QDir>
+#include <QtCore/QThread>
+#include <QtCore/QAtomicInt>
 
 #include "Engine/Curve.h"
 
@@ -121,3 +124,125 @@ TEST(Curve,Basic)
 }
 
 
+
+// the batched evaluation gives the same values as getValueAt, whether the times are sorted or not
+TEST(Curve,ValuesAt)
+{
+    Curve c;
+
+    c.addKeyFrame( KeyFrame(0., 10.) );
+    c.addKeyFrame( KeyFrame(5., 20., 0., 0., eKeyframeTypeLinear) );
+    c.addKeyFrame( KeyFrame(7., -3., 0., 0., eKeyframeTypeConstant) );
+    c.addKeyFrame( KeyFrame(20., 4., 0., 0., eKeyframeTypeCatmullRom) );
+
+    std::vector<double> times;
+    for (double t = -5.; t < 30.; t += 0.25) {
+        times.push_back(t);
+    }
+    for (int i = 0; i < 50; ++i) {
+        times.push_back( (i * 7919) % 35 - 5. );
+    }
+    std::vector<double> values( times.size() );
+    c.getValuesAt( &times[0], (int)times.size(), &values[0] );
+    for (std::size_t i = 0; i < times.size(); ++i) {
+        EXPECT_EQ( c.getValueAt(times[i]), values[i] );
+    }
+    EXPECT_EQ( 20., values[40] ); // t = 5
+    EXPECT_EQ( -3., values[60] ); // t = 10, constant after the key at t = 7
+}
+
+namespace {
+const int nStressTimes = 64;
+
+/// Reads the curve while it is being changed: all the values of a batch must come from one of the two states of the curve
+class CurveReaderThread
+    : public QThread
+{
+public:
+
+    CurveReaderThread(const Curve* curve,
+                      const std::vector<double>* times,
+                      const std::vector<double>* valuesA,
+                      const std::vector<double>* valuesB,
+                      QAtomicInt* stop,
+                      QAtomicInt* totalReads)
+        : _curve(curve)
+        , _times(times)
+        , _valuesA(valuesA)
+        , _valuesB(valuesB)
+        , _stop(stop)
+        , _totalReads(totalReads)
+        , mismatches(0)
+    {
+    }
+
+    virtual void run()
+    {
+        std::vector<double> values(nStressTimes);
+
+        while ( !_stop->fetchAndAddOrdered(0) ) {
+            _curve->getValuesAt( &(*_times)[0], nStressTimes, &values[0] );
+            if ( (values != *_valuesA) && (values != *_valuesB) ) {
+                ++mismatches;
+            }
+            const int i = _totalReads->fetchAndAddOrdered(1) % nStressTimes;
+            const double v = _curve->getValueAt( (*_times)[i] );
+            if ( (v != (*_valuesA)[i]) && (v != (*_valuesB)[i]) ) {
+                ++mismatches;
+            }
+        }
+    }
+
+private:
+
+    const Curve* _curve;
+    const std::vector<double>* _times;
+    const std::vector<double>* _valuesA;
+    const std::vector<double>* _valuesB;
+    QAtomicInt* _stop;
+    QAtomicInt* _totalReads;
+
+public:
+
+    int mismatches;
+};
+}
+
+TEST(Curve,ConcurrentReadWrite)
+{
+    Curve a, b;
+
+    a.addKeyFrame( KeyFrame(0., 0.) );
+    a.addKeyFrame( KeyFrame(10., 100.) );
+    a.addKeyFrame( KeyFrame(20., 50.) );
+    b.addKeyFrame( KeyFrame(-5., 30., 0., 0., eKeyframeTypeLinear) );
+    b.addKeyFrame( KeyFrame(15., -20., 0., 0., eKeyframeTypeConstant) );
+
+    std::vector<double> times(nStressTimes), valuesA(nStressTimes), valuesB(nStressTimes);
+    for (int i = 0; i < nStressTimes; ++i) {
+        times[i] = i * 0.5 - 8.;
+    }
+    a.getValuesAt( &times[0], nStressTimes, &valuesA[0] );
+    b.getValuesAt( &times[0], nStressTimes, &valuesB[0] );
+
+    Curve c;
+    c.clone(a);
+
+    QAtomicInt stop(0);
+    QAtomicInt totalReads(0);
+    std::vector<CurveReaderThread*> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.push_back( new CurveReaderThread(&c, &times, &valuesA, &valuesB, &stop, &totalReads) );
+        readers.back()->start();
+    }
+    // clone() replaces all the keyframes under the lock of the curve
+    for (int i = 0; i < 2000 || totalReads.fetchAndAddOrdered(0) < 20000; ++i) {
+        c.clone( (i % 2) ? a : b );
+    }
+    stop.fetchAndStoreOrdered(1);
+    for (std::size_t i = 0; i < readers.size(); ++i) {
+        readers[i]->wait();
+        EXPECT_EQ(0, readers[i]->mismatches);
+        delete readers[i];
+    }
+}
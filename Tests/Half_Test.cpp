@@ -0,0 +1,194 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "BaseTest.h"
+
+#include "Engine/Cache.h"
+#include "Engine/Half.h"
+#include "Engine/Image.h"
+#include "Engine/ImageParams.h"
+
+NATRON_NAMESPACE_USING
+
+static bool
+isHalfNaN(unsigned short bits)
+{
+    return (bits & 0x7c00) == 0x7c00 && (bits & 0x3ff) != 0;
+}
+
+// every half value converted to float and back gives the same half
+TEST(Half, RoundTrip) {
+    for (int i = 0; i < 0x10000; ++i) {
+        if ( isHalfNaN( (unsigned short)i ) ) {
+            continue;
+        }
+        Half h = Half::fromBits( (unsigned short)i );
+        EXPECT_EQ( i, Half( (float)h ).getBits() );
+    }
+}
+
+// a float in the range of normal halves is stored with a relative error of at most 2^-11
+TEST(Half, PrecisionBounds) {
+    std::srand(1);
+    for (int i = 0; i < 100000; ++i) {
+        const float f = (float)std::rand() / RAND_MAX * 65000.f + 6.2e-5f;
+        const float h = Half(f);
+        EXPECT_LE(std::fabs(h - f), f / 2048.f);
+    }
+    // denormals have an absolute error of at most 2^-25
+    for (int i = 0; i < 1000; ++i) {
+        const float f = (float)i * 6.1e-8f;
+        const float h = Half(f);
+        EXPECT_LE( std::fabs(h - f), std::ldexp(1.f, -25) );
+    }
+    EXPECT_EQ( 0.f, (float)Half(0.f) );
+    EXPECT_EQ( 1.f, (float)Half(1.f) );
+    EXPECT_EQ( 65504.f, (float)Half(65504.f) );
+    // out of range values become infinite
+    EXPECT_EQ( 0x7c00, Half(1e6f).getBits() );
+    EXPECT_EQ( 0xfc00, Half(-1e6f).getBits() );
+}
+
+// the F16C path, when available, gives the same results as the scalar one
+TEST(Half, RowConversionMatchesScalar) {
+    const int n = 100003;
+    std::vector<float> values(n);
+
+    std::srand(2);
+    for (int i = 0; i < n; ++i) {
+        values[i] = ( (float)std::rand() / RAND_MAX - 0.5f ) * std::ldexp( 1.f, std::rand() % 40 - 24 );
+    }
+    std::vector<Half> halves(n), scalarHalves(n);
+    Half::convertRowFromFloat(&values[0], &halves[0], n);
+    Half::convertRowFromFloatScalar(&values[0], &scalarHalves[0], n);
+    EXPECT_EQ( 0, std::memcmp( &halves[0], &scalarHalves[0], n * sizeof(Half) ) );
+
+    std::vector<float> floats(n), scalarFloats(n);
+    Half::convertRowToFloat(&halves[0], &floats[0], n);
+    Half::convertRowToFloatScalar(&halves[0], &scalarFloats[0], n);
+    EXPECT_EQ( 0, std::memcmp( &floats[0], &scalarFloats[0], n * sizeof(float) ) );
+}
+
+// a half image takes half the memory of a float image and converts back to float within the precision of halves
+TEST(Half, ImageStorage) {
+    const RectI bounds(0, 0, 256, 128);
+    RectD rod;
+    bounds.toCanonical_noClipping(0, 1., &rod);
+    const ImageComponents& rgba = ImageComponents::getRGBAComponents();
+
+    Image floatImg(rgba, rod, bounds, 0, 1., eImageBitDepthFloat, false);
+    Image halfImg(rgba, rod, bounds, 0, 1., eImageBitDepthHalf, false);
+    EXPECT_EQ( floatImg.size(), 2 * halfImg.size() );
+
+    {
+        Image::WriteAccess acc = floatImg.getWriteRights();
+        std::srand(3);
+        for (int y = bounds.y1; y < bounds.y2; ++y) {
+            float* pix = (float*)acc.pixelAt(bounds.x1, y);
+            for (int i = 0; i < bounds.width() * 4; ++i) {
+                pix[i] = (float)std::rand() / RAND_MAX * 4.f;
+            }
+        }
+    }
+    floatImg.convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceLinear, -1, false, false, &halfImg);
+
+    Image backImg(rgba, rod, bounds, 0, 1., eImageBitDepthFloat, false);
+    halfImg.convertToFormat(bounds, eViewerColorSpaceLinear, eViewerColorSpaceLinear, -1, false, false, &backImg);
+
+    Image::ReadAccess srcAcc = floatImg.getReadRights();
+    Image::ReadAccess backAcc = backImg.getReadRights();
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        const float* src = (const float*)srcAcc.pixelAt(bounds.x1, y);
+        const float* back = (const float*)backAcc.pixelAt(bounds.x1, y);
+        for (int i = 0; i < bounds.width() * 4; ++i) {
+            ASSERT_LE(std::fabs(back[i] - src[i]), src[i] / 2048.f + 1e-7f);
+        }
+    }
+}
+
+// the cache accounts for half images with half the memory of float images
+TEST_F(BaseTest, HalfCacheOccupancy) {
+    Cache<Image> cache("HalfCacheOccupancyTest", NATRON_CACHE_VERSION, (U64)512 * 1024 * 1024, 1.);
+    const RectD rod(0, 0, 256, 128);
+    const std::map<int, std::map<int, std::vector<RangeD> > > framesNeeded;
+    ASSERT_EQ( (std::size_t)0, cache.getMemoryCacheSize() );
+
+    ImageKey floatKey(0, 1, false, 0, 0, 1., false, false);
+    boost::shared_ptr<Image> floatImg;
+    EXPECT_FALSE( cache.getOrCreate(floatKey, Image::makeParams( 0, rod, 1., 0, false, ImageComponents::getRGBAComponents(),
+                                                                 eImageBitDepthFloat, framesNeeded ), &floatImg) );
+    ASSERT_TRUE(floatImg);
+    floatImg->allocateMemory();
+    EXPECT_EQ( (std::size_t)rod.area() * 4 * sizeof(float), cache.getMemoryCacheSize() );
+
+    ImageKey halfKey(0, 2, false, 0, 0, 1., false, false);
+    boost::shared_ptr<Image> halfImg;
+    EXPECT_FALSE( cache.getOrCreate(halfKey, Image::makeParams( 0, rod, 1., 0, false, ImageComponents::getRGBAComponents(),
+                                                                eImageBitDepthHalf, framesNeeded ), &halfImg) );
+    ASSERT_TRUE(halfImg);
+    halfImg->allocateMemory();
+    EXPECT_EQ( (std::size_t)rod.area() * 4 * sizeof(Half), halfImg->size() );
+    EXPECT_EQ( floatImg->size() + halfImg->size(), cache.getMemoryCacheSize() );
+    EXPECT_EQ( floatImg->size(), 2 * halfImg->size() );
+
+    cache.clear();
+    cache.waitForDeleterThread();
+}
+
+// the mipmaps of a half image are those of the float image within the precision of halves
+TEST(Half, ImageMipMap) {
+    const RectI bounds(0, 0, 64, 64);
+    RectD rod;
+    bounds.toCanonical_noClipping(0, 1., &rod);
+    const ImageComponents& rgba = ImageComponents::getRGBAComponents();
+    const RectI halfBounds(0, 0, 32, 32);
+
+    Image floatImg(rgba, rod, bounds, 0, 1., eImageBitDepthFloat, false);
+    Image halfImg(rgba, rod, bounds, 0, 1., eImageBitDepthHalf, false);
+    floatImg.fill(bounds, 0.25f, 0.5f, 0.75f, 1.f);
+    halfImg.fill(bounds, 0.25f, 0.5f, 0.75f, 1.f);
+    floatImg.fill(RectI(0, 0, 16, 64), 1.f, 0.f, 0.3f, 0.5f);
+    halfImg.fill(RectI(0, 0, 16, 64), 1.f, 0.f, 0.3f, 0.5f);
+
+    Image floatMipMap(rgba, rod, halfBounds, 1, 1., eImageBitDepthFloat, false);
+    Image halfMipMap(rgba, rod, halfBounds, 1, 1., eImageBitDepthHalf, false);
+    floatImg.downscaleMipMap(rod, bounds, 0, 1, false, &floatMipMap);
+    halfImg.downscaleMipMap(rod, bounds, 0, 1, false, &halfMipMap);
+
+    Image::ReadAccess floatAcc = floatMipMap.getReadRights();
+    Image::ReadAccess halfAcc = halfMipMap.getReadRights();
+    for (int y = halfBounds.y1; y < halfBounds.y2; ++y) {
+        const float* f = (const float*)floatAcc.pixelAt(halfBounds.x1, y);
+        const Half* h = (const Half*)halfAcc.pixelAt(halfBounds.x1, y);
+        for (int i = 0; i < halfBounds.width() * 4; ++i) {
+            ASSERT_NEAR(f[i], (float)h[i], 1. / 2048.);
+        }
+    }
+}
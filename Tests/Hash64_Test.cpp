@@ -23,8 +23,11 @@
 // ***** END PYTHON BLOCK *****
 
 #include <cstdlib>
+#include <vector>
 #include <gtest/gtest.h>
 
+#include <QtCore/QString>
+
 #include "Engine/Hash64.h"
 
 NATRON_NAMESPACE_USING
@@ -85,3 +88,94 @@ TEST(Hash64,GeneralTest) {
     EXPECT_NE( hash1.value(), hash2.value() );
     EXPECT_NE(hash1, hash2);
 }
+
+TEST(Hash64,QStrings) {
+    Hash64 hash1, hash2;
+
+    Hash64_appendQString( &hash1, QString::fromUtf8("Blur1") );
+    Hash64_appendQString( &hash1, QString::fromUtf8("size") );
+    hash1.computeHash();
+    Hash64_appendQString( &hash2, QString::fromUtf8("Blur1s") );
+    Hash64_appendQString( &hash2, QString::fromUtf8("ize") );
+    hash2.computeHash();
+    EXPECT_NE(hash1, hash2) << "Strings with the same concatenation should not collide.";
+
+    ///Appending after computing the hash continues the stream
+    hash1.append<int>(1);
+    hash1.computeHash();
+    hash2.reset();
+    Hash64_appendQString( &hash2, QString::fromUtf8("Blur1") );
+    Hash64_appendQString( &hash2, QString::fromUtf8("size") );
+    hash2.append<int>(1);
+    hash2.computeHash();
+    EXPECT_EQ(hash1, hash2);
+}
+
+///The bytes of the known answer tests: 0x03, 0x0A, 0x11...
+static std::vector<unsigned char>
+makeHash64TestBytes(std::size_t size)
+{
+    std::vector<unsigned char> bytes(size);
+
+    for (std::size_t i = 0; i < size; ++i) {
+        bytes[i] = (unsigned char)(i * 7 + 3);
+    }
+
+    return bytes;
+}
+
+///The reference values of XXH64: a divergence changes the keys of the cached images (see NATRON_CACHE_VERSION)
+TEST(Hash64,XXH64KnownAnswers) {
+    const std::size_t sizes[] = { 0, 1, 4, 8, 32, 100 };
+    const U64 seed0[] = {
+        0xEF46DB3751D8E999ULL, 0x1F25C8D0BC1F4BB6ULL, 0x9BB64B7D66EE9FDAULL,
+        0xDAB99D95C6F90092ULL, 0x23C3C17EF790FD97ULL, 0xA61F8D4C170FE531ULL
+    };
+    const U64 seed2016[] = {
+        0x65CCD4D076A38DA0ULL, 0x8332309C3D79673FULL, 0x97451C3621A8E602ULL,
+        0x39837E73BDA93124ULL, 0xA425CC66A7AA688EULL, 0x0FE67B31F9C6FC05ULL
+    };
+    const std::vector<unsigned char> bytes = makeHash64TestBytes(100);
+
+    for (int i = 0; i < 6; ++i) {
+        EXPECT_EQ( seed0[i], Hash64::xxh64(&bytes[0], sizes[i], 0) ) << sizes[i] << " bytes";
+        EXPECT_EQ( seed2016[i], Hash64::xxh64(&bytes[0], sizes[i], 2016) ) << sizes[i] << " bytes, seed 2016";
+    }
+}
+
+///Appends the bytes to the hash as little-endian words
+static void
+appendHash64TestWords(const std::vector<unsigned char>& bytes,
+                      std::size_t nWords,
+                      Hash64* hash)
+{
+    for (std::size_t w = 0; w < nWords; ++w) {
+        U64 word = 0;
+        for (int b = 7; b >= 0; --b) {
+            word = (word << 8) | bytes[w * 8 + b];
+        }
+        hash->append<U64>(word);
+    }
+}
+
+///The hash streamed word by word is XXH64 over the words in little-endian order
+TEST(Hash64,StreamMatchesXXH64) {
+    const std::vector<unsigned char> bytes = makeHash64TestBytes(13 * 8);
+
+    for (std::size_t nWords = 1; nWords <= 13; ++nWords) {
+        Hash64 hash;
+        appendHash64TestWords(bytes, nWords, &hash);
+        hash.computeHash();
+        EXPECT_EQ( Hash64::xxh64(&bytes[0], nWords * 8, 0), hash.value() ) << nWords << " words";
+    }
+
+    ///The values pinned by XXH64KnownAnswers, for a partial and a full stripe
+    Hash64 hash;
+    appendHash64TestWords(bytes, 1, &hash);
+    hash.computeHash();
+    EXPECT_EQ(0xDAB99D95C6F90092ULL, hash.value());
+    hash.reset();
+    appendHash64TestWords(bytes, 4, &hash);
+    hash.computeHash();
+    EXPECT_EQ(0x23C3C17EF790FD97ULL, hash.value());
+}
@@ -22,10 +22,18 @@
 #include <Python.h>
 // ***** END PYTHON BLOCK *****
 
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
 #include <cstring>
+#include <iostream>
+#include <vector>
 #include <gtest/gtest.h>
 
 #include "Engine/Image.h"
+#include "Engine/ImageRow.h"
+#include "Engine/MipMapRow.h"
+#include "Engine/Timer.h"
 
 NATRON_NAMESPACE_USING
 
@@ -108,6 +116,50 @@ TEST(BitmapTest,SimpleRect) {
     EXPECT_TRUE(nonRenderedRects.size() == 3);
 }
 
+TEST(BitmapTest,TileBoundaries) {
+    ///Bounds that are not a multiple of the tile size and do not start at 0
+    RectI rod(-37,-5,250,190);
+    Bitmap bm(rod);
+
+    ///Render the inside in several passes that do not line up with the tiles
+    RectI inside(-30,1,243,183);
+    bm.markForRendered( RectI(-30,1,100,183) );
+    bm.markForRendered( RectI(100,1,243,90) );
+    bm.markForRendered( RectI(100,90,243,183) );
+    EXPECT_TRUE( bm.getContent(inside) == Bitmap::eContentFlagRendered );
+    EXPECT_TRUE( bm.getContent(rod) == (Bitmap::eContentFlagRendered | Bitmap::eContentFlagUnrendered) );
+
+    ///Only the frame around the inside remains to render
+    std::list<RectI> nonRenderedRects;
+    bm.minimalNonMarkedRects(rod, nonRenderedRects);
+    U64 area = 0;
+    for (std::list<RectI>::iterator it = nonRenderedRects.begin(); it != nonRenderedRects.end(); ++it) {
+        EXPECT_FALSE( it->intersects(inside) );
+        area += it->area();
+    }
+    EXPECT_TRUE( area == rod.area() - inside.area() );
+
+    ///A single pixel being rendered elsewhere in the middle of a tile must be seen
+    bm.markForRendered(rod);
+    bm.markForRendering( RectI(70,70,71,71) );
+    nonRenderedRects.clear();
+    bool beingRenderedElseWhere = false;
+    bm.minimalNonMarkedRects_trimap(rod, nonRenderedRects, &beingRenderedElseWhere);
+    EXPECT_TRUE( nonRenderedRects.empty() );
+    EXPECT_TRUE(beingRenderedElseWhere);
+    nonRenderedRects.clear();
+    bm.minimalNonMarkedRects(rod, nonRenderedRects);
+    ASSERT_TRUE(nonRenderedRects.size() == 1);
+    EXPECT_TRUE( nonRenderedRects.front() == RectI(70,70,71,71) );
+
+    ///Copying pixels from another bitmap must update the tiles
+    Bitmap other(rod);
+    RectI copied(0,0,128,96);
+    bm.copyBitmapPortion(copied, other);
+    EXPECT_TRUE( bm.getContent(copied) == Bitmap::eContentFlagUnrendered );
+    EXPECT_TRUE( bm.minimalNonMarkedBbox(rod) == copied );
+}
+
 TEST(ImageKeyTest,Equality) {
     srand(2000);
     // coverity[dont_call]
@@ -151,3 +203,258 @@ TEST(ImageKeyTest,Difference) {
     ASSERT_TRUE(keyHash1 != keyHash2);
 }
 
+
+template <typename PIX>
+static void
+checkHalveRowMatchesScalar(int maxValue)
+{
+    const int width = 37;
+
+    std::srand(5);
+    for (int nComps = 1; nComps <= 4; ++nComps) {
+        std::vector<PIX> row0(width * 2 * nComps), row1(width * 2 * nComps);
+        for (std::size_t i = 0; i < row0.size(); ++i) {
+            row0[i] = PIX( (float)std::rand() / RAND_MAX * maxValue );
+            row1[i] = PIX( (float)std::rand() / RAND_MAX * maxValue );
+        }
+        // integer sums must not overflow, nor the rounding differ, at the maximum values
+        row0[0] = row1[0] = row0[nComps] = row1[nComps] = PIX(maxValue);
+        for (int w = 0; w <= width; ++w) {
+            std::vector<PIX> simd(w * nComps + 1, PIX(0)), scalar(w * nComps + 1, PIX(0));
+            MipMap::halveRow(&row0[0], &row1[0], nComps, w, &simd[0]);
+            MipMap::halveRow(&row0[0], &row1[0], nComps, w, &scalar[0], Color::eSIMDLevelNone);
+            ASSERT_EQ( 0, std::memcmp( &simd[0], &scalar[0], simd.size() * sizeof(PIX) ) );
+        }
+    }
+}
+
+// the SSE2 kernels used to build mipmaps give the same results as the scalar loop
+TEST(MipMapTest,HalveRowMatchesScalar) {
+    checkHalveRowMatchesScalar<unsigned char>(255);
+    checkHalveRowMatchesScalar<unsigned short>(65535);
+    checkHalveRowMatchesScalar<float>(1);
+}
+
+// a large level, halved in parallel bands, is the average of the 2x2 blocks of the source,
+// including the partial blocks on the odd borders of the source bounds
+TEST(MipMapTest,DownscaleMatchesReference) {
+    const RectI bounds(-3, 1, 1021, 777);
+    RectD rod;
+    bounds.toCanonical_noClipping(0, 1., &rod);
+    const ImageComponents& rgba = ImageComponents::getRGBAComponents();
+    RectI dstBounds;
+    rod.toPixelEnclosing(1, 1., &dstBounds);
+
+    Image img(rgba, rod, bounds, 0, 1., eImageBitDepthFloat, false);
+    {
+        Image::WriteAccess acc = img.getWriteRights();
+        std::srand(6);
+        for (int y = bounds.y1; y < bounds.y2; ++y) {
+            float* pix = (float*)acc.pixelAt(bounds.x1, y);
+            for (int i = 0; i < bounds.width() * 4; ++i) {
+                pix[i] = (float)std::rand() / RAND_MAX;
+            }
+        }
+    }
+    Image mipMap(rgba, rod, dstBounds, 1, 1., eImageBitDepthFloat, false);
+    img.downscaleMipMap(rod, bounds, 0, 1, false, &mipMap);
+
+    Image::ReadAccess srcAcc = img.getReadRights();
+    Image::ReadAccess dstAcc = mipMap.getReadRights();
+    for (int y = dstBounds.y1; y < dstBounds.y2; ++y) {
+        for (int x = dstBounds.x1; x < dstBounds.x2; ++x) {
+            const float* dst = (const float*)dstAcc.pixelAt(x, y);
+            for (int k = 0; k < 4; ++k) {
+                float sum = 0.f;
+                int n = 0;
+                for (int sy = y * 2; sy < y * 2 + 2; ++sy) {
+                    for (int sx = x * 2; sx < x * 2 + 2; ++sx) {
+                        if ( bounds.contains(sx, sy) ) {
+                            sum += ( (const float*)srcAcc.pixelAt(sx, sy) )[k];
+                            ++n;
+                        }
+                    }
+                }
+                ASSERT_NEAR(sum / n, dst[k], 1e-6);
+            }
+        }
+    }
+}
+
+template <typename PIX>
+static void
+checkImageRowMatchesScalar(int maxValue)
+{
+    const int width = 37;
+
+    std::vector<PIX> src(width * 4), dst(width * 4), mask(width);
+
+    std::srand(7);
+    for (std::size_t i = 0; i < src.size(); ++i) {
+        src[i] = PIX( (float)std::rand() / RAND_MAX * maxValue );
+        dst[i] = PIX( (float)std::rand() / RAND_MAX * maxValue );
+    }
+    for (int x = 0; x < width; ++x) {
+        mask[x] = PIX( (float)std::rand() / RAND_MAX * maxValue );
+    }
+    // transparent pixels must not be unpremultiplied
+    src[3] = dst[3] = src[7] = PIX(0);
+    for (int dstNComps = 1; dstNComps <= 4; ++dstNComps) {
+        for (int srcNComps = 0; srcNComps <= 4; ++srcNComps) {
+            const PIX* srcRow = srcNComps ? &src[0] : 0;
+            for (int m = 0; m < 3; ++m) {
+                std::vector<PIX> simd(dst), scalar(dst);
+                ImageRow::maskMixRow(srcRow, srcNComps, m ? &mask[0] : 0, m == 2, 0.7f, width, &simd[0], dstNComps);
+                ImageRow::maskMixRow(srcRow, srcNComps, m ? &mask[0] : 0, m == 2, 0.7f, width, &scalar[0], dstNComps, Color::eSIMDLevelNone);
+                ASSERT_EQ( 0, std::memcmp( &simd[0], &scalar[0], simd.size() * sizeof(PIX) ) );
+            }
+            for (int processChannels = 0; processChannels < 16; ++processChannels) {
+                for (int p = 0; p < 4; ++p) {
+                    const bool premult = p & 1;
+                    const bool originalPremult = p & 2;
+                    // only A or RGBA can be premult
+                    if ( (premult && dstNComps != 1 && dstNComps != 4) || (originalPremult && srcNComps != 1 && srcNComps != 4) ) {
+                        continue;
+                    }
+                    std::vector<PIX> simd(dst), scalar(dst);
+                    ImageRow::copyUnProcessedChannelsRow(srcRow, srcNComps, originalPremult, std::bitset<4>(processChannels), premult,
+                                                         width, &simd[0], dstNComps);
+                    ImageRow::copyUnProcessedChannelsRow(srcRow, srcNComps, originalPremult, std::bitset<4>(processChannels), premult,
+                                                         width, &scalar[0], dstNComps, Color::eSIMDLevelNone);
+                    ASSERT_EQ( 0, std::memcmp( &simd[0], &scalar[0], simd.size() * sizeof(PIX) ) );
+                }
+            }
+        }
+    }
+    for (int doPremult = 0; doPremult < 2; ++doPremult) {
+        std::vector<PIX> simd(src), scalar(src);
+        ImageRow::premultRow(doPremult, width, &simd[0]);
+        ImageRow::premultRow(doPremult, width, &scalar[0], Color::eSIMDLevelNone);
+        ASSERT_EQ( 0, std::memcmp( &simd[0], &scalar[0], simd.size() * sizeof(PIX) ) );
+    }
+}
+
+// the SSE2 kernels of the mask/mix, premultiplication and channel copy give the same results as the scalar loop
+TEST(ImageRowTest,KernelsMatchScalar) {
+    checkImageRowMatchesScalar<unsigned char>(255);
+    checkImageRowMatchesScalar<unsigned short>(65535);
+    checkImageRowMatchesScalar<float>(1);
+}
+
+// random RGBA source and destination rows and a mask row of a 4K frame
+template <typename PIX>
+static void
+makeImageRows4K(int maxValue,
+                std::vector<PIX>* src,
+                std::vector<PIX>* dst,
+                std::vector<PIX>* mask)
+{
+    const int width = 3840;
+
+    src->resize(width * 4);
+    dst->resize(width * 4);
+    mask->resize(width);
+    std::srand(8);
+    for (std::size_t i = 0; i < src->size(); ++i) {
+        (*src)[i] = PIX( (float)std::rand() / RAND_MAX * maxValue );
+        (*dst)[i] = PIX( (float)std::rand() / RAND_MAX * maxValue );
+    }
+    for (int x = 0; x < width; ++x) {
+        (*mask)[x] = PIX( (float)std::rand() / RAND_MAX * maxValue );
+    }
+}
+
+template <typename PIX>
+static void
+checkImageRow4KMatchesScalar(int maxValue)
+{
+    const int width = 3840;
+    const int height = 8;
+    std::vector<PIX> src, dst, mask;
+
+    makeImageRows4K<PIX>(maxValue, &src, &dst, &mask);
+    const std::bitset<4> processChannels(1); // R was processed, copy GBA
+    const int componentsCounts[] = { 1, 3, 4 };
+    const Color::SIMDLevelEnum levels[] = { Color::eSIMDLevelNone, Color::getSupportedSIMDLevel() };
+    for (int c = 0; c < 3; ++c) {
+        const int nComps = componentsCounts[c];
+        for (int kernel = 0; kernel < 3; ++kernel) {
+            if ( (kernel == 1) && (nComps != 4) ) {
+                continue; // only RGBA is premultiplied
+            }
+            // the kernels are applied on the same row again and again, as on the rows of a frame processed in place
+            std::vector<PIX> rows[2];
+            for (int l = 0; l < 2; ++l) {
+                rows[l] = dst;
+                for (int y = 0; y < height; ++y) {
+                    if (kernel == 0) {
+                        ImageRow::maskMixRow(&src[0], nComps, &mask[0], false, 0.7f, width, &rows[l][0], nComps, levels[l]);
+                    } else if (kernel == 1) {
+                        ImageRow::premultRow(y & 1, width, &rows[l][0], levels[l]);
+                    } else {
+                        ImageRow::copyUnProcessedChannelsRow(&src[0], nComps, nComps == 4, processChannels, nComps == 4,
+                                                             width, &rows[l][0], nComps, levels[l]);
+                    }
+                }
+            }
+            ASSERT_EQ( 0, std::memcmp( &rows[0][0], &rows[1][0], rows[0].size() * sizeof(PIX) ) ) << "kernel " << kernel << " x" << nComps;
+        }
+    }
+}
+
+// the row kernels give the same results as the scalar loop over rows of a 4K frame, the rows are processed in parallel bands by Image
+TEST(ImageRowTest,KernelsMatchScalar4K) {
+    checkImageRow4KMatchesScalar<unsigned char>(255);
+    checkImageRow4KMatchesScalar<unsigned short>(65535);
+    checkImageRow4KMatchesScalar<float>(1);
+}
+
+template <typename PIX>
+static void
+printImageRowThroughput(const char* depthName,
+                        int maxValue)
+{
+    const int width = 3840;
+    const int height = 2160;
+    std::vector<PIX> src, dst, mask;
+
+    makeImageRows4K<PIX>(maxValue, &src, &dst, &mask);
+    const std::bitset<4> processChannels(1); // R was processed, copy GBA
+    const int componentsCounts[] = { 1, 3, 4 };
+    const Color::SIMDLevelEnum levels[] = { Color::eSIMDLevelNone, Color::getSupportedSIMDLevel() };
+    const char* names[] = { "scalar", "SIMD" };
+    for (int c = 0; c < 3; ++c) {
+        const int nComps = componentsCounts[c];
+        for (int kernel = 0; kernel < 3; ++kernel) {
+            if ( (kernel == 1) && (nComps != 4) ) {
+                continue; // only RGBA is premultiplied
+            }
+            const char* kernelName = kernel == 0 ? "maskMix" : (kernel == 1 ? "premult" : "copyUnProcessedChannels");
+            for (int l = 0; l < 2; ++l) {
+                std::vector<PIX> row(dst);
+                TimeLapse timer;
+                for (int y = 0; y < height; ++y) {
+                    if (kernel == 0) {
+                        ImageRow::maskMixRow(&src[0], nComps, &mask[0], false, 0.7f, width, &row[0], nComps, levels[l]);
+                    } else if (kernel == 1) {
+                        ImageRow::premultRow(y & 1, width, &row[0], levels[l]);
+                    } else {
+                        ImageRow::copyUnProcessedChannelsRow(&src[0], nComps, nComps == 4, processChannels, nComps == 4,
+                                                             width, &row[0], nComps, levels[l]);
+                    }
+                }
+                double elapsed = timer.getTimeSinceCreation();
+                std::cout << kernelName << " " << depthName << " x" << nComps << " (" << names[l] << "): "
+                          << width * height / std::max(elapsed, 1e-9) / 1e9 << " Gpixels/s" << std::endl;
+            }
+        }
+    }
+}
+
+// benchmark, run with --gtest_also_run_disabled_tests --gtest_filter=ImageRowTest.DISABLED_Throughput4K
+// prints the throughput of the row kernels on a 4K frame on one thread, the rows are processed in parallel bands by Image
+TEST(ImageRowTest,DISABLED_Throughput4K) {
+    printImageRowThroughput<unsigned char>("byte", 255);
+    printImageRowThroughput<unsigned short>("short", 65535);
+    printImageRowThroughput<float>("float", 1);
+}
@@ -23,6 +23,8 @@
 // ***** END PYTHON BLOCK *****
 
 #include <cstdlib>
+#include <limits>
+#include <vector>
 #include <gtest/gtest.h>
 #include "Engine/Lut.h"
 
@@ -49,3 +51,46 @@ TEST(Lut,IntConversions) {
         EXPECT_EQ( i, uint8xxToChar( charToUint8xx(i) ) );
     }
 }
+
+TEST(Lut,RowConversionsMatchScalar) {
+    // An odd number of pixels so that the vectorized loops have a remainder
+    const int nPixels = 1027;
+    std::vector<float> from(nPixels * 4);
+    for (std::size_t i = 0; i < from.size(); ++i) {
+        from[i] = -0.5f + 2.5f * (std::rand() / (float)RAND_MAX);
+    }
+    const float specials[] = {
+        0.f, -0.f, 1.f, 0.5f, std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN(), std::numeric_limits<float>::denorm_min(), std::numeric_limits<float>::max()
+    };
+    for (std::size_t i = 0; i < sizeof(specials) / sizeof(specials[0]); ++i) {
+        from[i * 5] = specials[i];
+    }
+    std::vector<unsigned char> bytes(nPixels * 4);
+    for (std::size_t i = 0; i < bytes.size(); ++i) {
+        bytes[i] = (unsigned char)(i * 7);
+    }
+
+    const Lut* luts[] = { LutManager::sRGBLut(), LutManager::Rec709Lut(), LutManager::CineonLut() };
+    std::vector<unsigned short> to( from.size() );
+    std::vector<float> toFloat( bytes.size() );
+    for (int l = 0; l < 3; ++l) {
+        const Lut* lut = luts[l];
+        for (int simd = eSIMDLevelNone; simd <= getSupportedSIMDLevel(); ++simd) {
+            for (int nComps = 3; nComps <= 4; ++nComps) {
+                lut->toColorSpaceUint8xxFromLinearFloatFast(&from[0], &to[0], nPixels, nComps, -1, (SIMDLevelEnum)simd);
+                for (int i = 0; i < nPixels * nComps; ++i) {
+                    ASSERT_EQ(lut->toColorSpaceUint8xxFromLinearFloatFast(from[i]), to[i]) << lut->getName() << " simd " << simd << " at " << i;
+                }
+            }
+            lut->toColorSpaceUint8xxFromLinearFloatFast(&from[0], &to[0], nPixels, 4, 3, (SIMDLevelEnum)simd);
+            for (int i = 0; i < nPixels * 4; ++i) {
+                ASSERT_EQ(lut->toColorSpaceUint8xxFromLinearFloatFast(from[i] * from[(i / 4) * 4 + 3]), to[i]) << lut->getName() << " simd " << simd << " at " << i;
+            }
+            lut->fromColorSpaceUint8ToLinearFloatFast(&bytes[0], &toFloat[0], (int)bytes.size(), (SIMDLevelEnum)simd);
+            for (std::size_t i = 0; i < bytes.size(); ++i) {
+                ASSERT_EQ(lut->fromColorSpaceUint8ToLinearFloatFast(bytes[i]), toFloat[i]) << lut->getName() << " simd " << simd << " at " << i;
+            }
+        }
+    }
+}
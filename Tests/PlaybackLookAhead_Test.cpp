@@ -0,0 +1,107 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <gtest/gtest.h>
+
+#include "Engine/OutputSchedulerThread.h"
+
+NATRON_NAMESPACE_USING
+
+static OutputSchedulerThread::PlaybackSequence
+makeSequence(PlaybackModeEnum mode,
+             OutputSchedulerThread::RenderDirectionEnum direction,
+             int frameStep = 1)
+{
+    OutputSchedulerThread::PlaybackSequence sequence;
+
+    sequence.mode = mode;
+    sequence.direction = direction;
+    sequence.firstFrame = 1;
+    sequence.lastFrame = 100;
+    sequence.frameStep = frameStep;
+
+    return sequence;
+}
+
+// the window starts at the playhead and only contains the frames it will reach next
+TEST(PlaybackLookAhead, WindowFollowsDirection) {
+    const OutputSchedulerThread::PlaybackSequence forward = makeSequence(ePlaybackModeLoop, OutputSchedulerThread::eRenderDirectionForward);
+
+    EXPECT_EQ( 0, OutputSchedulerThread::getStepsInSequence(forward, 10, 10, 8) );
+    EXPECT_EQ( 7, OutputSchedulerThread::getStepsInSequence(forward, 10, 17, 8) );
+    EXPECT_EQ( -1, OutputSchedulerThread::getStepsInSequence(forward, 10, 18, 8) );
+    EXPECT_EQ( -1, OutputSchedulerThread::getStepsInSequence(forward, 10, 9, 8) );
+
+    const OutputSchedulerThread::PlaybackSequence backward = makeSequence(ePlaybackModeLoop, OutputSchedulerThread::eRenderDirectionBackward);
+    EXPECT_EQ( 5, OutputSchedulerThread::getStepsInSequence(backward, 10, 5, 8) );
+    EXPECT_EQ( -1, OutputSchedulerThread::getStepsInSequence(backward, 10, 11, 8) );
+
+    const OutputSchedulerThread::PlaybackSequence twos = makeSequence(ePlaybackModeLoop, OutputSchedulerThread::eRenderDirectionForward, 2);
+    EXPECT_EQ( 2, OutputSchedulerThread::getStepsInSequence(twos, 1, 5, 8) );
+    EXPECT_EQ( -1, OutputSchedulerThread::getStepsInSequence(twos, 1, 4, 8) );
+}
+
+// at the bounds of the range the window continues where the playhead goes: back to the start, back in the other direction, or nowhere
+TEST(PlaybackLookAhead, WindowAtTheBounds) {
+    const OutputSchedulerThread::PlaybackSequence loop = makeSequence(ePlaybackModeLoop, OutputSchedulerThread::eRenderDirectionForward);
+
+    EXPECT_EQ( 2, OutputSchedulerThread::getStepsInSequence(loop, 98, 100, 8) );
+    EXPECT_EQ( 3, OutputSchedulerThread::getStepsInSequence(loop, 98, 1, 8) );
+
+    // in bounce mode the frames behind the playhead are rendered again on the way back
+    const OutputSchedulerThread::PlaybackSequence bounce = makeSequence(ePlaybackModeBounce, OutputSchedulerThread::eRenderDirectionForward);
+    EXPECT_EQ( 1, OutputSchedulerThread::getStepsInSequence(bounce, 98, 99, 8) );
+    EXPECT_EQ( 5, OutputSchedulerThread::getStepsInSequence(bounce, 98, 97, 8) );
+    EXPECT_EQ( -1, OutputSchedulerThread::getStepsInSequence(bounce, 98, 1, 8) );
+
+    const OutputSchedulerThread::PlaybackSequence once = makeSequence(ePlaybackModeOnce, OutputSchedulerThread::eRenderDirectionForward);
+    EXPECT_EQ( 1, OutputSchedulerThread::getStepsInSequence(once, 99, 100, 8) );
+    EXPECT_EQ( -1, OutputSchedulerThread::getStepsInSequence(once, 99, 1, 8) );
+    EXPECT_EQ( -1, OutputSchedulerThread::getStepsInSequence(once, 99, 98, 8) );
+}
+
+// the window keeps the render threads busy and covers the render time of a frame at the requested fps
+TEST(PlaybackLookAhead, DepthFromRenderTime) {
+    // no render time measured yet
+    EXPECT_EQ( 8, OutputSchedulerThread::getLookAheadFrames(4, 0, 24., 0., 8, 0., 0) );
+    // frames take half a second: 12 frames are displayed while one is rendered
+    EXPECT_EQ( 16, OutputSchedulerThread::getLookAheadFrames(4, 0, 24., 0.5, 8, 0., 0) );
+    // rendering as fast as possible
+    EXPECT_EQ( 24, OutputSchedulerThread::getLookAheadFrames(4, 0, 0., 0.5, 8, 0., 0) );
+    // no render thread started yet
+    EXPECT_EQ( 2, OutputSchedulerThread::getLookAheadFrames(0, 0, 24., 0., 1, 0., 0) );
+}
+
+// the depth requested by the output device replaces the computed one, and the RAM budget bounds both
+TEST(PlaybackLookAhead, DepthBounds) {
+    EXPECT_EQ( 12, OutputSchedulerThread::getLookAheadFrames(4, 12, 24., 0.5, 8, 0., 0) );
+
+    const double frameSize = 100. * 1024 * 1024;
+    const U64 budget = (U64)1000 * 1024 * 1024;
+    EXPECT_EQ( 10, OutputSchedulerThread::getLookAheadFrames(4, 0, 24., 0.5, 8, frameSize, budget) );
+    EXPECT_EQ( 10, OutputSchedulerThread::getLookAheadFrames(4, 12, 24., 0.5, 8, frameSize, budget) );
+    EXPECT_EQ( 8, OutputSchedulerThread::getLookAheadFrames(4, 0, 24., 0., 8, frameSize, budget) );
+    // a frame larger than the budget: the playback still goes on, one frame at a time
+    EXPECT_EQ( 1, OutputSchedulerThread::getLookAheadFrames(4, 0, 24., 0.5, 8, frameSize, budget / 20) );
+}
@@ -0,0 +1,186 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
+#include <QtCore/QStringList>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
+
+#include "Engine/CLArgs.h"
+#include "Engine/RenderDaemon.h"
+
+NATRON_NAMESPACE_USING
+
+///A connected pair of local sockets, standing for the client and the daemon
+class RenderDaemonSocketTest
+    : public ::testing::Test
+{
+protected:
+
+    QLocalServer server;
+    QLocalSocket client;
+    QLocalSocket* daemonSide;
+
+    RenderDaemonSocketTest()
+        : server()
+        , client()
+        , daemonSide(0)
+    {
+    }
+
+    virtual void SetUp()
+    {
+        const QString name = QString("NatronRenderDaemonTest-%1").arg( QCoreApplication::applicationPid() );
+
+        QLocalServer::removeServer(name);
+        ASSERT_TRUE( server.listen(name) );
+        client.connectToServer(name);
+        ASSERT_TRUE( client.waitForConnected(NATRON_RENDER_DAEMON_TIMEOUT_MS) );
+        ASSERT_TRUE( server.waitForNewConnection(NATRON_RENDER_DAEMON_TIMEOUT_MS) );
+        daemonSide = server.nextPendingConnection();
+        ASSERT_TRUE(daemonSide != 0);
+    }
+
+    virtual void TearDown()
+    {
+        delete daemonSide;
+        server.close();
+    }
+};
+
+static CLArgs
+makeCLArgs(const QStringList& args)
+{
+    CLArgs cl(QStringList("NatronRenderer") + args, true);
+
+    EXPECT_EQ( 0, cl.getError() ) << args.join( QString(' ') ).toStdString();
+
+    return cl;
+}
+
+TEST_F(RenderDaemonSocketTest, JobRoundTrip) {
+    QStringList job;
+
+    job << "/home/me/shots" << "-w" << "Write1" << "/home/me/renders/my shot ###.exr" << "1-10" << QString::fromUtf8("plan \xC3\xA9t\xC3\xA9.ntp");
+    ASSERT_TRUE( RenderDaemon::writeJob(&client, job) );
+
+    QStringList received;
+    ASSERT_TRUE( RenderDaemon::readJob(daemonSide, &received) );
+    EXPECT_EQ(job, received);
+    EXPECT_EQ( 0, daemonSide->bytesAvailable() );
+}
+
+TEST_F(RenderDaemonSocketTest, JobsBackToBack) {
+    QStringList first;
+    QStringList second;
+
+    first << "/tmp" << "-w" << "Write1" << "a.ntp";
+    second << "/tmp" << "-w" << "Write2" << "5-6" << "b.ntp";
+    ASSERT_TRUE( RenderDaemon::writeJob(&client, first) );
+    ASSERT_TRUE( RenderDaemon::writeJob(&client, second) );
+
+    ///Each job is read on its own even if both are already in the socket
+    QStringList received;
+    ASSERT_TRUE( RenderDaemon::readJob(daemonSide, &received) );
+    EXPECT_EQ(first, received);
+    ASSERT_TRUE( RenderDaemon::readJob(daemonSide, &received) );
+    EXPECT_EQ(second, received);
+}
+
+TEST_F(RenderDaemonSocketTest, TruncatedJob) {
+    QStringList job;
+
+    job << "/tmp" << "-w" << "Write1" << "a.ntp";
+
+    QByteArray block;
+    {
+        QDataStream out(&block, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_4_8);
+        out << (quint32)0 << job;
+        out.device()->seek(0);
+        out << (quint32)(block.size() - sizeof(quint32));
+    }
+
+    ///The client goes away in the middle of the job
+    client.write( block.left(block.size() / 2) );
+    ASSERT_TRUE( client.waitForBytesWritten(NATRON_RENDER_DAEMON_TIMEOUT_MS) );
+    client.disconnectFromServer();
+
+    QStringList received;
+    EXPECT_FALSE( RenderDaemon::readJob(daemonSide, &received) );
+}
+
+TEST(RenderDaemon, SubmitOptionsStripped) {
+    QStringList args;
+
+    args << "-w" << "Write1" << "--submit" << "1-10" << "--socket" << "render2" << "project.ntp";
+    const CLArgs cl = makeCLArgs(args);
+    EXPECT_TRUE( cl.isRenderDaemonClient() );
+    EXPECT_EQ( QString("render2"), cl.getRenderDaemonName() );
+
+    QStringList expected;
+    expected << "-w" << "Write1" << "1-10" << "project.ntp";
+    EXPECT_EQ( expected, cl.getRenderDaemonJobArguments() );
+
+    ///The daemon parses the job as a plain background render
+    const CLArgs job = makeCLArgs( cl.getRenderDaemonJobArguments() );
+    EXPECT_FALSE( job.isRenderDaemonClient() );
+    EXPECT_TRUE( job.getRenderDaemonName().isEmpty() );
+    EXPECT_TRUE( job.hasFrameRange() );
+    ASSERT_EQ( 1, (int)job.getWriterArgs().size() );
+    EXPECT_EQ( QString("Write1"), job.getWriterArgs().front().name );
+    EXPECT_EQ( cl.getScriptFilename(), job.getScriptFilename() );
+}
+
+TEST(RenderDaemon, NoJobWithoutSubmit) {
+    QStringList args;
+
+    args << "--socket" << "render2" << "-w" << "Write1" << "project.ntp";
+    const CLArgs cl = makeCLArgs(args);
+    EXPECT_FALSE( cl.isRenderDaemonClient() );
+    EXPECT_TRUE( cl.getRenderDaemonJobArguments().isEmpty() );
+}
+
+TEST(RenderDaemon, JobModifiesProject) {
+    QStringList plain;
+
+    plain << "-w" << "Write1" << "1-10" << "project.ntp";
+    EXPECT_FALSE( RenderDaemon::jobModifiesProject( makeCLArgs(plain) ) );
+
+    QStringList writerFilename;
+    writerFilename << "-w" << "Write1" << "/renders/out###.exr" << "1-10" << "project.ntp";
+    EXPECT_TRUE( RenderDaemon::jobModifiesProject( makeCLArgs(writerFilename) ) );
+
+    QStringList pythonCommand;
+    pythonCommand << "-c" << "app.Write1.getParam('frameRange').set(1)" << "-w" << "Write1" << "project.ntp";
+    EXPECT_TRUE( RenderDaemon::jobModifiesProject( makeCLArgs(pythonCommand) ) );
+
+    QStringList reader;
+    reader << "-i" << "Read1" << "/footage/in###.exr" << "-w" << "Write1" << "project.ntp";
+    EXPECT_TRUE( RenderDaemon::jobModifiesProject( makeCLArgs(reader) ) );
+}
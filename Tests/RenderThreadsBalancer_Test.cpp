@@ -0,0 +1,135 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include "Engine/RenderThreadsBalancer.h"
+
+NATRON_NAMESPACE_USING
+
+#define BALANCER_TEST_CORES 16
+
+///A render where each frame keeps framesParallelism cores busy (its tiles) and where frames rendered in parallel
+///beyond the cores slow each other down by contentionCost
+struct SimulatedRender
+{
+    double framesParallelism;
+    double contentionCost;
+
+    double utilization(int threads) const
+    {
+        return std::min(1., threads * framesParallelism / BALANCER_TEST_CORES);
+    }
+
+    double throughput(int threads) const
+    {
+        const double demand = threads * framesParallelism / BALANCER_TEST_CORES;
+        double fps = 40. * utilization(threads);
+        if (demand > 1.) {
+            fps /= 1. + contentionCost * (demand - 1.);
+        }
+
+        return fps;
+    }
+};
+
+///Runs the balancer for the given number of one-second periods and returns the number of parallel frames
+static int
+runBalancer(const SimulatedRender& render,
+            int periods,
+            int* maxReached = 0)
+{
+    RenderThreadsBalancer balancer;
+
+    balancer.reset(BALANCER_TEST_CORES, BALANCER_TEST_CORES);
+    double wallTime = 0.;
+    double cpuTime = 0.;
+    int threads = balancer.update(wallTime, cpuTime);
+    int maxThreads = threads;
+    for (int p = 0; p < periods; ++p) {
+        const int frames = (int)render.throughput(threads);
+        for (int f = 0; f < frames; ++f) {
+            balancer.addFrameRendered();
+        }
+        wallTime += 1.;
+        cpuTime += render.utilization(threads) * BALANCER_TEST_CORES;
+        threads = balancer.update(wallTime, cpuTime);
+        maxThreads = std::max(maxThreads, threads);
+    }
+    if (maxReached) {
+        *maxReached = maxThreads;
+    }
+
+    return threads;
+}
+
+// heavy nodes whose tiles scale well: rendering less frames in parallel is as fast and holds less memory
+TEST(RenderThreadsBalancer, ShiftsToTilesWhenSaturated) {
+    SimulatedRender render;
+    render.framesParallelism = 8.;
+    render.contentionCost = 0.2;
+
+    const int threads = runBalancer(render, 200);
+    EXPECT_GE(threads, 2);
+    EXPECT_LE(threads, 3);
+}
+
+// light nodes, or nodes that barely use the tiles: the CPU is only used by rendering many frames in parallel
+TEST(RenderThreadsBalancer, ShiftsToFramesWhenUnderused) {
+    SimulatedRender render;
+    render.framesParallelism = 1.;
+    render.contentionCost = 0.;
+
+    int maxReached;
+    const int threads = runBalancer(render, 200, &maxReached);
+    EXPECT_EQ(BALANCER_TEST_CORES, maxReached);
+    // the probes toward less frames are rejected
+    EXPECT_GE(threads, BALANCER_TEST_CORES - 1);
+}
+
+// without the CPU time, the throughput alone still prevents losing speed
+TEST(RenderThreadsBalancer, KeepsThroughputWithoutCPUTime) {
+    SimulatedRender render;
+    render.framesParallelism = 1.;
+    render.contentionCost = 0.;
+
+    RenderThreadsBalancer balancer;
+    balancer.reset(BALANCER_TEST_CORES, BALANCER_TEST_CORES);
+    double wallTime = 0.;
+    int threads = balancer.update(wallTime, -1.);
+    int minThreads = threads;
+    for (int p = 0; p < 200; ++p) {
+        const int frames = (int)render.throughput(threads);
+        for (int f = 0; f < frames; ++f) {
+            balancer.addFrameRendered();
+        }
+        wallTime += 1.;
+        threads = balancer.update(wallTime, -1.);
+        minThreads = std::min(minThreads, threads);
+    }
+    EXPECT_LT(balancer.getLastUtilization(), 0.);
+    EXPECT_GE(minThreads, BALANCER_TEST_CORES - 1);
+}
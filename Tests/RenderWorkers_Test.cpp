@@ -0,0 +1,166 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <climits>
+#include <list>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <QtCore/QStringList>
+
+#include "Engine/CLArgs.h"
+#include "Engine/RenderWorkers.h"
+
+NATRON_NAMESPACE_USING
+
+static std::vector<int>
+makeFrames(int first,
+           int last,
+           int step = 1)
+{
+    std::vector<int> frames;
+
+    for (int f = first; f <= last; f += step) {
+        frames.push_back(f);
+    }
+
+    return frames;
+}
+
+///The frames a render process renders when given the frame ranges argument, as parsed by its command-line
+static std::vector<int>
+parseFrameRangesArgument(const QString& rangesArg)
+{
+    QStringList args;
+
+    args << "NatronRenderer" << "-w" << "Write1" << rangesArg << "project.ntp";
+    CLArgs cl(args, true);
+    EXPECT_EQ( 0, cl.getError() );
+    EXPECT_TRUE( cl.hasFrameRange() ) << rangesArg.toStdString();
+
+    std::vector<int> frames;
+    const std::list<std::pair<int, std::pair<int, int> > >& ranges = cl.getFrameRanges();
+    for (std::list<std::pair<int, std::pair<int, int> > >::const_iterator it = ranges.begin(); it != ranges.end(); ++it) {
+        // a single frame has no step
+        const int step = it->first == INT_MIN ? 1 : it->first;
+        EXPECT_GT(step, 0) << rangesArg.toStdString();
+        if (step <= 0) {
+            break;
+        }
+        for (int f = it->second.first; f <= it->second.second; f += step) {
+            frames.push_back(f);
+        }
+    }
+
+    return frames;
+}
+
+TEST(RenderWorkers, ShardFramesInterleaved) {
+    std::vector<std::vector<int> > shards;
+
+    RenderWorkers::shardFrames(makeFrames(1, 10), 3, false, &shards);
+    ASSERT_EQ(3U, shards.size());
+    EXPECT_EQ(makeFrames(1, 10, 3), shards[0]);
+    EXPECT_EQ(makeFrames(2, 8, 3), shards[1]);
+    EXPECT_EQ(makeFrames(3, 9, 3), shards[2]);
+}
+
+TEST(RenderWorkers, ShardFramesContiguous) {
+    std::vector<std::vector<int> > shards;
+
+    RenderWorkers::shardFrames(makeFrames(1, 10), 3, true, &shards);
+    ASSERT_EQ(3U, shards.size());
+    EXPECT_EQ(makeFrames(1, 4), shards[0]);
+    EXPECT_EQ(makeFrames(5, 7), shards[1]);
+    EXPECT_EQ(makeFrames(8, 10), shards[2]);
+}
+
+// a process is never started without frames
+TEST(RenderWorkers, ShardFramesMoreShardsThanFrames) {
+    std::vector<std::vector<int> > shards;
+    std::vector<int> frames;
+
+    frames.push_back(3);
+    frames.push_back(7);
+    for (int contiguous = 0; contiguous < 2; ++contiguous) {
+        RenderWorkers::shardFrames(frames, 5, contiguous != 0, &shards);
+        ASSERT_EQ(2U, shards.size());
+        EXPECT_EQ(std::vector<int>(1, 3), shards[0]);
+        EXPECT_EQ(std::vector<int>(1, 7), shards[1]);
+    }
+
+    RenderWorkers::shardFrames(std::vector<int>(), 5, false, &shards);
+    EXPECT_TRUE( shards.empty() );
+}
+
+TEST(RenderWorkers, FrameRangesArgument) {
+    EXPECT_EQ( std::string("5"), RenderWorkers::getFrameRangesArgument( makeFrames(5, 5) ).toStdString() );
+    EXPECT_EQ( std::string("4-8:4"), RenderWorkers::getFrameRangesArgument( makeFrames(4, 8, 4) ).toStdString() );
+    EXPECT_EQ( std::string("1-10:3"), RenderWorkers::getFrameRangesArgument( makeFrames(1, 10, 3) ).toStdString() );
+
+    // runs with different steps, then a single frame
+    std::vector<int> frames = makeFrames(1, 5, 2);
+    frames.push_back(6);
+    frames.push_back(7);
+    frames.push_back(10);
+    EXPECT_EQ( std::string("1-5:2,6-7:1,10"), RenderWorkers::getFrameRangesArgument(frames).toStdString() );
+
+    // negative frames cannot be given in a range
+    frames = makeFrames(-2, 0);
+    frames.push_back(2);
+    frames.push_back(4);
+    EXPECT_EQ( std::string("-2,-1,0-4:2"), RenderWorkers::getFrameRangesArgument(frames).toStdString() );
+}
+
+// the argument given to a render process makes it render exactly the frames of its shard
+TEST(RenderWorkers, FrameRangesArgumentRoundTrip) {
+    std::vector<std::vector<int> > frameLists;
+
+    frameLists.push_back( makeFrames(7, 7) );
+    frameLists.push_back( makeFrames(1, 100) );
+    frameLists.push_back( makeFrames(-10, 10, 3) );
+    frameLists.push_back( makeFrames(-5, -1) );
+    std::vector<int> mixed = makeFrames(1, 9, 2);
+    mixed.push_back(10);
+    mixed.push_back(20);
+    mixed.push_back(21);
+    frameLists.push_back(mixed);
+
+    for (std::size_t i = 0; i < frameLists.size(); ++i) {
+        for (int nShards = 1; nShards <= 4; ++nShards) {
+            for (int contiguous = 0; contiguous < 2; ++contiguous) {
+                std::vector<std::vector<int> > shards;
+                RenderWorkers::shardFrames(frameLists[i], nShards, contiguous != 0, &shards);
+                std::size_t nFrames = 0;
+                for (std::size_t s = 0; s < shards.size(); ++s) {
+                    const QString rangesArg = RenderWorkers::getFrameRangesArgument(shards[s]);
+                    EXPECT_EQ( shards[s], parseFrameRangesArgument(rangesArg) ) << rangesArg.toStdString();
+                    nFrames += shards[s].size();
+                }
+                EXPECT_EQ( frameLists[i].size(), nFrames );
+            }
+        }
+    }
+}
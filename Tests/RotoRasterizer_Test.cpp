@@ -0,0 +1,302 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <list>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include <cairo/cairo.h>
+
+#include "Engine/Image.h"
+#include "Engine/RotoRasterizer.h"
+
+NATRON_NAMESPACE_USING
+
+static Point
+makePoint(double x,
+          double y)
+{
+    Point p;
+
+    p.x = x;
+    p.y = y;
+
+    return p;
+}
+
+// renders the shape in an alpha float image and returns its pixels, bottom row first
+static std::vector<float>
+renderAlpha(const std::vector<Point>& polygon,
+            const std::vector<RotoRasterizer::FeatherQuad>& quads,
+            double fallOff,
+            const RectI& bounds)
+{
+    RectD rod;
+
+    bounds.toCanonical_noClipping(0, 1., &rod);
+    Image img(ImageComponents::getAlphaComponents(), rod, bounds, 0, 1., eImageBitDepthFloat, false);
+    const double color[3] = { 1., 1., 1. };
+    RotoRasterizer::renderShape(polygon, quads, fallOff, color, 1., bounds, &img);
+
+    std::vector<float> ret( bounds.area() );
+    Image::ReadAccess acc = img.getReadRights();
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        const float* pix = (const float*)acc.pixelAt(bounds.x1, y);
+        std::memcpy( &ret[(y - bounds.y1) * bounds.width()], pix, bounds.width() * sizeof(float) );
+    }
+
+    return ret;
+}
+
+// renders the shape the way it was rendered by cairo: the polygon without antialiasing and the feather with mesh patterns
+static std::vector<float>
+renderAlphaWithCairo(const std::vector<Point>& polygon,
+                     const std::vector<RotoRasterizer::FeatherQuad>& quads,
+                     double fallOff,
+                     const RectI& bounds)
+{
+    cairo_surface_t* surface = cairo_image_surface_create( CAIRO_FORMAT_A8, bounds.width(), bounds.height() );
+
+    cairo_surface_set_device_offset(surface, -bounds.x1, -bounds.y1);
+    cairo_t* cr = cairo_create(surface);
+    cairo_set_fill_rule(cr, CAIRO_FILL_RULE_WINDING);
+    cairo_set_antialias(cr, CAIRO_ANTIALIAS_NONE);
+    cairo_set_operator(cr, CAIRO_OPERATOR_OVER);
+
+    cairo_set_source_rgba(cr, 1, 1, 1, 1);
+    cairo_move_to(cr, polygon[0].x, polygon[0].y);
+    for (std::size_t i = 1; i < polygon.size(); ++i) {
+        cairo_line_to(cr, polygon[i].x, polygon[i].y);
+    }
+    cairo_fill(cr);
+
+    if ( !quads.empty() ) {
+        cairo_pattern_t* mesh = cairo_pattern_create_mesh();
+        const double fallOffInverse = 1. / fallOff;
+        for (std::size_t i = 0; i < quads.size(); ++i) {
+            const Point& p0 = quads[i].inner0;
+            const Point& p1 = quads[i].outer0;
+            const Point& p2 = quads[i].outer1;
+            const Point& p3 = quads[i].inner1;
+            Point p0p1, p1p0, p2p3, p3p2;
+            p0p1.x = (p0.x * fallOff * 2. + fallOffInverse * p1.x) / (fallOff * 2. + fallOffInverse);
+            p0p1.y = (p0.y * fallOff * 2. + fallOffInverse * p1.y) / (fallOff * 2. + fallOffInverse);
+            p1p0.x = (p0.x * fallOff + 2. * fallOffInverse * p1.x) / (fallOff + 2. * fallOffInverse);
+            p1p0.y = (p0.y * fallOff + 2. * fallOffInverse * p1.y) / (fallOff + 2. * fallOffInverse);
+            p2p3.x = (p3.x * fallOff + 2. * fallOffInverse * p2.x) / (fallOff + 2. * fallOffInverse);
+            p2p3.y = (p3.y * fallOff + 2. * fallOffInverse * p2.y) / (fallOff + 2. * fallOffInverse);
+            p3p2.x = (p3.x * fallOff * 2. + fallOffInverse * p2.x) / (fallOff * 2. + fallOffInverse);
+            p3p2.y = (p3.y * fallOff * 2. + fallOffInverse * p2.y) / (fallOff * 2. + fallOffInverse);
+
+            cairo_mesh_pattern_begin_patch(mesh);
+            cairo_mesh_pattern_move_to(mesh, p0.x, p0.y);
+            cairo_mesh_pattern_curve_to(mesh, p0p1.x, p0p1.y, p1p0.x, p1p0.y, p1.x, p1.y);
+            cairo_mesh_pattern_line_to(mesh, p2.x, p2.y);
+            cairo_mesh_pattern_curve_to(mesh, p2p3.x, p2p3.y, p3p2.x, p3p2.y, p3.x, p3.y);
+            cairo_mesh_pattern_line_to(mesh, p0.x, p0.y);
+            cairo_mesh_pattern_set_corner_color_rgba(mesh, 0, 1, 1, 1, 1);
+            cairo_mesh_pattern_set_corner_color_rgba(mesh, 1, 1, 1, 1, 0);
+            cairo_mesh_pattern_set_corner_color_rgba(mesh, 2, 1, 1, 1, 0);
+            cairo_mesh_pattern_set_corner_color_rgba(mesh, 3, 1, 1, 1, 1);
+            cairo_mesh_pattern_end_patch(mesh);
+        }
+        cairo_set_source(cr, mesh);
+        cairo_mask(cr, mesh);
+        cairo_pattern_destroy(mesh);
+    }
+    cairo_surface_flush(surface);
+
+    std::vector<float> ret( bounds.area() );
+    const unsigned char* data = cairo_image_surface_get_data(surface);
+    const int stride = cairo_image_surface_get_stride(surface);
+    for (int y = 0; y < bounds.height(); ++y) {
+        for (int x = 0; x < bounds.width(); ++x) {
+            ret[y * bounds.width() + x] = data[y * stride + x] / 255.f;
+        }
+    }
+    cairo_destroy(cr);
+    cairo_surface_destroy(surface);
+
+    return ret;
+}
+
+// a polygon approximating a circle, counter-clockwise
+static std::vector<Point>
+makeCircle(double cx,
+           double cy,
+           double radius,
+           int n)
+{
+    std::vector<Point> ret;
+
+    for (int i = 0; i < n; ++i) {
+        const double a = 2. * M_PI * i / n;
+        ret.push_back( makePoint( cx + radius * std::cos(a), cy + radius * std::sin(a) ) );
+    }
+
+    return ret;
+}
+
+// pixels are covered by the exact area of the shape they contain, whatever the orientation of the shape
+// the coverage of an axis-aligned rectangle is the exact area it covers in each pixel
+static void
+checkRectangleCoverage(const RectI& bounds,
+                       double x1,
+                       double x2,
+                       double y1,
+                       double y2)
+{
+    std::vector<Point> square;
+
+    square.push_back( makePoint(x1, y1) );
+    square.push_back( makePoint(x2, y1) );
+    square.push_back( makePoint(x2, y2) );
+    square.push_back( makePoint(x1, y2) );
+    for (int orientation = 0; orientation < 2; ++orientation) {
+        const std::vector<float> alpha = renderAlpha( square, std::vector<RotoRasterizer::FeatherQuad>(), 1., bounds );
+        for (int y = bounds.y1; y < bounds.y2; ++y) {
+            const double h = std::max( 0., std::min(y + 1., y2) - std::max( (double)y, y1 ) );
+            for (int x = bounds.x1; x < bounds.x2; ++x) {
+                const double w = std::max( 0., std::min(x + 1., x2) - std::max( (double)x, x1 ) );
+                EXPECT_NEAR(w * h, alpha[y * bounds.width() + x], 1e-6);
+                if (w * h == 0.) {
+                    EXPECT_EQ(0.f, alpha[y * bounds.width() + x]);
+                }
+            }
+        }
+        std::reverse( square.begin(), square.end() );
+    }
+}
+
+TEST(RotoRasterizer, SquareCoverage) {
+    checkRectangleCoverage(RectI(0, 0, 16, 12), 3.25, 12.75, 2.5, 9.125);
+}
+
+// large rois are rendered in tiles, whose seams must not show
+TEST(RotoRasterizer, TiledCoverage) {
+    checkRectangleCoverage(RectI(0, 0, 700, 500), -20.5, 611.25, 130.75, 520.);
+}
+
+TEST(RotoRasterizer, MatchesSupersampling) {
+    const RectI bounds(0, 0, 100, 96);
+    std::vector<Point> star;
+
+    for (int i = 0; i < 10; ++i) {
+        const double a = M_PI * i / 5. + 0.3;
+        const double r = (i % 2) ? 18. : 40.;
+        star.push_back( makePoint( 30.3 + r * std::cos(a), 47.7 + r * std::sin(a) ) );
+    }
+    const std::vector<float> alpha = renderAlpha( star, std::vector<RotoRasterizer::FeatherQuad>(), 1., bounds );
+
+    const int n = 16;
+    double sumError = 0.;
+    for (int y = bounds.y1; y < bounds.y2; ++y) {
+        for (int x = bounds.x1; x < bounds.x2; ++x) {
+            int inside = 0;
+            for (int sy = 0; sy < n; ++sy) {
+                for (int sx = 0; sx < n; ++sx) {
+                    const double px = x + (sx + 0.5) / n;
+                    const double py = y + (sy + 0.5) / n;
+                    int winding = 0;
+                    for (std::size_t i = 0; i < star.size(); ++i) {
+                        const Point& a = star[i];
+                        const Point& b = star[(i + 1) % star.size()];
+                        if ( (a.y <= py) != (b.y <= py) ) {
+                            const double ix = a.x + (py - a.y) * (b.x - a.x) / (b.y - a.y);
+                            if (ix > px) {
+                                winding += (b.y > a.y) ? 1 : -1;
+                            }
+                        }
+                    }
+                    inside += (winding != 0);
+                }
+            }
+            const double error = std::abs(alpha[y * bounds.width() + x] - (double)inside / (n * n));
+            EXPECT_LE(error, 0.1);
+            sumError += error;
+        }
+    }
+    EXPECT_LE(sumError / bounds.area(), 0.005);
+}
+
+// the feather profile goes from 1 on the shape to 0 on the feather contour, a fall-off of 1 is a quadratic ramp
+TEST(RotoRasterizer, FeatherFallOff) {
+    const double fallOffs[3] = { 0.3, 1., 3. };
+
+    for (int f = 0; f < 3; ++f) {
+        EXPECT_NEAR( 1., RotoRasterizer::featherFallOffValue(0., fallOffs[f]), 1e-9 );
+        EXPECT_NEAR( 0., RotoRasterizer::featherFallOffValue(1., fallOffs[f]), 1e-9 );
+        double prev = 1.;
+        for (int i = 1; i <= 100; ++i) {
+            const double v = RotoRasterizer::featherFallOffValue(i / 100., fallOffs[f]);
+            EXPECT_LE(v, prev);
+            prev = v;
+        }
+    }
+    for (int i = 0; i <= 100; ++i) {
+        const double x = i / 100.;
+        EXPECT_NEAR( (1. - x) * (1. - x), RotoRasterizer::featherFallOffValue(x, 1.), 1e-9 );
+    }
+}
+
+// the native rasterizer gives the image cairo gave, up to the antialiasing of the edges of the shape
+TEST(RotoRasterizer, MatchesCairo) {
+    const RectI bounds(0, 0, 80, 80);
+    const double cx = 40.4, cy = 39.6;
+    const std::vector<Point> circle = makeCircle(cx, cy, 25., 200);
+    const std::list<Point> polygon( circle.begin(), circle.end() );
+
+    // without feather, only the pixels on the edges differ
+    {
+        const std::vector<RotoRasterizer::FeatherQuad> quads;
+        const std::vector<float> alpha = renderAlpha(circle, quads, 1., bounds);
+        const std::vector<float> cairoAlpha = renderAlphaWithCairo(circle, quads, 1., bounds);
+        for (std::size_t i = 0; i < alpha.size(); ++i) {
+            if ( (alpha[i] == 0.f) || (alpha[i] == 1.f) ) {
+                EXPECT_EQ(alpha[i], cairoAlpha[i]);
+            }
+        }
+    }
+
+    // with a feather
+    const double fallOffs[2] = { 1., 2.5 };
+    for (int f = 0; f < 2; ++f) {
+        std::vector<RotoRasterizer::FeatherQuad> quads;
+        RotoRasterizer::computeFeatherQuads(polygon, polygon, false, 8., &quads);
+        ASSERT_FALSE( quads.empty() );
+        // the feather goes outwards
+        EXPECT_NEAR( 33., std::sqrt( (quads[0].outer0.x - cx) * (quads[0].outer0.x - cx) + (quads[0].outer0.y - cy) * (quads[0].outer0.y - cy) ), 0.1 );
+
+        const std::vector<float> alpha = renderAlpha(circle, quads, fallOffs[f], bounds);
+        const std::vector<float> cairoAlpha = renderAlphaWithCairo(circle, quads, fallOffs[f], bounds);
+        double sumError = 0.;
+        for (std::size_t i = 0; i < alpha.size(); ++i) {
+            sumError += std::abs(alpha[i] - cairoAlpha[i]);
+        }
+        EXPECT_LE(sumError / alpha.size(), 0.01);
+    }
+}
@@ -0,0 +1,154 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <QtCore/QAtomicInt>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+
+#include "Engine/EffectInstance.h"
+#include "Engine/TaskScheduler.h"
+#include "Engine/TLSHolder.h"
+
+NATRON_NAMESPACE_USING
+
+typedef TLSHolder<EffectInstance::EffectTLSData> EffectTLSHolder;
+typedef boost::shared_ptr<EffectTLSHolder> EffectTLSHolderPtr;
+
+static QAtomicInt tilesFailed;
+
+///Mimics a host frame threading tile: use the TLS of the thread that launched the render and access
+///the TLS of a few effects of the tree, as the render of a tile does.
+static void
+tileTask(AppTLS* appTLS,
+         const std::vector<EffectTLSHolderPtr>* holders,
+         const QThread* callingThread,
+         const TLSSnapshotPtr& callingThreadTLS)
+{
+    QThread* curThread = QThread::currentThread();
+
+    if (curThread == callingThread) {
+        // The calling thread renders with its own TLS
+        return;
+    }
+    appTLS->copyTLS(callingThreadTLS);
+    for (std::size_t i = 0; i < holders->size(); ++i) {
+        boost::shared_ptr<EffectInstance::EffectTLSData> tls = (*holders)[i]->getOrCreateTLSData();
+        if ( !tls || (tls->actionRecursionLevel != 1) ) {
+            tilesFailed.fetchAndAddOrdered(1);
+        } else {
+            tls->actionRecursionLevel = 2;
+        }
+    }
+    appTLS->cleanupTLSForThread();
+}
+
+TEST(TLSHolder,CopiedToSpawnedThreads) {
+    AppTLS appTLS;
+    std::vector<EffectTLSHolderPtr> holders(8);
+    for (std::size_t i = 0; i < holders.size(); ++i) {
+        holders[i].reset(new EffectTLSHolder);
+        holders[i]->getOrCreateTLSData()->actionRecursionLevel = 1;
+    }
+    
+    TaskScheduler scheduler( QThread::idealThreadCount() );
+    tilesFailed = 0;
+    {
+        TaskGroup group(&scheduler);
+        const TLSSnapshotPtr snapshot = appTLS.takeSnapshot();
+        ASSERT_TRUE(snapshot);
+        for (int i = 0; i < 1000; ++i) {
+            group.run( boost::bind(tileTask, &appTLS, &holders, QThread::currentThread(), snapshot) );
+        }
+        // The spawned threads see the TLS as it was when the snapshot was taken
+        for (std::size_t i = 0; i < holders.size(); ++i) {
+            holders[i]->getOrCreateTLSData()->actionRecursionLevel = 3;
+        }
+        EXPECT_TRUE( group.wait() );
+    }
+    EXPECT_EQ(0, (int)tilesFailed);
+    
+    // The spawned threads modified their copy only
+    for (std::size_t i = 0; i < holders.size(); ++i) {
+        EXPECT_EQ(3, holders[i]->getTLSData()->actionRecursionLevel);
+    }
+    
+    appTLS.cleanupTLSForThread();
+    EXPECT_FALSE( holders.front()->getTLSData() );
+}
+
+///A thread keeping the TLS of a holder until the holder is destroyed
+class TLSUserThread
+    : public QThread
+{
+public:
+
+    EffectTLSHolder* holder;
+    boost::weak_ptr<EffectInstance::EffectTLSData> value;
+    QSemaphore valueSet;
+    QSemaphore holderDestroyed;
+
+    TLSUserThread(EffectTLSHolder* holder)
+        : holder(holder)
+        , value()
+        , valueSet()
+        , holderDestroyed()
+    {
+    }
+
+protected:
+
+    virtual void run()
+    {
+        value = holder->getOrCreateTLSData();
+        valueSet.release();
+        holderDestroyed.acquire();
+    }
+};
+
+TEST(TLSHolder,DestroyedHolderReleasedInAllThreads) {
+    boost::scoped_ptr<EffectTLSHolder> holder(new EffectTLSHolder);
+    holder->getOrCreateTLSData()->actionRecursionLevel = 1;
+    TLSUserThread thread( holder.get() );
+    thread.start();
+    thread.valueSet.acquire();
+    EXPECT_FALSE( thread.value.expired() );
+    
+    holder.reset();
+    EXPECT_TRUE( thread.value.expired() );
+    
+    // A holder reusing the slot of the destroyed holder does not see its TLS
+    EffectTLSHolder newHolder;
+    EXPECT_FALSE( newHolder.getTLSData() );
+    
+    thread.holderDestroyed.release();
+    thread.wait();
+}
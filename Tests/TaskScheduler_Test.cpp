@@ -0,0 +1,104 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <vector>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+
+#include <QtCore/QAtomicInt>
+
+#include "Engine/TaskScheduler.h"
+
+NATRON_NAMESPACE_USING
+
+static QAtomicInt leavesCount;
+
+static void
+leafTask(int* result,
+         int value)
+{
+    *result = value;
+    leavesCount.fetchAndAddOrdered(1);
+}
+
+///Mimics a tile of a node spawning the tiles of its upstream node and waiting on them
+static void
+nestedTask(TaskScheduler* scheduler,
+           int* result)
+{
+    std::vector<int> values(8);
+    TaskGroup group(scheduler);
+
+    for (int i = 0; i < 8; ++i) {
+        group.run( boost::bind(leafTask, &values[i], i) );
+    }
+    group.wait();
+    *result = 0;
+    for (int i = 0; i < 8; ++i) {
+        *result += values[i];
+    }
+}
+
+static void
+throwingTask()
+{
+    throw std::runtime_error("TaskScheduler test");
+}
+
+TEST(TaskScheduler,NestedGroups) {
+    leavesCount = 0;
+    // Use less workers than top-level tasks so that waiting workers have to help
+    for (int nThreads = 1; nThreads <= 4; ++nThreads) {
+        TaskScheduler scheduler(nThreads);
+        std::vector<int> results(32);
+        TaskGroup group(&scheduler);
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            group.run( boost::bind(nestedTask, &scheduler, &results[i]) );
+        }
+        EXPECT_TRUE( group.wait() );
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            EXPECT_EQ(28, results[i]);
+        }
+    }
+    EXPECT_EQ(4 * 32 * 8, (int)leavesCount);
+}
+
+TEST(TaskScheduler,ExceptionIsReported) {
+    TaskScheduler scheduler(2);
+    int value = 0;
+    TaskGroup group(&scheduler);
+
+    group.run(throwingTask);
+    group.run( boost::bind(leafTask, &value, 1) );
+    EXPECT_FALSE( group.wait() );
+    EXPECT_EQ(1, value);
+
+    // The failure is not sticky
+    group.run( boost::bind(leafTask, &value, 2) );
+    EXPECT_TRUE( group.wait() );
+    EXPECT_EQ(2, value);
+}
@@ -220,8 +220,18 @@ SOURCES += \
     Hash64_Test.cpp \
     Image_Test.cpp \
     Lut_Test.cpp \
+    Cache_Test.cpp \
     KnobFile_Test.cpp \
-    Curve_Test.cpp
+    Curve_Test.cpp \
+    TaskScheduler_Test.cpp \
+    TLSHolder_Test.cpp \
+    Half_Test.cpp \
+    ViewerRowConverter_Test.cpp \
+    RotoRasterizer_Test.cpp \
+    RenderThreadsBalancer_Test.cpp \
+    PlaybackLookAhead_Test.cpp \
+    RenderWorkers_Test.cpp \
+    RenderDaemon_Test.cpp
 
 HEADERS += \
     BaseTest.h
@@ -0,0 +1,270 @@
+/* ***** BEGIN LICENSE BLOCK *****
+ * This file is part of Natron <http://www.natron.fr/>,
+ * Copyright (C) 2016 INRIA and Alexandre Gauthier-Foichat
+ *
+ * Natron is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Natron is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Natron.  If not, see <http://www.gnu.org/licenses/gpl-2.0.html>
+ * ***** END LICENSE BLOCK ***** */
+
+// ***** BEGIN PYTHON BLOCK *****
+// from <https://docs.python.org/3/c-api/intro.html#include-files>:
+// "Since Python may define some pre-processor definitions which affect the standard headers on some systems, you must include Python.h before any standard headers are included."
+#include <Python.h>
+// ***** END PYTHON BLOCK *****
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include <gtest/gtest.h>
+#include "Engine/Lut.h"
+#include "Engine/Timer.h"
+#include "Engine/ViewerRowConverter.h"
+
+NATRON_NAMESPACE_USING
+
+#define VIEWER_TEST_GAMMA_LUT_NB_VALUES 1023
+
+static std::vector<float>
+makeGammaLut(double gamma)
+{
+    std::vector<float> lut(VIEWER_TEST_GAMMA_LUT_NB_VALUES + 1);
+    for (int i = 0; i <= VIEWER_TEST_GAMMA_LUT_NB_VALUES; ++i) {
+        lut[i] = (float)std::pow(double(i) / VIEWER_TEST_GAMMA_LUT_NB_VALUES, gamma);
+    }
+
+    return lut;
+}
+
+static void
+fillRandomRow(ViewerRowConverter& converter,
+              int n)
+{
+    float* planes[4] = { converter.red(), converter.green(), converter.blue(), converter.alpha() };
+    for (int c = 0; c < 4; ++c) {
+        for (int i = 0; i < n; ++i) {
+            // include values out of [0, 1]
+            planes[c][i] = (float)(std::rand() % 1300) / 1000.f - 0.1f;
+        }
+    }
+}
+
+// the SIMD path must produce exactly the output of the scalar one, for all the options of the viewer
+TEST(ViewerRowConverter, SIMDMatchesScalar) {
+    const std::vector<float> gammaLut = makeGammaLut(1. / 2.2);
+    const int widths[] = { 1, 7, 16, 33, 1920 };
+    const Color::Lut* colorSpaces[] = { NULL, Color::LutManager::sRGBLut() };
+
+    for (int cs = 0; cs < 2; ++cs) {
+        for (int options = 0; options < 8; ++options) {
+            ViewerRowConverter::Params params;
+            params.gain = 1.5;
+            params.offset = -0.05;
+            params.gamma = (options & 1) ? 1. / 2.2 : 1.;
+            params.gammaLut = &gammaLut[0];
+            params.gammaLutValuesCount = VIEWER_TEST_GAMMA_LUT_NB_VALUES;
+            params.luminance = (options & 2) != 0;
+            params.colorSpace = colorSpaces[cs];
+            const bool matte = (options & 4) != 0;
+
+            for (std::size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+                const int n = widths[w];
+                ViewerRowConverter scalar(params, n, Color::eSIMDLevelNone);
+                ViewerRowConverter simd(params, n);
+                std::vector<U32> scalarBGRA(n), simdBGRA(n);
+                std::vector<float> scalarRGBA(n * 4), simdRGBA(n * 4);
+
+                std::srand(n);
+                fillRandomRow(scalar, n);
+                std::srand(n);
+                fillRandomRow(simd, n);
+                scalar.toBGRA8(n, 3, 5, matte ? scalar.alpha() : NULL, &scalarBGRA[0]);
+                simd.toBGRA8(n, 3, 5, matte ? simd.alpha() : NULL, &simdBGRA[0]);
+                EXPECT_EQ(0, std::memcmp( &scalarBGRA[0], &simdBGRA[0], n * sizeof(U32) ) );
+
+                std::srand(n);
+                fillRandomRow(scalar, n);
+                std::srand(n);
+                fillRandomRow(simd, n);
+                scalar.toRGBA32(n, matte ? scalar.red() : NULL, &scalarRGBA[0]);
+                simd.toRGBA32(n, matte ? simd.red() : NULL, &simdRGBA[0]);
+                EXPECT_EQ(0, std::memcmp( &scalarRGBA[0], &simdRGBA[0], n * 4 * sizeof(float) ) );
+            }
+        }
+    }
+}
+
+// the dither only depends on the pixel coordinates: a row converted in several tiles is the same as in one
+TEST(ViewerRowConverter, DitherIsDeterministic) {
+    ViewerRowConverter::Params params;
+    params.colorSpace = Color::LutManager::sRGBLut();
+    const int n = 100;
+    const int split = 37;
+    const int x = -13;
+    const int y = 42;
+    ViewerRowConverter converter(params, n);
+    std::vector<U32> whole(n), tiled(n);
+
+    std::srand(1);
+    fillRandomRow(converter, n);
+    converter.toBGRA8(n, x, y, NULL, &whole[0]);
+
+    std::srand(1);
+    fillRandomRow(converter, n);
+    std::vector<float> planes(4 * n);
+    std::memcpy( &planes[0], converter.red(), n * sizeof(float) );
+    std::memcpy( &planes[n], converter.green(), n * sizeof(float) );
+    std::memcpy( &planes[2 * n], converter.blue(), n * sizeof(float) );
+    std::memcpy( &planes[3 * n], converter.alpha(), n * sizeof(float) );
+    converter.toBGRA8(split, x, y, NULL, &tiled[0]);
+    std::memcpy( converter.red(), &planes[split], (n - split) * sizeof(float) );
+    std::memcpy( converter.green(), &planes[n + split], (n - split) * sizeof(float) );
+    std::memcpy( converter.blue(), &planes[2 * n + split], (n - split) * sizeof(float) );
+    std::memcpy( converter.alpha(), &planes[3 * n + split], (n - split) * sizeof(float) );
+    converter.toBGRA8(n - split, x + split, y, NULL, &tiled[split]);
+
+    EXPECT_EQ(0, std::memcmp( &whole[0], &tiled[0], n * sizeof(U32) ) );
+}
+
+// over an 8x8 block the dithered bytes average to the exact value given by the color-space look-up
+TEST(ViewerRowConverter, DitherPreservesAverage) {
+    ViewerRowConverter::Params params;
+    params.colorSpace = Color::LutManager::sRGBLut();
+    ViewerRowConverter converter(params, 8);
+    U32 row[8];
+
+    for (int v = 0; v <= 100; ++v) {
+        const float value = v / 100.f;
+        const double expected = params.colorSpace->toColorSpaceUint8xxFromLinearFloatFast(value) / 256.;
+        double sum = 0.;
+        for (int y = 0; y < 8; ++y) {
+            for (int i = 0; i < 8; ++i) {
+                converter.red()[i] = converter.green()[i] = converter.blue()[i] = value;
+                converter.alpha()[i] = 1.f;
+            }
+            converter.toBGRA8(8, 0, y, NULL, row);
+            for (int i = 0; i < 8; ++i) {
+                sum += (row[i] >> 16) & 0xff;
+                EXPECT_EQ(row[i] & 0xff, (row[i] >> 16) & 0xff);
+                EXPECT_EQ(0xffU, row[i] >> 24);
+            }
+        }
+        EXPECT_NEAR(expected, sum / 64., 1. / 64.);
+    }
+}
+
+// the SIMD min/max of the auto-contrast must be exactly the scalar one, NaNs included
+TEST(ViewerRowConverter, MinMaxMatchesScalar) {
+    const int widths[] = { 1, 3, 4, 17, 1920 };
+    const int nCompsList[] = { 1, 3, 4 };
+    const DisplayChannelsEnum channelsList[] = {
+        eDisplayChannelsRGB, eDisplayChannelsR, eDisplayChannelsG, eDisplayChannelsB, eDisplayChannelsA, eDisplayChannelsY
+    };
+
+    for (int w = 0; w < 5; ++w) {
+        const int n = widths[w];
+        for (int c = 0; c < 3; ++c) {
+            const int nComps = nCompsList[c];
+            std::vector<float> pixels(n * nComps);
+            for (std::size_t i = 0; i < pixels.size(); ++i) {
+                pixels[i] = (float)(std::rand() % 4000) / 1000.f - 2.f;
+            }
+            for (int withNaN = 0; withNaN < 2; ++withNaN) {
+                if (withNaN) {
+                    pixels[(n * nComps) / 2] = std::numeric_limits<float>::quiet_NaN();
+                }
+                for (int ch = 0; ch < 6; ++ch) {
+                    double vminScalar = std::numeric_limits<double>::infinity();
+                    double vmaxScalar = -std::numeric_limits<double>::infinity();
+                    double vmin = vminScalar;
+                    double vmax = vmaxScalar;
+                    ViewerRowConverter::findMinMax(&pixels[0], nComps, n, channelsList[ch], &vminScalar, &vmaxScalar, Color::eSIMDLevelNone);
+                    ViewerRowConverter::findMinMax(&pixels[0], nComps, n, channelsList[ch], &vmin, &vmax);
+                    EXPECT_EQ(0, std::memcmp(&vminScalar, &vmin, sizeof(double))) << "nComps " << nComps << " width " << n << " channels " << ch;
+                    EXPECT_EQ(0, std::memcmp(&vmaxScalar, &vmax, sizeof(double))) << "nComps " << nComps << " width " << n << " channels " << ch;
+                }
+            }
+        }
+    }
+}
+
+///Converts the first rows of a 4K frame to an 8-bit texture the way the viewer does
+static void
+convertFrame4K(Color::SIMDLevelEnum level,
+               int height,
+               std::vector<U32>* texture)
+{
+    const int width = 3840;
+    const std::vector<float> gammaLut = makeGammaLut(1. / 2.2);
+    ViewerRowConverter::Params params;
+    params.gain = 1.2;
+    params.gamma = 1. / 2.2;
+    params.gammaLut = &gammaLut[0];
+    params.gammaLutValuesCount = VIEWER_TEST_GAMMA_LUT_NB_VALUES;
+    params.colorSpace = Color::LutManager::sRGBLut();
+
+    std::vector<float> frame(width * 4);
+    std::srand(4);
+    for (int i = 0; i < width * 4; ++i) {
+        frame[i] = (float)(std::rand() % 1000) / 1000.f;
+    }
+
+    ViewerRowConverter converter(params, width, level);
+    texture->resize(width * height);
+    for (int y = 0; y < height; ++y) {
+        // deinterleave like the viewer does when it reads a RGBA float image
+        float* r = converter.red();
+        float* g = converter.green();
+        float* b = converter.blue();
+        float* a = converter.alpha();
+        for (int x = 0; x < width; ++x) {
+            r[x] = frame[x * 4];
+            g[x] = frame[x * 4 + 1];
+            b[x] = frame[x * 4 + 2];
+            a[x] = frame[x * 4 + 3];
+        }
+        converter.toBGRA8(width, 0, y, NULL, &(*texture)[y * width]);
+    }
+}
+
+// a 4K frame converted the way the viewer does gives the same texture on the SIMD and the scalar paths, over all
+// the rows of the dither pattern
+TEST(ViewerRowConverter, Frame4KMatchesScalar) {
+    std::vector<U32> textures[2];
+
+    convertFrame4K(Color::eSIMDLevelNone, 16, &textures[0]);
+    convertFrame4K(Color::getSupportedSIMDLevel(), 16, &textures[1]);
+    ASSERT_EQ( textures[0].size(), textures[1].size() );
+    EXPECT_EQ(0, std::memcmp( &textures[0][0], &textures[1][0], textures[0].size() * sizeof(U32) ) );
+}
+
+// benchmark, run with --gtest_also_run_disabled_tests --gtest_filter=ViewerRowConverter.DISABLED_Throughput4K
+// prints how fast a 4K frame is converted to an 8-bit texture on one thread, on the scalar and the SIMD paths
+TEST(ViewerRowConverter, DISABLED_Throughput4K) {
+    const int width = 3840;
+    const int height = 2160;
+    const Color::SIMDLevelEnum levels[] = { Color::eSIMDLevelNone, Color::getSupportedSIMDLevel() };
+    const char* names[] = { "scalar", "SIMD" };
+
+    for (int l = 0; l < 2; ++l) {
+        std::vector<U32> texture;
+        TimeLapse timer;
+        convertFrame4K(levels[l], height, &texture);
+        double elapsed = timer.getTimeSinceCreation();
+        std::cout << "Viewer 8-bit texture (" << names[l] << "): 4K frame in " << elapsed * 1000. << " ms, "
+                  << (int)( width * height / std::max(elapsed, 1e-9) / 1e6 ) << " Mpixels/s" << std::endl;
+    }
+}